@@ -21,30 +21,83 @@ SOURCES += \
     src/session.cpp \
     src/data/abstractlogdata.cpp \
     src/data/logdata.cpp \
+    src/data/logdataset.cpp \
+    src/data/mergedlogdata.cpp \
+    src/data/timestamprule.cpp \
+    src/data/timestampindex.cpp \
+    src/data/textencoding.cpp \
     src/data/logfiltereddata.cpp \
     src/data/logfiltereddataworkerthread.cpp \
     src/data/logdataworkerthread.cpp \
+    src/data/bytescanner.cpp \
+    src/data/compressedlinestorage.cpp \
+    src/data/linelengthstorage.cpp \
+    src/data/compressedfile.cpp \
+    src/data/indexcache.cpp \
+    src/data/rawmatcher.cpp \
+    src/data/compiledregexp.cpp \
+    src/data/literalprefilter.cpp \
+    src/data/patternsetmatcher.cpp \
+    src/data/lineblockcache.cpp \
+    src/data/matchset.cpp \
+    src/data/matchesexporter.cpp \
+    src/data/pipespooler.cpp \
+    src/data/remotefile.cpp \
+    src/data/scanreader.cpp \
+    src/data/fusedsearch.cpp \
+    src/data/searchquery.cpp \
+    src/data/fieldindex.cpp \
+    src/data/tokenindex.cpp \
+    src/data/trigramindex.cpp \
+    src/data/skipindex.cpp \
+    src/data/taskscheduler.cpp \
+    src/data/memorybudget.cpp \
+    src/data/spillfile.cpp \
+    src/data/searchchunker.cpp \
+    src/data/devicematcher.cpp \
+    src/data/columnindex.cpp \
+    src/data/matchhistogram.cpp \
+    src/data/templateindex.cpp \
+    src/data/statestore.cpp \
+    src/data/checkpointindex.cpp \
+    src/data/runindex.cpp \
+    src/data/logcomparison.cpp \
+    src/data/keywordmatcher.cpp \
+    src/data/blockcache.cpp \
+    src/data/matchestimator.cpp \
     src/mainwindow.cpp \
     src/crawlerwidget.cpp \
     src/abstractlogview.cpp \
     src/logmainview.cpp \
     src/filteredview.cpp \
     src/optionsdialog.cpp \
+    src/perfcounters.cpp \
+    src/perfcountersdialog.cpp \
+    src/globalsearchdialog.cpp \
+    src/tracerecorder.cpp \
+    src/batchrunner.cpp \
+    src/prewarmer.cpp \
     src/persistentinfo.cpp \
     src/configuration.cpp \
     src/filtersdialog.cpp \
     src/filterset.cpp \
+    src/filtercolorcache.cpp \
+    src/filtermap.cpp \
+    src/filterwatch.cpp \
     src/savedsearches.cpp \
     src/infoline.cpp \
     src/menuactiontooltipbehavior.cpp \
     src/selection.cpp \
     src/quickfind.cpp \
+    src/quickfindworker.cpp \
     src/quickfindpattern.cpp \
     src/quickfindwidget.cpp \
     src/sessioninfo.cpp \
     src/recentfiles.cpp \
     src/overview.cpp \
     src/overviewwidget.cpp \
+    src/matchhistogramwidget.cpp \
+    src/templatelistwidget.cpp \
     src/marks.cpp \
     src/quickfindmux.cpp \
     src/signalmux.cpp \
@@ -55,9 +108,53 @@ INCLUDEPATH += src/
 HEADERS += \
     src/data/abstractlogdata.h \
     src/data/logdata.h \
+    src/data/logdataset.h \
+    src/data/mergedlogdata.h \
+    src/data/timestamprule.h \
+    src/data/timestampindex.h \
+    src/data/textencoding.h \
+    src/data/linebuffer.h \
     src/data/logfiltereddata.h \
     src/data/logfiltereddataworkerthread.h \
     src/data/logdataworkerthread.h \
+    src/data/bytescanner.h \
+    src/data/compressedlinestorage.h \
+    src/data/linelengthstorage.h \
+    src/data/compressedfile.h \
+    src/data/indexcache.h \
+    src/data/rawmatcher.h \
+    src/data/compiledregexp.h \
+    src/data/literalprefilter.h \
+    src/data/patternsetmatcher.h \
+    src/data/lineblockcache.h \
+    src/data/matchset.h \
+    src/data/matchesexporter.h \
+    src/data/pipespooler.h \
+    src/data/readthroughfile.h \
+    src/data/remotefile.h \
+    src/data/scanreader.h \
+    src/data/fusedsearch.h \
+    src/data/searchquery.h \
+    src/data/fieldindex.h \
+    src/data/tokenindex.h \
+    src/data/trigramindex.h \
+    src/data/skipindex.h \
+    src/data/taskscheduler.h \
+    src/data/memorybudget.h \
+    src/data/spillfile.h \
+    src/data/searchchunker.h \
+    src/data/devicematcher.h \
+    src/data/columnindex.h \
+    src/data/matchhistogram.h \
+    src/data/templateindex.h \
+    src/data/statestore.h \
+    src/data/checkpointindex.h \
+    src/data/runindex.h \
+    src/data/logcomparison.h \
+    src/data/keywordmatcher.h \
+    src/data/blockcache.h \
+    src/data/bufferpool.h \
+    src/data/matchestimator.h \
     src/mainwindow.h \
     src/session.h \
     src/viewinterface.h \
@@ -67,15 +164,25 @@ HEADERS += \
     src/filteredview.h \
     src/abstractlogview.h \
     src/optionsdialog.h \
+    src/perfcounters.h \
+    src/perfcountersdialog.h \
+    src/globalsearchdialog.h \
+    src/tracerecorder.h \
+    src/batchrunner.h \
+    src/prewarmer.h \
     src/persistentinfo.h \
     src/configuration.h \
     src/filtersdialog.h \
     src/filterset.h \
+    src/filtercolorcache.h \
+    src/filtermap.h \
+    src/filterwatch.h \
     src/savedsearches.h \
     src/infoline.h \
     src/filewatcher.h \
     src/selection.h \
     src/quickfind.h \
+    src/quickfindworker.h \
     src/quickfindpattern.h \
     src/quickfindwidget.h \
     src/sessioninfo.h \
@@ -84,6 +191,8 @@ HEADERS += \
     src/menuactiontooltipbehavior.h \
     src/overview.h \
     src/overviewwidget.h \
+    src/matchhistogramwidget.h \
+    src/templatelistwidget.h \
     src/marks.h \
     src/qfnotifications.h \
     src/quickfindmux.h \
@@ -229,6 +338,45 @@ else {
     }
 }
 
+# Byte level search (e.g. CONFIG+=no-pcre2)
+system(pkg-config --exists libpcre2-8):!no-pcre2 {
+    message("Search using PCRE2 will be included")
+    QMAKE_CXXFLAGS += -DGLOGG_SUPPORTS_PCRE2
+    LIBS += -lpcre2-8
+}
+else {
+    message("Search using PCRE2 will NOT be included")
+}
+
+# Search on the GPU (e.g. CONFIG+=no-opencl)
+system(pkg-config --exists OpenCL):!no-opencl {
+    message("Search using OpenCL will be included")
+    QMAKE_CXXFLAGS += -DGLOGG_SUPPORTS_OPENCL
+    LIBS += -lOpenCL
+}
+else {
+    message("Search using OpenCL will NOT be included")
+}
+
+# Compressed files (e.g. CONFIG+=no-zlib)
+system(pkg-config --exists zlib):!no-zlib {
+    message("Reading gzip files will be included")
+    QMAKE_CXXFLAGS += -DGLOGG_SUPPORTS_GZIP
+    LIBS += -lz
+}
+else {
+    message("Reading gzip files will NOT be included")
+}
+
+system(pkg-config --exists libzstd):!no-zstd {
+    message("Reading zstd files will be included")
+    QMAKE_CXXFLAGS += -DGLOGG_SUPPORTS_ZSTD
+    LIBS += -lzstd
+}
+else {
+    message("Reading zstd files will NOT be included")
+}
+
 # Version checking
 version_checker {
     message("Version checker will be included")
@@ -245,17 +393,26 @@ else {
 linux-g++ {
     CONFIG += inotify
 }
+macx|freebsd-*|openbsd-*|netbsd-* {
+    CONFIG += kqueue
+}
 
 inotify {
     message("File watching using inotify")
     QMAKE_CXXFLAGS += -DGLOGG_SUPPORTS_INOTIFY
-    SOURCES += src/platformfilewatcher.cpp src/inotifywatchtowerdriver.cpp src/watchtower.cpp src/watchtowerlist.cpp
-    HEADERS += src/platformfilewatcher.h src/inotifywatchtowerdriver.h src/watchtower.h src/watchtowerlist.h
+    SOURCES += src/platformfilewatcher.cpp src/inotifywatchtowerdriver.cpp src/watchtower.cpp src/watchtowerlist.cpp src/filepoller.cpp src/pollingschedule.cpp
+    HEADERS += src/platformfilewatcher.h src/inotifywatchtowerdriver.h src/watchtower.h src/watchtowerlist.h src/filepoller.h src/pollingschedule.h
+}
+else:kqueue {
+    message("File watching using kqueue")
+    QMAKE_CXXFLAGS += -DGLOGG_SUPPORTS_KQUEUE
+    SOURCES += src/platformfilewatcher.cpp src/kqueuewatchtowerdriver.cpp src/watchtower.cpp src/watchtowerlist.cpp src/filepoller.cpp src/pollingschedule.cpp
+    HEADERS += src/platformfilewatcher.h src/kqueuewatchtowerdriver.h src/watchtower.h src/watchtowerlist.h src/filepoller.h src/pollingschedule.h
 }
 else {
     win32 {
-        SOURCES += src/platformfilewatcher.cpp src/winwatchtowerdriver.cpp src/watchtower.cpp src/watchtowerlist.cpp
-        HEADERS += src/platformfilewatcher.h src/winwatchtowerdriver.h src/watchtower.h src/watchtowerlist.h
+        SOURCES += src/platformfilewatcher.cpp src/winwatchtowerdriver.cpp src/watchtower.cpp src/watchtowerlist.cpp src/filepoller.cpp src/pollingschedule.cpp
+        HEADERS += src/platformfilewatcher.h src/winwatchtowerdriver.h src/watchtower.h src/watchtowerlist.h src/filepoller.h src/pollingschedule.h
     }
     else {
         SOURCES += src/qtfilewatcher.cpp
@@ -25,10 +25,13 @@
 
 #include <iostream>
 #include <cassert>
+#include <limits>
 
 #include <QApplication>
 #include <QClipboard>
 #include <QFile>
+#include <QFileDialog>
+#include <QMessageBox>
 #include <QRect>
 #include <QPaintEvent>
 #include <QPainter>
@@ -42,11 +45,15 @@
 
 #include "persistentinfo.h"
 #include "filterset.h"
+#include "filtercolorcache.h"
+#include "filtermap.h"
 #include "logmainview.h"
 #include "quickfind.h"
 #include "quickfindpattern.h"
 #include "overview.h"
 #include "configuration.h"
+#include "perfcounters.h"
+#include "tracerecorder.h"
 
 namespace {
 
@@ -100,17 +107,16 @@ LineChunk::LineChunk( int first_col, int last_col, ChunkType type )
     type_  = type;
 }
 
-QList<LineChunk> LineChunk::select( int sel_start, int sel_end ) const
+void LineChunk::select( int sel_start, int sel_end,
+        std::vector<LineChunk>* chunks ) const
 {
-    QList<LineChunk> list;
-
     if ( ( sel_start < start_ ) && ( sel_end < start_ ) ) {
         // Selection BEFORE this chunk: no change
-        list << LineChunk( *this );
+        chunks->push_back( *this );
     }
     else if ( sel_start > end_ ) {
         // Selection AFTER this chunk: no change
-        list << LineChunk( *this );
+        chunks->push_back( *this );
     }
     else /* if ( ( sel_start >= start_ ) && ( sel_end <= end_ ) ) */
     {
@@ -119,13 +125,17 @@ QList<LineChunk> LineChunk::select( int sel_start, int sel_end ) const
         sel_end   = qMin( sel_end, end_ );
 
         if ( sel_start > start_ )
-            list << LineChunk( start_, sel_start - 1, type_ );
-        list << LineChunk( sel_start, sel_end, Selected );
+            chunks->push_back( LineChunk( start_, sel_start - 1, type_ ) );
+        chunks->push_back( LineChunk( sel_start, sel_end, Selected ) );
         if ( sel_end < end_ )
-            list << LineChunk( sel_end + 1, end_, type_ );
+            chunks->push_back( LineChunk( sel_end + 1, end_, type_ ) );
     }
+}
 
-    return list;
+inline void LineDrawer::reset( const QColor& back_color )
+{
+    list.clear();
+    backColor_ = back_color;
 }
 
 inline void LineDrawer::addChunk( int first_col, int last_col,
@@ -135,7 +145,7 @@ inline void LineDrawer::addChunk( int first_col, int last_col,
         first_col = 0;
     int length = last_col - first_col + 1;
     if ( length > 0 ) {
-        list << Chunk ( first_col, length, fore, back );
+        list.push_back( Chunk( first_col, length, fore, back ) );
     }
 }
 
@@ -163,10 +173,13 @@ inline void LineDrawer::draw( QPainter& painter,
     int xPos = initialXPos;
     int yPos = initialYPos;
 
-    foreach ( Chunk chunk, list ) {
+    for ( const Chunk& chunk : list ) {
         // Draw each chunk
         // LOG(logDEBUG) << "Chunk: " << chunk.start() << " " << chunk.length();
-        QString cutline = line.mid( chunk.start(), chunk.length() );
+        // (using the characters of the line, without a copy)
+        const int start = qMin( chunk.start(), line.size() );
+        const QString cutline = QString::fromRawData( line.constData() + start,
+                qMin( chunk.length(), line.size() - start ) );
         const int chunk_width = cutline.length() * fontWidth;
         if ( xPos == initialXPos ) {
             // First chunk, we extend the left background a bit,
@@ -214,9 +227,9 @@ void DigitsBuffer::add( char character )
     timer_.start( timeout_ , this );
 }
 
-int DigitsBuffer::content()
+qint64 DigitsBuffer::content()
 {
-    int result = digits_.toInt();
+    qint64 result = digits_.toLongLong();
     reset();
 
     return result;
@@ -234,6 +247,8 @@ void DigitsBuffer::timerEvent( QTimerEvent* event )
 
 // Graphic parameters
 const int AbstractLogView::OVERVIEW_WIDTH = 27;
+const int AbstractLogView::SHAPED_LINE_MAX_LENGTH = 4096;
+const int AbstractLogView::SHAPED_LINES_CACHE_SIZE = 1000;
 
 AbstractLogView::AbstractLogView(const AbstractLogData* newLogData,
         const QuickFindPattern* const quickFindPattern, QWidget* parent) :
@@ -244,11 +259,17 @@ AbstractLogView::AbstractLogView(const AbstractLogData* newLogData,
     autoScrollTimer_(),
     selection_(),
     quickFindPattern_( quickFindPattern ),
-    quickFind_( newLogData, &selection_, quickFindPattern )
+    quickFind_( newLogData, &selection_, quickFindPattern ),
+    quickFindMatches_(), quickFindMatchesGeneration_( -1 ),
+    paintedLines_(), paintedWindowStarts_(), paintedChunks_(),
+    paintedSelectedChunks_(), lineDrawer_( QColor() ),
+    shapedLines_( SHAPED_LINES_CACHE_SIZE ),
+    shapedLinesFont_()
 {
     logData = newLogData;
 
     followMode_ = false;
+    tailWanted_ = false;
 
     selectionStarted_ = false;
     markingClickInitiated_ = false;
@@ -256,10 +277,14 @@ AbstractLogView::AbstractLogView(const AbstractLogData* newLogData,
     firstLine = 0;
     lastLine = 0;
     firstCol = 0;
+    verticalScrollScale_ = 1;
 
     overview_ = NULL;
     overviewWidget_ = NULL;
 
+    filterColorCache_ = NULL;
+    filterMap_ = NULL;
+
     // Display
     nbDigitsInLineNumber_ = 0;
     leftMarginPx_ = 0;
@@ -289,6 +314,8 @@ AbstractLogView::AbstractLogView(const AbstractLogData* newLogData,
             this, SIGNAL( notifyQuickFind( const QFNotification& ) ) );
     connect( &quickFind_, SIGNAL( clearNotification() ),
             this, SIGNAL( clearQuickFindNotification() ) );
+    connect( &quickFind_, SIGNAL( searchDone( qint64 ) ),
+            this, SLOT( handleQuickFindDone( qint64 ) ) );
 }
 
 AbstractLogView::~AbstractLogView()
@@ -319,7 +346,7 @@ void AbstractLogView::mousePressEvent( QMouseEvent* mouseEvent )
 
     if ( mouseEvent->button() == Qt::LeftButton )
     {
-        int line = convertCoordToLine( mouseEvent->y() );
+        qint64 line = convertCoordToLine( mouseEvent->y() );
 
         if ( mouseEvent->modifiers() & Qt::ShiftModifier )
         {
@@ -361,6 +388,8 @@ void AbstractLogView::mousePressEvent( QMouseEvent* mouseEvent )
             copyAction_->setStatusTip( tr("Copy the selection") );
         }
 
+        saveSelectionAction_->setEnabled( ! selection_.isEmpty() );
+
         if ( selection_.isPortion() ) {
             findNextAction_->setEnabled( true );
             findPreviousAction_->setEnabled( true );
@@ -386,35 +415,36 @@ void AbstractLogView::mouseMoveEvent( QMouseEvent* mouseEvent )
     // Selection implementation
     if ( selectionStarted_ )
     {
-        QPoint thisEndPos = convertCoordToFilePos( mouseEvent->pos() );
-        if ( thisEndPos != selectionCurrentEndPos_ )
+        FilePosition thisEndPos = convertCoordToFilePos( mouseEvent->pos() );
+        if ( thisEndPos.line() != selectionCurrentEndPos_.line()
+                || thisEndPos.column() != selectionCurrentEndPos_.column() )
         {
             // Are we on a different line?
-            if ( selectionStartPos_.y() != thisEndPos.y() )
+            if ( selectionStartPos_.line() != thisEndPos.line() )
             {
-                if ( thisEndPos.y() != selectionCurrentEndPos_.y() )
+                if ( thisEndPos.line() != selectionCurrentEndPos_.line() )
                 {
                     // This is a 'range' selection
-                    selection_.selectRange( selectionStartPos_.y(),
-                            thisEndPos.y() );
-                    emit updateLineNumber( thisEndPos.y() );
+                    selection_.selectRange( selectionStartPos_.line(),
+                            thisEndPos.line() );
+                    emit updateLineNumber( thisEndPos.line() );
                     update();
                 }
             }
             // So we are on the same line. Are we moving horizontaly?
-            else if ( thisEndPos.x() != selectionCurrentEndPos_.x() )
+            else if ( thisEndPos.column() != selectionCurrentEndPos_.column() )
             {
                 // This is a 'portion' selection
-                selection_.selectPortion( thisEndPos.y(),
-                        selectionStartPos_.x(), thisEndPos.x() );
+                selection_.selectPortion( thisEndPos.line(),
+                        selectionStartPos_.column(), thisEndPos.column() );
                 update();
             }
             // On the same line, and moving vertically then
             else
             {
                 // This is a 'line' selection
-                selection_.selectLine( thisEndPos.y() );
-                emit updateLineNumber( thisEndPos.y() );
+                selection_.selectLine( thisEndPos.line() );
+                emit updateLineNumber( thisEndPos.line() );
                 update();
             }
             selectionCurrentEndPos_ = thisEndPos;
@@ -436,7 +466,7 @@ void AbstractLogView::mouseReleaseEvent( QMouseEvent* mouseEvent )
 {
     if ( markingClickInitiated_ ) {
         markingClickInitiated_ = false;
-        int line = convertCoordToLine( mouseEvent->y() );
+        qint64 line = convertCoordToLine( mouseEvent->y() );
         if ( line == markingClickLine_ )
             emit markLine( line );
     }
@@ -452,7 +482,7 @@ void AbstractLogView::mouseDoubleClickEvent( QMouseEvent* mouseEvent )
 {
     if ( mouseEvent->button() == Qt::LeftButton )
     {
-        const QPoint pos = convertCoordToFilePos( mouseEvent->pos() );
+        const FilePosition pos = convertCoordToFilePos( mouseEvent->pos() );
         selectWordAtPosition( pos );
     }
 }
@@ -539,7 +569,7 @@ void AbstractLogView::keyPressEvent( QKeyEvent* keyEvent )
             switch ( (keyEvent->text())[0].toLatin1() ) {
                 case 'j':
                     {
-                        int delta = qMax( 1, digitsBuffer_.content() );
+                        qint64 delta = qMax<qint64>( 1, digitsBuffer_.content() );
                         emit followDisabled();
                         //verticalScrollBar()->triggerAction(
                         //QScrollBar::SliderSingleStepAdd);
@@ -548,7 +578,7 @@ void AbstractLogView::keyPressEvent( QKeyEvent* keyEvent )
                     }
                 case 'k':
                     {
-                        int delta = qMin( -1, - digitsBuffer_.content() );
+                        qint64 delta = qMin<qint64>( -1, - digitsBuffer_.content() );
                         emit followDisabled();
                         //verticalScrollBar()->triggerAction(
                         //QScrollBar::SliderSingleStepSub);
@@ -571,7 +601,7 @@ void AbstractLogView::keyPressEvent( QKeyEvent* keyEvent )
                     break;
                 case 'g':
                     {
-                        int newLine = qMax( 0, digitsBuffer_.content() - 1 );
+                        qint64 newLine = qMax<qint64>( 0, digitsBuffer_.content() - 1 );
                         if ( newLine >= logData->getNbLine() )
                             newLine = logData->getNbLine() - 1;
                         emit followDisabled();
@@ -579,6 +609,11 @@ void AbstractLogView::keyPressEvent( QKeyEvent* keyEvent )
                         emit updateLineNumber( newLine );
                         break;
                     }
+                case '%':
+                    emit followDisabled();
+                    emit percentRequested(
+                            qMin<qint64>( digitsBuffer_.content(), 100 ) );
+                    break;
                 case 'G':
                     emit followDisabled();
                     selection_.selectLine( logData->getNbLine() - 1 );
@@ -599,6 +634,12 @@ void AbstractLogView::keyPressEvent( QKeyEvent* keyEvent )
                     // Use the selected 'word' and search backward
                     findPreviousSelected();
                     break;
+                case ']':
+                    jumpToLineOfSameFilter( true );
+                    break;
+                case '[':
+                    jumpToLineOfSameFilter( false );
+                    break;
                 default:
                     keyEvent->ignore();
             }
@@ -630,20 +671,45 @@ void AbstractLogView::scrollContentsBy( int dx, int dy )
 {
     LOG(logDEBUG4) << "scrollContentsBy received";
 
-    firstLine = (firstLine - dy) > 0 ? firstLine - dy : 0;
-    firstCol  = (firstCol - dx) > 0 ? firstCol - dx : 0;
+    // The top line is read from the scroll bar (dy is not reliable, its
+    // value being set without signals by setTopLine()), unless the bar
+    // is still on the step of the line displayed.
+    Q_UNUSED( dy );
+    const qint64 value = verticalScrollBar()->value();
+    const qint64 line = ( value == firstLine / verticalScrollScale_ ) ?
+        firstLine : value * verticalScrollScale_;
+
+    scrollTo( line, qMax( firstCol - dx, 0 ) );
+}
+
+// Display the passed line at the top and the passed column at the left
+void AbstractLogView::scrollTo( qint64 line, int column )
+{
+    const qint64 previousFirstLine = firstLine;
+    const int previousFirstCol = firstCol;
+
+    firstLine = qMax( line, 0LL );
+    firstCol  = column;
     lastLine = qMin( logData->getNbLine(), firstLine + getNbVisibleLines() );
 
     // Update the overview if we have one
     if ( overview_ != NULL )
         overview_->updateCurrentPosition( firstLine, lastLine );
 
+    updateTailWanted();
+
     // Are we hovering over a new line?
     const QPoint mouse_pos = mapFromGlobal( QCursor::pos() );
     considerMouseHovering( mouse_pos.x(), mouse_pos.y() );
 
-    // Redraw
-    update();
+    // Scrolling vertically by less than a page, what is still visible
+    // is moved and only the lines exposed are painted.
+    const qint64 scrolledLines = firstLine - previousFirstLine;
+    if ( firstCol == previousFirstCol
+            && qAbs( scrolledLines ) < getNbVisibleLines() )
+        viewport()->scroll( 0, -scrolledLines * charHeight_ );
+    else
+        update();
 }
 
 void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
@@ -652,6 +718,9 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
     if ( (invalidRect.isEmpty()) || (logData == NULL) )
         return;
 
+    const PerfTimer timer( PerfCounters::PaintTime );
+    const TraceSpan span( "AbstractLogView::paintEvent", "gui" );
+
     LOG(logDEBUG4) << "paintEvent received, firstLine=" << firstLine
         << " lastLine=" << lastLine <<
         " rect: " << invalidRect.topLeft().x() <<
@@ -669,6 +738,7 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
         std::shared_ptr<const FilterSet> filterSet =
             Persistent<FilterSet>( "filterSet" );
         QColor foreColor, backColor;
+        bool isFiltered;
 
         static const QBrush normalBulletBrush = QBrush( Qt::white );
         static const QBrush matchBulletBrush = QBrush( Qt::red );
@@ -681,7 +751,7 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
 
         // First check the lines to be drawn are within range (might not be the case if
         // the file has just changed)
-        const int nbLines = logData->getNbLine();
+        const qint64 nbLines = logData->getNbLine();
         if ( nbLines == 0 ) {
             return;
         }
@@ -692,8 +762,32 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                 lastLine =  nbLines - 1;
         }
 
-        // Lines to write
-        const QStringList lines = logData->getExpandedLines( firstLine, lastLine - firstLine + 1 );
+        // Only the lines in the area to repaint are read and drawn
+        // (the ones exposed by a scroll, see scrollContentsBy())
+        const qint64 firstPaintedLine = qMin( lastLine,
+                firstLine + qMax( invalidRect.top(), 0 ) / fontHeight );
+        const qint64 lastPaintedLine = qMin( lastLine,
+                firstLine + invalidRect.bottom() / fontHeight );
+
+        // Lines to write (read in a buffer kept from one paint to the next)
+        logData->getExpandedLineWindows( firstPaintedLine,
+                lastPaintedLine - firstPaintedLine + 1, firstCol, nbCols,
+                &paintedLines_, &paintedWindowStarts_ );
+
+        if ( filterColorCache_ ) {
+            // Have the colours matched for the displayed lines and
+            // a page above and below (in the original file)
+            filterColorCache_->setFilterSet( *filterSet );
+
+            const qint64 nbPageLines = lastLine - firstLine + 1;
+            const qint64 firstPrefetched = qMax( 0LL, firstLine - nbPageLines );
+            const qint64 lastPrefetched = qMin<qint64>( nbLines - 1, lastLine + nbPageLines );
+            std::vector<qint64> prefetchedLines;
+            prefetchedLines.reserve( lastPrefetched - firstPrefetched + 1 );
+            for ( qint64 i = firstPrefetched; i <= lastPrefetched; i++ )
+                prefetchedLines.push_back( displayLineNumber( i ) - 1 );
+            filterColorCache_->prefetch( prefetchedLines );
+        }
 
         // First draw the bullet left margin
         painter.setPen(palette.color(QPalette::Text));
@@ -739,15 +833,46 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
         // used for mouse calculation etc...
         leftMarginPx_ = contentStartPosX;
 
+        // The QuickFind matches are kept for the lines painted, so
+        // repaints (hovering, scrolling a line...) don't search again.
+        if ( quickFindMatchesGeneration_ != quickFindPattern_->generation() ) {
+            quickFindMatches_.clear();
+            quickFindMatchesGeneration_ = quickFindPattern_->generation();
+        }
+
+        if ( shapedLinesFont_ != painter.font() ) {
+            shapedLines_.clear();
+            shapedLinesFont_ = painter.font();
+        }
+        // The shaped lines are drawn whole, clipped to the text area,
+        // shifted by the exact width of the columns scrolled
+        const qreal shapedLineOffset =
+            firstCol * QFontMetricsF( painter.font() ).width( QChar('a') );
+        painter.setClipRect( contentStartPosX + CONTENT_MARGIN_WIDTH, 0,
+                viewport()->width(), viewport()->height() );
+        painter.setClipping( false );
+
         // Then draw each line
-        for (int i = firstLine; i <= lastLine; i++) {
+        for (qint64 i = firstPaintedLine; i <= lastPaintedLine; i++) {
             // Position in pixel of the base line of the line to print
-            const int yPos = (i-firstLine) * fontHeight;
+            const int yPos = static_cast<int>( i - firstLine ) * fontHeight;
             const int xPos = contentStartPosX + CONTENT_MARGIN_WIDTH;
 
+            // (the file might have been truncated since it was indexed)
+            if ( i - firstPaintedLine >= paintedLines_.size() )
+                break;
+
             // string to print, cut to fit the length and position of the view
-            const QString line = lines[i - firstLine];
-            const QString cutLine = line.mid( firstCol, nbCols );
+            // (both using the characters in the buffer, without a copy)
+            // (a long line being only its window, starting at firstCol)
+            const QString line = paintedLines_.rawString( i - firstPaintedLine );
+            const int windowStart = paintedWindowStarts_[ i - firstPaintedLine ];
+            const bool isWindow = ( windowStart >= 0 );
+            const int cutStart = qMin( isWindow ? firstCol - windowStart : firstCol,
+                    line.size() );
+            const QString cutLine = QString::fromRawData(
+                    line.constData() + cutStart,
+                    qMin( nbCols, line.size() - cutStart ) );
 
             if ( selection_.isLineSelected( i ) ) {
                 // Reverse the selected line
@@ -755,9 +880,13 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                 backColor = palette.color( QPalette::Highlight );
                 painter.setPen(palette.color(QPalette::Text));
             }
-            else if ( filterSet->matchLine( logData->getLineString( i ),
+            else if ( filterColorCache_ ?
+                    ( filterColorCache_->getLineColors( displayLineNumber( i ) - 1,
+                            &isFiltered, &foreColor, &backColor ) && isFiltered ) :
+                    filterSet->matchLine( logData->getLineString( i ),
                         &foreColor, &backColor ) ) {
                 // Apply a filter to the line
+                // (lines not matched yet are shown with the default colours)
             }
             else {
                 // Use the default colors
@@ -770,17 +899,32 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
             bool isSelection =
                 selection_.getPortionForLine( i, &sel_start, &sel_end );
             // Has the line got elements to be highlighted
+            // (only in the window of a long line, which is not kept)
             QList<QuickFindMatch> qfMatchList;
-            bool isMatch =
+            const auto cachedMatches = quickFindMatches_.constFind( i );
+            if ( isWindow ) {
+                QList<QuickFindMatch> windowMatches;
+                quickFindPattern_->matchLine( line, windowMatches );
+                for ( const QuickFindMatch& match : windowMatches )
+                    qfMatchList.append( QuickFindMatch(
+                                windowStart + match.startColumn(), match.length() ) );
+            }
+            else if ( cachedMatches != quickFindMatches_.constEnd() )
+                qfMatchList = cachedMatches.value();
+            else {
                 quickFindPattern_->matchLine( line, qfMatchList );
+                quickFindMatches_.insert( i, qfMatchList );
+            }
+            bool isMatch = ! qfMatchList.isEmpty();
 
             if ( isSelection || isMatch ) {
                 // We use the LineDrawer and its chunks because the
                 // line has to be somehow highlighted
-                LineDrawer lineDrawer( backColor );
+                // (all kept from one line to the next)
+                lineDrawer_.reset( backColor );
 
                 // First we create a list of chunks with the highlights
-                QList<LineChunk> chunkList;
+                paintedChunks_.clear();
                 int column = 0; // Current column in line space
                 foreach( const QuickFindMatch match, qfMatchList ) {
                     int start = match.startColumn() - firstCol;
@@ -789,29 +933,30 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                     if ( ( start < 0 && end < 0 ) || start >= nbCols )
                         continue;
                     if ( start > column )
-                        chunkList << LineChunk( column, start - 1, LineChunk::Normal );
+                        paintedChunks_.push_back(
+                                LineChunk( column, start - 1, LineChunk::Normal ) );
                     column = qMin( start + match.length() - 1, nbCols );
-                    chunkList << LineChunk( qMax( start, 0 ), column,
-                                            LineChunk::Highlighted );
+                    paintedChunks_.push_back( LineChunk( qMax( start, 0 ), column,
+                                LineChunk::Highlighted ) );
                     column++;
                 }
                 if ( column <= cutLine.length() - 1 )
-                    chunkList << LineChunk( column, cutLine.length() - 1, LineChunk::Normal );
+                    paintedChunks_.push_back(
+                            LineChunk( column, cutLine.length() - 1, LineChunk::Normal ) );
 
                 // Then we add the selection if needed
-                QList<LineChunk> newChunkList;
                 if ( isSelection ) {
                     sel_start -= firstCol; // coord in line space
                     sel_end   -= firstCol;
 
-                    foreach ( const LineChunk chunk, chunkList ) {
-                        newChunkList << chunk.select( sel_start, sel_end );
-                    }
+                    paintedSelectedChunks_.clear();
+                    for ( const LineChunk& chunk : paintedChunks_ )
+                        chunk.select( sel_start, sel_end, &paintedSelectedChunks_ );
                 }
-                else
-                    newChunkList = chunkList;
+                const std::vector<LineChunk>& chunks =
+                    isSelection ? paintedSelectedChunks_ : paintedChunks_;
 
-                foreach ( const LineChunk chunk, newChunkList ) {
+                for ( const LineChunk& chunk : chunks ) {
                     // Select the colours
                     QColor fore;
                     QColor back;
@@ -821,8 +966,8 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                             back = backColor;
                             break;
                         case LineChunk::Highlighted:
-                            fore = QColor( "black" );
-                            back = QColor( "yellow" );
+                            fore = QColor( Qt::black );
+                            back = QColor( Qt::yellow );
                             // fore = highlightForeColor;
                             // back = highlightBackColor;
                             break;
@@ -831,10 +976,10 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                             back = palette.color( QPalette::Highlight );
                             break;
                     }
-                    lineDrawer.addChunk ( chunk, fore, back );
+                    lineDrawer_.addChunk ( chunk, fore, back );
                 }
 
-                lineDrawer.draw( painter, xPos, yPos,
+                lineDrawer_.draw( painter, xPos, yPos,
                                  viewport()->width(), cutLine,
                                  CONTENT_MARGIN_WIDTH );
             }
@@ -845,7 +990,40 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                 // (the rectangle is extended on the left to cover the small
                 // margin, it looks better (LineDrawer does the same) )
                 painter.setPen( foreColor );
-                painter.drawText( xPos, yPos + fontAscent, cutLine );
+                if ( ! isWindow && line.size() <= SHAPED_LINE_MAX_LENGTH ) {
+                    ShapedLine* shaped = shapedLines_.object( i );
+                    if ( ! shaped || shaped->text != line ) {
+                        shaped = new ShapedLine;
+                        // (a copy, the line is in paintedLines_)
+                        shaped->text = QString( line.constData(), line.size() );
+                        shaped->staticText.setTextFormat( Qt::PlainText );
+                        shaped->staticText.setPerformanceHint(
+                                QStaticText::AggressiveCaching );
+                        shaped->staticText.setText( shaped->text );
+                        shaped->staticText.prepare( QTransform(), painter.font() );
+                        shapedLines_.insert( i, shaped );
+                    }
+                    painter.setClipping( true );
+                    painter.drawStaticText( QPointF( xPos - shapedLineOffset, yPos ),
+                            shaped->staticText );
+                    painter.setClipping( false );
+                }
+                else {
+                    painter.drawText( xPos, yPos + fontAscent, cutLine );
+                }
+            }
+
+            // Then the number of lines folded into it, at the right
+            const qint64 nbFolded = foldedLines( i );
+            if ( nbFolded > 1 ) {
+                const QString badge =
+                    tr( " [%1 similar lines] " ).arg( nbFolded );
+                const int badgeWidth = painter.fontMetrics().width( badge );
+                const int badgeX = qMax( xPos, viewport()->width() - badgeWidth );
+                painter.fillRect( badgeX, yPos, badgeWidth, fontHeight,
+                        palette.color( QPalette::Mid ) );
+                painter.setPen( palette.color( QPalette::BrightText ) );
+                painter.drawText( badgeX, yPos + fontAscent, badge );
             }
 
             // Then draw the bullet
@@ -893,6 +1071,16 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
             }
 
         } // For each line
+
+        // Only the lines visible are kept (in place, the hash not
+        // being built again for each frame)
+        for ( auto matches = quickFindMatches_.begin();
+                matches != quickFindMatches_.end(); ) {
+            if ( matches.key() < firstLine || matches.key() > lastLine )
+                matches = quickFindMatches_.erase( matches );
+            else
+                ++matches;
+        }
     }
     LOG(logDEBUG4) << "End of repaint";
 }
@@ -900,7 +1088,7 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
 // These two functions are virtual and this implementation is clearly
 // only valid for a non-filtered display.
 // We count on the 'filtered' derived classes to override them.
-qint64 AbstractLogView::displayLineNumber( int lineNumber ) const
+qint64 AbstractLogView::displayLineNumber( qint64 lineNumber ) const
 {
     return lineNumber + 1; // show a 1-based index
 }
@@ -917,25 +1105,21 @@ void AbstractLogView::setOverview( Overview* overview,
     overviewWidget_ = overview_widget;
 
     if ( overviewWidget_ ) {
-        connect( overviewWidget_, SIGNAL( lineClicked ( int ) ),
+        connect( overviewWidget_, SIGNAL( lineClicked ( qint64 ) ),
                 this, SIGNAL( followDisabled() ) );
-        connect( overviewWidget_, SIGNAL( lineClicked ( int ) ),
-                this, SLOT( jumpToLine( int ) ) );
+        connect( overviewWidget_, SIGNAL( lineClicked ( qint64 ) ),
+                this, SLOT( jumpToLine( qint64 ) ) );
     }
     refreshOverview();
 }
 
+// The search is asynchronous, see handleQuickFindDone()
 void AbstractLogView::searchUsingFunction(
-        qint64 (QuickFind::*search_function)() )
+        void (QuickFind::*search_function)() )
 {
     emit followDisabled();
 
-    int line = (quickFind_.*search_function)();
-    if ( line >= 0 ) {
-        LOG(logDEBUG) << "search " << line;
-        displayLine( line );
-        emit updateLineNumber( line );
-    }
+    (quickFind_.*search_function)();
 }
 
 void AbstractLogView::searchForward()
@@ -976,6 +1160,8 @@ void AbstractLogView::followSet( bool checked )
     followMode_ = checked;
     if ( checked )
         jumpToBottom();
+
+    updateTailWanted();
 }
 
 void AbstractLogView::refreshOverview()
@@ -999,9 +1185,20 @@ void AbstractLogView::handlePatternUpdated()
     LOG(logDEBUG) << "AbstractLogView::handlePatternUpdated()";
 
     quickFind_.resetLimits();
+    quickFindMatches_.clear();
     update();
 }
 
+// Display the line the QuickFind search has found
+void AbstractLogView::handleQuickFindDone( qint64 line )
+{
+    if ( line >= 0 ) {
+        LOG(logDEBUG) << "search " << line;
+        displayLine( line );
+        emit updateLineNumber( line );
+    }
+}
+
 // OR the current with the current search expression
 void AbstractLogView::addToSearch()
 {
@@ -1042,7 +1239,22 @@ void AbstractLogView::copy()
 {
     static QClipboard* clipboard = QApplication::clipboard();
 
-    clipboard->setText( selection_.getSelectedText( logData ) );
+    clipboard->setMimeData( getSelectionMimeData() );
+}
+
+// Write the selection to a file
+void AbstractLogView::saveSelection()
+{
+    saveToFile( tr( "Save Selection" ), [this]( QIODevice* device )
+            { return selection_.writeSelectedText( logData, device ); } );
+}
+
+// Write all the lines (the results in the filtered view) to a file
+void AbstractLogView::saveAll()
+{
+    saveToFile( tr( "Save All Lines" ), [this]( QIODevice* device )
+            { return Selection::writeLines( logData, 0,
+                    logData->getNbLine() - 1, device ); } );
 }
 
 //
@@ -1053,6 +1265,9 @@ void AbstractLogView::updateData()
 {
     LOG(logDEBUG) << "AbstractLogView::updateData";
 
+    // The lines may have changed
+    quickFindMatches_.clear();
+
     // Check the top Line is within range
     if ( firstLine >= logData->getNbLine() ) {
         firstLine = 0;
@@ -1065,7 +1280,7 @@ void AbstractLogView::updateData()
     selection_.crop( logData->getNbLine() - 1 );
 
     // Adapt the scroll bars to the new content
-    verticalScrollBar()->setRange( 0, logData->getNbLine()-1 );
+    updateVerticalScrollRange();
     const int hScrollMaxValue = ( logData->getMaxLength() - getNbVisibleCols() + 1 ) > 0 ?
         ( logData->getMaxLength() - getNbVisibleCols() + 1 ) : 0;
     horizontalScrollBar()->setRange( 0, hScrollMaxValue );
@@ -1102,7 +1317,7 @@ void AbstractLogView::updateDisplaySize()
     lastLine = qMin( logData->getNbLine(), firstLine + getNbVisibleLines() );
 
     // Update the scroll bars
-    verticalScrollBar()->setPageStep( getNbVisibleLines() );
+    updateVerticalScrollRange();
 
     const int hScrollMaxValue = ( logData->getMaxLength() - getNbVisibleCols() + 1 ) > 0 ?
         ( logData->getMaxLength() - getNbVisibleCols() + 1 ) : 0;
@@ -1118,7 +1333,7 @@ void AbstractLogView::updateDisplaySize()
                 OVERVIEW_WIDTH - 1, viewport()->height() );
 }
 
-int AbstractLogView::getTopLine() const
+qint64 AbstractLogView::getTopLine() const
 {
     return firstLine;
 }
@@ -1128,13 +1343,32 @@ QString AbstractLogView::getSelection() const
     return selection_.getSelectedText( logData );
 }
 
+QMimeData* AbstractLogView::getSelectionMimeData() const
+{
+    return new SelectionMimeData( logData, selection_ );
+}
+
 void AbstractLogView::selectAll()
 {
     selection_.selectRange( 0, logData->getNbLine() - 1 );
     update();
 }
 
-void AbstractLogView::selectAndDisplayLine( int line )
+void AbstractLogView::setFilterColorCache( FilterColorCache* filterColorCache )
+{
+    filterColorCache_ = filterColorCache;
+
+    // Repaint when the lines we asked for are matched
+    connect( filterColorCache_, SIGNAL( colorsAvailable() ),
+            viewport(), SLOT( update() ) );
+}
+
+void AbstractLogView::setFilterMap( const FilterMap* filterMap )
+{
+    filterMap_ = filterMap;
+}
+
+void AbstractLogView::selectAndDisplayLine( qint64 line )
 {
     emit followDisabled();
     selection_.selectLine( line );
@@ -1144,15 +1378,14 @@ void AbstractLogView::selectAndDisplayLine( int line )
 
 // The difference between this function and displayLine() is quite
 // subtle: this one always jump, even if the line passed is visible.
-void AbstractLogView::jumpToLine( int line )
+void AbstractLogView::jumpToLine( qint64 line )
 {
     // Put the selected line in the middle if possible
-    int newTopLine = line - ( getNbVisibleLines() / 2 );
+    qint64 newTopLine = line - ( getNbVisibleLines() / 2 );
     if ( newTopLine < 0 )
         newTopLine = 0;
 
-    // This will also trigger a scrollContents event
-    verticalScrollBar()->setValue( newTopLine );
+    setTopLine( newTopLine );
 }
 
 void AbstractLogView::setLineNumbersVisible( bool lineNumbersVisible )
@@ -1177,18 +1410,18 @@ int AbstractLogView::getNbVisibleCols() const
 }
 
 // Converts the mouse x, y coordinates to the line number in the file
-int AbstractLogView::convertCoordToLine(int yPos) const
+qint64 AbstractLogView::convertCoordToLine(int yPos) const
 {
-    int line = firstLine + yPos / charHeight_;
+    qint64 line = firstLine + yPos / charHeight_;
 
     return line;
 }
 
 // Converts the mouse x, y coordinates to the char coordinates (in the file)
 // This function ensure the pos exists in the file.
-QPoint AbstractLogView::convertCoordToFilePos( const QPoint& pos ) const
+FilePosition AbstractLogView::convertCoordToFilePos( const QPoint& pos ) const
 {
-    int line = firstLine + pos.y() / charHeight_;
+    qint64 line = firstLine + pos.y() / charHeight_;
     if ( line >= logData->getNbLine() )
         line = logData->getNbLine() - 1;
     if ( line < 0 )
@@ -1207,14 +1440,46 @@ QPoint AbstractLogView::convertCoordToFilePos( const QPoint& pos ) const
 
     LOG(logDEBUG4) << "AbstractLogView::convertCoordToFilePos col="
         << column << " line=" << line;
-    QPoint point( column, line );
+    return FilePosition( line, column );
+}
 
-    return point;
+// Adapt the vertical scroll bar to the number of lines: when there are
+// more than its int can count, a step of the bar is several lines.
+void AbstractLogView::updateVerticalScrollRange()
+{
+    const qint64 nbLines = logData->getNbLine();
+    verticalScrollScale_ = nbLines / std::numeric_limits<int>::max() + 1;
+
+    // (the position of the view does not change)
+    QScrollBar* scrollBar = verticalScrollBar();
+    const bool blocked = scrollBar->blockSignals( true );
+    scrollBar->setRange( 0, qMax( nbLines - 1, 0LL ) / verticalScrollScale_ );
+    scrollBar->setPageStep(
+            qMax<qint64>( getNbVisibleLines() / verticalScrollScale_, 1 ) );
+    scrollBar->setValue( firstLine / verticalScrollScale_ );
+    scrollBar->blockSignals( blocked );
+}
+
+// Display the passed line at the top of the view, exactly even if
+// the scroll bar can only be put on a step of several lines.
+void AbstractLogView::setTopLine( qint64 line )
+{
+    if ( verticalScrollScale_ == 1 ) {
+        // This will also trigger a scrollContents event
+        verticalScrollBar()->setValue( line );
+    }
+    else {
+        QScrollBar* scrollBar = verticalScrollBar();
+        const bool blocked = scrollBar->blockSignals( true );
+        scrollBar->setValue( line / verticalScrollScale_ );
+        scrollBar->blockSignals( blocked );
+        scrollTo( line, firstCol );
+    }
 }
 
 // Makes the widget adjust itself to display the passed line.
 // Doing so, it will throw itself a scrollContents event.
-void AbstractLogView::displayLine( int line )
+void AbstractLogView::displayLine( qint64 line )
 {
     // If the line is already the screen
     if ( ( line >= firstLine ) &&
@@ -1227,21 +1492,21 @@ void AbstractLogView::displayLine( int line )
 }
 
 // Move the selection up and down by the passed number of lines
-void AbstractLogView::moveSelection( int delta )
+void AbstractLogView::moveSelection( qint64 delta )
 {
     LOG(logDEBUG) << "AbstractLogView::moveSelection delta=" << delta;
 
-    QList<int> selection = selection_.getLines();
-    int new_line;
+    qint64 first_line, last_line;
+    qint64 new_line;
 
     // If nothing is selected, do as if line -1 was.
-    if ( selection.isEmpty() )
-        selection.append( -1 );
+    if ( ! selection_.getLineRange( &first_line, &last_line ) )
+        first_line = last_line = -1;
 
     if ( delta < 0 )
-        new_line = selection.first() + delta;
+        new_line = first_line + delta;
     else
-        new_line = selection.last() + delta;
+        new_line = last_line + delta;
 
     if ( new_line < 0 )
         new_line = 0;
@@ -1263,11 +1528,13 @@ void AbstractLogView::jumpToStartOfLine()
 // Make the end of the lines in the selection visible
 void AbstractLogView::jumpToEndOfLine()
 {
-    QList<int> selection = selection_.getLines();
+    qint64 first_line, last_line;
+    if ( ! selection_.getLineRange( &first_line, &last_line ) )
+        return;
 
     // Search the longest line in the selection
     int max_length = 0;
-    foreach ( int line, selection ) {
+    for ( qint64 line = first_line; line <= last_line; line++ ) {
         int length = logData->getLineLength( line );
         if ( length > max_length )
             max_length = length;
@@ -1279,11 +1546,9 @@ void AbstractLogView::jumpToEndOfLine()
 // Make the end of the lines on the screen visible
 void AbstractLogView::jumpToRightOfScreen()
 {
-    QList<int> selection = selection_.getLines();
-
     // Search the longest line on screen
     int max_length = 0;
-    for ( int i = firstLine; i <= ( firstLine + getNbVisibleLines() ); i++ ) {
+    for ( qint64 i = firstLine; i <= ( firstLine + getNbVisibleLines() ); i++ ) {
         int length = logData->getLineLength( i );
         if ( length > max_length )
             max_length = length;
@@ -1295,22 +1560,39 @@ void AbstractLogView::jumpToRightOfScreen()
 // Jump to the first line
 void AbstractLogView::jumpToTop()
 {
-    // This will also trigger a scrollContents event
-    verticalScrollBar()->setValue( 0 );
+    setTopLine( 0 );
     update();       // in case the screen hasn't moved
 }
 
 // Jump to the last line
 void AbstractLogView::jumpToBottom()
 {
-    const int new_top_line =
+    const qint64 new_top_line =
         qMax( logData->getNbLine() - getNbVisibleLines() + 1, 0LL );
 
-    // This will also trigger a scrollContents event
-    verticalScrollBar()->setValue( new_top_line );
+    setTopLine( new_top_line );
     update();       // in case the screen hasn't moved
 }
 
+// Select the next (or previous) line coloured by the same filter
+// as the selected line, as far as the filter map knows.
+void AbstractLogView::jumpToLineOfSameFilter( bool forward )
+{
+    if ( filterMap_ == NULL || ! selection_.isSingleLine() )
+        return;
+
+    const qint64 line = selection_.selectedLine();
+    const int filter = filterMap_->filterOfLine( line );
+    if ( filter < 0 )
+        return;
+
+    const qint64 new_line = forward ?
+        filterMap_->nextLineOfFilter( filter, line ) :
+        filterMap_->previousLineOfFilter( filter, line );
+    if ( new_line >= 0 && new_line < logData->getNbLine() )
+        selectAndDisplayLine( new_line );
+}
+
 // Returns whether the character passed is a 'word' character
 inline bool AbstractLogView::isCharWord( char c )
 {
@@ -1324,10 +1606,10 @@ inline bool AbstractLogView::isCharWord( char c )
 }
 
 // Select the word under the given position
-void AbstractLogView::selectWordAtPosition( const QPoint& pos )
+void AbstractLogView::selectWordAtPosition( const FilePosition& pos )
 {
-    const int x = pos.x();
-    const QString line = logData->getExpandedLineString( pos.y() );
+    const int x = pos.column();
+    const QString line = logData->getExpandedLineString( pos.line() );
 
     if ( isCharWord( line[x].toLatin1() ) ) {
         // Search backward for the first character in the word
@@ -1350,7 +1632,7 @@ void AbstractLogView::selectWordAtPosition( const QPoint& pos )
             currentPos--;
         int end = currentPos;
 
-        selection_.selectPortion( pos.y(), start, end );
+        selection_.selectPortion( pos.line(), start, end );
         updateGlobalSelection();
         update();
     }
@@ -1363,7 +1645,7 @@ void AbstractLogView::updateGlobalSelection()
 
     // Updating it only for "non-trivial" (range or portion) selections
     if ( ! selection_.isSingleLine() )
-        clipboard->setText( selection_.getSelectedText( logData ),
+        clipboard->setMimeData( getSelectionMimeData(),
                 QClipboard::Selection );
 }
 
@@ -1395,17 +1677,50 @@ void AbstractLogView::createMenu()
     connect( addToSearchAction_, SIGNAL( triggered() ),
             this, SLOT( addToSearch() ) );
 
+    saveSelectionAction_ = new QAction( tr("&Save Selection As..."), this );
+    saveSelectionAction_->setStatusTip( tr("Write the selection to a file") );
+    connect( saveSelectionAction_, SIGNAL( triggered() ),
+            this, SLOT( saveSelection() ) );
+
+    saveAllAction_ = new QAction( tr("Save A&ll Lines As..."), this );
+    saveAllAction_->setStatusTip( tr("Write all the lines of this view to a file") );
+    connect( saveAllAction_, SIGNAL( triggered() ),
+            this, SLOT( saveAll() ) );
+
     popupMenu_ = new QMenu( this );
     popupMenu_->addAction( copyAction_ );
+    popupMenu_->addAction( saveSelectionAction_ );
+    popupMenu_->addAction( saveAllAction_ );
     popupMenu_->addSeparator();
     popupMenu_->addAction( findNextAction_ );
     popupMenu_->addAction( findPreviousAction_ );
     popupMenu_->addAction( addToSearchAction_ );
 }
 
+// The lines are written by blocks, as they are read, so the file
+// can be much larger than the memory.
+void AbstractLogView::saveToFile( const QString& title,
+        const std::function<bool( QIODevice* )>& write )
+{
+    const QString fileName = QFileDialog::getSaveFileName( this, title );
+    if ( fileName.isEmpty() )
+        return;
+
+    QFile file( fileName );
+    QApplication::setOverrideCursor( Qt::WaitCursor );
+    const bool written = file.open( QIODevice::WriteOnly ) && write( &file );
+    QApplication::restoreOverrideCursor();
+
+    if ( ! written ) {
+        LOG(logERROR) << "Cannot write " << fileName.toStdString();
+        QMessageBox::critical( this, title, tr( "Cannot write %1: %2" )
+                .arg( fileName, file.errorString() ) );
+    }
+}
+
 void AbstractLogView::considerMouseHovering( int x_pos, int y_pos )
 {
-    int line = convertCoordToLine( y_pos );
+    qint64 line = convertCoordToLine( y_pos );
     if ( ( x_pos < leftMarginPx_ )
             && ( line >= 0 )
             && ( line < logData->getNbLine() ) ) {
@@ -1424,3 +1739,15 @@ void AbstractLogView::considerMouseHovering( int x_pos, int y_pos )
         }
     }
 }
+
+void AbstractLogView::updateTailWanted()
+{
+    // (the first lines being all there is of a file starting to load)
+    const bool wanted = followMode_
+        || ( firstLine > 0 && lastLine >= logData->getNbLine() );
+
+    if ( wanted != tailWanted_ ) {
+        tailWanted_ = wanted;
+        emit tailWanted( wanted );
+    }
+}
@@ -21,17 +21,28 @@
 #ifndef ABSTRACTLOGVIEW_H
 #define ABSTRACTLOGVIEW_H
 
+#include <functional>
+#include <vector>
+
 #include <QAbstractScrollArea>
 #include <QBasicTimer>
+#include <QCache>
+#include <QHash>
+#include <QStaticText>
 
 #include "selection.h"
 #include "quickfind.h"
 #include "overviewwidget.h"
 #include "quickfindmux.h"
+#include "data/linebuffer.h"
 
 class QMenu;
 class QAction;
+class QIODevice;
+class QMimeData;
 class AbstractLogData;
+class FilterColorCache;
+class FilterMap;
 
 class LineChunk
 {
@@ -48,9 +59,11 @@ class LineChunk
     int end() const { return end_; }
     ChunkType type() const { return type_; }
 
-    // Returns 'true' if the selection is part of this chunk
-    // (at least partially), if so, it should be replaced by the list returned
-    QList<LineChunk> select( int selection_start, int selection_end ) const;
+    // Appends this chunk to the passed list, split in the parts
+    // before, in and after the selection if it is (at least partially)
+    // part of this chunk
+    void select( int selection_start, int selection_end,
+            std::vector<LineChunk>* chunks ) const;
 
   private:
     int start_;
@@ -67,6 +80,10 @@ class LineDrawer
     LineDrawer( const QColor& back_color) :
         list(), backColor_( back_color ) { };
 
+    // Remove the chunks (keeping their memory for the next line)
+    // and use the passed background colour
+    void reset( const QColor& back_color );
+
     // Add a chunk of line using the given colours.
     // Both first_col and last_col are included
     // An empty chunk will be ignored.
@@ -105,7 +122,7 @@ class LineDrawer
         QColor foreColor_;
         QColor backColor_;
     };
-    QList<Chunk> list;
+    std::vector<Chunk> list;
     QColor backColor_;
 };
 
@@ -125,7 +142,7 @@ class DigitsBuffer : public QObject
     // the timeout timer is reset.
     void add( char character );
     // Get the content of the buffer (0 if empty) and reset it.
-    int content();
+    qint64 content();
 
   protected:
     void timerEvent( QTimerEvent* event );
@@ -162,11 +179,21 @@ class AbstractLogView :
     // used when the font is changed.
     void updateDisplaySize();
     // Return the line number of the top line of the view
-    int getTopLine() const;
+    qint64 getTopLine() const;
     // Return the text of the current selection.
     QString getSelection() const;
+    // Returns the current selection for the clipboard (to be owned by
+    // it), its text being read only when pasted.
+    QMimeData* getSelectionMimeData() const;
     // Instructs the widget to select the whole text.
     void selectAll();
+    // Use the passed cache (not owned) to colour the lines,
+    // the FilterSet being matched directly if there is none.
+    void setFilterColorCache( FilterColorCache* filterColorCache );
+    // Use the passed map (not owned) to jump between the lines coloured
+    // by the same filter ('[' and ']'), the lines of the view must be
+    // the lines of the file.
+    void setFilterMap( const FilterMap* filterMap );
 
   protected:
     void mousePressEvent( QMouseEvent* mouseEvent );
@@ -184,11 +211,14 @@ class AbstractLogView :
     // Must be implemented to return wether the line number is
     // a match, a mark or just a normal line (used for coloured bullets)
     enum LineType { Normal, Marked, Match };
-    virtual LineType lineType( int lineNumber ) const = 0;
+    virtual LineType lineType( qint64 lineNumber ) const = 0;
 
     // Line number to display for line at the given index
-    virtual qint64 displayLineNumber( int lineNumber ) const;
+    virtual qint64 displayLineNumber( qint64 lineNumber ) const;
     virtual qint64 maxDisplayLineNumber() const;
+    // Number of lines folded into the line at the given index
+    // (shown next to it if more than one)
+    virtual qint64 foldedLines( qint64 ) const { return 1; }
 
     // Get the overview associated with this view, or NULL if there is none
     Overview* getOverview() const { return overview_; }
@@ -197,14 +227,14 @@ class AbstractLogView :
 
   signals:
     // Sent when a new line has been selected by the user.
-    void newSelection(int line);
+    void newSelection( qint64 line );
     // Sent up to the MainWindow to disable the follow mode
     void followDisabled();
     // Sent when the view wants the QuickFind widget pattern to change.
     void changeQuickFind( const QString& newPattern,
             QuickFindMux::QFDirection newDirection );
     // Sent up when the current line number is updated
-    void updateLineNumber( int line );
+    void updateLineNumber( qint64 line );
     // Sent up when quickFind wants to show a message to the user.
     void notifyQuickFind( const QFNotification& message );
     // Sent up when quickFind wants to clear the notification.
@@ -221,11 +251,17 @@ class AbstractLogView :
     // Sent up for view initiated quickfind searches
     void searchNext();
     void searchPrevious();
+    // Sent up when the user asks to go to a percentage of the lines
+    // (typing it followed by '%', as in vim)
+    void percentRequested( int percent );
+    // Sent when the end of the file starts or stops being looked at
+    // (followed or scrolled to), to have it indexed early
+    void tailWanted( bool wanted );
 
   public slots:
     // Makes the widget select and display the passed line.
     // Scrolling as necessary
-    void selectAndDisplayLine( int line );
+    void selectAndDisplayLine( qint64 line );
 
     // Use the current QFP to go and select the next match.
     virtual void searchForward();
@@ -250,21 +286,27 @@ class AbstractLogView :
     // Make the view jump to the specified line, regardless of weither it
     // is on the screen or not.
     // (does NOT emit followDisabled() )
-    void jumpToLine( int line );
+    void jumpToLine( qint64 line );
 
     // Configure the setting of whether to show line number margin
     void setLineNumbersVisible( bool lineNumbersVisible );
 
   private slots:
     void handlePatternUpdated();
+    void handleQuickFindDone( qint64 line );
     void addToSearch();
     void findNextSelected();
     void findPreviousSelected();
     void copy();
+    void saveSelection();
+    void saveAll();
 
   private:
     // Constants
     static const int OVERVIEW_WIDTH;
+    // Longest line kept shaped, and number of lines kept
+    static const int SHAPED_LINE_MAX_LENGTH;
+    static const int SHAPED_LINES_CACHE_SIZE;
 
     // Width of the bullet zone, including decoration
     int bulletZoneWidthPx_;
@@ -280,6 +322,8 @@ class AbstractLogView :
 
     // Follow mode
     bool followMode_;
+    // Whether the end of the file is looked at (see tailWanted())
+    bool tailWanted_;
 
     // Whether to show line numbers or not
     bool lineNumbersVisible_;
@@ -287,6 +331,11 @@ class AbstractLogView :
     // Pointer to the CrawlerWidget's data set
     const AbstractLogData* logData;
 
+    // Colours of the lines (not owned, can be NULL)
+    FilterColorCache* filterColorCache_;
+    // Filters colouring the whole file (not owned, can be NULL)
+    const FilterMap* filterMap_;
+
     // Pointer to the Overview object
     Overview* overview_;
 
@@ -297,9 +346,9 @@ class AbstractLogView :
 
     bool selectionStarted_;
     // Start of the selection (characters)
-    QPoint selectionStartPos_;
+    FilePosition selectionStartPos_;
     // Current end of the selection (characters)
-    QPoint selectionCurrentEndPos_;
+    FilePosition selectionCurrentEndPos_;
     QBasicTimer autoScrollTimer_;
 
     // Hovering state
@@ -314,6 +363,9 @@ class AbstractLogView :
     qint64 firstLine;
     qint64 lastLine;
     int firstCol;
+    // Number of lines in a step of the vertical scroll bar (more than
+    // one if the file has more lines than an int can count)
+    qint64 verticalScrollScale_;
 
     // Text handling
     int charWidth_;
@@ -322,6 +374,8 @@ class AbstractLogView :
     // Popup menu
     QMenu* popupMenu_;
     QAction* copyAction_;
+    QAction* saveSelectionAction_;
+    QAction* saveAllAction_;
     QAction* findNextAction_;
     QAction* findPreviousAction_;
     QAction* addToSearchAction_;
@@ -330,27 +384,59 @@ class AbstractLogView :
     const QuickFindPattern* const quickFindPattern_;
     // Our own QuickFind object
     QuickFind quickFind_;
+    // Matches of the QuickFind pattern in the lines painted last,
+    // for the pattern generation recorded (see paintEvent())
+    QHash<qint64, QList<QuickFindMatch>> quickFindMatches_;
+    int quickFindMatchesGeneration_;
+    // The lines painted last, the buffer being reused by each paint,
+    // and the column each starts at (-1 if it is the whole line, only
+    // the window displayed of the long lines being read)
+    LineBuffer paintedLines_;
+    std::vector<int> paintedWindowStarts_;
+    // The chunks of the highlighted lines, reused for each line
+    // painted (cleared, keeping their capacity)
+    std::vector<LineChunk> paintedChunks_;
+    std::vector<LineChunk> paintedSelectedChunks_;
+    LineDrawer lineDrawer_;
+    // The whole text of the lines painted recently, laid out for
+    // shapedLinesFont_, so a line is only shaped again when it changes
+    // (not when repainted with other colours or scrolled horizontally)
+    struct ShapedLine {
+        QString text;
+        QStaticText staticText;
+    };
+    QCache<qint64, ShapedLine> shapedLines_;
+    QFont shapedLinesFont_;
 
     int getNbVisibleLines() const;
     int getNbVisibleCols() const;
-    QPoint convertCoordToFilePos( const QPoint& pos ) const;
-    int convertCoordToLine( int yPos ) const;
+    FilePosition convertCoordToFilePos( const QPoint& pos ) const;
+    qint64 convertCoordToLine( int yPos ) const;
     int convertCoordToColumn( int xPos ) const;
-    void displayLine( int line );
-    void moveSelection( int y );
+    void updateVerticalScrollRange();
+    void setTopLine( qint64 line );
+    void scrollTo( qint64 line, int column );
+    void displayLine( qint64 line );
+    void moveSelection( qint64 delta );
     void jumpToStartOfLine();
     void jumpToEndOfLine();
     void jumpToRightOfScreen();
     void jumpToTop();
     void jumpToBottom();
-    void selectWordAtPosition( const QPoint& pos );
+    void jumpToLineOfSameFilter( bool forward );
+    void selectWordAtPosition( const FilePosition& pos );
 
     void createMenu();
+    // Write some lines to a file chosen by the user
+    void saveToFile( const QString& title,
+            const std::function<bool( QIODevice* )>& write );
 
     void considerMouseHovering( int x_pos, int y_pos );
+    // Emit tailWanted() if the end is looked at or not anymore
+    void updateTailWanted();
 
     // Search functions (for n/N)
-    void searchUsingFunction ( qint64 (QuickFind::*search_function)() );
+    void searchUsingFunction ( void (QuickFind::*search_function)() );
 
     // Utils functions
     bool isCharWord( char c );
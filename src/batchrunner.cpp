@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements BatchRunner.
+
+#include <iostream>
+#include <memory>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+
+#include "log.h"
+
+#include "data/logdata.h"
+#include "data/logfiltereddata.h"
+#include "data/tokenindex.h"
+#include "batchrunner.h"
+
+const int BatchRunner::printedBlockSize = 1024 * 1024;
+const int BatchRunner::linesPerRead = 10000;
+
+BatchRunner::BatchRunner( const Options& options )
+    : QObject(), options_( options ), loop_(),
+    loadingStatus_( LoadingStatus::Successful ), matched_( false )
+{
+}
+
+int BatchRunner::run()
+{
+    bool error = false;
+
+    for ( const std::string& fileName : options_.fileNames ) {
+        if ( ! processFile( QString::fromStdString( fileName ) ) ) {
+            std::cerr << "glogg: cannot read " << fileName << std::endl;
+            error = true;
+        }
+    }
+
+    if ( error )
+        return 2;
+    else if ( options_.pattern.empty() || matched_ )
+        return 0;
+    else
+        return 1;
+}
+
+void BatchRunner::loadingFinished( LoadingStatus status )
+{
+    loadingStatus_ = status;
+    loop_.quit();
+}
+
+void BatchRunner::searchProgressed( qint64, int progress )
+{
+    if ( progress >= 100 )
+        loop_.quit();
+}
+
+bool BatchRunner::processFile( const QString& fileName )
+{
+    const QFileInfo fileInfo( fileName );
+    if ( ! fileInfo.isFile() || ! fileInfo.isReadable() )
+        return false;
+
+    // The paths are the keys of the index cache
+    const QString path = fileInfo.absoluteFilePath();
+
+    const QRegExp regexp( QString::fromStdString( options_.pattern ),
+            options_.ignoreCase ? Qt::CaseInsensitive : Qt::CaseSensitive,
+            QRegExp::RegExp2 );
+
+    LogData logData;
+    connect( &logData, SIGNAL( loadingFinished( LoadingStatus ) ),
+            this, SLOT( loadingFinished( LoadingStatus ) ) );
+    logData.setPriority( TaskScheduler::Visible );
+    // The lines are searched as they are indexed, the file being
+    // read once
+    if ( ! options_.pattern.empty() )
+        logData.setFusedSearch( regexp );
+    logData.attachFile( path );
+    loop_.exec();
+
+    if ( loadingStatus_ != LoadingStatus::Successful )
+        return false;
+    LOG(logINFO) << "Indexed " << path.toStdString() << ": "
+        << logData.getNbLine() << " lines";
+
+    if ( options_.writeIndex ) {
+        // Saved to the index cache once built
+        TokenIndex tokens;
+        const bool interruptRequest = false;
+        tokens.setFile( path );
+        tokens.update( &logData, logData.getNbLine() + 1, &interruptRequest );
+    }
+
+    if ( options_.pattern.empty() )
+        return true;
+
+    std::unique_ptr<LogFilteredData> filteredData( logData.getNewFilteredData() );
+    connect( filteredData.get(), SIGNAL( searchProgressed( qint64, int ) ),
+            this, SLOT( searchProgressed( qint64, int ) ) );
+    if ( options_.writeIndex )
+        filteredData->setTokenIndexFile( path );
+    filteredData->setPriority( TaskScheduler::Visible );
+    filteredData->runSearch( regexp );
+    loop_.exec();
+
+    const LineNumber nbMatches = filteredData->getNbMatches();
+    matched_ = matched_ || nbMatches > 0;
+
+    // The lines are prefixed with their file if there are several
+    const QByteArray prefix = ( options_.fileNames.size() > 1 ) ?
+        QFile::encodeName( fileName ) + ':' : QByteArray();
+    if ( options_.countOnly )
+        std::cout << prefix.constData() << nbMatches << '\n';
+    else
+        printMatches( &logData, filteredData->getMatches(), prefix );
+    std::cout.flush();
+
+    return true;
+}
+
+// Each run of consecutive matches is read at once, undecoded.
+void BatchRunner::printMatches( const AbstractLogData* source,
+        const MatchSet& matches, const QByteArray& prefix ) const
+{
+    QByteArray block;
+    std::vector<int> lineEnds;
+
+    auto line = matches.begin();
+    while ( line != matches.end() ) {
+        const LineNumber first = *line;
+        int number = 0;
+        do {
+            ++line;
+            ++number;
+        } while ( line != matches.end() && *line == first + number
+                && number < linesPerRead );
+
+        const QByteArray data = source->getRawLines( first, number, &lineEnds );
+        for ( size_t i = 0; i < lineEnds.size(); i++ ) {
+            const int beginning = ( i == 0 ) ? 0 : lineEnds[i-1] + 1;
+            block.append( prefix );
+            block.append( data.constData() + beginning, lineEnds[i] - beginning );
+            block.append( '\n' );
+        }
+
+        if ( block.size() >= printedBlockSize ) {
+            std::cout.write( block.constData(), block.size() );
+            block.clear();
+        }
+    }
+
+    std::cout.write( block.constData(), block.size() );
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <string>
+#include <vector>
+
+#include <QObject>
+#include <QEventLoop>
+#include <QString>
+
+#include "loadingstatus.h"
+
+class AbstractLogData;
+class MatchSet;
+
+// Runs the pipeline of the GUI (a LogData then a LogFilteredData) over
+// files without a window (glogg --search or --index), for the scripts
+// and the servers prebuilding the indexes: the matching lines (or their
+// number) are printed to the standard output, like grep does.
+class BatchRunner : public QObject
+{
+  Q_OBJECT
+
+  public:
+    struct Options {
+        std::vector<std::string> fileNames;
+        // Searched for (as the extended regexps of the GUI), nothing
+        // being searched if empty
+        std::string pattern;
+        bool ignoreCase;
+        // Print the number of matching lines rather than the lines
+        bool countOnly;
+        // Build the token index of the files (see TokenIndex), which
+        // is kept in the index cache with their line positions
+        bool writeIndex;
+    };
+
+    BatchRunner( const Options& options );
+
+    // Process the files, running the event loop until done.
+    // Returns the exit status: 0 if a line matched (or the files have
+    // been indexed), 1 if none did and 2 if a file could not be read.
+    int run();
+
+  private slots:
+    void loadingFinished( LoadingStatus status );
+    void searchProgressed( qint64 nbMatches, int progress );
+
+  private:
+    // Size of the blocks of lines printed
+    static const int printedBlockSize;
+    // Most lines read at once
+    static const int linesPerRead;
+
+    // Index then search the file, returns false if it cannot be read
+    bool processFile( const QString& fileName );
+    // Print the matching lines of the source, prefixed with the
+    // file name if not empty
+    void printMatches( const AbstractLogData* source,
+            const MatchSet& matches, const QByteArray& prefix ) const;
+
+    const Options options_;
+    QEventLoop loop_;
+    LoadingStatus loadingStatus_;
+    bool matched_;
+};
+
+#endif
@@ -32,16 +32,28 @@ Configuration::Configuration()
     mainRegexpType_               = ExtendedRegexp;
     quickfindRegexpType_          = FixedString;
     quickfindIncremental_         = true;
+    mainSearchIncremental_        = false;
 
     overviewVisible_              = true;
     lineNumbersVisibleInMain_     = false;
     lineNumbersVisibleInFiltered_ = true;
+    contextLines_                 = 3;
 
     QFontInfo fi(mainFont_);
     LOG(logDEBUG) << "Default font is " << fi.family().toStdString();
 
     searchAutoRefresh_ = false;
     searchIgnoreCase_  = false;
+
+    growthCoalescingDelay_ = 100;
+    followRotation_ = true;
+
+    workerThreads_ = 0;
+    ioPolicy_ = 0;
+    memoryBudget_ = 0;
+    blockCacheSize_ = 64;
+    sharedIndexDirectory_ = QString();
+    prewarmFiles_ = 0;
 }
 
 // Accessor functions
@@ -76,6 +88,8 @@ void Configuration::retrieveFromStorage( QSettings& settings )
             settings.value( "regexpType.quickfind", quickfindRegexpType_ ).toInt() );
     if ( settings.contains( "quickfind.incremental" ) )
         quickfindIncremental_ = settings.value( "quickfind.incremental" ).toBool();
+    if ( settings.contains( "mainSearch.incremental" ) )
+        mainSearchIncremental_ = settings.value( "mainSearch.incremental" ).toBool();
 
     // View settings
     if ( settings.contains( "view.overviewVisible" ) )
@@ -86,6 +100,8 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     if ( settings.contains( "view.lineNumbersVisibleInFiltered" ) )
         lineNumbersVisibleInFiltered_ =
             settings.value( "view.lineNumbersVisibleInFiltered" ).toBool();
+    if ( settings.contains( "view.contextLines" ) )
+        contextLines_ = qMax( settings.value( "view.contextLines" ).toInt(), 0 );
 
     // Some sanity check (mainly for people upgrading)
     if ( quickfindIncremental_ )
@@ -96,6 +112,29 @@ void Configuration::retrieveFromStorage( QSettings& settings )
         searchAutoRefresh_ = settings.value( "defaultView.searchAutoRefresh" ).toBool();
     if ( settings.contains( "defaultView.searchIgnoreCase" ) )
         searchIgnoreCase_ = settings.value( "defaultView.searchIgnoreCase" ).toBool();
+
+    // File monitoring
+    if ( settings.contains( "monitoring.growthCoalescingDelay" ) )
+        growthCoalescingDelay_ =
+            settings.value( "monitoring.growthCoalescingDelay" ).toInt();
+    if ( settings.contains( "monitoring.followRotation" ) )
+        followRotation_ = settings.value( "monitoring.followRotation" ).toBool();
+
+    // Performance
+    if ( settings.contains( "performance.workerThreads" ) )
+        workerThreads_ = settings.value( "performance.workerThreads" ).toInt();
+    if ( settings.contains( "performance.ioPolicy" ) )
+        ioPolicy_ = settings.value( "performance.ioPolicy" ).toInt();
+    if ( settings.contains( "performance.memoryBudget" ) )
+        memoryBudget_ = settings.value( "performance.memoryBudget" ).toInt();
+    if ( settings.contains( "performance.blockCacheSize" ) )
+        blockCacheSize_ = settings.value( "performance.blockCacheSize" ).toInt();
+    if ( settings.contains( "performance.sharedIndexDirectory" ) )
+        sharedIndexDirectory_ =
+            settings.value( "performance.sharedIndexDirectory" ).toString();
+    if ( settings.contains( "performance.prewarmFiles" ) )
+        prewarmFiles_ =
+            qMax( settings.value( "performance.prewarmFiles" ).toInt(), 0 );
 }
 
 void Configuration::saveToStorage( QSettings& settings ) const
@@ -109,9 +148,19 @@ void Configuration::saveToStorage( QSettings& settings ) const
     settings.setValue( "regexpType.main", static_cast<int>( mainRegexpType_ ) );
     settings.setValue( "regexpType.quickfind", static_cast<int>( quickfindRegexpType_ ) );
     settings.setValue( "quickfind.incremental", quickfindIncremental_ );
+    settings.setValue( "mainSearch.incremental", mainSearchIncremental_ );
     settings.setValue( "view.overviewVisible", overviewVisible_ );
     settings.setValue( "view.lineNumbersVisibleInMain", lineNumbersVisibleInMain_ );
     settings.setValue( "view.lineNumbersVisibleInFiltered", lineNumbersVisibleInFiltered_ );
+    settings.setValue( "view.contextLines", contextLines_ );
     settings.setValue( "defaultView.searchAutoRefresh", searchAutoRefresh_ );
     settings.setValue( "defaultView.searchIgnoreCase", searchIgnoreCase_ );
+    settings.setValue( "monitoring.growthCoalescingDelay", growthCoalescingDelay_ );
+    settings.setValue( "monitoring.followRotation", followRotation_ );
+    settings.setValue( "performance.workerThreads", workerThreads_ );
+    settings.setValue( "performance.ioPolicy", ioPolicy_ );
+    settings.setValue( "performance.memoryBudget", memoryBudget_ );
+    settings.setValue( "performance.blockCacheSize", blockCacheSize_ );
+    settings.setValue( "performance.sharedIndexDirectory", sharedIndexDirectory_ );
+    settings.setValue( "performance.prewarmFiles", prewarmFiles_ );
 }
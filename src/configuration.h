@@ -30,6 +30,8 @@ enum SearchRegexpType {
     ExtendedRegexp,
     Wildcard,
     FixedString,
+    // Regexps combined with AND/OR/NOT (main search only)
+    BooleanQuery,
 };
 
 // Configuration class containing everything in the "Settings" dialog
@@ -54,6 +56,11 @@ class Configuration : public Persistable {
     { quickfindRegexpType_ = type; }
     void setQuickfindIncremental( bool is_incremental )
     { quickfindIncremental_ = is_incremental; }
+    // Whether the main search is run as it is typed
+    bool isMainSearchIncremental() const
+    { return mainSearchIncremental_; }
+    void setMainSearchIncremental( bool is_incremental )
+    { mainSearchIncremental_ = is_incremental; }
 
     // View settings
     bool isOverviewVisible() const
@@ -68,6 +75,12 @@ class Configuration : public Persistable {
     { lineNumbersVisibleInMain_ = lineNumbersVisible; }
     void setFilteredLineNumbersVisible( bool lineNumbersVisible )
     { lineNumbersVisibleInFiltered_ = lineNumbersVisible; }
+    // Number of lines shown before and after each match when the
+    // filtered view shows the matches with their context
+    int contextLines() const
+    { return contextLines_; }
+    void setContextLines( int nbLines )
+    { contextLines_ = nbLines; }
 
     // Default settings for new views
     bool isSearchAutoRefreshDefault() const
@@ -79,6 +92,57 @@ class Configuration : public Persistable {
     void setSearchIgnoreCaseDefault( bool ignore_case )
     { searchIgnoreCase_ = ignore_case; }
 
+    // Delay (in ms) during which the growth of a file is batched
+    // before being indexed, 0 to index each change immediately.
+    int growthCoalescingDelay() const
+    { return growthCoalescingDelay_; }
+    void setGrowthCoalescingDelay( int delay )
+    { growthCoalescingDelay_ = delay; }
+    // Whether a followed file being rotated is followed on into the
+    // new file, keeping the lines of the rotated one.
+    bool followRotation() const
+    { return followRotation_; }
+    void setFollowRotation( bool follow )
+    { followRotation_ = follow; }
+
+    // Number of threads indexing and searching the files (see
+    // TaskScheduler), 0 for one per core.
+    int workerThreads() const
+    { return workerThreads_; }
+    void setWorkerThreads( int nbThreads )
+    { workerThreads_ = nbThreads; }
+    // How the whole files are read when indexed and searched (a
+    // ScanReader::Policy: 0 cached, 1 sequential, 2 direct).
+    int ioPolicy() const
+    { return ioPolicy_; }
+    void setIoPolicy( int policy )
+    { ioPolicy_ = policy; }
+    // Memory the indexes of the files open can use before those of
+    // the hidden tabs are released (see MemoryBudget), in MiB,
+    // 0 for half the physical memory.
+    int memoryBudget() const
+    { return memoryBudget_; }
+    void setMemoryBudget( int mebibytes )
+    { memoryBudget_ = mebibytes; }
+    // Memory the blocks of data read from each network or remote file
+    // are kept compressed in (see BlockCache), in MiB, 0 for none.
+    int blockCacheSize() const
+    { return blockCacheSize_; }
+    void setBlockCacheSize( int mebibytes )
+    { blockCacheSize_ = mebibytes; }
+    // Directory the indexes of the big files are shared through with
+    // the other users of the machine (see IndexCache), none if empty.
+    QString sharedIndexDirectory() const
+    { return sharedIndexDirectory_; }
+    void setSharedIndexDirectory( const QString& directory )
+    { sharedIndexDirectory_ = directory; }
+    // Number of the most recent files indexed in the background at
+    // startup, so they open at once (see Prewarmer), 0 for none.
+    int prewarmFiles() const
+    { return prewarmFiles_; }
+    void setPrewarmFiles( int nbFiles )
+    { prewarmFiles_ = nbFiles; }
+
     // Reads/writes the current config in the QSettings object passed
     virtual void saveToStorage( QSettings& settings ) const;
     virtual void retrieveFromStorage( QSettings& settings );
@@ -89,15 +153,29 @@ class Configuration : public Persistable {
     SearchRegexpType mainRegexpType_;
     SearchRegexpType quickfindRegexpType_;
     bool quickfindIncremental_;
+    bool mainSearchIncremental_;
 
     // View settings
     bool overviewVisible_;
     bool lineNumbersVisibleInMain_;
     bool lineNumbersVisibleInFiltered_;
+    int contextLines_;
 
     // Default settings for new views
     bool searchAutoRefresh_;
     bool searchIgnoreCase_;
+
+    // File monitoring
+    int growthCoalescingDelay_;
+    bool followRotation_;
+
+    // Performance
+    int workerThreads_;
+    int ioPolicy_;
+    int memoryBudget_;
+    int blockCacheSize_;
+    QString sharedIndexDirectory_;
+    int prewarmFiles_;
 };
 
 #endif
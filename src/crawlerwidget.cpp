@@ -35,20 +35,32 @@
 #include <QStandardItemModel>
 #include <QHeaderView>
 #include <QListView>
+#include <QToolTip>
 
 #include "crawlerwidget.h"
 
 #include "quickfindpattern.h"
 #include "overview.h"
+#include "matchhistogramwidget.h"
+#include "templatelistwidget.h"
 #include "infoline.h"
 #include "savedsearches.h"
 #include "quickfindwidget.h"
 #include "persistentinfo.h"
 #include "configuration.h"
+#include "data/taskscheduler.h"
+#include "data/scanreader.h"
+#include "data/memorybudget.h"
+#include "data/blockcache.h"
+#include "data/indexcache.h"
+#include "data/timestamprule.h"
 
 // Palette for error signaling (yellow background)
 const QPalette CrawlerWidget::errorPalette( QColor( "yellow" ) );
 
+// Pause in the typing before an incremental search (in ms)
+const int CrawlerWidget::liveSearchDelay = 300;
+
 // Implementation of the view context for the CrawlerWidget
 class CrawlerWidgetContext : public ViewContextInterface {
   public:
@@ -57,10 +69,12 @@ class CrawlerWidgetContext : public ViewContextInterface {
     // Construct from the value passsed
     CrawlerWidgetContext( QList<int> sizes,
            bool ignore_case,
-           bool auto_refresh )
+           bool auto_refresh,
+           const QString& search_text )
         : sizes_( sizes ),
           ignore_case_( ignore_case ),
-          auto_refresh_( auto_refresh ) {}
+          auto_refresh_( auto_refresh ),
+          search_text_( search_text ) {}
 
     // Implementation of the ViewContextInterface function
     std::string toString() const;
@@ -70,18 +84,20 @@ class CrawlerWidgetContext : public ViewContextInterface {
 
     bool ignoreCase() const { return ignore_case_; }
     bool autoRefresh() const { return auto_refresh_; }
+    const QString& searchText() const { return search_text_; }
 
   private:
     QList<int> sizes_;
 
     bool ignore_case_;
     bool auto_refresh_;
+    QString search_text_;
 };
 
 // Constructor only does trivial construction. The real work is done once
 // the data is attached.
 CrawlerWidget::CrawlerWidget( QWidget *parent )
-        : QSplitter( parent ), overview_()
+        : QSplitter( parent ), overview_(), liveSearchTimer_()
 {
     logData_         = nullptr;
     logFilteredData_ = nullptr;
@@ -93,12 +109,20 @@ CrawlerWidget::CrawlerWidget( QWidget *parent )
     // Until we have received confirmation loading is finished, we
     // should consider we are loading something.
     loadingInProgress_ = true;
+    searchFollowsLoading_ = false;
+    restoredResultsFile_  = QString();
+    searchRunning_        = false;
+    searchUpdatePending_  = false;
+
+    searchCommand_ = -1;
+    exportCommand_ = -1;
 
     currentLineNumber_ = 0;
+    pendingJumpFraction_ = -1.0;
 }
 
 // The top line is first one on the main display
-int CrawlerWidget::getTopLine() const
+qint64 CrawlerWidget::getTopLine() const
 {
     return logMainView->getTopLine();
 }
@@ -111,11 +135,136 @@ QString CrawlerWidget::getSelectedText() const
         return logMainView->getSelection();
 }
 
+QMimeData* CrawlerWidget::getSelectionMimeData() const
+{
+    if ( filteredView->hasFocus() )
+        return filteredView->getSelectionMimeData();
+    else
+        return logMainView->getSelectionMimeData();
+}
+
+void CrawlerWidget::exportSearchResults( const QString& fileName )
+{
+    logFilteredData_->exportMatches( fileName );
+}
+
 void CrawlerWidget::selectAll()
 {
     activeView()->selectAll();
 }
 
+void CrawlerWidget::search( const QString& text, bool ignore_case )
+{
+    searchLineEdit->setEditText( text );
+    ignoreCaseCheck->setCheckState( ignore_case ? Qt::Checked : Qt::Unchecked );
+
+    startNewSearch();
+}
+
+void CrawlerWidget::showLines( const MatchSet& lines,
+        const QString& description )
+{
+    // The search ongoing is abandoned
+    searchRunning_        = false;
+    searchFollowsLoading_ = false;
+    searchUpdatePending_  = false;
+    searchInfoLine->hideGauge();
+    stopButton->setEnabled( false );
+    searchState_.resetState();
+
+    logFilteredData_->showLines( lines );
+
+    searchInfoLine->setPalette( searchInfoLineDefaultPalette );
+    searchInfoLine->setText( description );
+
+    filteredView->updateData();
+    overview_.updateData( logData_->getNbLine() );
+    histogramWidget_->updateHistogram();
+    update();
+}
+
+const LogData* CrawlerWidget::logData() const
+{
+    return logData_;
+}
+
+const LogFilteredData* CrawlerWidget::filteredData() const
+{
+    return logFilteredData_;
+}
+
+void CrawlerWidget::displayLine( qint64 line )
+{
+    if ( line >= 0 && line < logData_->getNbLine() )
+        logMainView->selectAndDisplayLine( line );
+}
+
+qint64 CrawlerWidget::nbNewWatchedMatches() const
+{
+    return filterWatch_->nbNewMatches();
+}
+
+void CrawlerWidget::acknowledgeWatchedMatches()
+{
+    filterWatch_->acknowledge();
+}
+
+void CrawlerWidget::saveSearchResults( const QString& file_name ) const
+{
+    // (a file not loaded yet keeps the results restored last)
+    if ( loadingInProgress_ || ! restoredResultsFile_.isEmpty() )
+        return;
+
+    IndexCache::SearchResults results;
+    LineNumber nb_lines;
+    if ( ! logFilteredData_->getCurrentSearch( &results.regexp, &nb_lines,
+                &results.maxLength ) )
+        results.regexp = QRegExp();
+    else if ( nb_lines > 0 ) {
+        results.nbLines = nb_lines;
+        results.matches = logFilteredData_->getMatches();
+    }
+
+    for ( const Mark& mark : logFilteredData_->getMarks() )
+        results.marks.push_back( mark.lineNumber() );
+
+    IndexCache().saveSearchResults( file_name,
+            logData_->getFileSize(), results );
+}
+
+void CrawlerWidget::restoreSearchResults( const QString& file_name )
+{
+    restoredResultsFile_ = file_name;
+}
+
+void CrawlerWidget::runCommand( qint32 id, const QString& command,
+        const QVariantMap& args )
+{
+    LOG(logDEBUG) << "CrawlerWidget::runCommand " << command.toStdString();
+
+    if ( command == "search" ) {
+        // The search replaced is not going to end
+        finishCommand( &searchCommand_, false );
+
+        search( args[ "pattern" ].toString(), args[ "ignoreCase" ].toBool() );
+
+        if ( searchState_.getState() != SearchState::NoSearch ) {
+            searchCommand_ = id;
+        }
+        else {
+            QVariantMap result;
+            result[ "error" ] = searchInfoLine->text();
+            emit commandFinished( id, false, result );
+        }
+    }
+    else if ( loadingInProgress_ ) {
+        commandsAfterLoading_.push_back( { id, command, args } );
+    }
+    else {
+        runLoadedCommand( id, command, args );
+    }
+}
+
 // Return a pointer to the view in which we should do the QuickFind
 SearchableWidgetInterface* CrawlerWidget::doGetActiveSearchable() const
 {
@@ -153,21 +302,59 @@ void CrawlerWidget::reload()
 {
     searchState_.resetState();
     logFilteredData_->clearSearch();
+    logFilteredData_->forgetPreviousSearches();
     filteredView->updateData();
+    histogramWidget_->updateHistogram();
     printSearchInfoMessage();
+    filterColorCache_->clear();
+    filterMap_->invalidateFrom( 0 );
+    filterWatch_->reset();
 
     logData_->reload();
 }
 
+void CrawlerWidget::reloadChanges()
+{
+    const bool searching = ( searchState_.getState() != SearchState::NoSearch );
+
+    switch ( logData_->reloadChanges() ) {
+        case LogData::Truncated:
+            reload();
+            break;
+        case LogData::PartiallyTruncated:
+            // The search goes on with the lines indexed again
+            // (the matches of the others being kept)
+            if ( searching )
+                searchFollowsLoading_ = true;
+            break;
+        default:
+            break;
+    }
+}
+
 //
 // Protected functions
 //
+void CrawlerWidget::showEvent( QShowEvent* event )
+{
+    QSplitter::showEvent( event );
+    updateTaskPriority();
+}
+
+void CrawlerWidget::hideEvent( QHideEvent* event )
+{
+    QSplitter::hideEvent( event );
+    updateTaskPriority();
+}
+
 void CrawlerWidget::doSetData(
         std::shared_ptr<LogData> log_data,
         std::shared_ptr<LogFilteredData> filtered_data )
 {
     logData_         = log_data.get();
     logFilteredData_ = filtered_data.get();
+
+    updateTaskPriority();
 }
 
 void CrawlerWidget::doSetQuickFindPattern(
@@ -196,6 +383,8 @@ void CrawlerWidget::doSetViewContext(
     setSizes( context.sizes() );
     ignoreCaseCheck->setCheckState( context.ignoreCase() ? Qt::Checked : Qt::Unchecked );
     searchRefreshCheck->setCheckState( context.autoRefresh() ? Qt::Checked : Qt::Unchecked );
+    // (searched for once the file is loaded, see restoreSearchResults)
+    searchLineEdit->setEditText( context.searchText() );
 }
 
 std::shared_ptr<const ViewContextInterface>
@@ -204,7 +393,9 @@ CrawlerWidget::doGetViewContext() const
     auto context = std::make_shared<const CrawlerWidgetContext>(
             sizes(),
             ( ignoreCaseCheck->checkState() == Qt::Checked ),
-            ( searchRefreshCheck->checkState() == Qt::Checked ) );
+            ( searchRefreshCheck->checkState() == Qt::Checked ),
+            ( searchInfoLine->text().isEmpty() && restoredResultsFile_.isEmpty() ) ?
+                QString() : searchLineEdit->currentText() );
 
     return static_cast<std::shared_ptr<const ViewContextInterface>>( context );
 }
@@ -215,6 +406,11 @@ CrawlerWidget::doGetViewContext() const
 
 void CrawlerWidget::startNewSearch()
 {
+    static std::shared_ptr<Configuration> config =
+        Persistent<Configuration>( "settings" );
+
+    liveSearchTimer_.stop();
+
     // Record the search line in the recent list
     // (reload the list first in case another glogg changed it)
     GetPersistentInfo().retrieve( "savedSearches" );
@@ -224,27 +420,69 @@ void CrawlerWidget::startNewSearch()
     // Update the SearchLine (history)
     updateSearchCombo();
     // Call the private function to do the search
-    replaceCurrentSearch( searchLineEdit->currentText() );
+    // (the live search of the text typed being reused)
+    replaceCurrentSearch( searchLineEdit->currentText(),
+            config->isMainSearchIncremental() );
 }
 
 void CrawlerWidget::stopSearch()
 {
     logFilteredData_->interruptSearch();
     searchState_.stopSearch();
+    searchFollowsLoading_ = false;
+    searchUpdatePending_  = false;
     printSearchInfoMessage();
+
+    finishCommand( &searchCommand_, false );
+}
+
+void CrawlerWidget::updateExportProgress( int percent )
+{
+    searchInfoLine->setText( tr("Exporting the results (%1 %)...").arg( percent ) );
+    searchInfoLine->displayGauge( percent );
+}
+
+void CrawlerWidget::exportFinished( bool success )
+{
+    searchInfoLine->hideGauge();
+    if ( success ) {
+        printSearchInfoMessage( logFilteredData_->getNbMatches() );
+    }
+    else {
+        searchInfoLine->setPalette( errorPalette );
+        searchInfoLine->setText( tr("The results could not be exported.") );
+    }
+
+    finishCommand( &exportCommand_, success );
 }
 
 // When receiving the 'newDataAvailable' signal from LogFilteredData
-void CrawlerWidget::updateFilteredView( int nbMatches, int progress )
+void CrawlerWidget::updateFilteredView( qint64 nbMatches, int progress )
 {
     LOG(logDEBUG) << "updateFilteredView received.";
 
     if ( progress == 100 ) {
-        // Searching done
-        printSearchInfoMessage( nbMatches );
-        searchInfoLine->hideGauge();
-        // De-activate the stop button
-        stopButton->setEnabled( false );
+        searchRunning_ = false;
+        if ( searchUpdatePending_ ) {
+            // More lines have been loaded meanwhile
+            searchUpdatePending_ = false;
+            searchRunning_ = true;
+            logFilteredData_->updateSearch();
+        }
+        else {
+            // Searching done
+            printSearchInfoMessage( nbMatches );
+            searchInfoLine->hideGauge();
+            // De-activate the stop button
+            stopButton->setEnabled( false );
+
+            // (the lines still to be loaded are searched next)
+            if ( ! loadingInProgress_ ) {
+                QVariantMap result;
+                result[ "matches" ] = nbMatches;
+                finishCommand( &searchCommand_, true, result );
+            }
+        }
     }
     else {
         // Search in progress
@@ -264,18 +502,20 @@ void CrawlerWidget::updateFilteredView( int nbMatches, int progress )
 
     // Update the match overview
     overview_.updateData( logData_->getNbLine() );
+    // and the chart, counted again from the matches found so far
+    histogramWidget_->updateHistogram();
 
     // Also update the top window for the coloured bullets.
     update();
 }
 
-void CrawlerWidget::jumpToMatchingLine(int filteredLineNb)
+void CrawlerWidget::jumpToMatchingLine( qint64 filteredLineNb )
 {
-    int mainViewLine = logFilteredData_->getMatchingLineNumber(filteredLineNb);
+    qint64 mainViewLine = logFilteredData_->getMatchingLineNumber(filteredLineNb);
     logMainView->selectAndDisplayLine(mainViewLine);  // FIXME: should be done with a signal.
 }
 
-void CrawlerWidget::updateLineNumberHandler( int line )
+void CrawlerWidget::updateLineNumberHandler( qint64 line )
 {
     currentLineNumber_ = line;
     emit updateLineNumber( line );
@@ -317,6 +557,26 @@ void CrawlerWidget::markLineFromFiltered( qint64 line )
     update();
 }
 
+void CrawlerWidget::markAllMatches()
+{
+    logFilteredData_->markAllMatches();
+
+    // Everything is refreshed once for all the new marks
+    filteredView->updateData();
+    overview_.updateData( logData_->getNbLine() );
+    update();
+}
+
+void CrawlerWidget::jumpToPercent( int percent )
+{
+    jumpToFraction( percent / 100.0 );
+}
+
+void CrawlerWidget::tailWantedHandler( bool wanted )
+{
+    logData_->setIndexingTail( wanted );
+}
+
 void CrawlerWidget::applyConfiguration()
 {
     std::shared_ptr<Configuration> config =
@@ -338,9 +598,28 @@ void CrawlerWidget::applyConfiguration()
     logMainView->setLineNumbersVisible( config->mainLineNumbersVisible() );
     filteredView->setLineNumbersVisible( config->filteredLineNumbersVisible() );
 
+    logFilteredData_->setContextLines( config->contextLines() );
+    filteredView->updateData();
+
     overview_.setVisible( config->isOverviewVisible() );
     logMainView->refreshOverview();
 
+    // The whole file is only mapped for the overview
+    filterMap_->setFilterSet( *Persistent<FilterSet>( "filterSet" ) );
+    filterMap_->setActive( config->isOverviewVisible() );
+    filterWatch_->setFilterSet( *Persistent<FilterSet>( "filterSet" ) );
+
+    logData_->setGrowthCoalescingDelay( config->growthCoalescingDelay() );
+    logData_->setFollowRotation( config->followRotation() );
+
+    TaskScheduler::instance().setMaxThreads( config->workerThreads() );
+    ScanReader::setPolicy( static_cast<ScanReader::Policy>( config->ioPolicy() ) );
+    MemoryBudget::instance().setLimit(
+            qint64( config->memoryBudget() ) * 1024 * 1024 );
+    BlockCache::setDefaultMaxBytes(
+            qint64( config->blockCacheSize() ) * 1024 * 1024 );
+    IndexCache::setSharedDirectory( config->sharedIndexDirectory() );
+
     logMainView->updateDisplaySize();
     logMainView->update();
     filteredView->updateDisplaySize();
@@ -377,17 +656,60 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
     // We need to refresh the main window because the view lines on the
     // overview have probably changed.
     overview_.updateData( logData_->getNbLine() );
+    // (the filters might have been changed while we were not displayed)
+    filterMap_->setFilterSet( *Persistent<FilterSet>( "filterSet" ) );
+    filterMap_->update();
+    // The lines of the first loading are not new
+    filterWatch_->setFilterSet( *Persistent<FilterSet>( "filterSet" ) );
+    filterWatch_->update();
 
     // FIXME, handle topLine
     // logMainView->updateData( logData_, topLine );
     logMainView->updateData();
+    templateListWidget_->mineTemplates();
+    // (the collapsed lines are all the lines of the file)
+    if ( logFilteredData_->getVisibility() == LogFilteredData::Collapsed )
+        filteredView->updateData();
+
+    if ( pendingJumpFraction_ >= 0.0 ) {
+        if ( status == LoadingStatus::Successful )
+            jumpToFraction( pendingJumpFraction_ );
+        pendingJumpFraction_ = -1.0;
+    }
 
         // Shall we Forbid starting a search when loading in progress?
         // searchButton->setEnabled( false );
 
     // searchButton->setEnabled( true );
 
+    // The search restored with the session, only the lines added
+    // since it was saved being searched
+    if ( ! restoredResultsFile_.isEmpty() ) {
+        IndexCache::SearchResults results;
+        if ( status == LoadingStatus::Successful
+                && IndexCache().loadSearchResults( restoredResultsFile_, &results ) ) {
+            if ( ! results.regexp.isEmpty() )
+                logFilteredData_->restoreMatches( results.regexp,
+                        results.matches, results.nbLines, results.maxLength );
+
+            std::vector<qint64> marks;
+            for ( qint64 line : results.marks ) {
+                if ( line < logData_->getNbLine() )
+                    marks.push_back( line );
+            }
+            logFilteredData_->addMarks( marks );
+            filteredView->updateData();
+        }
+        restoredResultsFile_ = QString();
+
+        if ( ! searchLineEdit->currentText().isEmpty() )
+            replaceCurrentSearch( searchLineEdit->currentText() );
+    }
+
     // See if we need to auto-refresh the search
+    const bool searchFollowsLoading = searchFollowsLoading_;
+    searchFollowsLoading_ = false;
+    searchUpdatePending_  = false;
     if ( searchState_.isAutorefreshAllowed() ) {
         if ( searchState_.isFileTruncated() )
             // We need to restart the search
@@ -395,24 +717,83 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
         else
             logFilteredData_->updateSearch();
     }
+    else if ( searchFollowsLoading ) {
+        // The last lines loaded are searched (or none if the lines
+        // shown while loading are not anymore)
+        if ( status == LoadingStatus::Successful )
+            logFilteredData_->updateSearch();
+        else
+            replaceCurrentSearch( searchLineEdit->currentText() );
+    }
 
     emit loadingFinished( status );
+
+    std::vector<Command> commands;
+    commands.swap( commandsAfterLoading_ );
+    for ( const Command& command : commands )
+        runLoadedCommand( command.id, command.command, command.args );
+}
+
+void CrawlerWidget::linesIndexedHandler( qint64 nbLines )
+{
+    overview_.updateData( nbLines );
+    logMainView->updateData();
+    templateListWidget_->mineTemplates();
+    if ( logFilteredData_->getVisibility() == LogFilteredData::Collapsed )
+        filteredView->updateData();
+
+    if ( pendingJumpFraction_ >= 0.0 )
+        jumpToFraction( pendingJumpFraction_ );
+
+    // (the search being updated once done if it is running)
+    if ( searchFollowsLoading_ ) {
+        if ( searchRunning_ ) {
+            searchUpdatePending_ = true;
+        }
+        else {
+            searchRunning_ = true;
+            logFilteredData_->updateSearch();
+        }
+    }
 }
 
 void CrawlerWidget::fileChangedHandler( LogData::MonitoredFileStatus status )
 {
+    // The colours of the lines are kept if the file is only added to
+    // or only its end is changed (apart from the last line kept which
+    // might have been incomplete)
+    if ( status == LogData::Truncated ) {
+        filterColorCache_->clear();
+        filterMap_->invalidateFrom( 0 );
+        // (the file being written again, all its lines are new)
+        filterWatch_->restartFrom( 0 );
+    }
+    else {
+        filterColorCache_->invalidateFrom( logData_->getNbLine() - 1 );
+        filterMap_->invalidateFrom( logData_->getNbLine() - 1 );
+    }
+
     // Handle the case where the file has been truncated
     if ( status == LogData::Truncated ) {
+        // The matches kept for the queries are not valid anymore
+        logFilteredData_->forgetPreviousSearches();
         // Clear all marks (TODO offer the option to keep them)
         logFilteredData_->clearMarks();
         if ( ! searchInfoLine->text().isEmpty() ) {
             // Invalidate the search
             logFilteredData_->clearSearch();
             filteredView->updateData();
+            histogramWidget_->updateHistogram();
             searchState_.truncateFile();
             printSearchInfoMessage();
         }
     }
+    else if ( status == LogData::PartiallyTruncated ) {
+        // Only the matches and marks of the lines removed are forgotten,
+        // the search being continued once the new lines are indexed.
+        logFilteredData_->truncate( logData_->getNbLine() );
+        filteredView->updateData();
+    }
 }
 
 // Returns a pointer to the window in which the search should be done
@@ -459,9 +840,38 @@ void CrawlerWidget::searchRefreshChangedHandler( int state )
 
 void CrawlerWidget::searchTextChangeHandler()
 {
+    static std::shared_ptr<Configuration> config =
+        Persistent<Configuration>( "settings" );
+
     // We suspend auto-refresh
     searchState_.changeExpression();
     printSearchInfoMessage( logFilteredData_->getNbMatches() );
+    estimateMatches();
+
+    // The search is run once the typing pauses
+    // (searching within the results only on demand)
+    if ( config->isMainSearchIncremental()
+            && searchWithinCheck->checkState() != Qt::Checked )
+        liveSearchTimer_.start();
+}
+
+void CrawlerWidget::runLiveSearch()
+{
+    LOG(logDEBUG) << "Live search of the text typed";
+
+    replaceCurrentSearch( searchLineEdit->currentText(), true );
+}
+
+void CrawlerWidget::matchesEstimated( const QRegExp& regexp, qint64 nbMatches,
+        qint64 nbLinesSampled, qint64 searchTime )
+{
+    // The text might have been searched (or changed) meanwhile
+    if ( estimatedRegExp_.isEmpty() || regexp != estimatedRegExp_ )
+        return;
+
+    searchInfoLine->setPalette( searchInfoLineDefaultPalette );
+    searchInfoLine->setText( MatchEstimator::describe( nbMatches,
+                nbLinesSampled, logData_->getNbLine(), searchTime ) );
 }
 
 void CrawlerWidget::changeFilteredViewVisibility( int index )
@@ -497,6 +907,18 @@ void CrawlerWidget::mouseHoveredOverMatch( qint64 line )
     overviewWidget_->highlightLine( line_in_mainview );
 }
 
+void CrawlerWidget::filterMapUpdated()
+{
+    overview_.updateData( logData_->getNbLine() );
+    logMainView->refreshOverview();
+}
+
+void CrawlerWidget::searchTemplate( int id )
+{
+    searchLineEdit->setEditText( TemplateIndex::termOfTemplate( id ) );
+    startNewSearch();
+}
+
 //
 // Private functions
 //
@@ -518,6 +940,22 @@ void CrawlerWidget::setup()
     filteredView    = new FilteredView(
             logFilteredData_, quickFindPattern_.get() );
 
+    filterColorCache_.reset( new FilterColorCache( logData_ ) );
+    logMainView->setFilterColorCache( filterColorCache_.get() );
+    filteredView->setFilterColorCache( filterColorCache_.get() );
+
+    filterMap_.reset( new FilterMap( logData_ ) );
+    overview_.setFilterMap( filterMap_.get() );
+    logMainView->setFilterMap( filterMap_.get() );
+    filterMap_->setFilterSet( *Persistent<FilterSet>( "filterSet" ) );
+    filterMap_->setActive(
+            Persistent<Configuration>( "settings" )->isOverviewVisible() );
+
+    filterWatch_.reset( new FilterWatch( logData_ ) );
+    filterWatch_->setFilterSet( *Persistent<FilterSet>( "filterSet" ) );
+
+    matchEstimator_.reset( new MatchEstimator( logData_ ) );
+
     overviewWidget_->setOverview( &overview_ );
     overviewWidget_->setParent( logMainView );
 
@@ -545,6 +983,20 @@ void CrawlerWidget::setup()
     matchesItem->setData( FilteredView::MatchesOnly );
     visibilityModel_->appendRow( matchesItem );
 
+    QStandardItem *contextItem = new QStandardItem( tr( "Matches with context" ) );
+    QPixmap contextPixmap( 16, 10 );
+    contextPixmap.fill( Qt::darkRed );
+    contextItem->setIcon( QIcon( contextPixmap ) );
+    contextItem->setData( FilteredView::MatchesWithContext );
+    visibilityModel_->appendRow( contextItem );
+
+    QStandardItem *collapsedItem = new QStandardItem( tr( "Collapsed lines" ) );
+    QPixmap collapsedPixmap( 16, 10 );
+    collapsedPixmap.fill( Qt::gray );
+    collapsedItem->setIcon( QIcon( collapsedPixmap ) );
+    collapsedItem->setData( FilteredView::Collapsed );
+    visibilityModel_->appendRow( collapsedItem );
+
     QListView *visibilityView = new QListView( this );
     visibilityView->setMovement( QListView::Static );
     visibilityView->setMinimumWidth( 170 ); // Only needed with custom style-sheet
@@ -584,6 +1036,9 @@ void CrawlerWidget::setup()
 
     ignoreCaseCheck = new QCheckBox( "Ignore &case" );
     searchRefreshCheck = new QCheckBox( "Auto-&refresh" );
+    searchWithinCheck = new QCheckBox( "&Within results" );
+    searchWithinCheck->setToolTip(
+            tr("Search only the lines matching the current search") );
 
     // Construct the Search line
     searchLabel = new QLabel(tr("&Text: "));
@@ -605,25 +1060,63 @@ void CrawlerWidget::setup()
     stopButton->setAutoRaise( true );
     stopButton->setEnabled( false );
 
+    markAllButton = new QToolButton();
+    markAllButton->setText( tr("Mark all") );
+    markAllButton->setToolTip( tr("Mark all the lines matching the search") );
+    markAllButton->setAutoRaise( true );
+
+    // The chart of the matches, shown on demand
+    histogramButton = new QToolButton();
+    histogramButton->setText( tr("Histogram") );
+    histogramButton->setToolTip(
+            tr("Show the number of matches by period of time") );
+    histogramButton->setCheckable( true );
+    histogramButton->setAutoRaise( true );
+
+    histogramWidget_ = new MatchHistogramWidget();
+    histogramWidget_->setFilteredData( logFilteredData_ );
+    histogramWidget_->hide();
+
+    // and the templates of the messages, mined while shown
+    templatesButton = new QToolButton();
+    templatesButton->setText( tr("Templates") );
+    templatesButton->setToolTip(
+            tr("Show the most frequent messages, their parameters aside") );
+    templatesButton->setCheckable( true );
+    templatesButton->setAutoRaise( true );
+
+    templateListWidget_ = new TemplateListWidget();
+    templateListWidget_->setFilteredData( logFilteredData_ );
+    templateListWidget_->hide();
+
     QHBoxLayout* searchLineLayout = new QHBoxLayout;
     searchLineLayout->addWidget(searchLabel);
     searchLineLayout->addWidget(searchLineEdit);
     searchLineLayout->addWidget(searchButton);
     searchLineLayout->addWidget(stopButton);
+    searchLineLayout->addWidget(markAllButton);
+    searchLineLayout->addWidget(histogramButton);
+    searchLineLayout->addWidget(templatesButton);
     searchLineLayout->setContentsMargins(6, 0, 6, 0);
     stopButton->setSizePolicy( QSizePolicy( QSizePolicy::Maximum, QSizePolicy::Maximum ) );
     searchButton->setSizePolicy( QSizePolicy( QSizePolicy::Maximum, QSizePolicy::Maximum ) );
+    markAllButton->setSizePolicy( QSizePolicy( QSizePolicy::Maximum, QSizePolicy::Maximum ) );
+    histogramButton->setSizePolicy( QSizePolicy( QSizePolicy::Maximum, QSizePolicy::Maximum ) );
+    templatesButton->setSizePolicy( QSizePolicy( QSizePolicy::Maximum, QSizePolicy::Maximum ) );
 
     QHBoxLayout* searchInfoLineLayout = new QHBoxLayout;
     searchInfoLineLayout->addWidget( visibilityBox );
     searchInfoLineLayout->addWidget( searchInfoLine );
     searchInfoLineLayout->addWidget( ignoreCaseCheck );
     searchInfoLineLayout->addWidget( searchRefreshCheck );
+    searchInfoLineLayout->addWidget( searchWithinCheck );
 
     // Construct the bottom window
     QVBoxLayout* bottomMainLayout = new QVBoxLayout;
     bottomMainLayout->addLayout(searchLineLayout);
     bottomMainLayout->addLayout(searchInfoLineLayout);
+    bottomMainLayout->addWidget(histogramWidget_);
+    bottomMainLayout->addWidget(templateListWidget_);
     bottomMainLayout->addWidget(filteredView);
     bottomMainLayout->setContentsMargins(2, 1, 2, 1);
     bottomWindow->setLayout(bottomMainLayout);
@@ -644,29 +1137,52 @@ void CrawlerWidget::setup()
     ignoreCaseCheck->setCheckState( config->isSearchIgnoreCaseDefault() ?
             Qt::Checked : Qt::Unchecked );
 
+    // Growth of the file indexed (and searched) by batches
+    logData_->setGrowthCoalescingDelay( config->growthCoalescingDelay() );
+    // and followed on through its rotations
+    logData_->setFollowRotation( config->followRotation() );
+
     // Connect the signals
     connect(searchLineEdit->lineEdit(), SIGNAL( returnPressed() ),
             searchButton, SIGNAL( clicked() ));
     connect(searchLineEdit->lineEdit(), SIGNAL( textEdited( const QString& ) ),
             this, SLOT( searchTextChangeHandler() ));
+    liveSearchTimer_.setSingleShot( true );
+    liveSearchTimer_.setInterval( liveSearchDelay );
+    connect(&liveSearchTimer_, SIGNAL( timeout() ),
+            this, SLOT( runLiveSearch() ));
     connect(searchButton, SIGNAL( clicked() ),
             this, SLOT( startNewSearch() ) );
     connect(stopButton, SIGNAL( clicked() ),
             this, SLOT( stopSearch() ) );
+    connect(markAllButton, SIGNAL( clicked() ),
+            this, SLOT( markAllMatches() ) );
+    connect(histogramButton, SIGNAL( toggled( bool ) ),
+            histogramWidget_, SLOT( setVisible( bool ) ) );
+    connect(histogramWidget_, SIGNAL( lineClicked( qint64 ) ),
+            logMainView, SLOT( selectAndDisplayLine( qint64 ) ) );
+    connect(templatesButton, SIGNAL( toggled( bool ) ),
+            templateListWidget_, SLOT( setVisible( bool ) ) );
+    connect(templateListWidget_, SIGNAL( templateActivated( int ) ),
+            this, SLOT( searchTemplate( int ) ) );
 
     connect(visibilityBox, SIGNAL( currentIndexChanged( int ) ),
             this, SLOT( changeFilteredViewVisibility( int ) ) );
 
-    connect(logMainView, SIGNAL( newSelection( int ) ),
+    connect(logMainView, SIGNAL( newSelection( qint64 ) ),
             logMainView, SLOT( update() ) );
-    connect(filteredView, SIGNAL( newSelection( int ) ),
-            this, SLOT( jumpToMatchingLine( int ) ) );
-    connect(filteredView, SIGNAL( newSelection( int ) ),
+    connect(filteredView, SIGNAL( newSelection( qint64 ) ),
+            this, SLOT( jumpToMatchingLine( qint64 ) ) );
+    connect(filteredView, SIGNAL( newSelection( qint64 ) ),
             filteredView, SLOT( update() ) );
-    connect(logMainView, SIGNAL( updateLineNumber( int ) ),
-            this, SLOT( updateLineNumberHandler( int ) ) );
+    connect(logMainView, SIGNAL( updateLineNumber( qint64 ) ),
+            this, SLOT( updateLineNumberHandler( qint64 ) ) );
     connect(logMainView, SIGNAL( markLine( qint64 ) ),
             this, SLOT( markLineFromMain( qint64 ) ) );
+    connect(logMainView, SIGNAL( percentRequested( int ) ),
+            this, SLOT( jumpToPercent( int ) ) );
+    connect(logMainView, SIGNAL( tailWanted( bool ) ),
+            this, SLOT( tailWantedHandler( bool ) ) );
     connect(filteredView, SIGNAL( markLine( qint64 ) ),
             this, SLOT( markLineFromFiltered( qint64 ) ) );
 
@@ -690,17 +1206,37 @@ void CrawlerWidget::setup()
     connect(filteredView, SIGNAL( followDisabled() ),
             this, SIGNAL( followDisabled() ) );
 
-    connect( logFilteredData_, SIGNAL( searchProgressed( int, int ) ),
-            this, SLOT( updateFilteredView( int, int ) ) );
+    connect( logFilteredData_, SIGNAL( searchProgressed( qint64, int ) ),
+            this, SLOT( updateFilteredView( qint64, int ) ) );
+    connect( logFilteredData_, SIGNAL( exportProgressed( int ) ),
+            this, SLOT( updateExportProgress( int ) ) );
+    connect( logFilteredData_, SIGNAL( exportFinished( bool ) ),
+            this, SLOT( exportFinished( bool ) ) );
 
     // Sent load file update to MainWindow (for status update)
     connect( logData_, SIGNAL( loadingProgressed( int ) ),
             this, SIGNAL( loadingProgressed( int ) ) );
     connect( logData_, SIGNAL( loadingFinished( LoadingStatus ) ),
             this, SLOT( loadingFinishedHandler( LoadingStatus ) ) );
+    connect( logData_, SIGNAL( linesIndexed( qint64 ) ),
+            this, SLOT( linesIndexedHandler( qint64 ) ) );
     connect( logData_, SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ),
             this, SLOT( fileChangedHandler( LogData::MonitoredFileStatus ) ) );
 
+    // Redraw the overview as the filter map is built
+    connect( filterMap_.get(), SIGNAL( mapProgressed( int ) ),
+            this, SLOT( filterMapUpdated() ) );
+    connect( filterMap_.get(), SIGNAL( mapFinished() ),
+            this, SLOT( filterMapUpdated() ) );
+
+    connect( filterWatch_.get(), SIGNAL( newMatches( qint64 ) ),
+            this, SIGNAL( watchedFiltersMatched( qint64 ) ) );
+
+    connect( matchEstimator_.get(),
+            SIGNAL( estimated( const QRegExp&, qint64, qint64, qint64 ) ),
+            this,
+            SLOT( matchesEstimated( const QRegExp&, qint64, qint64, qint64 ) ) );
+
     // Search auto-refresh
     connect( searchRefreshCheck, SIGNAL( stateChanged( int ) ),
             this, SLOT( searchRefreshChangedHandler( int ) ) );
@@ -711,61 +1247,171 @@ void CrawlerWidget::setup()
             this, SIGNAL( searchRefreshChanged( int ) ) );
     connect( ignoreCaseCheck, SIGNAL( stateChanged( int ) ),
             this, SIGNAL( ignoreCaseChanged( int ) ) );
+
+    // The file shared with another view might be loaded already, in
+    // which case no loadingFinished is coming
+    if ( logData_->isLoaded() )
+        QMetaObject::invokeMethod( this, "loadingFinishedHandler",
+                Qt::QueuedConnection,
+                Q_ARG( LoadingStatus, LoadingStatus::Successful ) );
+}
+
+void CrawlerWidget::runLoadedCommand( qint32 id, const QString& command,
+        const QVariantMap& args )
+{
+    const qint64 nb_lines = logData_->getNbLine();
+    QVariantMap result;
+
+    if ( command == "goToLine" ) {
+        const qint64 line = args[ "line" ].toLongLong();
+        if ( line >= 1 && line <= nb_lines ) {
+            logMainView->selectAndDisplayLine( line - 1 );
+            emit commandFinished( id, true, result );
+            return;
+        }
+        result[ "error" ] = tr( "No line %1" ).arg( line );
+    }
+    else if ( command == "goToTime" ) {
+        const TimestampRule rule( QRegExp( args[ "regexp" ].toString() ),
+                args[ "format" ].toString() );
+        // The time is read as a whole as the timestamps of the lines
+        const qint64 timestamp = TimestampRule( QRegExp( ".+" ),
+                args[ "format" ].toString() ).timestamp(
+                    args[ "time" ].toString() );
+
+        if ( rule.isValid() && timestamp != TimestampRule::noTimestamp ) {
+            const qint64 line = rule.findLine( *logData_, timestamp );
+            if ( line < nb_lines ) {
+                logMainView->selectAndDisplayLine( line );
+                result[ "line" ] = line + 1;
+                emit commandFinished( id, true, result );
+                return;
+            }
+            result[ "error" ] = tr( "No line at or after the time" );
+        }
+        else {
+            result[ "error" ] = tr( "Invalid time or regexp" );
+        }
+    }
+    else if ( command == "mark" ) {
+        for ( const QVariant& line : args[ "lines" ].toList() ) {
+            const qint64 number = line.toLongLong();
+            if ( number >= 1 && number <= nb_lines )
+                logFilteredData_->addMark( number - 1 );
+        }
+
+        // Everything is refreshed once for all the new marks
+        filteredView->updateData();
+        overview_.updateData( nb_lines );
+        update();
+        emit commandFinished( id, true, result );
+        return;
+    }
+    else if ( command == "markMatches" ) {
+        markAllMatches();
+        emit commandFinished( id, true, result );
+        return;
+    }
+    else if ( command == "export" ) {
+        // The export replaced is not going to end
+        finishCommand( &exportCommand_, false );
+
+        exportCommand_ = id;
+        exportSearchResults( args[ "fileName" ].toString() );
+        return;
+    }
+    else {
+        result[ "error" ] = tr( "Unknown command %1" ).arg( command );
+    }
+
+    emit commandFinished( id, false, result );
+}
+
+void CrawlerWidget::finishCommand( qint32* id, bool success,
+        const QVariantMap& result )
+{
+    if ( *id != -1 ) {
+        const qint32 finished = *id;
+        *id = -1;
+        emit commandFinished( finished, success, result );
+    }
 }
 
 // Create a new search using the text passed, replace the currently
 // used one and destroy the old one.
-void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
+void CrawlerWidget::replaceCurrentSearch( const QString& searchText,
+        bool reuseResults )
 {
-    // Interrupt the search if it's ongoing
-    logFilteredData_->interruptSearch();
+    // The search ongoing is abandoned by the new one (or when cleared)
+    // without waiting for it, its last updates being dropped
+    searchRunning_        = false;
+    searchFollowsLoading_ = false;
+    searchUpdatePending_  = false;
+    searchInfoLine->hideGauge();
+    stopButton->setEnabled( false );
 
-    // We have to wait for the last search update (100%)
-    // before clearing/restarting to avoid having remaining results.
-
-    // FIXME: this is a bit of a hack, we call processEvents
-    // for Qt to empty its event queue, including (hopefully)
-    // the search update event sent by logFilteredData_. It saves
-    // us the overhead of having proper sync.
-    QApplication::processEvents( QEventLoop::ExcludeUserInputEvents );
-
-    if ( !searchText.isEmpty() ) {
-        // Determine the type of regexp depending on the config
-        QRegExp::PatternSyntax syntax;
-        static std::shared_ptr<Configuration> config =
-            Persistent<Configuration>( "settings" );
-        switch ( config->mainRegexpType() ) {
-            case Wildcard:
-                syntax = QRegExp::Wildcard;
-                break;
-            case FixedString:
-                syntax = QRegExp::FixedString;
-                break;
-            default:
-                syntax = QRegExp::RegExp2;
-                break;
-        }
+    // The matches are not estimated any more
+    estimatedRegExp_ = QRegExp();
+    matchEstimator_->cancel();
+
+    static std::shared_ptr<Configuration> config =
+        Persistent<Configuration>( "settings" );
 
-        // Set the pattern case insensitive if needed
+    // A template is searched for from the template index, whatever the
+    // type of the search
+    int template_id;
+    if ( !searchText.isEmpty() && ( config->mainRegexpType() == BooleanQuery
+                || TemplateIndex::templateOfTerm( QRegExp( searchText ), &template_id ) ) ) {
         Qt::CaseSensitivity case_sensitivity = Qt::CaseSensitive;
         if ( ignoreCaseCheck->checkState() == Qt::Checked )
             case_sensitivity = Qt::CaseInsensitive;
 
+        SearchQuery query( searchText, case_sensitivity );
+
+        if ( query.isValid() ) {
+            stopButton->setEnabled( true );
+            logFilteredData_->runQuery( query );
+            searchState_.startSearch();
+            searchRunning_ = true;
+            searchFollowsLoading_ = loadingInProgress_;
+        }
+        else {
+            logFilteredData_->clearSearch();
+            filteredView->updateData();
+            histogramWidget_->updateHistogram();
+            searchState_.resetState();
+
+            QString errorMessage = tr("Error in query: ");
+            errorMessage += query.errorString();
+            searchInfoLine->setPalette( errorPalette );
+            searchInfoLine->setText( errorMessage );
+        }
+    }
+    else if ( !searchText.isEmpty() ) {
         // Constructs the regexp
-        QRegExp regexp( searchText, case_sensitivity, syntax );
+        QRegExp regexp = searchRegExp( searchText );
 
         if ( regexp.isValid() ) {
             // Activate the stop button
             stopButton->setEnabled( true );
             // Start a new asynchronous search
-            logFilteredData_->runSearch( regexp );
+            if ( searchWithinCheck->checkState() == Qt::Checked )
+                logFilteredData_->runSearchWithinResults( regexp );
+            else if ( reuseResults )
+                logFilteredData_->runNarrowerSearch( regexp );
+            else
+                logFilteredData_->runSearch( regexp );
             // Accept auto-refresh of the search
             searchState_.startSearch();
+            searchRunning_ = true;
+            // (and the lines still to be loaded to be searched)
+            searchFollowsLoading_ = loadingInProgress_;
         }
         else {
             // The regexp is wrong
             logFilteredData_->clearSearch();
             filteredView->updateData();
+            histogramWidget_->updateHistogram();
             searchState_.resetState();
 
             // Inform the user
@@ -778,6 +1424,7 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
     else {
         logFilteredData_->clearSearch();
         filteredView->updateData();
+        histogramWidget_->updateHistogram();
         searchState_.resetState();
         printSearchInfoMessage();
     }
@@ -796,8 +1443,63 @@ void CrawlerWidget::updateSearchCombo()
     searchLineEdit->lineEdit()->setText( text );
 }
 
+QRegExp CrawlerWidget::searchRegExp( const QString& searchText ) const
+{
+    static std::shared_ptr<Configuration> config =
+        Persistent<Configuration>( "settings" );
+
+    // Determine the type of regexp depending on the config
+    QRegExp::PatternSyntax syntax;
+    switch ( config->mainRegexpType() ) {
+        case Wildcard:
+            syntax = QRegExp::Wildcard;
+            break;
+        case FixedString:
+            syntax = QRegExp::FixedString;
+            break;
+        default:
+            syntax = QRegExp::RegExp2;
+            break;
+    }
+
+    // Set the pattern case insensitive if needed
+    Qt::CaseSensitivity case_sensitivity = Qt::CaseSensitive;
+    if ( ignoreCaseCheck->checkState() == Qt::Checked )
+        case_sensitivity = Qt::CaseInsensitive;
+
+    return QRegExp( searchText, case_sensitivity, syntax );
+}
+
+// The queries and the templates are not estimated, nor the searches
+// within the results (which are not searching the file)
+void CrawlerWidget::estimateMatches()
+{
+    static std::shared_ptr<Configuration> config =
+        Persistent<Configuration>( "settings" );
+
+    const QString text = searchLineEdit->currentText();
+    int template_id;
+    if ( text.isEmpty() || searchWithinCheck->checkState() == Qt::Checked
+            || config->mainRegexpType() == BooleanQuery
+            || TemplateIndex::templateOfTerm( QRegExp( text ), &template_id ) ) {
+        estimatedRegExp_ = QRegExp();
+        matchEstimator_->cancel();
+        return;
+    }
+
+    const QRegExp regexp = searchRegExp( text );
+    if ( regexp.isValid() ) {
+        estimatedRegExp_ = regexp;
+        matchEstimator_->estimate( regexp );
+    }
+    else {
+        estimatedRegExp_ = QRegExp();
+        matchEstimator_->cancel();
+    }
+}
+
 // Print the search info message.
-void CrawlerWidget::printSearchInfoMessage( int nbMatches )
+void CrawlerWidget::printSearchInfoMessage( qint64 nbMatches )
 {
     QString text;
 
@@ -819,10 +1521,59 @@ void CrawlerWidget::printSearchInfoMessage( int nbMatches )
             break;
     }
 
+    // The pattern backtracking too much is not matched any more
+    if ( ( searchState_.getState() == SearchState::Static
+                || searchState_.getState() == SearchState::Autorefreshing )
+            && logFilteredData_->isSearchTooCostly() ) {
+        searchInfoLine->setPalette( errorPalette );
+        searchInfoLine->setText( text + " " + tr("The expression is too costly "
+                    "to match (it backtracks too much), the search was "
+                    "abandoned and the matches are incomplete.") );
+        return;
+    }
+
     searchInfoLine->setPalette( searchInfoLineDefaultPalette );
     searchInfoLine->setText( text );
 }
 
+void CrawlerWidget::jumpToFraction( double fraction )
+{
+    qint64 line;
+    if ( logData_->getLineAtFraction( fraction, &line ) ) {
+        if ( pendingJumpFraction_ >= 0.0 ) {
+            pendingJumpFraction_ = -1.0;
+            logData_->setIndexingFocus( -1.0 );
+            QToolTip::hideText();
+        }
+        logMainView->selectAndDisplayLine( line );
+    }
+    else {
+        // The line is shown from the file while it is indexed
+        if ( pendingJumpFraction_ != fraction ) {
+            pendingJumpFraction_ = fraction;
+            logData_->setIndexingFocus( fraction );
+        }
+
+        QString text = tr( "Indexing up to about line %1..." ).arg( line + 1 );
+        const QString content = logData_->getLineStartingAfter( fraction );
+        if ( ! content.isEmpty() )
+            text += "\n" + content.left( 200 );
+        QToolTip::showText( logMainView->mapToGlobal( QPoint( 0, 0 ) ),
+                text, logMainView );
+    }
+}
+
+void CrawlerWidget::updateTaskPriority()
+{
+    const TaskScheduler::Priority priority = isVisible() ?
+        TaskScheduler::Visible : TaskScheduler::Background;
+
+    if ( logData_ )
+        logData_->setPriority( priority );
+    if ( logFilteredData_ )
+        logFilteredData_->setPriority( priority );
+}
+
 //
 // SearchState implementation
 //
@@ -913,6 +1664,13 @@ CrawlerWidgetContext::CrawlerWidgetContext( const char* string )
         ignore_case_ = false;
         auto_refresh_ = false;
     }
+
+    // The text is encoded not to clash with the separators
+    QRegExp search_regex = QRegExp( "ST([A-Za-z0-9+/=]*)" );
+
+    if ( search_regex.indexIn( string ) > -1 )
+        search_text_ = QString::fromUtf8(
+                QByteArray::fromBase64( search_regex.cap(1).toLatin1() ) );
 }
 
 std::string CrawlerWidgetContext::toString() const
@@ -923,5 +1681,9 @@ std::string CrawlerWidgetContext::toString() const
             sizes_[0], sizes_[1],
             ignore_case_, auto_refresh_ );
 
-    return { string };
+    std::string result = string;
+    if ( ! search_text_.isEmpty() )
+        result += ":ST" + search_text_.toUtf8().toBase64().toStdString();
+
+    return result;
 }
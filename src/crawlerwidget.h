@@ -29,6 +29,8 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QTimer>
+#include <QVariantMap>
 
 #include "logmainview.h"
 #include "filteredview.h"
@@ -38,12 +40,18 @@
 #include "signalmux.h"
 #include "overview.h"
 #include "loadingstatus.h"
+#include "filtercolorcache.h"
+#include "filtermap.h"
+#include "filterwatch.h"
+#include "data/matchestimator.h"
 
 class InfoLine;
 class QuickFindPattern;
 class SavedSearches;
 class QStandardItemModel;
 class OverviewWidget;
+class MatchHistogramWidget;
+class TemplateListWidget;
 
 // Implements the central widget of the application.
 // It includes both windows, the search line, the info
@@ -58,9 +66,14 @@ class CrawlerWidget : public QSplitter,
     CrawlerWidget( QWidget *parent=0 );
 
     // Get the line number of the first line displayed.
-    int getTopLine() const;
+    qint64 getTopLine() const;
     // Get the selected text as a string (from the main window)
     QString getSelectedText() const;
+    // Idem for the clipboard, only read when pasted
+    QMimeData* getSelectionMimeData() const;
+    // Write the results of the search to the file, in the background,
+    // the progress being displayed in the search info line
+    void exportSearchResults( const QString& fileName );
 
     // Display the QFB at the bottom, remembering where the focus was
     void displayQuickFindBar( QuickFindMux::QFDirection direction );
@@ -69,12 +82,55 @@ class CrawlerWidget : public QSplitter,
     // is interacting with
     void selectAll();
 
+    // Start the search as if typed in the search line, following the
+    // loading if the file is still being loaded
+    void search( const QString& text, bool ignore_case );
+    // Show the passed lines of the file in the filtered view instead
+    // of the results of a search, described in the search info line
+    void showLines( const MatchSet& lines, const QString& description );
+    // The file displayed and the results of its search, for the views
+    // working across the tabs (see GlobalSearchDialog)
+    const LogData* logData() const;
+    const LogFilteredData* filteredData() const;
+    // Select and display the passed line (starting at 0) in the main view
+    void displayLine( qint64 line );
+    // Returns the number of lines appended to the file matching a
+    // watched filter since the user was last notified (see FilterWatch)
+    qint64 nbNewWatchedMatches() const;
+    // Forget these lines, the user having seen them
+    void acknowledgeWatchedMatches();
+    // Keep the results of the search and the marks of the passed file
+    // (the one displayed) in the index cache, with the session
+    void saveSearchResults( const QString& file_name ) const;
+    // Restore them once the file is loaded, the search of the view
+    // context being run again only on the lines not searched when
+    // saved (the whole file if they cannot be used)
+    void restoreSearchResults( const QString& file_name );
+
+    // Run a command sent by a script (see ExternalCommunicator), the
+    // commandFinished() signal being sent with its id once it is done.
+    // The commands (and their arguments) are:
+    //   "search" (pattern, ignoreCase): results in "matches"
+    //   "goToLine" (line, starting at 1)
+    //   "goToTime" (time, regexp, format): see TimestampRule, the
+    //       line shown being the first at or after the time, in "line"
+    //   "mark" (lines, starting at 1)
+    //   "markMatches"
+    //   "export" (fileName): export the results of the search
+    // The commands but "search" wait for the file to be loaded.
+    void runCommand( qint32 id, const QString& command,
+            const QVariantMap& args );
+
   public slots:
     // Stop the asynchoronous loading of the file if one is in progress
     // The file is identified by the view attached to it.
     void stopLoading();
     // Reload the displayed file
     void reload();
+    // Idem, keeping the lines which have not changed (and their
+    // matches), only the following ones being indexed and searched
+    // again (see LogData::reloadChanges)
+    void reloadChanges();
 
   protected:
     // Implementation of the ViewInterface functions
@@ -97,6 +153,10 @@ class CrawlerWidget : public QSplitter,
     // Implementation of the MuxableDocumentInterface
     virtual void doSendAllStateSignals();
 
+    // The indexing and searches of the file displayed go first
+    virtual void showEvent( QShowEvent* event );
+    virtual void hideEvent( QHideEvent* event );
+
   signals:
     // Sent to signal the client load has progressed,
     // passing the completion percentage.
@@ -109,13 +169,20 @@ class CrawlerWidget : public QSplitter,
     // Sent up to the MainWindow to disable the follow mode
     void followDisabled();
     // Sent up when the current line number is updated
-    void updateLineNumber( int line );
+    void updateLineNumber( qint64 line );
+    // Sent when lines appended to the file match a watched filter,
+    // nbMatches being the number of them not acknowledged
+    void watchedFiltersMatched( qint64 nbMatches );
 
     // "auto-refresh" check has been changed
     void searchRefreshChanged( int state );
     // "ignore case" check has been changed
     void ignoreCaseChanged( int state );
 
+    // A command passed to runCommand() is done, the result holding
+    // an "error" if it failed
+    void commandFinished( qint32 id, bool success, const QVariantMap& result );
+
   private slots:
     // Instructs the widget to start a search using the current search line.
     void startNewSearch();
@@ -128,18 +195,32 @@ class CrawlerWidget : public QSplitter,
     // QuickFind is being closed.
     void exitingQuickFind();
     // Called when new data must be displayed in the filtered window.
-    void updateFilteredView( int nbMatches, int progress );
+    void updateFilteredView( qint64 nbMatches, int progress );
+    // Called while the search results are exported, then at the end
+    void updateExportProgress( int percent );
+    void exportFinished( bool success );
     // Called when a new line has been selected in the filtered view,
     // to instruct the main view to jump to the matching line.
-    void jumpToMatchingLine( int filteredLineNb );
+    void jumpToMatchingLine( qint64 filteredLineNb );
     // Called when the main view is on a new line number
-    void updateLineNumberHandler( int line );
+    void updateLineNumberHandler( qint64 line );
     // Mark a line that has been clicked on the main (top) view.
     void markLineFromMain( qint64 line );
     // Mark a line that has been clicked on the filtered (bottom) view.
     void markLineFromFiltered( qint64 line );
+    // Mark all the lines matching the current search.
+    void markAllMatches();
+    // Called when "N%" has been typed in the main view, to show the
+    // line at this percentage of the file.
+    void jumpToPercent( int percent );
+    // Called when the end of the file starts or stops being looked at
+    // in the main view, for it to be indexed early while loading.
+    void tailWantedHandler( bool wanted );
 
     void loadingFinishedHandler( LoadingStatus status );
+    // Shows the first lines of the file while it is loading, searching
+    // them if a search has been started meanwhile.
+    void linesIndexedHandler( qint64 nbLines );
     // Manages the info lines to inform the user the file has changed.
     void fileChangedHandler( LogData::MonitoredFileStatus );
 
@@ -151,6 +232,12 @@ class CrawlerWidget : public QSplitter,
 
     // Called when the text on the search line is modified
     void searchTextChangeHandler();
+    // Search for the text typed, once the typing has paused
+    // (if the main search is incremental)
+    void runLiveSearch();
+    // Called when the matches of the text typed have been estimated
+    void matchesEstimated( const QRegExp& regexp, qint64 nbMatches,
+            qint64 nbLinesSampled, qint64 searchTime );
 
     // Called when the user change the visibility combobox
     void changeFilteredViewVisibility( int index );
@@ -161,6 +248,13 @@ class CrawlerWidget : public QSplitter,
     // Called when a match is hovered on in the filtered view
     void mouseHoveredOverMatch( qint64 line );
 
+    // Called when the filter map has progressed, to redraw the overview
+    void filterMapUpdated();
+
+    // Called when a template is activated in the list, to search
+    // for its lines
+    void searchTemplate( int id );
+
   private:
     // State machine holding the state of the search, used to allow/disallow
     // auto-refresh and inform the user via the info line.
@@ -204,13 +298,37 @@ class CrawlerWidget : public QSplitter,
 
     // Private functions
     void setup();
-    void replaceCurrentSearch( const QString& searchText );
+    // Start the search for the passed text, the current matches being
+    // searched again only if reuseResults and the text only matches
+    // lines the current search does (see runNarrowerSearch).
+    void replaceCurrentSearch( const QString& searchText,
+            bool reuseResults = false );
     void updateSearchCombo();
     AbstractLogView* activeView() const;
-    void printSearchInfoMessage( int nbMatches = 0 );
+    void printSearchInfoMessage( qint64 nbMatches = 0 );
+    // Returns the regexp searched for the passed text (as configured)
+    QRegExp searchRegExp( const QString& searchText ) const;
+    // Estimate the matches of the text typed, if it is a regexp
+    void estimateMatches();
+    // Select the line at the passed fraction of the file if it is
+    // indexed, else have the indexing reach it and select it then.
+    void jumpToFraction( double fraction );
+    // Sets the priority of the indexing and searches of the file
+    // (see TaskScheduler) from whether it is displayed
+    void updateTaskPriority();
+    // Run the command, the file being loaded
+    void runLoadedCommand( qint32 id, const QString& command,
+            const QVariantMap& args );
+    // Send commandFinished() for the command waiting in *id if there is
+    // one, and stop waiting
+    void finishCommand( qint32* id, bool success,
+            const QVariantMap& result = QVariantMap() );
 
     // Palette for error notification (yellow background)
     static const QPalette errorPalette;
+    // Pause in the typing (in ms) after which the search is run,
+    // if the main search is incremental
+    static const int liveSearchDelay;
 
     LogMainView*    logMainView;
     QWidget*        bottomWindow;
@@ -218,12 +336,18 @@ class CrawlerWidget : public QSplitter,
     QComboBox*      searchLineEdit;
     QToolButton*    searchButton;
     QToolButton*    stopButton;
+    QToolButton*    markAllButton;
+    QToolButton*    histogramButton;
+    QToolButton*    templatesButton;
     FilteredView*   filteredView;
     QComboBox*      visibilityBox;
     InfoLine*       searchInfoLine;
     QCheckBox*      ignoreCaseCheck;
     QCheckBox*      searchRefreshCheck;
+    QCheckBox*      searchWithinCheck;
     OverviewWidget* overviewWidget_;
+    MatchHistogramWidget* histogramWidget_;
+    TemplateListWidget* templateListWidget_;
 
     QVBoxLayout*    bottomMainLayout;
     QHBoxLayout*    searchLineLayout;
@@ -250,15 +374,51 @@ class CrawlerWidget : public QSplitter,
     // Matches overview
     Overview        overview_;
 
+    // Colours of the lines, shared by both views
+    std::unique_ptr<FilterColorCache> filterColorCache_;
+
+    // Filters colouring the whole file, for the overview
+    std::unique_ptr<FilterMap> filterMap_;
+    // Watched filters matched against the lines appended
+    std::unique_ptr<FilterWatch> filterWatch_;
+    // Estimates the matches of the text typed until it is searched
+    // (estimatedRegExp_ being empty if none is)
+    std::unique_ptr<MatchEstimator> matchEstimator_;
+    QRegExp         estimatedRegExp_;
+
     // Model for the visibility selector
     QStandardItemModel* visibilityModel_;
 
     // Last main line number received
     qint64 currentLineNumber_;
+    // Fraction of the file to jump to once indexed (negative if none)
+    double pendingJumpFraction_;
 
     // Are we loading something?
     // Set to false when we receive a completion message from the LogData
     bool            loadingInProgress_;
+    // Set if the search has been started while loading, the lines
+    // being searched as they are shown until loading is finished.
+    bool            searchFollowsLoading_;
+    // The file whose search results are restored once loaded
+    // (empty if none)
+    QString         restoredResultsFile_;
+    // Set while the search runs, and if it is to be updated when done
+    bool            searchRunning_;
+    bool            searchUpdatePending_;
+    // Started by each change of the search line, if incremental
+    QTimer          liveSearchTimer_;
+
+    // Commands of runCommand() waiting for the loading to finish
+    struct Command {
+        qint32 id;
+        QString command;
+        QVariantMap args;
+    };
+    std::vector<Command> commandsAfterLoading_;
+    // Commands waiting for the search and the export to end (-1 if none)
+    qint32          searchCommand_;
+    qint32          exportCommand_;
 };
 
 #endif
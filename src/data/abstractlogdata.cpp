@@ -53,6 +53,66 @@ QStringList AbstractLogData::getExpandedLines( qint64 first_line, int number ) c
     return doGetExpandedLines( first_line, number );
 }
 
+// Simple wrapper in order to use a clean Template Method
+QStringList AbstractLogData::getLinesAt( const std::vector<qint64>& lines ) const
+{
+    return doGetLinesAt( lines, false );
+}
+
+// Simple wrapper in order to use a clean Template Method
+QStringList AbstractLogData::getExpandedLinesAt(
+        const std::vector<qint64>& lines ) const
+{
+    return doGetLinesAt( lines, true );
+}
+
+// Simple wrapper in order to use a clean Template Method
+QStringList AbstractLogData::getExpandedLinesForScan( qint64 first_line, int number ) const
+{
+    return doGetExpandedLinesForScan( first_line, number );
+}
+
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::getExpandedLines( qint64 first_line, int number,
+        LineBuffer* lines ) const
+{
+    lines->clear();
+    doFillExpandedLines( first_line, number, lines );
+}
+
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::getExpandedLinesForScan( qint64 first_line, int number,
+        LineBuffer* lines ) const
+{
+    lines->clear();
+    doFillExpandedLinesForScan( first_line, number, lines );
+}
+
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::getExpandedLineWindows( qint64 first_line, int number,
+        int first_col, int nb_cols, LineBuffer* lines,
+        std::vector<int>* windowStarts ) const
+{
+    lines->clear();
+    windowStarts->clear();
+    doFillExpandedLineWindows( first_line, number, first_col, nb_cols,
+            lines, windowStarts );
+}
+
+// Simple wrapper in order to use a clean Template Method
+QByteArray AbstractLogData::getRawLines( qint64 first_line, int number,
+        std::vector<int>* lineEnds ) const
+{
+    return doGetRawLines( first_line, number, lineEnds );
+}
+
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::getRawLines( qint64 first_line, int number,
+        QByteArray* data, std::vector<int>* lineEnds ) const
+{
+    doFillRawLines( first_line, number, data, lineEnds );
+}
+
 // Simple wrapper in order to use a clean Template Method
 qint64 AbstractLogData::getNbLine() const
 {
@@ -70,3 +130,114 @@ int AbstractLogData::getLineLength( qint64 line ) const
 {
     return doGetLineLength( line );
 }
+
+// Simple wrapper in order to use a clean Template Method
+bool AbstractLogData::hasLineLengths() const
+{
+    return doHasLineLengths();
+}
+
+// Simple wrapper in order to use a clean Template Method
+qint64 AbstractLogData::getLinesSize( qint64 first_line, qint64 last_line ) const
+{
+    return doGetLinesSize( first_line, last_line );
+}
+
+// Simple wrapper in order to use a clean Template Method
+std::shared_ptr<const SkipIndex> AbstractLogData::getSkipIndex() const
+{
+    return doGetSkipIndex();
+}
+
+// Simple wrapper in order to use a clean Template Method
+bool AbstractLogData::isThreadSafe() const
+{
+    return doIsThreadSafe();
+}
+
+// Simple wrapper in order to use a clean Template Method
+std::shared_ptr<const FusedSearch> AbstractLogData::getFusedSearch() const
+{
+    return doGetFusedSearch();
+}
+
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::releaseScannedLines( qint64 first_line,
+        qint64 last_line ) const
+{
+    doReleaseScannedLines( first_line, last_line );
+}
+
+// Simple wrapper in order to use a clean Template Method
+void AbstractLogData::prefetchLines( qint64 first_line, qint64 last_line ) const
+{
+    doPrefetchLines( first_line, last_line );
+}
+
+// Simple wrapper in order to use a clean Template Method
+std::vector<AbstractLogData::LineRun> AbstractLogData::getLineRuns() const
+{
+    return doGetLineRuns();
+}
+
+// Simple wrapper in order to use a clean Template Method
+qint64 AbstractLogData::getLineAtTime( qint64 timestamp ) const
+{
+    return doGetLineAtTime( timestamp );
+}
+
+// Simple wrapper in order to use a clean Template Method
+bool AbstractLogData::getTimeRange( qint64* first, qint64* last ) const
+{
+    return doGetTimeRange( first, last );
+}
+
+QStringList AbstractLogData::doGetLinesAt( const std::vector<qint64>& lines,
+        bool expand ) const
+{
+    QStringList list;
+    list.reserve( lines.size() );
+    for ( qint64 line : lines )
+        list.append( expand ?
+                doGetExpandedLineString( line ) : doGetLineString( line ) );
+
+    return list;
+}
+
+void AbstractLogData::doFillExpandedLines( qint64 first_line, int number,
+        LineBuffer* lines ) const
+{
+    for ( const QString& line : doGetExpandedLines( first_line, number ) )
+        lines->append( line );
+}
+
+void AbstractLogData::doFillExpandedLinesForScan( qint64 first_line,
+        int number, LineBuffer* lines ) const
+{
+    for ( const QString& line : doGetExpandedLinesForScan( first_line, number ) )
+        lines->append( line );
+}
+
+void AbstractLogData::doFillExpandedLineWindows( qint64 first_line,
+        int number, int, int, LineBuffer* lines,
+        std::vector<int>* windowStarts ) const
+{
+    doFillExpandedLines( first_line, number, lines );
+    windowStarts->assign( lines->size(), -1 );
+}
+
+QByteArray AbstractLogData::doGetRawLines( qint64 first_line, int number,
+        std::vector<int>* lineEnds ) const
+{
+    QByteArray data;
+
+    lineEnds->clear();
+    lineEnds->reserve( number );
+    for ( const QString& line : doGetLines( first_line, number ) ) {
+        data.append( line.toUtf8() );
+        lineEnds->push_back( data.size() );
+        data.append( '\n' );
+    }
+
+    return data;
+}
@@ -22,16 +22,32 @@
 
 // #include "log.h"
 
+#include <cstring>
+#include <memory>
+#include <vector>
+
 #include <QObject>
+#include <QByteArray>
 #include <QString>
 #include <QStringList>
 
+#include "linebuffer.h"
+
+class SkipIndex;
+class FusedSearch;
+
 // Base class representing a set of data.
 // It can be either a full set or a filtered set.
 class AbstractLogData : public QObject {
   Q_OBJECT
 
   public:
+    // Consecutive similar lines (see getLineRuns())
+    struct LineRun {
+        qint64 firstLine;
+        qint64 nbLines;
+    };
+
     AbstractLogData();
     // Permit each child to have its destructor
     virtual ~AbstractLogData() {};
@@ -44,6 +60,39 @@ class AbstractLogData : public QObject {
     QStringList getLines( qint64 first_line, int number ) const;
     // Returns a set of lines with tabs expanded
     QStringList getExpandedLines( qint64 first_line, int number ) const;
+    // Returns the passed lines, in any order and not necessarily
+    // consecutive (as shown by a filtered view), fetched together.
+    QStringList getLinesAt( const std::vector<qint64>& lines ) const;
+    // Idem with tabs expanded
+    QStringList getExpandedLinesAt( const std::vector<qint64>& lines ) const;
+    // Idem for a scan through the data: the lines are not kept in
+    // any cache meant for the display.
+    QStringList getExpandedLinesForScan( qint64 first_line, int number ) const;
+    // Idem, the lines being written to the passed buffer (cleared
+    // first) rather than to QStrings, without an allocation per line.
+    void getExpandedLines( qint64 first_line, int number,
+            LineBuffer* lines ) const;
+    void getExpandedLinesForScan( qint64 first_line, int number,
+            LineBuffer* lines ) const;
+    // Idem for the display of the columns [first_col, first_col+nb_cols),
+    // only this window being read (and decoded) of the lines longer
+    // than longLineLength bytes. windowStarts receives (cleared first)
+    // the column the text of each line starts at, -1 if it is the
+    // whole line.
+    void getExpandedLineWindows( qint64 first_line, int number,
+            int first_col, int nb_cols, LineBuffer* lines,
+            std::vector<int>* windowStarts ) const;
+    // Returns the undecoded (UTF-8) content of a set of lines, for the
+    // search to match it without creating a QString per line.
+    // lineEnds receives the offset in the returned data of the end
+    // (LF excluded) of each line, a line starting where the previous
+    // one ended plus one.
+    QByteArray getRawLines( qint64 first_line, int number,
+            std::vector<int>* lineEnds ) const;
+    // Idem, the content being written to the passed buffer, whose
+    // memory is reused if it is large enough (and not shared).
+    void getRawLines( qint64 first_line, int number,
+            QByteArray* data, std::vector<int>* lineEnds ) const;
     // Returns the total number of lines
     qint64 getNbLine() const;
     // Returns the visible length of the longest line
@@ -52,9 +101,64 @@ class AbstractLogData : public QObject {
     // Returns the visible length of the passed line
     // Tabs are expanded
     int getLineLength( qint64 line ) const;
+    // Returns whether getLineLength() is answered without reading
+    // the line (the lengths having been recorded when indexing)
+    bool hasLineLengths() const;
+    // Returns the size in bytes of the lines from first_line to
+    // last_line (excluded), their ends of line included, or -1 if it
+    // is not known without reading them.
+    qint64 getLinesSize( qint64 first_line, qint64 last_line ) const;
+    // Returns the skip index of the lines (built while indexing), which
+    // tells the blocks of lines a search can skip, or null if there is
+    // none.
+    std::shared_ptr<const SkipIndex> getSkipIndex() const;
+    // Returns the search run while the lines were indexed, whose
+    // matches spare the first search for its pattern reading them,
+    // or null if there is none (see FusedSearch).
+    std::shared_ptr<const FusedSearch> getFusedSearch() const;
+    // Returns the first line with a timestamp at or after the passed
+    // one, getNbLine() if there is none and -1 if the timestamps of
+    // the lines are not known.
+    qint64 getLineAtTime( qint64 timestamp ) const;
+    // Sets the timestamps of the first and last lines (having one),
+    // returns false if the timestamps of the lines are not known.
+    bool getTimeRange( qint64* first, qint64* last ) const;
+    // Returns whether the lines can be read from any thread
+    // (the other functions being called from the owner's thread only)
+    bool isThreadSafe() const;
+    // Tells the lines from first_line to last_line (excluded) have been
+    // read by a scan of the data (a search) which does not need them
+    // anymore, for the I/O policy to drop them from the system's cache
+    // (see ScanReader). Called from the scanning threads.
+    void releaseScannedLines( qint64 first_line, qint64 last_line ) const;
+    // Tells the lines from first_line to last_line (excluded) are about
+    // to be read by a scan, for them to be read from the disk while the
+    // previous ones are processed. Called from the scanning threads.
+    void prefetchLines( qint64 first_line, qint64 last_line ) const;
+    // Returns the runs of at least two consecutive similar lines
+    // (differing only by their digits) found while the lines were
+    // indexed, in the order of the lines, none if they are not known.
+    std::vector<LineRun> getLineRuns() const;
 
     // Length of a tab stop
     static const int tabStop = 8;
+    // Raw length (in bytes) from which a line is displayed by windows
+    static const int longLineLength = 64 * 1024;
+
+    // Returns the length the passed raw line will have once untabified,
+    // without building it.
+    static inline int expandedLength( const char* line, int length ) {
+        int total_spaces = 0;
+        const char* tab = line;
+
+        while ( ( tab = static_cast<const char*>(
+                        memchr( tab, '\t', line + length - tab ) ) ) ) {
+            total_spaces += tabStop - ( ( (tab - line) + total_spaces ) % tabStop ) - 1;
+            tab++;
+        }
+
+        return length + total_spaces;
+    }
 
   protected:
     // Internal function called to get a given line
@@ -65,12 +169,69 @@ class AbstractLogData : public QObject {
     virtual QStringList doGetLines( qint64 first_line, int number ) const = 0;
     // Internal function called to get a set of expanded lines
     virtual QStringList doGetExpandedLines( qint64 first_line, int number ) const = 0;
+    // Internal function called to get a list of lines (one by one
+    // by default)
+    virtual QStringList doGetLinesAt( const std::vector<qint64>& lines,
+            bool expand ) const;
     // Internal function called to get the number of lines
     virtual qint64 doGetNbLine() const = 0;
     // Internal function called to get the maximum length
     virtual int doGetMaxLength() const = 0;
     // Internal function called to get the line length
     virtual int doGetLineLength( qint64 line ) const = 0;
+    // Internal function called to get a set of expanded lines to scan
+    virtual QStringList doGetExpandedLinesForScan( qint64 first_line, int number ) const
+    { return doGetExpandedLines( first_line, number ); }
+    // Internal functions called to write a set of expanded lines to a
+    // buffer (copying the QStrings by default)
+    virtual void doFillExpandedLines( qint64 first_line, int number,
+            LineBuffer* lines ) const;
+    virtual void doFillExpandedLinesForScan( qint64 first_line, int number,
+            LineBuffer* lines ) const;
+    // Internal function called to write the windows of a set of expanded
+    // lines to a buffer (the whole lines by default)
+    virtual void doFillExpandedLineWindows( qint64 first_line, int number,
+            int first_col, int nb_cols, LineBuffer* lines,
+            std::vector<int>* windowStarts ) const;
+    // Internal function called to get the raw content of a set of lines
+    // (encodes the decoded lines by default)
+    virtual QByteArray doGetRawLines( qint64 first_line, int number,
+            std::vector<int>* lineEnds ) const;
+    // Idem, written to a buffer (replaced by doGetRawLines() by default)
+    virtual void doFillRawLines( qint64 first_line, int number,
+            QByteArray* data, std::vector<int>* lineEnds ) const
+    { *data = doGetRawLines( first_line, number, lineEnds ); }
+    // Internal function called to know if the lines can be read
+    // from any thread
+    virtual bool doIsThreadSafe() const { return false; }
+    // Internal function called to find the line at a time
+    // (the timestamps are not known by default)
+    virtual qint64 doGetLineAtTime( qint64 ) const { return -1; }
+    // Internal function called to get the times of the lines
+    // (not known by default)
+    virtual bool doGetTimeRange( qint64*, qint64* ) const { return false; }
+    // Internal function called to know if the lengths of the lines
+    // are known without reading them
+    virtual bool doHasLineLengths() const { return false; }
+    // Internal function called to get the size of lines
+    // (not known by default)
+    virtual qint64 doGetLinesSize( qint64, qint64 ) const { return -1; }
+    // Internal function called to get the skip index (none by default)
+    virtual std::shared_ptr<const SkipIndex> doGetSkipIndex() const
+    { return nullptr; }
+    // Internal function called to get the fused search (none by default)
+    virtual std::shared_ptr<const FusedSearch> doGetFusedSearch() const
+    { return nullptr; }
+    // Internal function called when lines have been scanned
+    // (nothing to release by default)
+    virtual void doReleaseScannedLines( qint64, qint64 ) const {}
+    // Internal function called when lines are about to be scanned
+    // (nothing to read ahead by default)
+    virtual void doPrefetchLines( qint64, qint64 ) const {}
+    // Internal function called to get the runs of similar lines
+    // (none known by default)
+    virtual std::vector<LineRun> doGetLineRuns() const
+    { return std::vector<LineRun>(); }
 
     static inline QString untabify( const QString& line ) {
         QString untabified_line;
@@ -91,26 +252,6 @@ class AbstractLogData : public QObject {
 
         return untabified_line;
     }
-
-    static inline QString untabify( const char* line ) {
-        QString untabified_line;
-        int total_spaces = 0;
-
-        for ( const char* i = line; *i != '\0'; i++ ) {
-            if ( *i == '\t' ) {
-                int spaces = tabStop - ( ( (i - line) + total_spaces ) % tabStop );
-                // LOG(logDEBUG4) << "Replacing tab at char " << j << " (" << spaces << " spaces)";
-                QString blanks( spaces, QChar(' ') );
-                untabified_line.append( blanks );
-                total_spaces += spaces - 1;
-            }
-            else {
-                untabified_line.append( *i );
-            }
-        }
-
-        return untabified_line;
-    }
 };
 
 #endif
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+#include "log.h"
+#include "perfcounters.h"
+
+#include "blockcache.h"
+
+namespace {
+    // 64 MiB per source by default
+    std::atomic<qint64> defaultBudget( 64 * 1024 * 1024 );
+
+    // zlib's fastest level, the data being compressed at each miss
+    const int compressionLevel = 1;
+}
+
+BlockCache::BlockCache( qint64 blockSize, qint64 maxBytes )
+    : blockSize_( blockSize ),
+    blocks_( qMin<qint64>( maxBytes, std::numeric_limits<int>::max() ) )
+{
+}
+
+void BlockCache::setDefaultMaxBytes( qint64 maxBytes )
+{
+    defaultBudget = maxBytes;
+}
+
+qint64 BlockCache::defaultMaxBytes()
+{
+    return defaultBudget.load();
+}
+
+bool BlockCache::contains( qint64 block ) const
+{
+    return blocks_.contains( block );
+}
+
+QByteArray BlockCache::block( qint64 block )
+{
+    const QByteArray* compressed = blocks_.object( block );
+    if ( ! compressed ) {
+        PerfCounters::add( PerfCounters::BlockCacheMisses, 1 );
+        return QByteArray();
+    }
+
+    PerfCounters::add( PerfCounters::BlockCacheHits, 1 );
+    return qUncompress( *compressed );
+}
+
+void BlockCache::insert( qint64 block, const QByteArray& data )
+{
+    QByteArray* compressed = new QByteArray( qCompress( data, compressionLevel ) );
+    // (deleted at once if it is over the whole budget)
+    blocks_.insert( block, compressed, compressed->size() );
+}
+
+bool BlockCache::read( qint64 position, char* buffer, qint64 length,
+        const Fetch& fetch )
+{
+    qint64 block = position / blockSize_;
+    while ( length > 0 ) {
+        QByteArray data = this->block( block );
+        if ( data.isNull() ) {
+            data = fetch( block );
+            // (the fetch may have cached it already)
+            if ( data.size() == blockSize_ && ! blocks_.contains( block ) )
+                insert( block, data );
+        }
+
+        const qint64 offset = position - block * blockSize_;
+        const qint64 count = qMin<qint64>( length, data.size() - offset );
+        if ( count <= 0 )
+            return false;
+
+        memcpy( buffer, data.constData() + offset, count );
+        buffer   += count;
+        position += count;
+        length   -= count;
+        block++;
+    }
+
+    return true;
+}
+
+void BlockCache::invalidateFrom( qint64 position )
+{
+    const qint64 first = position / blockSize_;
+    for ( qint64 block : blocks_.keys() ) {
+        if ( block >= first )
+            blocks_.remove( block );
+    }
+}
+
+void BlockCache::clear()
+{
+    blocks_.clear();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QCache>
+
+// Keeps the blocks of data last read from a slow source (a file on a
+// network file system or on another host) compressed in memory, so
+// scrolling back or searching again does not read them from it again.
+// The blocks are compressed by qCompress at zlib's fastest level, the
+// least recently used ones being dropped when the total of their
+// compressed sizes goes over the budget. The hits and misses are
+// counted in the PerfCounters.
+// This class is reentrant (not thread-safe).
+class BlockCache
+{
+  public:
+    // Returns the data of the block-th block of the source, of
+    // blockSize bytes unless it is the last one, a null array if it
+    // cannot be read.
+    typedef std::function<QByteArray( qint64 block )> Fetch;
+
+    // Blocks of blockSize bytes, up to maxBytes compressed
+    BlockCache( qint64 blockSize, qint64 maxBytes );
+
+    // Sets the budget of the caches created afterwards, in bytes
+    // (0 for no cache)
+    static void setDefaultMaxBytes( qint64 maxBytes );
+    static qint64 defaultMaxBytes();
+
+    qint64 blockSize() const { return blockSize_; }
+
+    // Returns whether the block is cached (not counted as a hit or miss)
+    bool contains( qint64 block ) const;
+    // Returns the data of the block, a null array if it is not cached
+    QByteArray block( qint64 block );
+    // Cache the data of the block
+    void insert( qint64 block, const QByteArray& data );
+
+    // Copy length bytes from position to buffer, the blocks not cached
+    // being fetched (and cached if complete, the last block of a source
+    // still growing being read again).
+    // Returns false if they cannot be read.
+    bool read( qint64 position, char* buffer, qint64 length,
+            const Fetch& fetch );
+
+    // Drop the blocks holding the bytes from position (which have
+    // changed)
+    void invalidateFrom( qint64 position );
+    void clear();
+
+  private:
+    const qint64 blockSize_;
+    // The compressed blocks, their cost being their size
+    QCache<qint64, QByteArray> blocks_;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QMutexLocker>
+
+// A pool of buffers for the threads of a task, each taking one for a
+// piece of the work and giving it back after, so their memory is only
+// allocated for the first pieces rather than for each of them.
+// At most as many buffers are made as there are pieces done at once.
+// It is thread safe.
+template <typename Buffer>
+class BufferPool
+{
+  public:
+    BufferPool() : mutex_(), free_() {}
+
+    // A buffer taken from the pool, given back when destroyed
+    class Lease {
+      public:
+        Lease( BufferPool* pool, std::unique_ptr<Buffer> buffer )
+            : pool_( pool ), buffer_( std::move( buffer ) ) {}
+        Lease( Lease&& other ) = default;
+        ~Lease() { if ( buffer_ ) pool_->release( std::move( buffer_ ) ); }
+
+        Buffer* get() const { return buffer_.get(); }
+        Buffer* operator->() const { return buffer_.get(); }
+
+      private:
+        BufferPool* pool_;
+        std::unique_ptr<Buffer> buffer_;
+    };
+
+    // Returns a free buffer (as the previous piece of work left it),
+    // a new one if all are taken.
+    Lease acquire()
+    {
+        QMutexLocker locker( &mutex_ );
+
+        if ( free_.empty() )
+            return Lease( this, std::unique_ptr<Buffer>( new Buffer() ) );
+
+        std::unique_ptr<Buffer> buffer = std::move( free_.back() );
+        free_.pop_back();
+        return Lease( this, std::move( buffer ) );
+    }
+
+  private:
+    void release( std::unique_ptr<Buffer> buffer )
+    {
+        QMutexLocker locker( &mutex_ );
+        free_.push_back( std::move( buffer ) );
+    }
+
+    QMutex mutex_;
+    std::vector<std::unique_ptr<Buffer>> free_;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bytescanner.h"
+
+#if defined( __AVX2__ )
+#  include <immintrin.h>
+#  define BYTESCANNER_AVX2
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#  include <emmintrin.h>
+#  define BYTESCANNER_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#  include <arm_neon.h>
+#  define BYTESCANNER_NEON
+#endif
+
+#if defined( _MSC_VER ) && ( defined( BYTESCANNER_AVX2 ) || defined( BYTESCANNER_SSE2 ) )
+#  include <intrin.h>
+static inline int firstBitSet( unsigned mask )
+{
+    unsigned long index;
+    _BitScanForward( &index, mask );
+    return static_cast<int>( index );
+}
+#else
+static inline int firstBitSet( unsigned mask )
+{
+    return __builtin_ctz( mask );
+}
+#endif
+
+int findEndOfLineOrTabScalar( const char* data, int length )
+{
+    for ( int i = 0; i < length; i++ ) {
+        const char c = data[i];
+        if ( c == '\n' || c == '\t' )
+            return i;
+    }
+
+    return length;
+}
+
+#if defined( BYTESCANNER_AVX2 )
+
+int findEndOfLineOrTab( const char* data, int length )
+{
+    const __m256i lf  = _mm256_set1_epi8( '\n' );
+    const __m256i tab = _mm256_set1_epi8( '\t' );
+
+    int i = 0;
+    for ( ; i + 32 <= length; i += 32 ) {
+        const __m256i chunk = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>( data + i ) );
+        const __m256i found = _mm256_or_si256(
+                _mm256_cmpeq_epi8( chunk, lf ), _mm256_cmpeq_epi8( chunk, tab ) );
+        const unsigned mask = static_cast<unsigned>( _mm256_movemask_epi8( found ) );
+        if ( mask )
+            return i + firstBitSet( mask );
+    }
+
+    return i + findEndOfLineOrTabScalar( data + i, length - i );
+}
+
+const char* byteScannerKernelName() { return "AVX2"; }
+
+#elif defined( BYTESCANNER_SSE2 )
+
+int findEndOfLineOrTab( const char* data, int length )
+{
+    const __m128i lf  = _mm_set1_epi8( '\n' );
+    const __m128i tab = _mm_set1_epi8( '\t' );
+
+    int i = 0;
+    for ( ; i + 16 <= length; i += 16 ) {
+        const __m128i chunk = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>( data + i ) );
+        const __m128i found = _mm_or_si128(
+                _mm_cmpeq_epi8( chunk, lf ), _mm_cmpeq_epi8( chunk, tab ) );
+        const unsigned mask = static_cast<unsigned>( _mm_movemask_epi8( found ) );
+        if ( mask )
+            return i + firstBitSet( mask );
+    }
+
+    return i + findEndOfLineOrTabScalar( data + i, length - i );
+}
+
+const char* byteScannerKernelName() { return "SSE2"; }
+
+#elif defined( BYTESCANNER_NEON )
+
+int findEndOfLineOrTab( const char* data, int length )
+{
+    const uint8x16_t lf  = vdupq_n_u8( '\n' );
+    const uint8x16_t tab = vdupq_n_u8( '\t' );
+
+    int i = 0;
+    for ( ; i + 16 <= length; i += 16 ) {
+        const uint8x16_t chunk = vld1q_u8(
+                reinterpret_cast<const uint8_t*>( data + i ) );
+        const uint8x16_t found = vorrq_u8(
+                vceqq_u8( chunk, lf ), vceqq_u8( chunk, tab ) );
+        // No movemask on NEON, narrow the result to 4 bits per byte
+        const uint64_t mask = vget_lane_u64( vreinterpret_u64_u8(
+                    vshrn_n_u16( vreinterpretq_u16_u8( found ), 4 ) ), 0 );
+        if ( mask )
+            return i + ( __builtin_ctzll( mask ) >> 2 );
+    }
+
+    return i + findEndOfLineOrTabScalar( data + i, length - i );
+}
+
+const char* byteScannerKernelName() { return "NEON"; }
+
+#else
+
+int findEndOfLineOrTab( const char* data, int length )
+{
+    return findEndOfLineOrTabScalar( data, length );
+}
+
+const char* byteScannerKernelName() { return "scalar"; }
+
+#endif
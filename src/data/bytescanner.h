@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BYTESCANNER_H
+#define BYTESCANNER_H
+
+// Kernels used by the indexer to find the characters it is interested
+// in ('\n' and '\t') in a block of raw data.
+// The vectorised version is selected at compile time (AVX2, SSE2 or NEON)
+// and falls back to the scalar one when none is available.
+
+// Returns the offset of the first '\n' or '\t' in data,
+// or length if there is none.
+int findEndOfLineOrTab( const char* data, int length );
+
+// Byte by byte implementation, used as a reference and for the tail
+// of the buffers.
+int findEndOfLineOrTabScalar( const char* data, int length );
+
+// Name of the kernel used by findEndOfLineOrTab()
+const char* byteScannerKernelName();
+
+#endif
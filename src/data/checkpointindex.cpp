@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements CheckpointIndex
+
+#include "checkpointindex.h"
+
+#include <algorithm>
+
+#include <QIODevice>
+
+// 4 MiB read whatever the size of the file
+const int CheckpointIndex::defaultNbCheckpoints = 64;
+const int CheckpointIndex::defaultWindowSize = 64*1024;
+
+bool CheckpointIndex::build( QIODevice* device, qint64 size,
+        int nb_checkpoints, int window_size )
+{
+    checkpoints_.clear();
+
+    Checkpoints checkpoints;
+    qint64 line = 0;
+    for ( int i = 0; i < nb_checkpoints; i++ ) {
+        const qint64 begin = size * i / nb_checkpoints;
+        const qint64 end = size * ( i + 1 ) / nb_checkpoints;
+        if ( end <= begin )
+            continue;
+
+        if ( ! device->seek( begin ) )
+            return false;
+        const QByteArray window =
+            device->read( qMin<qint64>( window_size, end - begin ) );
+        if ( window.isEmpty() )
+            return false;
+
+        // The lines of the window stand for the ones up to the next
+        // checkpoint
+        checkpoints.push_back( { begin, line } );
+        const qint64 nb_lines = window.count( '\n' );
+        line += ( window.size() == end - begin ) ? nb_lines :
+            qRound64( nb_lines * double( end - begin ) / window.size() );
+    }
+
+    // The last line might not be terminated
+    if ( size > 0 ) {
+        if ( ! device->seek( size - 1 ) )
+            return false;
+        if ( device->read( 1 ) != "\n" )
+            line++;
+    }
+    checkpoints.push_back( { size, line } );
+
+    checkpoints_.swap( checkpoints );
+    return true;
+}
+
+qint64 CheckpointIndex::lineAt( qint64 position ) const
+{
+    if ( checkpoints_.empty() || position <= 0 )
+        return 0;
+    if ( position >= size() )
+        return nbLines();
+
+    // The checkpoints around the position
+    const auto next = std::upper_bound( checkpoints_.begin(),
+            checkpoints_.end(), position,
+            []( qint64 p, const Checkpoint& c ) { return p < c.position; } );
+    const Checkpoint& before = *( next - 1 );
+
+    return before.line + qint64( double( next->line - before.line )
+            * ( position - before.position )
+            / ( next->position - before.position ) );
+}
+
+qint64 CheckpointIndex::positionOf( qint64 line ) const
+{
+    if ( checkpoints_.empty() || line <= 0 )
+        return 0;
+    if ( line >= nbLines() )
+        return size();
+
+    // The checkpoints around the line
+    const auto next = std::upper_bound( checkpoints_.begin(),
+            checkpoints_.end(), line,
+            []( qint64 l, const Checkpoint& c ) { return l < c.line; } );
+    const Checkpoint& before = *( next - 1 );
+
+    return before.position + qint64( double( next->position - before.position )
+            * ( line - before.line ) / ( next->line - before.line ) );
+}
+
+qint64 CheckpointIndex::lineStartAfter( QIODevice* device, qint64 size,
+        qint64 position )
+{
+    static const int blockSize = 64*1024;
+
+    if ( position <= 0 )
+        return 0;
+
+    // A line starts after each LF, from the one before position
+    qint64 block_position = position - 1;
+    while ( block_position < size ) {
+        if ( ! device->seek( block_position ) )
+            break;
+        const QByteArray block = device->read(
+                qMin<qint64>( blockSize, size - block_position ) );
+        if ( block.isEmpty() )
+            break;
+
+        const int lf = block.indexOf( '\n' );
+        if ( lf >= 0 )
+            return block_position + lf + 1;
+        block_position += block.size();
+    }
+
+    return size;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHECKPOINTINDEX_H
+#define CHECKPOINTINDEX_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+class QIODevice;
+
+// A sparse index of a file not indexed yet, sampled at fixed byte
+// checkpoints: the ends of line of a window after each checkpoint are
+// counted, from which the number of lines of the whole file, and the
+// line at a position, are estimated at once whatever its size.
+// It is only an estimate (exact at the checkpoints whose window goes
+// to the next one), the positions of the lines being known once the
+// file is indexed.
+// Only the files of one byte wide code units are sampled.
+class CheckpointIndex
+{
+  public:
+    struct Checkpoint {
+        qint64 position;
+        // Estimated number of lines before the position
+        qint64 line;
+    };
+    typedef std::vector<Checkpoint> Checkpoints;
+
+    CheckpointIndex() : checkpoints_() {}
+
+    // Sample the first size bytes of the device at nb_checkpoints
+    // checkpoints evenly spaced, reading window_size bytes at each.
+    // Returns false (the index being empty) if it cannot be read.
+    bool build( QIODevice* device, qint64 size,
+            int nb_checkpoints = defaultNbCheckpoints,
+            int window_size = defaultWindowSize );
+
+    bool isEmpty() const { return checkpoints_.empty(); }
+    // The checkpoints, the last one being at the end of the data
+    const Checkpoints& checkpoints() const { return checkpoints_; }
+    // Size of the data sampled
+    qint64 size() const
+    { return checkpoints_.empty() ? 0 : checkpoints_.back().position; }
+
+    // Estimated number of lines of the data
+    qint64 nbLines() const
+    { return checkpoints_.empty() ? 0 : checkpoints_.back().line; }
+    // Estimated number of lines before the passed position
+    qint64 lineAt( qint64 position ) const;
+    // Estimated position of the start of the passed line
+    qint64 positionOf( qint64 line ) const;
+
+    // Returns the position of the start of the first line starting at
+    // or after position in the first size bytes of the device (size if
+    // none does), only the bytes from the one before position being read.
+    static qint64 lineStartAfter( QIODevice* device, qint64 size,
+            qint64 position );
+
+    static const int defaultNbCheckpoints;
+    static const int defaultWindowSize;
+
+  private:
+    Checkpoints checkpoints_;
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements ColumnIndex
+
+#include "columnindex.h"
+
+#include "abstractlogdata.h"
+
+const int ColumnIndex::checkpointInterval = 64 * 1024;
+
+void ColumnIndex::add( qint64 begin, qint64 end,
+        const Checkpoints& checkpoints )
+{
+    QMutexLocker locker( &mutex_ );
+
+    lines_[ begin ] = { end, checkpoints };
+}
+
+bool ColumnIndex::find( qint64 begin, qint64 end,
+        Checkpoints* checkpoints ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    const auto line = lines_.find( begin );
+    if ( line == lines_.end() || line->second.end != end )
+        return false;
+
+    *checkpoints = line->second.checkpoints;
+    return true;
+}
+
+void ColumnIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    lines_.clear();
+}
+
+ColumnIndex::Checkpoints ColumnIndex::checkpoints(
+        const TextEncoding& encoding, const char* line, int length )
+{
+    Checkpoints checkpoints;
+    checkpoints.push_back( { 0, 0 } );
+
+    // Decoded by the same pieces as LogData reads the line
+    LineDecoder decoder( encoding );
+    int offset = 0;
+    int column = 0;
+    while ( offset < length ) {
+        int piece = length - offset;
+        if ( piece > checkpointInterval + 4 )
+            piece = characterBoundary( encoding, line + offset,
+                    checkpointInterval );
+
+        column = advance( column,
+                decoder.decode( line + offset, piece, false ) );
+
+        offset += piece;
+        if ( offset < length )
+            checkpoints.push_back( { offset, column } );
+    }
+
+    return checkpoints;
+}
+
+int ColumnIndex::characterBoundary( const TextEncoding& encoding,
+        const char* data, int length )
+{
+    switch ( encoding.type() ) {
+        case TextEncoding::Latin1:
+            return length;
+        case TextEncoding::Utf16LE:
+        case TextEncoding::Utf16BE:
+            {
+                int end = length & ~1;
+                // Not between the two units of a surrogate pair
+                const uchar high = data[ end + 1 - encoding.lowByteIndex() ];
+                if ( ( high & 0xFC ) == 0xDC )
+                    end -= 2;
+                return end;
+            }
+        default:
+            {
+                // Not before a continuation byte
+                int end = length;
+                while ( ( uchar( data[end] ) & 0xC0 ) == 0x80
+                        && length - end < 3 )
+                    end--;
+                return end;
+            }
+    }
+}
+
+int ColumnIndex::advance( int column, const QString& text )
+{
+    for ( const QChar c : text )
+        column += ( c == '\t' ) ?
+            AbstractLogData::tabStop - column % AbstractLogData::tabStop : 1;
+
+    return column;
+}
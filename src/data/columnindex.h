@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COLUMNINDEX_H
+#define COLUMNINDEX_H
+
+#include <map>
+#include <vector>
+
+#include <QMutex>
+#include <QString>
+
+#include "textencoding.h"
+
+// The columns (tabs expanded) some characters of the long lines are
+// displayed at, for the window of such a line shown by a view scrolled
+// horizontally to be decoded from the closest one rather than from the
+// start of the line (see AbstractLogData::getExpandedLineWindows).
+// The checkpoints of a line are recorded while it is indexed, the line
+// being in memory then, so it is not read whole again to be displayed.
+// The lines are identified by their position in the data.
+// This class is thread-safe.
+class ColumnIndex
+{
+  public:
+    struct Checkpoint {
+        // Offset of the character from the start of the line, in bytes
+        qint64 offset;
+        int column;
+    };
+    typedef std::vector<Checkpoint> Checkpoints;
+
+    ColumnIndex() : mutex_(), lines_() {}
+
+    // Record the checkpoints of the line from begin to end (excluding
+    // its end of line), replacing those of a line starting there.
+    void add( qint64 begin, qint64 end, const Checkpoints& checkpoints );
+    // Returns whether the checkpoints of the line from begin to end have
+    // been recorded, setting *checkpoints to them if so.
+    bool find( qint64 begin, qint64 end, Checkpoints* checkpoints ) const;
+    // Forget all the lines (the data is indexed again)
+    void clear();
+
+    // Returns the checkpoints of the passed raw line, the first one at
+    // its start then one every checkpointInterval bytes or so.
+    static Checkpoints checkpoints( const TextEncoding& encoding,
+            const char* line, int length );
+    // Returns the length to keep of the passed piece of a line (followed
+    // by at least 3 more bytes of it) for it to end between two characters.
+    static int characterBoundary( const TextEncoding& encoding,
+            const char* data, int length );
+    // Returns the column the decoded text displayed from column ends at
+    static int advance( int column, const QString& text );
+
+    // Bytes of a line between two checkpoints (about)
+    static const int checkpointInterval;
+
+  private:
+    struct Line {
+        qint64 end;
+        Checkpoints checkpoints;
+    };
+
+    mutable QMutex mutex_;
+    // The lines by the position of their start
+    std::map<qint64, Line> lines_;
+};
+
+#endif
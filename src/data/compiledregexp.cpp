@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
+#include "log.h"
+
+#include "compiledregexp.h"
+
+// Number of compiled patterns kept in the cache
+static const int cacheSize = 64;
+
+// A line matched by a sane pattern takes at most a few thousand steps,
+// and the budget is spent in a few ms.
+const int CompiledRegExp::matchBudget = 1000000;
+
+namespace {
+    // The patterns too costly to match, by their text and options
+    QMutex tooCostlyMutex;
+    QSet<QString> tooCostlyPatterns;
+
+    QString costKey( const QRegExp& regexp )
+    {
+        return QString( "%1:%2:%3:" ).arg( regexp.patternSyntax() )
+            .arg( regexp.caseSensitivity() ).arg( regexp.isMinimal() )
+            + regexp.pattern();
+    }
+}
+
+CompiledRegExp::CompiledRegExp()
+    : regexp_(), pattern_(), compiled_( false ),
+    tooCostly_( std::make_shared<std::atomic<bool>>( false ) )
+{
+}
+
+CompiledRegExp::CompiledRegExp( const QRegExp& regexp )
+    : regexp_( regexp ), pattern_(), compiled_( false ),
+    tooCostly_( std::make_shared<std::atomic<bool>>( false ) )
+{
+    compiled_ = compile( regexp, &pattern_ );
+}
+
+bool CompiledRegExp::isTooCostly( const QRegExp& regexp )
+{
+    QMutexLocker locker( &tooCostlyMutex );
+    return tooCostlyPatterns.contains( costKey( regexp ) );
+}
+
+void CompiledRegExp::reportTooCostly( const QRegExp& regexp )
+{
+    QMutexLocker locker( &tooCostlyMutex );
+    if ( ! tooCostlyPatterns.contains( costKey( regexp ) ) ) {
+        LOG(logWARNING) << "Pattern too costly to match, abandoned: "
+            << regexp.pattern().toStdString();
+        tooCostlyPatterns.insert( costKey( regexp ) );
+    }
+}
+
+int CompiledRegExp::indexIn( const QString& string, int offset,
+        int* matchedLength, QString* capture ) const
+{
+    if ( ! compiled_ ) {
+        // (the copy holding the state of the match)
+        QRegExp regexp( regexp_ );
+        const int position = regexp.indexIn( string, offset );
+        if ( position != -1 ) {
+            if ( matchedLength )
+                *matchedLength = regexp.matchedLength();
+            if ( capture )
+                *capture = regexp.cap( regexp.captureCount() > 0 ? 1 : 0 );
+        }
+        return position;
+    }
+
+    if ( offset < 0 )
+        offset = qMax( offset + string.size(), 0 );
+    if ( offset > string.size() || *tooCostly_ )
+        return -1;
+
+    const QRegularExpressionMatch match = pattern_.match( string, offset );
+    if ( ! match.hasMatch() ) {
+        // (not valid when PCRE2 fails, on reaching the match limit)
+        if ( ! match.isValid() ) {
+            *tooCostly_ = true;
+            reportTooCostly( regexp_ );
+        }
+        return -1;
+    }
+
+    if ( matchedLength )
+        *matchedLength = match.capturedLength();
+    if ( capture )
+        *capture = match.captured( pattern_.captureCount() > 0 ? 1 : 0 );
+
+    return match.capturedStart();
+}
+
+int CompiledRegExp::lastIndexIn( const QString& string, int offset,
+        int* matchedLength ) const
+{
+    if ( ! compiled_ ) {
+        QRegExp regexp( regexp_ );
+        const int position = regexp.lastIndexIn( string, offset );
+        if ( position != -1 && matchedLength )
+            *matchedLength = regexp.matchedLength();
+        return position;
+    }
+
+    if ( offset < 0 )
+        offset += string.size();
+    if ( offset < 0 || *tooCostly_ )
+        return -1;
+
+    // There is no backward search, the matches are found from the
+    // start, one per position a match starts at.
+    int position = -1;
+    int length = 0;
+    int start = 0;
+    while ( start <= string.size() ) {
+        const QRegularExpressionMatch match = pattern_.match( string, start );
+        if ( ! match.isValid() ) {
+            *tooCostly_ = true;
+            reportTooCostly( regexp_ );
+            return -1;
+        }
+        if ( ! match.hasMatch() || match.capturedStart() > offset )
+            break;
+
+        position = match.capturedStart();
+        length   = match.capturedLength();
+        start    = position + 1;
+    }
+
+    if ( position != -1 && matchedLength )
+        *matchedLength = length;
+
+    return position;
+}
+
+// As QRegExp converts them
+QString CompiledRegExp::fromWildcard( const QString& wildcard, bool escaping )
+{
+    QString pattern;
+    bool escaped = false;
+
+    for ( int i = 0; i < wildcard.size(); i++ ) {
+        const QChar c = wildcard[i];
+        switch ( c.unicode() ) {
+            case '\\':
+                if ( escaping && ! escaped ) {
+                    escaped = true;
+                    continue;
+                }
+                pattern += "\\\\";
+                break;
+            case '*':
+                pattern += escaped ? "\\*" : ".*";
+                break;
+            case '?':
+                pattern += escaped ? "\\?" : ".";
+                break;
+            case '[':
+                if ( escaped ) {
+                    pattern += "\\[";
+                    break;
+                }
+                // A set, copied up to its end
+                pattern += c;
+                if ( i + 1 < wildcard.size() && wildcard[i + 1] == '^' )
+                    pattern += wildcard[++i];
+                if ( i + 1 < wildcard.size() && wildcard[i + 1] == ']' )
+                    pattern += wildcard[++i];
+                while ( i + 1 < wildcard.size() && wildcard[i + 1] != ']' ) {
+                    if ( wildcard[i + 1] == '\\' )
+                        pattern += '\\';
+                    pattern += wildcard[++i];
+                }
+                if ( i + 1 < wildcard.size() )
+                    pattern += wildcard[++i];
+                break;
+            case '$': case '(': case ')': case '+': case '.':
+            case '^': case '{': case '|': case '}': case ']':
+                pattern += '\\';
+                pattern += c;
+                break;
+            default:
+                pattern += c;
+                break;
+        }
+        escaped = false;
+    }
+
+    return pattern;
+}
+
+bool CompiledRegExp::compile( const QRegExp& regexp,
+        QRegularExpression* compiled )
+{
+    static QMutex mutex;
+    static QCache<QString, QRegularExpression> cache( cacheSize );
+
+    QString pattern;
+    switch ( regexp.patternSyntax() ) {
+        case QRegExp::RegExp:
+        case QRegExp::RegExp2:
+            pattern = regexp.pattern();
+            break;
+        case QRegExp::FixedString:
+            pattern = QRegularExpression::escape( regexp.pattern() );
+            break;
+        case QRegExp::Wildcard:
+        case QRegExp::WildcardUnix:
+            pattern = fromWildcard( regexp.pattern(),
+                    regexp.patternSyntax() == QRegExp::WildcardUnix );
+            break;
+        default:
+            return false;
+    }
+
+    // \w, \d... match the same (Unicode) characters as with QRegExp
+    QRegularExpression::PatternOptions options =
+        QRegularExpression::UseUnicodePropertiesOption;
+    if ( regexp.caseSensitivity() == Qt::CaseInsensitive )
+        options |= QRegularExpression::CaseInsensitiveOption;
+    if ( regexp.isMinimal() )
+        options |= QRegularExpression::InvertedGreedinessOption;
+
+    // Matches going over the budget fail rather than going on
+    // (the limit being set in the pattern, as QRegularExpression has
+    // no match context)
+    pattern = QString( "(*LIMIT_MATCH=%1)" ).arg( matchBudget ) + pattern;
+
+    const QString key = QString::number( options ) + ':' + pattern;
+
+    QMutexLocker locker( &mutex );
+    if ( const QRegularExpression* cached = cache.object( key ) ) {
+        *compiled = *cached;
+        return true;
+    }
+
+    QRegularExpression* expression = new QRegularExpression( pattern, options );
+    if ( ! expression->isValid() ) {
+        LOG(logDEBUG) << "CompiledRegExp: cannot compile the pattern ("
+            << expression->errorString().toStdString() << ")";
+        delete expression;
+        return false;
+    }
+
+    // Compiled now (copies share it), rather than by its first match
+#if QT_VERSION >= 0x050400
+    expression->optimize();
+#endif
+    *compiled = *expression;
+    cache.insert( key, expression );
+
+    return true;
+}
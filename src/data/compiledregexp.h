@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPILEDREGEXP_H
+#define COMPILEDREGEXP_H
+
+#include <atomic>
+#include <memory>
+
+#include <QRegExp>
+#include <QRegularExpression>
+#include <QString>
+
+// A QRegExp pattern matched by the PCRE2 engine of QRegularExpression,
+// JIT compiled where it is supported, rather than by the interpreter of
+// QRegExp, for the matching done on the decoded lines (the views, the
+// quick find, the filters and the timestamps).
+// The compiled patterns are kept in a cache shared by all the instances,
+// so a pattern is compiled once whatever the number of its users.
+// Unlike QRegExp, an instance holds no state of the last match (the
+// results being returned by the matching functions), so it is
+// immutable and one instance can be shared by the threads matching
+// with it. The few patterns PCRE2 rejects are matched by a copy of
+// the QRegExp made for each match.
+// A match taking more than matchBudget steps (a pattern backtracking
+// catastrophically, such as (a+)+b) is abandoned, the pattern being
+// then deemed too costly: it matches nothing any more, and is
+// reported by isTooCostly() for the user to be told.
+class CompiledRegExp
+{
+  public:
+    // An empty pattern
+    CompiledRegExp();
+    explicit CompiledRegExp( const QRegExp& regexp );
+
+    const QRegExp& regexp() const { return regexp_; }
+
+    // Most steps of the engine a match of a line can take
+    // (PCRE2's match limit, see also RawMatcher)
+    static const int matchBudget;
+
+    // Returns the position of the first match in string from offset
+    // (counted from the end if negative), -1 if none, as
+    // QRegExp::indexIn() does.
+    // matchedLength is set to the length of the match, and capture to
+    // the text of the first capture (or the whole match if the pattern
+    // has none) if they are not null.
+    int indexIn( const QString& string, int offset = 0,
+            int* matchedLength = nullptr, QString* capture = nullptr ) const;
+    // Idem for the last match starting at or before offset, as
+    // QRegExp::lastIndexIn() does.
+    int lastIndexIn( const QString& string, int offset = -1,
+            int* matchedLength = nullptr ) const;
+
+    // Returns the regular expression matching what the wildcard
+    // pattern does (its backslashes escaping the next character if
+    // escaping is set, as with QRegExp::WildcardUnix).
+    static QString fromWildcard( const QString& wildcard, bool escaping );
+
+    // Returns whether a match of this instance (or of its copies) has
+    // gone over the budget.
+    bool isTooCostly() const { return *tooCostly_; }
+    // Returns whether a match of the passed pattern has gone over the
+    // budget, whatever the instance (or RawMatcher) it was made by.
+    static bool isTooCostly( const QRegExp& regexp );
+    // Record that a match of the pattern has gone over the budget
+    // (thread safe).
+    static void reportTooCostly( const QRegExp& regexp );
+
+  private:
+    // Set compiled to the pattern of regexp from the cache, compiling
+    // it if needed, returns false if it has no equivalent.
+    static bool compile( const QRegExp& regexp, QRegularExpression* compiled );
+
+    // (the regexp_ is used by the matches if pattern_ is not valid)
+    QRegExp regexp_;
+    QRegularExpression pattern_;
+    bool compiled_;
+    // Shared by the copies, for all to stop matching
+    std::shared_ptr<std::atomic<bool>> tooCostly_;
+};
+
+#endif
@@ -0,0 +1,554 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements CompressedFile
+
+#include "compressedfile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef GLOGG_SUPPORTS_GZIP
+#  include <zlib.h>
+#endif
+#ifdef GLOGG_SUPPORTS_ZSTD
+#  include <zstd.h>
+#endif
+
+const int64_t CompressedFile::checkpointSpacing = 4 * 1024 * 1024;
+
+namespace {
+    // Size of the reads from the compressed file
+    const size_t inputSize = 64 * 1024;
+    // Size of the deflate window
+    const size_t windowSize = 32 * 1024;
+
+    bool seekFile( FILE* file, int64_t position )
+    {
+#ifdef _WIN32
+        return _fseeki64( file, position, SEEK_SET ) == 0;
+#else
+        return fseeko( file, position, SEEK_SET ) == 0;
+#endif
+    }
+
+    // Returns the size of the file, its position being left at the start
+    int64_t fileSize( FILE* file )
+    {
+#ifdef _WIN32
+        _fseeki64( file, 0, SEEK_END );
+        const int64_t size = _ftelli64( file );
+#else
+        fseeko( file, 0, SEEK_END );
+        const int64_t size = ftello( file );
+#endif
+        seekFile( file, 0 );
+        return size < 0 ? 0 : size;
+    }
+}
+
+struct CompressedFile::Session {
+    Session( const std::string& fileName )
+        : file( fopen( fileName.c_str(), "rb" ) ), out( 0 ),
+        input( inputSize )
+    {
+#ifdef GLOGG_SUPPORTS_GZIP
+        memset( &stream, 0, sizeof( stream ) );
+        streamReady = ( inflateInit2( &stream, 15 + 32 ) == Z_OK );
+        raw = false;
+#endif
+#ifdef GLOGG_SUPPORTS_ZSTD
+        dctx = ZSTD_createDCtx();
+        zin = { input.data(), 0, 0 };
+#endif
+    }
+
+    ~Session()
+    {
+        if ( file )
+            fclose( file );
+#ifdef GLOGG_SUPPORTS_GZIP
+        if ( streamReady )
+            inflateEnd( &stream );
+#endif
+#ifdef GLOGG_SUPPORTS_ZSTD
+        ZSTD_freeDCtx( dctx );
+#endif
+    }
+
+    bool isValid() const { return file != nullptr; }
+
+    // Read the next input, returns the number of bytes read
+    size_t readInput() { return fread( input.data(), 1, input.size(), file ); }
+
+    FILE* file;
+    // Position reached in the decompressed data
+    int64_t out;
+    std::vector<unsigned char> input;
+
+#ifdef GLOGG_SUPPORTS_GZIP
+    z_stream stream;
+    bool streamReady;
+    // Reading raw deflate data (from a checkpoint within a member)
+    bool raw;
+#endif
+#ifdef GLOGG_SUPPORTS_ZSTD
+    ZSTD_DCtx* dctx;
+    ZSTD_inBuffer zin;
+#endif
+};
+
+CompressedFile::Format CompressedFile::detectFormat( const std::string& fileName )
+{
+    unsigned char magic[4] = { 0, 0, 0, 0 };
+
+    FILE* file = fopen( fileName.c_str(), "rb" );
+    if ( file ) {
+        if ( fread( magic, 1, sizeof( magic ), file ) < 2 )
+            magic[0] = 0;
+        fclose( file );
+    }
+
+    if ( magic[0] == 0x1f && magic[1] == 0x8b )
+        return Format::Gzip;
+    else if ( magic[0] == 0x28 && magic[1] == 0xb5
+            && magic[2] == 0x2f && magic[3] == 0xfd )
+        return Format::Zstd;
+    else
+        return Format::Uncompressed;
+}
+
+bool CompressedFile::isSupported( Format format )
+{
+    switch ( format ) {
+        case Format::Uncompressed:
+            return true;
+        case Format::Gzip:
+#ifdef GLOGG_SUPPORTS_GZIP
+            return true;
+#else
+            return false;
+#endif
+        case Format::Zstd:
+#ifdef GLOGG_SUPPORTS_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+CompressedFile::CompressedFile( const std::string& fileName, Format format )
+    : fileName_( fileName ), format_( format ), size_( 0 ), sourceSize_( 0 ),
+    checkpoints_(), session_()
+{
+}
+
+CompressedFile::~CompressedFile()
+{
+}
+
+bool CompressedFile::readAll( const Consumer& consumer )
+{
+    checkpoints_.clear();
+    size_ = 0;
+
+    session_.reset( new Session( fileName_ ) );
+    if ( ! session_->isValid() ) {
+        session_.reset();
+        return false;
+    }
+
+    sourceSize_ = fileSize( session_->file );
+
+    const bool result = ( format_ == Format::Gzip ) ?
+        gzipDecompressAll( consumer ) : zstdDecompressAll( consumer );
+
+    // Its state is not the one of any checkpoint
+    session_.reset();
+
+    if ( ! result ) {
+        checkpoints_.clear();
+        size_ = 0;
+    }
+
+    return result;
+}
+
+bool CompressedFile::read( int64_t position, char* buffer, int64_t length )
+{
+    if ( checkpoints_.empty() || position < 0 || length < 0
+            || position + length > size_ )
+        return false;
+    if ( length == 0 )
+        return true;
+
+    // Last checkpoint at or before the position
+    const Checkpoint& checkpoint = *( std::upper_bound(
+                checkpoints_.begin(), checkpoints_.end(), position,
+                []( int64_t position, const Checkpoint& checkpoint )
+                { return position < checkpoint.out; } ) - 1 );
+
+    // Going on from the end of the previous read if it is closer
+    if ( ! session_ || session_->out > position
+            || session_->out < checkpoint.out ) {
+        if ( ! session_ )
+            session_.reset( new Session( fileName_ ) );
+
+        const bool started = session_->isValid()
+            && seekFile( session_->file, checkpoint.in
+                    - ( checkpoint.bits > 0 ? 1 : 0 ) )
+            && ( ( format_ == Format::Gzip ) ?
+                    gzipStartSession( checkpoint ) :
+                    zstdStartSession( checkpoint ) );
+        if ( ! started ) {
+            session_.reset();
+            return false;
+        }
+        session_->out = checkpoint.out;
+    }
+
+    const bool result = ( format_ == Format::Gzip ) ?
+        gzipDecompress( position - session_->out, buffer, length ) :
+        zstdDecompress( position - session_->out, buffer, length );
+    if ( ! result )
+        session_.reset();
+
+    return result;
+}
+
+#ifdef GLOGG_SUPPORTS_GZIP
+
+bool CompressedFile::gzipDecompressAll( const Consumer& consumer )
+{
+    Session& session = *session_;
+    z_stream& stream = session.stream;
+    if ( ! session.streamReady )
+        return false;
+
+    // The output goes round the window, so it always holds the last
+    // 32 KiB decompressed
+    std::vector<unsigned char> window( windowSize );
+    int64_t total_in = 0;
+    int64_t total_out = 0;
+    int64_t last = 0;
+
+    checkpoints_.push_back( { 0, 0, -1, std::vector<unsigned char>() } );
+
+    stream.avail_in = 0;
+    stream.avail_out = 0;
+    for (;;) {
+        if ( stream.avail_in == 0 ) {
+            stream.avail_in = session.readInput();
+            stream.next_in = session.input.data();
+            // The stream is incomplete
+            if ( stream.avail_in == 0 )
+                return false;
+        }
+        if ( stream.avail_out == 0 ) {
+            stream.avail_out = windowSize;
+            stream.next_out = window.data();
+        }
+
+        unsigned char* const output = stream.next_out;
+        total_in  += stream.avail_in;
+        total_out += stream.avail_out;
+        // Stop at the end of each deflate block
+        const int ret = inflate( &stream, Z_BLOCK );
+        total_in  -= stream.avail_in;
+        total_out -= stream.avail_out;
+
+        if ( ret != Z_OK && ret != Z_STREAM_END )
+            return false;
+
+        if ( stream.next_out > output
+                && ! consumer( reinterpret_cast<const char*>( output ),
+                    stream.next_out - output, total_in ) )
+            return false;
+
+        if ( ret == Z_STREAM_END ) {
+            // Another member might follow (concatenated gzip files)
+            if ( stream.avail_in == 0 ) {
+                stream.avail_in = session.readInput();
+                stream.next_in = session.input.data();
+                if ( stream.avail_in == 0 )
+                    break;
+            }
+            inflateReset( &stream );
+            checkpoints_.push_back( { total_out, total_in, -1,
+                    std::vector<unsigned char>() } );
+            last = total_out;
+        }
+        else if ( ( stream.data_type & 128 ) && ! ( stream.data_type & 64 )
+                && total_out - last >= checkpointSpacing ) {
+            // At the end of a block (but the last one), the window
+            // oldest byte being at next_out
+            Checkpoint checkpoint = { total_out, total_in,
+                stream.data_type & 7, std::vector<unsigned char>( windowSize ) };
+            const size_t left = stream.avail_out;
+            std::copy( window.end() - left, window.end(),
+                    checkpoint.window.begin() );
+            std::copy( window.begin(), window.end() - left,
+                    checkpoint.window.begin() + left );
+            checkpoints_.push_back( std::move( checkpoint ) );
+            last = total_out;
+        }
+    }
+
+    size_ = total_out;
+
+    return true;
+}
+
+bool CompressedFile::gzipStartSession( const Checkpoint& checkpoint )
+{
+    Session& session = *session_;
+    z_stream& stream = session.stream;
+    if ( ! session.streamReady )
+        return false;
+
+    stream.avail_in = 0;
+
+    if ( checkpoint.bits == -1 ) {
+        // The header of a member
+        session.raw = false;
+        return inflateReset2( &stream, 15 + 32 ) == Z_OK;
+    }
+
+    session.raw = true;
+    if ( inflateReset2( &stream, -15 ) != Z_OK )
+        return false;
+
+    if ( checkpoint.bits > 0 ) {
+        const int c = getc( session.file );
+        if ( c == EOF )
+            return false;
+        inflatePrime( &stream, checkpoint.bits, c >> ( 8 - checkpoint.bits ) );
+    }
+
+    return inflateSetDictionary( &stream, checkpoint.window.data(),
+            checkpoint.window.size() ) == Z_OK;
+}
+
+bool CompressedFile::gzipDecompress( int64_t skip, char* buffer, int64_t length )
+{
+    Session& session = *session_;
+    z_stream& stream = session.stream;
+    unsigned char discard[windowSize];
+
+    // Bytes of the gzip trailer to skip
+    int trailer = 0;
+
+    while ( skip > 0 || length > 0 ) {
+        if ( stream.avail_in == 0 ) {
+            stream.avail_in = session.readInput();
+            stream.next_in = session.input.data();
+            if ( stream.avail_in == 0 )
+                return false;
+        }
+
+        if ( trailer > 0 ) {
+            const int skipped = std::min<int>( trailer, stream.avail_in );
+            stream.next_in  += skipped;
+            stream.avail_in -= skipped;
+            trailer -= skipped;
+            continue;
+        }
+
+        const bool skipping = ( skip > 0 );
+        const uInt wanted = skipping ?
+            std::min<int64_t>( skip, windowSize ) :
+            std::min<int64_t>( length, 1 << 30 );
+        stream.next_out = skipping ?
+            discard : reinterpret_cast<unsigned char*>( buffer );
+        stream.avail_out = wanted;
+
+        const int ret = inflate( &stream, Z_NO_FLUSH );
+        if ( ret != Z_OK && ret != Z_STREAM_END )
+            return false;
+
+        const int64_t produced = wanted - stream.avail_out;
+        session.out += produced;
+        if ( skipping ) {
+            skip -= produced;
+        }
+        else {
+            buffer += produced;
+            length -= produced;
+        }
+
+        if ( ret == Z_STREAM_END ) {
+            // The raw data of a member is followed by its trailer,
+            // then the header of the next one.
+            if ( session.raw )
+                trailer = 8;
+            session.raw = false;
+            if ( inflateReset2( &stream, 15 + 32 ) != Z_OK )
+                return false;
+        }
+    }
+
+    return true;
+}
+
+#else
+
+bool CompressedFile::gzipDecompressAll( const Consumer& )
+{
+    return false;
+}
+
+bool CompressedFile::gzipStartSession( const Checkpoint& )
+{
+    return false;
+}
+
+bool CompressedFile::gzipDecompress( int64_t, char*, int64_t )
+{
+    return false;
+}
+
+#endif
+
+#ifdef GLOGG_SUPPORTS_ZSTD
+
+bool CompressedFile::zstdDecompressAll( const Consumer& consumer )
+{
+    Session& session = *session_;
+    if ( ! session.dctx )
+        return false;
+
+    ZSTD_DCtx_reset( session.dctx, ZSTD_reset_session_only );
+
+    std::vector<char> output( ZSTD_DStreamOutSize() );
+    ZSTD_inBuffer& input = session.zin;
+    // Position of the input buffer in the file
+    int64_t input_position = 0;
+    int64_t total_out = 0;
+    int64_t last = 0;
+    size_t ret = 0;
+
+    checkpoints_.push_back( { 0, 0, 0, std::vector<unsigned char>() } );
+
+    input = { session.input.data(), 0, 0 };
+    for (;;) {
+        if ( input.pos == input.size ) {
+            input_position += input.size;
+            input.size = session.readInput();
+            input.pos = 0;
+            if ( input.size == 0 )
+                break;
+        }
+
+        ZSTD_outBuffer out = { output.data(), output.size(), 0 };
+        ret = ZSTD_decompressStream( session.dctx, &out, &input );
+        if ( ZSTD_isError( ret ) )
+            return false;
+
+        total_out += out.pos;
+        if ( out.pos > 0 && ! consumer( output.data(), out.pos,
+                    input_position + input.pos ) )
+            return false;
+
+        // At the end of a frame, the next one can be decompressed
+        // on its own.
+        if ( ret == 0 && total_out - last >= checkpointSpacing ) {
+            checkpoints_.push_back( { total_out, input_position + input.pos,
+                    0, std::vector<unsigned char>() } );
+            last = total_out;
+        }
+    }
+
+    // The last frame is incomplete
+    if ( ret != 0 )
+        return false;
+
+    size_ = total_out;
+
+    return true;
+}
+
+bool CompressedFile::zstdStartSession( const Checkpoint& )
+{
+    Session& session = *session_;
+    if ( ! session.dctx )
+        return false;
+
+    ZSTD_DCtx_reset( session.dctx, ZSTD_reset_session_only );
+    session.zin = { session.input.data(), 0, 0 };
+
+    return true;
+}
+
+bool CompressedFile::zstdDecompress( int64_t skip, char* buffer, int64_t length )
+{
+    Session& session = *session_;
+    ZSTD_inBuffer& input = session.zin;
+    char discard[windowSize];
+
+    while ( skip > 0 || length > 0 ) {
+        if ( input.pos == input.size ) {
+            input.size = session.readInput();
+            input.pos = 0;
+            if ( input.size == 0 )
+                return false;
+        }
+
+        const bool skipping = ( skip > 0 );
+        ZSTD_outBuffer out = skipping ?
+            ZSTD_outBuffer { discard, (size_t) std::min<int64_t>( skip, windowSize ), 0 } :
+            ZSTD_outBuffer { buffer, (size_t) length, 0 };
+
+        const size_t ret = ZSTD_decompressStream( session.dctx, &out, &input );
+        if ( ZSTD_isError( ret ) )
+            return false;
+
+        session.out += out.pos;
+        if ( skipping ) {
+            skip -= out.pos;
+        }
+        else {
+            buffer += out.pos;
+            length -= out.pos;
+        }
+    }
+
+    return true;
+}
+
+#else
+
+bool CompressedFile::zstdDecompressAll( const Consumer& )
+{
+    return false;
+}
+
+bool CompressedFile::zstdStartSession( const Checkpoint& )
+{
+    return false;
+}
+
+bool CompressedFile::zstdDecompress( int64_t, char*, int64_t )
+{
+    return false;
+}
+
+#endif
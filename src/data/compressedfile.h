@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSEDFILE_H
+#define COMPRESSEDFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "readthroughfile.h"
+
+// Reads a compressed file as if it was decompressed, with random access.
+// The file is first decompressed from the start (while it is indexed),
+// checkpoints being recorded every checkpointSpacing bytes of output:
+//  - for gzip, the state of the decompressor at the end of a deflate
+//    block (the bit offset and the last 32 KiB output, as zlib's zran
+//    example does),
+//  - for zstd, the start of the frames (so a file made of a single
+//    frame can only be read from its start).
+// A read then decompresses from the nearest checkpoint before it, or
+// goes on from where the previous read ended if it is closer (the
+// search reads the lines in order).
+// gzip needs GLOGG_SUPPORTS_GZIP and zstd GLOGG_SUPPORTS_ZSTD.
+// This class is reentrant (not thread-safe).
+class CompressedFile : public ReadThroughFile
+{
+  public:
+    enum class Format { Uncompressed, Gzip, Zstd };
+
+    // Returns the format of the passed file, from its first bytes
+    static Format detectFormat( const std::string& fileName );
+    // Returns whether glogg can decompress the passed format
+    static bool isSupported( Format format );
+
+    CompressedFile( const std::string& fileName, Format format );
+    ~CompressedFile();
+
+    // Decompress the whole file, passing the data to the consumer
+    // (with the position in the compressed file) and recording the
+    // checkpoints.
+    // Returns false on error or if the consumer stopped.
+    bool readAll( const Consumer& consumer ) override;
+
+    // Copy length bytes of decompressed data from position to buffer
+    // (the data must have been decompressed once).
+    // Returns false if they cannot be read.
+    bool read( int64_t position, char* buffer, int64_t length ) override;
+
+    // Returns the size of the decompressed data
+    int64_t size() const override { return size_; }
+    // Returns the size of the compressed file
+    int64_t sourceSize() const override { return sourceSize_; }
+
+    // Decompressed bytes between two checkpoints (4 MiB)
+    static const int64_t checkpointSpacing;
+
+  private:
+    // Where the decompression can start from
+    struct Checkpoint {
+        // Position in the decompressed data
+        int64_t out;
+        // Position in the compressed file
+        int64_t in;
+        // gzip: number of bits of the byte before 'in' still to be
+        // read, -1 at the start of a member (before its header)
+        int bits;
+        // gzip: the last 32 KiB of data before 'out'
+        std::vector<unsigned char> window;
+    };
+    // The decompressor state, defined with the libraries used
+    struct Session;
+
+    // The implementation for each format (failing if not supported)
+    bool gzipDecompressAll( const Consumer& consumer );
+    bool zstdDecompressAll( const Consumer& consumer );
+    // Start decompressing from the passed checkpoint
+    bool gzipStartSession( const Checkpoint& checkpoint );
+    bool zstdStartSession( const Checkpoint& checkpoint );
+    // Decompress skip bytes then length bytes to buffer
+    bool gzipDecompress( int64_t skip, char* buffer, int64_t length );
+    bool zstdDecompress( int64_t skip, char* buffer, int64_t length );
+
+    const std::string fileName_;
+    const Format format_;
+    int64_t size_;
+    int64_t sourceSize_;
+    std::vector<Checkpoint> checkpoints_;
+    // Reading state, kept between the reads
+    std::unique_ptr<Session> session_;
+
+    CompressedFile( const CompressedFile& ) = delete;
+    CompressedFile& operator=( const CompressedFile& ) = delete;
+};
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compressedlinestorage.h"
+
+#include <limits>
+
+#include "spillfile.h"
+
+CompressedLinePositionStorage::CompressedLinePositionStorage()
+    : blocks_(), pool16_(), pool32_(), pool64_(), current_(),
+    spillFile_(), spilled16_( nullptr ), spilled32_( nullptr ),
+    spilled64_( nullptr ), spilledSize16_( 0 ), spilledSize32_( 0 ),
+    spilledSize64_( 0 )
+{
+    current_.reserve( BLOCK_SIZE );
+}
+
+void CompressedLinePositionStorage::append( qint64 pos )
+{
+    current_.push_back( pos );
+
+    if ( current_.size() == BLOCK_SIZE )
+        compressCurrent();
+}
+
+void CompressedLinePositionStorage::append(
+        const CompressedLinePositionStorage& other )
+{
+    const qint64 other_size = other.size();
+    for ( qint64 i = 0; i < other_size; i++ )
+        append( other.at( i ) );
+}
+
+void CompressedLinePositionStorage::pop_back()
+{
+    if ( current_.empty() ) {
+        // Decompress the last block so we can remove from it
+        if ( blocks_.empty() )
+            return;
+
+        unspill();
+        const Block block = blocks_.back();
+        const qint64 last_position = size();
+        for ( qint64 i = last_position - BLOCK_SIZE; i < last_position; i++ )
+            current_.push_back( at( i ) );
+
+        // The last block is always at the end of its pool
+        switch ( block.width ) {
+            case 2: pool16_.resize( block.offset ); break;
+            case 4: pool32_.resize( block.offset ); break;
+            default: pool64_.resize( block.offset ); break;
+        }
+        blocks_.pop_back();
+    }
+
+    current_.pop_back();
+}
+
+qint64 CompressedLinePositionStorage::at( qint64 index ) const
+{
+    const size_t block_index = index / BLOCK_SIZE;
+    const size_t index_in_block = index % BLOCK_SIZE;
+
+    if ( block_index == blocks_.size() )
+        return current_[index_in_block];
+
+    const Block& block = blocks_[block_index];
+    const size_t offset = block.offset + index_in_block;
+    switch ( block.width ) {
+        case 2:
+            return block.base +
+                ( spillFile_ ? spilled16_[offset] : pool16_[offset] );
+        case 4:
+            return block.base +
+                ( spillFile_ ? spilled32_[offset] : pool32_[offset] );
+        default:
+            return block.base +
+                ( spillFile_ ? spilled64_[offset] : pool64_[offset] );
+    }
+}
+
+size_t CompressedLinePositionStorage::allocatedSize() const
+{
+    return blocks_.capacity() * sizeof( Block )
+        + pool16_.capacity() * sizeof( uint16_t )
+        + pool32_.capacity() * sizeof( uint32_t )
+        + pool64_.capacity() * sizeof( qint64 )
+        + current_.capacity() * sizeof( qint64 );
+}
+
+bool CompressedLinePositionStorage::spill(
+        CompressedLinePositionStorage* spilled ) const
+{
+    if ( isSpilled() || blocks_.empty() ) {
+        *spilled = *this;
+        return true;
+    }
+
+    std::shared_ptr<SpillFile> file = std::make_shared<SpillFile>();
+    const qint64 offset16 = file->append( pool16_.data(),
+            pool16_.size() * sizeof( uint16_t ) );
+    const qint64 offset32 = file->append( pool32_.data(),
+            pool32_.size() * sizeof( uint32_t ) );
+    const qint64 offset64 = file->append( pool64_.data(),
+            pool64_.size() * sizeof( qint64 ) );
+    if ( offset16 < 0 || offset32 < 0 || offset64 < 0 || ! file->map() )
+        return false;
+
+    CompressedLinePositionStorage copy;
+    copy.blocks_  = blocks_;
+    copy.current_ = current_;
+    copy.spilled16_ = reinterpret_cast<const uint16_t*>( file->data( offset16 ) );
+    copy.spilled32_ = reinterpret_cast<const uint32_t*>( file->data( offset32 ) );
+    copy.spilled64_ = reinterpret_cast<const qint64*>( file->data( offset64 ) );
+    copy.spilledSize16_ = pool16_.size();
+    copy.spilledSize32_ = pool32_.size();
+    copy.spilledSize64_ = pool64_.size();
+    copy.spillFile_ = file;
+    *spilled = std::move( copy );
+
+    return true;
+}
+
+void CompressedLinePositionStorage::unspill()
+{
+    if ( ! spillFile_ )
+        return;
+
+    pool16_.assign( spilled16_, spilled16_ + spilledSize16_ );
+    pool32_.assign( spilled32_, spilled32_ + spilledSize32_ );
+    pool64_.assign( spilled64_, spilled64_ + spilledSize64_ );
+    spillFile_.reset();
+}
+
+void CompressedLinePositionStorage::compressCurrent()
+{
+    unspill();
+
+    Block block;
+    block.base = current_.front();
+
+    const qint64 span = current_.back() - block.base;
+    if ( span <= std::numeric_limits<uint16_t>::max() ) {
+        block.width  = 2;
+        block.offset = pool16_.size();
+        for ( const qint64 pos : current_ )
+            pool16_.push_back( static_cast<uint16_t>( pos - block.base ) );
+    }
+    else if ( span <= std::numeric_limits<uint32_t>::max() ) {
+        block.width  = 4;
+        block.offset = pool32_.size();
+        for ( const qint64 pos : current_ )
+            pool32_.push_back( static_cast<uint32_t>( pos - block.base ) );
+    }
+    else {
+        block.width  = 8;
+        block.offset = pool64_.size();
+        for ( const qint64 pos : current_ )
+            pool64_.push_back( pos - block.base );
+    }
+
+    blocks_.push_back( block );
+    current_.clear();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSEDLINESTORAGE_H
+#define COMPRESSEDLINESTORAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <QtGlobal>
+
+class SpillFile;
+
+// Space efficient storage for the (increasing) list of line positions
+// of a file.
+// Positions are grouped in blocks of BLOCK_SIZE lines, each block storing
+// a 64 bits base and the offset of each line from it, using the smallest
+// integer type able to hold the largest offset (typically 16 bits).
+// Random access is O(1), the last (incomplete) block is kept
+// uncompressed until it is full.
+// The compressed positions can be spilled to a temporary file mapped
+// in memory (see SpillFile), they are brought back in memory if the
+// storage is changed then.
+class CompressedLinePositionStorage
+{
+  public:
+    // Number of lines per block
+    static const int BLOCK_SIZE = 128;
+
+    CompressedLinePositionStorage();
+
+    // Append the position of a line (must be greater than the last one)
+    void append( qint64 pos );
+    // Append all the positions in the passed storage
+    void append( const CompressedLinePositionStorage& other );
+    // Remove the last position
+    void pop_back();
+
+    // Number of line positions stored
+    qint64 size() const
+    { return blocks_.size() * BLOCK_SIZE + current_.size(); }
+    // Extract an element
+    qint64 at( qint64 index ) const;
+
+    // Approximate memory used (not counting the positions spilled),
+    // in bytes
+    size_t allocatedSize() const;
+
+    // Copy the storage to *spilled, its compressed positions being kept
+    // in a spill file rather than in memory. Returns false (*spilled
+    // being unchanged) if the file cannot be written.
+    bool spill( CompressedLinePositionStorage* spilled ) const;
+    // Whether the compressed positions are in a spill file
+    bool isSpilled() const { return spillFile_ != nullptr; }
+
+  private:
+    struct Block {
+        qint64 base;
+        // Size of each offset (2, 4 or 8 bytes)
+        uint8_t width;
+        // Start of the offsets in the pool of the corresponding width
+        size_t offset;
+    };
+
+    // Compress current_ as a new block
+    void compressCurrent();
+    // Bring the spilled positions back in the pools (before a change)
+    void unspill();
+
+    std::vector<Block> blocks_;
+    std::vector<uint16_t> pool16_;
+    std::vector<uint32_t> pool32_;
+    std::vector<qint64> pool64_;
+    // Positions of the last, incomplete block
+    std::vector<qint64> current_;
+
+    // Set if the pools are spilled, in its mapping
+    std::shared_ptr<const SpillFile> spillFile_;
+    const uint16_t* spilled16_;
+    const uint32_t* spilled32_;
+    const qint64* spilled64_;
+    size_t spilledSize16_;
+    size_t spilledSize32_;
+    size_t spilledSize64_;
+};
+
+#endif
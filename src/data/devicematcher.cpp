@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "log.h"
+
+#include "devicematcher.h"
+#include "literalprefilter.h"
+
+#ifdef GLOGG_SUPPORTS_OPENCL
+#  define CL_TARGET_OPENCL_VERSION 120
+#  ifdef __APPLE__
+#    include <OpenCL/opencl.h>
+#  else
+#    include <CL/cl.h>
+#  endif
+#endif
+
+// Below this, the transfer to the device costs more than it saves
+const qint64 DeviceMatcher::minimumSize = 1024*1024;
+const size_t DeviceMatcher::maximumLiteralLength = 256;
+
+DeviceMatcher& DeviceMatcher::instance()
+{
+    static DeviceMatcher matcher;
+    return matcher;
+}
+
+bool DeviceMatcher::isAvailable() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return device_ != nullptr;
+}
+
+bool DeviceMatcher::qualifies( const LiteralPrefilter& prefilter,
+        qint64 size ) const
+{
+    // An occurrence of the literal must be within a line
+    return size >= minimumSize
+        && prefilter.isValid()
+        && prefilter.literal().size() <= maximumLiteralLength
+        && prefilter.literal().find( '\n' ) == std::string::npos
+        && isAvailable();
+}
+
+#ifdef GLOGG_SUPPORTS_OPENCL
+
+namespace {
+
+// Each work item looks for the literal at one position of the data,
+// marking the line it is in if it is found there.
+const char* kernelSource =
+"__kernel void findLiteral( __global const uchar* data, uint size,\n"
+"        __global const uchar* literal, uint length, uint foldCase,\n"
+"        __global const int* lineEnds, uint nbLines,\n"
+"        __global uchar* found )\n"
+"{\n"
+"    const uint i = get_global_id( 0 );\n"
+"    if ( i + length > size )\n"
+"        return;\n"
+"    for ( uint j = 0; j < length; j++ ) {\n"
+"        uchar c = data[i + j];\n"
+"        if ( foldCase && c >= 'A' && c <= 'Z' )\n"
+"            c += 'a' - 'A';\n"
+"        if ( c != literal[j] )\n"
+"            return;\n"
+"    }\n"
+"    // The line is the first one ending after the occurrence\n"
+"    uint low = 0;\n"
+"    uint high = nbLines;\n"
+"    while ( low < high ) {\n"
+"        const uint middle = ( low + high ) / 2;\n"
+"        if ( lineEnds[middle] < (int) i )\n"
+"            low = middle + 1;\n"
+"        else\n"
+"            high = middle;\n"
+"    }\n"
+"    if ( low < nbLines )\n"
+"        found[low] = 1;\n"
+"}\n";
+
+}
+
+struct DeviceMatcher::Device {
+    Device() : context( nullptr ), queue( nullptr ),
+        program( nullptr ), kernel( nullptr ) {}
+
+    ~Device()
+    {
+        if ( kernel )
+            clReleaseKernel( kernel );
+        if ( program )
+            clReleaseProgram( program );
+        if ( queue )
+            clReleaseCommandQueue( queue );
+        if ( context )
+            clReleaseContext( context );
+    }
+
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel kernel;
+};
+
+DeviceMatcher::DeviceMatcher() : mutex_(), device_()
+{
+    cl_uint nb_platforms = 0;
+    if ( clGetPlatformIDs( 0, nullptr, &nb_platforms ) != CL_SUCCESS
+            || nb_platforms == 0 ) {
+        LOG(logINFO) << "DeviceMatcher: no OpenCL platform";
+        return;
+    }
+
+    std::vector<cl_platform_id> platforms( nb_platforms );
+    clGetPlatformIDs( nb_platforms, platforms.data(), nullptr );
+
+    // The first GPU found (a CPU device would not beat our own threads)
+    cl_device_id device_id = nullptr;
+    for ( cl_platform_id platform : platforms ) {
+        if ( clGetDeviceIDs( platform, CL_DEVICE_TYPE_GPU, 1,
+                    &device_id, nullptr ) == CL_SUCCESS )
+            break;
+        device_id = nullptr;
+    }
+    if ( ! device_id ) {
+        LOG(logINFO) << "DeviceMatcher: no OpenCL GPU";
+        return;
+    }
+
+    std::unique_ptr<Device> device( new Device() );
+    cl_int error = CL_SUCCESS;
+    device->context = clCreateContext( nullptr, 1, &device_id,
+            nullptr, nullptr, &error );
+    if ( error == CL_SUCCESS )
+        device->queue = clCreateCommandQueue( device->context, device_id,
+                0, &error );
+    if ( error == CL_SUCCESS )
+        device->program = clCreateProgramWithSource( device->context, 1,
+                &kernelSource, nullptr, &error );
+    if ( error == CL_SUCCESS )
+        error = clBuildProgram( device->program, 1, &device_id,
+                nullptr, nullptr, nullptr );
+    if ( error == CL_SUCCESS )
+        device->kernel = clCreateKernel( device->program, "findLiteral", &error );
+
+    if ( error != CL_SUCCESS ) {
+        LOG(logWARNING) << "DeviceMatcher: cannot set up the GPU (OpenCL error "
+            << error << ")";
+        return;
+    }
+
+    char name[256] = "";
+    clGetDeviceInfo( device_id, CL_DEVICE_NAME, sizeof name, name, nullptr );
+    LOG(logINFO) << "DeviceMatcher: searching on " << name;
+
+    device_ = std::move( device );
+}
+
+DeviceMatcher::~DeviceMatcher()
+{
+}
+
+bool DeviceMatcher::findLines( const LiteralPrefilter& prefilter,
+        const char* data, int size, const std::vector<int>& lineEnds,
+        QBitArray* candidates )
+{
+    const std::string& literal = prefilter.literal();
+    const int nb_lines = lineEnds.size();
+
+    candidates->fill( false, nb_lines );
+    if ( nb_lines == 0 || size < (int) literal.size() )
+        return true;
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+    if ( ! device_ )
+        return false;
+
+    std::vector<cl_uchar> found( nb_lines, 0 );
+    const cl_uint length = literal.size();
+    const cl_uint fold_case = prefilter.isCaseInsensitive();
+    const cl_uint data_size = size;
+    const cl_uint nb_lines_arg = nb_lines;
+
+    // The buffers are copied from the host, the device may be a
+    // discrete one
+    cl_int error = CL_SUCCESS;
+    const cl_mem_flags in = CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR;
+    cl_mem buffers[4] = { nullptr, nullptr, nullptr, nullptr };
+    buffers[0] = clCreateBuffer( device_->context, in, size,
+            const_cast<char*>( data ), &error );
+    if ( error == CL_SUCCESS )
+        buffers[1] = clCreateBuffer( device_->context, in, length,
+                const_cast<char*>( literal.data() ), &error );
+    if ( error == CL_SUCCESS )
+        buffers[2] = clCreateBuffer( device_->context, in,
+                nb_lines * sizeof( cl_int ),
+                const_cast<int*>( lineEnds.data() ), &error );
+    if ( error == CL_SUCCESS )
+        buffers[3] = clCreateBuffer( device_->context,
+                CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                nb_lines, found.data(), &error );
+
+    cl_kernel kernel = device_->kernel;
+    if ( error == CL_SUCCESS ) {
+        clSetKernelArg( kernel, 0, sizeof( cl_mem ), &buffers[0] );
+        clSetKernelArg( kernel, 1, sizeof( cl_uint ), &data_size );
+        clSetKernelArg( kernel, 2, sizeof( cl_mem ), &buffers[1] );
+        clSetKernelArg( kernel, 3, sizeof( cl_uint ), &length );
+        clSetKernelArg( kernel, 4, sizeof( cl_uint ), &fold_case );
+        clSetKernelArg( kernel, 5, sizeof( cl_mem ), &buffers[2] );
+        clSetKernelArg( kernel, 6, sizeof( cl_uint ), &nb_lines_arg );
+        error = clSetKernelArg( kernel, 7, sizeof( cl_mem ), &buffers[3] );
+    }
+    if ( error == CL_SUCCESS ) {
+        const size_t nb_positions = size - length + 1;
+        error = clEnqueueNDRangeKernel( device_->queue, kernel, 1, nullptr,
+                &nb_positions, nullptr, 0, nullptr, nullptr );
+    }
+    if ( error == CL_SUCCESS )
+        error = clEnqueueReadBuffer( device_->queue, buffers[3], CL_TRUE,
+                0, nb_lines, found.data(), 0, nullptr, nullptr );
+
+    for ( cl_mem buffer : buffers ) {
+        if ( buffer )
+            clReleaseMemObject( buffer );
+    }
+
+    if ( error != CL_SUCCESS ) {
+        // Most likely out of memory on the device, which would
+        // not get better
+        LOG(logWARNING) << "DeviceMatcher: search failed (OpenCL error "
+            << error << "), searching on the CPU from now on";
+        device_.reset();
+        return false;
+    }
+
+    for ( int j = 0; j < nb_lines; j++ ) {
+        if ( found[j] )
+            candidates->setBit( j );
+    }
+
+    return true;
+}
+
+#else
+
+struct DeviceMatcher::Device {
+};
+
+DeviceMatcher::DeviceMatcher() : mutex_(), device_()
+{
+}
+
+DeviceMatcher::~DeviceMatcher()
+{
+}
+
+bool DeviceMatcher::findLines( const LiteralPrefilter&,
+        const char*, int, const std::vector<int>&, QBitArray* )
+{
+    return false;
+}
+
+#endif
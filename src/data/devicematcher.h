@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEVICEMATCHER_H
+#define DEVICEMATCHER_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QBitArray>
+#include <QtGlobal>
+
+class LiteralPrefilter;
+
+// Finds the lines containing the literal of a search pattern (see
+// LiteralPrefilter) on a compute device (a GPU, through OpenCL), to
+// search the largest files faster than the CPU threads would.
+// The lines found are exactly those matching a FixedString pattern, and
+// the candidates for the regexps having a literal (which must then be
+// matched on them).
+// This uses OpenCL when glogg is built with GLOGG_SUPPORTS_OPENCL and
+// a GPU is found, otherwise the device is never available and the
+// caller must search the lines itself.
+// It is thread safe, the searches being queued to the device one at
+// a time.
+class DeviceMatcher
+{
+  public:
+    // Returns the matcher, looking for a device the first time
+    static DeviceMatcher& instance();
+
+    ~DeviceMatcher();
+
+    // Returns whether a device has been found (and has not failed)
+    bool isAvailable() const;
+
+    // Returns whether the literal of the prefilter is worth looking for
+    // on the device in size bytes, i.e. a device is available, the
+    // literal can be found there and the data is large enough for the
+    // transfer to pay off.
+    bool qualifies( const LiteralPrefilter& prefilter, qint64 size ) const;
+
+    // Set the bit j of candidates if the literal of the prefilter is in
+    // the line j of data (of size bytes), lineEnds being the offset of
+    // the end of each line (as returned by AbstractLogData::getRawLines).
+    // Returns false if the device failed (candidates are then undefined,
+    // and the device not used again).
+    bool findLines( const LiteralPrefilter& prefilter,
+            const char* data, int size, const std::vector<int>& lineEnds,
+            QBitArray* candidates );
+
+    // Smallest data worth sending to the device, in bytes
+    static const qint64 minimumSize;
+    // Longest literal the device looks for
+    static const size_t maximumLiteralLength;
+
+  private:
+    struct Device;
+
+    DeviceMatcher();
+
+    mutable std::mutex mutex_;
+    std::unique_ptr<Device> device_;
+
+    DeviceMatcher( const DeviceMatcher& ) = delete;
+    DeviceMatcher& operator=( const DeviceMatcher& ) = delete;
+};
+
+#endif
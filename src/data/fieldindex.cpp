@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fieldindex.h"
+
+#include <cstring>
+
+#include "log.h"
+
+#include "abstractlogdata.h"
+
+const int FieldIndex::nbLinesInChunk = 5000;
+
+namespace {
+
+bool isNameCharacter( char c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' )
+        || ( c >= '0' && c <= '9' ) || c == '_' || c == '.' || c == '-';
+}
+
+const char* skipSpaces( const char* data, const char* end )
+{
+    while ( data < end && ( *data == ' ' || *data == '\t' ) )
+        data++;
+
+    return data;
+}
+
+}
+
+FieldIndex::FieldIndex() : mutex_(), names_(), columns_(), generation_( 0 )
+{
+}
+
+void FieldIndex::setFields( const QStringList& names )
+{
+    QMutexLocker locker( &mutex_ );
+
+    names_.clear();
+    for ( const QString& name : names )
+        names_.push_back( name.toUtf8() );
+    columns_.assign( names_.size(), Column() );
+    generation_++;
+}
+
+int FieldIndex::fieldOfTerm( const QRegExp& term, QString* value ) const
+{
+    const QString pattern = term.pattern();
+    const int equal = pattern.indexOf( QLatin1Char( '=' ) );
+    if ( equal <= 0 )
+        return -1;
+
+    *value = pattern.mid( equal + 1 );
+    if ( value->isEmpty() || QRegExp::escape( *value ) != *value )
+        return -1;
+
+    QMutexLocker locker( &mutex_ );
+
+    const QByteArray name = pattern.left( equal ).toUtf8();
+    for ( size_t i = 0; i < names_.size(); i++ ) {
+        if ( names_[i] == name )
+            return i;
+    }
+
+    return -1;
+}
+
+void FieldIndex::update( const AbstractLogData* source, LineNumber nbLines,
+        const std::atomic<bool>* interruptRequest )
+{
+    std::vector<QByteArray> names;
+    LineNumber first;
+    int generation;
+    {
+        QMutexLocker locker( &mutex_ );
+
+        if ( names_.empty() )
+            return;
+
+        names = names_;
+        first = columns_.front().codes.size();
+        // The last line might have been updated (if it was not LF-terminated)
+        if ( first >= 1 )
+            first--;
+        generation = generation_;
+    }
+
+    LOG(logDEBUG) << "Extracting the fields of lines " << first
+        << " to " << nbLines;
+
+    // The values of the fields of each line of a chunk
+    std::vector<std::vector<QByteArray>> values( names.size() );
+    std::vector<std::vector<char>> found( names.size() );
+
+    for ( LineNumber i = first; i < nbLines; i += nbLinesInChunk ) {
+        if ( *interruptRequest )
+            return;
+
+        const int number = qMin<LineNumber>( nbLinesInChunk, nbLines - i );
+        std::vector<int> lineEnds;
+        const QByteArray blob = source->getRawLines( i, number, &lineEnds );
+
+        for ( size_t f = 0; f < names.size(); f++ ) {
+            values[f].clear();
+            found[f].clear();
+        }
+        for ( size_t j = 0; j < lineEnds.size(); j++ ) {
+            const int beginning = ( j == 0 ) ? 0 : lineEnds[j-1] + 1;
+            for ( size_t f = 0; f < names.size(); f++ ) {
+                QByteArray value;
+                found[f].push_back( fieldValue( blob.constData() + beginning,
+                        lineEnds[j] - beginning, names[f], &value ) );
+                values[f].push_back( value );
+            }
+        }
+
+        QMutexLocker locker( &mutex_ );
+
+        // The lines have been forgotten meanwhile
+        if ( generation != generation_ )
+            return;
+
+        for ( size_t f = 0; f < names.size(); f++ ) {
+            Column& column = columns_[f];
+            column.codes.resize( i );
+            for ( size_t j = 0; j < values[f].size(); j++ ) {
+                const QByteArray& value = values[f][j];
+                uint32_t code = 0;
+                if ( found[f][j] ) {
+                    code = column.dictionary.value( value, 0 );
+                    if ( code == 0 ) {
+                        column.values.push_back( value );
+                        code = column.values.size();
+                        column.dictionary.insert( value, code );
+                    }
+                }
+                column.codes.push_back( code );
+            }
+        }
+
+        // The data might have been truncated
+        if ( (int) lineEnds.size() < number )
+            break;
+    }
+}
+
+MatchSet FieldIndex::find( int field, const QString& value,
+        Qt::CaseSensitivity caseSensitivity, LineNumber nbLines ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    // The fields might have been changed meanwhile
+    if ( field >= (int) columns_.size() )
+        return MatchSet();
+
+    const Column& column = columns_[field];
+
+    // The codes of the values looked for
+    std::vector<char> wanted( column.values.size() + 1, false );
+    if ( caseSensitivity == Qt::CaseSensitive ) {
+        wanted[ column.dictionary.value( value.toUtf8(), 0 ) ] = true;
+    }
+    else {
+        for ( size_t i = 0; i < column.values.size(); i++ ) {
+            if ( QString::fromUtf8( column.values[i] ).compare(
+                        value, Qt::CaseInsensitive ) == 0 )
+                wanted[i + 1] = true;
+        }
+    }
+    wanted[0] = false;
+
+    MatchSet lines;
+    const LineNumber end = qMin<LineNumber>( nbLines, column.codes.size() );
+    for ( LineNumber line = 0; line < end; line++ ) {
+        if ( wanted[ column.codes[line] ] )
+            lines.append( line );
+    }
+
+    return lines;
+}
+
+void FieldIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    columns_.assign( names_.size(), Column() );
+    generation_++;
+}
+
+void FieldIndex::truncate( LineNumber nbLines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( Column& column : columns_ ) {
+        if ( column.codes.size() > nbLines )
+            column.codes.resize( nbLines );
+    }
+    generation_++;
+}
+
+bool FieldIndex::fieldValue( const char* line, int length,
+        const QByteArray& name, QByteArray* value )
+{
+    const char* const end = line + length;
+    const int name_length = name.size();
+    if ( name_length == 0 )
+        return false;
+
+    for ( const char* p = line; end - p > name_length; p++ ) {
+        p = static_cast<const char*>(
+                memchr( p, name[0], end - p - name_length ) );
+        if ( ! p )
+            return false;
+        if ( memcmp( p, name.constData(), name_length ) != 0 )
+            continue;
+
+        const char before = ( p == line ) ? ' ' : p[-1];
+        const char* data = p + name_length;
+        if ( before == '"' && *data == '"' ) {
+            // JSON member
+            data = skipSpaces( data + 1, end );
+            if ( data == end || *data != ':' )
+                continue;
+            data = skipSpaces( data + 1, end );
+        }
+        else if ( ! isNameCharacter( before ) && before != '"' && *data == '=' ) {
+            data++;
+        }
+        else {
+            continue;
+        }
+
+        const char* value_end;
+        if ( data < end && *data == '"' ) {
+            // Up to the closing quote (escaped quotes being skipped)
+            value_end = ++data;
+            while ( value_end < end && *value_end != '"' )
+                value_end += ( *value_end == '\\' && value_end + 1 < end ) ? 2 : 1;
+        }
+        else {
+            value_end = data;
+            while ( value_end < end && ! strchr( " \t,;{}[]", *value_end ) )
+                value_end++;
+        }
+
+        *value = QByteArray( data, value_end - data );
+        return true;
+    }
+
+    return false;
+}
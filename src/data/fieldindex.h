@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIELDINDEX_H
+#define FIELDINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QRegExp>
+#include <QStringList>
+
+#include "matchset.h"
+
+class AbstractLogData;
+
+// The values of some fields of the lines of a log (such as the level or
+// the thread), kept so a query term on a field's value is answered
+// without matching a regular expression over each line.
+// A field is found in a line written either name=value (the value
+// ending at a space, comma, semicolon or brace unless double quoted) or
+// as a JSON member "name": value, its first occurrence being used.
+// Each field is stored as a column of one code per line, the code being
+// the index (plus one) of the value in the dictionary of the distinct
+// values of the field, 0 if the line does not have the field.
+// The fields of the lines are extracted on demand, as they are
+// searched, from the raw (UTF-8) data.
+// It is thread safe.
+class FieldIndex
+{
+  public:
+    FieldIndex();
+
+    // Sets the names of the fields to extract, the lines being
+    // extracted again.
+    void setFields( const QStringList& names );
+
+    // Returns the index of the field the passed query term searches
+    // the value of, -1 if it is not such a term, that is written
+    // name=value, name being one of the fields and value a literal
+    // (no regular expression special character).
+    int fieldOfTerm( const QRegExp& term, QString* value ) const;
+
+    // Extract the fields of the lines of source not extracted yet (the
+    // last line extracted is extracted again, in case it was not LF
+    // terminated), up to nbLines.
+    // Stops if interrupted, the lines done being kept.
+    void update( const AbstractLogData* source, LineNumber nbLines,
+            const std::atomic<bool>* interruptRequest );
+    // Returns the lines, among the nbLines first ones, whose field has
+    // the passed value (they must have been extracted).
+    MatchSet find( int field, const QString& value,
+            Qt::CaseSensitivity caseSensitivity, LineNumber nbLines ) const;
+
+    // Forget the lines extracted (the file has changed)
+    void clear();
+    // Forget the lines from the passed line on (the end of the file
+    // has changed)
+    void truncate( LineNumber nbLines );
+
+    // Sets value to the value of the passed field in the line,
+    // returns false if the line does not have the field.
+    static bool fieldValue( const char* line, int length,
+            const QByteArray& name, QByteArray* value );
+
+  private:
+    struct Column {
+        Column() : codes(), values(), dictionary() {}
+
+        std::vector<uint32_t> codes;
+        std::vector<QByteArray> values;
+        QHash<QByteArray, uint32_t> dictionary;
+    };
+
+    // Number of lines read from the source at once
+    static const int nbLinesInChunk;
+
+    mutable QMutex mutex_;
+    std::vector<QByteArray> names_;
+    std::vector<Column> columns_;
+    // Changed each time lines extracted are forgotten, so the
+    // extraction in progress is not added
+    int generation_;
+};
+
+#endif
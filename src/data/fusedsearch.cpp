@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements FusedSearch
+
+#include "fusedsearch.h"
+
+#include <QMutexLocker>
+
+FusedSearch::FusedSearch( const QRegExp& regexp )
+    : regexp_( regexp ), matcher_( { regexp } ), mutex_(), matches_(),
+    nbLines_( 0 ), maxLength_( 0 ), complete_( false )
+{
+}
+
+void FusedSearch::Scan::matchLines( const char* data, int size,
+        const std::vector<int>& lineEnds )
+{
+    if ( lineEnds.empty() )
+        return;
+
+    matcher_.matchLines( data, size, lineEnds, &buffers_, &maxLength_ );
+
+    const QBitArray& bits = buffers_.matches.front();
+    for ( int i = 0; i < bits.size(); i++ ) {
+        if ( bits.testBit( i ) )
+            matches_.push_back( nbLines_ + i );
+    }
+    nbLines_ += lineEnds.size();
+}
+
+void FusedSearch::restart()
+{
+    QMutexLocker locker( &mutex_ );
+
+    matches_.clear();
+    nbLines_ = 0;
+    maxLength_ = 0;
+    complete_ = false;
+}
+
+void FusedSearch::append( Scan& scan )
+{
+    {
+        QMutexLocker locker( &mutex_ );
+
+        for ( LineNumber line : scan.matches_ )
+            matches_.append( nbLines_ + line );
+        nbLines_ += scan.nbLines_;
+        maxLength_ = qMax( maxLength_, scan.maxLength_ );
+    }
+
+    scan.matches_.clear();
+    scan.nbLines_ = 0;
+    scan.maxLength_ = 0;
+}
+
+void FusedSearch::complete()
+{
+    QMutexLocker locker( &mutex_ );
+
+    complete_ = true;
+}
+
+bool FusedSearch::isComplete() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return complete_;
+}
+
+void FusedSearch::abandon()
+{
+    QMutexLocker locker( &mutex_ );
+
+    matches_.clear();
+    nbLines_ = 0;
+    maxLength_ = 0;
+    complete_ = false;
+}
+
+void FusedSearch::truncate( LineNumber nbLines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    while ( ! matches_.empty() && matches_.last() >= nbLines )
+        matches_.removeLast();
+    nbLines_ = qMin( nbLines_, nbLines );
+    // (the longest line might be gone)
+    maxLength_ = -1;
+}
+
+bool FusedSearch::find( const QRegExp& regexp, MatchSet* matches,
+        LineNumber* nbLines, int* maxLength ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( ! complete_ || regexp != regexp_ )
+        return false;
+
+    *matches = matches_;
+    *nbLines = nbLines_;
+    *maxLength = maxLength_;
+
+    return true;
+}
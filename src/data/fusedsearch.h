@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FUSEDSEARCH_H
+#define FUSEDSEARCH_H
+
+#include <vector>
+
+#include <QBitArray>
+#include <QMutex>
+#include <QRegExp>
+
+#include "matchset.h"
+#include "patternsetmatcher.h"
+
+// The search for a pattern done by the full indexing of a file, on the
+// lines of each block read as soon as they are delimited, so a file
+// opened with a search pending is only read once (see
+// LogData::setFusedSearch).
+// Only the files in UTF-8 (or ASCII) indexed from their start are
+// searched this way. The matches are handed to the first search for
+// the pattern once the indexing has succeeded (see FullSearchOperation),
+// and forgotten if the file is indexed again from its start.
+// It is thread safe.
+class FusedSearch
+{
+  public:
+    explicit FusedSearch( const QRegExp& regexp );
+
+    const QRegExp& regexp() const { return regexp_; }
+
+    // The matches in a range of lines, found by one of the threads of
+    // the indexing, numbered from the first line of the range.
+    class Scan {
+      public:
+        explicit Scan( const FusedSearch& search )
+            : matcher_( search.matcher_ ), buffers_(), matches_(),
+            nbLines_( 0 ), maxLength_( 0 ) {}
+
+        // Match the lines following the ones matched before, in data
+        // (of size bytes), lineEnds being the offset of the end (LF
+        // excluded) of each one.
+        void matchLines( const char* data, int size,
+                const std::vector<int>& lineEnds );
+
+        // Number of lines matched
+        qint64 nbLines() const { return nbLines_; }
+
+      private:
+        friend class FusedSearch;
+
+        const PatternSetMatcher& matcher_;
+        // (reused for each block of lines)
+        PatternSetMatcher::Buffers buffers_;
+        std::vector<LineNumber> matches_;
+        qint64 nbLines_;
+        int maxLength_;
+    };
+
+    // Start again, for an indexing from the start of the file
+    void restart();
+    // Add the matches of the scan, whose lines follow the ones added
+    // before, then clear it.
+    void append( Scan& scan );
+    // Tells the indexing has succeeded, the matches being complete
+    // up to the lines added.
+    void complete();
+    // Whether complete() has been called since the last restart
+    bool isComplete() const;
+    // Forget the matches (the lines have been indexed again)
+    void abandon();
+    // Forget the matches from the passed line on (the end of the file
+    // has changed)
+    void truncate( LineNumber nbLines );
+
+    // Get the matches of the passed regexp in the lines searched, their
+    // number and the max length of the matching lines.
+    // Returns false if it is not the regexp searched for or the
+    // indexing has not succeeded.
+    bool find( const QRegExp& regexp, MatchSet* matches,
+            LineNumber* nbLines, int* maxLength ) const;
+
+  private:
+    const QRegExp regexp_;
+    const PatternSetMatcher matcher_;
+
+    mutable QMutex mutex_;
+    MatchSet matches_;
+    LineNumber nbLines_;
+    int maxLength_;
+    bool complete_;
+};
+
+#endif
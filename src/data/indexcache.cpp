@@ -0,0 +1,598 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "indexcache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+
+#include "log.h"
+
+#include "logdataworkerthread.h"
+#include "tokenindex.h"
+#include "statestore.h"
+
+namespace {
+    // Identifies glogg's index files
+    const quint32 INDEX_MAGIC = 0x676c6978; // "glix"
+    const quint32 INDEX_VERSION = 1;
+    const quint32 TOKENS_MAGIC = 0x676c746b; // "gltk"
+    // (version 2 has the number of lines in 64 bits)
+    const quint32 TOKENS_VERSION = 2;
+    const quint32 SEARCH_MAGIC = 0x676c7372; // "glsr"
+    const quint32 SEARCH_VERSION = 1;
+
+    // Size of the regions hashed with the fingerprint
+    const int FINGERPRINT_SIZE = 64*1024;
+
+    // Maximum number of files kept in the cache
+    const int MAX_CACHED_FILES = 64;
+
+    // See IndexCache::setSharedDirectory
+    QMutex sharedDirectoryMutex;
+    QString sharedCacheDirectory;
+
+    // Positions are stored as the difference from the previous one,
+    // using a variable number of bytes (7 bits per byte).
+    void appendVarInt( QByteArray& buffer, quint64 value )
+    {
+        while ( value >= 0x80 ) {
+            buffer.append( static_cast<char>( ( value & 0x7F ) | 0x80 ) );
+            value >>= 7;
+        }
+        buffer.append( static_cast<char>( value ) );
+    }
+
+    bool readVarInt( const char*& data, const char* end, quint64* value )
+    {
+        quint64 result = 0;
+        int shift = 0;
+        while ( data < end && shift < 64 ) {
+            const unsigned char byte = static_cast<unsigned char>( *data++ );
+            result |= static_cast<quint64>( byte & 0x7F ) << shift;
+            if ( ( byte & 0x80 ) == 0 ) {
+                *value = result;
+                return true;
+            }
+            shift += 7;
+        }
+
+        return false;
+    }
+}
+
+// Files under 16 MiB are indexed fast enough
+const qint64 IndexCache::minimumFileSize = 16*1024*1024;
+
+IndexCache::IndexCache() : sharedDirectory_( sharedDirectory() )
+{
+#if QT_VERSION >= 0x050000
+    directory_ = QStandardPaths::writableLocation( QStandardPaths::CacheLocation )
+        + "/index";
+#else
+    directory_ = QDir::homePath() + "/.cache/glogg/index";
+#endif
+}
+
+IndexCache::IndexCache( const QString& directory,
+        const QString& sharedDirectory )
+    : directory_( directory ), sharedDirectory_( sharedDirectory )
+{
+}
+
+void IndexCache::setSharedDirectory( const QString& directory )
+{
+    QMutexLocker locker( &sharedDirectoryMutex );
+    sharedCacheDirectory = directory;
+}
+
+QString IndexCache::sharedDirectory()
+{
+    QMutexLocker locker( &sharedDirectoryMutex );
+    return sharedCacheDirectory;
+}
+
+IndexCache::Validity IndexCache::load( const QString& fileName,
+        qint64* size, int* maxLength, LinePositionArray* linePosition ) const
+{
+    QFileInfo info( fileName );
+    if ( info.size() < minimumFileSize )
+        return Invalid;
+
+    Validity validity = loadIndex( cacheFileName( directory_, fileName, ".idx" ),
+            fileName, size, maxLength, linePosition );
+
+    if ( validity != UpToDate && ! sharedDirectory_.isEmpty() ) {
+        qint64 shared_size;
+        int shared_max_length;
+        LinePositionArray shared_position;
+        const Validity shared = loadIndex(
+                cacheFileName( sharedDirectory_, fileName, ".idx" ),
+                fileName, &shared_size, &shared_max_length, &shared_position );
+
+        // Use the shared index if it covers more of the file
+        if ( shared == UpToDate || ( shared == FileGrown
+                    && ( validity == Invalid || shared_size > *size ) ) ) {
+            LOG(logDEBUG) << "Using the shared index of " << fileName.toStdString();
+            *size = shared_size;
+            *maxLength = shared_max_length;
+            *linePosition = shared_position;
+            validity = shared;
+        }
+    }
+
+    return validity;
+}
+
+IndexCache::Validity IndexCache::loadIndex( const QString& cacheName,
+        const QString& fileName, qint64* size, int* maxLength,
+        LinePositionArray* linePosition )
+{
+    QFile file( cacheName );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return Invalid;
+
+    QDataStream in( &file );
+    in.setVersion( QDataStream::Qt_4_6 );
+
+    qint64 cached_size;
+    const Validity validity = readHeader( in, INDEX_MAGIC, INDEX_VERSION,
+            fileName, &cached_size );
+    if ( validity == Invalid )
+        return Invalid;
+
+    qint32 max_length;
+    bool fake_final_lf;
+    QByteArray positions;
+    in >> max_length >> fake_final_lf >> positions;
+
+    if ( in.status() != QDataStream::Ok )
+        return Invalid;
+
+    // Decode the positions, which must be those of lines of the file
+    // (the index might have been written by someone else)
+    LinePositionArray decoded;
+    const char* data = positions.constData();
+    const char* end  = data + positions.size();
+    const qint64 last_position = cached_size + ( fake_final_lf ? 2 : 0 );
+    qint64 position = 0;
+    quint64 delta;
+    while ( data < end ) {
+        if ( ! readVarInt( data, end, &delta ) || delta == 0
+                || delta > quint64( last_position - position ) )
+            return Invalid;
+        position += delta;
+        decoded.append( position );
+    }
+    decoded.setFakeFinalLF( fake_final_lf );
+
+    LOG(logDEBUG) << "Loaded index cache for " << fileName.toStdString()
+        << ": " << decoded.size() << " lines, " << cached_size << " bytes";
+
+    *size = cached_size;
+    *maxLength = max_length;
+    *linePosition = decoded;
+
+    return validity;
+}
+
+void IndexCache::save( const QString& fileName, qint64 size, int maxLength,
+        const LinePositionArray& linePosition ) const
+{
+    QFileInfo info( fileName );
+    // Don't save anything if the file has changed since indexing
+    if ( size < minimumFileSize || info.size() != size )
+        return;
+
+    QByteArray positions;
+    positions.reserve( linePosition.size() * 2 );
+    qint64 previous = 0;
+    for ( qint64 i = 0; i < linePosition.size(); i++ ) {
+        const qint64 position = linePosition.at( i );
+        appendVarInt( positions, position - previous );
+        previous = position;
+    }
+
+    QByteArray data;
+    QDataStream out( &data, QIODevice::WriteOnly );
+    out.setVersion( QDataStream::Qt_4_6 );
+    out << static_cast<qint32>( maxLength ) << linePosition.hasFakeFinalLF()
+        << positions;
+
+    write( fileName, ".idx", INDEX_MAGIC, INDEX_VERSION, size, data );
+
+    LOG(logDEBUG) << "Saved index cache for " << fileName.toStdString();
+}
+
+bool IndexCache::loadTokens( const QString& fileName, TokenIndex* tokens ) const
+{
+    QFileInfo info( fileName );
+    if ( info.size() < minimumFileSize )
+        return false;
+
+    return loadTokenIndex( cacheFileName( directory_, fileName, ".tok" ),
+            fileName, tokens )
+        || ( ! sharedDirectory_.isEmpty() && loadTokenIndex(
+                    cacheFileName( sharedDirectory_, fileName, ".tok" ),
+                    fileName, tokens ) );
+}
+
+bool IndexCache::loadTokenIndex( const QString& cacheName,
+        const QString& fileName, TokenIndex* tokens )
+{
+    QFile file( cacheName );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream in( &file );
+    in.setVersion( QDataStream::Qt_4_6 );
+
+    qint64 cached_size;
+    if ( readHeader( in, TOKENS_MAGIC, TOKENS_VERSION, fileName, &cached_size )
+            == Invalid )
+        return false;
+
+    qint64 nb_lines;
+    quint32 nb_tokens;
+    in >> nb_lines >> nb_tokens;
+
+    // The lines of each token are stored as the difference from the
+    // previous one, as the positions.
+    QHash<QByteArray, MatchSet> postings;
+    for ( quint32 t = 0; t < nb_tokens && in.status() == QDataStream::Ok; t++ ) {
+        QByteArray token, lines;
+        in >> token >> lines;
+
+        MatchSet& decoded = postings[token];
+        const char* data = lines.constData();
+        const char* end  = data + lines.size();
+        quint64 line = 0;
+        quint64 delta;
+        while ( data < end ) {
+            if ( ! readVarInt( data, end, &delta ) )
+                return false;
+            line += delta;
+            if ( line >= quint64( nb_lines )
+                    || ( ! decoded.empty() && line <= decoded.last() ) )
+                return false;
+            decoded.append( line );
+        }
+    }
+
+    if ( in.status() != QDataStream::Ok )
+        return false;
+
+    LOG(logDEBUG) << "Loaded token index for " << fileName.toStdString()
+        << ": " << nb_tokens << " tokens in " << nb_lines << " lines";
+
+    tokens->setPostings( postings, nb_lines );
+
+    return true;
+}
+
+void IndexCache::saveTokens( const QString& fileName, qint64 size,
+        const TokenIndex& tokens ) const
+{
+    QFileInfo info( fileName );
+    // Don't save anything if the file has changed since indexing
+    if ( size < minimumFileSize || info.size() != size )
+        return;
+
+    const QHash<QByteArray, MatchSet> postings = tokens.postings();
+
+    QByteArray data;
+    QDataStream out( &data, QIODevice::WriteOnly );
+    out.setVersion( QDataStream::Qt_4_6 );
+    out << static_cast<qint64>( tokens.nbLines() )
+        << static_cast<quint32>( postings.size() );
+
+    QByteArray lines;
+    for ( auto i = postings.constBegin(); i != postings.constEnd(); ++i ) {
+        lines.clear();
+        LineNumber previous = 0;
+        for ( LineNumber line : i.value() ) {
+            appendVarInt( lines, line - previous );
+            previous = line;
+        }
+        out << i.key() << lines;
+    }
+
+    write( fileName, ".tok", TOKENS_MAGIC, TOKENS_VERSION, size, data );
+
+    LOG(logDEBUG) << "Saved token index for " << fileName.toStdString();
+}
+
+bool IndexCache::loadSearchResults( const QString& fileName,
+        SearchResults* results ) const
+{
+    const QByteArray value = StateStore::instance().value(
+            searchResultsKey( fileName ) );
+    if ( value.isEmpty() )
+        return false;
+
+    QDataStream in( value );
+    in.setVersion( QDataStream::Qt_4_6 );
+
+    qint64 cached_size;
+    if ( readHeader( in, SEARCH_MAGIC, SEARCH_VERSION, fileName, &cached_size )
+            == Invalid )
+        return false;
+
+    QRegExp regexp;
+    qint64 nb_lines;
+    qint32 max_length;
+    QByteArray lines, marks;
+    in >> regexp >> nb_lines >> max_length >> lines >> marks;
+
+    if ( in.status() != QDataStream::Ok || nb_lines < 0 )
+        return false;
+
+    // The lines are stored as the difference from the previous one,
+    // as the tokens.
+    MatchSet decoded;
+    const char* data = lines.constData();
+    const char* end  = data + lines.size();
+    quint64 line = 0;
+    quint64 delta;
+    while ( data < end ) {
+        if ( ! readVarInt( data, end, &delta ) )
+            return false;
+        line += delta;
+        if ( line >= quint64( nb_lines )
+                || ( ! decoded.empty() && line <= decoded.last() ) )
+            return false;
+        decoded.append( line );
+    }
+
+    std::vector<qint64> decoded_marks;
+    data = marks.constData();
+    end  = data + marks.size();
+    line = 0;
+    while ( data < end ) {
+        if ( ! readVarInt( data, end, &delta )
+                || ( ! decoded_marks.empty() && delta == 0 ) )
+            return false;
+        line += delta;
+        decoded_marks.push_back( line );
+    }
+
+    LOG(logDEBUG) << "Loaded search results for " << fileName.toStdString()
+        << ": " << decoded.size() << " matches in " << nb_lines << " lines, "
+        << decoded_marks.size() << " marks";
+
+    results->regexp = regexp;
+    results->nbLines = nb_lines;
+    results->maxLength = max_length;
+    results->matches = decoded;
+    results->marks = decoded_marks;
+
+    return true;
+}
+
+void IndexCache::saveSearchResults( const QString& fileName, qint64 size,
+        const SearchResults& results ) const
+{
+    QFileInfo info( fileName );
+    // Don't save anything if the file has changed since indexing
+    if ( info.size() != size )
+        return;
+
+    QByteArray lines;
+    LineNumber previous = 0;
+    for ( LineNumber line : results.matches ) {
+        appendVarInt( lines, line - previous );
+        previous = line;
+    }
+
+    QByteArray marks;
+    previous = 0;
+    for ( qint64 line : results.marks ) {
+        appendVarInt( marks, line - previous );
+        previous = line;
+    }
+
+    QByteArray data;
+    QDataStream out( &data, QIODevice::WriteOnly );
+    out.setVersion( QDataStream::Qt_4_6 );
+    writeHeader( out, SEARCH_MAGIC, SEARCH_VERSION, fileName, size );
+    out << results.regexp << static_cast<qint64>( results.nbLines )
+        << static_cast<qint32>( results.maxLength ) << lines << marks;
+
+    StateStore::instance().setValue( searchResultsKey( fileName ), data );
+
+    LOG(logDEBUG) << "Saved search results for " << fileName.toStdString();
+}
+
+void IndexCache::write( const QString& fileName, const char* extension,
+        quint32 magic, quint32 version, qint64 size,
+        const QByteArray& data ) const
+{
+    QStringList directories( directory_ );
+    if ( ! sharedDirectory_.isEmpty() ) {
+        // Another user might have published it already
+        if ( ! isUpToDate( cacheFileName( sharedDirectory_, fileName, extension ),
+                    magic, version, fileName, size ) )
+            directories << sharedDirectory_;
+    }
+
+    for ( const QString& directory : directories ) {
+        const QString cache_name = cacheFileName( directory, fileName, extension );
+        QFile file;
+        if ( ! create( &file, directory, cache_name ) )
+            continue;
+
+        QDataStream out( &file );
+        out.setVersion( QDataStream::Qt_4_6 );
+
+        writeHeader( out, magic, version, fileName, size );
+        out.writeRawData( data.constData(), data.size() );
+
+        commit( &file, directory, cache_name, directory != directory_ );
+    }
+}
+
+bool IndexCache::isUpToDate( const QString& cacheName, quint32 magic,
+        quint32 version, const QString& fileName, qint64 size )
+{
+    QFile file( cacheName );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream in( &file );
+    in.setVersion( QDataStream::Qt_4_6 );
+
+    qint64 cached_size;
+    return readHeader( in, magic, version, fileName, &cached_size ) == UpToDate
+        && cached_size == size;
+}
+
+QString IndexCache::searchResultsKey( const QString& fileName )
+{
+    return "searchResults/" + QFileInfo( fileName ).absoluteFilePath();
+}
+
+QString IndexCache::cacheFileName( const QString& directory,
+        const QString& fileName, const char* extension )
+{
+    const QByteArray path = QFileInfo( fileName ).absoluteFilePath().toUtf8();
+
+    return directory + "/" + QString(
+            QCryptographicHash::hash( path, QCryptographicHash::Sha1 ).toHex() )
+        + extension;
+}
+
+bool IndexCache::create( QFile* file, const QString& directory,
+        const QString& cacheName )
+{
+    if ( ! QDir().mkpath( directory ) ) {
+        LOG(logWARNING) << "Cannot create the index cache directory "
+            << directory.toStdString();
+        return false;
+    }
+
+    // Write to a temporary file first so a concurrent reader never
+    // sees half a file.
+    file->setFileName( cacheName + ".new" );
+    if ( ! file->open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG(logWARNING) << "Cannot write the index cache "
+            << file->fileName().toStdString();
+        return false;
+    }
+
+    return true;
+}
+
+void IndexCache::commit( QFile* file, const QString& directory,
+        const QString& cacheName, bool shared )
+{
+    file->close();
+
+    // The other users only read it
+    if ( shared )
+        file->setPermissions( QFile::ReadOwner | QFile::WriteOwner
+                | QFile::ReadGroup | QFile::ReadOther );
+
+    QFile::remove( cacheName );
+    if ( ! QFile::rename( file->fileName(), cacheName ) ) {
+        // e.g. the shared file of another user we cannot replace
+        LOG(logWARNING) << "Cannot write the index cache "
+            << cacheName.toStdString();
+        QFile::remove( file->fileName() );
+    }
+
+    cleanUp( directory );
+}
+
+IndexCache::Validity IndexCache::readHeader( QDataStream& in, quint32 magic,
+        quint32 version, const QString& fileName, qint64* size )
+{
+    quint32 cached_magic, cached_version;
+    in >> cached_magic >> cached_version;
+    if ( cached_magic != magic || cached_version != version )
+        return Invalid;
+
+    qint64 cached_size, modified_date;
+    QByteArray cached_fingerprint;
+    in >> cached_size >> modified_date >> cached_fingerprint;
+
+    if ( in.status() != QDataStream::Ok )
+        return Invalid;
+
+    QFileInfo info( fileName );
+    Validity validity;
+    if ( cached_size == info.size()
+            && modified_date == info.lastModified().toMSecsSinceEpoch() )
+        validity = UpToDate;
+    else if ( cached_size < info.size() )
+        validity = FileGrown;
+    else
+        return Invalid;
+
+    if ( fingerprint( fileName, cached_size ) != cached_fingerprint ) {
+        LOG(logDEBUG) << "Index cache for " << fileName.toStdString()
+            << " does not match the file";
+        return Invalid;
+    }
+
+    *size = cached_size;
+
+    return validity;
+}
+
+void IndexCache::writeHeader( QDataStream& out, quint32 magic,
+        quint32 version, const QString& fileName, qint64 size )
+{
+    out << magic << version
+        << size << QFileInfo( fileName ).lastModified().toMSecsSinceEpoch()
+        << fingerprint( fileName, size );
+}
+
+QByteArray IndexCache::fingerprint( const QString& fileName, qint64 size )
+{
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+
+    QFile file( fileName );
+    if ( file.open( QIODevice::ReadOnly ) ) {
+        hash.addData( file.read( qMin<qint64>( size, FINGERPRINT_SIZE ) ) );
+
+        const qint64 tail = qMax<qint64>( size - FINGERPRINT_SIZE, 0 );
+        file.seek( tail );
+        hash.addData( file.read( size - tail ) );
+    }
+
+    return hash.result();
+}
+
+void IndexCache::cleanUp( const QString& directory )
+{
+    QDir dir( directory );
+    const QFileInfoList files = dir.entryInfoList(
+            QStringList() << "*.idx" << "*.tok", QDir::Files, QDir::Time );
+
+    for ( int i = MAX_CACHED_FILES; i < files.size(); i++ )
+        QFile::remove( files[i].absoluteFilePath() );
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INDEXCACHE_H
+#define INDEXCACHE_H
+
+#include <vector>
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <QDataStream>
+#include <QFile>
+#include <QRegExp>
+
+#include "matchset.h"
+
+class LinePositionArray;
+class TokenIndex;
+
+// Persistent cache of the indexing data of big files, so reopening
+// them does not require a full indexing.
+// Each file has its own cache file (named after a hash of its path),
+// holding the line positions, the max length and enough information
+// (size, modification date and a fingerprint of the content) to check
+// it is still valid.
+// The token index of a file (see TokenIndex) is kept in the same way,
+// in a file of its own next to the one of the line positions.
+// The indexes can also be shared by the users (or sessions) of the same
+// machine through a shared directory (see setSharedDirectory): they are
+// published there when saved and read from there when the user has no
+// (or an older) index of their own, so a big file is indexed only once.
+// An index is only used if it matches the file, whoever wrote it.
+// The results of the search of a file and its marks are the user's
+// own, kept in the StateStore with the same header (rather than in
+// the cache, where they could be dropped).
+// This class is reentrant (not thread-safe).
+class IndexCache
+{
+  public:
+    // What the cache knows about the file
+    enum Validity { Invalid, UpToDate, FileGrown };
+
+    // Uses the default (per user) cache directory, and the shared
+    // directory if there is one
+    IndexCache();
+    // Uses the passed directories (mainly for tests)
+    IndexCache( const QString& directory,
+            const QString& sharedDirectory = QString() );
+
+    // Set the directory the indexes are shared through, none if empty.
+    // It must be writable by all the users sharing it.
+    static void setSharedDirectory( const QString& directory );
+    static QString sharedDirectory();
+
+    // Load the cached index for the passed file.
+    // Returns UpToDate if the index can be used as is, FileGrown if
+    // the file has only been appended to since the index was saved,
+    // in which case the data must be completed from *size.
+    Validity load( const QString& fileName, qint64* size, int* maxLength,
+            LinePositionArray* linePosition ) const;
+
+    // Save the index, if the file is big enough for it to be useful.
+    void save( const QString& fileName, qint64 size, int maxLength,
+            const LinePositionArray& linePosition ) const;
+
+    // Load the token index saved for the passed file, returns false if
+    // there is none or it is not valid anymore.
+    // (the index of a file only appended to since is valid)
+    bool loadTokens( const QString& fileName, TokenIndex* tokens ) const;
+
+    // Save the token index of the file, if it is big enough.
+    void saveTokens( const QString& fileName, qint64 size,
+            const TokenIndex& tokens ) const;
+
+    // The search of a file and its marks, restored with the session
+    struct SearchResults {
+        SearchResults() : regexp(), nbLines( 0 ), maxLength( 0 ),
+            matches(), marks() {}
+
+        // The regexp searched for (empty if the matches are not kept)
+        QRegExp regexp;
+        // The matches in the first nbLines lines of the file
+        qint64 nbLines;
+        int maxLength;
+        MatchSet matches;
+        // The marked lines, sorted
+        std::vector<qint64> marks;
+    };
+
+    // Load the search results saved for the passed file, returns false
+    // if there are none or they are not valid anymore.
+    // (the results of a file only appended to since are valid)
+    bool loadSearchResults( const QString& fileName,
+            SearchResults* results ) const;
+
+    // Save the search results of the file (of the passed size),
+    // whatever its size.
+    void saveSearchResults( const QString& fileName, qint64 size,
+            const SearchResults& results ) const;
+
+    // Files smaller than this are not cached
+    static const qint64 minimumFileSize;
+
+  private:
+    // Load the index from the passed cache file
+    static Validity loadIndex( const QString& cacheName,
+            const QString& fileName, qint64* size, int* maxLength,
+            LinePositionArray* linePosition );
+    // Idem for the token index
+    static bool loadTokenIndex( const QString& cacheName,
+            const QString& fileName, TokenIndex* tokens );
+    // Write the cache file of the passed kind in the user's directory,
+    // then in the shared one if it does not have it already, the
+    // header being followed by data.
+    void write( const QString& fileName, const char* extension,
+            quint32 magic, quint32 version, qint64 size,
+            const QByteArray& data ) const;
+    // Returns whether the cache file is up to date for the file of
+    // the passed size
+    static bool isUpToDate( const QString& cacheName, quint32 magic,
+            quint32 version, const QString& fileName, qint64 size );
+    // Key of the search results of the file in the StateStore
+    static QString searchResultsKey( const QString& fileName );
+    // Path of the cache file in directory for the passed file (with
+    // the passed extension, one for each kind of data)
+    static QString cacheFileName( const QString& directory,
+            const QString& fileName, const char* extension );
+    // Open the cache file for writing, to be passed to commit() once
+    // written so a concurrent reader never sees half a file.
+    static bool create( QFile* file, const QString& directory,
+            const QString& cacheName );
+    // (the file being made readable by all if shared)
+    static void commit( QFile* file, const QString& directory,
+            const QString& cacheName, bool shared );
+    // Read the header of a cache file, telling whether it is valid for
+    // the file and setting the size the file had when it was saved.
+    static Validity readHeader( QDataStream& in, quint32 magic,
+            quint32 version, const QString& fileName, qint64* size );
+    static void writeHeader( QDataStream& out, quint32 magic,
+            quint32 version, const QString& fileName, qint64 size );
+    // Hash of the beginning of the file and of the data just before 'size'
+    static QByteArray fingerprint( const QString& fileName, qint64 size );
+    // Remove the oldest cache files of the directory if there are
+    // too many
+    static void cleanUp( const QString& directory );
+
+    QString directory_;
+    QString sharedDirectory_;
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "log.h"
+
+#include "keywordmatcher.h"
+
+namespace {
+
+inline unsigned foldCase( unsigned c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? c + ( 'a' - 'A' ) : c;
+}
+
+inline bool isLetter( unsigned c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' );
+}
+
+}
+
+KeywordMatcher::KeywordMatcher()
+    : keywords_(), caseInsensitive_( false ), minimumLength_( 0 ),
+    byFirst_(), commonFirst_( -1 )
+{
+    std::memset( bucket_, 0, sizeof bucket_ );
+}
+
+KeywordMatcher::KeywordMatcher( const QRegExp& regexp )
+    : keywords_(), caseInsensitive_( false ), minimumLength_( 0 ),
+    byFirst_(), commonFirst_( -1 )
+{
+    std::memset( bucket_, 0, sizeof bucket_ );
+
+    const QByteArray utf8 = regexp.pattern().toUtf8();
+    const std::string pattern( utf8.constData(), utf8.size() );
+
+    switch ( regexp.patternSyntax() ) {
+        case QRegExp::RegExp:
+        case QRegExp::RegExp2:
+            keywords_ = alternatedKeywords( pattern );
+            break;
+        case QRegExp::FixedString:
+            if ( ! pattern.empty() )
+                keywords_.push_back( pattern );
+            break;
+        default:
+            break;
+    }
+
+    for ( const std::string& keyword : keywords_ ) {
+        for ( unsigned char c : keyword ) {
+            if ( c < 0x20 || c >= 0x80 ) {
+                keywords_.clear();
+                return;
+            }
+        }
+    }
+
+    if ( keywords_.empty() )
+        return;
+
+    caseInsensitive_ = ( regexp.caseSensitivity() == Qt::CaseInsensitive );
+    if ( caseInsensitive_ ) {
+        for ( std::string& keyword : keywords_ ) {
+            for ( char& c : keyword )
+                c = foldCase( c );
+        }
+    }
+
+    // Bucket the keywords by their first character (counting sort,
+    // keeping the order of the pattern)
+    minimumLength_ = keywords_.front().size();
+    for ( const std::string& keyword : keywords_ ) {
+        bucket_[ static_cast<unsigned char>( keyword[0] ) + 1 ]++;
+        minimumLength_ = std::min<int>( minimumLength_, keyword.size() );
+    }
+    for ( int c = 0; c < 128; c++ )
+        bucket_[c + 1] += bucket_[c];
+
+    std::vector<int> next( bucket_, bucket_ + 128 );
+    byFirst_.resize( keywords_.size() );
+    for ( size_t i = 0; i < keywords_.size(); i++ )
+        byFirst_[ next[ static_cast<unsigned char>( keywords_[i][0] ) ]++ ] = i;
+
+    const unsigned first = keywords_.front()[0];
+    if ( ! ( caseInsensitive_ && isLetter( first ) )
+            && bucket_[first + 1] - bucket_[first] == int( keywords_.size() ) )
+        commonFirst_ = first;
+
+    LOG(logDEBUG) << "Pattern matched as " << keywords_.size() << " keyword(s)";
+}
+
+int KeywordMatcher::indexIn( const QString& string, int* matchedLength ) const
+{
+    return findIn( string.utf16(), string.size(), matchedLength );
+}
+
+int KeywordMatcher::find( const char* data, int length, int* matchedLength ) const
+{
+    const unsigned char* const text = reinterpret_cast<const unsigned char*>( data );
+
+    if ( commonFirst_ == -1 )
+        return findIn( text, length, matchedLength );
+
+    // Skip quickly to the next possible start
+    for ( int i = 0; i + minimumLength_ <= length; i++ ) {
+        const void* found = memchr( text + i, commonFirst_,
+                length - minimumLength_ + 1 - i );
+        if ( ! found )
+            break;
+        i = static_cast<const unsigned char*>( found ) - text;
+
+        const int keyword = keywordAt( text + i, length - i );
+        if ( keyword != -1 ) {
+            if ( matchedLength )
+                *matchedLength = keywords_[keyword].size();
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+template <typename Char>
+int KeywordMatcher::keywordAt( const Char* text, int length ) const
+{
+    const unsigned first = caseInsensitive_ ? foldCase( text[0] ) : text[0];
+    if ( first >= 128 )
+        return -1;
+
+    for ( int b = bucket_[first]; b < bucket_[first + 1]; b++ ) {
+        const std::string& keyword = keywords_[ byFirst_[b] ];
+        const int size = keyword.size();
+        if ( size > length )
+            continue;
+
+        int j = 1;
+        if ( caseInsensitive_ ) {
+            while ( j < size && foldCase( text[j] ) == unsigned( keyword[j] ) )
+                j++;
+        }
+        else {
+            while ( j < size && unsigned( text[j] ) == unsigned( keyword[j] ) )
+                j++;
+        }
+
+        // The first of the pattern is in the bucket first
+        if ( j == size )
+            return byFirst_[b];
+    }
+
+    return -1;
+}
+
+template <typename Char>
+int KeywordMatcher::findIn( const Char* text, int length, int* matchedLength ) const
+{
+    for ( int i = 0; i + minimumLength_ <= length; i++ ) {
+        const unsigned c = caseInsensitive_ ? foldCase( text[i] ) : text[i];
+        if ( c < 128 && bucket_[c] != bucket_[c + 1] ) {
+            const int keyword = keywordAt( text + i, length - i );
+            if ( keyword != -1 ) {
+                if ( matchedLength )
+                    *matchedLength = keywords_[keyword].size();
+                return i;
+            }
+        }
+    }
+
+    return -1;
+}
+
+std::vector<std::string> KeywordMatcher::alternatedKeywords(
+        const std::string& pattern )
+{
+    std::string alternation = pattern;
+
+    // The alternation can be in a (capturing or not) group
+    if ( alternation.size() >= 2 && alternation.front() == '('
+            && alternation.back() == ')'
+            && alternation[ alternation.size() - 2 ] != '\\' ) {
+        const size_t start = ( alternation.compare( 0, 3, "(?:" ) == 0 ) ? 3 : 1;
+        if ( start == 1 && alternation.size() > 1 && alternation[1] == '?' )
+            return std::vector<std::string>();
+        alternation = alternation.substr( start, alternation.size() - start - 1 );
+    }
+
+    std::vector<std::string> keywords( 1 );
+    for ( size_t i = 0; i < alternation.size(); i++ ) {
+        const char c = alternation[i];
+        if ( c == '|' ) {
+            if ( keywords.back().empty() )
+                return std::vector<std::string>();
+            keywords.emplace_back();
+        }
+        else if ( c == '\\' ) {
+            // Only escaped punctuation is a plain character
+            if ( i + 1 == alternation.size()
+                    || ! std::ispunct( static_cast<unsigned char>( alternation[i + 1] ) ) )
+                return std::vector<std::string>();
+            keywords.back() += alternation[++i];
+        }
+        else if ( std::strchr( "^$.[]()?*+{}", c ) ) {
+            return std::vector<std::string>();
+        }
+        else {
+            keywords.back() += c;
+        }
+    }
+
+    // (an empty alternative would match everywhere)
+    if ( keywords.back().empty() )
+        return std::vector<std::string>();
+
+    return keywords;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEYWORDMATCHER_H
+#define KEYWORDMATCHER_H
+
+#include <string>
+#include <vector>
+
+#include <QRegExp>
+#include <QString>
+
+// Matches a pattern which is only an alternation of plain keywords
+// (such as ERROR|WARN|FATAL, the most common filters) without a
+// regexp engine: the text is scanned for the first characters of the
+// keywords, each one found being only compared with the keywords
+// starting with it.
+// The keywords must be ASCII, their case being folded if the pattern
+// is case insensitive.
+// This class is immutable once built and can be shared between threads.
+class KeywordMatcher
+{
+  public:
+    // No keywords
+    KeywordMatcher();
+    // Extract the keywords from the pattern, isValid() tells whether
+    // it is one we can match.
+    explicit KeywordMatcher( const QRegExp& regexp );
+
+    // Returns whether the pattern is an alternation of keywords
+    bool isValid() const { return ! keywords_.empty(); }
+    // Returns the keywords, in the order of the pattern
+    // (lower case if the pattern is case insensitive)
+    const std::vector<std::string>& keywords() const { return keywords_; }
+
+    // Returns the position of the first match in string, -1 if none,
+    // matchedLength being set to the length of the keyword found if
+    // not null (the first one of the pattern matching there, as PCRE
+    // does).
+    int indexIn( const QString& string, int* matchedLength = nullptr ) const;
+    // Idem in raw (UTF-8) data, returns the offset of the first match.
+    int find( const char* data, int length, int* matchedLength = nullptr ) const;
+
+    // Returns the keywords the (QRegExp or PCRE) pattern is the
+    // alternation of, possibly in a group, or nothing if it is not
+    // one.
+    static std::vector<std::string> alternatedKeywords( const std::string& pattern );
+
+  private:
+    // Returns the index of the first keyword matching at the start of
+    // text (of length characters), -1 if none.
+    template <typename Char>
+    int keywordAt( const Char* text, int length ) const;
+    template <typename Char>
+    int findIn( const Char* text, int length, int* matchedLength ) const;
+
+    std::vector<std::string> keywords_;
+    bool caseInsensitive_;
+    // Length of the shortest keyword
+    int minimumLength_;
+    // The indexes of the keywords starting with the (folded) ASCII
+    // character c are byFirst_[bucket_[c]] to byFirst_[bucket_[c+1]-1]
+    std::vector<int> byFirst_;
+    int bucket_[129];
+    // The first character of all the keywords if they share it and
+    // it can be looked for with memchr, -1 otherwise
+    int commonFirst_;
+};
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements LineBlockCache
+
+#include "log.h"
+
+#include "lineblockcache.h"
+
+const int LineBlockCache::linesPerBlock   = 256;
+const int LineBlockCache::maxBlocks       = 64;
+const int LineBlockCache::readAheadBlocks = 2;
+
+LineBlockCache::LineBlockCache( Loader loader )
+    : QThread(), loader_( loader ), mutex_(), readAheadCond_(),
+    terminate_( false ), epoch_( 0 ), blocks_( maxBlocks ),
+    lastFirstLine_( 0 ), readAhead_(), readAheadNbLines_( 0 )
+{
+    start();
+}
+
+LineBlockCache::~LineBlockCache()
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        terminate_ = true;
+        readAheadCond_.wakeAll();
+    }
+    wait();
+}
+
+QStringList LineBlockCache::getLines( qint64 first_line, int number,
+        qint64 nb_lines )
+{
+    QStringList list;
+
+    forEachLine( first_line, number, nb_lines,
+            [&list]( const QString& line ) { list.append( line ); } );
+
+    return list;
+}
+
+void LineBlockCache::getLines( qint64 first_line, int number,
+        qint64 nb_lines, LineBuffer* lines )
+{
+    forEachLine( first_line, number, nb_lines,
+            [lines]( const QString& line ) { lines->append( line ); } );
+}
+
+void LineBlockCache::forEachLine( qint64 first_line, int number,
+        qint64 nb_lines, const std::function<void( const QString& )>& function )
+{
+    if ( number <= 0 || first_line + number > nb_lines )
+        return;
+
+    const qint64 first_block = first_line / linesPerBlock;
+    const qint64 last_block  = ( first_line + number - 1 ) / linesPerBlock;
+
+    for ( qint64 block = first_block; block <= last_block; block++ ) {
+        const QStringList lines = getBlock( block, nb_lines );
+        const qint64 block_first_line = block * linesPerBlock;
+
+        const int begin = qMax( first_line - block_first_line, 0LL );
+        const int end   = qMin( first_line + number - block_first_line,
+                (qint64) lines.size() );
+        for ( int i = begin; i < end; i++ )
+            function( lines[i] );
+    }
+
+    // Read ahead in the direction we are going
+    {
+        QMutexLocker locker( &mutex_ );
+
+        const qint64 nb_blocks = ( nb_lines + linesPerBlock - 1 ) / linesPerBlock;
+
+        readAhead_.clear();
+        for ( int i = 1; i <= readAheadBlocks; i++ ) {
+            qint64 block = -1;
+            if ( first_line > lastFirstLine_ )
+                block = last_block + i;
+            else if ( first_line < lastFirstLine_ )
+                block = first_block - i;
+
+            if ( block >= 0 && block < nb_blocks && ! blocks_.contains( block ) )
+                readAhead_.push_back( block );
+        }
+        readAheadNbLines_ = nb_lines;
+        lastFirstLine_ = first_line;
+
+        if ( ! readAhead_.empty() )
+            readAheadCond_.wakeAll();
+    }
+}
+
+void LineBlockCache::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    blocks_.clear();
+    readAhead_.clear();
+    epoch_++;
+}
+
+void LineBlockCache::invalidateFrom( qint64 line )
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( qint64 block : blocks_.keys() ) {
+        if ( ( block + 1 ) * linesPerBlock > line )
+            blocks_.remove( block );
+    }
+    readAhead_.clear();
+    epoch_++;
+}
+
+QStringList LineBlockCache::getBlock( qint64 block, qint64 nb_lines )
+{
+    {
+        QMutexLocker locker( &mutex_ );
+
+        // (also marks the block as the most recently used)
+        const QStringList* lines = blocks_.object( block );
+        // The last block is read again if the file has grown since
+        const qint64 number = qMin( nb_lines - block * linesPerBlock,
+                (qint64) linesPerBlock );
+        if ( lines && lines->size() == number )
+            return *lines;
+    }
+
+    return loadBlock( block, nb_lines );
+}
+
+QStringList LineBlockCache::loadBlock( qint64 block, qint64 nb_lines )
+{
+    mutex_.lock();
+    const int epoch = epoch_;
+    mutex_.unlock();
+
+    const qint64 first_line = block * linesPerBlock;
+    const int number = qMin( nb_lines - first_line, (qint64) linesPerBlock );
+    const QStringList lines = loader_( first_line, number );
+
+    QMutexLocker locker( &mutex_ );
+
+    // A block read whilst the file was being reindexed might be stale
+    // (the caller still gets it, as if it had read it before),
+    // and an incomplete read is not kept.
+    if ( epoch == epoch_ && lines.size() == number )
+        blocks_.insert( block, new QStringList( lines ) );
+
+    return lines;
+}
+
+void LineBlockCache::run()
+{
+    QMutexLocker locker( &mutex_ );
+
+    forever {
+        while ( ( terminate_ == false ) && readAhead_.empty() )
+            readAheadCond_.wait( &mutex_ );
+
+        if ( terminate_ )
+            return;
+
+        const qint64 block = readAhead_.front();
+        readAhead_.pop_front();
+
+        if ( blocks_.contains( block ) )
+            continue;
+
+        const qint64 nb_lines = readAheadNbLines_;
+
+        locker.unlock();
+        LOG(logDEBUG) << "LineBlockCache: reading ahead block " << block;
+        loadBlock( block, nb_lines );
+        locker.relock();
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEBLOCKCACHE_H
+#define LINEBLOCKCACHE_H
+
+#include <functional>
+#include <deque>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QCache>
+#include <QStringList>
+
+#include "linebuffer.h"
+
+// LRU cache of blocks of consecutive (expanded) lines, so the views
+// can be repainted and scrolled back without reading and decoding
+// the file again.
+// The blocks following the lines asked for, in the direction the
+// lines are asked in, are read ahead by a thread of its own.
+// This class is thread-safe.
+class LineBlockCache : public QThread
+{
+  public:
+    // Function reading the passed lines (all existing) from the file
+    typedef std::function<QStringList( qint64 first_line, int number )> Loader;
+
+    LineBlockCache( Loader loader );
+    ~LineBlockCache();
+
+    // Returns the passed lines, from the cache if possible,
+    // 'nb_lines' being the number of lines in the file.
+    QStringList getLines( qint64 first_line, int number, qint64 nb_lines );
+    // Idem, the lines being appended to the passed buffer
+    void getLines( qint64 first_line, int number, qint64 nb_lines,
+            LineBuffer* lines );
+
+    // Forget all the lines (the file is reindexed)
+    void clear();
+    // Forget the lines from the passed one (the file has grown, the
+    // last line might have been incomplete)
+    void invalidateFrom( qint64 line );
+
+    // Number of lines in a block
+    static const int linesPerBlock;
+    // Number of blocks kept in the cache
+    static const int maxBlocks;
+    // Number of blocks read ahead
+    static const int readAheadBlocks;
+
+  protected:
+    void run();
+
+  private:
+    // Pass the lines asked for to the function, one by one, then
+    // schedule the reading ahead
+    void forEachLine( qint64 first_line, int number, qint64 nb_lines,
+            const std::function<void( const QString& )>& function );
+    // Returns the lines of the passed block, loading them if needed
+    QStringList getBlock( qint64 block, qint64 nb_lines );
+    // Read the passed block and insert it in the cache
+    // (called without the mutex held)
+    QStringList loadBlock( qint64 block, qint64 nb_lines );
+
+    const Loader loader_;
+
+    // Protects everything below
+    QMutex mutex_;
+    QWaitCondition readAheadCond_;
+    bool terminate_;
+
+    // Changed whenever lines are invalidated, so the blocks being read
+    // at the time are not cached
+    int epoch_;
+    QCache<qint64, QStringList> blocks_;
+    // First line asked for last time (to guess the direction)
+    qint64 lastFirstLine_;
+    // Blocks to read ahead, and the number of lines in the file then
+    std::deque<qint64> readAhead_;
+    qint64 readAheadNbLines_;
+};
+
+#endif
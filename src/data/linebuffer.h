@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEBUFFER_H
+#define LINEBUFFER_H
+
+#include <algorithm>
+#include <vector>
+
+#include <QChar>
+#include <QString>
+
+// A set of lines stored in a single UTF-16 buffer, with the offset of
+// the end of each line, so lines can be read without a heap allocation
+// per line. Clearing it keeps the memory, so a buffer reused for each
+// batch of lines stops allocating once it is big enough.
+class LineBuffer
+{
+  public:
+    LineBuffer() : chars_( 256 ), size_( 0 ), ends_() {}
+
+    // Number of lines
+    int size() const { return ends_.size(); }
+    bool isEmpty() const { return ends_.empty(); }
+
+    // Returns the characters of the passed line (length() of them)
+    const QChar* line( int i ) const { return chars_.data() + start( i ); }
+    int length( int i ) const { return ends_[i] - start( i ); }
+    // Returns the passed line as a QString using the characters in
+    // place, only valid until the buffer is changed.
+    QString rawString( int i ) const
+    { return QString::fromRawData( line( i ), length( i ) ); }
+    // Returns a copy of the passed line
+    QString string( int i ) const { return QString( line( i ), length( i ) ); }
+
+    // Forget the lines, keeping the memory
+    void clear() { size_ = 0; ends_.clear(); }
+    // Add a line
+    void append( const QChar* chars, int length )
+    {
+        reserve( length );
+        std::copy( chars, chars + length, chars_.begin() + size_ );
+        size_ += length;
+        endLine();
+    }
+    void append( const QString& line ) { append( line.constData(), line.size() ); }
+
+    // Writing a line character by character (done by the decoders):
+    // make room for count more characters,
+    void reserve( int count )
+    {
+        if ( size_ + count > chars_.size() )
+            chars_.resize( std::max( 2 * chars_.size(), size_ + count ) );
+    }
+    // add a character (room having been made for it),
+    void push( QChar c ) { chars_[size_++] = c; }
+    // the characters added since the previous line make a line.
+    void endLine() { ends_.push_back( size_ ); }
+    // Number of characters added to the line being written
+    int pendingLength() const
+    { return size_ - ( ends_.empty() ? 0 : ends_.back() ); }
+
+  private:
+    int start( int i ) const { return ( i == 0 ) ? 0 : ends_[i - 1]; }
+
+    // Its size is the capacity, size_ characters being used
+    std::vector<QChar> chars_;
+    size_t size_;
+    std::vector<int> ends_;
+};
+
+#endif
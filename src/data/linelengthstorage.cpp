@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linelengthstorage.h"
+
+#include "spillfile.h"
+
+const uint16_t LineLengthStorage::LONG_LENGTH;
+
+LineLengthStorage::LineLengthStorage() : lengths_(), longLengths_(),
+    spillFile_(), spilledLengths_( nullptr ), nbSpilled_( 0 )
+{
+}
+
+void LineLengthStorage::append( int length )
+{
+    unspill();
+
+    if ( length >= LONG_LENGTH ) {
+        longLengths_[ lengths_.size() ] = length;
+        lengths_.push_back( LONG_LENGTH );
+    }
+    else {
+        lengths_.push_back( length );
+    }
+}
+
+void LineLengthStorage::append( const LineLengthStorage& other )
+{
+    unspill();
+
+    for ( const auto& long_length : other.longLengths_ )
+        longLengths_[ lengths_.size() + long_length.first ] = long_length.second;
+
+    const uint16_t* other_lengths = other.lengths();
+    lengths_.insert( lengths_.end(), other_lengths, other_lengths + other.size() );
+}
+
+void LineLengthStorage::pop_back()
+{
+    unspill();
+
+    if ( lengths_.back() == LONG_LENGTH )
+        longLengths_.erase( lengths_.size() - 1 );
+
+    lengths_.pop_back();
+}
+
+void LineLengthStorage::clear()
+{
+    lengths_ = std::vector<uint16_t>();
+    longLengths_.clear();
+    spillFile_.reset();
+    spilledLengths_ = nullptr;
+    nbSpilled_ = 0;
+}
+
+int LineLengthStorage::at( qint64 index ) const
+{
+    const uint16_t length = lengths()[index];
+
+    return ( length == LONG_LENGTH ) ? longLengths_.at( index ) : length;
+}
+
+size_t LineLengthStorage::allocatedSize() const
+{
+    return lengths_.capacity() * sizeof( uint16_t )
+        + longLengths_.size() * ( sizeof( qint64 ) + sizeof( int ) );
+}
+
+bool LineLengthStorage::spill( LineLengthStorage* spilled ) const
+{
+    if ( isSpilled() || lengths_.empty() ) {
+        *spilled = *this;
+        return true;
+    }
+
+    std::shared_ptr<SpillFile> file = std::make_shared<SpillFile>();
+    const qint64 offset = file->append( lengths_.data(),
+            lengths_.size() * sizeof( uint16_t ) );
+    if ( offset < 0 || ! file->map() )
+        return false;
+
+    LineLengthStorage copy;
+    copy.longLengths_ = longLengths_;
+    copy.spilledLengths_ =
+        reinterpret_cast<const uint16_t*>( file->data( offset ) );
+    copy.nbSpilled_ = lengths_.size();
+    copy.spillFile_ = file;
+    *spilled = std::move( copy );
+
+    return true;
+}
+
+void LineLengthStorage::unspill()
+{
+    if ( ! spillFile_ )
+        return;
+
+    lengths_.assign( spilledLengths_, spilledLengths_ + nbSpilled_ );
+    spillFile_.reset();
+    spilledLengths_ = nullptr;
+    nbSpilled_ = 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINELENGTHSTORAGE_H
+#define LINELENGTHSTORAGE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QtGlobal>
+
+class SpillFile;
+
+// Space efficient storage for the (tab-expanded) length of each line
+// of a file.
+// Each length is stored in 16 bits, the few lines too long for it
+// having their length kept in a separate table.
+// Random access is O(1) for all but these lines.
+// As CompressedLinePositionStorage, the lengths can be spilled to a
+// temporary file.
+class LineLengthStorage
+{
+  public:
+    LineLengthStorage();
+
+    // Append the length of a line
+    void append( int length );
+    // Append all the lengths in the passed storage
+    void append( const LineLengthStorage& other );
+    // Remove the last length
+    void pop_back();
+    // Remove all the lengths, freeing the memory
+    void clear();
+
+    // Number of lengths stored
+    qint64 size() const
+    { return spillFile_ ? nbSpilled_ : lengths_.size(); }
+    // Extract an element
+    int at( qint64 index ) const;
+
+    // Approximate memory used (not counting the lengths spilled),
+    // in bytes
+    size_t allocatedSize() const;
+
+    // Copy the storage to *spilled, its lengths being kept in a spill
+    // file rather than in memory. Returns false (*spilled being
+    // unchanged) if the file cannot be written.
+    bool spill( LineLengthStorage* spilled ) const;
+    // Whether the lengths are in a spill file
+    bool isSpilled() const { return spillFile_ != nullptr; }
+
+  private:
+    // Stored in place of the lengths kept in longLengths_
+    static const uint16_t LONG_LENGTH = 0xFFFF;
+
+    // Bring the spilled lengths back in lengths_ (before a change)
+    void unspill();
+    // The lengths, wherever they are
+    const uint16_t* lengths() const
+    { return spillFile_ ? spilledLengths_ : lengths_.data(); }
+
+    std::vector<uint16_t> lengths_;
+    std::map<qint64, int> longLengths_;
+
+    // Set if the lengths are spilled, in its mapping
+    std::shared_ptr<const SpillFile> spillFile_;
+    const uint16_t* spilledLengths_;
+    size_t nbSpilled_;
+};
+
+#endif
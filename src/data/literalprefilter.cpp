@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cctype>
+#include <cstring>
+
+#include "log.h"
+
+#include "literalprefilter.h"
+
+const size_t LiteralPrefilter::minimumLength = 2;
+
+namespace {
+
+inline unsigned char foldCase( unsigned char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? c + ( 'a' - 'A' ) : c;
+}
+
+bool isAscii( const std::string& string )
+{
+    for ( unsigned char c : string ) {
+        if ( c >= 0x80 )
+            return false;
+    }
+
+    return true;
+}
+
+}
+
+LiteralPrefilter::LiteralPrefilter( const QRegExp& regexp )
+    : literal_(), caseInsensitive_( false ), exact_( false )
+{
+    for ( const std::string& literal : requiredLiterals( regexp ) ) {
+        if ( literal.size() > literal_.size() )
+            literal_ = literal;
+    }
+    exact_ = ( regexp.patternSyntax() == QRegExp::FixedString );
+
+    if ( regexp.caseSensitivity() == Qt::CaseInsensitive ) {
+        // We only know how to fold ASCII
+        if ( isAscii( literal_ ) )
+            caseInsensitive_ = true;
+        else
+            literal_.clear();
+    }
+
+    if ( literal_.size() < minimumLength ) {
+        literal_.clear();
+        exact_ = false;
+    }
+
+    if ( isValid() ) {
+        LOG(logDEBUG) << "Search prefiltered on \"" << literal_ << "\""
+            << ( exact_ ? " (exact)" : "" );
+        buildShiftTable();
+    }
+}
+
+int LiteralPrefilter::find( const char* data, int length ) const
+{
+    const unsigned char* const text = reinterpret_cast<const unsigned char*>( data );
+    const unsigned char* const literal =
+        reinterpret_cast<const unsigned char*>( literal_.data() );
+    const int last = literal_.size() - 1;
+
+    if ( caseInsensitive_ ) {
+        for ( int i = 0; i + last < length; ) {
+            const unsigned char c = foldCase( text[i + last] );
+            if ( c == literal[last] ) {
+                int j = last - 1;
+                while ( j >= 0 && foldCase( text[i + j] ) == literal[j] )
+                    j--;
+                if ( j < 0 )
+                    return i;
+            }
+            i += shift_[c];
+        }
+    }
+    else {
+        const unsigned char first = literal[0];
+        for ( int i = 0; i + last < length; ) {
+            // Skip quickly to the next possible start
+            const void* found = memchr( text + i, first, length - last - i );
+            if ( ! found )
+                break;
+            i = static_cast<const unsigned char*>( found ) - text;
+
+            if ( memcmp( text + i + 1, literal + 1, last ) == 0 )
+                return i;
+
+            i += shift_[ text[i + last] ];
+        }
+    }
+
+    return -1;
+}
+
+std::vector<std::string> LiteralPrefilter::requiredLiterals( const QRegExp& regexp )
+{
+    const QByteArray utf8 = regexp.pattern().toUtf8();
+    const std::string pattern( utf8.constData(), utf8.size() );
+
+    switch ( regexp.patternSyntax() ) {
+        case QRegExp::FixedString:
+            return std::vector<std::string>( 1, pattern );
+        case QRegExp::RegExp:
+        case QRegExp::RegExp2:
+            return requiredLiterals( pattern );
+        case QRegExp::Wildcard:
+            return wildcardLiterals( pattern );
+        default:
+            return std::vector<std::string>();
+    }
+}
+
+bool LiteralPrefilter::isNarrower( const QRegExp& narrower, const QRegExp& wider )
+{
+    // The wider pattern must be its own (only) literal
+    const QByteArray utf8 = wider.pattern().toUtf8();
+    std::string literal( utf8.constData(), utf8.size() );
+    const std::vector<std::string> wider_literals = requiredLiterals( wider );
+    if ( literal.empty() || wider_literals.size() != 1
+            || wider_literals.front() != literal )
+        return false;
+
+    // A case sensitive pattern only requires its literal with this case,
+    // and we only know how to fold ASCII
+    const bool fold = ( wider.caseSensitivity() == Qt::CaseInsensitive );
+    if ( ! fold && narrower.caseSensitivity() == Qt::CaseInsensitive )
+        return false;
+    if ( fold && ! isAscii( literal ) )
+        return false;
+
+    if ( fold ) {
+        for ( char& c : literal )
+            c = foldCase( c );
+    }
+    for ( std::string required : requiredLiterals( narrower ) ) {
+        if ( fold ) {
+            for ( char& c : required )
+                c = foldCase( c );
+        }
+        if ( required.find( literal ) != std::string::npos )
+            return true;
+    }
+
+    return false;
+}
+
+std::string LiteralPrefilter::requiredLiteral( const std::string& pattern )
+{
+    std::string longest;
+    for ( const std::string& literal : requiredLiterals( pattern ) ) {
+        if ( literal.size() > longest.size() )
+            longest = literal;
+    }
+
+    return longest;
+}
+
+// Walks through the pattern, keeping the runs of plain characters
+// found outside of any group or class.
+// A character followed by a quantifier allowing zero occurrences
+// is not part of the run. Any top level alternation or construct
+// we do not understand returns no run at all.
+std::vector<std::string> LiteralPrefilter::requiredLiterals(
+        const std::string& pattern )
+{
+    std::vector<std::string> runs;
+    std::string current;
+    int depth = 0;
+
+    auto endRun = [&] () {
+        if ( ! current.empty() )
+            runs.push_back( current );
+        current.clear();
+    };
+
+    for ( size_t i = 0; i < pattern.size(); i++ ) {
+        const char c = pattern[i];
+
+        if ( depth > 0 ) {
+            // Inside a group, only looking for its end
+            if ( c == '\\' )
+                i++;
+            else if ( c == '(' )
+                depth++;
+            else if ( c == ')' )
+                depth--;
+            else if ( c == '[' ) {
+                // Skip the class, ']' first in it being a plain character
+                i++;
+                if ( i < pattern.size() && pattern[i] == '^' )
+                    i++;
+                if ( i < pattern.size() && pattern[i] == ']' )
+                    i++;
+                while ( i < pattern.size() && pattern[i] != ']' ) {
+                    if ( pattern[i] == '\\' )
+                        i++;
+                    i++;
+                }
+            }
+            continue;
+        }
+
+        switch ( c ) {
+            case '|':
+                // Nothing is mandatory
+                return std::vector<std::string>();
+            case '(':
+                // Inline options (e.g. "(?i)") could change the case
+                if ( i + 1 < pattern.size() && pattern[i + 1] == '?' )
+                    return std::vector<std::string>();
+                endRun();
+                depth++;
+                break;
+            case ')':
+                // Unbalanced
+                return std::vector<std::string>();
+            case '?':
+            case '*':
+            case '{':
+                // The previous character is optional, all of its
+                // UTF-8 bytes (continuation ones, then the lead one)
+                while ( ! current.empty()
+                        && ( current.back() & 0xC0 ) == 0x80 )
+                    current.erase( current.size() - 1 );
+                if ( ! current.empty() )
+                    current.erase( current.size() - 1 );
+                endRun();
+                if ( c == '{' ) {
+                    while ( i < pattern.size() && pattern[i] != '}' )
+                        i++;
+                }
+                break;
+            case '+':
+                // The previous character is needed at least once
+                endRun();
+                break;
+            case '[':
+                endRun();
+                i++;
+                if ( i < pattern.size() && pattern[i] == '^' )
+                    i++;
+                if ( i < pattern.size() && pattern[i] == ']' )
+                    i++;
+                while ( i < pattern.size() && pattern[i] != ']' ) {
+                    if ( pattern[i] == '\\' )
+                        i++;
+                    i++;
+                }
+                break;
+            case '.':
+            case '^':
+            case '$':
+                endRun();
+                break;
+            case '\\':
+                if ( i + 1 >= pattern.size() )
+                    return std::vector<std::string>();
+                i++;
+                if ( isalnum( static_cast<unsigned char>( pattern[i] ) ) ) {
+                    // Escapes with no argument only
+                    if ( strchr( "dDwWsSbBntrfv", pattern[i] ) == nullptr )
+                        return std::vector<std::string>();
+                    // A quantifier would apply to the escape, not to
+                    // the run, which is ended anyway.
+                    endRun();
+                }
+                else {
+                    current += pattern[i];
+                }
+                break;
+            default:
+                current += c;
+                break;
+        }
+    }
+
+    if ( depth != 0 )
+        return std::vector<std::string>();
+
+    endRun();
+
+    return runs;
+}
+
+// Only '*', '?' and the character classes are special in a wildcard
+// pattern (the backslash is a plain character).
+std::vector<std::string> LiteralPrefilter::wildcardLiterals(
+        const std::string& pattern )
+{
+    std::vector<std::string> runs;
+    std::string current;
+
+    for ( size_t i = 0; i < pattern.size(); i++ ) {
+        const char c = pattern[i];
+
+        if ( c == '*' || c == '?' || c == '[' ) {
+            if ( ! current.empty() )
+                runs.push_back( current );
+            current.clear();
+
+            if ( c == '[' ) {
+                // ']' first in the class being a plain character
+                i++;
+                if ( i < pattern.size() && ( pattern[i] == '^' || pattern[i] == '!' ) )
+                    i++;
+                if ( i < pattern.size() && pattern[i] == ']' )
+                    i++;
+                while ( i < pattern.size() && pattern[i] != ']' )
+                    i++;
+            }
+        }
+        else {
+            current += c;
+        }
+    }
+
+    if ( ! current.empty() )
+        runs.push_back( current );
+
+    return runs;
+}
+
+void LiteralPrefilter::buildShiftTable()
+{
+    const int length = literal_.size();
+
+    if ( caseInsensitive_ ) {
+        for ( char& c : literal_ )
+            c = foldCase( c );
+    }
+
+    for ( int i = 0; i < 256; i++ )
+        shift_[i] = length;
+
+    for ( int i = 0; i < length - 1; i++ ) {
+        const unsigned char c = literal_[i];
+        shift_[c] = length - 1 - i;
+        if ( caseInsensitive_ && c >= 'a' && c <= 'z' )
+            shift_[c - ( 'a' - 'A' )] = length - 1 - i;
+    }
+}
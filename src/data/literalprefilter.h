@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LITERALPREFILTER_H
+#define LITERALPREFILTER_H
+
+#include <string>
+#include <vector>
+
+#include <QRegExp>
+
+// Finds the lines which might match a search pattern by looking for a
+// literal string every matching line must contain, so the (much slower)
+// regexp is only run on these candidate lines.
+// The literal is found in raw UTF-8 data using Boyer-Moore-Horspool.
+// Case insensitive patterns are only supported if the literal is ASCII.
+// This class is immutable once built and can be shared between threads.
+class LiteralPrefilter
+{
+  public:
+    // Extract the literal from the pattern, isValid() tells whether
+    // one has been found.
+    explicit LiteralPrefilter( const QRegExp& regexp );
+
+    // Returns whether the pattern has a literal usable as a prefilter
+    bool isValid() const { return ! literal_.empty(); }
+    // Returns whether finding the literal is enough for a line to match
+    // (i.e. the pattern is the literal)
+    bool isExact() const { return exact_; }
+    // Returns whether the literal is searched for ignoring the case
+    // of ASCII letters (the literal being lower case then)
+    bool isCaseInsensitive() const { return caseInsensitive_; }
+    // Returns the literal (empty if it is not valid)
+    const std::string& literal() const { return literal_; }
+
+    // Returns the offset of the first occurrence of the literal
+    // in data, or -1 if there is none.
+    int find( const char* data, int length ) const;
+
+    // Returns the longest string any match of the (QRegExp or PCRE)
+    // pattern must contain, or an empty string if there is none or
+    // the pattern is too complex for us.
+    static std::string requiredLiteral( const std::string& pattern );
+    // Returns all the strings any match of the pattern must contain
+    // (none if the pattern is too complex for us).
+    static std::vector<std::string> requiredLiterals( const std::string& pattern );
+    // Idem for a QRegExp, in UTF-8, whatever its syntax.
+    static std::vector<std::string> requiredLiterals( const QRegExp& regexp );
+    // Returns whether every line the narrower pattern matches is
+    // matched by the wider one: the wider one being a plain string
+    // the narrower one requires (false if it cannot be told).
+    static bool isNarrower( const QRegExp& narrower, const QRegExp& wider );
+
+    // Shortest literal worth prefiltering on
+    static const size_t minimumLength;
+
+  private:
+    // Returns the runs of plain characters of a wildcard pattern
+    static std::vector<std::string> wildcardLiterals( const std::string& pattern );
+
+    void buildShiftTable();
+
+    std::string literal_;
+    bool caseInsensitive_;
+    bool exact_;
+    int shift_[256];
+};
+
+#endif
@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements LogComparison.
+
+#include "log.h"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+#include "abstractlogdata.h"
+#include "logcomparison.h"
+
+const int LogComparison::linesPerJob = 64 * 1024;
+const int LogComparison::linesPerRead = 8 * 1024;
+
+namespace {
+
+// Lines [leftBegin, leftEnd) and [rightBegin, rightEnd) to diff
+struct Range {
+    LineNumber leftBegin;
+    LineNumber leftEnd;
+    LineNumber rightBegin;
+    LineNumber rightEnd;
+};
+
+// Lines of each side matched
+struct Anchor {
+    LineNumber left;
+    LineNumber right;
+};
+
+// Largest ranges (in cells of the table) diffed by dynamic programming
+// when they have no line found once on each side
+const qint64 maxLcsCells = 4 * 1024 * 1024;
+
+const quint64 fnvOffset = 14695981039346656037ULL;
+const quint64 fnvPrime = 1099511628211ULL;
+
+inline bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool isWordChar( char c )
+{
+    return isDigit( c ) || ( c >= 'a' && c <= 'z' )
+        || ( c >= 'A' && c <= 'Z' ) || c == '_';
+}
+
+inline quint64 hashByte( quint64 hash, char c )
+{
+    return ( hash ^ static_cast<unsigned char>( c ) ) * fnvPrime;
+}
+
+// Returns the lines found once on each side of the range, in the
+// order of the longest increasing sequence of their right lines
+// (found by patience sorting).
+std::vector<Anchor> uniqueAnchors( const std::vector<quint64>& left,
+        const std::vector<quint64>& right, const Range& range )
+{
+    struct Occurrences {
+        int nbLeft;
+        int nbRight;
+        LineNumber right;
+    };
+
+    std::unordered_map<quint64, Occurrences> occurrences;
+    occurrences.reserve( range.leftEnd - range.leftBegin );
+    for ( LineNumber l = range.leftBegin; l < range.leftEnd; l++ )
+        occurrences[ left[l] ].nbLeft++;
+    for ( LineNumber r = range.rightBegin; r < range.rightEnd; r++ ) {
+        const auto occurrence = occurrences.find( right[r] );
+        if ( occurrence != occurrences.end() ) {
+            occurrence->second.nbRight++;
+            occurrence->second.right = r;
+        }
+    }
+
+    std::vector<Anchor> candidates;
+    for ( LineNumber l = range.leftBegin; l < range.leftEnd; l++ ) {
+        const Occurrences& occurrence = occurrences[ left[l] ];
+        if ( occurrence.nbLeft == 1 && occurrence.nbRight == 1 )
+            candidates.push_back( { l, occurrence.right } );
+    }
+
+    // The candidate on top of each pile, each candidate put on a pile
+    // being linked to the top of the previous pile
+    std::vector<size_t> piles;
+    std::vector<qint64> previous( candidates.size() );
+    for ( size_t i = 0; i < candidates.size(); i++ ) {
+        const auto pile = std::lower_bound( piles.begin(), piles.end(),
+                candidates[i].right, [&candidates]( size_t top, LineNumber line )
+                { return candidates[top].right < line; } );
+        previous[i] = ( pile == piles.begin() ) ? -1 : *( pile - 1 );
+        if ( pile == piles.end() )
+            piles.push_back( i );
+        else
+            *pile = i;
+    }
+
+    std::vector<Anchor> anchors;
+    if ( ! piles.empty() ) {
+        for ( qint64 i = piles.back(); i >= 0; i = previous[i] )
+            anchors.push_back( candidates[i] );
+        std::reverse( anchors.begin(), anchors.end() );
+    }
+
+    return anchors;
+}
+
+// Returns the longest common subsequence of the range
+std::vector<Anchor> lcsAnchors( const std::vector<quint64>& left,
+        const std::vector<quint64>& right, const Range& range )
+{
+    const LineNumber nbLeft = range.leftEnd - range.leftBegin;
+    const LineNumber nbRight = range.rightEnd - range.rightBegin;
+    const LineNumber width = nbRight + 1;
+
+    // Length of the subsequence of the lines from (i, j)
+    std::vector<uint32_t> lengths( ( nbLeft + 1 ) * width, 0 );
+    for ( LineNumber i = nbLeft - 1; i >= 0; i-- ) {
+        for ( LineNumber j = nbRight - 1; j >= 0; j-- ) {
+            lengths[ i * width + j ] =
+                ( left[ range.leftBegin + i ] == right[ range.rightBegin + j ] ) ?
+                lengths[ ( i + 1 ) * width + j + 1 ] + 1 :
+                qMax( lengths[ ( i + 1 ) * width + j ], lengths[ i * width + j + 1 ] );
+        }
+    }
+
+    std::vector<Anchor> anchors;
+    LineNumber i = 0;
+    LineNumber j = 0;
+    while ( i < nbLeft && j < nbRight ) {
+        if ( left[ range.leftBegin + i ] == right[ range.rightBegin + j ] ) {
+            anchors.push_back( { range.leftBegin + i, range.rightBegin + j } );
+            i++;
+            j++;
+        }
+        else if ( lengths[ ( i + 1 ) * width + j ] >= lengths[ i * width + j + 1 ] ) {
+            i++;
+        }
+        else {
+            j++;
+        }
+    }
+
+    return anchors;
+}
+
+}
+
+LogComparison::LogComparison( const AbstractLogData* left,
+        const AbstractLogData* right, bool maskVariables )
+    : QObject(), left_( left ), right_( right ),
+    leftNbLines_( left->getNbLine() ), rightNbLines_( right->getNbLine() ),
+    maskVariables_( maskVariables ), leftOnly_(), rightOnly_(),
+    finished_( false ), interruptRequested_( false ), nbLinesHashed_( 0 ),
+    progress_( 0 ), taskMutex_(), task_()
+{
+}
+
+LogComparison::~LogComparison()
+{
+    interrupt();
+}
+
+void LogComparison::start( TaskScheduler::Priority priority )
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    task_ = TaskScheduler::instance().submit( [this] { run(); }, priority );
+}
+
+void LogComparison::interrupt()
+{
+    TaskScheduler::TaskHandle task;
+    bool cancelled;
+    {
+        QMutexLocker locker( &taskMutex_ );
+
+        interruptRequested_ = true;
+        cancelled = TaskScheduler::instance().cancel( task_ );
+        if ( ! cancelled )
+            TaskScheduler::instance().expedite( task_ );
+        task = task_;
+    }
+
+    if ( cancelled )
+        emit comparisonFinished( false );
+    else
+        TaskScheduler::instance().wait( task );
+}
+
+quint64 LogComparison::hashLine( const char* line, int length,
+        bool maskVariables )
+{
+    while ( length > 0 && ( line[length - 1] == ' '
+                || line[length - 1] == '\t' || line[length - 1] == '\r' ) )
+        length--;
+
+    quint64 hash = fnvOffset;
+    int i = 0;
+    while ( i < length ) {
+        if ( maskVariables && isWordChar( line[i] ) ) {
+            int end = i;
+            bool variable = false;
+            while ( end < length && isWordChar( line[end] ) )
+                variable = isDigit( line[end++] ) || variable;
+
+            if ( variable ) {
+                hash = hashByte( hash, '#' );
+                i = end;
+            }
+            else {
+                for ( ; i < end; i++ )
+                    hash = hashByte( hash, line[i] );
+            }
+        }
+        else {
+            hash = hashByte( hash, line[i++] );
+        }
+    }
+
+    return hash;
+}
+
+// The ranges are diffed in the order of their lines (the first one
+// being on top of the stack), so the lines of each side not in the
+// other one are found in order.
+void LogComparison::diff( const std::vector<quint64>& left,
+        const std::vector<quint64>& right,
+        MatchSet* leftOnly, MatchSet* rightOnly )
+{
+    std::vector<Range> ranges;
+    ranges.push_back( { 0, LineNumber( left.size() ),
+            0, LineNumber( right.size() ) } );
+
+    while ( ! ranges.empty() ) {
+        Range range = ranges.back();
+        ranges.pop_back();
+
+        // The lines the same at the start and at the end
+        while ( range.leftBegin < range.leftEnd && range.rightBegin < range.rightEnd
+                && left[ range.leftBegin ] == right[ range.rightBegin ] ) {
+            range.leftBegin++;
+            range.rightBegin++;
+        }
+        while ( range.leftBegin < range.leftEnd && range.rightBegin < range.rightEnd
+                && left[ range.leftEnd - 1 ] == right[ range.rightEnd - 1 ] ) {
+            range.leftEnd--;
+            range.rightEnd--;
+        }
+
+        std::vector<Anchor> anchors;
+        if ( range.leftBegin < range.leftEnd && range.rightBegin < range.rightEnd ) {
+            anchors = uniqueAnchors( left, right, range );
+            if ( anchors.empty() && ( range.leftEnd - range.leftBegin )
+                    * ( range.rightEnd - range.rightBegin ) <= maxLcsCells )
+                anchors = lcsAnchors( left, right, range );
+        }
+
+        if ( anchors.empty() ) {
+            for ( LineNumber l = range.leftBegin; l < range.leftEnd; l++ )
+                leftOnly->append( l );
+            for ( LineNumber r = range.rightBegin; r < range.rightEnd; r++ )
+                rightOnly->append( r );
+            continue;
+        }
+
+        // The ranges between the anchors, the first one on top
+        ranges.push_back( { anchors.back().left + 1, range.leftEnd,
+                anchors.back().right + 1, range.rightEnd } );
+        for ( size_t a = anchors.size() - 1; a > 0; a-- )
+            ranges.push_back( { anchors[a - 1].left + 1, anchors[a].left,
+                    anchors[a - 1].right + 1, anchors[a].right } );
+        ranges.push_back( { range.leftBegin, anchors.front().left,
+                range.rightBegin, anchors.front().right } );
+    }
+}
+
+void LogComparison::run()
+{
+    std::vector<quint64> left_hashes;
+    std::vector<quint64> right_hashes;
+    const bool success = hashLines( &left_hashes, &right_hashes );
+
+    if ( success ) {
+        diff( left_hashes, right_hashes, &leftOnly_, &rightOnly_ );
+        finished_ = true;
+        emit comparisonProgressed( 100 );
+    }
+    else {
+        LOG(logWARNING) << "Comparison of the files not completed";
+    }
+
+    emit comparisonFinished( success );
+}
+
+// The chunks of lines of both sources are hashed by the threads in
+// turn, the task's thread being one of them.
+bool LogComparison::hashLines( std::vector<quint64>* leftHashes,
+        std::vector<quint64>* rightHashes )
+{
+    struct Job {
+        const AbstractLogData* source;
+        LineNumber first;
+        LineNumber end;
+        quint64* hashes;
+    };
+
+    leftHashes->resize( leftNbLines_ );
+    rightHashes->resize( rightNbLines_ );
+
+    std::vector<Job> jobs;
+    for ( LineNumber first = 0; first < leftNbLines_; first += linesPerJob )
+        jobs.push_back( { left_, first, qMin( first + linesPerJob, leftNbLines_ ),
+                leftHashes->data() + first } );
+    for ( LineNumber first = 0; first < rightNbLines_; first += linesPerJob )
+        jobs.push_back( { right_, first, qMin( first + linesPerJob, rightNbLines_ ),
+                rightHashes->data() + first } );
+
+    std::atomic<size_t> next_job( 0 );
+    std::atomic<bool> failed( false );
+    auto hash_jobs = [&] {
+        for ( size_t j = next_job++; j < jobs.size() && ! failed; j = next_job++ ) {
+            if ( ! hashLineRange( jobs[j].source, jobs[j].first, jobs[j].end,
+                        jobs[j].hashes ) )
+                failed = true;
+        }
+    };
+
+    const int nb_threads = qBound( 1,
+            qMin<int>( TaskScheduler::instance().maxThreads(), jobs.size() ), 64 );
+    std::vector<std::thread> threads;
+    for ( int i = 1; i < nb_threads; i++ )
+        threads.emplace_back( hash_jobs );
+    hash_jobs();
+    for ( std::thread& thread : threads )
+        thread.join();
+
+    return ! failed;
+}
+
+bool LogComparison::hashLineRange( const AbstractLogData* source,
+        LineNumber first, LineNumber end, quint64* hashes )
+{
+    std::vector<int> lineEnds;
+    for ( LineNumber line = first; line < end; line += linesPerRead ) {
+        if ( interruptRequested_ )
+            return false;
+
+        const int number = qMin<LineNumber>( linesPerRead, end - line );
+        const QByteArray data = source->getRawLines( line, number, &lineEnds );
+        if ( lineEnds.size() != static_cast<size_t>( number ) ) {
+            // The file has been truncated since
+            LOG(logWARNING) << "Lines " << line << " to " << line + number
+                << " cannot be read to compare them";
+            return false;
+        }
+
+        int start = 0;
+        for ( int i = 0; i < number; i++ ) {
+            hashes[ line - first + i ] = hashLine( data.constData() + start,
+                    lineEnds[i] - start, maskVariables_ );
+            start = lineEnds[i] + 1;
+        }
+
+        const LineNumber nb_hashed = ( nbLinesHashed_ += number );
+        reportProgress( nb_hashed * 99 / ( leftNbLines_ + rightNbLines_ ) );
+    }
+
+    return true;
+}
+
+void LogComparison::reportProgress( int percent )
+{
+    int reported = progress_;
+    while ( percent > reported ) {
+        if ( progress_.compare_exchange_weak( reported, percent ) ) {
+            emit comparisonProgressed( percent );
+            return;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOGCOMPARISON_H
+#define LOGCOMPARISON_H
+
+#include <atomic>
+#include <vector>
+
+#include <QObject>
+#include <QMutex>
+
+#include "matchset.h"
+#include "taskscheduler.h"
+
+class AbstractLogData;
+
+// Compares the lines of two sources (a good and a bad run of a
+// program), finding the lines of each one not in the other, as a task
+// of the TaskScheduler.
+// The lines are compared by a hash of their text, computed in parallel
+// by chunks of lines read undecoded (see AbstractLogData::getRawLines),
+// so millions of lines are compared without comparing their strings.
+// The words having a digit (timestamps, ids, counters) can be masked,
+// so the lines only differing by them are the same.
+// The hashes are then diffed as in the patience diff: the lines found
+// once on each side are matched in the order of the longest increasing
+// sequence of them, the lines between them being diffed the same way.
+class LogComparison : public QObject
+{
+  Q_OBJECT
+
+  public:
+    // The lines of the sources are the ones they have when created
+    LogComparison( const AbstractLogData* left, const AbstractLogData* right,
+            bool maskVariables );
+    // Interrupts the comparison if it is running
+    ~LogComparison();
+
+    // Start comparing the lines
+    void start( TaskScheduler::Priority priority );
+    // Stop comparing, waiting for the task to end
+    void interrupt();
+    // Returns whether the comparison has succeeded (the results can
+    // then be read)
+    bool isFinished() const { return finished_; }
+
+    // The lines of each source not in the other one
+    const MatchSet& leftOnly() const { return leftOnly_; }
+    const MatchSet& rightOnly() const { return rightOnly_; }
+
+    // Returns the hash of the line of length bytes (its spaces at the
+    // end excluded), the words having a digit being replaced by one
+    // character if maskVariables is set
+    static quint64 hashLine( const char* line, int length,
+            bool maskVariables );
+    // Sets the indexes of the left hashes not in the right ones, and
+    // the other way round
+    static void diff( const std::vector<quint64>& left,
+            const std::vector<quint64>& right,
+            MatchSet* leftOnly, MatchSet* rightOnly );
+
+  signals:
+    // Sent while the lines are compared, with the percentage done
+    void comparisonProgressed( int percent );
+    // Sent at the end, success being false if the comparison has been
+    // interrupted or the lines cannot be read
+    void comparisonFinished( bool success );
+
+  private:
+    // Lines hashed by a thread at once
+    static const int linesPerJob;
+    // Most lines read at once
+    static const int linesPerRead;
+
+    // Run in the task
+    void run();
+    // Hash the lines of both sources, returns false if interrupted
+    // or if they cannot be read
+    bool hashLines( std::vector<quint64>* leftHashes,
+            std::vector<quint64>* rightHashes );
+    // Hash the lines [first, end) of the source to hashes
+    bool hashLineRange( const AbstractLogData* source, LineNumber first,
+            LineNumber end, quint64* hashes );
+    // Report the progress if it has gone past the last one reported
+    void reportProgress( int percent );
+
+    const AbstractLogData* const left_;
+    const AbstractLogData* const right_;
+    const LineNumber leftNbLines_;
+    const LineNumber rightNbLines_;
+    const bool maskVariables_;
+
+    MatchSet leftOnly_;
+    MatchSet rightOnly_;
+    std::atomic<bool> finished_;
+    std::atomic<bool> interruptRequested_;
+    std::atomic<LineNumber> nbLinesHashed_;
+    std::atomic<int> progress_;
+
+    // Protects task_
+    QMutex taskMutex_;
+    TaskScheduler::TaskHandle task_;
+};
+
+#endif
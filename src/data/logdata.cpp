@@ -22,15 +22,27 @@
 #include <iostream>
 
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 
 #include <QFileInfo>
+#include <QHash>
+
+#ifndef WIN32
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
 
 #include "log.h"
+#include "perfcounters.h"
 
 #include "logdata.h"
 #include "logfiltereddata.h"
-#if defined(GLOGG_SUPPORTS_INOTIFY) || defined(WIN32)
+#include "scanreader.h"
+#if defined(GLOGG_SUPPORTS_INOTIFY) || defined(GLOGG_SUPPORTS_KQUEUE) || defined(WIN32)
 #include "platformfilewatcher.h"
+#include "filepoller.h"
 #else
 #include "qtfilewatcher.h"
 #endif
@@ -59,21 +71,66 @@ void LogData::PartialIndexOperation::doStart(
     workerThread.indexAdditionalLines( filesize_ );
 }
 
+void LogData::RotationIndexOperation::doStart(
+        LogDataWorkerThread& workerThread ) const
+{
+    LOG(logDEBUG) << "Reindexing (rotation)";
+    workerThread.indexRotatedFile();
+}
+
+
+// A fingerprint every 10000 lines, of the last 256 bytes of the line
+const qint64 LogData::fingerprintInterval = 10000;
+const int LogData::fingerprintSize = 256;
+// Growth of a file not displayed is indexed at most every 2 s
+const int LogData::backgroundGrowthDelay = 2000;
+// The column checkpoints of 100 long lines
+const int LogData::longLinesCacheSize = 100;
+// Lines up to 64 KiB apart are read at once
+const int LogData::sparseReadGap = 64 * 1024;
+// The data of a network file are cached by blocks of 64 KiB
+const qint64 LogData::cachedBlockSize = 64 * 1024;
+
+namespace {
+    // Returns whether the file is on a network file system
+    bool isOnNetworkFileSystem( const QString& fileName )
+    {
+#if defined(GLOGG_SUPPORTS_INOTIFY) || defined(GLOGG_SUPPORTS_KQUEUE) || defined(WIN32)
+        return FilePoller::isOnNetworkFileSystem( fileName );
+#else
+        Q_UNUSED( fileName );
+        return false;
+#endif
+    }
+}
 
 // Constructs an empty log file.
 // It must be displayed without error.
-LogData::LogData() : AbstractLogData(), linePosition_(),
-    fileMutex_(), dataMutex_(), workerThread_()
+LogData::LogData() : AbstractLogData(),
+    index_( std::make_shared<const IndexSnapshot>() ),
+    timestampRule_( QRegExp() ), estimate_(), fileMutex_(), workerThread_(),
+    columnIndex_( workerThread_.columnIndex() ),
+    runIndex_( workerThread_.runIndex() ),
+    longLinesMutex_(), longLines_( longLinesCacheSize ),
+    lineCache_( [this]( qint64 first_line, int number )
+            { return readLines( first_line, number, true ); } )
 {
     // Start with an "empty" log
     attached_file_ = nullptr;
-    fileSize_      = 0;
-    nbLines_       = 0;
-    maxLength_     = 0;
+    mapped_file_   = nullptr;
+    mappedData_    = nullptr;
+    mappedSize_    = 0;
+    fileStart_     = 0;
+    fileChangedOnDisk_ = Unchanged;
     currentOperation_ = nullptr;
     nextOperation_    = nullptr;
+    growthCoalescingDelay_ = 0;
+    priority_       = TaskScheduler::Background;
+    followRotation_ = false;
+    rotating_       = false;
+    prefixShown_    = false;
 
-#if defined(GLOGG_SUPPORTS_INOTIFY) || defined(WIN32)
+#if defined(GLOGG_SUPPORTS_INOTIFY) || defined(GLOGG_SUPPORTS_KQUEUE) || defined(WIN32)
     fileWatcher_ = std::make_shared<PlatformFileWatcher>();
 #else
     fileWatcher_ = std::make_shared<QtFileWatcher>();
@@ -83,17 +140,29 @@ LogData::LogData() : AbstractLogData(), linePosition_(),
     connect( fileWatcher_.get(), SIGNAL( fileChanged( const QString& ) ),
             this, SLOT( fileChangedOnDisk() ) );
     // Forward the update signal
+    // (queued, even when an operation is run in this thread by
+    // LogDataWorkerThread, not to be called back from within it)
     connect( &workerThread_, SIGNAL( indexingProgressed( int ) ),
-            this, SIGNAL( loadingProgressed( int ) ) );
+            this, SIGNAL( loadingProgressed( int ) ), Qt::QueuedConnection );
     connect( &workerThread_, SIGNAL( indexingFinished( LoadingStatus ) ),
-            this, SLOT( indexingFinished( LoadingStatus ) ) );
-
-    // Starts the worker thread
-    workerThread_.start();
+            this, SLOT( indexingFinished( LoadingStatus ) ),
+            Qt::QueuedConnection );
+    connect( &workerThread_, SIGNAL( linesIndexed() ),
+            this, SLOT( showIndexedLines() ), Qt::QueuedConnection );
+    connect( &workerThread_, SIGNAL( linesEstimated() ),
+            this, SLOT( showEstimate() ), Qt::QueuedConnection );
+
+    growthTimer_.setSingleShot( true );
+    connect( &growthTimer_, SIGNAL( timeout() ),
+            this, SLOT( indexGrowth() ) );
+
+    MemoryBudget::instance().addClient( this );
 }
 
 LogData::~LogData()
 {
+    MemoryBudget::instance().removeClient( this );
+
     // Remove the current file from the watch list
     if ( attached_file_ )
         fileWatcher_->removeFile( attached_file_->fileName() );
@@ -115,11 +184,21 @@ void LogData::attachFile( const QString& fileName )
         throw CantReattachErr();
     }
 
+    // A pipe (or the standard input) cannot be seeked back so it is
+    // copied to a file, followed as it grows.
+    QString indexedFileName = fileName;
+    if ( ! spooler_ && PipeSpooler::isPipe( fileName ) ) {
+        spooler_.reset( new PipeSpooler( fileName ) );
+        if ( spooler_->start() )
+            indexedFileName = spooler_->spoolFileName();
+    }
+
     workerThread_.interrupt();
 
     // If an attach operation is already in progress, the new one will
     // be delayed until the current one is finished (canceled)
-    std::shared_ptr<const LogDataOperation> operation( new AttachOperation( fileName ) );
+    std::shared_ptr<const LogDataOperation> operation(
+            new AttachOperation( indexedFileName ) );
     enqueueOperation( std::move( operation ) );
 }
 
@@ -128,9 +207,14 @@ void LogData::interruptLoading()
     workerThread_.interrupt();
 }
 
+bool LogData::isLoaded() const
+{
+    return attached_file_ && ! currentOperation_;
+}
+
 qint64 LogData::getFileSize() const
 {
-    return fileSize_;
+    return index()->fileSize;
 }
 
 QDateTime LogData::getLastModifiedDate() const
@@ -138,6 +222,79 @@ QDateTime LogData::getLastModifiedDate() const
     return lastModifiedDate_;
 }
 
+qint64 LogData::getEstimatedNbLine() const
+{
+    const qint64 nb_lines = index()->nbLines;
+
+    return estimate_ ? qMax( estimate_->nbLines(), nb_lines ) : nb_lines;
+}
+
+bool LogData::getLineAtFraction( double fraction, qint64* line ) const
+{
+    std::shared_ptr<const IndexSnapshot> index = this->index();
+
+    const qint64 size = estimate_ ? estimate_->size() : index->fileSize;
+    const qint64 position = qBound( 0LL, qint64( size * fraction ), size );
+
+    // Beyond the lines indexed, their number is only estimated
+    if ( estimate_ && position >= index->fileSize ) {
+        *line = qMax( estimate_->lineAt( position ), index->nbLines );
+        return false;
+    }
+
+    // The line ending after the position
+    qint64 first = 0;
+    qint64 last = index->nbLines;
+    while ( first < last ) {
+        const qint64 middle = first + ( last - first ) / 2;
+        if ( index->linePosition.at( middle ) <= position )
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    *line = qMin( first, qMax( index->nbLines - 1, 0LL ) );
+
+    return true;
+}
+
+QString LogData::getLineStartingAfter( double fraction ) const
+{
+    // The longest line read
+    static const int maxLineSize = 64*1024;
+
+    if ( ! estimate_ || ! currentOperation_ )
+        return QString();
+
+    QFile file( currentOperation_->getFilename() );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return QString();
+
+    const qint64 size = estimate_->size();
+    const qint64 start = CheckpointIndex::lineStartAfter( &file, size,
+            qBound( 0LL, qint64( size * fraction ), size ) );
+    if ( start >= size || ! file.seek( start ) )
+        return QString();
+
+    QByteArray line = file.read( qMin<qint64>( maxLineSize, size - start ) );
+    const int end = line.indexOf( '\n' );
+    if ( end >= 0 )
+        line.truncate( end );
+
+    return LineDecoder( index()->encoding ).decode(
+            line.constData(), line.size(), true );
+}
+
+void LogData::setIndexingFocus( double fraction )
+{
+    workerThread_.setIndexingFocus( ( estimate_ && fraction >= 0 ) ?
+            qint64( estimate_->size() * fraction ) : -1 );
+}
+
+void LogData::setIndexingTail( bool tail )
+{
+    workerThread_.setIndexingTail( tail );
+}
+
 // Return an initialised LogFilteredData. The search is not started.
 LogFilteredData* LogData::getNewFilteredData() const
 {
@@ -150,9 +307,247 @@ void LogData::reload()
 {
     workerThread_.interrupt();
 
+    {
+        // The file might have been truncated (or replaced)
+        PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+        unmapFile();
+        if ( attached_file_ )
+            attached_file_->close();
+        if ( blockCache_ )
+            blockCache_->clear();
+        lineCache_.clear();
+    }
+    {
+        QMutexLocker locker( &longLinesMutex_ );
+        longLines_.clear();
+    }
+
     enqueueOperation( std::make_shared<FullIndexOperation>() );
 }
 
+LogData::MonitoredFileStatus LogData::reloadChanges()
+{
+    // A compressed or rotated file can only be read again from its start
+    if ( ! attached_file_ || currentOperation_ || readThrough_
+            || ( followRotation_ && isRotated() ) )
+        return Truncated;
+
+    const QFileInfo info( attached_file_->fileName() );
+    if ( ! info.exists() )
+        return Truncated;
+
+    const qint64 kept_lines = unchangedLines( info.size() );
+    if ( kept_lines == 0 )
+        return Truncated;
+
+    if ( kept_lines == index()->nbLines
+            && info.size() == index()->fileSize - fileStart_ ) {
+        if ( info.lastModified() == lastModifiedDate_ ) {
+            LOG(logINFO) << "Reload: file unchanged";
+            return Unchanged;
+        }
+
+        // Changed in place where the fingerprints do not tell, any
+        // line might have changed
+        LOG(logINFO) << "Reload: file changed in place";
+        return Truncated;
+    }
+
+    {
+        // The file might have been replaced
+        PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+        unmapFile();
+        attached_file_->close();
+    }
+    growthTimer_.stop();
+
+    LOG(logINFO) << "Reload: the first " << kept_lines << " lines are unchanged";
+    fileChangedOnDisk_ = PartiallyTruncated;
+    truncateIndex( kept_lines );
+    enqueueOperation( std::make_shared<PartialIndexOperation>(
+                index()->fileSize ) );
+
+    lastModifiedDate_ = info.lastModified();
+    emit fileChanged( fileChangedOnDisk_ );
+
+    return PartiallyTruncated;
+}
+
+void LogData::setGrowthCoalescingDelay( int msecs )
+{
+    growthCoalescingDelay_ = msecs;
+
+    // Growth waiting for a window is handled as usual now
+    if ( msecs <= 0 && growthTimer_.isActive() ) {
+        growthTimer_.stop();
+        fileChangedOnDisk();
+    }
+}
+
+void LogData::setFollowRotation( bool follow )
+{
+#ifndef WIN32
+    followRotation_ = follow;
+#else
+    Q_UNUSED( follow );
+#endif
+}
+
+void LogData::setTimestampRule( const TimestampRule& rule )
+{
+    timestampRule_ = rule;
+    workerThread_.setTimestampRule( rule );
+
+    // The lines already indexed (or being) have not been sampled
+    if ( attached_file_ || currentOperation_ )
+        enqueueOperation( std::make_shared<FullIndexOperation>() );
+}
+
+void LogData::setEncoding( TextEncoding encoding )
+{
+    workerThread_.setEncoding( encoding );
+
+    // The positions of the lines depend on the encoding
+    if ( attached_file_ || currentOperation_ )
+        enqueueOperation( std::make_shared<FullIndexOperation>() );
+}
+
+TextEncoding LogData::getEncoding() const
+{
+    return index()->encoding;
+}
+
+void LogData::setRecordLineLengths( bool record )
+{
+    workerThread_.setRecordLineLengths( record );
+
+    if ( attached_file_ || currentOperation_ )
+        enqueueOperation( std::make_shared<FullIndexOperation>() );
+}
+
+void LogData::setBuildSkipIndex( bool build )
+{
+    workerThread_.setBuildSkipIndex( build );
+
+    if ( attached_file_ || currentOperation_ )
+        enqueueOperation( std::make_shared<FullIndexOperation>() );
+}
+
+void LogData::setFusedSearch( const QRegExp& regexp )
+{
+    fusedSearch_ = std::make_shared<FusedSearch>( regexp );
+    workerThread_.setFusedSearch( fusedSearch_ );
+}
+
+void LogData::setPriority( TaskScheduler::Priority priority )
+{
+    priority_ = priority;
+    workerThread_.setPriority( priority );
+    MemoryBudget::instance().setPriority( this, priority );
+
+    // The growth waiting is indexed sooner once displayed
+    if ( growthTimer_.isActive()
+            && growthTimer_.remainingTime() > growthDelay() )
+        growthTimer_.start( growthDelay() );
+}
+
+int LogData::growthDelay() const
+{
+    if ( priority_ == TaskScheduler::Background && growthCoalescingDelay_ > 0 )
+        return qMax( growthCoalescingDelay_, backgroundGrowthDelay );
+    else
+        return growthCoalescingDelay_;
+}
+
+qint64 LogData::doGetLineAtTime( qint64 timestamp ) const
+{
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    if ( ! index->timestamps )
+        return -1;
+
+    qint64 first, last;
+    index->timestamps->findRange( timestamp, index->nbLines, &first, &last );
+
+    const TimestampRule& rule = *index->timestampRule;
+    for ( qint64 line = first; line < last; ) {
+        const int number = qMin<qint64>( last - line, TimestampIndex::interval );
+        const QStringList lines = getLines( line, number );
+        if ( lines.isEmpty() )
+            break;
+
+        for ( const QString& string : lines ) {
+            if ( rule.timestamp( string ) >= timestamp )
+                return line;
+            line++;
+        }
+    }
+
+    return last;
+}
+
+bool LogData::doGetTimeRange( qint64* first, qint64* last ) const
+{
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    if ( ! index->timestamps || ! index->timestamps->timeRange( first, last ) )
+        return false;
+
+    if ( index->nbLines > 0 ) {
+        const qint64 timestamp = index->timestampRule->timestamp(
+                getLineString( index->nbLines - 1 ) );
+        *last = qMax( *last, timestamp );
+    }
+
+    return true;
+}
+
+QByteArray LogData::doGetRawLines( qint64 first_line, int number,
+        std::vector<int>* lineEnds ) const
+{
+    QByteArray blob;
+    doFillRawLines( first_line, number, &blob, lineEnds );
+
+    return blob;
+}
+
+// Note this function is called from the LogFilteredDataWorker thread.
+// Only UTF-8 data can be passed as read, the lines of a file in another
+// encoding being decoded then encoded in UTF-8.
+void LogData::doFillRawLines( qint64 first_line, int number,
+        QByteArray* data, std::vector<int>* lineEnds ) const
+{
+    const qint64 last_line = first_line + number - 1;
+
+    lineEnds->clear();
+
+    if ( number == 0 ) {
+        data->resize( 0 );
+        return;
+    }
+
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+
+    if ( index->encoding != TextEncoding::Utf8
+            && index->encoding != TextEncoding::Auto ) {
+        *data = AbstractLogData::doGetRawLines( first_line, number, lineEnds );
+        return;
+    }
+
+    if ( last_line >= index->nbLines ) {
+        LOG(logWARNING) << "LogData::doGetRawLines Lines out of bound asked for";
+        data->resize( 0 );
+        return; /* exception? */
+    }
+
+    const SharedLinePositionArray& linePosition = index->linePosition;
+    const qint64 first_byte = (first_line == 0) ? 0 : linePosition[first_line-1];
+    const qint64 last_byte  = linePosition[last_line];
+    readFileData( index->fileSize, first_byte, last_byte, data );
+
+    lineEnds->reserve( number );
+    for ( qint64 line = first_line; line <= last_line; line++ )
+        lineEnds->push_back( linePosition[line] - first_byte - 1 );
+}
+
 //
 // Private functions
 //
@@ -171,6 +566,8 @@ void LogData::enqueueOperation( std::shared_ptr<const LogDataOperation> new_oper
     {
         // An operation is in progress...
         // ... we schedule the attach op for later
+        if ( nextOperation_ && nextOperation_->isRotation() )
+            rotating_ = false;
         nextOperation_ = new_operation;
     }
 }
@@ -186,9 +583,7 @@ void LogData::startOperation()
         // If it's a full indexing ...
         // ... we invalidate the non indexed data
         if ( currentOperation_->isFull() ) {
-            fileSize_     = 0;
-            nbLines_      = 0;
-            maxLength_    = 0;
+            publishIndex( std::make_shared<const IndexSnapshot>() );
         }
 
         // And let the operation do its stuff
@@ -211,17 +606,85 @@ void LogData::fileChangedOnDisk()
 
     std::shared_ptr<LogDataOperation> newOperation;
 
-    LOG(logDEBUG) << "current fileSize=" << fileSize_;
+    const qint64 file_size = index()->fileSize;
+
+    LOG(logDEBUG) << "current fileSize=" << file_size;
     LOG(logDEBUG) << "info file_->size()=" << info.size();
-    if ( info.size() < fileSize_ ) {
+    if ( followRotation_ && ! info.exists() ) {
+        // Probably rotated and not created again yet, the lines are
+        // kept until it is.
+        LOG(logINFO) << "File removed, waiting for it to be created";
+        return;
+    }
+    else if ( readThrough_ ) {
+        // A compressed file can only be decompressed again from its start
+        if ( fileChangedOnDisk_ == Truncated )
+            return;
+
+        LOG(logINFO) << "Compressed file changed";
         fileChangedOnDisk_ = Truncated;
-        LOG(logINFO) << "File truncated";
+        growthTimer_.stop();
         newOperation = std::make_shared<FullIndexOperation>();
     }
-    else if ( fileChangedOnDisk_ != DataAdded ) {
+    else if ( followRotation_ && isRotated() ) {
+        // Until the rotation is indexed, the file opened is the old one
+        if ( rotating_ )
+            return;
+
+        LOG(logINFO) << "File rotated";
+        rotating_ = true;
+        fileChangedOnDisk_ = DataAdded;
+        // The end of the rotated file is indexed with the new one
+        growthTimer_.stop();
+        newOperation = std::make_shared<RotationIndexOperation>();
+    }
+    else if ( info.size() < file_size - fileStart_ ) {
+        {
+            // Reading the mapping past the new end would crash
+            // (and the file might have been replaced)
+            PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+            unmapFile();
+            attached_file_->close();
+        }
+        // The reindexing includes the growth waiting
+        growthTimer_.stop();
+
+        // Only the lines after the last ones unchanged are indexed
+        // again (if the index is not being changed meanwhile).
+        const qint64 kept_lines = currentOperation_ ?
+            0 : unchangedLines( info.size() );
+        if ( kept_lines > 0 ) {
+            fileChangedOnDisk_ = PartiallyTruncated;
+            LOG(logINFO) << "File truncated, the first "
+                << kept_lines << " lines are unchanged";
+            truncateIndex( kept_lines );
+            newOperation = std::make_shared<PartialIndexOperation>(
+                    index()->fileSize );
+        }
+        else {
+            fileChangedOnDisk_ = Truncated;
+            LOG(logINFO) << "File truncated";
+            newOperation = std::make_shared<FullIndexOperation>();
+        }
+    }
+    else if ( growthCoalescingDelay_ > 0 ) {
+        // Only the first growth of the window is reported,
+        // the file is indexed when it closes.
+        if ( growthTimer_.isActive() )
+            return;
+
+        LOG(logINFO) << "New data on disk, indexed in "
+            << growthDelay() << " ms";
+        growthTimer_.start( growthDelay() );
+        lastModifiedDate_ = info.lastModified();
+        emit fileChanged( DataAdded );
+        return;
+    }
+    else if ( fileChangedOnDisk_ != DataAdded
+            && fileChangedOnDisk_ != PartiallyTruncated ) {
         fileChangedOnDisk_ = DataAdded;
         LOG(logINFO) << "New data on disk";
-        newOperation = std::make_shared<PartialIndexOperation>( fileSize_ );
+        newOperation = std::make_shared<PartialIndexOperation>( file_size );
     }
 
     if ( newOperation )
@@ -237,17 +700,116 @@ void LogData::indexingFinished( LoadingStatus status )
 {
     LOG(logDEBUG) << "Entering LogData::indexingFinished.";
 
-    // We use the newly created file data or restore the old ones.
-    // (Qt implicit copy makes this fast!)
+    // We use the newly indexed data or keep the old ones,
+    // the readers still using the previous ones keep them until done.
+    // When the file has grown, only the new positions are handed over
+    // and the existing ones are shared with the previous version.
+    const qint64 previous_nb_lines = index()->nbLines;
+
+    // The file opened becomes a rotated file before the lines of the
+    // new one are published.
+    if ( currentOperation_->isRotation() ) {
+        rotating_ = false;
+
+        PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+        if ( status == LoadingStatus::Successful ) {
+            qint64 rotated_size, file_start;
+            workerThread_.getRotation( &rotated_size, &file_start );
+            chainRotatedFile( rotated_size, file_start );
+        }
+        else {
+            // The worker has left the rotated file, start again
+            unmapFile();
+            attached_file_->close();
+            if ( ! nextOperation_ || ! nextOperation_->isFull() )
+                nextOperation_ = std::make_shared<FullIndexOperation>();
+        }
+    }
+
+    // The file attached is read through attached_file_ from now on
+    // (its lines being known)
+    if ( currentOperation_->isFull() ) {
+        estimate_.reset();
+        workerThread_.setIndexingFocus( -1 );
+
+        PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+        indexingFile_.reset();
+    }
+
     {
-        QMutexLocker locker( &dataMutex_ );
-        workerThread_.getIndexingData( &fileSize_, &maxLength_, &linePosition_ );
-        nbLines_ = linePosition_.size();
+        LinePositionArray new_positions;
+        TimestampIndex::Samples new_samples;
+        SkipIndex::Blocks new_blocks;
+        // (the lines shown while the file was being attached are
+        // dropped if it has not been, a reindexing interrupted keeping
+        // the previous ones)
+        std::shared_ptr<IndexSnapshot> index =
+            ( prefixShown_ && status != LoadingStatus::Successful ) ?
+            std::make_shared<IndexSnapshot>() :
+            std::make_shared<IndexSnapshot>( *this->index() );
+        prefixShown_ = false;
+        if ( workerThread_.takeIndexingData( &index->fileSize,
+                    &index->maxLength, &new_positions, &new_samples,
+                    &new_blocks, &index->encoding ) ) {
+            index->linePosition = SharedLinePositionArray();
+            index->timestamps.reset();
+            index->timestampRule.reset();
+            index->skipIndex.reset();
+            if ( timestampRule_.isValid() ) {
+                index->timestamps = std::make_shared<const TimestampIndex>();
+                index->timestampRule =
+                    std::make_shared<const TimestampRule>( timestampRule_ );
+            }
+
+            fingerprints_.clear();
+
+            // The rotated files are not part of the new data
+            PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+            rotatedFiles_.clear();
+            fileStart_ = 0;
+            readThrough_ = workerThread_.getReadThroughFile();
+        }
+        // The samples (and blocks) are numbered from the first new
+        // position, which replaces the fake final LF if there is one.
+        const qint64 first_new_line = index->linePosition.size()
+            - ( index->linePosition.hasFakeFinalLF() ? 1 : 0 );
+        index->linePosition.append( std::move( new_positions ) );
+        index->nbLines = index->linePosition.size();
+        if ( index->timestamps && ! new_samples.empty() ) {
+            std::shared_ptr<TimestampIndex> timestamps =
+                std::make_shared<TimestampIndex>( *index->timestamps );
+            timestamps->append( new_samples, first_new_line );
+            index->timestamps = timestamps;
+        }
+        if ( ! new_blocks.empty() ) {
+            std::shared_ptr<SkipIndex> skip_index = index->skipIndex ?
+                std::make_shared<SkipIndex>( *index->skipIndex ) :
+                std::make_shared<SkipIndex>();
+            skip_index->append( new_blocks, first_new_line );
+            index->skipIndex = skip_index;
+        }
+        publishIndex( index );
+    }
+    const qint64 nb_lines = index()->nbLines;
+
+    // The lines already read are still valid if the file has only
+    // been added to, apart from the last one which might have been
+    // incomplete.
+    if ( ( fileChangedOnDisk_ == DataAdded
+                || fileChangedOnDisk_ == PartiallyTruncated )
+            && nb_lines >= previous_nb_lines )
+        lineCache_.invalidateFrom( qMax( previous_nb_lines - 1, 0LL ) );
+    else {
+        lineCache_.clear();
+
+        PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+        if ( blockCache_ )
+            blockCache_->clear();
     }
 
     LOG(logDEBUG) << "indexingFinished: " <<
         ( status == LoadingStatus::Successful ) <<
-        ", found " << nbLines_ << " lines.";
+        ", found " << nb_lines << " lines.";
 
     if ( status == LoadingStatus::Successful ) {
         // Use the new filename if needed
@@ -255,19 +817,45 @@ void LogData::indexingFinished( LoadingStatus status )
             QString newFileName = currentOperation_->getFilename();
 
             if ( attached_file_ ) {
-                QMutexLocker locker( &fileMutex_ );
+                PerfMutexLocker locker( &fileMutex_, PerfCounters::FileMutexWait );
+                attached_file_->close();
                 attached_file_->setFileName( newFileName );
             }
             else {
-                QMutexLocker locker( &fileMutex_ );
+                PerfMutexLocker locker( &fileMutex_, PerfCounters::FileMutexWait );
                 attached_file_.reset( new QFile( newFileName ) );
 
-                // And we watch the file for updates
+                // And we watch the file for updates (a remote file
+                // changing being only seen when reloaded)
                 fileChangedOnDisk_ = Unchanged;
-                fileWatcher_->addFile( attached_file_->fileName() );
+                if ( ! RemoteFile::isRemote( newFileName ) )
+                    fileWatcher_->addFile( attached_file_->fileName() );
+
+                // The pages of a mapping would be read again from the
+                // server once evicted
+                if ( ! readThrough_ && BlockCache::defaultMaxBytes() > 0
+                        && isOnNetworkFileSystem( newFileName ) ) {
+                    LOG(logINFO) << "Network file, read through a block cache";
+                    blockCache_.reset( new BlockCache( cachedBlockSize,
+                                BlockCache::defaultMaxBytes() ) );
+                }
             }
         }
 
+        {
+            // Map the file as now indexed
+            PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+            mapFile();
+
+            // Kept open to notice the file being replaced
+            if ( followRotation_ && ! attached_file_->isOpen() )
+                attached_file_->open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+        }
+
+        // Changes to a compressed file are always fully reindexed
+        if ( ! readThrough_ )
+            updateFingerprints();
+
         // Update the modified date/time if the file exists
         lastModifiedDate_ = QDateTime();
         QFileInfo fileInfo( *attached_file_ );
@@ -295,160 +883,923 @@ void LogData::indexingFinished( LoadingStatus status )
     }
 }
 
+void LogData::showIndexedLines()
+{
+    qint64 size;
+    int max_length;
+    TextEncoding encoding;
+    LinePositionArray positions;
+    if ( ! workerThread_.takeIndexedPrefix( &size, &max_length, &encoding,
+                &positions ) )
+        return;
+
+    // Only the lines of the file being attached are shown before its
+    // indexing ends, a reindexing keeping the previous ones until then.
+    if ( ! currentOperation_ || ! currentOperation_->isFull() )
+        return;
+
+    {
+        PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+        if ( ! indexingFile_ )
+            indexingFile_.reset( new QFile( currentOperation_->getFilename() ) );
+    }
+
+    std::shared_ptr<IndexSnapshot> index =
+        std::make_shared<IndexSnapshot>( *this->index() );
+    index->linePosition.append( std::move( positions ) );
+    index->nbLines   = index->linePosition.size();
+    index->fileSize  = size;
+    index->maxLength = max_length;
+    index->encoding  = encoding;
+    publishIndex( index );
+    prefixShown_ = true;
+
+    LOG(logDEBUG) << "showIndexedLines: " << index->nbLines << " lines";
+    emit linesIndexed( index->nbLines );
+}
+
+void LogData::showEstimate()
+{
+    std::shared_ptr<const CheckpointIndex> estimate =
+        workerThread_.takeEstimate();
+
+    // Only the file being attached is estimated
+    if ( ! estimate || ! currentOperation_ || ! currentOperation_->isFull() )
+        return;
+
+    estimate_ = estimate;
+
+    LOG(logDEBUG) << "showEstimate: about " << estimate_->nbLines() << " lines";
+    emit nbLinesEstimated( estimate_->nbLines() );
+}
+
+void LogData::indexGrowth()
+{
+    // Only one operation can be waiting, so the growth is kept for the
+    // next window rather than replacing it (or being indexed twice).
+    if ( currentOperation_ ) {
+        growthTimer_.start( growthDelay() );
+        return;
+    }
+
+    fileChangedOnDisk_ = DataAdded;
+    enqueueOperation( std::make_shared<PartialIndexOperation>(
+                index()->fileSize ) );
+}
+
+void LogData::releaseMemory()
+{
+    // Not from within the publishing of an index
+    QMetaObject::invokeMethod( this, "spillIndex", Qt::QueuedConnection );
+}
+
+void LogData::spillIndex()
+{
+    std::shared_ptr<IndexSnapshot> index =
+        std::make_shared<IndexSnapshot>( *this->index() );
+    index->linePosition = index->linePosition.spilled();
+    publishIndex( index );
+
+    // The lines are read again from the file when needed
+    lineCache_.clear();
+    {
+        QMutexLocker locker( &longLinesMutex_ );
+        longLines_.clear();
+    }
+
+    LOG(logDEBUG) << "spillIndex: " << index->linePosition.allocatedSize()
+        << " bytes of line positions left in memory";
+}
+
+void LogData::publishIndex( std::shared_ptr<const IndexSnapshot> index )
+{
+    std::atomic_store( &index_, index );
+    MemoryBudget::instance().setUsage( this,
+            index->linePosition.allocatedSize() );
+}
+
 //
 // Implementation of virtual functions
 //
 qint64 LogData::doGetNbLine() const
 {
-    return nbLines_;
+    return index()->nbLines;
 }
 
 int LogData::doGetMaxLength() const
 {
-    return maxLength_;
+    return index()->maxLength;
 }
 
 int LogData::doGetLineLength( qint64 line ) const
 {
-    if ( line >= nbLines_ ) { return 0; /* exception? */ }
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    if ( line >= index->nbLines ) { return 0; /* exception? */ }
+
+    if ( index->linePosition.hasLengths() )
+        return index->linePosition.lengthAt( line );
 
     int length = doGetExpandedLineString( line ).length();
 
     return length;
 }
 
-QString LogData::doGetLineString( qint64 line ) const
+bool LogData::doHasLineLengths() const
+{
+    return index()->linePosition.hasLengths();
+}
+
+qint64 LogData::doGetLinesSize( qint64 first_line, qint64 last_line ) const
+{
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    last_line = qMin( last_line, index->nbLines );
+    if ( first_line >= last_line )
+        return 0;
+
+    const SharedLinePositionArray& linePosition = index->linePosition;
+    const qint64 first_byte = ( first_line == 0 ) ? 0 : linePosition[first_line - 1];
+    return qMin( linePosition[last_line - 1], index->fileSize ) - first_byte;
+}
+
+std::shared_ptr<const SkipIndex> LogData::doGetSkipIndex() const
+{
+    return index()->skipIndex;
+}
+
+std::shared_ptr<const FusedSearch> LogData::doGetFusedSearch() const
 {
-    if ( line >= nbLines_ ) { return QString(); /* exception? */ }
+    return fusedSearch_;
+}
 
-    dataMutex_.lock();
-    fileMutex_.lock();
-    attached_file_->open( QIODevice::ReadOnly );
+std::vector<AbstractLogData::LineRun> LogData::doGetLineRuns() const
+{
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    const SharedLinePositionArray& linePosition = index->linePosition;
+
+    std::vector<LineRun> runs;
+    qint64 line = 0;
+    for ( const RunIndex::Run& run : runIndex_->runs( index->fileSize ) ) {
+        // The first line ending after the start of the run
+        qint64 first = line;
+        qint64 last = index->nbLines;
+        while ( first < last ) {
+            const qint64 middle = first + ( last - first ) / 2;
+            if ( linePosition.at( middle ) <= run.begin )
+                first = middle + 1;
+            else
+                last = middle;
+        }
 
-    attached_file_->seek( (line == 0) ? 0 : linePosition_[line-1] );
+        // The run must be of lines of the index (it could have been
+        // recorded for the positions of a file since rotated)
+        if ( first + run.nbLines > index->nbLines
+                || ( first > 0 ? linePosition.at( first - 1 ) : 0 ) != run.begin
+                || linePosition.at( first + run.nbLines - 1 ) != run.end )
+            continue;
 
-    QString string = QString( attached_file_->readLine() );
+        runs.push_back( { first, run.nbLines } );
+        line = first + run.nbLines;
+    }
 
-    attached_file_->close();
-    fileMutex_.unlock();
-    dataMutex_.unlock();
+    return runs;
+}
 
-    string.chop( 1 );
+// Called from the searching threads
+void LogData::doReleaseScannedLines( qint64 first_line, qint64 last_line ) const
+{
+#ifndef WIN32
+    if ( ScanReader::policy() == ScanReader::Cached )
+        return;
+
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+
+    PerfMutexLocker locker( &fileMutex_, PerfCounters::FileMutexWait );
+
+    // Only the data of the attached file are released
+    qint64 begin, end;
+    if ( ! attachedFileRange( *index, first_line, last_line, &begin, &end ) )
+        return;
+
+    // The system does not drop the pages still mapped, so they are
+    // unmapped first (only the whole pages, to be read again as any).
+    if ( mappedData_ ) {
+        const qint64 page = sysconf( _SC_PAGESIZE );
+        const qint64 page_begin = ( begin + page - 1 ) / page * page;
+        const qint64 page_end   = qMin( end, mappedSize_ ) / page * page;
+        if ( page_end > page_begin )
+            madvise( const_cast<char*>( mappedData_ ) + page_begin,
+                    page_end - page_begin, MADV_DONTNEED );
+    }
 
-    return string;
+    ScanReader::release( attachedFileHandle(), begin, end );
+#else
+    Q_UNUSED( first_line );
+    Q_UNUSED( last_line );
+#endif
 }
 
-QString LogData::doGetExpandedLineString( qint64 line ) const
+// Called from the searching threads
+void LogData::doPrefetchLines( qint64 first_line, qint64 last_line ) const
 {
-    if ( line >= nbLines_ ) { return QString(); /* exception? */ }
+#ifndef WIN32
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+
+    PerfMutexLocker locker( &fileMutex_, PerfCounters::FileMutexWait );
+
+    qint64 begin, end;
+    if ( ! attachedFileRange( *index, first_line, last_line, &begin, &end ) )
+        return;
+
+    // Read asynchronously by the system, the call returning at once
+    if ( mappedData_ ) {
+        const qint64 page = sysconf( _SC_PAGESIZE );
+        const qint64 page_begin = begin / page * page;
+        const qint64 page_end   = qMin( end, mappedSize_ );
+        if ( page_end > page_begin )
+            madvise( const_cast<char*>( mappedData_ ) + page_begin,
+                    page_end - page_begin, MADV_WILLNEED );
+    }
+#  ifdef POSIX_FADV_WILLNEED
+    else if ( attachedFileHandle() >= 0 ) {
+        posix_fadvise( attachedFileHandle(), begin, end - begin,
+                POSIX_FADV_WILLNEED );
+    }
+#  endif
+#else
+    Q_UNUSED( first_line );
+    Q_UNUSED( last_line );
+#endif
+}
+
+bool LogData::attachedFileRange( const IndexSnapshot& index, qint64 first_line,
+        qint64 last_line, qint64* begin, qint64* end ) const
+{
+    if ( readThrough_ || last_line <= first_line || last_line > index.nbLines )
+        return false;
+
+    const SharedLinePositionArray& linePosition = index.linePosition;
+    const qint64 first_byte = ( first_line == 0 ) ? 0 : linePosition[first_line - 1];
+    const qint64 last_byte  = qMin( linePosition[last_line - 1], index.fileSize );
+    if ( last_byte <= fileStart_ )
+        return false;
+
+    *begin = qMax( first_byte, fileStart_ ) - fileStart_;
+    *end   = last_byte - fileStart_;
+
+    return *end > *begin;
+}
+
+int LogData::attachedFileHandle() const
+{
+    if ( mapped_file_ )
+        return mapped_file_->handle();
+    else if ( attached_file_ && attached_file_->isOpen() )
+        return attached_file_->handle();
+    else
+        return -1;
+}
 
-    dataMutex_.lock();
-    fileMutex_.lock();
-    attached_file_->open( QIODevice::ReadOnly );
+QString LogData::doGetLineString( qint64 line ) const
+{
+    if ( line >= index()->nbLines ) { return QString(); /* exception? */ }
 
-    attached_file_->seek( (line == 0) ? 0 : linePosition_[line-1] );
+    const QStringList lines = readLines( line, 1, false );
 
-    QByteArray rawString = attached_file_->readLine();
+    return lines.isEmpty() ? QString() : lines.front();
+}
 
-    attached_file_->close();
-    fileMutex_.unlock();
-    dataMutex_.unlock();
+QString LogData::doGetExpandedLineString( qint64 line ) const
+{
+    if ( line >= index()->nbLines ) { return QString(); /* exception? */ }
 
-    QString string = QString( untabify( rawString.constData() ) );
-    string.chop( 1 );
+    const QStringList lines = readLines( line, 1, true );
 
-    return string;
+    return lines.isEmpty() ? QString() : lines.front();
 }
 
-// Note this function is also called from the LogFilteredDataWorker thread, so
-// data must be protected because they are changed in the main thread (by
-// indexingFinished).
+// Note this function is also called from the LogFilteredDataWorker thread,
+// it works on the index published when it starts, a new one being
+// published by indexingFinished meanwhile would not be seen.
 QStringList LogData::doGetLines( qint64 first_line, int number ) const
 {
+    return readLines( first_line, number, false );
+}
+
+QStringList LogData::doGetExpandedLines( qint64 first_line, int number ) const
+{
+    return lineCache_.getLines( first_line, number, index()->nbLines );
+}
+
+// The lines are taken in the order of the file, those separated by less
+// than sparseReadGap bytes being read in one go, and only the lines asked
+// for decoded. Like the single lines, they are not read through the cache.
+QStringList LogData::doGetLinesAt( const std::vector<qint64>& lines,
+        bool expand ) const
+{
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    const SharedLinePositionArray& linePosition = index->linePosition;
+    const int lf_width = index->encoding.unitWidth();
+    auto line_begin = [&linePosition]( qint64 line ) {
+        return ( line == 0 ) ? 0 : linePosition[line - 1];
+    };
+
+    // (the lines of a filtered view already are in order)
+    std::vector<size_t> order( lines.size() );
+    for ( size_t i = 0; i < order.size(); i++ )
+        order[i] = i;
+    if ( ! std::is_sorted( lines.begin(), lines.end() ) )
+        std::stable_sort( order.begin(), order.end(),
+                [&lines]( size_t a, size_t b ) { return lines[a] < lines[b]; } );
+
+    std::vector<QString> strings( lines.size() );
+    LineDecoder decoder( index->encoding );
+
+    size_t i = 0;
+    while ( i < order.size() ) {
+        const qint64 first_line = lines[ order[i] ];
+        if ( first_line < 0 || first_line >= index->nbLines ) {
+            LOG(logWARNING) << "LogData::doGetLinesAt Line out of bound asked for";
+            i++;
+            continue;
+        }
+
+        size_t end = i + 1;
+        while ( end < order.size() && lines[ order[end] ] < index->nbLines
+                && line_begin( lines[ order[end] ] )
+                - linePosition[ lines[ order[end - 1] ] ] <= sparseReadGap )
+            end++;
+
+        const qint64 first_byte = line_begin( first_line );
+        const QByteArray blob = readFileData( index->fileSize, first_byte,
+                linePosition[ lines[ order[end - 1] ] ] );
+        const char* const data = blob.constData();
+
+        for ( ; i < end; i++ ) {
+            const qint64 line = lines[ order[i] ];
+            qint64 beginning = qMin<qint64>(
+                    line_begin( line ) - first_byte, blob.size() );
+            // The byte order mark is not part of the first line
+            if ( line == 0 )
+                beginning = index->encoding.bomLength( data, blob.size() );
+            const qint64 last = qMin<qint64>(
+                    linePosition[line] - first_byte - lf_width, blob.size() );
+            strings[ order[i] ] = decoder.decode( data + beginning,
+                    qMax( last - beginning, 0LL ), expand );
+        }
+    }
+
     QStringList list;
-    const qint64 last_line = first_line + number - 1;
+    list.reserve( strings.size() );
+    for ( const QString& string : strings )
+        list.append( string );
 
-    // LOG(logDEBUG) << "LogData::doGetLines first_line:" << first_line << " nb:" << number;
+    return list;
+}
 
-    if ( number == 0 ) {
-        return QStringList();
+// Scans read the file directly, not to evict the lines displayed
+// from the cache.
+QStringList LogData::doGetExpandedLinesForScan( qint64 first_line, int number ) const
+{
+    return readLines( first_line, number, true );
+}
+
+void LogData::doFillExpandedLines( qint64 first_line, int number,
+        LineBuffer* lines ) const
+{
+    lineCache_.getLines( first_line, number, index()->nbLines, lines );
+}
+
+void LogData::doFillExpandedLinesForScan( qint64 first_line, int number,
+        LineBuffer* lines ) const
+{
+    readLines( first_line, number, true, lines );
+}
+
+void LogData::doFillExpandedLineWindows( qint64 first_line, int number,
+        int first_col, int nb_cols, LineBuffer* lines,
+        std::vector<int>* windowStarts ) const
+{
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    const qint64 end_line = first_line + number;
+
+    if ( end_line > index->nbLines ) {
+        LOG(logWARNING) << "LogData::doFillExpandedLineWindows Lines out of bound asked for";
+        return; /* exception? */
+    }
+
+    const SharedLinePositionArray& linePosition = index->linePosition;
+    auto isLong = [&linePosition]( qint64 line ) {
+        return linePosition[line] - ( line == 0 ? 0 : linePosition[line-1] )
+            > longLineLength;
+    };
+
+    qint64 line = first_line;
+    while ( line < end_line ) {
+        if ( isLong( line ) ) {
+            readLineWindow( *index, line, first_col, nb_cols, lines );
+            windowStarts->push_back( first_col );
+            line++;
+            continue;
+        }
+
+        // The short lines up to the next long one of the block are read
+        // whole, through the cache unless the block has a long line
+        // (the cache reading its blocks whole).
+        const qint64 block_first = line - line % LineBlockCache::linesPerBlock;
+        const qint64 block_end = qMin<qint64>( index->nbLines,
+                block_first + LineBlockCache::linesPerBlock );
+        qint64 next_long = block_first;
+        while ( next_long < block_end && ! isLong( next_long ) )
+            next_long++;
+
+        qint64 run_end = line;
+        while ( run_end < qMin( end_line, block_end ) && ! isLong( run_end ) )
+            run_end++;
+
+        if ( next_long == block_end )
+            lineCache_.getLines( line, run_end - line, index->nbLines, lines );
+        else
+            readLines( line, run_end - line, true, lines );
+        windowStarts->insert( windowStarts->end(), run_end - line, -1 );
+        line = run_end;
     }
+}
+
+//
+// File access
+//
 
-    if ( last_line >= nbLines_ ) {
-        LOG(logWARNING) << "LogData::doGetLines Lines out of bound asked for";
-        return QStringList(); /* exception? */
+void LogData::mapFile()
+{
+#ifndef WIN32
+    // On Windows, a mapped file cannot be truncated by its writer.
+    if ( ! attached_file_ || readThrough_ || blockCache_ ) {
+        unmapFile();
+        return;
     }
 
-    dataMutex_.lock();
+    // Only the attached file is mapped
+    const qint64 file_size = index()->fileSize - fileStart_;
 
-    fileMutex_.lock();
-    attached_file_->open( QIODevice::ReadOnly );
+    if ( mappedData_ && mappedSize_ == file_size
+            && mapped_file_->fileName() == attached_file_->fileName() )
+        return;
 
-    const qint64 first_byte = (first_line == 0) ? 0 : linePosition_[first_line-1];
-    const qint64 last_byte  = linePosition_[last_line];
-    // LOG(logDEBUG) << "LogData::doGetLines first_byte:" << first_byte << " last_byte:" << last_byte;
-    attached_file_->seek( first_byte );
-    QByteArray blob = attached_file_->read( last_byte - first_byte );
+    if ( mapped_file_ && file_size > 0
+            && mapped_file_->fileName() == attached_file_->fileName() ) {
+        // The file has grown, it is mapped again without reopening it
+        mapped_file_->unmap( reinterpret_cast<uchar*>(
+                    const_cast<char*>( mappedData_ ) ) );
+        mappedData_ = nullptr;
+        mappedSize_ = 0;
+    }
+    else {
+        unmapFile();
 
-    attached_file_->close();
-    fileMutex_.unlock();
+        if ( file_size == 0 )
+            return;
 
-    qint64 beginning = 0;
-    qint64 end = 0;
-    for ( qint64 line = first_line; (line <= last_line); line++ ) {
-        end = linePosition_[line] - first_byte;
-        // LOG(logDEBUG) << "Getting line " << line << " beginning " << beginning << " end " << end;
-        QByteArray this_line = blob.mid( beginning, end - beginning - 1 );
-        // LOG(logDEBUG) << "Line is: " << QString( this_line ).toStdString();
-        list.append( QString( this_line ) );
-        beginning = end;
+        mapped_file_.reset( new QFile( attached_file_->fileName() ) );
+        if ( ! mapped_file_->open( QIODevice::ReadOnly ) )
+            mapped_file_.reset();
+    }
+
+    if ( mapped_file_ ) {
+        mappedData_ = reinterpret_cast<const char*>(
+                mapped_file_->map( 0, file_size ) );
     }
 
-    dataMutex_.unlock();
+    if ( mappedData_ ) {
+        mappedSize_ = file_size;
+        LOG(logDEBUG) << "File mapped in memory (" << mappedSize_ << " bytes)";
+    }
+    else {
+        LOG(logWARNING) << "Cannot map " << attached_file_->fileName().toStdString()
+            << ", reading it from disk.";
+        mapped_file_.reset();
+    }
+#endif
+}
 
-    return list;
+void LogData::updateFingerprints()
+{
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+    const SharedLinePositionArray& linePosition = index->linePosition;
+    const qint64 nb_complete_lines = index->nbLines
+        - ( linePosition.hasFakeFinalLF() ? 1 : 0 );
+
+    // The last complete line is not the last anymore
+    if ( ! fingerprints_.empty()
+            && ( fingerprints_.back().line + 1 ) % fingerprintInterval != 0 )
+        fingerprints_.pop_back();
+
+    auto add_fingerprint = [&]( qint64 line ) {
+        const qint64 end = linePosition[line];
+        // Only the lines of the attached file can be checked
+        if ( end <= fileStart_ )
+            return;
+
+        const qint64 begin = qMax( end - fingerprintSize, fileStart_ );
+        const QByteArray data = readFileData( index->fileSize, begin, end );
+        fingerprints_.push_back( { line, begin, data.size(), qHash( data ) } );
+    };
+
+    qint64 line = fingerprints_.empty() ?
+        fingerprintInterval - 1 : fingerprints_.back().line + fingerprintInterval;
+    for ( ; line < nb_complete_lines; line += fingerprintInterval )
+        add_fingerprint( line );
+
+    if ( nb_complete_lines > 0 && ( fingerprints_.empty()
+                || fingerprints_.back().line < nb_complete_lines - 1 ) )
+        add_fingerprint( nb_complete_lines - 1 );
 }
 
-QStringList LogData::doGetExpandedLines( qint64 first_line, int number ) const
+qint64 LogData::unchangedLines( qint64 file_size ) const
 {
-    QStringList list;
-    const qint64 last_line = first_line + number - 1;
+    QFile file( attached_file_->fileName() );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return 0;
+
+    // The lines are unchanged up to the first fingerprint not matching
+    qint64 nb_lines = 0;
+    for ( const Fingerprint& fingerprint : fingerprints_ ) {
+        // Taken before the file was rotated
+        if ( fingerprint.position < fileStart_ )
+            continue;
+
+        const qint64 position = fingerprint.position - fileStart_;
+        if ( position + fingerprint.length > file_size
+                || ! file.seek( position ) )
+            break;
+
+        const QByteArray data = file.read( fingerprint.length );
+        if ( data.size() != fingerprint.length
+                || qHash( data ) != fingerprint.hash )
+            break;
+
+        nb_lines = fingerprint.line + 1;
+    }
 
-    if ( number == 0 ) {
-        return QStringList();
+    return nb_lines;
+}
+
+void LogData::truncateIndex( qint64 nb_lines )
+{
+    std::shared_ptr<IndexSnapshot> index =
+        std::make_shared<IndexSnapshot>( *this->index() );
+    index->linePosition.truncate( nb_lines );
+    index->nbLines  = nb_lines;
+    index->fileSize = index->linePosition[ nb_lines - 1 ];
+    if ( index->timestamps ) {
+        std::shared_ptr<TimestampIndex> timestamps =
+            std::make_shared<TimestampIndex>( *index->timestamps );
+        timestamps->truncate( nb_lines );
+        index->timestamps = timestamps;
+    }
+    if ( index->skipIndex ) {
+        std::shared_ptr<SkipIndex> skip_index =
+            std::make_shared<SkipIndex>( *index->skipIndex );
+        skip_index->truncate( nb_lines );
+        index->skipIndex = skip_index;
+    }
+    publishIndex( index );
+
+    lineCache_.invalidateFrom( nb_lines );
+    if ( fusedSearch_ )
+        fusedSearch_->truncate( nb_lines );
+
+    while ( ! fingerprints_.empty() && fingerprints_.back().line >= nb_lines )
+        fingerprints_.pop_back();
+
+    PerfMutexLocker file_locker( &fileMutex_, PerfCounters::FileMutexWait );
+    if ( blockCache_ )
+        blockCache_->invalidateFrom( index->fileSize - fileStart_ );
+}
+
+bool LogData::isRotated() const
+{
+#ifndef WIN32
+    PerfMutexLocker locker( &fileMutex_, PerfCounters::FileMutexWait );
+
+    if ( ! attached_file_ || ! attached_file_->isOpen() )
+        return false;
+
+    struct stat opened, named;
+    if ( fstat( attached_file_->handle(), &opened ) != 0
+            || stat( QFile::encodeName( attached_file_->fileName() ).constData(),
+                &named ) != 0 )
+        return false;
+
+    return opened.st_ino != named.st_ino || opened.st_dev != named.st_dev;
+#else
+    return false;
+#endif
+}
+
+void LogData::chainRotatedFile( qint64 rotated_size, qint64 file_start )
+{
+    LOG(logINFO) << "Following on with the new file at " << file_start
+        << " after " << rotated_size << " bytes";
+
+    // The mapping is the rotated file's
+    unmapFile();
+
+    const QString name = attached_file_->fileName();
+    rotatedFiles_.push_back( { std::move( attached_file_ ), fileStart_,
+            rotated_size, ( file_start - fileStart_ > rotated_size ) } );
+
+    attached_file_.reset( new QFile( name ) );
+    attached_file_->open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+    fileStart_ = file_start;
+    if ( blockCache_ )
+        blockCache_->clear();
+}
+
+void LogData::unmapFile()
+{
+    if ( mappedData_ ) {
+        mapped_file_->unmap( reinterpret_cast<uchar*>(
+                    const_cast<char*>( mappedData_ ) ) );
+        mapped_file_->close();
     }
 
-    if ( last_line >= nbLines_ ) {
-        LOG(logWARNING) << "LogData::doGetExpandedLines Lines out of bound asked for";
-        return QStringList(); /* exception? */
+    mapped_file_.reset();
+    mappedData_ = nullptr;
+    mappedSize_ = 0;
+}
+
+QByteArray LogData::readFileData( qint64 file_size,
+        qint64 first_byte, qint64 last_byte ) const
+{
+    QByteArray data;
+    readFileData( file_size, first_byte, last_byte, &data );
+
+    return data;
+}
+
+void LogData::readFileData( qint64 file_size, qint64 first_byte,
+        qint64 last_byte, QByteArray* data ) const
+{
+    PerfMutexLocker locker( &fileMutex_, PerfCounters::FileMutexWait );
+
+    // The fake final LF is past the end of file
+    const qint64 end = qMin( last_byte, file_size );
+
+    // (resizing within the capacity of the buffer does not allocate)
+    if ( readThrough_ ) {
+        data->resize( end - first_byte );
+        if ( ! readThrough_->read( first_byte, data->data(), data->size() ) ) {
+            LOG(logWARNING) << "Cannot read the data at " << first_byte;
+            data->resize( 0 );
+        }
+        return;
     }
 
-    dataMutex_.lock();
+    // Where the data of the attached file goes in the buffer
+    int offset = 0;
+    if ( first_byte < fileStart_ ) {
+        *data = readRotatedData( first_byte, qMin( end, fileStart_ ) );
+        if ( end <= fileStart_ )
+            return;
+        offset = data->size();
+    }
 
-    fileMutex_.lock();
-    attached_file_->open( QIODevice::ReadOnly );
+    // Position in the attached file
+    const qint64 first = qMax( first_byte, fileStart_ ) - fileStart_;
+    const qint64 last  = end - fileStart_;
 
-    const qint64 first_byte = (first_line == 0) ? 0 : linePosition_[first_line-1];
-    const qint64 last_byte  = linePosition_[last_line];
-    // LOG(logDEBUG) << "LogData::doGetExpandedLines first_byte:" << first_byte << " last_byte:" << last_byte;
-    attached_file_->seek( first_byte );
-    QByteArray blob = attached_file_->read( last_byte - first_byte );
+    if ( mappedData_ && last <= mappedSize_ ) {
+        data->resize( offset + last - first );
+        memcpy( data->data() + offset, mappedData_ + first, last - first );
+    }
+    else {
+        // (the lines of a file being attached are read from it as
+        // they are shown before it is)
+        QFile* const file = attached_file_ ?
+            attached_file_.get() : indexingFile_.get();
+        if ( ! file ) {
+            data->resize( offset );
+            return;
+        }
 
-    attached_file_->close();
-    fileMutex_.unlock();
+        // Kept open for the next reads, until the file is replaced
+        if ( ! file->isOpen() )
+            file->open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+
+        data->resize( offset + last - first );
+        if ( blockCache_ && file == attached_file_.get() ) {
+            if ( ! blockCache_->read( first, data->data() + offset, last - first,
+                        [file]( qint64 block ) {
+                            file->seek( block * cachedBlockSize );
+                            return file->read( cachedBlockSize );
+                        } ) )
+                data->resize( offset );
+        }
+        else {
+            file->seek( first );
+            const qint64 nb_read = file->read( data->data() + offset, last - first );
+            data->resize( offset + qMax( nb_read, 0LL ) );
+        }
+    }
+}
 
-    qint64 beginning = 0;
-    qint64 end = 0;
-    for ( qint64 line = first_line; (line <= last_line); line++ ) {
-        end = linePosition_[line] - first_byte;
-        // LOG(logDEBUG) << "Getting line " << line << " beginning " << beginning << " end " << end;
-        QByteArray this_line = blob.mid( beginning, end - beginning - 1 );
-        // LOG(logDEBUG) << "Line is: " << QString( this_line ).toStdString();
-        list.append( untabify( this_line.constData() ) );
-        beginning = end;
+QByteArray LogData::readRotatedData( qint64 first_byte, qint64 last_byte ) const
+{
+    QByteArray data;
+    const QByteArray line_feed = index()->encoding.lineFeed();
+
+    for ( const auto& rotated : rotatedFiles_ ) {
+        const qint64 rotated_end = rotated.start + rotated.size
+            + ( rotated.addedLF ? line_feed.size() : 0 );
+        if ( first_byte >= rotated_end || last_byte <= rotated.start )
+            continue;
+
+        // Position in the rotated file
+        const qint64 first = qMax( first_byte, rotated.start ) - rotated.start;
+        const qint64 last  = qMin( last_byte, rotated_end ) - rotated.start;
+
+        if ( first < rotated.size ) {
+            rotated.file->seek( first );
+            data.append( rotated.file->read( qMin( last, rotated.size ) - first ) );
+        }
+        if ( last > rotated.size ) {
+            const qint64 lf_first = qMax( first, rotated.size );
+            data.append( line_feed.mid( lf_first - rotated.size, last - lf_first ) );
+        }
+    }
+
+    return data;
+}
+
+LogData::LongLine LogData::longLine( const IndexSnapshot& index,
+        qint64 line ) const
+{
+    LongLine long_line;
+    long_line.begin = ( line == 0 ) ? 0 : index.linePosition[line-1];
+    // (the fake final LF is past the end of file)
+    long_line.end = qMin( index.linePosition[line]
+            - index.encoding.unitWidth(), index.fileSize );
+
+    // The byte order mark is not part of the first line
+    if ( line == 0 ) {
+        const QByteArray start = readFileData( index.fileSize, 0,
+                qMin<qint64>( long_line.end, 4 ) );
+        long_line.begin = index.encoding.bomLength(
+                start.constData(), start.size() );
+    }
+
+    // Recorded when the line was indexed (if it was not across two
+    // of the blocks read)
+    if ( columnIndex_->find( long_line.begin, long_line.end,
+                &long_line.checkpoints ) )
+        return long_line;
+
+    {
+        QMutexLocker locker( &longLinesMutex_ );
+        const LongLine* cached = longLines_.object( line );
+        if ( cached && cached->begin == long_line.begin
+                && cached->end == long_line.end )
+            return *cached;
+    }
+
+    // The line is decoded once, piece by piece, counting the columns
+    LineDecoder decoder( index.encoding );
+    qint64 position = long_line.begin;
+    int column = 0;
+    long_line.checkpoints.push_back( { 0, 0 } );
+    while ( position < long_line.end ) {
+        const QByteArray data = readLinePiece( index, position, long_line.end );
+        if ( data.isEmpty() )
+            break;
+
+        column = ColumnIndex::advance( column,
+                decoder.decode( data.constData(), data.size(), false ) );
+
+        position += data.size();
+        if ( position < long_line.end )
+            long_line.checkpoints.push_back(
+                    { position - long_line.begin, column } );
+    }
+
+    QMutexLocker locker( &longLinesMutex_ );
+    longLines_.insert( line, new LongLine( long_line ) );
+
+    return long_line;
+}
+
+QByteArray LogData::readLinePiece( const IndexSnapshot& index,
+        qint64 position, qint64 line_end ) const
+{
+    // A few more bytes to find where the last character ends
+    const qint64 last = qMin<qint64>( line_end,
+            position + ColumnIndex::checkpointInterval + 4 );
+    QByteArray data = readFileData( index.fileSize, position, last );
+
+    if ( last < line_end && data.size() == last - position )
+        data.truncate( ColumnIndex::characterBoundary( index.encoding,
+                    data.constData(), ColumnIndex::checkpointInterval ) );
+
+    return data;
+}
+
+void LogData::readLineWindow( const IndexSnapshot& index, qint64 line,
+        int first_col, int nb_cols, LineBuffer* lines ) const
+{
+    const LongLine long_line = longLine( index, line );
+    const int last_col = first_col + nb_cols;
+
+    // Decoded from the last checkpoint at or before the first column
+    // (the first one being at column 0)
+    const auto checkpoint = std::upper_bound( long_line.checkpoints.begin(),
+            long_line.checkpoints.end(), first_col,
+            []( int column, const ColumnIndex::Checkpoint& c )
+            { return column < c.column; } ) - 1;
+
+    QString window;
+    window.reserve( nb_cols );
+
+    LineDecoder decoder( index.encoding );
+    qint64 position = long_line.begin + checkpoint->offset;
+    int column = checkpoint->column;
+    while ( column < last_col && position < long_line.end ) {
+        const QByteArray data = readLinePiece( index, position, long_line.end );
+        if ( data.isEmpty() )
+            break;
+
+        // The tabs are expanded from the column of the checkpoint
+        const QString text = decoder.decode( data.constData(), data.size(), false );
+        for ( int i = 0; i < text.size() && column < last_col; i++ ) {
+            if ( text[i] == '\t' ) {
+                const int next = column + tabStop - column % tabStop;
+                for ( ; column < next; column++ ) {
+                    if ( column >= first_col && column < last_col )
+                        window.append( QChar( ' ' ) );
+                }
+            }
+            else {
+                if ( column >= first_col )
+                    window.append( text[i] );
+                column++;
+            }
+        }
+
+        position += data.size();
     }
 
-    dataMutex_.unlock();
+    lines->append( window );
+}
+
+QStringList LogData::readLines( qint64 first_line, int number,
+        bool expand ) const
+{
+    LineBuffer lines;
+    readLines( first_line, number, expand, &lines );
+
+    QStringList list;
+    list.reserve( lines.size() );
+    for ( int i = 0; i < lines.size(); i++ )
+        list.append( lines.string( i ) );
 
     return list;
 }
+
+void LogData::readLines( qint64 first_line, int number, bool expand,
+        LineBuffer* lines ) const
+{
+    const qint64 last_line = first_line + number - 1;
+
+    // LOG(logDEBUG) << "LogData::readLines first_line:" << first_line << " nb:" << number;
+
+    if ( number == 0 ) {
+        return;
+    }
+
+    const std::shared_ptr<const IndexSnapshot> index = this->index();
+
+    if ( last_line >= index->nbLines ) {
+        LOG(logWARNING) << "LogData::readLines Lines out of bound asked for";
+        return; /* exception? */
+    }
+
+    const SharedLinePositionArray& linePosition = index->linePosition;
+    const qint64 first_byte = (first_line == 0) ? 0 : linePosition[first_line-1];
+    const qint64 last_byte  = linePosition[last_line];
+    // LOG(logDEBUG) << "LogData::readLines first_byte:" << first_byte << " last_byte:" << last_byte;
+    const QByteArray blob = readFileData( index->fileSize, first_byte, last_byte );
+    const char* const data = blob.constData();
+    const int lf_width = index->encoding.unitWidth();
+
+    LineDecoder decoder( index->encoding );
+
+    // The byte order mark is not part of the first line
+    qint64 beginning = ( first_line == 0 ) ?
+        index->encoding.bomLength( data, blob.size() ) : 0;
+    for ( qint64 line = first_line; (line <= last_line); line++ ) {
+        const qint64 next = linePosition[line] - first_byte;
+        const qint64 end = qMin<qint64>( next - lf_width, blob.size() );
+        // LOG(logDEBUG) << "Getting line " << line << " beginning " << beginning << " end " << end;
+        decoder.decode( data + beginning, qMax( end - beginning, 0LL ),
+                expand, lines );
+        beginning = qMin<qint64>( next, blob.size() );
+    }
+}
@@ -21,13 +21,16 @@
 #define LOGDATA_H
 
 #include <memory>
+#include <vector>
 
 #include <QObject>
 #include <QString>
 #include <QFile>
 #include <QVector>
 #include <QMutex>
+#include <QCache>
 #include <QDateTime>
+#include <QTimer>
 
 #include "utils.h"
 
@@ -35,6 +38,17 @@
 #include "logdataworkerthread.h"
 #include "filewatcher.h"
 #include "loadingstatus.h"
+#include "lineblockcache.h"
+#include "timestampindex.h"
+#include "skipindex.h"
+#include "timestamprule.h"
+#include "textencoding.h"
+#include "columnindex.h"
+#include "runindex.h"
+#include "checkpointindex.h"
+#include "pipespooler.h"
+#include "memorybudget.h"
+#include "blockcache.h"
 
 class LogFilteredData;
 
@@ -42,8 +56,10 @@ class LogFilteredData;
 class CantReattachErr {};
 
 // Represents a complete set of data to be displayed (ie. a log file content)
+// Its line positions are spilled to the disk when the MemoryBudget
+// asks for its memory.
 // This class is thread-safe.
-class LogData : public AbstractLogData {
+class LogData : public AbstractLogData, public MemoryBudget::Client {
   Q_OBJECT
 
   public:
@@ -52,7 +68,11 @@ class LogData : public AbstractLogData {
     // Destroy an object
     ~LogData();
 
-    enum MonitoredFileStatus { Unchanged, DataAdded, Truncated };
+    // When the file is PartiallyTruncated, its first lines (as many as
+    // getNbLine() returns when notified) are unchanged, the following
+    // ones being indexed again.
+    enum MonitoredFileStatus { Unchanged, DataAdded, Truncated,
+        PartiallyTruncated };
 
     // Attaches the LogData to a file on disk
     // It starts the asynchronous indexing and returns (almost) immediately
@@ -63,6 +83,9 @@ class LogData : public AbstractLogData {
     // Interrupt the loading and report a null file.
     // Does nothing if no loading in progress.
     void interruptLoading();
+    // Returns whether a file is attached and no indexing of it is in
+    // progress, loadingFinished having been sent already.
+    bool isLoaded() const;
     // Creates a new filtered data.
     // ownership is passed to the caller
     LogFilteredData* getNewFilteredData() const;
@@ -73,6 +96,82 @@ class LogData : public AbstractLogData {
     QDateTime getLastModifiedDate() const;
     // Throw away all the file data and reload/reindex.
     void reload();
+    // Reload only what has changed in the file: the lines whose
+    // fingerprints are unchanged are kept, the following ones being
+    // indexed again as when the file is PartiallyTruncated (which is
+    // returned), or nothing if the file is Unchanged.
+    // Returns Truncated, doing nothing, if no line can be kept (or the
+    // index is being changed): reload() must be called then.
+    MonitoredFileStatus reloadChanges();
+    // Index the data added to the file at most once every msecs
+    // milliseconds, however often the file is reported to grow, the
+    // growth reported meanwhile being indexed (and searched) together.
+    // 0 (the default) indexes each growth as soon as it is reported.
+    void setGrowthCoalescingDelay( int msecs );
+    // When the file is rotated (renamed and replaced by a new file),
+    // keep the lines of the rotated file and follow on with the new
+    // one, indexing only its content (the default is to reindex the
+    // new file as if the old one had been truncated).
+    // Not supported on Windows, where an open file cannot be renamed.
+    void setFollowRotation( bool follow );
+    // Sets how to find the timestamps of the lines, which are sampled
+    // while the file is indexed (it is indexed again if already attached).
+    // getLineAtTime() returns -1 until a rule is set.
+    void setTimestampRule( const TimestampRule& rule );
+    // Sets the encoding the file is read in, Auto (the default) to detect
+    // it from its first bytes (it is indexed again if already attached).
+    void setEncoding( TextEncoding encoding );
+    // Returns the encoding the file is read in (as detected if Auto
+    // was set), Auto until it has been indexed.
+    TextEncoding getEncoding() const;
+    // Sets whether the (tab-expanded) length of each line is recorded
+    // while indexing, so getLineLength() does not read the line, for
+    // about 2 more bytes per line (it is indexed again if already
+    // attached). Like the max length, it is counted in code units.
+    void setRecordLineLengths( bool record );
+    // Sets whether a sketch of the words of each block of about 1 MiB
+    // of lines is built while indexing, so the searches for words skip
+    // the blocks not having them, for about 5% more memory than the
+    // size of the file (it is indexed again if already attached).
+    // Files in UTF-16 have no skip index.
+    void setBuildSkipIndex( bool build );
+    // Sets a search to run on the lines of the file while it is indexed,
+    // so the first search for regexp (by a LogFilteredData) does not
+    // read them again, when the file is opened to be searched.
+    // Only the files in UTF-8 (or ASCII) are searched this way, by the
+    // full indexings until one succeeds (see FusedSearch).
+    // Must be called before attachFile().
+    void setFusedSearch( const QRegExp& regexp );
+    // Sets the priority of the indexing of the file among the tasks of
+    // the TaskScheduler (Visible when the file is displayed).
+    // The growth of a Background file is coalesced over at least
+    // backgroundGrowthDelay, if coalesced at all.
+    void setPriority( TaskScheduler::Priority priority );
+
+    // While a big file is attached, the number of its lines is first
+    // estimated from a CheckpointIndex (see nbLinesEstimated()), then
+    // they are indexed from its start (see linesIndexed()).
+    // Returns the estimated number of lines of the file being attached,
+    // getNbLine() if it is not estimated.
+    qint64 getEstimatedNbLine() const;
+    // Sets *line to the line at the passed fraction (0 to 1) of the
+    // file, returns true if it is indexed, false if the line is only
+    // an estimate (the file being attached).
+    bool getLineAtFraction( double fraction, qint64* line ) const;
+    // Returns the line starting first after the passed fraction of the
+    // file being attached, read from the file (the lines there being
+    // possibly not indexed yet), empty if the file is not estimated.
+    QString getLineStartingAfter( double fraction ) const;
+    // Sets the fraction of the file being attached the user wants to
+    // see, its indexing reaching there as soon as possible (negative
+    // for none). Reset once the file is attached.
+    void setIndexingFocus( double fraction );
+    // Sets whether the end of the file is looked at (followed), its
+    // last lines being indexed early while the file is attached.
+    void setIndexingTail( bool tail );
+
+    // From MemoryBudget::Client
+    void releaseMemory() override;
 
   signals:
     // Sent during the 'attach' process to signal progress
@@ -80,6 +179,13 @@ class LogData : public AbstractLogData {
     void loadingProgressed( int percent );
     // Signal the client the file is fully loaded and available.
     void loadingFinished( LoadingStatus status );
+    // Sent while a file is being attached when more of its first lines
+    // have been indexed, the nbLines first lines being available
+    // before loadingFinished.
+    void linesIndexed( qint64 nbLines );
+    // Sent while a big file is being attached, when the number of its
+    // lines has been estimated (see getEstimatedNbLine()).
+    void nbLinesEstimated( qint64 nbLines );
     // Sent when the file on disk has changed, will be followed
     // by loadingProgressed if needed and then a loadingFinished.
     void fileChanged( LogData::MonitoredFileStatus status );
@@ -89,8 +195,40 @@ class LogData : public AbstractLogData {
     void fileChangedOnDisk();
     // Called when the worker thread signals the current operation ended
     void indexingFinished( LoadingStatus status );
+    // Called when the worker thread has indexed more lines of the file
+    // being attached, which are published
+    void showIndexedLines();
+    // Called when the worker thread has estimated the lines of the
+    // file being attached
+    void showEstimate();
+    // Index the growth reported since the coalescing window opened
+    void indexGrowth();
+    // Publish the index with its line positions spilled, and drop
+    // the lines cached
+    void spillIndex();
 
   private:
+    // The indexing data of the file, never modified once published
+    // so the readers can use it without locking.
+    struct IndexSnapshot {
+        IndexSnapshot() : linePosition(), fileSize( 0 ),
+            nbLines( 0 ), maxLength( 0 ), encoding(), timestamps(),
+            timestampRule(), skipIndex() {}
+
+        SharedLinePositionArray linePosition;
+        qint64 fileSize;
+        qint64 nbLines;
+        int maxLength;
+        // The positions of the ends of line depend on it
+        TextEncoding encoding;
+        // The timestamps sampled and the rule they were found with
+        // (null if no rule is set)
+        std::shared_ptr<const TimestampIndex> timestamps;
+        std::shared_ptr<const TimestampRule> timestampRule;
+        // The skip index (null if not built)
+        std::shared_ptr<const SkipIndex> skipIndex;
+    };
+
     // This class models an indexing operation.
     // It exists to permit LogData to delay the operation if another
     // one is ongoing (operations are asynchronous)
@@ -104,6 +242,7 @@ class LogData : public AbstractLogData {
         { doStart( workerThread ); }
         const QString& getFilename() const { return filename_; }
         virtual bool isFull() const { return true; }
+        virtual bool isRotation() const { return false; }
 
       protected:
         virtual void doStart( LogDataWorkerThread& workerThread ) const = 0;
@@ -151,40 +290,248 @@ class LogData : public AbstractLogData {
         qint64 filesize_;
     };
 
+    // Indexing the end of the rotated file and the new one
+    class RotationIndexOperation : public LogDataOperation {
+      public:
+        RotationIndexOperation() : LogDataOperation( QString() ) {}
+        ~RotationIndexOperation() {};
+
+        bool isFull() const { return false; }
+        bool isRotation() const { return true; }
+
+      protected:
+        void doStart( LogDataWorkerThread& workerThread ) const;
+    };
+
+    // The hash of the end of a line, used to tell whether the lines
+    // up to it have changed when the file is truncated.
+    struct Fingerprint {
+        qint64 line;
+        // Position of the bytes hashed in the data
+        qint64 position;
+        int length;
+        uint hash;
+    };
+
+    // The checkpoints of a line (see ColumnIndex) and the positions
+    // of the line they were taken on.
+    struct LongLine {
+        qint64 begin;
+        qint64 end;
+        ColumnIndex::Checkpoints checkpoints;
+    };
+
+    // A file the attached file has been rotated from, still read
+    // through the handle opened before the rotation.
+    struct RotatedFile {
+        std::unique_ptr<QFile> file;
+        // Position of its first byte in the data
+        qint64 start;
+        // Its size on disk (when rotated)
+        qint64 size;
+        // Whether a LF follows it in the data (if it did not end with one)
+        bool addedLF;
+    };
+
     std::shared_ptr<FileWatcher> fileWatcher_;
     MonitoredFileStatus fileChangedOnDisk_;
+    // Running while growth is waiting to be indexed
+    QTimer growthTimer_;
+    int growthCoalescingDelay_;
+    // Minimum window of the growth of a Background file
+    static const int backgroundGrowthDelay;
+    TaskScheduler::Priority priority_;
+    bool followRotation_;
+    // Set while a rotation is being indexed
+    bool rotating_;
+    // Used by the next full indexing
+    TimestampRule timestampRule_;
 
     // Implementation of virtual functions
     QString doGetLineString( qint64 line ) const override;
     QString doGetExpandedLineString( qint64 line ) const override;
     QStringList doGetLines( qint64 first, int number ) const override;
     QStringList doGetExpandedLines( qint64 first, int number ) const override;
+    // The lines close to each other in the file are read together.
+    QStringList doGetLinesAt( const std::vector<qint64>& lines,
+            bool expand ) const override;
     qint64 doGetNbLine() const override;
     int doGetMaxLength() const override;
     int doGetLineLength( qint64 line ) const override;
+    QStringList doGetExpandedLinesForScan( qint64 first, int number ) const override;
+    void doFillExpandedLines( qint64 first, int number,
+            LineBuffer* lines ) const override;
+    void doFillExpandedLinesForScan( qint64 first, int number,
+            LineBuffer* lines ) const override;
+    // Only the long lines are read by windows, the others through
+    // the cache.
+    void doFillExpandedLineWindows( qint64 first, int number,
+            int first_col, int nb_cols, LineBuffer* lines,
+            std::vector<int>* windowStarts ) const override;
+    QByteArray doGetRawLines( qint64 first_line, int number,
+            std::vector<int>* lineEnds ) const override;
+    void doFillRawLines( qint64 first_line, int number,
+            QByteArray* data, std::vector<int>* lineEnds ) const override;
+    bool doIsThreadSafe() const override { return true; }
+    // Only the lines around the timestamp are read, found with the
+    // timestamps sampled.
+    qint64 doGetLineAtTime( qint64 timestamp ) const override;
+    // The range is the one of the timestamps sampled, up to the one of
+    // the last line (the lines after the last sample are not read).
+    bool doGetTimeRange( qint64* first, qint64* last ) const override;
+    bool doHasLineLengths() const override;
+    qint64 doGetLinesSize( qint64 first_line, qint64 last_line ) const override;
+    std::shared_ptr<const SkipIndex> doGetSkipIndex() const override;
+    std::shared_ptr<const FusedSearch> doGetFusedSearch() const override;
+    void doReleaseScannedLines( qint64 first_line,
+            qint64 last_line ) const override;
+    void doPrefetchLines( qint64 first_line,
+            qint64 last_line ) const override;
+    // The runs recorded by the indexing, of the lines indexed
+    std::vector<LineRun> doGetLineRuns() const override;
 
     void enqueueOperation( std::shared_ptr<const LogDataOperation> newOperation );
     void startOperation();
 
-    QString indexingFileName_;
+    // Returns the current indexing data (without locking)
+    std::shared_ptr<const IndexSnapshot> index() const
+    { return std::atomic_load( &index_ ); }
+    // Replace the indexing data seen by the readers
+    // (and report the memory it uses to the MemoryBudget)
+    void publishIndex( std::shared_ptr<const IndexSnapshot> index );
+
+    // Take the fingerprints of the lines indexed since the last call
+    void updateFingerprints();
+    // Returns the number of lines at the beginning of the attached
+    // file, now of file_size bytes, whose fingerprints are unchanged.
+    qint64 unchangedLines( qint64 file_size ) const;
+    // Keep only the first nb_lines lines in the index
+    void truncateIndex( qint64 nb_lines );
+
+    // Returns whether the name of the attached file now designates
+    // a different file than the one opened (Unix only).
+    bool isRotated() const;
+    // Make the file opened the last rotated file, the new file
+    // starting at file_start in the data.
+    // Must be called with fileMutex_ held.
+    void chainRotatedFile( qint64 rotated_size, qint64 file_start );
+
+    // Map the indexed part of the file in memory (if not already done)
+    // Must be called with fileMutex_ held.
+    void mapFile();
+    // Release the mapping, reverting to reading through attached_file_
+    // Must be called with fileMutex_ held.
+    void unmapFile();
+    // Returns the content of the file between the two positions,
+    // from the mapped memory if possible (without any system call),
+    // file_size being the size of the data as indexed.
+    // The positions are in the data made of the rotated files followed
+    // by the attached file.
+    QByteArray readFileData( qint64 file_size,
+            qint64 first_byte, qint64 last_byte ) const;
+    // Idem, written to the passed buffer (its memory being reused)
+    void readFileData( qint64 file_size, qint64 first_byte,
+            qint64 last_byte, QByteArray* data ) const;
+    // Returns the content of the rotated files between the two positions
+    // Must be called with fileMutex_ held.
+    QByteArray readRotatedData( qint64 first_byte, qint64 last_byte ) const;
+    // Read and decode the passed lines from the file, expanding the
+    // tabs if asked (used to fill the line cache).
+    QStringList readLines( qint64 first_line, int number, bool expand ) const;
+    // Idem, the lines being decoded to the passed buffer in one pass
+    void readLines( qint64 first_line, int number, bool expand,
+            LineBuffer* lines ) const;
+    // Read the columns [first_col, first_col+nb_cols) of the passed
+    // line, expanding the tabs, to the buffer. Only the part of the line
+    // after the last checkpoint before first_col is decoded.
+    void readLineWindow( const IndexSnapshot& index, qint64 line,
+            int first_col, int nb_cols, LineBuffer* lines ) const;
+    // Returns the passed long line with its column checkpoints, as
+    // recorded by the indexing or scanning it the first time (or when
+    // it has changed).
+    LongLine longLine( const IndexSnapshot& index, qint64 line ) const;
+    // Returns the piece of about ColumnIndex::checkpointInterval bytes of
+    // a long line starting at position, ending between two characters.
+    QByteArray readLinePiece( const IndexSnapshot& index,
+            qint64 position, qint64 line_end ) const;
+    // Returns in begin and end the part of the attached file holding
+    // the passed lines (as far as it does), false if it holds none.
+    // fileMutex_ must be held.
+    bool attachedFileRange( const IndexSnapshot& index, qint64 first_line,
+            qint64 last_line, qint64* begin, qint64* end ) const;
+    // Returns the descriptor the attached file is read through, -1
+    // if none (fileMutex_ must be held)
+    int attachedFileHandle() const;
+    // Returns the window the growth is coalesced over
+    // for the priority of the file
+    int growthDelay() const;
+
+    // The file being attached, its lines being read from it as they
+    // are indexed until it is attached_file_ (see showIndexedLines())
+    std::unique_ptr<QFile> indexingFile_;
+    // The estimate of the lines of the file being attached
+    // (only used in the LogData's thread)
+    std::shared_ptr<const CheckpointIndex> estimate_;
+    // Whether lines of the file being attached have been shown (and
+    // must be dropped if it is not attached in the end)
+    bool prefixShown_;
+    // Set if a pipe is attached, the file indexed being the one it
+    // is copied to.
+    std::unique_ptr<PipeSpooler> spooler_;
+    // Set if the lines are searched while indexed
+    std::shared_ptr<FusedSearch> fusedSearch_;
+    // Opened on the first read not served by the mapping and kept open
+    // until the file is truncated or reloaded.
     std::unique_ptr<QFile> attached_file_;
-    LinePositionArray linePosition_;
-    qint64 fileSize_;
-    qint64 nbLines_;
-    int maxLength_;
+    // Separate file object as closing a QFile unmaps its memory.
+    // It stays open when the file grows, only the mapping being redone.
+    // Note that accessing the mapping after the file has been truncated
+    // by another process is undefined (SIGBUS), so we drop it as soon
+    // as a truncation is reported.
+    std::unique_ptr<QFile> mapped_file_;
+    const char* mappedData_;
+    qint64 mappedSize_;
+    // Set if the attached file is compressed or remote, the data
+    // being read through it rather than the file or a mapping.
+    std::shared_ptr<ReadThroughFile> readThrough_;
+    // Set if the attached file is on a network file system, its data
+    // being read through it rather than mapped (with fileMutex_)
+    std::unique_ptr<BlockCache> blockCache_;
+    static const qint64 cachedBlockSize;
+    // The files rotated while followed, oldest first
+    std::vector<RotatedFile> rotatedFiles_;
+    // Position of the attached file in the data
+    qint64 fileStart_;
+    // Every fingerprintInterval lines and the last complete one
+    static const qint64 fingerprintInterval;
+    static const int fingerprintSize;
+    std::vector<Fingerprint> fingerprints_;
+    // Only accessed through index() and publishIndex()
+    std::shared_ptr<const IndexSnapshot> index_;
     QDateTime lastModifiedDate_;
     std::shared_ptr<const LogDataOperation> currentOperation_;
     std::shared_ptr<const LogDataOperation> nextOperation_;
 
-    // To protect the file:
+    // To protect the file and its mapping:
     mutable QMutex fileMutex_;
-    // To protect linePosition_, fileSize_ and maxLength_:
-    mutable QMutex dataMutex_;
-    // (are mutable to allow 'const' function to touch it,
+    // (is mutable to allow 'const' function to touch it,
     // while remaining const)
-    // When acquiring both, data should be help before locking file.
 
     LogDataWorkerThread workerThread_;
+
+    // The checkpoints of the long lines recorded by the indexing
+    std::shared_ptr<const ColumnIndex> columnIndex_;
+    // The runs of similar lines recorded by the indexing
+    std::shared_ptr<const RunIndex> runIndex_;
+    // The checkpoints of the other long lines displayed recently, by line
+    static const int longLinesCacheSize;
+    // Largest gap between two of the lines asked for read with them
+    static const int sparseReadGap;
+    mutable QMutex longLinesMutex_;
+    mutable QCache<qint64, LongLine> longLines_;
+
+    // Recently displayed lines (last so its thread stops first)
+    mutable LineBlockCache lineCache_;
 };
 
 Q_DECLARE_METATYPE( LogData::MonitoredFileStatus );
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements LogDataSet, the content of a set of log files.
+
+#include <algorithm>
+#include <limits>
+
+#include "log.h"
+
+#include "logdataset.h"
+#include "logfiltereddata.h"
+
+LogDataSet::LogDataSet() : AbstractLogData(),
+    files_(), fileNames_(),
+    layout_( std::make_shared<const Layout>() ),
+    loading_(), progress_(), loadingStatus_( LoadingStatus::Successful )
+{
+}
+
+LogDataSet::~LogDataSet()
+{
+}
+
+//
+// Public functions
+//
+
+void LogDataSet::attachFiles( const QStringList& fileNames )
+{
+    LOG(logDEBUG) << "LogDataSet::attachFiles " << fileNames.size() << " files";
+
+    if ( ! files_.empty() ) {
+        // We cannot reattach
+        throw CantReattachErr();
+    }
+
+    fileNames_ = fileNames;
+    loading_.assign( fileNames.size(), true );
+    progress_.assign( fileNames.size(), 0 );
+    loadingStatus_ = LoadingStatus::Successful;
+
+    for ( const QString& fileName : fileNames ) {
+        files_.emplace_back( new LogData() );
+        LogData* file = files_.back().get();
+
+        connect( file, SIGNAL( loadingProgressed( int ) ),
+                this, SLOT( fileLoadingProgressed( int ) ) );
+        connect( file, SIGNAL( loadingFinished( LoadingStatus ) ),
+                this, SLOT( fileLoadingFinished( LoadingStatus ) ) );
+        connect( file, SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ),
+                this, SLOT( fileChangedOnDisk( LogData::MonitoredFileStatus ) ) );
+    }
+
+    // Each LogData indexing in its own thread
+    for ( size_t i = 0; i < files_.size(); i++ )
+        files_[i]->attachFile( fileNames[i] );
+
+    if ( files_.empty() )
+        emit loadingFinished( LoadingStatus::Successful );
+}
+
+void LogDataSet::interruptLoading()
+{
+    for ( const auto& file : files_ )
+        file->interruptLoading();
+}
+
+// Return an initialised LogFilteredData. The search is not started.
+LogFilteredData* LogDataSet::getNewFilteredData() const
+{
+    LogFilteredData* newFilteredData = new LogFilteredData( this );
+
+    return newFilteredData;
+}
+
+qint64 LogDataSet::getFileSize() const
+{
+    qint64 size = 0;
+    for ( const auto& file : files_ )
+        size += file->getFileSize();
+
+    return size;
+}
+
+QDateTime LogDataSet::getLastModifiedDate() const
+{
+    QDateTime date;
+    for ( const auto& file : files_ ) {
+        const QDateTime file_date = file->getLastModifiedDate();
+        if ( date.isNull() || ( ! file_date.isNull() && file_date > date ) )
+            date = file_date;
+    }
+
+    return date;
+}
+
+void LogDataSet::reload()
+{
+    for ( size_t i = 0; i < files_.size(); i++ ) {
+        loading_[i] = true;
+        progress_[i] = 0;
+        files_[i]->reload();
+    }
+}
+
+QStringList LogDataSet::getFileNames() const
+{
+    return fileNames_;
+}
+
+int LogDataSet::getFileIndex( qint64 line ) const
+{
+    const std::shared_ptr<const Layout> layout = this->layout();
+
+    if ( line < 0 || line >= layout->nbLines )
+        return -1;
+
+    // Last file starting at or before the line (skipping the empty ones)
+    return std::upper_bound( layout->firstLines.begin(),
+            layout->firstLines.end(), line ) - layout->firstLines.begin() - 1;
+}
+
+qint64 LogDataSet::getFirstLine( int file_index ) const
+{
+    const std::shared_ptr<const Layout> layout = this->layout();
+
+    if ( file_index < 0 || file_index >= (int) layout->firstLines.size() )
+        return -1;
+
+    return layout->firstLines[file_index];
+}
+
+void LogDataSet::setGrowthCoalescingDelay( int msecs )
+{
+    for ( const auto& file : files_ )
+        file->setGrowthCoalescingDelay( msecs );
+}
+
+void LogDataSet::setFollowRotation( bool follow )
+{
+    for ( const auto& file : files_ )
+        file->setFollowRotation( follow );
+}
+
+void LogDataSet::setRecordLineLengths( bool record )
+{
+    for ( const auto& file : files_ )
+        file->setRecordLineLengths( record );
+}
+
+void LogDataSet::setBuildSkipIndex( bool build )
+{
+    for ( const auto& file : files_ )
+        file->setBuildSkipIndex( build );
+}
+
+//
+// Slots
+//
+
+void LogDataSet::fileLoadingProgressed( int percent )
+{
+    const int index = senderIndex();
+    if ( index == -1 )
+        return;
+
+    progress_[index] = percent;
+
+    int total = 0;
+    int nb_loading = 0;
+    for ( size_t i = 0; i < files_.size(); i++ ) {
+        if ( loading_[i] ) {
+            total += progress_[i];
+            nb_loading++;
+        }
+    }
+
+    if ( nb_loading > 0 )
+        emit loadingProgressed( total / nb_loading );
+}
+
+void LogDataSet::fileLoadingFinished( LoadingStatus status )
+{
+    const int index = senderIndex();
+    if ( index == -1 )
+        return;
+
+    LOG(logDEBUG) << "LogDataSet::fileLoadingFinished for file " << index;
+
+    loading_[index] = false;
+    progress_[index] = 100;
+    if ( loadingStatus_ == LoadingStatus::Successful )
+        loadingStatus_ = status;
+
+    updateLayout();
+
+    if ( std::none_of( loading_.begin(), loading_.end(),
+                []( bool loading ) { return loading; } ) ) {
+        const LoadingStatus set_status = loadingStatus_;
+        loadingStatus_ = LoadingStatus::Successful;
+        emit loadingFinished( set_status );
+    }
+}
+
+void LogDataSet::fileChangedOnDisk( LogData::MonitoredFileStatus status )
+{
+    const int index = senderIndex();
+    if ( index == -1 )
+        return;
+
+    LOG(logDEBUG) << "LogDataSet::fileChangedOnDisk for file " << index;
+
+    loading_[index] = true;
+    progress_[index] = 0;
+
+    // The lines of the last file are the only ones not followed by others
+    if ( index == (int) files_.size() - 1 )
+        emit fileChanged( status );
+    else
+        emit fileChanged( LogData::Truncated );
+}
+
+//
+// Implementation of virtual functions
+//
+
+QString LogDataSet::doGetLineString( qint64 line ) const
+{
+    const std::vector<Part> parts = split( *layout(), line, 1 );
+    if ( parts.empty() )
+        return QString();
+
+    return files_[parts[0].file]->getLineString( parts[0].firstLine );
+}
+
+QString LogDataSet::doGetExpandedLineString( qint64 line ) const
+{
+    const std::vector<Part> parts = split( *layout(), line, 1 );
+    if ( parts.empty() )
+        return QString();
+
+    return files_[parts[0].file]->getExpandedLineString( parts[0].firstLine );
+}
+
+QStringList LogDataSet::doGetLines( qint64 first_line, int number ) const
+{
+    QStringList list;
+    for ( const Part& part : split( *layout(), first_line, number ) )
+        list.append( files_[part.file]->getLines( part.firstLine, part.number ) );
+
+    return list;
+}
+
+QStringList LogDataSet::doGetExpandedLines( qint64 first_line, int number ) const
+{
+    QStringList list;
+    for ( const Part& part : split( *layout(), first_line, number ) )
+        list.append( files_[part.file]->getExpandedLines(
+                    part.firstLine, part.number ) );
+
+    return list;
+}
+
+QStringList LogDataSet::doGetLinesAt( const std::vector<qint64>& lines,
+        bool expand ) const
+{
+    const std::shared_ptr<const Layout> layout = this->layout();
+
+    // The lines of each file, and where they go in the list
+    std::vector<std::vector<qint64>> file_lines( files_.size() );
+    std::vector<std::vector<int>> positions( files_.size() );
+    for ( size_t i = 0; i < lines.size(); i++ ) {
+        const std::vector<Part> parts = split( *layout, lines[i], 1 );
+        if ( parts.empty() )
+            continue;
+        file_lines[parts[0].file].push_back( parts[0].firstLine );
+        positions[parts[0].file].push_back( i );
+    }
+
+    std::vector<QString> strings( lines.size() );
+    for ( size_t file = 0; file < files_.size(); file++ ) {
+        if ( file_lines[file].empty() )
+            continue;
+        const QStringList list = expand ?
+            files_[file]->getExpandedLinesAt( file_lines[file] ) :
+            files_[file]->getLinesAt( file_lines[file] );
+        for ( int i = 0; i < list.size(); i++ )
+            strings[ positions[file][i] ] = list[i];
+    }
+
+    QStringList list;
+    list.reserve( strings.size() );
+    for ( const QString& string : strings )
+        list.append( string );
+
+    return list;
+}
+
+QStringList LogDataSet::doGetExpandedLinesForScan( qint64 first_line, int number ) const
+{
+    QStringList list;
+    for ( const Part& part : split( *layout(), first_line, number ) )
+        list.append( files_[part.file]->getExpandedLinesForScan(
+                    part.firstLine, part.number ) );
+
+    return list;
+}
+
+// Note this function is called from the LogFilteredDataWorker thread.
+QByteArray LogDataSet::doGetRawLines( qint64 first_line, int number,
+        std::vector<int>* lineEnds ) const
+{
+    QByteArray blob;
+    std::vector<int> partLineEnds;
+
+    lineEnds->clear();
+    lineEnds->reserve( number );
+
+    for ( const Part& part : split( *layout(), first_line, number ) ) {
+        const QByteArray part_blob = files_[part.file]->getRawLines(
+                part.firstLine, part.number, &partLineEnds );
+        if ( partLineEnds.empty() )
+            break;
+
+        // The final LF of the previous file might not be there
+        const int offset = lineEnds->empty() ? 0 : lineEnds->back() + 1;
+        blob.resize( offset );
+        if ( offset > 0 )
+            blob[offset - 1] = '\n';
+        blob.append( part_blob );
+
+        for ( int end : partLineEnds )
+            lineEnds->push_back( offset + end );
+    }
+
+    return blob;
+}
+
+qint64 LogDataSet::doGetNbLine() const
+{
+    return layout()->nbLines;
+}
+
+int LogDataSet::doGetMaxLength() const
+{
+    return layout()->maxLength;
+}
+
+int LogDataSet::doGetLineLength( qint64 line ) const
+{
+    const std::vector<Part> parts = split( *layout(), line, 1 );
+    if ( parts.empty() )
+        return 0;
+
+    return files_[parts[0].file]->getLineLength( parts[0].firstLine );
+}
+
+bool LogDataSet::doHasLineLengths() const
+{
+    for ( const auto& file : files_ ) {
+        if ( ! file->hasLineLengths() )
+            return false;
+    }
+
+    return true;
+}
+
+qint64 LogDataSet::doGetLinesSize( qint64 first_line, qint64 last_line ) const
+{
+    qint64 size = 0;
+    for ( const Part& part : split( *layout(), first_line,
+                qMin<qint64>( last_line - first_line,
+                    std::numeric_limits<int>::max() ) ) ) {
+        const qint64 part_size = files_[part.file]->getLinesSize(
+                part.firstLine, part.firstLine + part.number );
+        if ( part_size < 0 )
+            return -1;
+        size += part_size;
+    }
+
+    return size;
+}
+
+//
+// Private functions
+//
+
+void LogDataSet::updateLayout()
+{
+    std::shared_ptr<Layout> layout = std::make_shared<Layout>();
+
+    layout->firstLines.reserve( files_.size() );
+    for ( const auto& file : files_ ) {
+        layout->firstLines.push_back( layout->nbLines );
+        layout->nbLines += file->getNbLine();
+        layout->maxLength = qMax( layout->maxLength, file->getMaxLength() );
+    }
+
+    std::atomic_store( &layout_, std::shared_ptr<const Layout>( layout ) );
+}
+
+int LogDataSet::senderIndex() const
+{
+    for ( size_t i = 0; i < files_.size(); i++ ) {
+        if ( files_[i].get() == sender() )
+            return i;
+    }
+
+    return -1;
+}
+
+std::vector<LogDataSet::Part> LogDataSet::split( const Layout& layout,
+        qint64 first_line, int number ) const
+{
+    std::vector<Part> parts;
+
+    if ( first_line < 0 || number <= 0
+            || first_line + number > layout.nbLines ) {
+        if ( number > 0 )
+            LOG(logWARNING) << "LogDataSet: lines out of bound asked for";
+        return parts;
+    }
+
+    const std::vector<qint64>& firstLines = layout.firstLines;
+    size_t file = std::upper_bound( firstLines.begin(), firstLines.end(),
+            first_line ) - firstLines.begin() - 1;
+
+    while ( number > 0 && file < firstLines.size() ) {
+        // The lines the file had when the layout was built
+        const qint64 end = ( file + 1 < firstLines.size() ) ?
+            firstLines[file + 1] : layout.nbLines;
+        const int part_number = qMin<qint64>( number, end - first_line );
+
+        if ( part_number > 0 ) {
+            parts.push_back( { (int) file,
+                    first_line - firstLines[file], part_number } );
+            first_line += part_number;
+            number -= part_number;
+        }
+        file++;
+    }
+
+    return parts;
+}
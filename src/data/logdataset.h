@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOGDATASET_H
+#define LOGDATASET_H
+
+#include <memory>
+#include <vector>
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#include "abstractlogdata.h"
+#include "logdata.h"
+#include "loadingstatus.h"
+
+class LogFilteredData;
+
+// Represents an ordered set of files (typically a log and the files
+// it has been rotated to, oldest first) as one stream of lines, so
+// they can be displayed and searched without concatenating them.
+// Each file has its own LogData, the files being indexed in parallel.
+// This class is thread-safe.
+class LogDataSet : public AbstractLogData {
+  Q_OBJECT
+
+  public:
+    // Creates an empty LogDataSet
+    LogDataSet();
+    ~LogDataSet();
+
+    // Attaches the set to the passed files, in the order their lines
+    // are presented.
+    // It starts the asynchronous indexing and returns (almost) immediately
+    // Reattaching is forbidden and will throw.
+    void attachFiles( const QStringList& fileNames );
+    // Interrupt the loading of all the files.
+    void interruptLoading();
+    // Creates a new filtered data, searching through all the files.
+    // ownership is passed to the caller
+    LogFilteredData* getNewFilteredData() const;
+    // Returns the total size of the files in bytes
+    qint64 getFileSize() const;
+    // Returns the last modification date of the most recent file.
+    QDateTime getLastModifiedDate() const;
+    // Throw away all the files data and reload/reindex them.
+    void reload();
+    // Returns the files of the set, in order
+    QStringList getFileNames() const;
+    // Returns the index (in getFileNames()) of the file the passed
+    // line is from, -1 if out of bounds.
+    int getFileIndex( qint64 line ) const;
+    // Returns the line number of the first line of the passed file
+    qint64 getFirstLine( int file_index ) const;
+    // Apply to each file (see LogData)
+    void setGrowthCoalescingDelay( int msecs );
+    void setFollowRotation( bool follow );
+    void setRecordLineLengths( bool record );
+    void setBuildSkipIndex( bool build );
+
+  signals:
+    // Sent during the 'attach' process to signal progress
+    // percent being the percentage of completion (of all the files).
+    void loadingProgressed( int percent );
+    // Signal the client all the files are loaded and available.
+    void loadingFinished( LoadingStatus status );
+    // Sent when one of the files on disk has changed, as LogData does.
+    // As the lines of the following files move, a change to any file
+    // but the last one is reported as a truncation.
+    void fileChanged( LogData::MonitoredFileStatus status );
+
+  private slots:
+    // Called by the files' LogData
+    void fileLoadingProgressed( int percent );
+    void fileLoadingFinished( LoadingStatus status );
+    void fileChangedOnDisk( LogData::MonitoredFileStatus status );
+
+  private:
+    // Where the lines of each file are in the set, never modified once
+    // published so the readers can use it without locking.
+    struct Layout {
+        Layout() : firstLines(), nbLines( 0 ), maxLength( 0 ) {}
+
+        // Prefix sum of the line counts (one entry per file)
+        std::vector<qint64> firstLines;
+        qint64 nbLines;
+        int maxLength;
+    };
+
+    // A range of lines within one of the files
+    struct Part {
+        int file;
+        qint64 firstLine;
+        int number;
+    };
+
+    // Implementation of virtual functions
+    QString doGetLineString( qint64 line ) const override;
+    QString doGetExpandedLineString( qint64 line ) const override;
+    QStringList doGetLines( qint64 first, int number ) const override;
+    QStringList doGetExpandedLines( qint64 first, int number ) const override;
+    // The lines of each file are fetched from it together.
+    QStringList doGetLinesAt( const std::vector<qint64>& lines,
+            bool expand ) const override;
+    qint64 doGetNbLine() const override;
+    int doGetMaxLength() const override;
+    int doGetLineLength( qint64 line ) const override;
+    QStringList doGetExpandedLinesForScan( qint64 first, int number ) const override;
+    QByteArray doGetRawLines( qint64 first_line, int number,
+            std::vector<int>* lineEnds ) const override;
+    bool doIsThreadSafe() const override { return true; }
+    bool doHasLineLengths() const override;
+    qint64 doGetLinesSize( qint64 first_line, qint64 last_line ) const override;
+
+    // Returns the current layout (without locking)
+    std::shared_ptr<const Layout> layout() const
+    { return std::atomic_load( &layout_ ); }
+    // Rebuild the layout from the line counts of the files
+    void updateLayout();
+
+    // Returns the index of the file (in files_) sending a signal
+    int senderIndex() const;
+    // Split the passed lines into ranges of lines of the files
+    std::vector<Part> split( const Layout& layout,
+            qint64 first_line, int number ) const;
+
+    std::vector<std::unique_ptr<LogData>> files_;
+    QStringList fileNames_;
+    // Only accessed through layout()
+    std::shared_ptr<const Layout> layout_;
+
+    // The files being (re)indexed and their progress
+    std::vector<bool> loading_;
+    std::vector<int> progress_;
+    // First failure reported since the files started loading
+    LoadingStatus loadingStatus_;
+};
+
+#endif
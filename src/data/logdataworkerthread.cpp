@@ -17,63 +17,315 @@
  * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <thread>
+#include <vector>
 
 #include "log.h"
+#include "perfcounters.h"
+#include "tracerecorder.h"
 
 #include "logdata.h"
 #include "logdataworkerthread.h"
+#include "bytescanner.h"
+#include "indexcache.h"
+#include "scanreader.h"
 
-// Size of the chunk to read (5 MiB)
+// Size of the first block read by the serial indexing, adapted to
+// the rate of the indexing then (see BlockSizer), and of the blocks
+// read by the parallel indexing (5 MiB)
 const int IndexOperation::sizeChunk = 5*1024*1024;
 
-void IndexingData::getAll( qint64* size, int* length,
-        LinePositionArray* linePosition )
+// Size of the data the encoding of a file is detected from (64 KiB)
+static const int encodingDetectionSize = 64*1024;
+
+const size_t SharedLinePositionArray::minSpilledPartSize = 1024*1024;
+
+void SharedLinePositionArray::append( LinePositionArray&& linePosition )
+{
+    if ( linePosition.size() == 0 )
+        return;
+
+    // If our final LF is fake, we stop using it
+    if ( fakeFinalLF_ ) {
+        size_--;
+        if ( --parts_.back().size == 0 )
+            parts_.pop_back();
+    }
+    fakeFinalLF_ = linePosition.hasFakeFinalLF();
+    hasLengths_ = ( hasLengths_ || size_ == 0 ) && linePosition.hasLengths();
+
+    const qint64 size = linePosition.size();
+    parts_.push_back( { std::make_shared<const LinePositionArray>(
+                std::move( linePosition ) ), size, size_ } );
+    size_ += size;
+
+    while ( parts_.size() >= 2 &&
+            parts_[ parts_.size() - 2 ].size <= 2 * parts_.back().size )
+        mergeLastParts();
+}
+
+qint64 SharedLinePositionArray::at( qint64 i ) const
+{
+    const Part& part = partOf( i );
+
+    return part.positions->at( i - part.first );
+}
+
+int SharedLinePositionArray::lengthAt( qint64 i ) const
+{
+    const Part& part = partOf( i );
+
+    return part.positions->lengthAt( i - part.first );
+}
+
+void SharedLinePositionArray::truncate( qint64 size )
+{
+    if ( size >= size_ )
+        return;
+
+    while ( ! parts_.empty() && parts_.back().first >= size )
+        parts_.pop_back();
+    if ( ! parts_.empty() )
+        parts_.back().size = size - parts_.back().first;
+
+    size_ = size;
+    fakeFinalLF_ = false;
+}
+
+SharedLinePositionArray SharedLinePositionArray::spilled() const
+{
+    SharedLinePositionArray copy = *this;
+
+    for ( Part& part : copy.parts_ ) {
+        if ( part.positions->isSpilled()
+                || part.positions->allocatedSize() < minSpilledPartSize )
+            continue;
+
+        std::shared_ptr<LinePositionArray> positions =
+            std::make_shared<LinePositionArray>();
+        if ( part.positions->spill( positions.get() ) )
+            part.positions = positions;
+        else
+            LOG(logWARNING) << "Cannot spill the line positions, kept in memory";
+    }
+
+    return copy;
+}
+
+size_t SharedLinePositionArray::allocatedSize() const
+{
+    size_t size = 0;
+    for ( const Part& part : parts_ )
+        size += part.positions->allocatedSize();
+
+    return size;
+}
+
+const SharedLinePositionArray::Part& SharedLinePositionArray::partOf(
+        qint64 i ) const
 {
-    QMutexLocker locker( &dataMutex_ );
+    if ( parts_.size() == 1 )
+        return parts_.front();
+
+    // Last part starting at or before i
+    std::vector<Part>::const_iterator part = std::upper_bound(
+            parts_.begin(), parts_.end(), i,
+            []( qint64 index, const Part& part ) { return index < part.first; } );
+
+    return *( --part );
+}
+
+void SharedLinePositionArray::mergeLastParts()
+{
+    const Part& previous = parts_[ parts_.size() - 2 ];
+    const Part& last = parts_.back();
+
+    LinePositionArray merged;
+    for ( const Part* part : { &previous, &last } ) {
+        const LinePositionArray& positions = *part->positions;
+        for ( qint64 i = 0; i < part->size; i++ ) {
+            if ( positions.hasLengths() )
+                merged.append( positions.at( i ), positions.lengthAt( i ) );
+            else
+                merged.append( positions.at( i ) );
+        }
+    }
+
+    const qint64 first = previous.first;
+    const qint64 size  = previous.size + last.size;
+    parts_.pop_back();
+    parts_.back() = { std::make_shared<const LinePositionArray>(
+            std::move( merged ) ), size, first };
+}
+
+bool IndexingData::takeAll( qint64* size, int* length,
+        LinePositionArray* linePosition, TimestampIndex::Samples* samples,
+        SkipIndex::Blocks* skipBlocks, TextEncoding* encoding )
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
 
     *size         = indexedSize_;
     *length       = maxLength_;
-    *linePosition = linePosition_;
+    *encoding     = encoding_;
+    *linePosition = std::move( linePosition_ );
+    linePosition_ = LinePositionArray();
+    *samples      = std::move( samples_ );
+    samples_.clear();
+    *skipBlocks   = std::move( skipBlocks_ );
+    skipBlocks_.clear();
+
+    const bool replace = replace_;
+    replace_ = false;
+
+    return replace;
 }
 
 void IndexingData::setAll( qint64 size, int length,
-        const LinePositionArray& linePosition )
+        LinePositionArray&& linePosition, TimestampIndex::Samples&& samples,
+        SkipIndex::Blocks&& skipBlocks, TextEncoding encoding )
 {
-    QMutexLocker locker( &dataMutex_ );
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
 
     indexedSize_  = size;
     maxLength_    = length;
-    linePosition_ = linePosition;
+    linePosition_ = std::move( linePosition );
+    samples_      = std::move( samples );
+    skipBlocks_   = std::move( skipBlocks );
+    encoding_     = encoding;
+    replace_      = true;
+}
+
+void IndexingData::addPrefix( qint64 size, int length,
+        TextEncoding encoding, LinePositionArray&& linePosition )
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    prefixSize_      = size;
+    prefixMaxLength_ = length;
+    prefixEncoding_  = encoding;
+    if ( prefixPosition_.size() == 0 )
+        prefixPosition_ = std::move( linePosition );
+    else
+        prefixPosition_ += linePosition;
+}
+
+bool IndexingData::takePrefix( qint64* size, int* length,
+        TextEncoding* encoding, LinePositionArray* linePosition )
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    if ( prefixPosition_.size() == 0 )
+        return false;
+
+    *size         = prefixSize_;
+    *length       = prefixMaxLength_;
+    *encoding     = prefixEncoding_;
+    *linePosition = std::move( prefixPosition_ );
+    prefixPosition_ = LinePositionArray();
+
+    return true;
+}
+
+void IndexingData::clearPrefix()
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    prefixPosition_ = LinePositionArray();
+    estimate_.reset();
+}
+
+void IndexingData::setEstimate( std::shared_ptr<const CheckpointIndex> estimate )
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    estimate_ = estimate;
+}
+
+std::shared_ptr<const CheckpointIndex> IndexingData::takeEstimate()
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    std::shared_ptr<const CheckpointIndex> estimate;
+    estimate.swap( estimate_ );
+
+    return estimate;
+}
+
+qint64 IndexingData::indexedSize()
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    return indexedSize_;
+}
+
+TextEncoding IndexingData::encoding()
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    return encoding_;
 }
 
 void IndexingData::addAll( qint64 size, int length,
-        const LinePositionArray& linePosition )
+        LinePositionArray&& linePosition, TimestampIndex::Samples&& samples,
+        SkipIndex::Blocks&& skipBlocks )
 {
-    QMutexLocker locker( &dataMutex_ );
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
 
     indexedSize_  += size;
     maxLength_     = qMax( maxLength_, length );
-    linePosition_ += linePosition;
+    // (appended to the positions not taken yet, if any, else moved in)
+    const qint64 first_line = linePosition_.size()
+        - ( linePosition_.hasFakeFinalLF() ? 1 : 0 );
+    if ( linePosition_.size() == 0 )
+        linePosition_ = std::move( linePosition );
+    else
+        linePosition_ += linePosition;
+    for ( const TimestampIndex::Sample& sample : samples )
+        samples_.push_back( { first_line + sample.line, sample.timestamp } );
+    for ( const SkipIndex::Block& block : skipBlocks )
+        skipBlocks_.push_back( { first_line + block.firstLine, block.nbLines,
+                block.bits } );
 }
 
 LogDataWorkerThread::LogDataWorkerThread()
-    : QThread(), mutex_(), operationRequestedCond_(),
-    nothingToDoCond_(), fileName_(), indexingData_()
+    : QObject(), mutex_(), nothingToDoCond_(), fileName_(),
+    timestampRule_( QRegExp() ), encoding_(), recordLineLengths_( false ),
+    buildSkipIndex_( false ), fusedSearch_(), indexingHints_(),
+    file_(), fileStart_( 0 ),
+    rotatedSize_( 0 ), readThrough_(),
+    columnIndex_( std::make_shared<ColumnIndex>() ),
+    runIndex_( std::make_shared<RunIndex>() ), indexingData_()
 {
     terminate_          = false;
     interruptRequested_ = false;
     operationRequested_ = NULL;
+    priority_           = TaskScheduler::Background;
+    attaching_          = false;
 }
 
 LogDataWorkerThread::~LogDataWorkerThread()
 {
+    expediteOperation();
+
+    TaskScheduler::TaskHandle task;
     {
         QMutexLocker locker( &mutex_ );
         terminate_ = true;
-        operationRequestedCond_.wakeAll();
+        // An operation not started is dropped, a running one finishes
+        if ( TaskScheduler::instance().cancel( task_ ) ) {
+            delete operationRequested_;
+            operationRequested_ = NULL;
+        }
+        task = task_;
     }
-    wait();
+    TaskScheduler::instance().wait( task );
 }
 
 void LogDataWorkerThread::attachFile( const QString& fileName )
@@ -81,6 +333,42 @@ void LogDataWorkerThread::attachFile( const QString& fileName )
     QMutexLocker locker( &mutex_ );  // to protect fileName_
 
     fileName_ = fileName;
+    attaching_ = true;
+}
+
+void LogDataWorkerThread::setTimestampRule( const TimestampRule& rule )
+{
+    QMutexLocker locker( &mutex_ );  // to protect timestampRule_
+
+    timestampRule_ = rule;
+}
+
+void LogDataWorkerThread::setEncoding( TextEncoding encoding )
+{
+    QMutexLocker locker( &mutex_ );  // to protect encoding_
+
+    encoding_ = encoding;
+}
+
+void LogDataWorkerThread::setRecordLineLengths( bool record )
+{
+    QMutexLocker locker( &mutex_ );  // to protect recordLineLengths_
+
+    recordLineLengths_ = record;
+}
+
+void LogDataWorkerThread::setBuildSkipIndex( bool build )
+{
+    QMutexLocker locker( &mutex_ );  // to protect buildSkipIndex_
+
+    buildSkipIndex_ = build;
+}
+
+void LogDataWorkerThread::setFusedSearch( std::shared_ptr<FusedSearch> search )
+{
+    QMutexLocker locker( &mutex_ );  // to protect fusedSearch_
+
+    fusedSearch_ = search;
 }
 
 void LogDataWorkerThread::indexAll()
@@ -90,12 +378,28 @@ void LogDataWorkerThread::indexAll()
     LOG(logDEBUG) << "FullIndex requested";
 
     // If an operation is ongoing, we will block
-    while ( (operationRequested_ != NULL) )
-        nothingToDoCond_.wait( &mutex_ );
+    waitForOperation();
+
+    // The matches of the fused search are not those of the lines
+    // indexed again
+    if ( fusedSearch_ && fusedSearch_->isComplete() ) {
+        fusedSearch_->abandon();
+        fusedSearch_.reset();
+    }
 
     interruptRequested_ = false;
-    operationRequested_ = new FullIndexOperation( fileName_, &interruptRequested_ );
-    operationRequestedCond_.wakeAll();
+    // The rotated files are forgotten
+    fileStart_ = 0;
+    // (and the lines might have changed)
+    columnIndex_->clear();
+    runIndex_->clear();
+    operationRequested_ = new FullIndexOperation( fileName_, &file_,
+            &interruptRequested_, timestampRule_, recordLineLengths_,
+            buildSkipIndex_, columnIndex_.get(), runIndex_.get(),
+            &readThrough_, encoding_, fusedSearch_, &indexingHints_,
+            attaching_ );
+    attaching_ = false;
+    submitOperation();
 }
 
 void LogDataWorkerThread::indexAdditionalLines( qint64 position )
@@ -105,12 +409,31 @@ void LogDataWorkerThread::indexAdditionalLines( qint64 position )
     LOG(logDEBUG) << "AddLines requested";
 
     // If an operation is ongoing, we will block
-    while ( (operationRequested_ != NULL) )
-        nothingToDoCond_.wait( &mutex_ );
+    waitForOperation();
 
     interruptRequested_ = false;
-    operationRequested_ = new PartialIndexOperation( fileName_, &interruptRequested_, position );
-    operationRequestedCond_.wakeAll();
+    operationRequested_ = new PartialIndexOperation( fileName_, &file_,
+            &interruptRequested_, timestampRule_, recordLineLengths_,
+            buildSkipIndex_, columnIndex_.get(), runIndex_.get(),
+            position, fileStart_ );
+    submitOperation();
+}
+
+void LogDataWorkerThread::indexRotatedFile()
+{
+    QMutexLocker locker( &mutex_ );  // to protect operationRequested_
+
+    LOG(logDEBUG) << "Rotation indexing requested";
+
+    // If an operation is ongoing, we will block
+    waitForOperation();
+
+    interruptRequested_ = false;
+    operationRequested_ = new RotationIndexOperation( fileName_, &file_,
+            &interruptRequested_, timestampRule_, recordLineLengths_,
+            buildSkipIndex_, columnIndex_.get(), runIndex_.get(),
+            &fileStart_, &rotatedSize_ );
+    submitOperation();
 }
 
 void LogDataWorkerThread::interrupt()
@@ -119,154 +442,1099 @@ void LogDataWorkerThread::interrupt()
 
     // No mutex here, setting a bool is probably atomic!
     interruptRequested_ = true;
+    // (a paused operation would not see it)
+    expediteOperation();
+}
+
+void LogDataWorkerThread::setPriority( TaskScheduler::Priority priority )
+{
+    QMutexLocker locker( &taskMutex_ );  // to protect priority_
+
+    priority_ = priority;
+    TaskScheduler::instance().setPriority( task_, priority );
 }
 
 // This will do an atomic copy of the object
 // (hopefully fast as we use Qt containers)
-void LogDataWorkerThread::getIndexingData(
-        qint64* indexedSize, int* maxLength, LinePositionArray* linePosition )
+bool LogDataWorkerThread::takeIndexingData( qint64* indexedSize,
+        int* maxLength, LinePositionArray* linePosition,
+        TimestampIndex::Samples* samples, SkipIndex::Blocks* skipBlocks,
+        TextEncoding* encoding )
+{
+    return indexingData_.takeAll( indexedSize, maxLength, linePosition,
+            samples, skipBlocks, encoding );
+}
+
+bool LogDataWorkerThread::takeIndexedPrefix( qint64* indexedSize,
+        int* maxLength, TextEncoding* encoding,
+        LinePositionArray* linePosition )
+{
+    return indexingData_.takePrefix( indexedSize, maxLength, encoding,
+            linePosition );
+}
+
+std::shared_ptr<const CheckpointIndex> LogDataWorkerThread::takeEstimate()
 {
-    indexingData_.getAll( indexedSize, maxLength, linePosition );
+    return indexingData_.takeEstimate();
+}
+
+void LogDataWorkerThread::setIndexingFocus( qint64 position )
+{
+    indexingHints_.focus = position;
+}
+
+void LogDataWorkerThread::setIndexingTail( bool tail )
+{
+    indexingHints_.tail = tail;
+}
+
+void LogDataWorkerThread::getRotation( qint64* rotatedSize, qint64* fileStart )
+{
+    QMutexLocker locker( &mutex_ );  // to protect fileStart_
+
+    *rotatedSize = rotatedSize_;
+    *fileStart   = fileStart_;
+}
+
+std::shared_ptr<ReadThroughFile> LogDataWorkerThread::getReadThroughFile()
+{
+    QMutexLocker locker( &mutex_ );  // to protect readThrough_
+
+    return readThrough_;
 }
 
-// This is the thread's main loop
-void LogDataWorkerThread::run()
+void LogDataWorkerThread::expediteOperation()
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    TaskScheduler::instance().expedite( task_ );
+}
+
+void LogDataWorkerThread::waitForOperation()
+{
+    if ( operationRequested_ && TaskScheduler::instance().cancel( task_ ) )
+        doOperation();
+
+    while ( (operationRequested_ != NULL) )
+        nothingToDoCond_.wait( &mutex_ );
+}
+
+void LogDataWorkerThread::submitOperation()
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    task_ = TaskScheduler::instance().submit(
+            [this] { runOperation(); }, priority_ );
+}
+
+void LogDataWorkerThread::runOperation()
 {
     QMutexLocker locker( &mutex_ );
 
-    forever {
-        while ( (terminate_ == false) && (operationRequested_ == NULL) )
-            operationRequestedCond_.wait( &mutex_ );
-        LOG(logDEBUG) << "Worker thread signaled";
+    doOperation();
+}
 
-        // Look at what needs to be done
-        if ( terminate_ )
-            return;      // We must die
+void LogDataWorkerThread::doOperation()
+{
+    if ( operationRequested_ == NULL )
+        return;
 
-        if ( operationRequested_ ) {
-            connect( operationRequested_, SIGNAL( indexingProgressed( int ) ),
-                    this, SIGNAL( indexingProgressed( int ) ) );
+    if ( ! terminate_ ) {
+        connect( operationRequested_, SIGNAL( indexingProgressed( int ) ),
+                this, SIGNAL( indexingProgressed( int ) ) );
+        connect( operationRequested_, SIGNAL( linesIndexed() ),
+                this, SIGNAL( linesIndexed() ) );
+        connect( operationRequested_, SIGNAL( linesEstimated() ),
+                this, SIGNAL( linesEstimated() ) );
 
-            // Run the operation
-            try {
-                if ( operationRequested_->start( indexingData_ ) ) {
-                    LOG(logDEBUG) << "... finished copy in workerThread.";
-                    emit indexingFinished( LoadingStatus::Successful );
-                }
-                else {
-                    emit indexingFinished( LoadingStatus::Interrupted );
-                }
+        // Run the operation
+        // (the lines it has shown and not taken yet are not to be
+        // shown once it has ended, whatever the outcome)
+        try {
+            TraceSpan span( "IndexOperation::start", "indexing" );
+            if ( operationRequested_->start( indexingData_ ) ) {
+                LOG(logDEBUG) << "... finished copy in workerThread.";
+                indexingData_.clearPrefix();
+                emit indexingFinished( LoadingStatus::Successful );
             }
-            catch ( std::bad_alloc& ba ) {
-                LOG(logERROR) << "Out of memory whilst indexing!";
-                emit indexingFinished( LoadingStatus::NoMemory );
+            else {
+                indexingData_.clearPrefix();
+                emit indexingFinished( LoadingStatus::Interrupted );
             }
-
-            delete operationRequested_;
-            operationRequested_ = NULL;
-            nothingToDoCond_.wakeAll();
+        }
+        catch ( std::bad_alloc& ba ) {
+            LOG(logERROR) << "Out of memory whilst indexing!";
+            indexingData_.clearPrefix();
+            emit indexingFinished( LoadingStatus::NoMemory );
         }
     }
+
+    delete operationRequested_;
+    operationRequested_ = NULL;
+    nothingToDoCond_.wakeAll();
 }
 
 //
 // Operations implementation
 //
 
-IndexOperation::IndexOperation( QString& fileName, bool* interruptRequest )
-    : fileName_( fileName )
+IndexOperation::IndexOperation( QString& fileName, QFile* file,
+        bool* interruptRequest, const TimestampRule& timestampRule,
+        bool recordLengths, bool buildSkipIndex, ColumnIndex* columnIndex,
+        RunIndex* runIndex )
+    : fileName_( fileName ), file_( file ), timestampRule_( timestampRule ),
+    recordLengths_( recordLengths ), buildSkipIndex_( buildSkipIndex ),
+    columnIndex_( columnIndex ), runIndex_( runIndex ),
+    encoding_(), fusedSearch_(), searchFused_( false ),
+    prefixData_( nullptr ), hints_( nullptr ), prefixNbLines_( 0 ),
+    prefixTimer_(), progress_( -1 ), progressTimer_()
 {
     interruptRequest_ = interruptRequest;
 }
 
 PartialIndexOperation::PartialIndexOperation( QString& fileName,
-        bool* interruptRequest, qint64 position )
-    : IndexOperation( fileName, interruptRequest )
+        QFile* file, bool* interruptRequest, const TimestampRule& timestampRule,
+        bool recordLengths, bool buildSkipIndex, ColumnIndex* columnIndex,
+        RunIndex* runIndex, qint64 position, qint64 fileStart )
+    : IndexOperation( fileName, file, interruptRequest, timestampRule,
+            recordLengths, buildSkipIndex, columnIndex, runIndex )
 {
     initialPosition_ = position;
+    fileStart_ = fileStart;
 }
 
-qint64 IndexOperation::doIndex( LinePositionArray& linePosition, int* maxLength,
-        qint64 initialPosition )
+RotationIndexOperation::RotationIndexOperation( QString& fileName,
+        QFile* file, bool* interruptRequest, const TimestampRule& timestampRule,
+        bool recordLengths, bool buildSkipIndex, ColumnIndex* columnIndex,
+        RunIndex* runIndex, qint64* fileStart, qint64* rotatedSize )
+    : IndexOperation( fileName, file, interruptRequest, timestampRule,
+            recordLengths, buildSkipIndex, columnIndex, runIndex )
 {
-    int max_length = *maxLength;
-    qint64 pos = initialPosition; // Absolute position of the start of current line
-    qint64 end = 0;               // Absolute position of the end of current line
-    int additional_spaces = 0;    // Additional spaces due to tabs
+    fileStart_ = fileStart;
+    rotatedSize_ = rotatedSize;
+}
+
+namespace {
+
+// Scans successive blocks of a file for end of lines, keeping track of
+// the tab-expanded length of the line being scanned.
+// The state being carried from one block to the next, a range of the
+// file can be indexed independently as long as the scanner is started
+// at the beginning of a line.
+// In an encoding of two bytes wide code units, the LF and tabs are only
+// recognised as whole units aligned on the start of the file, and the
+// length of a line is counted in units.
+// The length of each line is appended with its position if record_lengths
+// is set.
+// The timestamps of the lines are sampled every TimestampIndex::interval
+// lines if a (valid) rule is passed, the lines being numbered from 0.
+// A line with no timestamp (or across two blocks) is replaced by the next
+// one, up to maxSampleAttempts times.
+// The lines are added to the skip index if a builder is passed (one byte
+// wide code units only), the start of a line across blocks being kept
+// until its end is found (lines longer than SkipIndex::blockSize are
+// left out).
+// The lines are searched if a scan of a fused search is passed (one
+// byte wide code units only), those of a block at once at the end of
+// it, a line across blocks on its own once its end is found.
+// The column checkpoints of the long lines are recorded if a column
+// index is passed (only those within a block, the others being scanned
+// by LogData when displayed).
+class LineScanner
+{
+  public:
+    // pos is the absolute position of the start of the first line
+    LineScanner( qint64 pos, int max_length, const TextEncoding& encoding,
+            bool record_lengths, const TimestampRule* rule = nullptr,
+            TimestampIndex::Samples* samples = nullptr,
+            SkipIndex::Builder* skip_index = nullptr,
+            FusedSearch::Scan* search = nullptr,
+            ColumnIndex* columns = nullptr, RunIndex* runs = nullptr )
+        : pos_( pos ), additional_spaces_( 0 ), max_length_( max_length ),
+        record_lengths_( record_lengths ), unit_width_( encoding.unitWidth() ),
+        low_byte_( encoding.lowByteIndex() ), carry_( 0 ), encoding_( encoding ),
+        rule_( ( rule && rule->isValid() ) ? rule : nullptr ),
+        samples_( samples ), decoder_( encoding ),
+        line_( 0 ), next_sample_( 0 ), attempts_( 0 ),
+        skip_index_( unit_width_ == 1 ? skip_index : nullptr ),
+        search_( unit_width_ == 1 ? search : nullptr ), block_line_ends_(),
+        block_lines_start_( -1 ), pending_(), pending_too_long_( false ),
+        columns_( columns ), runs_( unit_width_ == 1 ? runs : nullptr ),
+        run_begin_( pos ), run_lines_( 0 ), first_run_( true ),
+        previous_( nullptr ), previous_length_( 0 ), previous_copy_() {}
+
+    // Scan a block read at block_beginning, appending the position of
+    // each new line to linePosition.
+    // Returns true if a line starting at or after stop_at has been reached,
+    // in which case the rest of the block is ignored.
+    bool scanBlock( const QByteArray& block, qint64 block_beginning,
+            LinePositionArray& linePosition, qint64 stop_at )
+    {
+        if ( unit_width_ == 2 )
+            return scanUnits( block, block_beginning, linePosition, stop_at );
+
+        const char* const data = block.constData();
+        const int length = block.length();
+
+        qint64 pos_within_block = 0;
+        while ( pos_within_block != -1 ) {
+            pos_within_block = qMax( pos_ - block_beginning, 0LL);
+            // Looking for the next \n, expanding tabs in the process
+            do {
+                pos_within_block += findEndOfLineOrTab(
+                        data + pos_within_block, length - pos_within_block );
+                if ( pos_within_block < length ) {
+                    if ( data[pos_within_block] == '\n' )
+                        break;
+
+                    // Tab
+                    additional_spaces_ += AbstractLogData::tabStop -
+                        ( ( ( block_beginning - pos_ ) + pos_within_block
+                            + additional_spaces_ ) % AbstractLogData::tabStop ) - 1;
+
+                    pos_within_block++;
+                }
+                else {
+                    pos_within_block = -1;
+                }
+            } while ( pos_within_block != -1 );
+
+            // When a end of line has been found...
+            if ( pos_within_block != -1 ) {
+                const qint64 end = pos_within_block + block_beginning;
+                endLine( data, block_beginning, end, end - pos_, linePosition );
+
+                if ( pos_ >= stop_at ) {
+                    if ( search_ )
+                        searchBlockLines( data );
+                    keepPreviousLine();
+                    return true;
+                }
+            }
+        }
+
+        if ( search_ )
+            searchBlockLines( data );
+        if ( skip_index_ || search_ )
+            keepPendingLine( data, length, block_beginning );
+        keepPreviousLine();
+
+        return false;
+    }
+
+    // Record the run the last line scanned is part of, whatever its
+    // length (the lines following it are scanned separately).
+    void finishRuns()
+    {
+        if ( runs_ && previous_ )
+            runs_->add( run_begin_, pos_, run_lines_,
+                    RunIndex::key( previous_, previous_length_ ) );
+        previous_ = nullptr;
+    }
+
+    // Search the current line, not terminated by a LF, which ends
+    // where the data scanned do.
+    void searchLastLine()
+    {
+        if ( search_ )
+            search_->matchLines( pending_.constData(), pending_.size(),
+                    { pending_.size() } );
+    }
+
+    // Absolute position of the start of the current line
+    qint64 pos() const { return pos_; }
+    int maxLength() const { return max_length_; }
+    // Length of the current line if it ended at end (the data up to
+    // end having been scanned)
+    int lengthUpTo( qint64 end ) const
+    { return ( end - pos_ ) / unit_width_ + additional_spaces_; }
+
+  private:
+    static const int maxSampleAttempts = 16;
+
+    // The same for two bytes wide code units, looked at one by one
+    // (their bytes could be part of other characters).
+    bool scanUnits( const QByteArray& block, qint64 block_beginning,
+            LinePositionArray& linePosition, qint64 stop_at )
+    {
+        const char* const data = block.constData();
+        const int length = block.length();
+
+        int i = qMax( pos_ - block_beginning, 0LL );
+        if ( ( block_beginning + i ) % 2 != 0 ) {
+            // The first unit started at the end of the previous block
+            if ( i == 0 && length > 0 && scanUnit( carry_, data[0],
+                        block_beginning - 1, data, block_beginning, linePosition )
+                    && pos_ >= stop_at )
+                return true;
+            i++;
+        }
+
+        for ( ; i + 1 < length; i += 2 ) {
+            if ( scanUnit( data[i], data[i + 1], block_beginning + i,
+                        data, block_beginning, linePosition )
+                    && pos_ >= stop_at )
+                return true;
+        }
+
+        if ( i < length )
+            carry_ = data[i];
+
+        return false;
+    }
+
+    // Scan the unit made of the two passed bytes, at position,
+    // returns whether it ends a line.
+    bool scanUnit( char first, char second, qint64 position,
+            const char* data, qint64 block_beginning,
+            LinePositionArray& linePosition )
+    {
+        const char low  = low_byte_ ? second : first;
+        const char high = low_byte_ ? first : second;
+        if ( high != 0 )
+            return false;
+
+        if ( low == '\t' ) {
+            additional_spaces_ += AbstractLogData::tabStop -
+                ( ( ( position - pos_ ) / 2 + additional_spaces_ )
+                  % AbstractLogData::tabStop ) - 1;
+        }
+        else if ( low == '\n' ) {
+            endLine( data, block_beginning, position, ( position - pos_ ) / 2,
+                    linePosition );
+            return true;
+        }
+
+        return false;
+    }
+
+    // Record the end of the current line, which has nb_units units
+    // (tabs not expanded) before its LF at end.
+    void endLine( const char* data, qint64 block_beginning, qint64 end,
+            qint64 nb_units, LinePositionArray& linePosition )
+    {
+        const int length = nb_units + additional_spaces_;
+        if ( length > max_length_ )
+            max_length_ = length;
+        if ( rule_ && line_ >= next_sample_ )
+            sampleLine( data, block_beginning, end );
+        if ( skip_index_ || search_ )
+            addLine( data, block_beginning, end );
+        if ( columns_ && end + unit_width_ - pos_ > AbstractLogData::longLineLength
+                && pos_ >= block_beginning )
+            addColumns( data + ( pos_ - block_beginning ), end );
+        if ( runs_ )
+            addRunLine( data, block_beginning, end );
+        line_++;
+        pos_ = end + unit_width_;
+        additional_spaces_ = 0;
+        if ( record_lengths_ )
+            linePosition.append( pos_, length );
+        else
+            linePosition.append( pos_ );
+    }
+
+    // Sample the timestamp of the current line, ending at end
+    void sampleLine( const char* data, qint64 block_beginning, qint64 end )
+    {
+        qint64 timestamp = TimestampRule::noTimestamp;
+        if ( pos_ >= block_beginning )
+            timestamp = rule_->timestamp( decoder_.decode(
+                        data + ( pos_ - block_beginning ), end - pos_, false ) );
+
+        if ( timestamp != TimestampRule::noTimestamp ) {
+            samples_->push_back( { line_, timestamp } );
+            next_sample_ = line_ + TimestampIndex::interval;
+            attempts_ = 0;
+        }
+        else if ( ++attempts_ >= maxSampleAttempts ) {
+            next_sample_ = line_ + TimestampIndex::interval;
+            attempts_ = 0;
+        }
+    }
+
+    // Add the current line, ending at end, to the skip index and to
+    // the lines of the block to search (searching it now if it started
+    // in a previous block)
+    void addLine( const char* data, qint64 block_beginning, qint64 end )
+    {
+        if ( pending_too_long_ ) {
+            skip_index_->skipLine();
+        }
+        else if ( pos_ >= block_beginning ) {
+            const int start = pos_ - block_beginning;
+            if ( skip_index_ )
+                skip_index_->addLine( data + start, end - pos_ );
+            if ( search_ ) {
+                if ( block_lines_start_ == -1 )
+                    block_lines_start_ = start;
+                block_line_ends_.push_back(
+                        end - block_beginning - block_lines_start_ );
+            }
+        }
+        else {
+            pending_.append( data, end - block_beginning );
+            if ( skip_index_ )
+                skip_index_->addLine( pending_.constData(), pending_.size() );
+            if ( search_ )
+                search_->matchLines( pending_.constData(), pending_.size(),
+                        { pending_.size() } );
+        }
+
+        pending_.clear();
+        pending_too_long_ = false;
+    }
+
+    // Record the column checkpoints of the current line, which is at
+    // line and ends at end
+    void addColumns( const char* line, qint64 end )
+    {
+        // The byte order mark is not part of the first line
+        const int bom = ( pos_ == 0 ) ?
+            encoding_.bomLength( line, qMin<qint64>( end - pos_, 4 ) ) : 0;
+
+        columns_->add( pos_ + bom, end, ColumnIndex::checkpoints(
+                    encoding_, line + bom, end - pos_ - bom ) );
+    }
+
+    // Add the current line, ending at end, to the run of the lines
+    // similar to it, recording the previous run if it is not.
+    // A line started in a previous block ends the runs.
+    void addRunLine( const char* data, qint64 block_beginning, qint64 end )
+    {
+        const char* line = ( pos_ >= block_beginning ) ?
+            data + ( pos_ - block_beginning ) : nullptr;
+        const int length = end - pos_;
+
+        if ( line && previous_ && length == previous_length_
+                && RunIndex::similar( line, previous_, length ) ) {
+            run_lines_++;
+        }
+        else {
+            closeRun();
+            run_begin_ = pos_;
+            run_lines_ = 1;
+        }
+
+        previous_ = line;
+        previous_length_ = length;
+    }
+
+    // Record the run ending at the current line, if it has several
+    // lines or is the first one (which could continue the lines
+    // scanned before)
+    void closeRun()
+    {
+        if ( previous_ && ( run_lines_ >= 2 || first_run_ ) )
+            runs_->add( run_begin_, pos_, run_lines_,
+                    RunIndex::key( previous_, previous_length_ ) );
+        if ( previous_ )
+            first_run_ = false;
+    }
+
+    // Keep a copy of the last line scanned, the block being released
+    void keepPreviousLine()
+    {
+        if ( previous_ ) {
+            previous_copy_ = QByteArray( previous_, previous_length_ );
+            previous_ = previous_copy_.constData();
+        }
+    }
+
+    // Search the lines of the block ended so far
+    void searchBlockLines( const char* data )
+    {
+        if ( ! block_line_ends_.empty() ) {
+            search_->matchLines( data + block_lines_start_,
+                    block_line_ends_.back(), block_line_ends_ );
+            block_line_ends_.clear();
+        }
+        block_lines_start_ = -1;
+    }
+
+    // Keep the start of the current line, in the end of the block
+    // (whole if it is to be searched)
+    void keepPendingLine( const char* data, int length, qint64 block_beginning )
+    {
+        const int start = qMax( pos_ - block_beginning, 0LL );
+        if ( ! search_
+                && pending_.size() + length - start > SkipIndex::blockSize ) {
+            pending_.clear();
+            pending_too_long_ = true;
+        }
+        else if ( ! pending_too_long_ ) {
+            pending_.append( data + start, length - start );
+        }
+    }
+
+    qint64 pos_;
+    int additional_spaces_;    // Additional spaces due to tabs
+    int max_length_;
+    const bool record_lengths_;
+
+    // Code units
+    const int unit_width_;
+    const int low_byte_;
+    // Last byte of the previous block, if it ended in the middle of a unit
+    char carry_;
+    const TextEncoding encoding_;
+
+    // Timestamp sampling
+    const TimestampRule* rule_;
+    TimestampIndex::Samples* samples_;
+    LineDecoder decoder_;
+    qint64 line_;
+    qint64 next_sample_;
+    int attempts_;
+
+    // Skip index
+    SkipIndex::Builder* skip_index_;
+    // Fused search, and the lines of the block to search (their ends
+    // from the start of the first one)
+    FusedSearch::Scan* search_;
+    std::vector<int> block_line_ends_;
+    int block_lines_start_;
+    // Start of the current line, read in the previous blocks
+    QByteArray pending_;
+    bool pending_too_long_;
+
+    // Column checkpoints
+    ColumnIndex* columns_;
+
+    // Runs of similar lines: the current one and its last line
+    RunIndex* runs_;
+    qint64 run_begin_;
+    qint64 run_lines_;
+    bool first_run_;
+    const char* previous_;
+    int previous_length_;
+    QByteArray previous_copy_;
+};
+
+// Returns the position of the first line starting at or after 'position'
+// or -1 if none can be found before 'end'.
+qint64 firstLineStartingAfter( QFile& file, qint64 position, qint64 end )
+{
+    // Are we already at the start of a line?
+    file.seek( position - 1 );
+    char c;
+    if ( file.getChar( &c ) && c == '\n' )
+        return position;
+
+    while ( !file.atEnd() && file.pos() < end ) {
+        const qint64 block_beginning = file.pos();
+        const QByteArray block = file.read( 64*1024 );
+        const int lf = block.indexOf( '\n' );
+        if ( lf != -1 ) {
+            const qint64 start = block_beginning + lf + 1;
+            return ( start < end ) ? start : -1;
+        }
+    }
+
+    return -1;
+}
+
+// Append the samples to the samples of the lines before first_line
+void appendSamples( TimestampIndex::Samples& samples,
+        const TimestampIndex::Samples& added, qint64 first_line )
+{
+    for ( const TimestampIndex::Sample& sample : added )
+        samples.push_back( { first_line + sample.line, sample.timestamp } );
+}
+
+// Append the blocks to the blocks of the lines before first_line
+void appendSkipBlocks( SkipIndex::Blocks& blocks,
+        const SkipIndex::Blocks& added, qint64 first_line )
+{
+    for ( const SkipIndex::Block& block : added )
+        blocks.push_back( { first_line + block.firstLine, block.nbLines,
+                block.bits } );
+}
+
+// Returns whether position is in the middle of a line of the file
+// (of one byte wide code units)
+bool isInLine( QFile& file, qint64 position )
+{
+    char c;
+    return position > 0 && file.seek( position - 1 )
+        && file.getChar( &c ) && c != '\n';
+}
+
+// Adds an indexing of size bytes into nb_lines lines, timed by timer,
+// to the performance counters
+void countIndexing( qint64 size, qint64 nb_lines, const QElapsedTimer& timer )
+{
+    PerfCounters::add( PerfCounters::BytesIndexed, size );
+    PerfCounters::add( PerfCounters::LinesIndexed, nb_lines );
+    PerfCounters::add( PerfCounters::IndexingTime, timer.nsecsElapsed() );
+}
+
+// Returns the positions moved by offset (from the file to the data
+// it is part of), the passed ones being moved out if they do not change
+LinePositionArray shiftPositions( LinePositionArray&& linePosition,
+        qint64 offset )
+{
+    if ( offset == 0 )
+        return std::move( linePosition );
+
+    LinePositionArray shifted;
+    for ( qint64 i = 0; i < linePosition.size(); i++ ) {
+        if ( linePosition.hasLengths() )
+            shifted.append( linePosition[i] + offset, linePosition.lengthAt( i ) );
+        else
+            shifted.append( linePosition[i] + offset );
+    }
+    shifted.setFakeFinalLF( linePosition.hasFakeFinalLF() );
+
+    return shifted;
+}
+
+// Returns the encoding detected from the first bytes of the file
+TextEncoding detectEncoding( const QString& fileName )
+{
+    QFile file( fileName );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return TextEncoding();
+
+    const QByteArray data = file.read( encodingDetectionSize );
+
+    return TextEncoding::detect( data.constData(), data.size() );
+}
+
+}
+
+// Minimum size of data to index for the parallel path to be used (64 MiB)
+const qint64 IndexOperation::parallelThreshold = 64*1024*1024;
+
+// Minimum time between two showings of the lines indexed so far (ms)
+const int IndexOperation::prefixInterval = 500;
+// Interval between the progress notifications (20 per second)
+const int IndexOperation::progressInterval = 50;
+
+// Maximum size of a chunk indexed in parallel when the lines are shown
+// as they are indexed (256 MiB)
+const qint64 IndexOperation::prefixChunkSize = 256*1024*1024;
+
+qint64 IndexOperation::doIndex( LinePositionArray& linePosition,
+        TimestampIndex::Samples& samples, SkipIndex::Blocks& skipBlocks,
+        int* maxLength, qint64 initialPosition, bool parallel )
+{
+    // The file is only opened if it is not already (or has been closed
+    // by a full indexing), unbuffered as it is read by big blocks.
+    QFile& file = *file_;
+    if ( ! file.isOpen() || file.fileName() != fileName_ ) {
+        file.close();
+        file.setFileName( fileName_ );
+        file.open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+    }
+
+    if ( file.isOpen() ) {
+        QElapsedTimer timer;
+        timer.start();
+        const qint64 initial_nb_lines = linePosition.size();
+
+        // The line the indexing starts in (after the data indexed
+        // before) is left out of the skip index.
+        const bool skipIndex = buildSkipIndex_ && encoding_.unitWidth() == 1;
+        const bool midLine = skipIndex && isInLine( file, initialPosition );
+
+        FusedSearch* const search = fusedSearch( initialPosition );
+
+        const int nbThreads = TaskScheduler::instance().maxThreads();
+        if ( parallel && nbThreads > 1 && encoding_.unitWidth() == 1
+                && file.size() - initialPosition >= parallelThreshold ) {
+            ChunkResult result = doParallelIndex( file.size(),
+                    nbThreads, initialPosition, midLine, *maxLength, search );
+
+            if ( result.succeeded ) {
+                appendSamples( samples, result.samples, linePosition.size() );
+                appendSkipBlocks( skipBlocks, result.skipBlocks,
+                        linePosition.size() );
+                linePosition += result.linePosition;
+                *maxLength = result.maxLength;
+
+                // Check if there is a non LF terminated line at the end of the file
+                // (its length is only known once read again)
+                if ( file.size() > result.lastLineStart ) {
+                    int length = 0;
+                    if ( recordLengths_ && file.seek( result.lastLineStart ) ) {
+                        const QByteArray line =
+                            file.read( file.size() - result.lastLineStart );
+                        length = AbstractLogData::expandedLength(
+                                line.constData(), line.size() );
+                    }
+                    appendFakeFinalLF( linePosition, file.size(), length );
+                }
+
+                countIndexing( file.size() - initialPosition,
+                        linePosition.size() - initial_nb_lines, timer );
+                return file.size();
+            }
+            else if ( ! *interruptRequest_ ) {
+                LOG( logWARNING ) << "Parallel indexing failed, "
+                    "reverting to serial indexing";
+                if ( search )
+                    search->restart();
+            }
+        }
+
+        const TimestampRule& rule = timestampRule_;
+        TimestampIndex::Samples new_samples;
+        SkipIndex::Blocks new_blocks;
+        SkipIndex::Builder builder( &new_blocks );
+        if ( midLine )
+            builder.skipLine();
+        const qint64 first_line = linePosition.size();
+        std::unique_ptr<FusedSearch::Scan> scan(
+                search ? new FusedSearch::Scan( *search ) : nullptr );
+        LineScanner scanner( initialPosition, *maxLength, encoding_,
+                recordLengths_, &rule, &new_samples,
+                skipIndex ? &builder : nullptr, scan.get(), columnIndex_,
+                runIndex_ );
 
-    QFile file( fileName_ );
-    if ( file.open( QIODevice::ReadOnly ) ) {
         // Count the number of lines and max length
-        // (read big chunks to speed up reading from disk)
-        file.seek( pos );
-        while ( !file.atEnd() ) {
+        // (read big chunks to speed up reading from disk, the next
+        // ones being read while one is scanned)
+        BlockPrefetcher reader( file, initialPosition, sizeChunk );
+        BlockSizer sizer( sizeChunk );
+        QElapsedTimer block_timer;
+        block_timer.start();
+        qint64 block_beginning = initialPosition;
+        forever {
+            TaskScheduler::instance().yield();
             if ( *interruptRequest_ )   // a bool is always read/written atomically isn't it?
                 break;
 
-            // Read a chunk of 5MB
-            const qint64 block_beginning = file.pos();
-            const QByteArray block = file.read( sizeChunk );
+            // Read a block, the next ones being sized from the time the
+            // previous one took to be read and scanned
+            const QByteArray block = reader.next();
+            if ( block.isEmpty() )
+                break;
 
             // Count the number of lines in each chunk
-            qint64 pos_within_block = 0;
-            while ( pos_within_block != -1 ) {
-                pos_within_block = qMax( pos - block_beginning, 0LL);
-                // Looking for the next \n, expanding tabs in the process
-                do {
-                    if ( pos_within_block < block.length() ) {
-                        const char c = block.at(pos_within_block);
-                        if ( c == '\n' )
-                            break;
-                        else if ( c == '\t' )
-                            additional_spaces += AbstractLogData::tabStop -
-                                ( ( ( block_beginning - pos ) + pos_within_block
-                                    + additional_spaces ) % AbstractLogData::tabStop ) - 1;
-
-                        pos_within_block++;
-                    }
-                    else {
-                        pos_within_block = -1;
-                    }
-                } while ( pos_within_block != -1 );
-
-                // When a end of line has been found...
-                if ( pos_within_block != -1 ) {
-                    end = pos_within_block + block_beginning;
-                    const int length = end-pos + additional_spaces;
-                    if ( length > max_length )
-                        max_length = length;
-                    pos = end + 1;
-                    additional_spaces = 0;
-                    linePosition.append( pos );
-                }
-            }
+            scanner.scanBlock( block, block_beginning, linePosition,
+                    std::numeric_limits<qint64>::max() );
+            block_beginning += block.size();
+            if ( search )
+                search->append( *scan );
+            publishPrefix( linePosition, scanner.maxLength() );
+
+            sizer.processed( block.size(), block_timer.nsecsElapsed() );
+            block_timer.restart();
+            reader.setBlockSize( sizer.size() );
 
             // Update the caller for progress indication
-            int progress = ( file.size() > 0 ) ? pos*100 / file.size() : 100;
-            emit indexingProgressed( progress );
+            int progress = ( file.size() > 0 ) ? scanner.pos()*100 / file.size() : 100;
+            reportProgress( progress );
         }
 
         // Check if there is a non LF terminated line at the end of the file
-        if ( file.size() > pos ) {
-            LOG( logWARNING ) <<
-                "Non LF terminated file, adding a fake end of line";
-            linePosition.append( file.size() + 1 );
-            linePosition.setFakeFinalLF();
+        if ( file.size() > scanner.pos() ) {
+            appendFakeFinalLF( linePosition, file.size(),
+                    scanner.lengthUpTo( file.size() ) );
+            if ( search ) {
+                scanner.searchLastLine();
+                search->append( *scan );
+            }
         }
+
+        *maxLength = scanner.maxLength();
+        appendSamples( samples, new_samples, first_line );
+        builder.finish();
+        scanner.finishRuns();
+        appendSkipBlocks( skipBlocks, new_blocks, first_line );
+
+        countIndexing( scanner.pos() - initialPosition,
+                linePosition.size() - initial_nb_lines, timer );
     }
     else {
-        // TODO: Check that the file is seekable?
+        // (the pipes are spooled to a file by LogData, see PipeSpooler)
         // If the file cannot be open, we do as if it was empty
         LOG(logWARNING) << "Cannot open file " << fileName_.toStdString();
 
-        emit indexingProgressed( 100 );
+        reportProgress( 100 );
     }
 
-    *maxLength = max_length;
-
     return file.size();
 }
 
+FusedSearch* IndexOperation::fusedSearch( qint64 initialPosition )
+{
+    // The raw lines are matched as UTF-8, as by the searches
+    if ( ! fusedSearch_ || initialPosition != 0
+            || ( encoding_.type() != TextEncoding::Utf8
+                && encoding_.type() != TextEncoding::Auto ) )
+        return nullptr;
+
+    searchFused_ = true;
+    fusedSearch_->restart();
+
+    return fusedSearch_.get();
+}
+
+void IndexOperation::publishPrefix( const LinePositionArray& linePosition,
+        int maxLength )
+{
+    if ( ! prefixData_ || linePosition.size() <= prefixNbLines_ )
+        return;
+
+    if ( ! prefixTimer_.isValid() )
+        prefixTimer_.start();
+    else if ( prefixTimer_.elapsed() < prefixInterval )
+        return;
+    prefixTimer_.restart();
+
+    // (a copy, the positions being still added to)
+    LinePositionArray prefix;
+    const bool lengths = linePosition.hasLengths();
+    for ( qint64 i = prefixNbLines_; i < linePosition.size(); i++ ) {
+        if ( lengths )
+            prefix.append( linePosition.at( i ), linePosition.lengthAt( i ) );
+        else
+            prefix.append( linePosition.at( i ) );
+    }
+    prefixNbLines_ = linePosition.size();
+
+    prefixData_->addPrefix( linePosition.at( prefixNbLines_ - 1 ), maxLength,
+            encoding_, std::move( prefix ) );
+    emit linesIndexed();
+}
+
+void IndexOperation::reportProgress( int progress )
+{
+    if ( progress == progress_ )
+        return;
+
+    // The start and the end are always reported
+    if ( progress != 0 && progress != 100
+            && progressTimer_.isValid()
+            && progressTimer_.elapsed() < progressInterval )
+        return;
+
+    progress_ = progress;
+    progressTimer_.start();
+    emit indexingProgressed( progress );
+}
+
+void IndexOperation::appendFakeFinalLF( LinePositionArray& linePosition,
+        qint64 end, int length ) const
+{
+    LOG( logWARNING ) << "Non LF terminated file, adding a fake end of line";
+
+    if ( recordLengths_ )
+        linePosition.append( end + encoding_.unitWidth(), length );
+    else
+        linePosition.append( end + encoding_.unitWidth() );
+    linePosition.setFakeFinalLF();
+}
+
+// Each chunk [begin, end) is indexed by its own thread, using its own
+// QFile. A chunk owns the lines starting within it and reads past its
+// end to complete the last one, so the concatenation of the results
+// is identical to what the serial path would produce.
+IndexOperation::ChunkResult IndexOperation::doParallelIndex( qint64 size,
+        int nbThreads, qint64 initialPosition, bool midLine, int maxLength,
+        FusedSearch* search )
+{
+    ChunkResult result;
+    result.succeeded = true;
+    result.maxLength = maxLength;
+    result.lastLineStart = initialPosition;
+
+    // Chunks are made of whole blocks, indexed in waves of nbThreads
+    // chunks (a single wave if the lines are not shown).
+    // The lines being shown as they are indexed, the waves go from the
+    // start of the file by chunks of at most prefixChunkSize. A hint
+    // beyond the next wave has the chunk around it indexed by one of
+    // the threads of the wave, its result being kept until the waves
+    // reach it, so it is merged then without being indexed again.
+    std::map<qint64, AheadChunk> ahead;
+    qint64 position = initialPosition;
+    qint64 indexed = initialPosition;
+    while ( position < size && result.succeeded ) {
+        publishPrefix( result.linePosition, result.maxLength );
+
+        const qint64 nbBlocks = ( size - position + sizeChunk - 1 ) / sizeChunk;
+        qint64 chunkSize = ( ( nbBlocks + nbThreads - 1 ) / nbThreads ) * sizeChunk;
+        if ( prefixData_ )
+            chunkSize = qMin( chunkSize, prefixChunkSize );
+
+        std::vector<std::thread> threads;
+        // The chunks indexed by the threads, from begin to end
+        std::vector<std::pair<qint64, qint64>> bounds;
+
+        if ( prefixData_ && hints_ ) {
+            const qint64 hints[] = { hints_->focus.load(),
+                hints_->tail.load() ? size - 1 : -1 };
+            for ( qint64 hint : hints ) {
+                // One thread at least goes on from the start
+                if ( threads.size() + 1 >= size_t( nbThreads ) )
+                    break;
+                if ( hint < position + chunkSize * nbThreads || hint >= size )
+                    continue;
+
+                // Unless it is already indexed, the chunk is centred on
+                // the hint, without overlapping the other chunks ahead
+                auto next = ahead.upper_bound( hint );
+                if ( next != ahead.begin() && std::prev( next )->second.end > hint )
+                    continue;
+                qint64 begin = qMin( hint - chunkSize / 2, size - chunkSize );
+                next = ahead.upper_bound( begin );
+                if ( next != ahead.begin() && std::prev( next )->second.end > begin )
+                    begin = std::prev( next )->second.end;
+                qint64 end = qMin( begin + chunkSize, size );
+                if ( next != ahead.end() )
+                    end = qMin( end, next->first );
+                if ( end <= begin )
+                    continue;
+
+                LOG(logDEBUG) << "Indexing ahead from " << begin
+                    << " to " << end;
+
+                AheadChunk& chunk = ahead[ begin ];
+                chunk.end = end;
+                chunk.result.succeeded = false;
+                threads.emplace_back( &IndexOperation::indexChunk, this,
+                        begin, ( end == size ) ?
+                            std::numeric_limits<qint64>::max() : end,
+                        false, false, search, &chunk.result );
+                bounds.emplace_back( begin, end );
+            }
+        }
+
+        LOG(logDEBUG) << "Parallel indexing from " << position
+            << " using chunks of " << chunkSize << " bytes";
+
+        // The results to merge, in the order of the file (those of the
+        // chunks ahead being taken from there)
+        std::vector<ChunkResult> results( nbThreads );
+        size_t nbResults = 0;
+        std::vector<ChunkResult*> merged;
+        std::vector<qint64> aheadMerged;
+        while ( threads.size() < size_t( nbThreads ) && position < size ) {
+            const auto next = ahead.lower_bound( position );
+            if ( next != ahead.end() && next->first == position ) {
+                merged.push_back( &next->second.result );
+                aheadMerged.push_back( position );
+                position = next->second.end;
+                continue;
+            }
+
+            const qint64 begin = position;
+            position = qMin( begin + chunkSize, size );
+            if ( next != ahead.end() )
+                position = qMin( position, next->first );
+            // The last chunk goes on until the end of file, as the
+            // serial path does
+            const qint64 end = ( position == size ) ?
+                std::numeric_limits<qint64>::max() : position;
+            const bool firstChunk = ( begin == initialPosition );
+
+            ChunkResult* const chunk_result = &results[ nbResults++ ];
+            threads.emplace_back( &IndexOperation::indexChunk, this,
+                    begin, end, firstChunk, ( firstChunk && midLine ), search,
+                    chunk_result );
+            bounds.emplace_back( begin, position );
+            merged.push_back( chunk_result );
+        }
+
+        for ( size_t i = 0; i < threads.size(); i++ ) {
+            threads[i].join();
+            indexed += bounds[i].second - bounds[i].first;
+            reportProgress( indexed * 100 / size );
+        }
+
+        for ( ChunkResult* chunk : merged ) {
+            if ( chunk->succeeded && result.succeeded ) {
+                appendSamples( result.samples, chunk->samples,
+                        result.linePosition.size() );
+                appendSkipBlocks( result.skipBlocks, chunk->skipBlocks,
+                        result.linePosition.size() );
+                result.linePosition += chunk->linePosition;
+                result.maxLength = qMax( result.maxLength, chunk->maxLength );
+                if ( chunk->linePosition.size() > 0 )
+                    result.lastLineStart = chunk->lastLineStart;
+                // The matches found so far are those of the first lines
+                if ( chunk->fusedScan )
+                    search->append( *chunk->fusedScan );
+            }
+            else {
+                result.succeeded = false;
+            }
+
+            // Free the memory as soon as possible
+            chunk->linePosition = LinePositionArray();
+            chunk->samples = TimestampIndex::Samples();
+            chunk->skipBlocks = SkipIndex::Blocks();
+            chunk->fusedScan.reset();
+        }
+        for ( qint64 begin : aheadMerged )
+            ahead.erase( begin );
+    }
+
+    return result;
+}
+
+// Called in a thread of its own, should only use its own variables
+void IndexOperation::indexChunk( qint64 begin, qint64 end,
+        bool firstChunk, bool midLine, const FusedSearch* search,
+        ChunkResult* result ) const
+{
+    result->succeeded = false;
+    result->maxLength = 0;
+
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return;
+
+    const qint64 start = firstChunk ? begin :
+        firstLineStartingAfter( file, begin, end );
+    result->lastLineStart = start;
+
+    if ( start != -1 ) {
+        const TimestampRule& rule = timestampRule_;
+        SkipIndex::Builder builder( &result->skipBlocks );
+        if ( midLine )
+            builder.skipLine();
+        if ( search )
+            result->fusedScan.reset( new FusedSearch::Scan( *search ) );
+        LineScanner scanner( start, 0, encoding_, recordLengths_,
+                &rule, &result->samples,
+                buildSkipIndex_ ? &builder : nullptr, result->fusedScan.get(),
+                columnIndex_, runIndex_ );
+
+        ScanReader reader( file );
+        qint64 block_beginning = start;
+        bool stopped = false;
+        while ( block_beginning < file.size() ) {
+            if ( *interruptRequest_ )
+                return;
+
+            const QByteArray block = reader.read( block_beginning, sizeChunk );
+            if ( block.isEmpty() )
+                break;
+
+            if ( scanner.scanBlock( block, block_beginning,
+                        result->linePosition, end ) ) {
+                stopped = true;
+                break;
+            }
+            block_beginning += block.size();
+        }
+
+        // The last line of the file, not terminated by a LF
+        if ( ! stopped && block_beginning > scanner.pos() )
+            scanner.searchLastLine();
+
+        builder.finish();
+        scanner.finishRuns();
+        result->maxLength = scanner.maxLength();
+        result->lastLineStart = scanner.pos();
+    }
+
+    result->succeeded = true;
+}
+
 // Called in the worker thread's context
 // Should not use any shared variable
 bool FullIndexOperation::start( IndexingData& sharedData )
@@ -274,18 +1542,95 @@ bool FullIndexOperation::start( IndexingData& sharedData )
     LOG(logDEBUG) << "FullIndexOperation::start(), file "
         << fileName_.toStdString();
 
+    // The file might have been replaced since it was opened
+    file_->close();
+
     LOG(logDEBUG) << "FullIndexOperation: Starting the count...";
     int maxLength = 0;
     LinePositionArray linePosition = LinePositionArray();
+    TimestampIndex::Samples samples;
+    SkipIndex::Blocks skipBlocks;
+
+    reportProgress( 0 );
 
-    emit indexingProgressed( 0 );
+    std::shared_ptr<ReadThroughFile> readThrough;
+    if ( RemoteFile::isRemote( fileName_ ) ) {
+        readThrough = std::make_shared<RemoteFile>( fileName_ );
+    }
+    else {
+        const CompressedFile::Format format = CompressedFile::detectFormat(
+                QFile::encodeName( fileName_ ).constData() );
+        if ( format != CompressedFile::Format::Uncompressed
+                && CompressedFile::isSupported( format ) )
+            readThrough = std::make_shared<CompressedFile>(
+                    QFile::encodeName( fileName_ ).constData(), format );
+    }
+
+    // The encoding of a compressed (or remote) file is detected as
+    // it is read
+    if ( encoding_.type() == TextEncoding::Auto && ! readThrough )
+        encoding_ = detectEncoding( fileName_ );
+    LOG(logDEBUG) << "FullIndexOperation: reading the file as " << encoding_.name();
+
+    // Try the index saved last time the file was opened (it has
+    // no timestamps, no lengths of lines, no skip index and ends of
+    // line of one byte)
+    IndexCache cache;
+    qint64 size = 0;
+    const IndexCache::Validity cached =
+        ( readThrough || timestampRule_.isValid() || recordLengths_
+          || buildSkipIndex_ || encoding_.unitWidth() != 1 ) ?
+        IndexCache::Invalid :
+        cache.load( fileName_, &size, &maxLength, &linePosition );
+
+    if ( readThrough ) {
+        // The index is not cached, the checkpoints to read the data
+        // being only recorded while decompressing (and a remote file
+        // being possibly changed).
+        LOG(logDEBUG) << "FullIndexOperation: reading the file through";
+        size = doIndexReadThrough( *readThrough, linePosition, samples,
+                skipBlocks, &maxLength );
+    }
+    else if ( cached == IndexCache::UpToDate ) {
+        LOG(logDEBUG) << "FullIndexOperation: using the cached index";
+        // Opened as if indexed, for the next operations
+        file_->setFileName( fileName_ );
+        file_->open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+        reportProgress( 100 );
+    }
+    else {
+        if ( cached == IndexCache::FileGrown ) {
+            LOG(logDEBUG) << "FullIndexOperation: completing the cached index from "
+                << size;
+            LinePositionArray additionalPosition = LinePositionArray();
+            size = doIndex( additionalPosition, samples, skipBlocks,
+                    &maxLength, size );
+            linePosition += additionalPosition;
+        }
+        else {
+            // The lines of a file being attached are shown as they are
+            // indexed, their number being estimated first
+            if ( showPrefix_ ) {
+                prefixData_ = &sharedData;
+                estimateLines( sharedData );
+            }
+            size = doIndex( linePosition, samples, skipBlocks, &maxLength, 0 );
+            prefixData_ = nullptr;
+        }
 
-    qint64 size = doIndex( linePosition, &maxLength, 0 );
+        if ( *interruptRequest_ == false && ! timestampRule_.isValid()
+                && encoding_.unitWidth() == 1 )
+            cache.save( fileName_, size, maxLength, linePosition );
+    }
 
     if ( *interruptRequest_ == false )
     {
         // Commit the results to the shared data (atomically)
-        sharedData.setAll( size, maxLength, linePosition );
+        sharedData.setAll( size, maxLength, std::move( linePosition ),
+                std::move( samples ), std::move( skipBlocks ), encoding_ );
+        *readThrough_ = readThrough;
+        if ( searchFused_ )
+            fusedSearch_->complete();
     }
 
     LOG(logDEBUG) << "FullIndexOperation: ... finished counting."
@@ -294,6 +1639,113 @@ bool FullIndexOperation::start( IndexingData& sharedData )
     return ( *interruptRequest_ ? false : true );
 }
 
+void FullIndexOperation::estimateLines( IndexingData& sharedData )
+{
+    // Only the files indexed in parallel are worth it
+    QFile file( fileName_ );
+    if ( encoding_.unitWidth() != 1
+            || ! file.open( QIODevice::ReadOnly | QIODevice::Unbuffered )
+            || file.size() < parallelThreshold )
+        return;
+
+    std::shared_ptr<CheckpointIndex> estimate =
+        std::make_shared<CheckpointIndex>();
+    if ( estimate->build( &file, file.size() ) ) {
+        LOG(logDEBUG) << "FullIndexOperation: about " << estimate->nbLines()
+            << " lines";
+        sharedData.setEstimate( estimate );
+        emit linesEstimated();
+    }
+}
+
+qint64 FullIndexOperation::doIndexReadThrough( ReadThroughFile& readThrough,
+        LinePositionArray& linePosition, TimestampIndex::Samples& samples,
+        SkipIndex::Blocks& skipBlocks, int* maxLength )
+{
+    QElapsedTimer timer;
+    timer.start();
+    const TimestampRule& rule = timestampRule_;
+    SkipIndex::Builder builder( &skipBlocks );
+    // Created once the encoding is known
+    std::unique_ptr<LineScanner> scanner;
+    FusedSearch* search = nullptr;
+    std::unique_ptr<FusedSearch::Scan> scan;
+    qint64 block_beginning = 0;
+    int progress = 0;
+
+    const bool succeeded = readThrough.readAll(
+        [&]( const char* data, size_t length, int64_t sourcePosition ) {
+            TaskScheduler::instance().yield();
+            if ( *interruptRequest_ )
+                return false;
+
+            if ( ! scanner ) {
+                if ( encoding_.type() == TextEncoding::Auto )
+                    encoding_ = TextEncoding::detect( data,
+                            qMin<size_t>( length, encodingDetectionSize ) );
+                search = fusedSearch( 0 );
+                if ( search )
+                    scan.reset( new FusedSearch::Scan( *search ) );
+                scanner.reset( new LineScanner( 0, 0, encoding_,
+                            recordLengths_, &rule, &samples,
+                            buildSkipIndex_ ? &builder : nullptr, scan.get(),
+                            columnIndex_, runIndex_ ) );
+            }
+
+            scanner->scanBlock( QByteArray::fromRawData( data, length ),
+                    block_beginning, linePosition,
+                    std::numeric_limits<qint64>::max() );
+            block_beginning += length;
+            if ( search )
+                search->append( *scan );
+
+            // The progress is the part of the source read
+            const qint64 source_size = readThrough.sourceSize();
+            const int new_progress = ( source_size > 0 ) ?
+                sourcePosition * 100 / source_size : 100;
+            if ( new_progress != progress ) {
+                progress = new_progress;
+                reportProgress( progress );
+            }
+
+            return true;
+        } );
+
+    if ( ! succeeded ) {
+        // As for a file that cannot be opened, we do as if it was
+        // empty (the data cannot be read back)
+        if ( ! *interruptRequest_ )
+            LOG(logWARNING) << "Cannot read file " << fileName_.toStdString();
+        linePosition = LinePositionArray();
+        samples.clear();
+        skipBlocks.clear();
+        if ( search )
+            search->restart();
+        reportProgress( 100 );
+        return 0;
+    }
+
+    builder.finish();
+    if ( scanner )
+        scanner->finishRuns();
+
+    // Check if there is a non LF terminated line at the end of the data
+    if ( scanner && block_beginning > scanner->pos() ) {
+        appendFakeFinalLF( linePosition, block_beginning,
+                scanner->lengthUpTo( block_beginning ) );
+        if ( search ) {
+            scanner->searchLastLine();
+            search->append( *scan );
+        }
+    }
+
+    *maxLength = scanner ? scanner->maxLength() : 0;
+
+    countIndexing( block_beginning, linePosition.size(), timer );
+
+    return block_beginning;
+}
+
 bool PartialIndexOperation::start( IndexingData& sharedData )
 {
     LOG(logDEBUG) << "PartialIndexOperation::start(), file "
@@ -303,18 +1755,106 @@ bool PartialIndexOperation::start( IndexingData& sharedData )
         << initialPosition_ << " ...";
     int maxLength = 0;
     LinePositionArray linePosition = LinePositionArray();
+    TimestampIndex::Samples samples;
+    SkipIndex::Blocks skipBlocks;
 
-    emit indexingProgressed( 0 );
+    reportProgress( 0 );
 
-    qint64 size = doIndex( linePosition, &maxLength, initialPosition_ );
+    encoding_ = sharedData.encoding();
+
+    // The file is indexed in its own positions
+    const qint64 position = initialPosition_ - fileStart_;
+    qint64 size = doIndex( linePosition, samples, skipBlocks, &maxLength,
+            position );
 
     if ( *interruptRequest_ == false )
     {
-        // Commit the results to the shared data (atomically)
-        sharedData.addAll( size - initialPosition_, maxLength, linePosition );
+        // Commit the results to the shared data (atomically),
+        // the data indexed might have been truncated to initialPosition_.
+        sharedData.addAll( fileStart_ + size - sharedData.indexedSize(),
+                maxLength, shiftPositions( std::move( linePosition ), fileStart_ ),
+                std::move( samples ), std::move( skipBlocks ) );
     }
 
     LOG(logDEBUG) << "PartialIndexOperation: ... finished counting.";
 
     return ( *interruptRequest_ ? false : true );
 }
+
+bool RotationIndexOperation::start( IndexingData& sharedData )
+{
+    LOG(logDEBUG) << "RotationIndexOperation::start(), file "
+        << fileName_.toStdString();
+
+    // Where the previous operations stopped in the rotated file
+    const qint64 position = sharedData.indexedSize() - *fileStart_;
+    int maxLength = 0;
+    LinePositionArray linePosition = LinePositionArray();
+    TimestampIndex::Samples samples;
+    SkipIndex::Blocks skipBlocks;
+
+    // The file still open is the rotated one, its name is now the new
+    // file's so it must not be reopened.
+    if ( ! file_->isOpen() ) {
+        LOG(logWARNING) << "Rotated file not open, cannot follow the rotation";
+        return false;
+    }
+
+    reportProgress( 0 );
+
+    encoding_ = sharedData.encoding();
+    const QByteArray lineFeed = encoding_.lineFeed();
+
+    const qint64 rotatedSize = doIndex( linePosition, samples, skipBlocks,
+            &maxLength, position, false );
+
+    const bool addedLF = rotatedSize > 0
+        && file_->seek( qMax( rotatedSize - lineFeed.size(), 0LL ) )
+        && file_->read( lineFeed.size() ) != lineFeed;
+    if ( addedLF ) {
+        // The final LF is now part of the data, it is repeated if
+        // it was already indexed, to replace the fake one (the length
+        // of its line is not known here, the lengths are then lost).
+        if ( linePosition.hasFakeFinalLF() )
+            linePosition.setFakeFinalLF( false );
+        else
+            linePosition.append( rotatedSize + lineFeed.size() );
+    }
+
+    if ( *interruptRequest_ )
+        return false;
+
+    LOG(logDEBUG) << "RotationIndexOperation: rotated file of "
+        << rotatedSize << " bytes";
+
+    linePosition = shiftPositions( std::move( linePosition ), *fileStart_ );
+
+    // Then the new file, from its beginning
+    const qint64 newFileStart = *fileStart_ + rotatedSize
+        + ( addedLF ? lineFeed.size() : 0 );
+    file_->close();
+
+    LinePositionArray newPosition = LinePositionArray();
+    TimestampIndex::Samples newSamples;
+    SkipIndex::Blocks newSkipBlocks;
+    const qint64 newSize = doIndex( newPosition, newSamples, newSkipBlocks,
+            &maxLength, 0 );
+    appendSamples( samples, newSamples, linePosition.size() );
+    appendSkipBlocks( skipBlocks, newSkipBlocks, linePosition.size() );
+    linePosition += shiftPositions( std::move( newPosition ), newFileStart );
+
+    if ( *interruptRequest_ )
+        return false;
+
+    // Commit the results to the shared data (atomically)
+    sharedData.addAll( newFileStart - *fileStart_ - position + newSize,
+            maxLength, std::move( linePosition ), std::move( samples ),
+            std::move( skipBlocks ) );
+
+    *rotatedSize_ = rotatedSize;
+    *fileStart_ = newFileStart;
+
+    LOG(logDEBUG) << "RotationIndexOperation: ... finished counting.";
+
+    return true;
+}
@@ -20,54 +20,124 @@
 #ifndef LOGDATAWORKERTHREAD_H
 #define LOGDATAWORKERTHREAD_H
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include <QObject>
-#include <QThread>
+#include <QFile>
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QVector>
 
 #include "loadingstatus.h"
+#include "compressedlinestorage.h"
+#include "linelengthstorage.h"
+#include "skipindex.h"
+#include "taskscheduler.h"
+#include "compressedfile.h"
+#include "fusedsearch.h"
+#include "remotefile.h"
+#include "textencoding.h"
+#include "timestampindex.h"
+#include "timestamprule.h"
+#include "columnindex.h"
+#include "runindex.h"
+#include "checkpointindex.h"
 
 // This class is a list of end of lines position,
 // in addition to a list of qint64 (positions within the files)
 // it can keep track of whether the final LF was added (for non-LF terminated
 // files) and remove it when more data are added.
+// Positions are stored compressed (about 2 bytes per line).
+// The (tab-expanded) length of each line can be kept with its position
+// (about 2 more bytes per line), the lengths being known only if they
+// have been appended for all the lines.
 class LinePositionArray
 {
   public:
     // Default constructor
-    LinePositionArray() : array()
+    LinePositionArray() : array(), lengths_()
     { fakeFinalLF_ = false; }
     // Copy constructor
     inline LinePositionArray( const LinePositionArray& orig )
-        : array(orig.array)
+        : array(orig.array), lengths_(orig.lengths_)
     { fakeFinalLF_ = orig.fakeFinalLF_; }
 
+    LinePositionArray( LinePositionArray&& orig ) = default;
+
+    LinePositionArray& operator=( const LinePositionArray& orig ) = default;
+    LinePositionArray& operator=( LinePositionArray&& orig ) = default;
+
     // Add a new line position at the given position
+    // (the lengths of the lines are not known anymore)
     inline void append( qint64 pos )
-    { array.append( pos ); }
+    { array.append( pos ); lengths_.clear(); }
+    // Idem, with the length of the line ending there
+    inline void append( qint64 pos, int length )
+    {
+        if ( hasLengths() )
+            lengths_.append( length );
+        array.append( pos );
+    }
     // Size of the array
-    inline int size()
+    inline qint64 size() const
     { return array.size(); }
     // Extract an element
-    inline qint64 at( int i ) const
+    inline qint64 at( qint64 i ) const
     { return array.at( i ); }
-    inline qint64 operator[]( int i ) const
+    inline qint64 operator[]( qint64 i ) const
     { return array.at( i ); }
+    // Whether the lengths of all the lines are known
+    inline bool hasLengths() const
+    { return lengths_.size() == array.size(); }
+    // Returns the length of a line (only if hasLengths())
+    inline int lengthAt( qint64 i ) const
+    { return lengths_.at( i ); }
     // Set the presence of a fake final LF
     // Must be used after 'append'-ing a fake LF at the end.
     void setFakeFinalLF( bool finalLF=true )
     { fakeFinalLF_ = finalLF; }
+    bool hasFakeFinalLF() const
+    { return fakeFinalLF_; }
+
+    // Copy the array to *spilled, its positions and lengths being kept
+    // in spill files. Returns false if they cannot be written.
+    bool spill( LinePositionArray* spilled ) const
+    {
+        LinePositionArray copy;
+        if ( ! array.spill( &copy.array ) || ! lengths_.spill( &copy.lengths_ ) )
+            return false;
+        copy.fakeFinalLF_ = fakeFinalLF_;
+        *spilled = std::move( copy );
+        return true;
+    }
+    // Whether the positions are in a spill file
+    bool isSpilled() const
+    { return array.isSpilled(); }
+    // Approximate memory used, in bytes
+    size_t allocatedSize() const
+    { return array.allocatedSize() + lengths_.allocatedSize(); }
 
     // Add another list to this one, removing any fake LF on this list.
     LinePositionArray& operator+= ( const LinePositionArray& other )
     {
+        const bool lengths = hasLengths() && other.hasLengths();
+
         // If our final LF is fake, we remove it
-        if ( fakeFinalLF_ )
+        if ( fakeFinalLF_ ) {
             this->array.pop_back();
+            if ( lengths )
+                this->lengths_.pop_back();
+        }
 
         // Append the arrays
-        this->array += other.array;
+        this->array.append( other.array );
+        if ( lengths )
+            this->lengths_.append( other.lengths_ );
+        else
+            this->lengths_.clear();
 
         // In case the 'other' object has a fake LF
         this->fakeFinalLF_ = other.fakeFinalLF_;
@@ -76,44 +146,180 @@ class LinePositionArray
     }
 
   private:
-    QVector<qint64> array;
+    CompressedLinePositionStorage array;
+    LineLengthStorage lengths_;
+    bool fakeFinalLF_;
+};
+
+// A list of end of lines position made of immutable parts shared
+// between the copies, so a copy can be appended to without copying
+// the positions it already has (used by LogData to publish new versions
+// of the line positions as the file grows).
+// Small parts at the end are merged as they are appended, so the number
+// of parts stays logarithmic in the number of lines.
+class SharedLinePositionArray
+{
+  public:
+    SharedLinePositionArray() : parts_(), size_( 0 ), fakeFinalLF_( false ),
+        hasLengths_( true ) {}
+
+    // Add the passed positions, removing any fake LF on this list
+    // (as LinePositionArray::operator+=).
+    void append( LinePositionArray&& linePosition );
+    // Keep only the first size positions, the last one kept
+    // being a real LF.
+    void truncate( qint64 size );
+    // Whether the last position is a fake LF
+    bool hasFakeFinalLF() const { return fakeFinalLF_; }
+    // Size of the array
+    qint64 size() const { return size_; }
+    // Extract an element
+    qint64 at( qint64 i ) const;
+    qint64 operator[]( qint64 i ) const
+    { return at( i ); }
+    // Whether the lengths of all the lines are known
+    bool hasLengths() const { return hasLengths_; }
+    // Returns the length of a line (only if hasLengths())
+    int lengthAt( qint64 i ) const;
+
+    // Returns a copy of the array with its parts of at least
+    // minSpilledPartSize bytes kept in spill files (the parts that
+    // cannot be written staying in memory).
+    SharedLinePositionArray spilled() const;
+    // Approximate memory used by the parts, in bytes
+    size_t allocatedSize() const;
+
+  private:
+    // Smaller parts are not worth spilling (1 MiB)
+    static const size_t minSpilledPartSize;
+
+    struct Part {
+        std::shared_ptr<const LinePositionArray> positions;
+        // Number of positions used (the last one might be a fake LF
+        // removed since)
+        qint64 size;
+        // Index of the first position of this part in the array
+        qint64 first;
+    };
+
+    // Returns the part holding the position i
+    const Part& partOf( qint64 i ) const;
+    // Replace the last two parts by a single one
+    void mergeLastParts();
+
+    std::vector<Part> parts_;
+    qint64 size_;
     bool fakeFinalLF_;
+    bool hasLengths_;
 };
 
 // This class is a mutex protected set of indexing data.
+// Only the positions indexed since they were last taken are kept,
+// so they can be moved out instead of copying the whole file's.
+// The timestamp samples (and the blocks of the skip index) are numbered
+// from the first of these positions.
 // It is thread safe.
 class IndexingData
 {
   public:
-    IndexingData() : dataMutex_(), linePosition_(), maxLength_(0), indexedSize_(0) { }
-
-    // Atomically get all the indexing data
-    void getAll( qint64* size, int* length,
-            LinePositionArray* linePosition );
+    IndexingData() : dataMutex_(), linePosition_(), samples_(),
+        skipBlocks_(), maxLength_(0), indexedSize_(0), encoding_(),
+        replace_(false), prefixPosition_(), prefixMaxLength_(0),
+        prefixSize_(0), prefixEncoding_(), estimate_() { }
+
+    // Atomically take the indexing data: the indexed size and max length,
+    // the encoding of the file, and the positions indexed since the last
+    // call, which are moved out (with their timestamp samples and blocks
+    // of the skip index).
+    // Returns true if they replace all the previous positions (full
+    // indexing), false if they are to be appended to them.
+    bool takeAll( qint64* size, int* length,
+            LinePositionArray* linePosition, TimestampIndex::Samples* samples,
+            SkipIndex::Blocks* skipBlocks, TextEncoding* encoding );
 
     // Atomically set all the indexing data
     // (overwriting the existing)
     void setAll( qint64 size, int length,
-            const LinePositionArray& linePosition );
+            LinePositionArray&& linePosition,
+            TimestampIndex::Samples&& samples,
+            SkipIndex::Blocks&& skipBlocks, TextEncoding encoding );
 
     // Atomically add to all the existing 
-    // indexing data.
+    // indexing data (the positions are moved in if none are
+    // waiting to be taken).
     void addAll( qint64 size, int length,
-            const LinePositionArray& linePosition );
+            LinePositionArray&& linePosition,
+            TimestampIndex::Samples&& samples,
+            SkipIndex::Blocks&& skipBlocks );
+
+    // Atomically add the positions of the next lines of the file
+    // indexed so far by a full indexing still running (complete lines
+    // only, the first ones at the start of the file), size being the
+    // end of the last one.
+    void addPrefix( qint64 size, int length, TextEncoding encoding,
+            LinePositionArray&& linePosition );
+    // Atomically take the positions added by addPrefix() since the
+    // last call, returns false if there are none.
+    bool takePrefix( qint64* size, int* length, TextEncoding* encoding,
+            LinePositionArray* linePosition );
+    // Drop the positions of the prefix (and the estimate) not taken
+    // (the indexing having ended)
+    void clearPrefix();
+
+    // Atomically set the estimate of the lines of the file made by
+    // a full indexing before it indexes them
+    void setEstimate( std::shared_ptr<const CheckpointIndex> estimate );
+    // Atomically take it (null if there is none)
+    std::shared_ptr<const CheckpointIndex> takeEstimate();
+
+    // Returns the total size indexed so far
+    qint64 indexedSize();
+    // Returns the encoding the file has been indexed in
+    TextEncoding encoding();
 
   private:
     QMutex dataMutex_;
 
     LinePositionArray linePosition_;
+    TimestampIndex::Samples samples_;
+    SkipIndex::Blocks skipBlocks_;
     int maxLength_;
     qint64 indexedSize_;
+    TextEncoding encoding_;
+    bool replace_;
+
+    LinePositionArray prefixPosition_;
+    int prefixMaxLength_;
+    qint64 prefixSize_;
+    TextEncoding prefixEncoding_;
+
+    std::shared_ptr<const CheckpointIndex> estimate_;
+};
+
+// Where the lines of the file are looked at while it is indexed, the
+// chunks there being indexed first (see IndexOperation::doParallelIndex()).
+// Set from the GUI thread, read by the indexing as it runs.
+struct IndexingHints {
+    IndexingHints() : focus( -1 ), tail( false ) {}
+
+    // Position of the file looked at (-1 if none)
+    std::atomic<qint64> focus;
+    // Set if the end of the file is (as it is followed)
+    std::atomic<bool> tail;
 };
 
 class IndexOperation : public QObject
 {
   Q_OBJECT
   public:
-    IndexOperation( QString& fileName, bool* interruptRequest );
+    // The lengths of the lines are recorded with their positions
+    // if recordLengths is set, and the skip index of the lines built
+    // if buildSkipIndex is set.
+    // The column checkpoints of the long lines are recorded to
+    // columnIndex, and the runs of similar lines to runIndex.
+    IndexOperation( QString& fileName, QFile* file, bool* interruptRequest,
+            const TimestampRule& timestampRule, bool recordLengths,
+            bool buildSkipIndex, ColumnIndex* columnIndex, RunIndex* runIndex );
 
     virtual ~IndexOperation() { }
 
@@ -123,42 +329,198 @@ class IndexOperation : public QObject
 
   signals:
     void indexingProgressed( int );
+    // Sent when lines have been added to the prefix (see publishPrefix())
+    void linesIndexed();
+    // Sent when the lines of the file have been estimated
+    // (see IndexingData::setEstimate())
+    void linesEstimated();
 
   protected:
     static const int sizeChunk;
+    static const qint64 parallelThreshold;
+    static const int prefixInterval;
+    static const qint64 prefixChunkSize;
+    static const int progressInterval;
 
     // Returns the total size indexed
-    qint64 doIndex( LinePositionArray& linePosition, int* maxLength,
-            qint64 initialPosition );
+    // Big files are split in chunks indexed in parallel, the result
+    // being the same as a serial indexing (unless parallel is false,
+    // the chunks being read from the file having the name).
+    // The timestamps of the lines are sampled to samples if the
+    // timestamp rule is valid, numbered from the first line added, as
+    // are the blocks added to skipBlocks if buildSkipIndex_ is set.
+    // The file is read in encoding_, only files of one byte wide code
+    // units being indexed in parallel (or having a skip index).
+    // The lines are searched for fusedSearch_ if the file is indexed
+    // from its start (see fusedSearch()).
+    qint64 doIndex( LinePositionArray& linePosition,
+            TimestampIndex::Samples& samples, SkipIndex::Blocks& skipBlocks,
+            int* maxLength, qint64 initialPosition, bool parallel = true );
+    // Add a fake LF at end, after the last line of the data (which
+    // has length) not terminated by a LF
+    void appendFakeFinalLF( LinePositionArray& linePosition, qint64 end,
+            int length ) const;
+    // Returns the search to run on the lines indexed from
+    // initialPosition (null if none can be, the file not being in
+    // UTF-8), setting searchFused_ if there is one.
+    FusedSearch* fusedSearch( qint64 initialPosition );
+    // Hand the lines of linePosition (indexed from the start of the
+    // file) not handed yet to prefixData_ if it is set, at most every
+    // prefixInterval ms.
+    void publishPrefix( const LinePositionArray& linePosition,
+            int maxLength );
+    // Emit indexingProgressed if the progress has changed, at most
+    // every progressInterval ms (but for the start and the end)
+    void reportProgress( int progress );
 
     QString fileName_;
+    // Kept open between the operations (see LogDataWorkerThread)
+    QFile* file_;
     bool* interruptRequest_;
+    const TimestampRule timestampRule_;
+    const bool recordLengths_;
+    const bool buildSkipIndex_;
+    ColumnIndex* const columnIndex_;
+    RunIndex* const runIndex_;
+    // Set by start(), before indexing
+    TextEncoding encoding_;
+    // Run by the full indexing (null if none is)
+    std::shared_ptr<FusedSearch> fusedSearch_;
+    // Whether the lines indexed have been searched for it
+    bool searchFused_;
+    // Where doIndex() shows the lines indexed so far (null if it does
+    // not), the number of them shown and since when.
+    IndexingData* prefixData_;
+    // Where the lines are looked at, indexed first when they are
+    // shown (null if nowhere, see doParallelIndex())
+    const IndexingHints* hints_;
+    qint64 prefixNbLines_;
+    QElapsedTimer prefixTimer_;
+    // The progress last reported and when
+    int progress_;
+    QElapsedTimer progressTimer_;
+
+  private:
+    // Indexing result for a part of the file
+    struct ChunkResult {
+        bool succeeded;
+        LinePositionArray linePosition;
+        TimestampIndex::Samples samples;
+        SkipIndex::Blocks skipBlocks;
+        int maxLength;
+        // Position of the start of the last (non LF terminated) line
+        qint64 lastLineStart;
+        // The matches of the fused search in the lines of the chunk
+        std::unique_ptr<FusedSearch::Scan> fusedScan;
+    };
+
+    // A chunk indexed ahead of the ones before it, kept until they are
+    struct AheadChunk {
+        qint64 end;
+        ChunkResult result;
+    };
+
+    // Index the file from initialPosition to size using up to nbThreads
+    // threads (midLine telling whether initialPosition is in the middle
+    // of a line), in waves of chunks of at most prefixChunkSize if the
+    // lines are shown as they are indexed, the chunks of the hints_
+    // being indexed first (merged as the waves reach them).
+    ChunkResult doParallelIndex( qint64 size, int nbThreads,
+            qint64 initialPosition, bool midLine, int maxLength,
+            FusedSearch* search );
+    // Index the lines starting between begin and end (run in its own
+    // thread), searching them if search is not null
+    void indexChunk( qint64 begin, qint64 end, bool firstChunk, bool midLine,
+            const FusedSearch* search, ChunkResult* result ) const;
 };
 
+// A compressed file (if its format is supported) is indexed as its
+// decompressed data, and a remote file as it is streamed, readThrough
+// being set to the file to read them through (null for a local file
+// not compressed).
+// The file is read in the encoding passed, or the one detected from
+// its first bytes if it is Auto.
+// The lines are searched as they are indexed for fusedSearch if it
+// is not null (see FusedSearch).
+// The lines of a local file not cached are handed to the readers as
+// they are indexed (see IndexingData::addPrefix).
 class FullIndexOperation : public IndexOperation
 {
   public:
-    FullIndexOperation( QString& fileName, bool* interruptRequest )
-        : IndexOperation( fileName, interruptRequest ) { }
+    FullIndexOperation( QString& fileName, QFile* file, bool* interruptRequest,
+            const TimestampRule& timestampRule, bool recordLengths,
+            bool buildSkipIndex, ColumnIndex* columnIndex, RunIndex* runIndex,
+            std::shared_ptr<ReadThroughFile>* readThrough,
+            TextEncoding encoding, std::shared_ptr<FusedSearch> fusedSearch,
+            const IndexingHints* hints, bool showPrefix )
+        : IndexOperation( fileName, file, interruptRequest, timestampRule,
+                recordLengths, buildSkipIndex, columnIndex, runIndex ),
+        readThrough_( readThrough ), showPrefix_( showPrefix )
+    { encoding_ = encoding; fusedSearch_ = fusedSearch; hints_ = hints; }
     virtual bool start( IndexingData& result );
+
+  private:
+    // Estimate the lines of a big file from a CheckpointIndex, handed
+    // to sharedData before the lines are indexed
+    void estimateLines( IndexingData& sharedData );
+    // Returns the size of the data, indexed serially as they are
+    // read (decompressed or streamed).
+    qint64 doIndexReadThrough( ReadThroughFile& readThrough,
+            LinePositionArray& linePosition, TimestampIndex::Samples& samples,
+            SkipIndex::Blocks& skipBlocks, int* maxLength );
+
+    std::shared_ptr<ReadThroughFile>* readThrough_;
+    // Whether the lines are shown (and estimated) as they are indexed,
+    // only when the file is attached: the lines of a reindexing would
+    // be shown after the previous ones, still published until it ends.
+    const bool showPrefix_;
 };
 
+// The positions are in the data made of the rotated files followed
+// by the current one, which starts at fileStart.
+// The file is read in the encoding found by the full indexing.
 class PartialIndexOperation : public IndexOperation
 {
   public:
-    PartialIndexOperation( QString& fileName, bool* interruptRequest, qint64 position );
+    PartialIndexOperation( QString& fileName, QFile* file,
+            bool* interruptRequest, const TimestampRule& timestampRule,
+            bool recordLengths, bool buildSkipIndex, ColumnIndex* columnIndex,
+            RunIndex* runIndex,
+            qint64 position, qint64 fileStart );
     virtual bool start( IndexingData& result );
 
   private:
     qint64 initialPosition_;
+    qint64 fileStart_;
 };
 
-// Create and manage the thread doing loading/indexing for
-// the creating LogData. One LogDataWorkerThread is used
-// per LogData instance.
-// Note everything except the run() function is in the LogData's
+// Indexes the end of the file still open, which has been rotated,
+// then the new file having its name, chained after it in the data.
+// If the rotated file does not end with a LF, one is added in the data
+// so its last line is not merged with the first of the new file.
+class RotationIndexOperation : public IndexOperation
+{
+  public:
+    // fileStart is updated to the position of the new file, and
+    // rotatedSize set to the size of the rotated one, on success.
+    RotationIndexOperation( QString& fileName, QFile* file,
+            bool* interruptRequest, const TimestampRule& timestampRule,
+            bool recordLengths, bool buildSkipIndex, ColumnIndex* columnIndex,
+            RunIndex* runIndex,
+            qint64* fileStart, qint64* rotatedSize );
+    virtual bool start( IndexingData& result );
+
+  private:
+    qint64* fileStart_;
+    qint64* rotatedSize_;
+};
+
+// Runs the loading/indexing operations of the creating LogData, one
+// at a time, as tasks of the TaskScheduler. One LogDataWorkerThread
+// is used per LogData instance.
+// Note everything except runOperation() is in the LogData's
 // thread.
-class LogDataWorkerThread : public QThread
+class LogDataWorkerThread : public QObject
 {
   Q_OBJECT
 
@@ -169,43 +531,143 @@ class LogDataWorkerThread : public QThread
     // Attaches to a file on disk. Attaching to a non existant file
     // will work, it will just appear as an empty file.
     void attachFile( const QString& fileName );
+    // Sets the rule used to sample the timestamps of the lines
+    // by the next operations.
+    void setTimestampRule( const TimestampRule& rule );
+    // Sets the encoding the next full indexings read the file in
+    // (Auto to detect it).
+    void setEncoding( TextEncoding encoding );
+    // Sets whether the next operations record the (tab-expanded)
+    // length of each line with its position.
+    void setRecordLineLengths( bool record );
+    // Sets whether the next operations build the skip index of the lines
+    // (files of one byte wide code units only).
+    void setBuildSkipIndex( bool build );
+    // Sets the search the next full indexings run on the lines as they
+    // index them (see FusedSearch), until one has completed it, the
+    // following ones abandoning it.
+    void setFusedSearch( std::shared_ptr<FusedSearch> search );
     // Instructs the thread to start a new full indexing of the file, sending
     // signals as it progresses.
     void indexAll();
     // Instructs the thread to start a partial indexing (starting at
     // the index passed).
     void indexAdditionalLines( qint64 position );
+    // Instructs the thread to index the end of the file it has open,
+    // which has been rotated (renamed), and the new file having its name
+    // chained after it (see RotationIndexOperation).
+    void indexRotatedFile();
     // Interrupts the indexing if one is in progress
     void interrupt();
-
-    // Returns a copy of the current indexing data
-    void getIndexingData( qint64* indexedSize,
-            int* maxLength, LinePositionArray* linePosition );
+    // Sets the priority of the indexing operations (Visible when the
+    // file is displayed)
+    void setPriority( TaskScheduler::Priority priority );
+
+    // Returns the current indexing data, the positions being only
+    // those indexed since the last call (see IndexingData::takeAll)
+    bool takeIndexingData( qint64* indexedSize, int* maxLength,
+            LinePositionArray* linePosition, TimestampIndex::Samples* samples,
+            SkipIndex::Blocks* skipBlocks, TextEncoding* encoding );
+    // Returns the lines indexed so far by the full indexing running
+    // (see IndexingData::takePrefix)
+    bool takeIndexedPrefix( qint64* indexedSize, int* maxLength,
+            TextEncoding* encoding, LinePositionArray* linePosition );
+    // Returns the estimate of the lines of the file made by the full
+    // indexing running (see IndexingData::takeEstimate)
+    std::shared_ptr<const CheckpointIndex> takeEstimate();
+    // Sets the position of the file the lines are looked at, the full
+    // indexing reaching it as soon as it can (-1 for none)
+    void setIndexingFocus( qint64 position );
+    // Sets whether the end of the file is looked at, the full indexing
+    // indexing it early
+    void setIndexingTail( bool tail );
+    // Returns the size of the last rotated file indexed and the
+    // position of the current file in the data (0 until the file
+    // is rotated, and again after a full indexing)
+    void getRotation( qint64* rotatedSize, qint64* fileStart );
+    // Returns the compressed or remote file read by the last full
+    // indexing, to read the data from (null if neither)
+    std::shared_ptr<ReadThroughFile> getReadThroughFile();
+    // Returns the column checkpoints of the long lines indexed, each
+    // full indexing starting from none
+    std::shared_ptr<const ColumnIndex> columnIndex() const
+    { return columnIndex_; }
+    // Returns the runs of similar lines indexed, each full indexing
+    // starting from none
+    std::shared_ptr<const RunIndex> runIndex() const
+    { return runIndex_; }
 
   signals:
     // Sent during the indexing process to signal progress
     // percent being the percentage of completion.
     void indexingProgressed( int percent );
+    // Sent when a full indexing has more lines to show before it
+    // ends (see takeIndexedPrefix()).
+    void linesIndexed();
+    // Sent when a full indexing has estimated the lines of the file
+    // (see takeEstimate()).
+    void linesEstimated();
     // Sent when indexing is finished, signals the client
     // to copy the new data back.
     void indexingFinished( LoadingStatus status );
 
-  protected:
-    void run();
-
   private:
-    void doIndexAll();
+    // Wait for the end of the operation requested, running it in the
+    // calling thread if it has not started (with mutex_ held)
+    void waitForOperation();
+    // Have the scheduler run the operation requested
+    // (with mutex_ held)
+    void submitOperation();
+    // Resume the operation running if paused by the scheduler,
+    // before waiting for it (without mutex_ held)
+    void expediteOperation();
+    // The task running the operation requested
+    void runOperation();
+    // Run the operation requested (with mutex_ held)
+    void doOperation();
 
     // Mutex to protect operationRequested_ and friends
     QMutex mutex_;
-    QWaitCondition operationRequestedCond_;
     QWaitCondition nothingToDoCond_;
     QString fileName_;
-
-    // Set when the thread must die
+    TimestampRule timestampRule_;
+    TextEncoding encoding_;
+    bool recordLineLengths_;
+    bool buildSkipIndex_;
+    // The search of the next full indexings
+    std::shared_ptr<FusedSearch> fusedSearch_;
+    // Read by the full indexings as they run
+    IndexingHints indexingHints_;
+    // Set by attachFile(), the next full indexing showing the lines
+    // as they are indexed
+    bool attaching_;
+
+    // Set when the object is being destroyed
     bool terminate_;
     bool interruptRequested_;
     IndexOperation* operationRequested_;
+    // The task running operationRequested_ and its priority, also
+    // protected by taskMutex_ (not held while the operation runs)
+    QMutex taskMutex_;
+    TaskScheduler::TaskHandle task_;
+    TaskScheduler::Priority priority_;
+
+    // The file indexed, only used by the operations (one at a time).
+    // It is kept open so the growth of a followed file is read without
+    // opening it each time, and reopened on each full indexing (the
+    // file might have been replaced).
+    QFile file_;
+
+    // Position of file_ in the data and size of the last rotated file
+    qint64 fileStart_;
+    qint64 rotatedSize_;
+
+    // Set by the full indexing
+    std::shared_ptr<ReadThroughFile> readThrough_;
+
+    // Filled by the operations
+    const std::shared_ptr<ColumnIndex> columnIndex_;
+    const std::shared_ptr<RunIndex> runIndex_;
 
     // Shared indexing data
     IndexingData indexingData_;
@@ -18,29 +18,41 @@
  */
 
 // This file implements LogFilteredData
-// It stores a pointer to the LogData that created it,
-// so should always be destroyed before the LogData.
+// It stores a pointer to the LogData (or LogDataSet) that created it,
+// so should always be destroyed before it.
 
 #include "log.h"
 
 #include <QString>
 #include <cassert>
-#include <limits>
+#include <algorithm>
 
 #include "utils.h"
-#include "logdata.h"
 #include "marks.h"
 #include "logfiltereddata.h"
+#include "literalprefilter.h"
+#include "compiledregexp.h"
 
 // Creates an empty set. It must be possible to display it without error.
 // FIXME
 LogFilteredData::LogFilteredData() : AbstractLogData(),
     matching_lines_(),
+    matchesGeneration_( 0 ),
+    histogram_(),
     currentRegExp_(),
+    currentQuery_(),
+    refinedRegExps_(),
+    timeWindow_(),
     visibility_(),
-    filteredItemsCache_(),
+    markIndexes_(),
+    markedMatchesBefore_(),
+    contextRanges_(),
+    contextIndexes_(),
+    collapsedRuns_(),
+    collapsedIndexes_(),
     workerThread_( nullptr ),
-    marks_()
+    marks_(),
+    exporter_()
 {
     /* Prevent any more searching */
     maxLength_ = 0;
@@ -48,18 +60,36 @@ LogFilteredData::LogFilteredData() : AbstractLogData(),
     searchDone_ = true;
     visibility_ = MarksAndMatches;
 
-    filteredItemsCacheDirty_ = true;
+    markPositionsDirty_ = true;
+
+    contextLines_ = 3;
+    contextNbMatches_ = 0;
+    contextGeneration_ = -1;
+    collapsedNbSourceLines_ = -1;
+
+    MemoryBudget::instance().addClient( this );
 }
 
 // Usual constructor: just copy the data, the search is started by runSearch()
-LogFilteredData::LogFilteredData( const LogData* logData )
+LogFilteredData::LogFilteredData( const AbstractLogData* logData )
     : AbstractLogData(),
-    matching_lines_( SearchResultArray() ),
+    matching_lines_(),
+    matchesGeneration_( 0 ),
+    histogram_(),
     currentRegExp_(),
+    currentQuery_(),
+    refinedRegExps_(),
+    timeWindow_(),
     visibility_(),
-    filteredItemsCache_(),
+    markIndexes_(),
+    markedMatchesBefore_(),
+    contextRanges_(),
+    contextIndexes_(),
+    collapsedRuns_(),
+    collapsedIndexes_(),
     workerThread_( logData ),
-    marks_()
+    marks_(),
+    exporter_()
 {
     // Starts with an empty result list
     maxLength_ = 0;
@@ -72,18 +102,29 @@ LogFilteredData::LogFilteredData( const LogData* logData )
 
     visibility_ = MarksAndMatches;
 
-    filteredItemsCacheDirty_ = true;
+    markPositionsDirty_ = true;
 
-    // Forward the update signal
-    connect( &workerThread_, SIGNAL( searchProgressed( int, int ) ),
-            this, SLOT( handleSearchProgressed( int, int ) ) );
+    contextLines_ = 3;
+    contextNbMatches_ = 0;
+    contextGeneration_ = -1;
+    collapsedNbSourceLines_ = -1;
 
-    // Starts the worker thread
-    workerThread_.start();
+    // Forward the update signal
+    // (queued, even when a search is run in this thread by
+    // LogFilteredDataWorkerThread, not to be called back from within it)
+    connect( &workerThread_, SIGNAL( searchProgressed( qint64, int, int ) ),
+            this, SLOT( handleSearchProgressed( qint64, int, int ) ),
+            Qt::QueuedConnection );
+    connect( &workerThread_, SIGNAL( templatesMined() ),
+            this, SIGNAL( templatesMined() ), Qt::QueuedConnection );
+
+    MemoryBudget::instance().addClient( this );
 }
 
 LogFilteredData::~LogFilteredData()
 {
+    MemoryBudget::instance().removeClient( this );
+
     // FIXME
     // workerThread_.stop();
 }
@@ -93,21 +134,175 @@ LogFilteredData::~LogFilteredData()
 //
 
 // Run the search and send newDataAvailable() signals.
-void LogFilteredData::runSearch( const QRegExp& regExp )
+void LogFilteredData::runSearch( const QRegExp& regExp,
+        const TimeWindow& timeWindow )
 {
     LOG(logDEBUG) << "Entering runSearch";
 
     clearSearch();
     currentRegExp_ = regExp;
+    timeWindow_ = timeWindow;
+
+    workerThread_.search( currentRegExp_, timeWindow_ );
+}
+
+void LogFilteredData::runQuery( const SearchQuery& query )
+{
+    LOG(logDEBUG) << "Entering runQuery";
+
+    clearSearch();
+    currentQuery_.reset( new SearchQuery( query ) );
+
+    workerThread_.query( *currentQuery_ );
+}
+
+void LogFilteredData::setIndexedFields( const QStringList& names )
+{
+    workerThread_.setIndexedFields( names );
+}
+
+void LogFilteredData::setTokenIndexFile( const QString& fileName )
+{
+    workerThread_.setTokenIndexFile( fileName );
+}
+
+void LogFilteredData::setTrigramIndexEnabled( bool enabled )
+{
+    workerThread_.setTrigramIndexEnabled( enabled );
+}
+
+void LogFilteredData::mineTemplates()
+{
+    workerThread_.mineTemplates();
+}
+
+std::vector<TemplateIndex::Summary> LogFilteredData::getTopTemplates(
+        int number ) const
+{
+    return workerThread_.topTemplates( number );
+}
+
+void LogFilteredData::setPriority( TaskScheduler::Priority priority )
+{
+    workerThread_.setPriority( priority );
+    if ( exporter_ )
+        exporter_->setPriority( priority );
+    MemoryBudget::instance().setPriority( this, priority );
+}
+
+void LogFilteredData::releaseMemory()
+{
+    workerThread_.clearTermCache();
+    MemoryBudget::instance().setUsage( this, 0 );
+}
+
+void LogFilteredData::runSearchWithinResults( const QRegExp& regExp )
+{
+    LOG(logDEBUG) << "Entering runSearchWithinResults";
+
+    if ( currentQuery_ || currentRegExp_.isEmpty() ) {
+        runSearch( regExp );
+        return;
+    }
+
+    // The matching lines are the candidates for the new search
+    std::vector<QRegExp> patterns = refinedRegExps_;
+    patterns.push_back( currentRegExp_ );
+    const MatchSet candidates = matching_lines_;
+    const qint64 nbLinesSearched = nbLinesProcessed_;
+    const TimeWindow timeWindow = timeWindow_;
+
+    clearSearch();
+    refinedRegExps_ = patterns;
+    currentRegExp_ = regExp;
+    timeWindow_ = timeWindow;
+    patterns.push_back( regExp );
 
-    workerThread_.search( currentRegExp_ );
+    workerThread_.refineSearch( patterns, candidates, nbLinesSearched,
+            timeWindow_ );
+}
+
+void LogFilteredData::runNarrowerSearch( const QRegExp& regExp )
+{
+    LOG(logDEBUG) << "Entering runNarrowerSearch";
+
+    // (a search within results or a time window would be kept)
+    if ( currentQuery_ || ! refinedRegExps_.empty() || ! timeWindow_.isWhole()
+            || currentRegExp_.isEmpty()
+            || ! LiteralPrefilter::isNarrower( regExp, currentRegExp_ ) ) {
+        runSearch( regExp );
+        return;
+    }
+
+    // The matching lines are the candidates for the new search, the
+    // lines not searched yet being searched for it only
+    const MatchSet candidates = matching_lines_;
+    const qint64 nbLinesSearched = nbLinesProcessed_;
+
+    clearSearch();
+    currentRegExp_ = regExp;
+
+    workerThread_.refineSearch( std::vector<QRegExp>( 1, regExp ),
+            candidates, nbLinesSearched );
+}
+
+void LogFilteredData::restoreMatches( const QRegExp& regExp,
+        const MatchSet& matches, LineNumber nbLines, int maxLength )
+{
+    workerThread_.storeTermMatches( regExp, matches, nbLines, maxLength );
+}
+
+void LogFilteredData::showLines( const MatchSet& lines )
+{
+    clearSearch();
+
+    matching_lines_ = lines;
+    // (the lengths of the lines are not known)
+    maxLength_ = sourceLogData_->getMaxLength();
+    nbLinesProcessed_ = sourceLogData_->getNbLine();
 }
 
 void LogFilteredData::updateSearch()
 {
     LOG(logDEBUG) << "Entering updateSearch";
 
-    workerThread_.updateSearch( currentRegExp_, nbLinesProcessed_ );
+    // A query is evaluated again, only its terms
+    // being searched for in the new lines.
+    if ( currentQuery_ ) {
+        workerThread_.query( *currentQuery_ );
+    }
+    else {
+        std::vector<QRegExp> patterns = refinedRegExps_;
+        patterns.push_back( currentRegExp_ );
+        workerThread_.updateSearch( patterns, nbLinesProcessed_, timeWindow_ );
+    }
+}
+
+void LogFilteredData::forgetPreviousSearches()
+{
+    workerThread_.clearTermCache();
+    MemoryBudget::instance().setUsage( this, 0 );
+    histogram_.reset();
+}
+
+void LogFilteredData::truncate( qint64 nbLines )
+{
+    LOG(logDEBUG) << "Entering truncate " << nbLines;
+
+    interruptSearch();
+    takeSearchResult();
+
+    nbLinesProcessed_ = qMin( nbLinesProcessed_, nbLines );
+    while ( ! matching_lines_.empty()
+            && matching_lines_.last() >= nbLinesProcessed_ )
+        matching_lines_.removeLast();
+    matchesGeneration_++;
+    workerThread_.truncateResults( nbLinesProcessed_, matching_lines_.size(),
+            matching_lines_.empty() ? -1LL : qint64( matching_lines_.last() ) );
+
+    marks_.deleteMarksFrom( nbLines );
+    markPositionsDirty_ = true;
+    histogram_.reset();
 }
 
 void LogFilteredData::interruptSearch()
@@ -117,17 +312,53 @@ void LogFilteredData::interruptSearch()
     workerThread_.interrupt();
 }
 
+// The exporter reads the source from its task, with its own copy
+// of the matches.
+void LogFilteredData::exportMatches( const QString& fileName )
+{
+    LOG(logDEBUG) << "Exporting " << matching_lines_.size()
+        << " matches to " << fileName.toStdString();
+
+    exporter_.reset();
+    exporter_.reset( new MatchesExporter( sourceLogData_, matching_lines_,
+                fileName ) );
+    connect( exporter_.get(), SIGNAL( exportProgressed( int ) ),
+            this, SIGNAL( exportProgressed( int ) ) );
+    connect( exporter_.get(), SIGNAL( exportFinished( bool ) ),
+            this, SIGNAL( exportFinished( bool ) ) );
+    exporter_->start( TaskScheduler::Visible );
+}
+
+void LogFilteredData::interruptExport()
+{
+    if ( exporter_ )
+        exporter_->interrupt();
+}
+
 void LogFilteredData::clearSearch()
 {
+    workerThread_.cancel();
+
     currentRegExp_ = QRegExp();
+    currentQuery_.reset();
+    refinedRegExps_.clear();
+    timeWindow_ = TimeWindow();
     matching_lines_.clear();
+    matchesGeneration_++;
     maxLength_        = 0;
     maxLengthMarks_   = 0;
     nbLinesProcessed_ = 0;
-    filteredItemsCacheDirty_ = true;
+    markPositionsDirty_ = true;
+}
+
+const MatchHistogram& LogFilteredData::getMatchHistogram( int nbBuckets ) const
+{
+    histogram_.update( *sourceLogData_, matching_lines_, nbBuckets );
+
+    return histogram_;
 }
 
-qint64 LogFilteredData::getMatchingLineNumber( int matchNum ) const
+qint64 LogFilteredData::getMatchingLineNumber( qint64 matchNum ) const
 {
     qint64 matchingLine = findLogDataLine( matchNum );
 
@@ -137,9 +368,7 @@ qint64 LogFilteredData::getMatchingLineNumber( int matchNum ) const
 // Scan the list for the 'lineNumber' passed
 bool LogFilteredData::isLineInMatchingList( qint64 lineNumber )
 {
-    int index;                                    // Not used
-    return lookupLineNumber<SearchResultArray>(
-            matching_lines_, lineNumber, &index);
+    return matching_lines_.contains( lineNumber );
 }
 
 
@@ -153,13 +382,40 @@ LineNumber LogFilteredData::getNbMatches() const
     return matching_lines_.size();
 }
 
+bool LogFilteredData::getCurrentSearch( QRegExp* regExp, LineNumber* nbLines,
+        int* maxLength ) const
+{
+    if ( currentRegExp_.isEmpty() || currentQuery_
+            || ! refinedRegExps_.empty() || ! timeWindow_.isWhole() )
+        return false;
+
+    *regExp    = currentRegExp_;
+    *nbLines   = nbLinesProcessed_;
+    *maxLength = maxLength_;
+
+    return true;
+}
+
+bool LogFilteredData::isSearchTooCostly() const
+{
+    if ( CompiledRegExp::isTooCostly( currentRegExp_ ) )
+        return true;
+
+    for ( const QRegExp& regExp : refinedRegExps_ ) {
+        if ( CompiledRegExp::isTooCostly( regExp ) )
+            return true;
+    }
+
+    return false;
+}
+
 LineNumber LogFilteredData::getNbMarks() const
 {
     return marks_.size();
 }
 
 LogFilteredData::FilteredLineType
-    LogFilteredData::filteredLineTypeByIndex( int index ) const
+    LogFilteredData::filteredLineTypeByIndex( qint64 index ) const
 {
     // If we are only showing one type, the line is there because
     // it is of this type.
@@ -167,13 +423,25 @@ LogFilteredData::FilteredLineType
         return Match;
     else if ( visibility_ == MarksOnly )
         return Mark;
+    else if ( visibility_ == MatchesWithContext )
+        return matching_lines_.contains( findContextLine( index ) ) ?
+            Match : Context;
+    else if ( visibility_ == Collapsed ) {
+        const LineNumber line = findCollapsedLine( index );
+        if ( matching_lines_.contains( line ) )
+            return Match;
+        else if ( marks_.isLineMarked( line ) )
+            return Mark;
+        else
+            return Context;
+    }
     else {
         // If it is MarksAndMatches, we have to look.
-        // Regenerate the cache if needed
-        if ( filteredItemsCacheDirty_ )
-            regenerateFilteredItemsCache();
+        LineNumber line;
+        FilteredLineType type;
+        findCombinedItem( index, &line, &type );
 
-        return filteredItemsCache_[ index ].type();
+        return type;
     }
 }
 
@@ -185,13 +453,40 @@ void LogFilteredData::addMark( qint64 line, QChar mark )
         marks_.addMark( line, mark );
         maxLengthMarks_ = qMax( maxLengthMarks_,
                 sourceLogData_->getLineLength( line ) );
-        filteredItemsCacheDirty_ = true;
+        markPositionsDirty_ = true;
     }
     else
         LOG(logERROR) << "LogFilteredData::addMark\
  trying to create a mark outside of the file.";
 }
 
+void LogFilteredData::addMarks( const std::vector<qint64>& lines )
+{
+    if ( lines.empty() )
+        return;
+
+    marks_.addMarks( lines );
+    for ( qint64 line : lines )
+        maxLengthMarks_ = qMax( maxLengthMarks_,
+                sourceLogData_->getLineLength( line ) );
+    markPositionsDirty_ = true;
+}
+
+void LogFilteredData::markAllMatches()
+{
+    if ( matching_lines_.empty() )
+        return;
+
+    std::vector<qint64> lines;
+    lines.reserve( matching_lines_.size() );
+    for ( LineNumber line : matching_lines_ )
+        lines.push_back( line );
+
+    marks_.addMarks( lines );
+    maxLengthMarks_ = qMax( maxLengthMarks_, maxLength_ );
+    markPositionsDirty_ = true;
+}
+
 qint64 LogFilteredData::getMark( QChar mark ) const
 {
     return marks_.getMark( mark );
@@ -205,7 +500,7 @@ bool LogFilteredData::isLineMarked( qint64 line ) const
 void LogFilteredData::deleteMark( QChar mark )
 {
     marks_.deleteMark( mark );
-    filteredItemsCacheDirty_ = true;
+    markPositionsDirty_ = true;
 
     // FIXME: maxLengthMarks_
 }
@@ -213,7 +508,7 @@ void LogFilteredData::deleteMark( QChar mark )
 void LogFilteredData::deleteMark( qint64 line )
 {
     marks_.deleteMark( line );
-    filteredItemsCacheDirty_ = true;
+    markPositionsDirty_ = true;
 
     // Now update the max length if needed
     if ( sourceLogData_->getLineLength( line ) >= maxLengthMarks_ ) {
@@ -231,36 +526,91 @@ void LogFilteredData::deleteMark( qint64 line )
 void LogFilteredData::clearMarks()
 {
     marks_.clear();
-    filteredItemsCacheDirty_ = true;
+    markPositionsDirty_ = true;
     maxLengthMarks_ = 0;
 }
 
 void LogFilteredData::setVisibility( Visibility visi )
 {
     visibility_ = visi;
+    // (the runs are got again when looked at)
+    collapsedNbSourceLines_ = -1;
+}
+
+LogFilteredData::Visibility LogFilteredData::getVisibility() const
+{
+    return visibility_;
+}
+
+void LogFilteredData::setContextLines( int nbLines )
+{
+    if ( nbLines != contextLines_ ) {
+        contextLines_ = qMax( nbLines, 0 );
+        // (built again when looked at)
+        contextGeneration_ = -1;
+    }
+}
+
+qint64 LogFilteredData::getNbFoldedLines( qint64 index ) const
+{
+    if ( visibility_ != Collapsed )
+        return 1;
+
+    int run;
+    findCollapsedLine( index, &run );
+
+    return ( run >= 0 ) ? collapsedRuns_[run].nbLines : 1;
 }
 
 //
 // Slots
 //
-void LogFilteredData::handleSearchProgressed( int nbMatches, int progress )
+void LogFilteredData::handleSearchProgressed( qint64 nbMatches, int progress,
+        int generation )
 {
     LOG(logDEBUG) << "LogFilteredData::handleSearchProgressed matches="
         << nbMatches << " progress=" << progress;
 
+    // The progress of a search abandoned since (still queued)
+    if ( generation != workerThread_.generation() )
+        return;
+
     // searchDone_ = true;
-    workerThread_.getSearchResult( &maxLength_, &matching_lines_, &nbLinesProcessed_ );
-    filteredItemsCacheDirty_ = true;
+    takeSearchResult();
+    MemoryBudget::instance().setUsage( this, workerThread_.termCacheSize() );
 
     emit searchProgressed( nbMatches, progress );
 }
 
+void LogFilteredData::takeSearchResult()
+{
+    SearchResultArray new_matches;
+    std::vector<LineNumber> deleted_matches;
+    if ( workerThread_.takeSearchResult( &maxLength_, &new_matches,
+                &nbLinesProcessed_, &deleted_matches ) ) {
+        matching_lines_.clear();
+        matchesGeneration_++;
+    }
+
+    // The deleted matches are at the end
+    for ( LineNumber line : deleted_matches ) {
+        if ( ! matching_lines_.empty() && matching_lines_.last() == line ) {
+            matching_lines_.removeLast();
+            matchesGeneration_++;
+        }
+    }
+
+    for ( const MatchingLine& match : new_matches )
+        matching_lines_.append( match.lineNumber() );
+    markPositionsDirty_ = true;
+}
+
 LineNumber LogFilteredData::findLogDataLine( LineNumber lineNum ) const
 {
     LineNumber line = 0;
     if ( visibility_ == MatchesOnly ) {
         if ( lineNum < matching_lines_.size() ) {
-            line = matching_lines_[lineNum].lineNumber();
+            line = matching_lines_.select( lineNum );
         }
         else {
             LOG(logERROR) << "Index too big in LogFilteredData: " << lineNum;
@@ -272,13 +622,23 @@ LineNumber LogFilteredData::findLogDataLine( LineNumber lineNum ) const
         else
             LOG(logERROR) << "Index too big in LogFilteredData: " << lineNum;
     }
+    else if ( visibility_ == MatchesWithContext ) {
+        if ( lineNum < nbContextLines() )
+            line = findContextLine( lineNum );
+        else
+            LOG(logERROR) << "Index too big in LogFilteredData: " << lineNum;
+    }
+    else if ( visibility_ == Collapsed ) {
+        if ( lineNum < nbCollapsedLines() )
+            line = findCollapsedLine( lineNum );
+        else
+            LOG(logERROR) << "Index too big in LogFilteredData: " << lineNum;
+    }
     else {
-        // Regenerate the cache if needed
-        if ( filteredItemsCacheDirty_ )
-            regenerateFilteredItemsCache();
-
-        if ( lineNum < filteredItemsCache_.size() )
-            line = filteredItemsCache_[ lineNum ].lineNumber();
+        if ( lineNum < doGetNbLine() ) {
+            FilteredLineType type;
+            findCombinedItem( lineNum, &line, &type );
+        }
         else
             LOG(logERROR) << "Index too big in LogFilteredData: " << lineNum;
     }
@@ -305,27 +665,47 @@ QString LogFilteredData::doGetExpandedLineString( qint64 lineNum ) const
 }
 
 // Implementation of the virtual function.
+// The lines are fetched from the source together.
 QStringList LogFilteredData::doGetLines( qint64 first_line, int number ) const
 {
-    QStringList list;
-
-    for ( int i = first_line; i < first_line + number; i++ ) {
-        list.append( doGetLineString( i ) );
-    }
-
-    return list;
+    return sourceLogData_->getLinesAt( sourceLines( first_line, number ) );
 }
 
 // Implementation of the virtual function.
 QStringList LogFilteredData::doGetExpandedLines( qint64 first_line, int number ) const
 {
-    QStringList list;
+    return sourceLogData_->getExpandedLinesAt(
+            sourceLines( first_line, number ) );
+}
 
-    for ( int i = first_line; i < first_line + number; i++ ) {
-        list.append( doGetExpandedLineString( i ) );
-    }
+std::vector<qint64> LogFilteredData::sourceLines( qint64 first_line,
+        int number ) const
+{
+    std::vector<qint64> lines;
+    lines.reserve( qMax( number, 0 ) );
+    for ( qint64 i = first_line; i < first_line + number; i++ )
+        lines.push_back( findLogDataLine( i ) );
 
-    return list;
+    return lines;
+}
+
+// Implementation of the virtual function.
+// The windows of the long lines are read from the source one by one.
+void LogFilteredData::doFillExpandedLineWindows( qint64 first_line,
+        int number, int first_col, int nb_cols, LineBuffer* lines,
+        std::vector<int>* windowStarts ) const
+{
+    LineBuffer line;
+    std::vector<int> windowStart;
+
+    for ( qint64 i = first_line; i < first_line + number; i++ ) {
+        sourceLogData_->getExpandedLineWindows( findLogDataLine( i ), 1,
+                first_col, nb_cols, &line, &windowStart );
+        if ( line.size() == 0 )
+            break;
+        lines->append( line.rawString( 0 ) );
+        windowStarts->push_back( windowStart.front() );
+    }
 }
 
 // Implementation of the virtual function.
@@ -337,12 +717,15 @@ qint64 LogFilteredData::doGetNbLine() const
         nbLines = matching_lines_.size();
     else if ( visibility_ == MarksOnly )
         nbLines = marks_.size();
+    else if ( visibility_ == MatchesWithContext )
+        nbLines = nbContextLines();
+    else if ( visibility_ == Collapsed )
+        nbLines = nbCollapsedLines();
     else {
-        // Regenerate the cache if needed (hopefully most of the time
-        // it won't be necessarily)
-        if ( filteredItemsCacheDirty_ )
-            regenerateFilteredItemsCache();
-        nbLines = filteredItemsCache_.size();
+        if ( markPositionsDirty_ )
+            updateMarkPositions();
+        nbLines = matching_lines_.size() + marks_.size()
+            - markedMatchesBefore_.back();
     }
 
     return nbLines;
@@ -357,6 +740,11 @@ int LogFilteredData::doGetMaxLength() const
         max_length = maxLength_;
     else if ( visibility_ == MarksOnly )
         max_length = maxLengthMarks_;
+    else if ( visibility_ == MatchesWithContext )
+        // (the lengths of the lines around the matches are not known)
+        max_length = qMax( maxLength_, sourceLogData_->getMaxLength() );
+    else if ( visibility_ == Collapsed )
+        max_length = sourceLogData_->getMaxLength();
     else
         max_length = qMax( maxLength_, maxLengthMarks_ );
 
@@ -367,45 +755,169 @@ int LogFilteredData::doGetMaxLength() const
 int LogFilteredData::doGetLineLength( qint64 lineNum ) const
 {
     qint64 line = findLogDataLine( lineNum );
-    return sourceLogData_->getExpandedLineString( line ).length();
-}
-
-// TODO: We might be a bit smarter and not regenerate the whole thing when
-// e.g. stuff is added at the end of the search.
-void LogFilteredData::regenerateFilteredItemsCache() const
-{
-    LOG(logDEBUG) << "regenerateFilteredItemsCache";
-
-    filteredItemsCache_.clear();
-    filteredItemsCache_.reserve( matching_lines_.size() + marks_.size() );
-    // (it's an overestimate but probably not by much so it's fine)
-
-    auto i = matching_lines_.cbegin();
-    Marks::const_iterator j = marks_.begin();
-
-    while ( ( i != matching_lines_.cend() ) || ( j != marks_.end() ) ) {
-        qint64 next_mark =
-            ( j != marks_.end() ) ? j->lineNumber() : std::numeric_limits<qint64>::max();
-        qint64 next_match =
-            ( i != matching_lines_.cend() ) ? i->lineNumber() : std::numeric_limits<qint64>::max();
-        // We choose a Mark over a Match if a line is both, just an arbitrary choice really.
-        if ( next_mark <= next_match ) {
-            // LOG(logDEBUG) << "Add mark at " << next_mark;
-            filteredItemsCache_.push_back( FilteredItem( next_mark, Mark ) );
-            if ( j != marks_.end() )
-                ++j;
-            if ( ( next_mark == next_match ) && ( i != matching_lines_.cend() ) )
-                ++i;  // Case when it's both match and mark.
+    return sourceLogData_->getLineLength( line );
+}
+
+// Only the marks (few) are looked at, their positions in the combined
+// list being given by the rank of their line among the matches.
+void LogFilteredData::updateMarkPositions() const
+{
+    markIndexes_.clear();
+    markedMatchesBefore_.clear();
+    markIndexes_.reserve( marks_.size() );
+    markedMatchesBefore_.reserve( marks_.size() + 1 );
+
+    LineNumber markedMatches = 0;
+    LineNumber nbMarksBefore = 0;
+    for ( Marks::const_iterator i = marks_.begin(); i != marks_.end(); ++i ) {
+        const LineNumber line = i->lineNumber();
+
+        // Before the mark: the marks and the matches not marked
+        markIndexes_.push_back( nbMarksBefore
+                + matching_lines_.rank( line ) - markedMatches );
+        markedMatchesBefore_.push_back( markedMatches );
+
+        if ( matching_lines_.contains( line ) )
+            markedMatches++;
+        nbMarksBefore++;
+    }
+    markedMatchesBefore_.push_back( markedMatches );
+
+    markPositionsDirty_ = false;
+}
+
+void LogFilteredData::findCombinedItem( LineNumber index, LineNumber* line,
+        FilteredLineType* type ) const
+{
+    if ( markPositionsDirty_ )
+        updateMarkPositions();
+
+    // Number of marks before the item
+    const size_t nbMarks = std::lower_bound( markIndexes_.begin(),
+            markIndexes_.end(), index ) - markIndexes_.begin();
+
+    if ( nbMarks < markIndexes_.size() && markIndexes_[nbMarks] == index ) {
+        *type = Mark;
+        *line = marks_.getLineMarkedByIndex( nbMarks );
+    }
+    else {
+        // The matches before the item are the ones not marked
+        // and the marked ones before the marks before it.
+        *type = Match;
+        *line = matching_lines_.select(
+                index - nbMarks + markedMatchesBefore_[nbMarks] );
+    }
+}
+
+// The matches being only added after the last one (unless the generation
+// changes), only the ones added since the last call are looked at.
+void LogFilteredData::updateContextRanges() const
+{
+    if ( contextGeneration_ != matchesGeneration_ ) {
+        contextRanges_.clear();
+        contextIndexes_.clear();
+        contextNbMatches_ = 0;
+        contextGeneration_ = matchesGeneration_;
+    }
+
+    if ( contextNbMatches_ == matching_lines_.size() )
+        return;
+
+    // After the last match of the last range
+    MatchSet::const_iterator i = contextRanges_.empty() ?
+        matching_lines_.begin() :
+        matching_lines_.lowerBound( contextRanges_.back().end - contextLines_ );
+    for ( ; i != matching_lines_.end(); ++i ) {
+        const LineNumber first = qMax( *i - contextLines_, 0LL );
+        const LineNumber end = *i + contextLines_ + 1;
+
+        if ( ! contextRanges_.empty() && first <= contextRanges_.back().end ) {
+            contextRanges_.back().end = end;
         }
         else {
-            // LOG(logDEBUG) << "Add match at " << next_match;
-            filteredItemsCache_.push_back( FilteredItem( next_match, Match ) );
-            if ( i != matching_lines_.cend() )
-                ++i;
+            contextIndexes_.push_back( contextRanges_.empty() ? 0 :
+                    contextIndexes_.back() + contextRanges_.back().end
+                    - contextRanges_.back().first );
+            contextRanges_.push_back( { first, end } );
         }
     }
 
-    filteredItemsCacheDirty_ = false;
+    contextNbMatches_ = matching_lines_.size();
+}
 
-    LOG(logDEBUG) << "finished regenerateFilteredItemsCache";
+// Only the last range can go past the end of the source
+// (the lines after the last match might not be there yet).
+LineNumber LogFilteredData::nbContextLines() const
+{
+    updateContextRanges();
+
+    if ( contextRanges_.empty() )
+        return 0;
+
+    const ContextRange& last = contextRanges_.back();
+    return contextIndexes_.back()
+        + qMin( last.end, LineNumber( sourceLogData_->getNbLine() ) ) - last.first;
+}
+
+LineNumber LogFilteredData::findContextLine( LineNumber index ) const
+{
+    updateContextRanges();
+
+    // The range of the index
+    const size_t range = std::upper_bound( contextIndexes_.begin(),
+            contextIndexes_.end(), index ) - contextIndexes_.begin() - 1;
+
+    return contextRanges_[range].first + index - contextIndexes_[range];
+}
+
+// The runs are only known for the lines indexed, so they can change
+// when the source has more lines.
+void LogFilteredData::updateCollapsedRuns() const
+{
+    const LineNumber nbSourceLines = sourceLogData_->getNbLine();
+    if ( nbSourceLines == collapsedNbSourceLines_ )
+        return;
+
+    collapsedRuns_ = sourceLogData_->getLineRuns();
+    collapsedIndexes_.clear();
+    // Number of lines folded before the run
+    LineNumber folded = 0;
+    for ( const LineRun& run : collapsedRuns_ ) {
+        collapsedIndexes_.push_back( run.firstLine - folded );
+        folded += run.nbLines - 1;
+    }
+    collapsedNbSourceLines_ = nbSourceLines;
+}
+
+LineNumber LogFilteredData::nbCollapsedLines() const
+{
+    updateCollapsedRuns();
+
+    if ( collapsedRuns_.empty() )
+        return collapsedNbSourceLines_;
+
+    const LineRun& last = collapsedRuns_.back();
+    return collapsedIndexes_.back() + 1
+        + collapsedNbSourceLines_ - last.firstLine - last.nbLines;
+}
+
+LineNumber LogFilteredData::findCollapsedLine( LineNumber index,
+        int* run ) const
+{
+    updateCollapsedRuns();
+
+    // The last run starting at or before the index
+    const int i = std::upper_bound( collapsedIndexes_.begin(),
+            collapsedIndexes_.end(), index ) - collapsedIndexes_.begin() - 1;
+
+    if ( run )
+        *run = ( i >= 0 && collapsedIndexes_[i] == index ) ? i : -1;
+
+    if ( i < 0 )
+        return index;
+    else if ( collapsedIndexes_[i] == index )
+        return collapsedRuns_[i].firstLine;
+    else
+        return collapsedRuns_[i].firstLine + collapsedRuns_[i].nbLines
+            + index - collapsedIndexes_[i] - 1;
 }
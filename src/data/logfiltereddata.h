@@ -21,6 +21,7 @@
 #define LOGFILTEREDDATA_H
 
 #include <memory>
+#include <vector>
 
 #include <QObject>
 #include <QByteArray>
@@ -31,41 +32,116 @@
 #include "abstractlogdata.h"
 #include "logfiltereddataworkerthread.h"
 #include "marks.h"
+#include "matchesexporter.h"
+#include "matchhistogram.h"
+#include "memorybudget.h"
 
-class LogData;
 class Marks;
 
-// A list of matches found in a LogData, it stores all the matching lines,
+// A list of matches found in a LogData (or a LogDataSet), it stores all the matching lines,
 // which can be accessed using the AbstractLogData interface, together with
 // the original line number where they were found.
 // Constructing such objet does not start the search.
-// This object should be constructed by a LogData.
-class LogFilteredData : public AbstractLogData {
+// This object should be constructed by a LogData or a LogDataSet.
+class LogFilteredData : public AbstractLogData, public MemoryBudget::Client {
   Q_OBJECT
 
   public:
     // Creates an empty LogFilteredData
     LogFilteredData();
-    // Constructor used by LogData
-    LogFilteredData( const LogData* logData );
+    // Constructor used by LogData and LogDataSet
+    LogFilteredData( const AbstractLogData* logData );
 
     ~LogFilteredData();
 
     // Starts the async search, sending newDataAvailable() when new data found.
-    // If a search is already in progress this function will block until
-    // it is done, so the application should call interruptSearch() first.
-    void runSearch( const QRegExp& regExp );
+    // Only the lines in the time window are searched if the timestamps
+    // of the source are known (see LogData::setTimestampRule), also
+    // when the search is updated or run within its results.
+    // If a search is already in progress it is abandoned without waiting
+    // for it, its results and progress being dropped.
+    // (the same for the other searches and queries started)
+    void runSearch( const QRegExp& regExp,
+            const TimeWindow& timeWindow = TimeWindow() );
+    // Starts the async evaluation of a boolean query, in the same way.
+    // The matches of the terms searched for before (by runSearch or in
+    // a query) are reused, only the new terms being searched for.
+    void runQuery( const SearchQuery& query );
+    // Sets the fields whose values are indexed (such as "level" or
+    // "thread"), the query terms written field=value on them being
+    // answered from the index (see FieldIndex).
+    void setIndexedFields( const QStringList& names );
+    // Index the tokens of the source, being the passed file which is
+    // not expected to change (an archived log), so the searches only
+    // read the lines having the tokens required by their pattern.
+    // The index is built by the first search and kept in the index
+    // cache (see TokenIndex). An empty name disables it.
+    void setTokenIndexFile( const QString& fileName );
+    // Index the trigrams of the blocks of lines of the source, so the
+    // searches (substrings, wildcards or regexps needing some strings)
+    // only read the blocks having the trigrams of their pattern.
+    // The index is built by the first search (see TrigramIndex).
+    void setTrigramIndexEnabled( bool enabled );
+    // Mine the templates of the lines of the source not mined yet, in
+    // the background, sending templatesMined() when done. The lines of
+    // a template are then searched for with the query term
+    // template=<number> (see TemplateIndex), answered without reading
+    // the lines.
+    void mineTemplates();
+    // Returns the (at most) number templates having the most lines
+    // among the lines mined so far
+    std::vector<TemplateIndex::Summary> getTopTemplates( int number ) const;
+    // Sets the priority of the searches among the tasks of the
+    // TaskScheduler (Visible when the file is displayed).
+    void setPriority( TaskScheduler::Priority priority );
+    // From MemoryBudget::Client, forgets the matches kept for the
+    // queries (the matches of the current search are kept)
+    void releaseMemory() override;
+    // Starts the async search for the current matches also matching the
+    // passed regexp, only the matching lines being searched again.
+    // A full search is started if the current search is not a regexp one.
+    void runSearchWithinResults( const QRegExp& regExp );
+    // Starts the async search for the passed regexp, replacing the
+    // current one. If it only matches lines the current regexp matches
+    // (see LiteralPrefilter::isNarrower), only the current matches and
+    // the lines not searched yet are searched, else the whole file is.
+    void runNarrowerSearch( const QRegExp& regExp );
+    // Keep the passed matches of the regexp in the first nbLines lines
+    // of the source (restored with the session), so a search for it
+    // hands them over at once and only searches the lines after them.
+    void restoreMatches( const QRegExp& regExp, const MatchSet& matches,
+            LineNumber nbLines, int maxLength );
+    // Replace the search by the passed lines of the source (found by
+    // another means, see LogComparison), shown as its matches.
+    // They are not updated when the source changes.
+    void showLines( const MatchSet& lines );
     // Add to the existing search, starting at the line when the search was
     // last stopped. Used when the file on disk has been added too.
     void updateSearch();
-    // Interrupt the running search if one is in progress.
+    // Interrupt the running search if one is in progress, waiting for it
+    // to stop (within a chunk of lines), the matches found being kept.
     // Nothing is done if no search is in progress.
     void interruptSearch();
-    // Clear the search and the list of results.
+    // Clear the search and the list of results, abandoning the search
+    // in progress.
     void clearSearch();
+    // Forget the matches kept for the queries, to be called when the
+    // file has changed other than by lines being added.
+    void forgetPreviousSearches();
+    // Forget the matches and marks from the passed line on, the file
+    // having been truncated there. The search is interrupted, to be
+    // continued from there by updateSearch().
+    void truncate( qint64 nbLines );
+    // Write the matching lines found so far to the file, in the
+    // background (see MatchesExporter), sending exportProgressed()
+    // then exportFinished(). An export in progress is interrupted.
+    void exportMatches( const QString& fileName );
+    // Interrupt the export if one is in progress (the file being left
+    // incomplete)
+    void interruptExport();
     // Returns the line number in the original LogData where the element
     // 'index' was found.
-    qint64 getMatchingLineNumber( int index ) const;
+    qint64 getMatchingLineNumber( qint64 index ) const;
     // Returns whether the line number passed is in our list of matching ones.
     bool isLineInMatchingList( qint64 lineNumber );
 
@@ -75,17 +151,46 @@ class LogFilteredData : public AbstractLogData {
     LineNumber getNbMatches() const;
     // Returns the number of marks (independently of the visibility)
     LineNumber getNbMarks() const;
+    // Returns the matching lines (independently of the visibility)
+    const MatchSet& getMatches() const { return matching_lines_; }
+    // Returns the regexp of the current search, the number of lines
+    // searched for it and the max length of its matches, or false if
+    // the current search is not the search of a regexp in the whole
+    // source (a query, run within results or in a time window).
+    bool getCurrentSearch( QRegExp* regExp, LineNumber* nbLines,
+            int* maxLength ) const;
+    // Returns whether a pattern of the current search has been found
+    // too costly to match, the lines it was abandoned on (and the
+    // following ones) being then missing from the matches
+    // (see CompiledRegExp::isTooCostly).
+    bool isSearchTooCostly() const;
+    // Returns a number changed each time matches are removed, the
+    // matches being only added to (after the last one) otherwise.
+    int getMatchesGeneration() const { return matchesGeneration_; }
+    // Returns the number of matches in (at most) nbBuckets periods of
+    // the times of the source, or ranges of its lines if its timestamps
+    // are not known (see MatchHistogram). It is counted from the
+    // matches found so far, the buckets being kept as the file grows.
+    // (reference valid until the next call)
+    const MatchHistogram& getMatchHistogram( int nbBuckets ) const;
+    // Returns the marked lines (independently of the visibility)
+    const Marks& getMarks() const { return marks_; }
 
     // Returns the reason why the line at the passed index is in the filtered
-    // data.  It can be because it is either a mark or a match.
-    enum FilteredLineType { Match, Mark };
-    FilteredLineType filteredLineTypeByIndex( int index ) const;
+    // data.  It can be because it is either a mark or a match, or
+    // around a match (see MatchesWithContext) or shown with Collapsed.
+    enum FilteredLineType { Match, Mark, Context };
+    FilteredLineType filteredLineTypeByIndex( qint64 index ) const;
 
     // Marks interface (delegated to a Marks object)
 
     // Add a mark at the given line, optionally identified by the given char
     // If a mark for this char already exist, the previous one is replaced.
     void addMark( qint64 line, QChar mark = QChar() );
+    // Add unnamed marks at all the passed lines (sorted) at once.
+    void addMarks( const std::vector<qint64>& lines );
+    // Mark all the lines matching the current search at once.
+    void markAllMatches();
     // Get the (unique) mark identified by the passed char.
     qint64 getMark( QChar mark ) const;
     // Returns wheither the passed line has a mark on it.
@@ -100,34 +205,66 @@ class LogFilteredData : public AbstractLogData {
 
     // Changes what the AbstractLogData returns via its getXLines/getNbLines
     // API.
-    enum Visibility { MatchesOnly, MarksOnly, MarksAndMatches };
+    // MatchesWithContext shows the matches with the lines around them
+    // (see setContextLines()), as grep -C does.
+    // Collapsed shows all the lines of the source, each run of similar
+    // lines folded into its first one (see getLineRuns()).
+    enum Visibility { MatchesOnly, MarksOnly, MarksAndMatches,
+        MatchesWithContext, Collapsed };
     void setVisibility( Visibility visibility );
+    Visibility getVisibility() const;
+    // Sets the number of lines shown before and after each match
+    // with MatchesWithContext (3 by default)
+    void setContextLines( int nbLines );
+    int getContextLines() const { return contextLines_; }
+    // Returns the number of lines of the source shown by the line at
+    // the passed index (more than 1 for a run folded with Collapsed)
+    qint64 getNbFoldedLines( qint64 index ) const;
 
   signals:
     // Sent when the search has progressed, give the number of matches (so far)
-    // and the percentage of completion
-    void searchProgressed( int nbMatches, int progress );
+    // and the percentage of completion (only for the current search)
+    void searchProgressed( qint64 nbMatches, int progress );
+    // Sent while the matches are exported, then at the end of the
+    // export (success being false if the file is incomplete)
+    void exportProgressed( int percent );
+    void exportFinished( bool success );
+    // Sent when the templates of the lines have been mined
+    // (see mineTemplates())
+    void templatesMined();
 
   private slots:
-    void handleSearchProgressed( int NbMatches, int progress );
+    void handleSearchProgressed( qint64 nbMatches, int progress,
+            int generation );
 
   private:
-    class FilteredItem;
-
     // Implementation of virtual functions
     QString doGetLineString( qint64 line ) const;
     QString doGetExpandedLineString( qint64 line ) const;
     QStringList doGetLines( qint64 first, int number ) const;
     QStringList doGetExpandedLines( qint64 first, int number ) const;
+    void doFillExpandedLineWindows( qint64 first, int number,
+            int first_col, int nb_cols, LineBuffer* lines,
+            std::vector<int>* windowStarts ) const;
     qint64 doGetNbLine() const;
     int doGetMaxLength() const;
     int doGetLineLength( qint64 line ) const;
 
-    // List of the matching line numbers
-    SearchResultArray matching_lines_;
+    // Set of the matching line numbers
+    MatchSet matching_lines_;
+    int matchesGeneration_;
+    // The buckets of the last histogram asked for
+    mutable MatchHistogram histogram_;
 
-    const LogData* sourceLogData_;
+    const AbstractLogData* sourceLogData_;
     QRegExp currentRegExp_;
+    // Regexps the current search has been restricted by (if it has
+    // been run within the results of the previous one)
+    std::vector<QRegExp> refinedRegExps_;
+    // The times the current search is restricted to
+    TimeWindow timeWindow_;
+    // Set if the current search is a query
+    std::unique_ptr<SearchQuery> currentQuery_;
     bool searchDone_;
     int maxLength_;
     int maxLengthMarks_;
@@ -136,42 +273,71 @@ class LogFilteredData : public AbstractLogData {
 
     Visibility visibility_;
 
-    // Cache used to combine Marks and Matches
-    // when visibility_ == MarksAndMatches
-    // (QVector store actual objects instead of pointers)
-    mutable std::vector<FilteredItem> filteredItemsCache_;
-    mutable bool filteredItemsCacheDirty_;
+    // Position of the marks among the matches, used to combine them
+    // when visibility_ == MarksAndMatches without merging the two lists
+    // (a line both marked and matching being shown once, as a mark).
+    // For each mark, its index in the combined list and the number of
+    // marks before it which are matches (then the total number).
+    mutable std::vector<LineNumber> markIndexes_;
+    mutable std::vector<LineNumber> markedMatchesBefore_;
+    mutable bool markPositionsDirty_;
+
+    // The lines shown when visibility_ == MatchesWithContext, as the
+    // ranges [first, end) of lines around the matches, merged where
+    // they overlap or touch, with the index of the first line of each
+    // one in the list (the sum of the lengths of the ranges before it).
+    // They are only built when looked at, from the matches added since
+    // (the last range being extended), or all again if matches have been
+    // removed (see matchesGeneration_).
+    struct ContextRange {
+        LineNumber first;
+        LineNumber end;
+    };
+    int contextLines_;
+    mutable std::vector<ContextRange> contextRanges_;
+    mutable std::vector<LineNumber> contextIndexes_;
+    mutable LineNumber contextNbMatches_;
+    mutable int contextGeneration_;
+
+    // The runs of similar lines of the source folded when
+    // visibility_ == Collapsed, with the index of the first line of
+    // each one, got again when the number of lines of the source has
+    // changed.
+    mutable std::vector<LineRun> collapsedRuns_;
+    mutable std::vector<LineNumber> collapsedIndexes_;
+    mutable LineNumber collapsedNbSourceLines_;
 
     LogFilteredDataWorkerThread workerThread_;
     Marks marks_;
+    // The export running or done last (null if none)
+    std::unique_ptr<MatchesExporter> exporter_;
 
     // Utility functions
     LineNumber findLogDataLine( LineNumber lineNum ) const;
-    void regenerateFilteredItemsCache() const;
-};
-
-// A class representing a Mark or Match.
-// Conceptually it should be a base class for Mark and MatchingLine,
-// but we implement it this way for performance reason as we create plenty of
-// those everytime we refresh the cache.
-// Specifically it allows to store this in the cache by value instead
-// of pointer (less small allocations and no RTTI).
-class LogFilteredData::FilteredItem {
-  public:
-    // A default ctor seems to be necessary for QVector
-    FilteredItem()
-    { lineNumber_ = 0; }
-    FilteredItem( LineNumber lineNumber, FilteredLineType type )
-    { lineNumber_ = lineNumber; type_ = type; }
-
-    LineNumber lineNumber() const
-    { return lineNumber_; }
-    FilteredLineType type() const
-    { return type_; }
-
-  private:
-    LineNumber lineNumber_;
-    FilteredLineType type_;
+    // Returns the lines of the source shown by the passed lines
+    std::vector<qint64> sourceLines( qint64 first_line, int number ) const;
+    // Take the results found by the worker since the last call
+    void takeSearchResult();
+    void updateMarkPositions() const;
+    // Add the ranges of the matches not in contextRanges_ yet
+    void updateContextRanges() const;
+    // Number of lines shown with MatchesWithContext
+    LineNumber nbContextLines() const;
+    // Returns the line of the source at the passed index in the
+    // matches with their context
+    LineNumber findContextLine( LineNumber index ) const;
+    // Get the runs of the source again if it has changed
+    void updateCollapsedRuns() const;
+    // Number of lines shown with Collapsed
+    LineNumber nbCollapsedLines() const;
+    // Returns the line of the source at the passed index in the
+    // collapsed lines, and the run folded there if any (-1 if none)
+    LineNumber findCollapsedLine( LineNumber index,
+            int* run = nullptr ) const;
+    // Find the line and type of the item at the passed index
+    // in the combined list of marks and matches
+    void findCombinedItem( LineNumber index, LineNumber* line,
+            FilteredLineType* type ) const;
 };
 
 #endif
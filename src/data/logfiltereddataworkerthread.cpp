@@ -17,270 +17,1209 @@
  * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QElapsedTimer>
 #include <QFile>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "log.h"
+#include "perfcounters.h"
+#include "tracerecorder.h"
 
 #include "logfiltereddataworkerthread.h"
-#include "logdata.h"
+#include "abstractlogdata.h"
+#include "fusedsearch.h"
 
-// Number of lines in each chunk to read
+// Number of lines handed over at once to the shared results, and read
+// at once by the searches of candidate lines
 const int SearchOperation::nbLinesInChunk = 5000;
 
-void SearchData::getAll( int* length, SearchResultArray* matches,
-        qint64* lines) const
+// Number of terms whose matches are kept
+const int TermResultCache::maxTerms = 16;
+// Memory used by the matches kept
+const size_t TermResultCache::maxSize = 64 * 1024 * 1024;
+
+void TimeWindow::restrictLines( const AbstractLogData* source,
+        qint64* firstLine, qint64* endLine ) const
 {
-    QMutexLocker locker( &dataMutex_ );
+    const qint64 first_line = source->getLineAtTime( start );
+    // The timestamps are not known
+    if ( first_line == -1 )
+        return;
 
-    *length  = maxLength_;
-    *lines   = nbLinesProcessed_;
+    // The first line after the window
+    const qint64 end_line = ( end == std::numeric_limits<qint64>::max() ) ?
+        *endLine : source->getLineAtTime( end + 1 );
 
-    // This is a copy (potentially slow)
-    *matches = matches_;
+    *endLine   = qMin( *endLine, end_line );
+    *firstLine = qMin( qMax( *firstLine, first_line ), *endLine );
 }
 
-void SearchData::setAll( int length,
-        SearchResultArray&& matches )
+bool SearchData::takeAll( int* length, SearchResultArray* newMatches,
+        qint64* lines, std::vector<LineNumber>* deletedMatches )
 {
-    QMutexLocker locker( &dataMutex_ );
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
 
-    maxLength_  = length;
-    matches_    = matches;
+    *length  = maxLength_;
+    *lines   = nbLinesProcessed_;
+
+    // Only the new matches are moved (no copy)
+    newMatches->clear();
+    newMatches->swap( newMatches_ );
+    if ( ! newMatches->empty() )
+        lastTakenMatch_ = newMatches->back().lineNumber();
+    deletedMatches->clear();
+    deletedMatches->swap( deletedMatches_ );
+
+    const bool reset = reset_;
+    reset_ = false;
+
+    return reset;
 }
 
-void SearchData::addAll( int length,
-        const SearchResultArray& matches, LineNumber lines )
+void SearchData::addAll( int generation, int length,
+        SearchResultArray&& matches, LineNumber lines )
 {
-    QMutexLocker locker( &dataMutex_ );
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    if ( generation != generation_ ) {
+        matches.clear();
+        return;
+    }
 
     maxLength_        = qMax( maxLength_, length );
     nbLinesProcessed_ = lines;
+    nbMatches_       += matches.size();
 
-    // This does a copy as we want the final array to be
-    // linear.
-    matches_.insert( std::end( matches_ ),
-            std::begin( matches ), std::end( matches ) );
+    // The client usually took the previous matches already: these are
+    // swapped in (no copy), the caller getting the empty array back
+    // to fill the next ones.
+    if ( newMatches_.empty() )
+        newMatches_.swap( matches );
+    else
+        newMatches_.insert( std::end( newMatches_ ),
+                std::begin( matches ), std::end( matches ) );
+    matches.clear();
 }
 
 LineNumber SearchData::getNbMatches() const
 {
-    QMutexLocker locker( &dataMutex_ );
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
 
-    return matches_.size();
+    return nbMatches_;
 }
 
-// This function starts searching from the end since we use it
+LineNumber SearchData::getNbLinesProcessed() const
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    return nbLinesProcessed_;
+}
+
+// The match is looked for from the end since we use it
 // to remove the final match.
-void SearchData::deleteMatch( LineNumber line )
+void SearchData::deleteMatch( int generation, LineNumber line )
 {
-    QMutexLocker locker( &dataMutex_ );
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
 
-    SearchResultArray::iterator i = matches_.end();
-    while ( i != matches_.begin() ) {
-        i--;
-        const LineNumber this_line = i->lineNumber();
-        if ( this_line == line ) {
-            matches_.erase(i);
-            break;
+    if ( generation != generation_ )
+        return;
+
+    // Either it has not been taken yet...
+    if ( ! newMatches_.empty() && newMatches_.front().lineNumber() <= line ) {
+        SearchResultArray::iterator i = newMatches_.end();
+        while ( i != newMatches_.begin() ) {
+            i--;
+            const LineNumber this_line = i->lineNumber();
+            if ( this_line == line ) {
+                newMatches_.erase(i);
+                nbMatches_--;
+                break;
+            }
+            // Exit if we have passed the line number to look for.
+            if ( this_line < line )
+                break;
         }
-        // Exit if we have passed the line number to look for.
-        if ( this_line < line )
-            break;
+    }
+    // ... or the client must remove it
+    else if ( lastTakenMatch_ == line ) {
+        deletedMatches_.push_back( line );
+        nbMatches_--;
+        lastTakenMatch_ = -1;
     }
 }
 
-void SearchData::clear()
+void SearchData::clear( int generation )
 {
-    QMutexLocker locker( &dataMutex_ );
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    if ( generation != generation_ )
+        return;
 
     maxLength_        = 0;
     nbLinesProcessed_ = 0;
-    matches_.clear();
+    nbMatches_        = 0;
+    newMatches_.clear();
+    deletedMatches_.clear();
+    lastTakenMatch_   = -1;
+    reset_            = true;
+}
+
+void SearchData::restart( int generation )
+{
+    // The changes of the previous generation are refused before the
+    // data are cleared
+    {
+        PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+        generation_ = generation;
+    }
+
+    clear( generation );
+}
+
+void SearchData::truncate( LineNumber nbLines,
+        LineNumber nbMatches, qint64 lastMatch )
+{
+    PerfMutexLocker locker( &dataMutex_, PerfCounters::DataMutexWait );
+
+    nbLinesProcessed_ = qMin( nbLinesProcessed_, nbLines );
+    nbMatches_        = nbMatches;
+    newMatches_.clear();
+    deletedMatches_.clear();
+    lastTakenMatch_   = lastMatch;
+}
+
+bool TermResultCache::find( const QRegExp& term,
+        MatchSet* matches, LineNumber* nbLines, int* maxLength )
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( auto i = entries_.begin(); i != entries_.end(); ++i ) {
+        if ( i->term == term ) {
+            *matches = i->matches;
+            *nbLines = i->nbLines;
+            if ( maxLength )
+                *maxLength = i->maxLength;
+            // Now the most recently used
+            entries_.splice( entries_.begin(), entries_, i );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TermResultCache::store( const QRegExp& term,
+        const MatchSet& matches, LineNumber nbLines, int maxLength )
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( auto i = entries_.begin(); i != entries_.end(); ++i ) {
+        if ( i->term == term ) {
+            entries_.erase( i );
+            break;
+        }
+    }
+
+    entries_.push_front( Entry { term, matches, nbLines, maxLength } );
+
+    if ( entries_.size() > (size_t) maxTerms )
+        entries_.pop_back();
+
+    // The most recent entry is always kept
+    size_t size = 0;
+    for ( auto i = entries_.begin(); i != entries_.end(); ++i ) {
+        size += i->matches.allocatedSize();
+        if ( size > maxSize && i != entries_.begin() ) {
+            entries_.erase( i, entries_.end() );
+            break;
+        }
+    }
+}
+
+void TermResultCache::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    entries_.clear();
+}
+
+void TermResultCache::truncate( LineNumber nbLines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    for ( Entry& entry : entries_ ) {
+        while ( ! entry.matches.empty() && entry.matches.last() >= nbLines )
+            entry.matches.removeLast();
+        entry.nbLines = qMin( entry.nbLines, nbLines );
+    }
+}
+
+size_t TermResultCache::allocatedSize() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    size_t size = 0;
+    for ( const Entry& entry : entries_ )
+        size += entry.matches.allocatedSize();
+
+    return size;
 }
 
 LogFilteredDataWorkerThread::LogFilteredDataWorkerThread(
-        const LogData* sourceLogData )
-    : QThread(), mutex_(), operationRequestedCond_(), nothingToDoCond_(), searchData_()
+        const AbstractLogData* sourceLogData )
+    : QObject(), mutex_(), nothingToDoCond_(), operationsRequested_(),
+    taskMutex_(), task_(), priority_( TaskScheduler::Background ),
+    miningTask_(), miningInterruptRequested_( false ),
+    searchData_(), termCache_(), fieldIndex_(), templateIndex_(),
+    tokenIndex_(), trigramIndex_()
 {
     terminate_          = false;
-    interruptRequested_ = false;
-    operationRequested_ = NULL;
+    generation_         = 0;
+    operationRunning_   = NULL;
+    taskSubmitted_      = false;
+    miningSubmitted_    = false;
+    miningRequested_    = false;
 
     sourceLogData_ = sourceLogData;
 }
 
 LogFilteredDataWorkerThread::~LogFilteredDataWorkerThread()
 {
+    TaskScheduler::TaskHandle task;
     {
         QMutexLocker locker( &mutex_ );
         terminate_ = true;
-        operationRequestedCond_.wakeAll();
+        dropOperations();
+    }
+
+    expediteOperation();
+    TaskScheduler::TaskHandle mining_task;
+    {
+        QMutexLocker locker( &taskMutex_ );
+        TaskScheduler::instance().cancel( task_ );
+        task = task_;
+
+        miningInterruptRequested_ = true;
+        if ( ! TaskScheduler::instance().cancel( miningTask_ ) )
+            TaskScheduler::instance().expedite( miningTask_ );
+        mining_task = miningTask_;
     }
-    wait();
+    TaskScheduler::instance().wait( task );
+    TaskScheduler::instance().wait( mining_task );
 }
 
-void LogFilteredDataWorkerThread::search( const QRegExp& regExp )
+void LogFilteredDataWorkerThread::search( const QRegExp& regExp,
+        const TimeWindow& timeWindow )
 {
-    QMutexLocker locker( &mutex_ );  // to protect operationRequested_
+    {
+        QMutexLocker locker( &mutex_ );  // to protect operationsRequested_
 
-    LOG(logDEBUG) << "Search requested";
+        LOG(logDEBUG) << "Search requested";
 
-    // If an operation is ongoing, we will block
-    while ( (operationRequested_ != NULL) )
-        nothingToDoCond_.wait( &mutex_ );
+        restart();
+        requestOperation( new FullSearchOperation( sourceLogData_,
+                    regExp, generation_, &termCache_, &tokenIndex_,
+                    &trigramIndex_, timeWindow ) );
+    }
 
-    interruptRequested_ = false;
-    operationRequested_ = new FullSearchOperation( sourceLogData_,
-            regExp, &interruptRequested_ );
-    operationRequestedCond_.wakeAll();
+    // (for the interrupted operation to end at once)
+    expediteOperation();
 }
 
-void LogFilteredDataWorkerThread::updateSearch( const QRegExp& regExp, qint64 position )
+void LogFilteredDataWorkerThread::updateSearch(
+        const std::vector<QRegExp>& patterns, qint64 position,
+        const TimeWindow& timeWindow )
 {
-    QMutexLocker locker( &mutex_ );  // to protect operationRequested_
+    QMutexLocker locker( &mutex_ );  // to protect operationsRequested_
 
     LOG(logDEBUG) << "Search requested";
 
-    // If an operation is ongoing, we will block
-    while ( (operationRequested_ != NULL) )
-        nothingToDoCond_.wait( &mutex_ );
+    // Run after the operations of the search, not interrupting them
+    requestOperation( new UpdateSearchOperation( sourceLogData_,
+                patterns, generation_, position, timeWindow ) );
+}
+
+void LogFilteredDataWorkerThread::refineSearch(
+        const std::vector<QRegExp>& patterns,
+        const MatchSet& candidates, qint64 position,
+        const TimeWindow& timeWindow )
+{
+    {
+        QMutexLocker locker( &mutex_ );  // to protect operationsRequested_
+
+        LOG(logDEBUG) << "Refined search requested";
 
-    interruptRequested_ = false;
-    operationRequested_ = new UpdateSearchOperation( sourceLogData_,
-            regExp, &interruptRequested_, position );
-    operationRequestedCond_.wakeAll();
+        restart();
+        requestOperation( new RefineSearchOperation( sourceLogData_,
+                    patterns, generation_, candidates, position, timeWindow ) );
+    }
+
+    expediteOperation();
 }
 
-void LogFilteredDataWorkerThread::interrupt()
+void LogFilteredDataWorkerThread::query( const SearchQuery& query )
 {
-    LOG(logDEBUG) << "Search interruption requested";
+    {
+        QMutexLocker locker( &mutex_ );  // to protect operationsRequested_
 
-    // No mutex here, setting a bool is probably atomic!
-    interruptRequested_ = true;
+        LOG(logDEBUG) << "Query requested";
 
-    // We wait for the interruption to be done
+        restart();
+        requestOperation( new QuerySearchOperation( sourceLogData_,
+                    query, generation_, &termCache_, &fieldIndex_,
+                    &templateIndex_ ) );
+    }
+
+    expediteOperation();
+}
+
+void LogFilteredDataWorkerThread::cancel()
+{
     {
         QMutexLocker locker( &mutex_ );
-        while ( (operationRequested_ != NULL) )
-            nothingToDoCond_.wait( &mutex_ );
+
+        LOG(logDEBUG) << "Search cancellation requested";
+
+        restart();
     }
+
+    expediteOperation();
+}
+
+void LogFilteredDataWorkerThread::clearTermCache()
+{
+    termCache_.clear();
+    fieldIndex_.clear();
+    templateIndex_.clear();
+    tokenIndex_.clear();
+    trigramIndex_.clear();
+}
+
+void LogFilteredDataWorkerThread::storeTermMatches( const QRegExp& term,
+        const MatchSet& matches, LineNumber nbLines, int maxLength )
+{
+    termCache_.store( term, matches, nbLines, maxLength );
+}
+
+void LogFilteredDataWorkerThread::setIndexedFields( const QStringList& names )
+{
+    fieldIndex_.setFields( names );
+}
+
+void LogFilteredDataWorkerThread::setTokenIndexFile( const QString& fileName )
+{
+    tokenIndex_.setFile( fileName );
 }
 
-// This will do an atomic copy of the object
-void LogFilteredDataWorkerThread::getSearchResult(
-        int* maxLength, SearchResultArray* searchMatches, qint64* nbLinesProcessed )
+void LogFilteredDataWorkerThread::setTrigramIndexEnabled( bool enabled )
 {
-    searchData_.getAll( maxLength, searchMatches, nbLinesProcessed );
+    trigramIndex_.setEnabled( enabled );
 }
 
-// This is the thread's main loop
-void LogFilteredDataWorkerThread::run()
+void LogFilteredDataWorkerThread::mineTemplates()
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    if ( miningSubmitted_ ) {
+        // (the task might be past the lines added)
+        miningRequested_ = true;
+        return;
+    }
+
+    miningSubmitted_ = true;
+    miningTask_ = TaskScheduler::instance().submit( [this] { runMining(); },
+            TaskScheduler::Background );
+}
+
+void LogFilteredDataWorkerThread::interrupt()
 {
+    LOG(logDEBUG) << "Search interruption requested";
+
+    // The operations still end (at once), reporting their progress
+    {
+        QMutexLocker locker( &mutex_ );
+        if ( operationRunning_ != NULL )
+            operationRunning_->interrupt();
+        for ( SearchOperation* operation : operationsRequested_ )
+            operation->interrupt();
+    }
+
+    // (a paused operation would not see it)
+    expediteOperation();
+
+    // The operations not started are run in the calling thread,
+    // not to wait for the tasks of the other files
+    bool cancelled;
+    {
+        QMutexLocker locker( &taskMutex_ );
+        cancelled = TaskScheduler::instance().cancel( task_ );
+    }
+    if ( cancelled )
+        runOperation();
+
+    // We wait for the interruption to be done, the operations checking
+    // for it after each chunk of lines (searched in about 50 ms)
     QMutexLocker locker( &mutex_ );
+    while ( operationRunning_ != NULL || ! operationsRequested_.empty() )
+        nothingToDoCond_.wait( &mutex_ );
+}
 
-    forever {
-        while ( (terminate_ == false) && (operationRequested_ == NULL) )
-            operationRequestedCond_.wait( &mutex_ );
-        LOG(logDEBUG) << "Worker thread signaled";
+void LogFilteredDataWorkerThread::setPriority( TaskScheduler::Priority priority )
+{
+    QMutexLocker locker( &taskMutex_ );  // to protect priority_
 
-        // Look at what needs to be done
-        if ( terminate_ )
-            return;      // We must die
+    priority_ = priority;
+    TaskScheduler::instance().setPriority( task_, priority );
+}
 
-        if ( operationRequested_ ) {
-            connect( operationRequested_, SIGNAL( searchProgressed( int, int ) ),
-                    this, SIGNAL( searchProgressed( int, int ) ) );
+void LogFilteredDataWorkerThread::truncateResults( LineNumber nbLines,
+        LineNumber nbMatches, qint64 lastMatch )
+{
+    searchData_.truncate( nbLines, nbMatches, lastMatch );
+    termCache_.truncate( nbLines );
+    fieldIndex_.truncate( nbLines );
+    templateIndex_.truncate( nbLines );
+    // (only kept for files which do not change)
+    tokenIndex_.clear();
+    trigramIndex_.truncate( nbLines );
+}
 
-            // Run the search operation
-            operationRequested_->start( searchData_ );
+// This will atomically take the changes
+bool LogFilteredDataWorkerThread::takeSearchResult(
+        int* maxLength, SearchResultArray* newMatches, qint64* nbLinesProcessed,
+        std::vector<LineNumber>* deletedMatches )
+{
+    return searchData_.takeAll( maxLength, newMatches, nbLinesProcessed,
+            deletedMatches );
+}
 
-            LOG(logDEBUG) << "... finished copy in workerThread.";
+// Called in the mining task's context
+void LogFilteredDataWorkerThread::runMining()
+{
+    for (;;) {
+        templateIndex_.update( sourceLogData_, sourceLogData_->getNbLine(),
+                &miningInterruptRequested_ );
+        emit templatesMined();
 
-            emit searchFinished();
-            delete operationRequested_;
-            operationRequested_ = NULL;
-            nothingToDoCond_.wakeAll();
+        QMutexLocker locker( &taskMutex_ );
+        if ( ! miningRequested_ || miningInterruptRequested_ ) {
+            miningSubmitted_ = false;
+            return;
         }
+        miningRequested_ = false;
+    }
+}
+
+void LogFilteredDataWorkerThread::expediteOperation()
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    TaskScheduler::instance().expedite( task_ );
+}
+
+void LogFilteredDataWorkerThread::restart()
+{
+    dropOperations();
+
+    generation_++;
+    searchData_.restart( generation_ );
+}
+
+void LogFilteredDataWorkerThread::dropOperations()
+{
+    if ( operationRunning_ != NULL )
+        operationRunning_->interrupt();
+
+    for ( SearchOperation* operation : operationsRequested_ )
+        delete operation;
+    operationsRequested_.clear();
+}
+
+void LogFilteredDataWorkerThread::requestOperation( SearchOperation* operation )
+{
+    operationsRequested_.push_back( operation );
+
+    // (the task submitted runs it after the ones before)
+    if ( ! taskSubmitted_ ) {
+        taskSubmitted_ = true;
+        submitOperation();
     }
 }
 
+void LogFilteredDataWorkerThread::submitOperation()
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    task_ = TaskScheduler::instance().submit(
+            [this] { runOperation(); }, priority_ );
+}
+
+void LogFilteredDataWorkerThread::runOperation()
+{
+    QMutexLocker locker( &mutex_ );
+
+    while ( ! operationsRequested_.empty() && ! terminate_ ) {
+        operationRunning_ = operationsRequested_.front();
+        operationsRequested_.pop_front();
+
+        // The next operations can be requested meanwhile
+        locker.unlock();
+        doOperation( operationRunning_ );
+        locker.relock();
+
+        delete operationRunning_;
+        operationRunning_ = NULL;
+        nothingToDoCond_.wakeAll();
+    }
+
+    taskSubmitted_ = false;
+}
+
+void LogFilteredDataWorkerThread::doOperation( SearchOperation* operation )
+{
+    connect( operation, SIGNAL( searchProgressed( qint64, int, int ) ),
+            this, SIGNAL( searchProgressed( qint64, int, int ) ) );
+
+    // Run the search operation
+    operation->start( searchData_ );
+
+    LOG(logDEBUG) << "... finished copy in workerThread.";
+
+    emit searchFinished();
+}
+
 //
 // Operations implementation
 //
 
-SearchOperation::SearchOperation( const LogData* sourceLogData,
-        const QRegExp& regExp, bool* interruptRequest )
-    : regexp_( regExp ), sourceLogData_( sourceLogData )
+SearchOperation::SearchOperation( const AbstractLogData* sourceLogData,
+        const std::vector<QRegExp>& patterns, int generation,
+        const TimeWindow& timeWindow )
+    : interruptRequested_( false ), generation_( generation ),
+    patterns_( patterns ), matcher_( patterns ), buffers_(),
+    sourceLogData_( sourceLogData ), timeWindow_( timeWindow ),
+    matches_(), maxLength_( 0 ), skipIndex_(), skipQuery_()
 {
-    interruptRequested_ = interruptRequest;
 }
 
-void SearchOperation::doSearch( SearchData& searchData, qint64 initialLine )
+qint64 SearchOperation::doSearch( SearchData& searchData, qint64 initialLine )
 {
+    const TraceSpan span( "SearchOperation::doSearch", "search" );
     const qint64 nbSourceLines = sourceLogData_->getNbLine();
+    const int nbThreads = TaskScheduler::instance().maxThreads();
+
+    // Only the lines of the time window are searched
+    qint64 endLine = nbSourceLines;
+    if ( ! timeWindow_.isWhole() )
+        timeWindow_.restrictLines( sourceLogData_, &initialLine, &endLine );
+
+    LOG(logDEBUG) << "Searching from line " << initialLine << " to " << endLine;
+
+    // A line matches all the patterns, so has all their keys
+    skipIndex_ = sourceLogData_->getSkipIndex();
+    skipQuery_.clear();
+    if ( skipIndex_ ) {
+        for ( const QRegExp& pattern : patterns_ ) {
+            const SkipIndex::Query query = SkipIndex::query( pattern );
+            skipQuery_.insert( skipQuery_.end(), query.begin(), query.end() );
+        }
+    }
+
+    SearchChunker chunker( initialLine, endLine,
+            [this]( qint64 first, qint64 end )
+            { return sourceLogData_->getLinesSize( first, end ); } );
+
+    qint64 first, end;
+    if ( nbThreads > 1 && chunker.chunk( 1, &first, &end ) )
+        doParallelSearch( searchData, &chunker, initialLine, endLine, nbThreads );
+    else
+        doSerialSearch( searchData, &chunker, initialLine, endLine );
+
+    return nbSourceLines;
+}
+
+void SearchOperation::doSerialSearch( SearchData& searchData,
+        SearchChunker* chunker, qint64 initialLine, qint64 nbSourceLines )
+{
     int maxLength = 0;
-    int nbMatches = searchData.getNbMatches();
+    LineNumber nbMatches = searchData.getNbMatches();
     SearchResultArray currentList = SearchResultArray();
 
-    // Ensure no re-alloc will be done
-    currentList.reserve( nbLinesInChunk );
+    qint64 first, end;
+    for ( qint64 chunk = 0; chunker->chunk( chunk, &first, &end ); chunk++ ) {
+        TaskScheduler::instance().yield();
+        if ( interruptRequested_ )
+            break;
 
-    LOG(logDEBUG) << "Searching from line " << initialLine << " to " << nbSourceLines;
+        const int percentage = ( first - initialLine ) * 100 / ( nbSourceLines - initialLine );
+        emit searchProgressed( nbMatches, percentage, generation_ );
 
-    for ( qint64 i = initialLine; i < nbSourceLines; i += nbLinesInChunk ) {
-        if ( *interruptRequested_ )
+        // The next chunk is read from the disk while this one is searched
+        qint64 next_first, next_end;
+        if ( chunker->chunk( chunk + 1, &next_first, &next_end ) )
+            sourceLogData_->prefetchLines( next_first, next_end );
+        searchChunk( chunker, first, end, &currentList, &maxLength );
+        sourceLogData_->releaseScannedLines( first, end );
+        // (the chunk might not have been searched to its end)
+        if ( interruptRequested_ )
             break;
+        nbMatches += currentList.size();
 
-        const int percentage = ( i - initialLine ) * 100 / ( nbSourceLines - initialLine );
-        emit searchProgressed( nbMatches, percentage );
-
-        const QStringList lines = sourceLogData_->getLines( i,
-                qMin( nbLinesInChunk, (int) ( nbSourceLines - i ) ) );
-        LOG(logDEBUG) << "Chunk starting at " << i <<
-            ", " << lines.size() << " lines read.";
-
-        int j = 0;
-        for ( ; j < lines.size(); j++ ) {
-            if ( regexp_.indexIn( lines[j] ) != -1 ) {
-                // FIXME: increase perf by removing temporary
-                const int length = sourceLogData_->getExpandedLineString(i+j).length();
-                if ( length > maxLength )
-                    maxLength = length;
-                currentList.push_back( MatchingLine( i+j ) );
-                nbMatches++;
+        // After each block, hand the data over to the shared data
+        // and update the client
+        addMatches( searchData, maxLength, std::move( currentList ), end );
+    }
+
+    emit searchProgressed( nbMatches, 100, generation_ );
+}
+
+namespace {
+
+// A chunk of results handed from a searching thread to the
+// coordinating one.
+struct SearchHandoff {
+    SearchHandoff() : mutex(), cond(), full( false ), matches(), maxLength( 0 ) {}
+
+    QMutex mutex;
+    QWaitCondition cond;
+    bool full;
+    SearchResultArray matches;
+    int maxLength;
+};
+
+}
+
+// Chunk k is searched by thread (k % nbThreads). Results are collected
+// in order by the current thread so the filtered view is still populated
+// from the top, each searching thread waiting for its previous result to
+// be consumed before delivering the next one.
+// (the threads without a chunk end at once)
+void SearchOperation::doParallelSearch( SearchData& searchData,
+        SearchChunker* chunker, qint64 initialLine, qint64 nbSourceLines,
+        int nbThreads )
+{
+    LOG(logDEBUG) << "Parallel search using " << nbThreads << " threads";
+
+    std::vector<SearchHandoff> handoffs( nbThreads );
+    // Set when the coordinating thread stops collecting results
+    std::atomic<bool> stop( false );
+
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < nbThreads; t++ ) {
+        threads.emplace_back( [&, t] () {
+            SearchResultArray matches;
+            SearchHandoff& handoff = handoffs[t];
+
+            qint64 first, end;
+            for ( qint64 chunk = t; chunker->chunk( chunk, &first, &end );
+                    chunk += nbThreads ) {
+                int maxLength = 0;
+
+                // An interrupted search still delivers (empty) results
+                // so nobody waits for them forever.
+                if ( ! interruptRequested_ && ! stop ) {
+                    // (the next chunk of this thread)
+                    qint64 next_first, next_end;
+                    if ( chunker->chunk( chunk + nbThreads, &next_first, &next_end ) )
+                        sourceLogData_->prefetchLines( next_first, next_end );
+                    searchChunk( chunker, first, end, &matches, &maxLength );
+                    sourceLogData_->releaseScannedLines( first, end );
+                }
+
+                QMutexLocker locker( &handoff.mutex );
+                while ( handoff.full && ! stop )
+                    handoff.cond.wait( &handoff.mutex );
+                if ( stop )
+                    return;
+
+                handoff.matches.swap( matches );
+                handoff.maxLength = maxLength;
+                handoff.full = true;
+                handoff.cond.wakeAll();
+
+                matches.clear();
             }
+        } );
+    }
+
+    int maxLength = 0;
+    LineNumber nbMatches = searchData.getNbMatches();
+    SearchResultArray currentList = SearchResultArray();
+
+    qint64 first, end;
+    for ( qint64 chunk = 0; chunker->chunk( chunk, &first, &end ); chunk++ ) {
+        // (the searching threads stop a chunk ahead of it)
+        TaskScheduler::instance().yield();
+        if ( interruptRequested_ )
+            break;
+
+        const int percentage = ( first - initialLine ) * 100 / ( nbSourceLines - initialLine );
+        emit searchProgressed( nbMatches, percentage, generation_ );
+
+        SearchHandoff& handoff = handoffs[chunk % nbThreads];
+        {
+            QMutexLocker locker( &handoff.mutex );
+            while ( ! handoff.full )
+                handoff.cond.wait( &handoff.mutex );
+
+            currentList.swap( handoff.matches );
+            maxLength = qMax( maxLength, handoff.maxLength );
+            handoff.full = false;
+            handoff.cond.wakeAll();
         }
 
-        // After each block, copy the data to shared data
-        // and update the client
-        searchData.addAll( maxLength, currentList, i+j );
-        currentList.clear();
+        if ( interruptRequested_ )
+            break;
+
+        nbMatches += currentList.size();
+        addMatches( searchData, maxLength, std::move( currentList ), end );
+    }
+
+    // Release the threads still waiting for their results to be taken
+    stop = true;
+    for ( SearchHandoff& handoff : handoffs ) {
+        QMutexLocker locker( &handoff.mutex );
+        handoff.cond.wakeAll();
+    }
+    for ( std::thread& thread : threads )
+        thread.join();
+
+    emit searchProgressed( nbMatches, 100, generation_ );
+}
+
+void SearchOperation::addMatches( SearchData& searchData, int maxLength,
+        SearchResultArray&& matches, LineNumber nbLinesProcessed )
+{
+    for ( const MatchingLine& match : matches )
+        matches_.append( match.lineNumber() );
+    maxLength_ = qMax( maxLength_, maxLength );
+
+    searchData.addAll( generation_, maxLength, std::move( matches ),
+            nbLinesProcessed );
+}
+
+void SearchOperation::addMatchSet( SearchData& searchData, int maxLength,
+        const MatchSet& matches, LineNumber nbLinesProcessed )
+{
+    SearchResultArray currentList;
+    currentList.reserve( qMin<LineNumber>( matches.size(), nbLinesInChunk ) );
+    for ( LineNumber line : matches ) {
+        currentList.push_back( MatchingLine( line ) );
+        if ( currentList.size() == (size_t) nbLinesInChunk )
+            searchData.addAll( generation_, maxLength,
+                    std::move( currentList ), line + 1 );
+    }
+    searchData.addAll( generation_, maxLength, std::move( currentList ),
+            nbLinesProcessed );
+}
+
+bool SearchOperation::searchCandidates( SearchData& searchData,
+        const PatternSetMatcher& matcher, const MatchSet& candidates,
+        qint64 endOfCandidates )
+{
+    int maxLength = 0;
+    LineNumber nbMatches = searchData.getNbMatches();
+    LineNumber nbCandidatesDone = 0;
+    SearchResultArray currentList;
+    PatternSetMatcher::Buffers buffers;
+
+    // Lines are read by runs of consecutive candidates
+    MatchSet::const_iterator i = candidates.begin();
+    while ( i != candidates.end() && *i < endOfCandidates ) {
+        if ( interruptRequested_ )
+            break;
+
+        const LineNumber first = *i;
+        int nbLines = 0;
+        while ( i != candidates.end() && *i < endOfCandidates
+                && *i == first + nbLines && nbLines < nbLinesInChunk ) {
+            ++nbLines;
+            ++i;
+        }
+
+        matcher.matchLines( sourceLogData_, first, nbLines,
+                &buffers, &maxLength );
+        const QBitArray& bits = buffers.matches.front();
+        for ( int j = 0; j < bits.size(); j++ ) {
+            if ( bits.testBit( j ) )
+                currentList.push_back( MatchingLine( first + j ) );
+        }
+
+        // Hand the matches over every chunk worth of lines
+        const LineNumber previousChunk = nbCandidatesDone / nbLinesInChunk;
+        nbCandidatesDone += nbLines;
+        if ( nbCandidatesDone / nbLinesInChunk != previousChunk ) {
+            nbMatches += currentList.size();
+            addMatches( searchData, maxLength, std::move( currentList ),
+                    first + nbLines );
+            emit searchProgressed( nbMatches,
+                    (qint64) nbCandidatesDone * 100 / candidates.size(),
+                    generation_ );
+        }
+    }
+
+    if ( interruptRequested_ ) {
+        emit searchProgressed( nbMatches, 100, generation_ );
+        return false;
+    }
+
+    addMatches( searchData, maxLength, std::move( currentList ),
+            endOfCandidates );
+
+    return true;
+}
+
+int SearchOperation::maxLengthOf( const MatchSet& lines ) const
+{
+    int maxLength = 0;
+
+    // Nothing to read if the lengths are recorded
+    if ( sourceLogData_->hasLineLengths() ) {
+        for ( LineNumber line : lines )
+            maxLength = qMax( maxLength, sourceLogData_->getLineLength( line ) );
+
+        return maxLength;
+    }
+
+    // Read the lines by chunks, from the first line to the last one
+    // of the passed lines in each chunk.
+    MatchSet::const_iterator i = lines.begin();
+    while ( i != lines.end() ) {
+        const LineNumber first = *i;
+        std::vector<LineNumber> chunkLines;
+        while ( i != lines.end() && *i - first < (LineNumber) nbLinesInChunk ) {
+            chunkLines.push_back( *i );
+            ++i;
+        }
+
+        std::vector<int> lineEnds;
+        const QByteArray blob = sourceLogData_->getRawLines( first,
+                chunkLines.back() - first + 1, &lineEnds );
+        for ( LineNumber line : chunkLines ) {
+            const int j = line - first;
+            if ( j >= (int) lineEnds.size() )
+                break;
+            const int beginning = ( j == 0 ) ? 0 : lineEnds[j-1] + 1;
+            maxLength = qMax( maxLength, AbstractLogData::expandedLength(
+                        blob.constData() + beginning, lineEnds[j] - beginning ) );
+        }
     }
 
-    emit searchProgressed( nbMatches, 100 );
+    return maxLength;
+}
+
+// Called from the searching threads, only uses its own data
+// (the source data being thread safe).
+void SearchOperation::searchLines( qint64 firstLine, int nbLines,
+        SearchResultArray* matches, int* maxLength ) const
+{
+    const PerfTimer timer( PerfCounters::SearchChunkLatency );
+
+    std::vector<std::pair<qint64, qint64>> ranges;
+    if ( skipIndex_ && ! skipQuery_.empty() )
+        skipIndex_->linesToSearch( skipQuery_, firstLine, firstLine + nbLines,
+                &ranges );
+    else
+        ranges.push_back( { firstLine, firstLine + nbLines } );
+
+    const BufferPool<PatternSetMatcher::Buffers>::Lease buffers =
+        buffers_.acquire();
+    const std::vector<QBitArray>& lineMatches = buffers->matches;
+    for ( const auto& range : ranges ) {
+        // (the ranges left once interrupted are not searched)
+        if ( interruptRequested_ )
+            return;
+
+        matcher_.matchLines( sourceLogData_, range.first,
+                range.second - range.first, buffers.get(), maxLength );
+
+        QBitArray bits = lineMatches.front();
+        for ( size_t p = 1; p < lineMatches.size(); p++ )
+            bits &= lineMatches[p];
+
+        for ( int j = 0; j < bits.size(); j++ ) {
+            if ( bits.testBit( j ) )
+                matches->push_back( MatchingLine( range.first + j ) );
+        }
+    }
+}
+
+// Called from the searching threads
+void SearchOperation::searchChunk( SearchChunker* chunker, qint64 firstLine,
+        qint64 endLine, SearchResultArray* matches, int* maxLength ) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    searchLines( firstLine, endLine - firstLine, matches, maxLength );
+
+    chunker->searched( endLine - firstLine,
+            sourceLogData_->getLinesSize( firstLine, endLine ),
+            timer.nsecsElapsed() );
 }
 
 // Called in the worker thread's context
 void FullSearchOperation::start( SearchData& searchData )
 {
     // Clear the shared data
-    searchData.clear();
+    searchData.clear( generation_ );
+
+    // If this pattern has been searched for before, its matches are
+    // handed over at once and only the lines added since are searched.
+    // (the cache only holds the matches in whole files)
+    qint64 initialLine = 0;
+    LineNumber nbLinesCached;
+    int maxLength;
+    if ( timeWindow_.isWhole() )
+        takeFusedMatches();
+    if ( timeWindow_.isWhole()
+            && termCache_->find( patterns_.front(), &matches_, &nbLinesCached, &maxLength )
+            && nbLinesCached <= sourceLogData_->getNbLine() ) {
+        LOG(logDEBUG) << "Reusing the matches in " << nbLinesCached << " lines";
+
+        if ( nbLinesCached >= 1 ) {
+            // The last line might have been updated
+            // (if it was not LF-terminated)
+            initialLine = nbLinesCached - 1;
+            if ( ! matches_.empty() && matches_.last() == initialLine )
+                matches_.removeLast();
+        }
+
+        if ( maxLength < 0 )
+            maxLength = maxLengthOf( matches_ );
+        maxLength_ = maxLength;
 
-    doSearch( searchData, 0 );
+        addMatchSet( searchData, maxLength, matches_, initialLine );
+    }
+    else {
+        matches_.clear();
+
+        if ( timeWindow_.isWhole()
+                && ( tokenIndex_->isEnabled() || trigramIndex_->isEnabled() ) )
+            initialLine = searchIndexedLines( searchData );
+    }
+
+    const qint64 nbLinesSearched = doSearch( searchData, initialLine );
+
+    // Keep the matches for the next searches using this pattern
+    if ( ! interruptRequested_ && timeWindow_.isWhole() )
+        termCache_->store( patterns_.front(), matches_, nbLinesSearched, maxLength_ );
+}
+
+void FullSearchOperation::takeFusedMatches()
+{
+    // The matches found while the source was indexed are kept as if
+    // the pattern had been searched for, unless it has been since
+    const std::shared_ptr<const FusedSearch> fused =
+        sourceLogData_->getFusedSearch();
+    MatchSet matches;
+    LineNumber nbLines, nbLinesCached;
+    int maxLength;
+    if ( fused && fused->find( patterns_.front(), &matches, &nbLines, &maxLength )
+            && nbLines <= sourceLogData_->getNbLine()
+            && ! termCache_->find( patterns_.front(), &matches_, &nbLinesCached ) ) {
+        LOG(logDEBUG) << "Taking the matches found while indexing "
+            << nbLines << " lines";
+        termCache_->store( patterns_.front(), matches, nbLines, maxLength );
+    }
+}
+
+qint64 FullSearchOperation::searchIndexedLines( SearchData& searchData )
+{
+    const qint64 nbSourceLines = sourceLogData_->getNbLine();
+    tokenIndex_->update( sourceLogData_, nbSourceLines, &interruptRequested_ );
+    trigramIndex_->update( sourceLogData_, nbSourceLines, &interruptRequested_ );
+    if ( interruptRequested_ )
+        return 0;
+
+    // The tokens are more selective than the trigrams
+    MatchSet candidates;
+    qint64 nbLinesIndexed;
+    if ( tokenIndex_->isEnabled()
+            && tokenIndex_->candidates( patterns_.front(), &candidates ) )
+        nbLinesIndexed = tokenIndex_->nbLines();
+    else if ( trigramIndex_->isEnabled()
+            && trigramIndex_->candidates( patterns_.front(), &candidates ) )
+        nbLinesIndexed = trigramIndex_->nbLines();
+    else
+        return 0;
+
+    LOG(logDEBUG) << "Searching " << candidates.size()
+        << " lines having the tokens, out of " << nbLinesIndexed;
+
+    searchCandidates( searchData, matcher_, candidates, nbLinesIndexed );
+
+    return nbLinesIndexed;
 }
 
 // Called in the worker thread's context
 void UpdateSearchOperation::start( SearchData& searchData )
 {
-    qint64 initial_line = initialPosition_;
+    // The operations run since it was requested might have searched
+    // further than the position the client knew
+    qint64 initial_line = qMax<qint64>( initialPosition_,
+            searchData.getNbLinesProcessed() );
 
     if ( initial_line >= 1 ) {
         // We need to re-search the last line because it might have
         // been updated (if it was not LF-terminated)
         --initial_line;
         // In case the last line matched, we don't want it to match twice.
-        searchData.deleteMatch( initial_line );
+        searchData.deleteMatch( generation_, initial_line );
     }
 
     doSearch( searchData, initial_line );
 }
+
+// Called in the worker thread's context
+void RefineSearchOperation::start( SearchData& searchData )
+{
+    // Clear the shared data
+    searchData.clear( generation_ );
+
+    // The last line searched before might have been updated
+    // (if it was not LF-terminated), it is searched again below.
+    const qint64 endOfCandidates = qMax<qint64>( initialPosition_ - 1, 0 );
+
+    LOG(logDEBUG) << "Searching " << candidates_.size()
+        << " candidate lines before line " << endOfCandidates;
+
+    // Only the last pattern needs to be matched
+    const PatternSetMatcher matcher(
+            std::vector<QRegExp>( 1, patterns_.back() ) );
+
+    if ( ! searchCandidates( searchData, matcher, candidates_, endOfCandidates ) )
+        return;
+
+    // The rest of the file is searched for all the patterns
+    doSearch( searchData, endOfCandidates );
+}
+
+// Called in the worker thread's context
+void QuerySearchOperation::start( SearchData& searchData )
+{
+    // Clear the shared data
+    searchData.clear( generation_ );
+
+    const std::vector<QRegExp>& terms = query_.terms();
+    const qint64 nbSourceLines = sourceLogData_->getNbLine();
+
+    // The terms on a field indexed or a template are answered from
+    // the indexes, the others (the regular expressions) from the text
+    // of the lines.
+    std::vector<int> termFields( terms.size() );
+    std::vector<QString> fieldValues( terms.size() );
+    std::vector<int> termTemplates( terms.size(), -1 );
+    std::vector<QRegExp> regExps;
+    std::vector<size_t> regExpTerms;
+    bool fieldTerms = false;
+    bool templateTerms = false;
+    for ( size_t t = 0; t < terms.size(); t++ ) {
+        termFields[t] = fieldIndex_->fieldOfTerm( terms[t], &fieldValues[t] );
+        if ( termFields[t] >= 0 ) {
+            fieldTerms = true;
+        }
+        else if ( TemplateIndex::templateOfTerm( terms[t], &termTemplates[t] ) ) {
+            templateTerms = true;
+        }
+        else {
+            termTemplates[t] = -1;
+            regExps.push_back( terms[t] );
+            regExpTerms.push_back( t );
+        }
+    }
+
+    if ( fieldTerms )
+        fieldIndex_->update( sourceLogData_, nbSourceLines, &interruptRequested_ );
+    if ( templateTerms )
+        templateIndex_->update( sourceLogData_, nbSourceLines, &interruptRequested_ );
+    if ( interruptRequested_ ) {
+        emit searchProgressed( 0, 100, generation_ );
+        return;
+    }
+
+    // Get what we know of each term, the (possibly empty) part of the
+    // file not searched yet for it is searched below.
+    std::vector<MatchSet> termMatches( terms.size() );
+    std::vector<qint64> searchFrom( terms.size(), nbSourceLines );
+    qint64 initialLine = nbSourceLines;
+    for ( size_t t = 0; t < terms.size(); t++ ) {
+        if ( termFields[t] >= 0 ) {
+            termMatches[t] = fieldIndex_->find( termFields[t], fieldValues[t],
+                    terms[t].caseSensitivity(), nbSourceLines );
+            continue;
+        }
+        if ( termTemplates[t] >= 0 ) {
+            termMatches[t] = templateIndex_->find( termTemplates[t], nbSourceLines );
+            continue;
+        }
+
+        LineNumber nbLines;
+        searchFrom[t] = 0;
+        if ( termCache_->find( terms[t], &termMatches[t], &nbLines )
+                && nbLines <= nbSourceLines ) {
+            if ( nbLines >= 1 ) {
+                // The last line might have been updated
+                // (if it was not LF-terminated)
+                searchFrom[t] = nbLines - 1;
+                if ( ! termMatches[t].empty()
+                        && termMatches[t].last() == searchFrom[t] )
+                    termMatches[t].removeLast();
+            }
+        }
+        else {
+            termMatches[t].clear();
+        }
+        initialLine = qMin( initialLine, searchFrom[t] );
+    }
+
+    LOG(logDEBUG) << "Query searching " << regExps.size()
+        << " terms from line " << initialLine;
+
+    // Search for all the regular expressions in one pass
+    const PatternSetMatcher matcher( regExps );
+    PatternSetMatcher::Buffers buffers;
+    SearchChunker chunker( initialLine, nbSourceLines,
+            [this]( qint64 first, qint64 end )
+            { return sourceLogData_->getLinesSize( first, end ); } );
+    qint64 i, end;
+    for ( qint64 chunk = 0; chunker.chunk( chunk, &i, &end ); chunk++ ) {
+        if ( interruptRequested_ ) {
+            emit searchProgressed( 0, 100, generation_ );
+            return;
+        }
+
+        const int percentage = ( i - initialLine ) * 100 / ( nbSourceLines - initialLine );
+        emit searchProgressed( 0, percentage, generation_ );
+
+        QElapsedTimer timer;
+        timer.start();
+        int maxLength = 0;
+        matcher.matchLines( sourceLogData_, i, end - i, &buffers, &maxLength );
+        const std::vector<QBitArray>& lineMatches = buffers.matches;
+        chunker.searched( end - i, sourceLogData_->getLinesSize( i, end ),
+                timer.nsecsElapsed() );
+
+        for ( size_t r = 0; r < regExps.size(); r++ ) {
+            const size_t t = regExpTerms[r];
+            const QBitArray& bits = lineMatches[r];
+            for ( int j = qMax<qint64>( searchFrom[t] - i, 0 ); j < bits.size(); j++ ) {
+                if ( bits.testBit( j ) )
+                    termMatches[t].append( i + j );
+            }
+        }
+    }
+
+    for ( size_t t : regExpTerms )
+        termCache_->store( terms[t], termMatches[t], nbSourceLines );
+
+    const MatchSet result = query_.evaluate( termMatches, nbSourceLines );
+    const int maxLength = maxLengthOf( result );
+
+    addMatchSet( searchData, maxLength, result, nbSourceLines );
+
+    emit searchProgressed( result.size(), 100, generation_ );
+}
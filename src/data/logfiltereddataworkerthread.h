@@ -21,16 +21,29 @@
 #define LOGFILTEREDDATAWORKERTHREAD_H
 
 #include <QObject>
-#include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QRegExp>
 #include <QList>
 
-class LogData;
-
-// Line number are unsigned 32 bits for now.
-typedef uint32_t LineNumber;
+#include <atomic>
+#include <limits>
+#include <list>
+#include <memory>
+
+#include "patternsetmatcher.h"
+#include "bufferpool.h"
+#include "fieldindex.h"
+#include "templateindex.h"
+#include "tokenindex.h"
+#include "trigramindex.h"
+#include "skipindex.h"
+#include "matchset.h"
+#include "searchquery.h"
+#include "taskscheduler.h"
+#include "searchchunker.h"
+
+class AbstractLogData;
 
 // Class encapsulating a single matching line
 // Contains the line number the line was found in and its content.
@@ -50,80 +63,260 @@ class MatchingLine {
 // a fixed "in-place" array (vector) is probably fine.
 typedef std::vector<MatchingLine> SearchResultArray;
 
+// The times (as timestamps) between which the lines are searched,
+// both included.
+// The whole source is searched if its timestamps are not known.
+struct TimeWindow {
+    // All the lines
+    TimeWindow() : start( std::numeric_limits<qint64>::min() ),
+        end( std::numeric_limits<qint64>::max() ) {}
+    TimeWindow( qint64 start_time, qint64 end_time )
+        : start( start_time ), end( end_time ) {}
+
+    bool isWhole() const { return start == std::numeric_limits<qint64>::min()
+        && end == std::numeric_limits<qint64>::max(); }
+
+    // Restricts the lines [*firstLine, *endLine) of the source to the
+    // ones in the window (found with AbstractLogData::getLineAtTime)
+    void restrictLines( const AbstractLogData* source,
+            qint64* firstLine, qint64* endLine ) const;
+
+    qint64 start;
+    qint64 end;
+};
+
 // This class is a mutex protected set of search result data.
+// Only the changes since the client last took the results are kept,
+// so each update costs in proportion to the new matches, the client
+// keeping the whole list.
+// The data are changed by the operations of the current generation
+// only (see restart()), those of an abandoned search being ignored.
 // It is thread safe.
 class SearchData
 {
   public:
-    SearchData() : dataMutex_(), matches_(), maxLength_(0) { }
-
-    // Atomically get all the search data
-    void getAll( int* length, SearchResultArray* matches,
-            qint64* nbLinesProcessed ) const;
-    // Atomically set all the search data
-    // (overwriting the existing)
-    // (the matches are always moved)
-    void setAll( int length, SearchResultArray&& matches );
-    // Atomically add to all the existing search data.
-    void addAll( int length, const SearchResultArray& matches, LineNumber nbLinesProcessed );
+    SearchData() : dataMutex_(), generation_(0), newMatches_(),
+        deletedMatches_(), lastTakenMatch_(-1), reset_(false),
+        nbMatches_(0), maxLength_(0), nbLinesProcessed_(0) { }
+
+    // Atomically take the search data: the max length, the number of
+    // lines processed, the matches found since the last call (moved out)
+    // and the lines whose match found before the last call must be
+    // removed (to be done before adding the new ones).
+    // Returns true if the new matches replace all the previous ones.
+    bool takeAll( int* length, SearchResultArray* newMatches,
+            qint64* nbLinesProcessed, std::vector<LineNumber>* deletedMatches );
+    // Atomically add to all the existing search data, the matches
+    // being moved in (matches is left empty).
+    void addAll( int generation, int length,
+            SearchResultArray&& matches, LineNumber nbLinesProcessed );
     // Get the number of matches
     LineNumber getNbMatches() const;
+    // Get the number of lines processed
+    LineNumber getNbLinesProcessed() const;
     // Delete the match for the passed line (if it exist)
-    void deleteMatch( LineNumber line );
+    void deleteMatch( int generation, LineNumber line );
     // Atomically clear the data.
-    void clear();
+    void clear( int generation );
+    // Atomically clear the data and only accept the changes of the
+    // operations of the passed generation from now on.
+    void restart( int generation );
+    // Atomically forget the matches not taken and set the data as if
+    // the nbLines first lines had been searched, the client having kept
+    // nbMatches matches, the last one being on lastMatch (-1 if none).
+    void truncate( LineNumber nbLines, LineNumber nbMatches, qint64 lastMatch );
 
   private:
     mutable QMutex dataMutex_;
 
-    SearchResultArray matches_;
+    // Generation of the operations changing the data
+    int generation_;
+    // Matches not taken yet
+    SearchResultArray newMatches_;
+    // Lines of the matches taken already that have been deleted
+    std::vector<LineNumber> deletedMatches_;
+    // Line of the last match taken (-1 if none)
+    qint64 lastTakenMatch_;
+    // Whether the data have been cleared since last taken
+    bool reset_;
+    // Total number of matches (taken or not)
+    LineNumber nbMatches_;
     int maxLength_;
     LineNumber nbLinesProcessed_;
 };
 
+// The matches of the patterns searched for over the whole file, kept
+// so a search run again, or a boolean query (see SearchQuery), only
+// searches for the patterns, or the part of the file, not searched yet.
+// A pattern is identified by its text, syntax and case sensitivity.
+// The least recently used patterns are dropped beyond maxTerms or
+// once the matches kept take more than maxSize bytes.
+// It is thread safe.
+class TermResultCache
+{
+  public:
+    TermResultCache() : mutex_(), entries_() {}
+
+    // Get the matches of the passed term, the number of lines they have
+    // been searched for in and their max length (-1 if not known),
+    // returns false if the term has not been searched for.
+    bool find( const QRegExp& term, MatchSet* matches, LineNumber* nbLines,
+            int* maxLength = nullptr );
+    // Store the matches of the passed term in the first nbLines lines
+    void store( const QRegExp& term, const MatchSet& matches,
+            LineNumber nbLines, int maxLength = -1 );
+    // Forget all the terms (the file has changed)
+    void clear();
+    // Forget the matches from the passed line on (the end of the file
+    // has changed)
+    void truncate( LineNumber nbLines );
+    // Approximate memory used by the matches, in bytes
+    size_t allocatedSize() const;
+
+  private:
+    static const int maxTerms;
+    static const size_t maxSize;
+
+    struct Entry {
+        QRegExp term;
+        MatchSet matches;
+        LineNumber nbLines;
+        int maxLength;
+    };
+
+    mutable QMutex mutex_;
+    // Most recently used first
+    std::list<Entry> entries_;
+};
+
+// A search operation, run once, tagged with the generation of the
+// search it belongs to (a new search starting a new generation).
+// It can be interrupted from any thread, stopping at the end of the
+// chunk of lines being searched (see SearchChunker).
 class SearchOperation : public QObject
 {
   Q_OBJECT
   public:
-    SearchOperation( const LogData* sourceLogData,
-            const QRegExp& regExp, bool* interruptRequest );
+    SearchOperation( const AbstractLogData* sourceLogData,
+            const std::vector<QRegExp>& patterns, int generation,
+            const TimeWindow& timeWindow = TimeWindow() );
 
     virtual ~SearchOperation() { }
 
     // Start the search operation, returns true if it has been done
     // and false if it has been cancelled (results not copied)
     virtual void start( SearchData& result ) = 0;
+    // Have the operation stop as soon as possible
+    void interrupt() { interruptRequested_ = true; }
 
   signals:
-    void searchProgressed( int percent, int nbMatches );
+    void searchProgressed( qint64 nbMatches, int percent, int generation );
 
   protected:
     static const int nbLinesInChunk;
 
     // Implement the common part of the search, passing
     // the shared results and the line to begin the search from.
-    void doSearch( SearchData& result, qint64 initialLine );
+    // The lines are read by chunks of about the same size in bytes
+    // (see SearchChunker).
+    // The search is spread over several threads if possible, and
+    // restricted to the lines in the time window, the blocks of lines
+    // the skip index of the source tells cannot match being skipped.
+    // The matches are also added to matches_.
+    // Returns the number of lines in the file when the search started.
+    qint64 doSearch( SearchData& result, qint64 initialLine );
+
+    // Search the passed lines for the lines matching all the patterns,
+    // adding them to the array and updating the max length
+    // (see PatternSetMatcher).
+    void searchLines( qint64 firstLine, int nbLines,
+            SearchResultArray* matches, int* maxLength ) const;
+    // Idem for the lines of a chunk, reporting the time it took
+    // to the chunker
+    void searchChunk( SearchChunker* chunker, qint64 firstLine,
+            qint64 endLine, SearchResultArray* matches, int* maxLength ) const;
+    // Search the candidate lines before endOfCandidates for the
+    // lines matching the matcher's (only) pattern, adding them to
+    // the shared results.
+    // Returns false if interrupted.
+    bool searchCandidates( SearchData& result, const PatternSetMatcher& matcher,
+            const MatchSet& candidates, qint64 endOfCandidates );
+
+    // Add all the passed matches to the shared results, by chunks
+    void addMatchSet( SearchData& result, int maxLength,
+            const MatchSet& matches, LineNumber nbLinesProcessed );
+    // Returns the max expanded length of the passed lines
+    int maxLengthOf( const MatchSet& lines ) const;
+
+    std::atomic<bool> interruptRequested_;
+    const int generation_;
+    const std::vector<QRegExp> patterns_;
+    const PatternSetMatcher matcher_;
+    // The buffers the searching threads read and match the lines in,
+    // reused from one chunk to the next
+    mutable BufferPool<PatternSetMatcher::Buffers> buffers_;
+    const AbstractLogData* sourceLogData_;
+    const TimeWindow timeWindow_;
+    // All the matches found by doSearch() and their max length
+    MatchSet matches_;
+    int maxLength_;
+    // Set by doSearch(): the skip index of the source (null if none)
+    // and the keys the matches must have
+    std::shared_ptr<const SkipIndex> skipIndex_;
+    SkipIndex::Query skipQuery_;
 
-    bool* interruptRequested_;
-    const QRegExp regexp_;
-    const LogData* sourceLogData_;
+  private:
+    void doSerialSearch( SearchData& result, SearchChunker* chunker,
+            qint64 initialLine, qint64 nbSourceLines );
+    void doParallelSearch( SearchData& result, SearchChunker* chunker,
+            qint64 initialLine, qint64 nbSourceLines, int nbThreads );
+    // Hand the passed matches over to the shared results (matches is
+    // left empty), also adding them to matches_
+    void addMatches( SearchData& result, int maxLength,
+            SearchResultArray&& matches, LineNumber nbLinesProcessed );
 };
 
+// Search the whole file (or time window), reusing the matches of the
+// previous search for the same pattern if there is one (whole files only).
+// If the tokens or the trigrams of the file are indexed, only the
+// lines having the tokens (or the blocks having the trigrams) required
+// by the pattern are searched (whole files only).
 class FullSearchOperation : public SearchOperation
 {
   public:
-    FullSearchOperation( const LogData* sourceLogData, const QRegExp& regExp,
-            bool* interruptRequest )
-        : SearchOperation( sourceLogData, regExp, interruptRequest ) {}
+    FullSearchOperation( const AbstractLogData* sourceLogData, const QRegExp& regExp,
+            int generation, TermResultCache* termCache,
+            TokenIndex* tokenIndex, TrigramIndex* trigramIndex,
+            const TimeWindow& timeWindow )
+        : SearchOperation( sourceLogData, std::vector<QRegExp>( 1, regExp ),
+                generation, timeWindow ), termCache_( termCache ),
+        tokenIndex_( tokenIndex ), trigramIndex_( trigramIndex ) {}
     virtual void start( SearchData& result );
+
+  private:
+    // Store the matches of the search run while the source was indexed
+    // in the term cache (see FusedSearch)
+    void takeFusedMatches();
+    // Search the candidate lines given by the indexes, returns the
+    // first line not indexed (0 if no index can be used).
+    qint64 searchIndexedLines( SearchData& result );
+
+    TermResultCache* termCache_;
+    TokenIndex* tokenIndex_;
+    TrigramIndex* trigramIndex_;
 };
 
+// Search for the lines matching all the patterns from the passed
+// position (or the end of the lines processed by the operations run
+// before it), adding to the current results.
 class UpdateSearchOperation : public SearchOperation
 {
   public:
-    UpdateSearchOperation( const LogData* sourceLogData, const QRegExp& regExp,
-            bool* interruptRequest, qint64 position )
-        : SearchOperation( sourceLogData, regExp, interruptRequest ),
+    UpdateSearchOperation( const AbstractLogData* sourceLogData,
+            const std::vector<QRegExp>& patterns,
+            int generation, qint64 position,
+            const TimeWindow& timeWindow )
+        : SearchOperation( sourceLogData, patterns, generation, timeWindow ),
         initialPosition_( position ) {}
     virtual void start( SearchData& result );
 
@@ -131,57 +324,204 @@ class UpdateSearchOperation : public SearchOperation
     qint64 initialPosition_;
 };
 
-// Create and manage the thread doing loading/indexing for
-// the creating LogData. One LogDataWorkerThread is used
-// per LogData instance.
-// Note everything except the run() function is in the LogData's
+// Search for the last pattern only in the candidate lines (the matches
+// of the other patterns in the lines before the passed position), then
+// for the lines matching all the patterns from this position.
+class RefineSearchOperation : public SearchOperation
+{
+  public:
+    RefineSearchOperation( const AbstractLogData* sourceLogData,
+            const std::vector<QRegExp>& patterns, int generation,
+            const MatchSet& candidates, qint64 position,
+            const TimeWindow& timeWindow )
+        : SearchOperation( sourceLogData, patterns, generation, timeWindow ),
+        candidates_( candidates ), initialPosition_( position ) {}
+    virtual void start( SearchData& result );
+
+  private:
+    const MatchSet candidates_;
+    qint64 initialPosition_;
+};
+
+// Evaluate a boolean query from the cached matches of its terms,
+// searching (all together) only for the terms and lines missing
+// from the cache.
+class QuerySearchOperation : public SearchOperation
+{
+  public:
+    QuerySearchOperation( const AbstractLogData* sourceLogData, const SearchQuery& query,
+            int generation, TermResultCache* termCache,
+            FieldIndex* fieldIndex, TemplateIndex* templateIndex )
+        : SearchOperation( sourceLogData, query.terms(), generation ),
+        query_( query ), termCache_( termCache ), fieldIndex_( fieldIndex ),
+        templateIndex_( templateIndex ) {}
+    virtual void start( SearchData& result );
+
+  private:
+    const SearchQuery query_;
+    TermResultCache* termCache_;
+    // The terms on a field indexed are answered from it
+    FieldIndex* fieldIndex_;
+    // and the terms on a template (template=<number>) from this one
+    TemplateIndex* templateIndex_;
+};
+
+// Runs the search operations of the creating LogFilteredData, one at
+// a time, in a task of the TaskScheduler. One LogFilteredDataWorkerThread
+// is used per LogFilteredData instance.
+// Starting a search does not wait for the operation running: it is
+// interrupted and the new one queued, the results and progress of the
+// old one being dropped (they belong to an older generation).
+// Note everything except runOperation() is in the LogFilteredData's
 // thread.
-class LogFilteredDataWorkerThread : public QThread
+class LogFilteredDataWorkerThread : public QObject
 {
   Q_OBJECT
 
   public:
-    LogFilteredDataWorkerThread( const LogData* sourceLogData );
+    LogFilteredDataWorkerThread( const AbstractLogData* sourceLogData );
     ~LogFilteredDataWorkerThread();
 
-    // Start the search with the passed regexp
-    void search( const QRegExp& regExp );
+    // Start the search with the passed regexp, in the lines of the
+    // time window, abandoning the current one.
+    void search( const QRegExp& regExp,
+            const TimeWindow& timeWindow = TimeWindow() );
     // Continue the previous search starting at the passed position
-    // in the source file (line number)
-    void updateSearch( const QRegExp& regExp, qint64 position );
-    // Interrupts the search if one is in progress
+    // in the source file (line number), the lines having to match
+    // all the passed patterns, once its operations are done.
+    void updateSearch( const std::vector<QRegExp>& patterns, qint64 position,
+            const TimeWindow& timeWindow = TimeWindow() );
+    // Start the search for the lines matching all the passed patterns,
+    // looking for the last one only in the candidate lines before the
+    // passed position (see RefineSearchOperation).
+    void refineSearch( const std::vector<QRegExp>& patterns,
+            const MatchSet& candidates, qint64 position,
+            const TimeWindow& timeWindow = TimeWindow() );
+    // Start the evaluation of the passed boolean query
+    void query( const SearchQuery& query );
+    // Abandon the current search without waiting for it (its results
+    // being dropped)
+    void cancel();
+    // Returns the generation of the current search, the one of the
+    // progress reported by searchProgressed()
+    int generation() const { return generation_; }
+    // Forget the matches kept for the queries, to be called when
+    // the file has changed other than by lines being added.
+    void clearTermCache();
+    // Keep the passed matches of the term in the first nbLines lines,
+    // found before (e.g. restored with the session), as if searched for
+    void storeTermMatches( const QRegExp& term, const MatchSet& matches,
+            LineNumber nbLines, int maxLength );
+    // Approximate memory used by the matches kept, in bytes
+    size_t termCacheSize() const { return termCache_.allocatedSize(); }
+    // Sets the fields whose values are indexed, for the query terms
+    // written field=value (see FieldIndex)
+    void setIndexedFields( const QStringList& names );
+    // Sets the (static) file whose tokens are indexed for the searches
+    // (see TokenIndex), an empty name disabling the index
+    void setTokenIndexFile( const QString& fileName );
+    // Enables the index of the trigrams of the source for the
+    // searches (see TrigramIndex)
+    void setTrigramIndexEnabled( bool enabled );
+    // Mine the templates of the lines of the source not mined yet in
+    // a task of background priority, sending templatesMined() when
+    // done (see TemplateIndex). Mining again if already running.
+    void mineTemplates();
+    // Returns the templates having the most lines mined so far
+    std::vector<TemplateIndex::Summary> topTemplates( int number ) const
+    { return templateIndex_.topTemplates( number ); }
+    // Interrupts the search if one is in progress, the results found
+    // so far being kept, and waits for its operation to stop.
     void interrupt();
-
-    // Returns a copy of the current indexing data
-    void getSearchResult( int* maxLength, SearchResultArray* searchMatches,
-           qint64* nbLinesProcessed );
+    // Sets the priority of the search operations (Visible when the
+    // file is displayed)
+    void setPriority( TaskScheduler::Priority priority );
+    // Forget the matches from the passed line on, the file having been
+    // truncated there (see SearchData::truncate), to be called once
+    // the search has been interrupted and its results taken.
+    void truncateResults( LineNumber nbLines, LineNumber nbMatches,
+            qint64 lastMatch );
+
+    // Returns the changes to the search results since the last call
+    // (see SearchData::takeAll)
+    bool takeSearchResult( int* maxLength, SearchResultArray* newMatches,
+           qint64* nbLinesProcessed, std::vector<LineNumber>* deletedMatches );
 
   signals:
     // Sent during the indexing process to signal progress
-    // percent being the percentage of completion.
-    void searchProgressed( int percent, int nbMatches );
+    // percent being the percentage of completion, for the search of
+    // the passed generation.
+    void searchProgressed( qint64 nbMatches, int percent, int generation );
     // Sent when indexing is finished, signals the client
     // to copy the new data back.
     void searchFinished();
-
-  protected:
-    void run();
+    // Sent when the templates of the lines have been mined
+    // (from the mining task)
+    void templatesMined();
 
   private:
-    const LogData* sourceLogData_;
-
-    // Mutex to protect operationRequested_ and friends
+    // Start a new generation, interrupting the operation running and
+    // dropping the ones requested (with mutex_ held)
+    void restart();
+    // Interrupt the operation running and drop the ones requested
+    // (with mutex_ held)
+    void dropOperations();
+    // Queue the passed operation, to be run once the ones requested
+    // before are done (with mutex_ held)
+    void requestOperation( SearchOperation* operation );
+    // Have the scheduler run the operations requested
+    // (with mutex_ held)
+    void submitOperation();
+    // Resume the operation running if paused by the scheduler,
+    // before waiting for it (without mutex_ held)
+    void expediteOperation();
+    // The task running the operations requested
+    void runOperation();
+    // Run the passed operation (without mutex_ held)
+    void doOperation( SearchOperation* operation );
+    // The task mining the templates
+    void runMining();
+
+    const AbstractLogData* sourceLogData_;
+
+    // Mutex to protect operationsRequested_ and friends
+    // (not held while an operation runs)
     QMutex mutex_;
-    QWaitCondition operationRequestedCond_;
     QWaitCondition nothingToDoCond_;
 
-    // Set when the thread must die
+    // Set when the object is being destroyed
     bool terminate_;
-    bool interruptRequested_;
-    SearchOperation* operationRequested_;
+    // Generation of the current search
+    int generation_;
+    // Operations waiting to be run, in order, and the one running
+    std::list<SearchOperation*> operationsRequested_;
+    SearchOperation* operationRunning_;
+    // Whether a task runs the operations requested
+    bool taskSubmitted_;
+    // The task running the operations and its priority, also
+    // protected by taskMutex_
+    QMutex taskMutex_;
+    TaskScheduler::TaskHandle task_;
+    TaskScheduler::Priority priority_;
+    // The task mining the templates, whether it is queued or running
+    // and has to mine again once done, also protected by taskMutex_
+    TaskScheduler::TaskHandle miningTask_;
+    bool miningSubmitted_;
+    bool miningRequested_;
+    std::atomic<bool> miningInterruptRequested_;
 
     // Shared indexing data
     SearchData searchData_;
+    // Matches of the terms searched for
+    TermResultCache termCache_;
+    // Values of the fields indexed
+    FieldIndex fieldIndex_;
+    // Templates of the lines (mined on demand)
+    TemplateIndex templateIndex_;
+    // Tokens of the lines of the source
+    TokenIndex tokenIndex_;
+    // Trigrams of the blocks of lines of the source
+    TrigramIndex trigramIndex_;
 };
 
 #endif
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements MatchesExporter.
+
+#include "log.h"
+
+#include <QFile>
+
+#include "abstractlogdata.h"
+#include "matchesexporter.h"
+
+const int MatchesExporter::writtenBlockSize = 1024 * 1024;
+const int MatchesExporter::linesPerRead = 10000;
+
+MatchesExporter::MatchesExporter( const AbstractLogData* source,
+        const MatchSet& lines, const QString& fileName )
+    : QObject(), source_( source ), lines_( lines ), fileName_( fileName ),
+    interruptRequested_( false ), taskMutex_(), task_()
+{
+}
+
+MatchesExporter::~MatchesExporter()
+{
+    interrupt();
+}
+
+void MatchesExporter::start( TaskScheduler::Priority priority )
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    task_ = TaskScheduler::instance().submit( [this] { run(); }, priority );
+}
+
+void MatchesExporter::interrupt()
+{
+    TaskScheduler::TaskHandle task;
+    bool cancelled;
+    {
+        QMutexLocker locker( &taskMutex_ );
+
+        interruptRequested_ = true;
+        cancelled = TaskScheduler::instance().cancel( task_ );
+        if ( ! cancelled )
+            TaskScheduler::instance().expedite( task_ );
+        task = task_;
+    }
+
+    if ( cancelled )
+        emit exportFinished( false );
+    else
+        TaskScheduler::instance().wait( task );
+}
+
+void MatchesExporter::setPriority( TaskScheduler::Priority priority )
+{
+    QMutexLocker locker( &taskMutex_ );
+
+    TaskScheduler::instance().setPriority( task_, priority );
+}
+
+void MatchesExporter::run()
+{
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG(logERROR) << "Cannot open " << fileName_.toStdString()
+            << " to export the matches";
+        emit exportFinished( false );
+        return;
+    }
+
+    QByteArray block;
+    block.reserve( writtenBlockSize + 64 * 1024 );
+    std::vector<int> lineEnds;
+    LineNumber nbLinesWritten = 0;
+    int lastPercent = 0;
+    bool success = true;
+
+    auto line = lines_.begin();
+    while ( success && line != lines_.end() ) {
+        // The run of consecutive lines starting at this one
+        const LineNumber first = *line;
+        int number = 0;
+        do {
+            ++line;
+            ++number;
+        } while ( line != lines_.end() && *line == first + number
+                && number < linesPerRead );
+
+        const QByteArray data = source_->getRawLines( first, number, &lineEnds );
+        if ( lineEnds.size() != static_cast<size_t>( number ) ) {
+            // The file has been truncated since
+            LOG(logWARNING) << "Lines " << first << " to " << first + number
+                << " cannot be read to export the matches";
+            success = false;
+            break;
+        }
+        // With the LF between the lines, the last one's being added
+        // (it might be the last line of the file, without one)
+        block.append( data.constData(), lineEnds.back() );
+        block.append( '\n' );
+        nbLinesWritten += number;
+
+        if ( block.size() >= writtenBlockSize ) {
+            success = ( file.write( block ) == block.size() );
+            block.clear();
+
+            const int percent = nbLinesWritten * 100 / lines_.size();
+            if ( percent > lastPercent ) {
+                emit exportProgressed( percent );
+                lastPercent = percent;
+            }
+
+            TaskScheduler::instance().yield();
+            if ( interruptRequested_ )
+                success = false;
+        }
+    }
+
+    if ( success && ! block.isEmpty() )
+        success = ( file.write( block ) == block.size() );
+    if ( success )
+        success = file.flush();
+
+    if ( ! success )
+        LOG(logERROR) << "Export of the matches to " << fileName_.toStdString()
+            << " not completed";
+    else
+        emit exportProgressed( 100 );
+
+    emit exportFinished( success );
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHESEXPORTER_H
+#define MATCHESEXPORTER_H
+
+#include <atomic>
+
+#include <QObject>
+#include <QMutex>
+#include <QString>
+
+#include "matchset.h"
+#include "taskscheduler.h"
+
+class AbstractLogData;
+
+// Writes the passed lines of a source (the matches of a search) to a
+// file, as a task of the TaskScheduler.
+// The lines are read undecoded (see AbstractLogData::getRawLines), each
+// run of consecutive lines at once, and written by large blocks, so
+// neither the lines nor the file are ever held in memory.
+class MatchesExporter : public QObject
+{
+  Q_OBJECT
+
+  public:
+    MatchesExporter( const AbstractLogData* source, const MatchSet& lines,
+            const QString& fileName );
+    // Interrupts the export if it is running (the file being left
+    // incomplete)
+    ~MatchesExporter();
+
+    // Start writing the file
+    void start( TaskScheduler::Priority priority );
+    // Stop writing the file, waiting for the task to end
+    void interrupt();
+    // Sets the priority of the export task
+    void setPriority( TaskScheduler::Priority priority );
+
+  signals:
+    // Sent while the file is written, with the percentage of the
+    // lines written
+    void exportProgressed( int percent );
+    // Sent at the end, success being false if the file cannot be
+    // written or the export has been interrupted
+    void exportFinished( bool success );
+
+  private:
+    // Size of the blocks written
+    static const int writtenBlockSize;
+    // Most lines read at once
+    static const int linesPerRead;
+
+    // Run in the task
+    void run();
+
+    const AbstractLogData* const source_;
+    const MatchSet lines_;
+    const QString fileName_;
+    std::atomic<bool> interruptRequested_;
+
+    // Protects task_
+    QMutex taskMutex_;
+    TaskScheduler::TaskHandle task_;
+};
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements MatchEstimator.
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <QElapsedTimer>
+
+#include "log.h"
+
+#include "abstractlogdata.h"
+#include "patternsetmatcher.h"
+#include "matchestimator.h"
+
+const qint64 MatchEstimator::sampleBudget = 30;
+const int MatchEstimator::linesInBlock = 256;
+const int MatchEstimator::maxBlocks = 256;
+
+MatchEstimator::MatchEstimator( const AbstractLogData* source )
+    : QObject(), source_( source ), terminate_( false ), epoch_( 0 ),
+    mutex_(), regexp_(), task_(), taskSubmitted_( false )
+{
+}
+
+MatchEstimator::~MatchEstimator()
+{
+    terminate_ = true;
+    epoch_++;
+
+    TaskScheduler::TaskHandle task;
+    {
+        QMutexLocker locker( &mutex_ );
+        task = task_;
+    }
+
+    if ( task && ! TaskScheduler::instance().cancel( task ) ) {
+        TaskScheduler::instance().expedite( task );
+        TaskScheduler::instance().wait( task );
+    }
+}
+
+void MatchEstimator::estimate( const QRegExp& regexp )
+{
+    QMutexLocker locker( &mutex_ );
+
+    regexp_ = regexp;
+    epoch_++;
+
+    // (the task running takes the new regexp once done)
+    if ( ! taskSubmitted_ ) {
+        taskSubmitted_ = true;
+        task_ = TaskScheduler::instance().submit( [this] { run(); },
+                TaskScheduler::Visible );
+    }
+}
+
+void MatchEstimator::cancel()
+{
+    QMutexLocker locker( &mutex_ );
+
+    regexp_ = QRegExp();
+    epoch_++;
+}
+
+QString MatchEstimator::describe( qint64 nbMatches, qint64 nbLinesSampled,
+        qint64 nbLines, qint64 searchTime )
+{
+    const QString time = ( searchTime < 1000 ) ?
+        tr( "less than a second" ) :
+        ( searchTime < 120000 ) ?
+        tr( "%1 s" ).arg( ( searchTime + 500 ) / 1000 ) :
+        tr( "%1 min" ).arg( ( searchTime + 30000 ) / 60000 );
+
+    if ( nbLinesSampled >= nbLines )
+        return tr( "%1 matching line%2 (not searched yet)." )
+            .arg( nbMatches ).arg( nbMatches > 1 ? "s" : "" );
+    else if ( nbMatches == 0 )
+        return tr( "No match in the %1 lines sampled, searching the file "
+                "takes about %2." ).arg( nbLinesSampled ).arg( time );
+    else
+        return tr( "About %1 matching lines (%2%), searching the file "
+                "takes about %3." ).arg( nbMatches )
+            .arg( 100.0 * nbMatches / nbLines, 0, 'g', 2 ).arg( time );
+}
+
+void MatchEstimator::run()
+{
+    QMutexLocker locker( &mutex_ );
+
+    while ( ! terminate_ && ! regexp_.isEmpty() ) {
+        const QRegExp regexp = regexp_;
+        const int epoch = epoch_;
+        regexp_ = QRegExp();
+
+        // Match without holding the lock
+        locker.unlock();
+
+        const qint64 nb_lines = source_->getNbLine();
+        const qint64 nb_blocks = std::min<qint64>( maxBlocks,
+                ( nb_lines + linesInBlock - 1 ) / linesInBlock );
+
+        // A block drawn in each slice, the slices being matched in
+        // random order so the blocks matched within the budget are
+        // spread over the whole source
+        std::mt19937_64 random( epoch );
+        std::vector<qint64> slices( nb_blocks );
+        std::iota( slices.begin(), slices.end(), 0 );
+        std::shuffle( slices.begin(), slices.end(), random );
+
+        const PatternSetMatcher matcher( std::vector<QRegExp>( 1, regexp ) );
+        PatternSetMatcher::Buffers buffers;
+        qint64 nb_sampled = 0;
+        qint64 nb_matched = 0;
+        QElapsedTimer timer;
+        timer.start();
+
+        for ( qint64 slice : slices ) {
+            if ( epoch != epoch_ || timer.elapsed() >= sampleBudget )
+                break;
+
+            const qint64 slice_start = slice * nb_lines / nb_blocks;
+            const qint64 slice_end = ( slice + 1 ) * nb_lines / nb_blocks;
+            const int nb_block_lines =
+                std::min<qint64>( linesInBlock, slice_end - slice_start );
+            const qint64 first_line = slice_start +
+                std::uniform_int_distribution<qint64>(
+                        0, slice_end - slice_start - nb_block_lines )( random );
+
+            int max_length = 0;
+            matcher.matchLines( source_, first_line, nb_block_lines,
+                    &buffers, &max_length );
+            nb_sampled += buffers.lineEnds.size();
+            nb_matched += buffers.matches[0].count( true );
+        }
+
+        const qint64 elapsed = std::max<qint64>( timer.elapsed(), 1 );
+
+        // The search matches the lines on all the threads of the
+        // TaskScheduler (reading them sequentially, which makes the
+        // time projected from the blocks read at random an upper bound)
+        const qint64 nb_matches = ( nb_sampled > 0 ) ?
+            nb_matched * nb_lines / nb_sampled : 0;
+        const qint64 search_time = ( nb_sampled > 0 ) ?
+            double( elapsed ) * nb_lines / nb_sampled
+            / TaskScheduler::instance().maxThreads() : 0;
+
+        LOG(logDEBUG) << "MatchEstimator: " << nb_matched << " matches in "
+            << nb_sampled << " lines sampled in " << elapsed << " ms";
+
+        locker.relock();
+
+        // Not sent if another estimate has been requested meanwhile
+        if ( epoch == epoch_ && nb_sampled > 0 )
+            emit estimated( regexp, nb_matches, nb_sampled, search_time );
+    }
+
+    taskSubmitted_ = false;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHESTIMATOR_H
+#define MATCHESTIMATOR_H
+
+#include <atomic>
+#include <memory>
+
+#include <QObject>
+#include <QMutex>
+#include <QRegExp>
+#include <QString>
+
+#include "taskscheduler.h"
+
+class AbstractLogData;
+class PatternSetMatcher;
+
+// Estimates how many lines of a source a pattern matches, and how long
+// searching all of them would take, from blocks of lines drawn at random
+// (one in each of as many equal slices of the source, in random order),
+// so the user knows it before running the search on a big file.
+// The blocks are matched as a task of the TaskScheduler for at most
+// sampleBudget, the estimate being sent with estimated(). A source
+// small enough is matched entirely, the count being exact.
+// All public functions are called from the GUI thread.
+class MatchEstimator : public QObject
+{
+  Q_OBJECT
+
+  public:
+    MatchEstimator( const AbstractLogData* source );
+    // Interrupts the estimate if it is running
+    ~MatchEstimator();
+
+    // Estimate the matches of the regexp, the estimate in progress if
+    // any being abandoned (not sent)
+    void estimate( const QRegExp& regexp );
+    // Abandon the estimate in progress if any
+    void cancel();
+
+    // Returns the text telling the user an estimate of a source of
+    // nbLines lines (as sent with estimated())
+    static QString describe( qint64 nbMatches, qint64 nbLinesSampled,
+            qint64 nbLines, qint64 searchTime );
+
+    // Time spent matching the blocks of an estimate (in ms)
+    static const qint64 sampleBudget;
+    // Number of lines in a block, and most blocks matched
+    static const int linesInBlock;
+    static const int maxBlocks;
+
+  signals:
+    // Sent when the blocks of regexp have been matched, nbMatches being
+    // the estimated number of lines of the source matching it (exact
+    // if nbLinesSampled is the number of lines of the source) and
+    // searchTime the time a search of the source would take (in ms)
+    void estimated( const QRegExp& regexp, qint64 nbMatches,
+            qint64 nbLinesSampled, qint64 searchTime );
+
+  private:
+    // Run in the task
+    void run();
+
+    const AbstractLogData* const source_;
+
+    // Set to end the task, read without the mutex while matching
+    std::atomic<bool> terminate_;
+    // Changed by each estimate requested or cancelled, so the blocks
+    // of the previous one stop being matched
+    std::atomic<int> epoch_;
+
+    // Protects everything below
+    QMutex mutex_;
+
+    // The regexp to estimate next (empty if none)
+    QRegExp regexp_;
+
+    TaskScheduler::TaskHandle task_;
+    bool taskSubmitted_;
+};
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements MatchHistogram
+
+#include "matchhistogram.h"
+
+#include "abstractlogdata.h"
+
+MatchHistogram::MatchHistogram()
+    : byTime_( false ), nbBuckets_( 0 ), nbLines_( 0 ), bucketSize_( 1 ),
+    startTime_( 0 ), boundaries_(), counts_(), maxCount_( 0 )
+{
+}
+
+void MatchHistogram::update( const AbstractLogData& source,
+        const MatchSet& matches, int nbBuckets )
+{
+    const qint64 nb_lines = source.getNbLine();
+    nbBuckets = qMax( nbBuckets, 1 );
+    if ( nb_lines < nbLines_ || nbBuckets != nbBuckets_ )
+        reset();
+    nbBuckets_ = nbBuckets;
+
+    qint64 first_time, last_time;
+    int nb_buckets;
+    if ( source.getTimeRange( &first_time, &last_time )
+            && last_time >= first_time ) {
+        // The periods are widened when the times go past the last one
+        if ( ! byTime_ || first_time < startTime_
+                || last_time >= startTime( nbBuckets_ ) )
+            setPeriods( first_time, last_time );
+
+        // The boundaries not found in the lines known before might be
+        // in the new ones
+        while ( ! boundaries_.empty() && boundaries_.back() >= nbLines_ )
+            boundaries_.pop_back();
+        while ( int( boundaries_.size() ) < nbBuckets_ - 1 ) {
+            const qint64 line = source.getLineAtTime(
+                    startTime( int( boundaries_.size() ) + 1 ) );
+            boundaries_.push_back( line );
+            if ( line >= nb_lines )
+                break;
+        }
+
+        nb_buckets = qMin<qint64>( nbBuckets_,
+                ( last_time - startTime_ ) / bucketSize_ + 1 );
+    }
+    else {
+        // Powers of two, for the buckets to be merged by pairs as
+        // the file grows
+        byTime_ = false;
+        boundaries_.clear();
+        bucketSize_ = 1;
+        while ( bucketSize_ * nbBuckets_ < nb_lines )
+            bucketSize_ *= 2;
+
+        nb_buckets = ( nb_lines + bucketSize_ - 1 ) / bucketSize_;
+    }
+    nbLines_ = nb_lines;
+
+    counts_.assign( nb_buckets, 0 );
+    maxCount_ = 0;
+    qint64 matches_before = 0;
+    for ( int bucket = 0; bucket < nb_buckets; bucket++ ) {
+        const qint64 matches_after = matches.rank( endLine( bucket ) );
+        counts_[ bucket ] = matches_after - matches_before;
+        maxCount_ = qMax( maxCount_, counts_[ bucket ] );
+        matches_before = matches_after;
+    }
+}
+
+void MatchHistogram::reset()
+{
+    byTime_     = false;
+    nbBuckets_  = 0;
+    nbLines_    = 0;
+    bucketSize_ = 1;
+    startTime_  = 0;
+    boundaries_.clear();
+    counts_.clear();
+    maxCount_   = 0;
+}
+
+qint64 MatchHistogram::firstLine( int bucket ) const
+{
+    if ( bucket == 0 )
+        return 0;
+    else if ( ! byTime_ )
+        return qMin( bucket * bucketSize_, nbLines_ );
+    else if ( bucket - 1 < int( boundaries_.size() ) )
+        return qMin( boundaries_[ bucket - 1 ], nbLines_ );
+    else
+        return nbLines_;
+}
+
+qint64 MatchHistogram::endLine( int bucket ) const
+{
+    return ( bucket + 1 < size() ) ? firstLine( bucket + 1 ) : nbLines_;
+}
+
+void MatchHistogram::setPeriods( qint64 firstTime, qint64 lastTime )
+{
+    byTime_ = true;
+    boundaries_.clear();
+
+    // The periods start at a multiple of their duration (whole minutes...)
+    bucketSize_ = roundDuration( ( lastTime - firstTime ) / nbBuckets_ + 1 );
+    for (;;) {
+        startTime_ = firstTime
+            - ( firstTime % bucketSize_ + bucketSize_ ) % bucketSize_;
+        if ( lastTime < startTime( nbBuckets_ ) )
+            break;
+        bucketSize_ = roundDuration( bucketSize_ + 1 );
+    }
+}
+
+// The durations are round ones when the timestamps are milliseconds
+// (as the ones read with a format are).
+qint64 MatchHistogram::roundDuration( qint64 duration )
+{
+    static const qint64 durations[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500,
+        1000, 2000, 5000, 10000, 15000, 30000,
+        60000, 120000, 300000, 600000, 900000, 1800000,
+        3600000, 7200000, 10800000, 21600000, 43200000, 86400000 };
+
+    for ( qint64 round : durations ) {
+        if ( round >= duration )
+            return round;
+    }
+
+    qint64 round = 86400000;
+    while ( round < duration )
+        round *= 2;
+
+    return round;
+}
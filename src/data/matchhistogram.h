@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHHISTOGRAM_H
+#define MATCHHISTOGRAM_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+#include "matchset.h"
+
+class AbstractLogData;
+
+// The number of matches in consecutive buckets of the lines of a file:
+// periods of the same duration when the timestamps of the lines are
+// known (see AbstractLogData::getTimeRange), else ranges of the same
+// number of lines.
+// The counts are taken from the ranks of the MatchSet, so nothing is
+// added to the search. The buckets are kept while the file grows, only
+// the boundaries not found yet being searched for (see update()).
+//
+// This class is NOT thread-safe.
+class MatchHistogram
+{
+  public:
+    MatchHistogram();
+
+    // Fit the buckets (at most nbBuckets) to the lines of the source and
+    // count the passed matches of it in them.
+    void update( const AbstractLogData& source, const MatchSet& matches,
+            int nbBuckets );
+    // Forget the buckets, to be called when the lines of the source
+    // have changed other than by lines being added.
+    void reset();
+
+    // Whether the buckets are periods of time (else ranges of lines)
+    bool isByTime() const { return byTime_; }
+    // Number of buckets
+    int size() const { return counts_.size(); }
+    // Number of matches in the bucket
+    qint64 count( int bucket ) const { return counts_[ bucket ]; }
+    // Number of matches in the fullest bucket
+    qint64 maxCount() const { return maxCount_; }
+    // The lines of the bucket, from first to end (excluded)
+    qint64 firstLine( int bucket ) const;
+    qint64 endLine( int bucket ) const;
+    // The time the bucket starts at (if the buckets are periods)
+    qint64 startTime( int bucket ) const
+    { return startTime_ + bucket * bucketSize_; }
+    // Duration or number of lines of a bucket
+    qint64 bucketSize() const { return bucketSize_; }
+
+  private:
+    bool byTime_;
+    int nbBuckets_;
+    qint64 nbLines_;
+    qint64 bucketSize_;
+    qint64 startTime_;
+    // First line of the buckets after the first one, as far as they
+    // have been found (the last one can be the end of the lines)
+    std::vector<qint64> boundaries_;
+    std::vector<qint64> counts_;
+    qint64 maxCount_;
+
+    // Sets the periods for the times passed
+    void setPeriods( qint64 firstTime, qint64 lastTime );
+    // Returns the smallest round duration at least the passed one
+    static qint64 roundDuration( qint64 duration );
+};
+
+#endif
@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements MatchSet
+
+#include <algorithm>
+#include <cassert>
+
+#include "matchset.h"
+
+#if defined( _MSC_VER )
+#  include <intrin.h>
+static inline int bitCount( uint64_t word )
+{
+    return static_cast<int>( __popcnt64( word ) );
+}
+static inline int lowestBitSet( uint64_t word )
+{
+    unsigned long index;
+    _BitScanForward64( &index, word );
+    return static_cast<int>( index );
+}
+static inline int highestBitSet( uint64_t word )
+{
+    unsigned long index;
+    _BitScanReverse64( &index, word );
+    return static_cast<int>( index );
+}
+#else
+static inline int bitCount( uint64_t word )
+{
+    return __builtin_popcountll( word );
+}
+static inline int lowestBitSet( uint64_t word )
+{
+    return __builtin_ctzll( word );
+}
+static inline int highestBitSet( uint64_t word )
+{
+    return 63 - __builtin_clzll( word );
+}
+#endif
+
+// Beyond 4096 lines, a bitmap is smaller than the array
+const int MatchSet::maxArraySize = 4096;
+
+MatchSet::MatchSet() : containers_(), rankBefore_(), size_( 0 )
+{
+}
+
+void MatchSet::append( LineNumber line )
+{
+    assert( empty() || line > last() );
+
+    const size_t key = line / linesPerContainer;
+    const uint16_t offset = line % linesPerContainer;
+
+    while ( containers_.size() <= key ) {
+        containers_.push_back( Container() );
+        rankBefore_.push_back( size_ );
+    }
+
+    Container& container = containers_.back();
+    if ( container.isBitmap() ) {
+        startBlock( container, offset, container.cardinality );
+        container.bitmap[ offset / 64 ] |= uint64_t( 1 ) << ( offset % 64 );
+    }
+    else {
+        container.array.push_back( offset );
+
+        // Too many lines, convert to a bitmap
+        if ( container.array.size() > (size_t) maxArraySize ) {
+            container.bitmap.assign( wordsPerBitmap, 0 );
+            uint32_t rank = 0;
+            for ( uint16_t o : container.array ) {
+                startBlock( container, o, rank++ );
+                container.bitmap[ o / 64 ] |= uint64_t( 1 ) << ( o % 64 );
+            }
+            std::vector<uint16_t>().swap( container.array );
+        }
+    }
+
+    container.cardinality++;
+    size_++;
+}
+
+void MatchSet::startBlock( Container& container, uint16_t offset,
+        uint32_t rank )
+{
+    const size_t block = offset / 64 / wordsPerBlock;
+    while ( container.blockRanks.size() <= block )
+        container.blockRanks.push_back( rank );
+}
+
+void MatchSet::removeLast()
+{
+    assert( ! empty() );
+
+    Container& container = containers_.back();
+    if ( container.isBitmap() ) {
+        for ( int i = wordsPerBitmap - 1; i >= 0; i-- ) {
+            if ( container.bitmap[i] ) {
+                container.bitmap[i] &=
+                    ~( uint64_t( 1 ) << highestBitSet( container.bitmap[i] ) );
+                break;
+            }
+        }
+    }
+    else {
+        container.array.pop_back();
+    }
+
+    container.cardinality--;
+    size_--;
+
+    // Forget the blocks left empty at the end
+    while ( ! container.blockRanks.empty()
+            && container.blockRanks.back() == container.cardinality )
+        container.blockRanks.pop_back();
+
+    // The last container is never empty
+    while ( ! containers_.empty() && containers_.back().cardinality == 0 ) {
+        containers_.pop_back();
+        rankBefore_.pop_back();
+    }
+}
+
+LineNumber MatchSet::last() const
+{
+    assert( ! empty() );
+
+    const Container& container = containers_.back();
+    const LineNumber base = ( containers_.size() - 1 ) * linesPerContainer;
+
+    if ( container.isBitmap() ) {
+        for ( int i = wordsPerBitmap - 1; i >= 0; i-- ) {
+            if ( container.bitmap[i] )
+                return base + i * 64 + highestBitSet( container.bitmap[i] );
+        }
+    }
+    else {
+        return base + container.array.back();
+    }
+
+    return 0;
+}
+
+void MatchSet::clear()
+{
+    containers_.clear();
+    rankBefore_.clear();
+    size_ = 0;
+}
+
+bool MatchSet::contains( LineNumber line ) const
+{
+    const size_t key = line / linesPerContainer;
+    const uint16_t offset = line % linesPerContainer;
+
+    if ( key >= containers_.size() )
+        return false;
+
+    const Container& container = containers_[key];
+    if ( container.isBitmap() )
+        return container.bitmap[ offset / 64 ] & ( uint64_t( 1 ) << ( offset % 64 ) );
+    else
+        return std::binary_search( container.array.begin(),
+                container.array.end(), offset );
+}
+
+LineNumber MatchSet::rank( LineNumber line ) const
+{
+    const size_t key = line / linesPerContainer;
+    const uint16_t offset = line % linesPerContainer;
+
+    if ( key >= containers_.size() )
+        return size_;
+
+    const Container& container = containers_[key];
+    LineNumber rank = rankBefore_[key];
+
+    if ( container.isBitmap() ) {
+        const size_t block = offset / 64 / wordsPerBlock;
+        if ( block >= container.blockRanks.size() )
+            return rank + container.cardinality;
+
+        rank += container.blockRanks[block];
+        for ( int i = block * wordsPerBlock; i < offset / 64; i++ )
+            rank += bitCount( container.bitmap[i] );
+        if ( offset % 64 )
+            rank += bitCount( container.bitmap[ offset / 64 ]
+                    & ( ( uint64_t( 1 ) << ( offset % 64 ) ) - 1 ) );
+    }
+    else {
+        rank += std::lower_bound( container.array.begin(),
+                container.array.end(), offset ) - container.array.begin();
+    }
+
+    return rank;
+}
+
+LineNumber MatchSet::select( LineNumber index ) const
+{
+    assert( index < size_ );
+
+    // Last container starting at or before index (the empty
+    // containers start at the same index as the next one)
+    const size_t key = std::upper_bound( rankBefore_.begin(),
+            rankBefore_.end(), index ) - rankBefore_.begin() - 1;
+
+    const Container& container = containers_[key];
+    const LineNumber base = key * linesPerContainer;
+    LineNumber remaining = index - rankBefore_[key];
+
+    if ( container.isBitmap() ) {
+        // Last block starting at or before remaining
+        const size_t block = std::upper_bound( container.blockRanks.begin(),
+                container.blockRanks.end(), remaining )
+            - container.blockRanks.begin() - 1;
+        remaining -= container.blockRanks[block];
+
+        for ( int i = block * wordsPerBlock; i < wordsPerBitmap; i++ ) {
+            uint64_t word = container.bitmap[i];
+            const LineNumber count = bitCount( word );
+            if ( remaining < count ) {
+                // Drop the lowest bits until the one we want
+                while ( remaining-- > 0 )
+                    word &= word - 1;
+                return base + i * 64 + lowestBitSet( word );
+            }
+            remaining -= count;
+        }
+        return 0;
+    }
+    else {
+        return base + container.array[ remaining ];
+    }
+}
+
+MatchSet::const_iterator MatchSet::lowerBound( LineNumber line ) const
+{
+    const size_t key = line / linesPerContainer;
+    const uint16_t offset = line % linesPerContainer;
+
+    if ( key >= containers_.size() )
+        return end();
+
+    const Container& container = containers_[key];
+    if ( container.isBitmap() )
+        return const_iterator( this, key, offset );
+    else
+        return const_iterator( this, key, std::lower_bound( container.array.begin(),
+                    container.array.end(), offset ) - container.array.begin() );
+}
+
+MatchSet MatchSet::united( const MatchSet& other ) const
+{
+    MatchSet result;
+
+    const_iterator i = begin();
+    const_iterator j = other.begin();
+    while ( i != end() || j != other.end() ) {
+        if ( j == other.end() || ( i != end() && *i < *j ) ) {
+            result.append( *i );
+            ++i;
+        }
+        else if ( i == end() || *j < *i ) {
+            result.append( *j );
+            ++j;
+        }
+        else {
+            result.append( *i );
+            ++i;
+            ++j;
+        }
+    }
+
+    return result;
+}
+
+MatchSet MatchSet::intersected( const MatchSet& other ) const
+{
+    MatchSet result;
+
+    const_iterator i = begin();
+    const_iterator j = other.begin();
+    while ( i != end() && j != other.end() ) {
+        if ( *i < *j )
+            ++i;
+        else if ( *j < *i )
+            ++j;
+        else {
+            result.append( *i );
+            ++i;
+            ++j;
+        }
+    }
+
+    return result;
+}
+
+MatchSet MatchSet::subtracted( const MatchSet& other ) const
+{
+    MatchSet result;
+
+    const_iterator i = begin();
+    const_iterator j = other.begin();
+    while ( i != end() ) {
+        if ( j == other.end() || *i < *j ) {
+            result.append( *i );
+            ++i;
+        }
+        else if ( *j < *i )
+            ++j;
+        else {
+            ++i;
+            ++j;
+        }
+    }
+
+    return result;
+}
+
+MatchSet MatchSet::complemented( LineNumber nbLines ) const
+{
+    MatchSet result;
+
+    const_iterator i = begin();
+    for ( LineNumber line = 0; line < nbLines; line++ ) {
+        if ( i != end() && *i == line )
+            ++i;
+        else
+            result.append( line );
+    }
+
+    return result;
+}
+
+size_t MatchSet::allocatedSize() const
+{
+    size_t size = containers_.capacity() * sizeof( Container )
+        + rankBefore_.capacity() * sizeof( LineNumber );
+
+    for ( const Container& container : containers_ )
+        size += container.array.capacity() * sizeof( uint16_t )
+            + container.bitmap.capacity() * sizeof( uint64_t )
+            + container.blockRanks.capacity() * sizeof( uint16_t );
+
+    return size;
+}
+
+//
+// const_iterator
+//
+
+MatchSet::const_iterator::const_iterator( const MatchSet* set,
+        size_t container, int position )
+    : set_( set ), container_( container ), position_( position ), line_( 0 )
+{
+    settle();
+}
+
+MatchSet::const_iterator& MatchSet::const_iterator::operator++()
+{
+    position_++;
+    settle();
+
+    return *this;
+}
+
+void MatchSet::const_iterator::settle()
+{
+    while ( container_ < set_->containers_.size() ) {
+        const Container& container = set_->containers_[container_];
+        const LineNumber base = container_ * linesPerContainer;
+
+        if ( container.isBitmap() ) {
+            while ( position_ < linesPerContainer ) {
+                // Skip the bits below position_ in the word
+                const uint64_t word = container.bitmap[ position_ / 64 ]
+                    & ( ~uint64_t( 0 ) << ( position_ % 64 ) );
+                if ( word ) {
+                    position_ = ( position_ & ~63 ) + lowestBitSet( word );
+                    line_ = base + position_;
+                    return;
+                }
+                position_ = ( position_ & ~63 ) + 64;
+            }
+        }
+        else if ( position_ < (int) container.array.size() ) {
+            line_ = base + container.array[ position_ ];
+            return;
+        }
+
+        container_++;
+        position_ = 0;
+    }
+
+    // end()
+    position_ = 0;
+}
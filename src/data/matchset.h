@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHSET_H
+#define MATCHSET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include <QtGlobal>
+
+// Line numbers are 64 bits, as in the rest of the data (a file can
+// have more than 2^32 lines).
+typedef qint64 LineNumber;
+
+// Compressed set of line numbers (the lines matching a search),
+// in the manner of a roaring bitmap.
+// Lines are grouped in containers of 65536 consecutive lines, each
+// storing the (16 bits) offsets of its lines in a sorted array while
+// it has few of them, or as a bitmap (8 KiB) once it is dense.
+// Besides the membership test, the set supports rank (the number
+// of lines before a given one) and select (the line at a given index)
+// so it can be used as a sorted array of lines.
+// Bitmaps keep the number of their lines before each block of
+// wordsPerBlock words, so rank and select only count the bits of
+// one block (512 lines, a cache line) instead of the whole bitmap.
+// Lines can only be added at the end, as the search finds them.
+class MatchSet
+{
+  public:
+    MatchSet();
+
+    // Add a line (must be greater than the last one)
+    void append( LineNumber line );
+    // Remove the last line
+    void removeLast();
+    // Returns the last line (the set must not be empty)
+    LineNumber last() const;
+    // Remove all the lines
+    void clear();
+
+    // Number of lines in the set
+    LineNumber size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Returns whether the passed line is in the set
+    bool contains( LineNumber line ) const;
+    // Returns the number of lines in the set before the passed one
+    LineNumber rank( LineNumber line ) const;
+    // Returns the line at the passed index (must be less than size())
+    LineNumber select( LineNumber index ) const;
+
+    // Returns the lines in either set
+    MatchSet united( const MatchSet& other ) const;
+    // Returns the lines in both sets
+    MatchSet intersected( const MatchSet& other ) const;
+    // Returns the lines in this set but not in the other one
+    MatchSet subtracted( const MatchSet& other ) const;
+    // Returns the lines of [0, nbLines) not in the set
+    MatchSet complemented( LineNumber nbLines ) const;
+
+    // Approximate memory used, in bytes
+    size_t allocatedSize() const;
+
+    // Iterates over the lines, in order
+    class const_iterator {
+      public:
+        LineNumber operator*() const { return line_; }
+        const_iterator& operator++();
+        bool operator==( const const_iterator& other ) const
+        { return container_ == other.container_ && position_ == other.position_; }
+        bool operator!=( const const_iterator& other ) const
+        { return ! ( *this == other ); }
+
+      private:
+        friend class MatchSet;
+        const_iterator( const MatchSet* set, size_t container, int position );
+        // Move to the first line at or after the current position
+        void settle();
+
+        const MatchSet* set_;
+        size_t container_;
+        // Index in the array or bit in the bitmap
+        int position_;
+        LineNumber line_;
+    };
+
+    const_iterator begin() const { return const_iterator( this, 0, 0 ); }
+    const_iterator end() const
+    { return const_iterator( this, containers_.size(), 0 ); }
+    // Returns an iterator on the first line at or after the passed one
+    const_iterator lowerBound( LineNumber line ) const;
+
+    // Containers with more lines than this are stored as bitmaps
+    static const int maxArraySize;
+
+  private:
+    struct Container {
+        Container() : array(), bitmap(), blockRanks(), cardinality( 0 ) {}
+
+        bool isBitmap() const { return ! bitmap.empty(); }
+
+        // Offsets of the lines (when sparse)
+        std::vector<uint16_t> array;
+        // One bit per line (when dense)
+        std::vector<uint64_t> bitmap;
+        // Number of lines before each block of the bitmap, up to the
+        // block of the last line (the blocks after it are empty)
+        std::vector<uint16_t> blockRanks;
+        uint32_t cardinality;
+    };
+
+    // Add to blockRanks the blocks up to the one of the offset, the
+    // passed rank being the number of lines before the offset
+    static void startBlock( Container& container, uint16_t offset,
+            uint32_t rank );
+
+    static const int linesPerContainer = 65536;
+    static const int wordsPerBitmap = linesPerContainer / 64;
+    static const int wordsPerBlock = 8;
+
+    std::vector<Container> containers_;
+    // Number of lines in the containers before each one
+    std::vector<LineNumber> rankBefore_;
+    LineNumber size_;
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memorybudget.h"
+
+#include <algorithm>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "log.h"
+
+MemoryBudget& MemoryBudget::instance()
+{
+    // Never destroyed, as TaskScheduler
+    static MemoryBudget* budget = new MemoryBudget();
+    return *budget;
+}
+
+MemoryBudget::MemoryBudget() : mutex_(), clients_(), limit_( 0 ), clock_( 0 )
+{
+}
+
+void MemoryBudget::addClient( Client* client )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    clients_.push_back( { client, 0, TaskScheduler::Background, clock_++, -1 } );
+}
+
+void MemoryBudget::removeClient( Client* client )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    clients_.erase( std::remove_if( clients_.begin(), clients_.end(),
+                [client]( const ClientState& state )
+                { return state.client == client; } ),
+            clients_.end() );
+}
+
+void MemoryBudget::setUsage( Client* client, qint64 usage )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+
+        for ( ClientState& state : clients_ ) {
+            if ( state.client == client )
+                state.usage = usage;
+        }
+    }
+
+    enforceLimit();
+}
+
+void MemoryBudget::setPriority( Client* client,
+        TaskScheduler::Priority priority )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    for ( ClientState& state : clients_ ) {
+        if ( state.client == client && state.priority != priority ) {
+            state.priority = priority;
+            state.lastVisible = clock_++;
+        }
+    }
+}
+
+void MemoryBudget::setLimit( qint64 limit )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        limit_ = limit;
+    }
+
+    enforceLimit();
+}
+
+qint64 MemoryBudget::limit() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    return effectiveLimit();
+}
+
+qint64 MemoryBudget::usage() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    qint64 usage = 0;
+    for ( const ClientState& state : clients_ )
+        usage += state.usage;
+
+    return usage;
+}
+
+qint64 MemoryBudget::physicalMemory()
+{
+#ifdef WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof( status );
+    if ( GlobalMemoryStatusEx( &status ) )
+        return status.ullTotalPhys;
+    return 0;
+#else
+    const long nb_pages  = sysconf( _SC_PHYS_PAGES );
+    const long page_size = sysconf( _SC_PAGESIZE );
+    if ( nb_pages <= 0 || page_size <= 0 )
+        return 0;
+    return qint64( nb_pages ) * page_size;
+#endif
+}
+
+std::vector<MemoryBudget::Client*> MemoryBudget::clientsOverLimit()
+{
+    std::vector<Client*> victims;
+
+    const qint64 limit = effectiveLimit();
+    if ( limit == 0 )
+        return victims;
+
+    // What is still to be released by the clients already asked to
+    // does not count, they are not asked again.
+    qint64 usage = 0;
+    std::vector<ClientState*> candidates;
+    for ( ClientState& state : clients_ ) {
+        if ( state.usage > 0 && state.usage != state.askedUsage ) {
+            usage += state.usage;
+            candidates.push_back( &state );
+        }
+    }
+    if ( usage <= limit )
+        return victims;
+
+    // Hidden tabs first, the least recently displayed first
+    std::sort( candidates.begin(), candidates.end(),
+            []( const ClientState* a, const ClientState* b ) {
+                if ( a->priority != b->priority )
+                    return a->priority < b->priority;
+                return a->lastVisible < b->lastVisible;
+            } );
+
+    for ( ClientState* state : candidates ) {
+        if ( usage <= limit )
+            break;
+        usage -= state->usage;
+        state->askedUsage = state->usage;
+        victims.push_back( state->client );
+    }
+
+    return victims;
+}
+
+void MemoryBudget::enforceLimit()
+{
+    std::vector<Client*> victims;
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        victims = clientsOverLimit();
+    }
+
+    // A client might report its new usage from releaseMemory()
+    for ( Client* client : victims ) {
+        LOG(logDEBUG) << "MemoryBudget: asking " << client
+            << " to release its memory";
+        client->releaseMemory();
+    }
+}
+
+qint64 MemoryBudget::effectiveLimit() const
+{
+    return ( limit_ > 0 ) ? limit_ : physicalMemory() / 2;
+}
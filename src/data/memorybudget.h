@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <mutex>
+#include <vector>
+
+#include <QtGlobal>
+
+#include "taskscheduler.h"
+
+// Keeps the memory the indexes of all the files open use (the line
+// positions of the LogData, the cached results of the LogFilteredData)
+// under a limit, asking the clients of the tabs least recently displayed
+// (hidden tabs first) to release theirs when it is exceeded.
+// A client releases what it can (spilling it to the disk or dropping
+// what can be computed again) and reports its new usage.
+// The clients must all be used from the same (GUI) thread.
+class MemoryBudget
+{
+  public:
+    class Client {
+      public:
+        virtual ~Client() {}
+        // Release the memory reported as usage, as soon as possible
+        virtual void releaseMemory() = 0;
+    };
+
+    static MemoryBudget& instance();
+
+    void addClient( Client* client );
+    void removeClient( Client* client );
+    // Report the memory the client uses (and could release), in bytes,
+    // the clients over the limit are then asked to release theirs
+    void setUsage( Client* client, qint64 usage );
+    // The tab of the client has been displayed or hidden
+    void setPriority( Client* client, TaskScheduler::Priority priority );
+
+    // Sets the limit, in bytes (half the physical memory if 0)
+    void setLimit( qint64 limit );
+    qint64 limit() const;
+    // Total usage of the clients, in bytes
+    qint64 usage() const;
+
+    // Returns the physical memory of the machine (0 if not known,
+    // not limiting the usage then)
+    static qint64 physicalMemory();
+
+  private:
+    struct ClientState {
+        Client* client;
+        qint64 usage;
+        TaskScheduler::Priority priority;
+        // When the client was last displayed (or hidden)
+        unsigned long long lastVisible;
+        // Usage when the client was last asked to release it
+        // (not asked again until it changes), -1 if never
+        qint64 askedUsage;
+    };
+
+    MemoryBudget();
+
+    // Returns the clients to ask to release their memory to get
+    // under the limit (with mutex_ held)
+    std::vector<Client*> clientsOverLimit();
+    // Ask them (without mutex_ held)
+    void enforceLimit();
+    // Returns the limit in effect (with mutex_ held)
+    qint64 effectiveLimit() const;
+
+    mutable std::mutex mutex_;
+    std::vector<ClientState> clients_;
+    qint64 limit_;
+    unsigned long long clock_;
+};
+
+#endif
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements MergedLogData
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <queue>
+
+#include "log.h"
+
+#include "mergedlogdata.h"
+#include "logfiltereddata.h"
+
+const int MergedLogData::linesPerChunk = 5000;
+
+MergedLogData::MergedLogData( const std::vector<const LogData*>& sources,
+        const TimestampRule& rule )
+    : AbstractLogData(), sources_( sources ), rule_( rule ),
+    mutex_(), requestCond_(), terminate_( false ), epoch_( 0 ),
+    nbLinesToMerge_(), reindexing_( sources.size(), false ), merged_()
+{
+    for ( const LogData* source : sources_ ) {
+        nbLinesToMerge_.push_back( source->getNbLine() );
+
+        connect( source, SIGNAL( loadingFinished( LoadingStatus ) ),
+                this, SLOT( sourceLoadingFinished( LoadingStatus ) ) );
+        connect( source, SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ),
+                this, SLOT( sourceChanged( LogData::MonitoredFileStatus ) ) );
+    }
+
+    thread_ = std::thread( &MergedLogData::run, this );
+}
+
+MergedLogData::~MergedLogData()
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        terminate_ = true;
+        requestCond_.wakeAll();
+    }
+    thread_.join();
+}
+
+//
+// Public functions
+//
+
+// Return an initialised LogFilteredData. The search is not started.
+LogFilteredData* MergedLogData::getNewFilteredData() const
+{
+    LogFilteredData* newFilteredData = new LogFilteredData( this );
+
+    return newFilteredData;
+}
+
+int MergedLogData::getSourceIndex( qint64 line ) const
+{
+    const std::vector<MergedLine> lines = mergedLines( line, 1 );
+
+    return lines.empty() ? -1 : lines[0].source;
+}
+
+qint64 MergedLogData::getSourceLineNumber( qint64 line ) const
+{
+    const std::vector<MergedLine> lines = mergedLines( line, 1 );
+
+    return lines.empty() ? -1 : lines[0].line;
+}
+
+//
+// Slots
+//
+
+void MergedLogData::sourceLoadingFinished( LoadingStatus status )
+{
+    const int index = senderIndex();
+    if ( index == -1 )
+        return;
+
+    const qint64 nb_lines = sources_[index]->getNbLine();
+    bool added = false;
+    {
+        QMutexLocker locker( &mutex_ );
+
+        if ( reindexing_[index] ) {
+            reindexing_[index] = false;
+            nbLinesToMerge_[index] = nb_lines;
+        }
+        else if ( status == LoadingStatus::Successful
+                && nb_lines > nbLinesToMerge_[index] ) {
+            nbLinesToMerge_[index] = nb_lines;
+            added = true;
+        }
+        requestCond_.wakeAll();
+    }
+
+    if ( added )
+        emit fileChanged( LogData::DataAdded );
+}
+
+void MergedLogData::sourceChanged( LogData::MonitoredFileStatus status )
+{
+    const int index = senderIndex();
+    if ( index == -1 || status == LogData::DataAdded )
+        return;
+
+    LOG(logDEBUG) << "MergedLogData: source " << index << " truncated";
+
+    {
+        QMutexLocker locker( &mutex_ );
+
+        // Merge again once the file is indexed
+        reindexing_[index] = true;
+        merged_.clear();
+        epoch_++;
+        requestCond_.wakeAll();
+    }
+
+    emit fileChanged( LogData::Truncated );
+}
+
+//
+// Implementation of virtual functions
+//
+
+QString MergedLogData::doGetLineString( qint64 line ) const
+{
+    const std::vector<MergedLine> lines = mergedLines( line, 1 );
+    if ( lines.empty() )
+        return QString();
+
+    return sources_[lines[0].source]->getLineString( lines[0].line );
+}
+
+QString MergedLogData::doGetExpandedLineString( qint64 line ) const
+{
+    const std::vector<MergedLine> lines = mergedLines( line, 1 );
+    if ( lines.empty() )
+        return QString();
+
+    return sources_[lines[0].source]->getExpandedLineString( lines[0].line );
+}
+
+QStringList MergedLogData::doGetLines( qint64 first_line, int number ) const
+{
+    return getRuns( first_line, number, &AbstractLogData::getLines );
+}
+
+QStringList MergedLogData::doGetExpandedLines( qint64 first_line, int number ) const
+{
+    return getRuns( first_line, number, &AbstractLogData::getExpandedLines );
+}
+
+qint64 MergedLogData::doGetNbLine() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return merged_.size();
+}
+
+int MergedLogData::doGetMaxLength() const
+{
+    int max_length = 0;
+    for ( const LogData* source : sources_ )
+        max_length = qMax( max_length, source->getMaxLength() );
+
+    return max_length;
+}
+
+int MergedLogData::doGetLineLength( qint64 line ) const
+{
+    const std::vector<MergedLine> lines = mergedLines( line, 1 );
+    if ( lines.empty() )
+        return 0;
+
+    return sources_[lines[0].source]->getLineLength( lines[0].line );
+}
+
+bool MergedLogData::doHasLineLengths() const
+{
+    for ( const LogData* source : sources_ ) {
+        if ( ! source->hasLineLengths() )
+            return false;
+    }
+
+    return true;
+}
+
+//
+// Private functions
+//
+
+std::vector<MergedLogData::MergedLine> MergedLogData::mergedLines(
+        qint64 first_line, int number ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( first_line < 0 || number <= 0
+            || first_line + number > (qint64) merged_.size() ) {
+        if ( number > 0 )
+            LOG(logWARNING) << "MergedLogData: lines out of bound asked for";
+        return std::vector<MergedLine>();
+    }
+
+    return std::vector<MergedLine>( merged_.begin() + first_line,
+            merged_.begin() + first_line + number );
+}
+
+QStringList MergedLogData::getRuns( qint64 first_line, int number,
+        QStringList ( AbstractLogData::*get )( qint64, int ) const ) const
+{
+    const std::vector<MergedLine> lines = mergedLines( first_line, number );
+    QStringList list;
+
+    size_t begin = 0;
+    while ( begin < lines.size() ) {
+        size_t end = begin + 1;
+        while ( end < lines.size() && lines[end].source == lines[begin].source
+                && lines[end].line == lines[end - 1].line + 1 )
+            end++;
+
+        const LogData* source = sources_[lines[begin].source];
+        list.append( ( source->*get )( lines[begin].line, end - begin ) );
+        begin = end;
+    }
+
+    return list;
+}
+
+int MergedLogData::senderIndex() const
+{
+    for ( size_t i = 0; i < sources_.size(); i++ ) {
+        if ( sources_[i] == sender() )
+            return i;
+    }
+
+    return -1;
+}
+
+// Merges the lines of the files, reading them one chunk at a time
+void MergedLogData::run()
+{
+    // The next lines of a file, read but not merged yet
+    struct Cursor {
+        std::deque<qint64> timestamps;
+        qint64 nbRead;
+        qint64 lastTimestamp;
+    };
+    // Next timestamp of each file with lines read, the earliest on top
+    typedef std::pair<qint64, int> HeapEntry;
+    typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>,
+            std::greater<HeapEntry>> Heap;
+
+    const TimestampRule& rule = rule_;
+    std::vector<Cursor> cursors;
+    Heap heap;
+    int epoch = -1;
+    // Whether the end of the merge has been signalled
+    bool finished = false;
+
+    QMutexLocker locker( &mutex_ );
+
+    forever {
+        if ( epoch != epoch_ ) {
+            epoch = epoch_;
+            cursors.assign( sources_.size(), { std::deque<qint64>(), 0,
+                    TimestampRule::noTimestamp } );
+            heap = Heap();
+            finished = false;
+        }
+
+        auto hasWork = [&]() {
+            if ( ! heap.empty() )
+                return true;
+            for ( size_t i = 0; i < sources_.size(); i++ ) {
+                if ( cursors[i].nbRead < nbLinesToMerge_[i] )
+                    return true;
+            }
+            return false;
+        };
+
+        auto isReindexing = [&]() {
+            return std::find( reindexing_.begin(), reindexing_.end(), true )
+                != reindexing_.end();
+        };
+
+        if ( ! finished && ! isReindexing() && ! hasWork() ) {
+            LOG(logDEBUG) << "MergedLogData: " << merged_.size() << " lines merged";
+            finished = true;
+            emit loadingProgressed( 100 );
+            emit loadingFinished( LoadingStatus::Successful );
+        }
+
+        while ( ( terminate_ == false ) && ( epoch == epoch_ )
+                && ( isReindexing() || ! hasWork() ) )
+            requestCond_.wait( &mutex_ );
+
+        if ( terminate_ )
+            return;
+        if ( epoch != epoch_ )
+            continue;
+
+        const std::vector<qint64> nbLinesToMerge = nbLinesToMerge_;
+        finished = false;
+
+        // Read and merge without holding the lock
+        locker.unlock();
+
+        // Read the next lines of the files having none left to merge
+        bool stalled = false;
+        for ( size_t i = 0; i < sources_.size(); i++ ) {
+            Cursor& cursor = cursors[i];
+            if ( ! cursor.timestamps.empty()
+                    || cursor.nbRead >= nbLinesToMerge[i] )
+                continue;
+
+            const int number = qMin<qint64>( linesPerChunk,
+                    nbLinesToMerge[i] - cursor.nbRead );
+            const QStringList lines = sources_[i]->getLines(
+                    cursor.nbRead, number );
+            // The file is being truncated
+            if ( lines.size() < number )
+                stalled = true;
+
+            for ( const QString& line : lines ) {
+                const qint64 timestamp = rule.timestamp( line );
+                if ( timestamp != TimestampRule::noTimestamp )
+                    cursor.lastTimestamp = timestamp;
+                cursor.timestamps.push_back( cursor.lastTimestamp );
+            }
+            cursor.nbRead += lines.size();
+
+            if ( ! cursor.timestamps.empty() )
+                heap.push( { cursor.timestamps.front(), (int) i } );
+        }
+
+        // Merge until a file with lines left to read has none read
+        std::vector<MergedLine> lines;
+        while ( ! heap.empty() ) {
+            const int i = heap.top().second;
+            Cursor& cursor = cursors[i];
+            heap.pop();
+
+            lines.push_back( { (qint64) ( cursor.nbRead
+                            - cursor.timestamps.size() ), (qint64) i } );
+            cursor.timestamps.pop_front();
+
+            if ( ! cursor.timestamps.empty() )
+                heap.push( { cursor.timestamps.front(), i } );
+            else if ( cursor.nbRead < nbLinesToMerge[i] )
+                break;
+        }
+
+        locker.relock();
+
+        // The merge might have restarted in between
+        if ( epoch != epoch_ )
+            continue;
+
+        merged_.insert( merged_.end(), lines.begin(), lines.end() );
+
+        if ( stalled ) {
+            // Until the truncation is reported
+            while ( terminate_ == false && epoch == epoch_ )
+                requestCond_.wait( &mutex_ );
+        }
+        else if ( hasWork() ) {
+            qint64 total = 0;
+            for ( qint64 nb_lines : nbLinesToMerge_ )
+                total += nb_lines;
+            emit loadingProgressed( merged_.size() * 100 / total );
+        }
+    }
+}
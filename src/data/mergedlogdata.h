@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MERGEDLOGDATA_H
+#define MERGEDLOGDATA_H
+
+#include <thread>
+#include <vector>
+
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "abstractlogdata.h"
+#include "logdata.h"
+#include "loadingstatus.h"
+#include "timestamprule.h"
+
+class LogFilteredData;
+
+// Interleaves the lines of several LogData (e.g. the logs of the nodes
+// of a distributed system) in the order of their timestamps.
+// The merged order is built by a thread of its own, with a k-way merge
+// of the files (a heap holding the next line of each), the lines being
+// available as soon as they are merged.
+// A line with no timestamp takes the one of the previous line of its
+// file (continuation lines stay with their record) and the lines with
+// the same timestamp are in the order of the files.
+// The lines added to a file are merged after the ones already merged,
+// a file being truncated restarting the merge.
+// The LogData must have been loaded and outlive this object.
+// This class is thread-safe.
+class MergedLogData : public AbstractLogData {
+  Q_OBJECT
+
+  public:
+    MergedLogData( const std::vector<const LogData*>& sources,
+            const TimestampRule& rule );
+    ~MergedLogData();
+
+    // Creates a new filtered data, searching through the merged lines.
+    // ownership is passed to the caller
+    LogFilteredData* getNewFilteredData() const;
+    // Returns the index (in the sources) of the file the passed line
+    // is from, -1 if out of bounds.
+    int getSourceIndex( qint64 line ) const;
+    // Returns the number of the passed line in its file, -1 if out
+    // of bounds.
+    qint64 getSourceLineNumber( qint64 line ) const;
+
+    // Number of lines of each file read at once
+    static const int linesPerChunk;
+
+  signals:
+    // Sent while merging, percent being the proportion of lines merged.
+    void loadingProgressed( int percent );
+    // Sent when all the lines of the files have been merged.
+    void loadingFinished( LoadingStatus status );
+    // Sent when lines are added to a file (DataAdded) or a file is
+    // truncated (Truncated), followed by a loadingFinished.
+    void fileChanged( LogData::MonitoredFileStatus status );
+
+  private slots:
+    // Called by the sources
+    void sourceLoadingFinished( LoadingStatus status );
+    void sourceChanged( LogData::MonitoredFileStatus status );
+
+  private:
+    // A merged line, by its file and number in it (in 64 bits)
+    struct MergedLine {
+        qint64 line : 48;
+        qint64 source : 16;
+    };
+
+    // Implementation of virtual functions
+    QString doGetLineString( qint64 line ) const override;
+    QString doGetExpandedLineString( qint64 line ) const override;
+    QStringList doGetLines( qint64 first, int number ) const override;
+    QStringList doGetExpandedLines( qint64 first, int number ) const override;
+    qint64 doGetNbLine() const override;
+    int doGetMaxLength() const override;
+    int doGetLineLength( qint64 line ) const override;
+    bool doIsThreadSafe() const override { return true; }
+    bool doHasLineLengths() const override;
+
+    // Returns the passed lines of the merge
+    std::vector<MergedLine> mergedLines( qint64 first_line, int number ) const;
+    // Call get on each run of consecutive lines of the same file
+    QStringList getRuns( qint64 first_line, int number,
+            QStringList ( AbstractLogData::*get )( qint64, int ) const ) const;
+
+    // Returns the index of the source sending a signal
+    int senderIndex() const;
+
+    // Merges the lines, in the merging thread
+    void run();
+
+    const std::vector<const LogData*> sources_;
+    const TimestampRule rule_;
+
+    // Protects everything below
+    mutable QMutex mutex_;
+    QWaitCondition requestCond_;
+    bool terminate_;
+    // Changed whenever the merge restarts, so the lines merged
+    // meanwhile are thrown away
+    int epoch_;
+    // Number of lines of each file to merge
+    std::vector<qint64> nbLinesToMerge_;
+    // The files being reindexed (the merge waits for them)
+    std::vector<bool> reindexing_;
+    std::vector<MergedLine> merged_;
+
+    std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "log.h"
+
+#include "patternsetmatcher.h"
+#include "abstractlogdata.h"
+#include "devicematcher.h"
+
+PatternSetMatcher::PatternSetMatcher( const std::vector<QRegExp>& patterns )
+    : patterns_()
+{
+    patterns_.reserve( patterns.size() );
+    for ( const QRegExp& regexp : patterns )
+        patterns_.emplace_back( new Pattern( regexp ) );
+}
+
+// Called from the searching threads, only uses its own data
+// (the source data being thread safe).
+void PatternSetMatcher::matchLines( const AbstractLogData* logData,
+        qint64 firstLine, int nbLines,
+        std::vector<QBitArray>* matches, int* maxLength ) const
+{
+    Buffers buffers;
+    matchLines( logData, firstLine, nbLines, &buffers, maxLength );
+
+    matches->swap( buffers.matches );
+}
+
+void PatternSetMatcher::matchLines( const AbstractLogData* logData,
+        qint64 firstLine, int nbLines, Buffers* buffers, int* maxLength ) const
+{
+    logData->getRawLines( firstLine, nbLines,
+            &buffers->data, &buffers->lineEnds );
+
+    matchLines( buffers->data.constData(), buffers->data.size(),
+            buffers->lineEnds, buffers, maxLength );
+}
+
+void PatternSetMatcher::matchLines( const char* data, int size,
+        const std::vector<int>& lineEnds,
+        std::vector<QBitArray>* matches, int* maxLength ) const
+{
+    Buffers buffers;
+    matchLines( data, size, lineEnds, &buffers, maxLength );
+
+    matches->swap( buffers.matches );
+}
+
+void PatternSetMatcher::matchLines( const char* data, int size,
+        const std::vector<int>& lineEnds,
+        Buffers* buffers, int* maxLength ) const
+{
+    const int nbRead = lineEnds.size();
+
+    // (cleared keeping their memory)
+    std::vector<QBitArray>* const matches = &buffers->matches;
+    matches->resize( patterns_.size() );
+    for ( QBitArray& bits : *matches ) {
+        bits.resize( nbRead );
+        bits.fill( false );
+    }
+    QBitArray& matching = buffers->matching;
+    matching.resize( nbRead );
+    matching.fill( false );
+    buffers->decoded.clear();
+
+    for ( size_t p = 0; p < patterns_.size(); p++ ) {
+        const Pattern& pattern = *patterns_[p];
+        QBitArray& patternMatches = (*matches)[p];
+
+        RawMatcher::Context context( *pattern.rawMatcher );
+        const CompiledRegExp& regexp = pattern.regexp;
+
+        auto lineMatches = [&] ( int beginning, int end ) {
+            if ( pattern.prefilter.isExact() || pattern.keywords.isValid() )
+                return true;
+            else if ( pattern.rawMatcher->isValid() )
+                return pattern.rawMatcher->matches( context,
+                        data + beginning, end - beginning );
+            else {
+                // Decoded in the slab, then matched in place (the
+                // QString not being shared, without an allocation)
+                buffers->decoder.decode( data + beginning, end - beginning,
+                        false, &buffers->decoded );
+                const int last = buffers->decoded.size() - 1;
+                buffers->text.setRawData( buffers->decoded.line( last ),
+                        buffers->decoded.length( last ) );
+                return regexp.indexIn( buffers->text ) != -1;
+            }
+        };
+
+        // The length is computed from the data we already have
+        auto addMatch = [&] ( int j, int beginning, int end ) {
+            patternMatches.setBit( j );
+            if ( ! matching.testBit( j ) ) {
+                matching.setBit( j );
+                const int length = AbstractLogData::expandedLength(
+                        data + beginning, end - beginning );
+                if ( length > *maxLength )
+                    *maxLength = length;
+            }
+        };
+
+        // Finds the next occurrence of what the matching lines contain
+        auto findNext = [&] ( int position ) {
+            if ( pattern.keywords.isValid() )
+                return pattern.keywords.find( data + position, size - position );
+            else
+                return pattern.prefilter.find( data + position, size - position );
+        };
+
+        QBitArray candidates;
+        if ( ! pattern.keywords.isValid()
+                && DeviceMatcher::instance().qualifies( pattern.prefilter, size )
+                && DeviceMatcher::instance().findLines( pattern.prefilter,
+                    data, size, lineEnds, &candidates ) ) {
+            // Match only the lines the device found the literal in
+            int beginning = 0;
+            for ( int j = 0; j < nbRead; j++ ) {
+                if ( candidates.testBit( j ) && lineMatches( beginning, lineEnds[j] ) )
+                    addMatch( j, beginning, lineEnds[j] );
+                beginning = lineEnds[j] + 1;
+            }
+        }
+        else if ( pattern.keywords.isValid() || pattern.prefilter.isValid() ) {
+            // Jump from one occurrence of the literal (or a keyword) to
+            // the next, matching only the lines containing one.
+            int position = 0;
+            int j = 0;
+            while ( j < nbRead ) {
+                const int found = findNext( position );
+                if ( found == -1 )
+                    break;
+
+                while ( lineEnds[j] < position + found )
+                    j++;
+
+                const int beginning = ( j == 0 ) ? 0 : lineEnds[j-1] + 1;
+                if ( lineMatches( beginning, lineEnds[j] ) )
+                    addMatch( j, beginning, lineEnds[j] );
+
+                position = lineEnds[j] + 1;
+                j++;
+            }
+        }
+        else {
+            int beginning = 0;
+            for ( int j = 0; j < nbRead; j++ ) {
+                if ( lineMatches( beginning, lineEnds[j] ) )
+                    addMatch( j, beginning, lineEnds[j] );
+                beginning = lineEnds[j] + 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATTERNSETMATCHER_H
+#define PATTERNSETMATCHER_H
+
+#include <memory>
+#include <vector>
+
+#include <QBitArray>
+#include <QRegExp>
+
+#include "rawmatcher.h"
+#include "literalprefilter.h"
+#include "keywordmatcher.h"
+#include "compiledregexp.h"
+#include "linebuffer.h"
+#include "textencoding.h"
+
+class AbstractLogData;
+
+// Matches a set of patterns against the lines of a log data, reading
+// each range of lines only once whatever the number of patterns.
+// Each pattern is matched against the raw data (see RawMatcher) and
+// prefiltered on its literal if it has one (see LiteralPrefilter), or
+// against the decoded lines (see CompiledRegExp). A pattern which is
+// only an alternation of keywords is not matched, the lines being
+// those its keywords are found in (see KeywordMatcher).
+// The literal is looked for on the GPU instead if there is one and the
+// data is large enough (see DeviceMatcher).
+// The lines are read and matched in Buffers which can be kept from one
+// range to the next (see BufferPool), not to allocate them again.
+// This class is immutable once built and can be shared between threads.
+class PatternSetMatcher
+{
+  public:
+    explicit PatternSetMatcher( const std::vector<QRegExp>& patterns );
+
+    // Number of patterns in the set
+    int size() const { return patterns_.size(); }
+
+    // The memory used to match a range of lines: the raw lines read,
+    // the lines decoded for the patterns matched as QStrings (in one
+    // slab for the range), and the matches.
+    struct Buffers {
+        Buffers() : data(), lineEnds(), decoder( TextEncoding::Utf8 ),
+            decoded(), text(), matches(), matching() {}
+
+        QByteArray data;
+        std::vector<int> lineEnds;
+        LineDecoder decoder;
+        LineBuffer decoded;
+        // The decoded line being matched (using the slab's characters)
+        QString text;
+        std::vector<QBitArray> matches;
+        // Lines already known to match a pattern
+        QBitArray matching;
+    };
+
+    // Match the nbLines lines starting at firstLine against all the
+    // patterns, matches receiving one bit array per pattern (bit i
+    // being set if line firstLine+i matches it).
+    // maxLength is updated with the expanded length of the lines
+    // matching at least one pattern.
+    void matchLines( const AbstractLogData* logData, qint64 firstLine, int nbLines,
+            std::vector<QBitArray>* matches, int* maxLength ) const;
+    // Idem in the passed buffers, the matches being buffers->matches
+    void matchLines( const AbstractLogData* logData, qint64 firstLine, int nbLines,
+            Buffers* buffers, int* maxLength ) const;
+    // Idem for the lines in data (of size bytes) as returned by
+    // AbstractLogData::getRawLines, lineEnds being the offset of
+    // the end of each one.
+    void matchLines( const char* data, int size,
+            const std::vector<int>& lineEnds,
+            std::vector<QBitArray>* matches, int* maxLength ) const;
+    void matchLines( const char* data, int size,
+            const std::vector<int>& lineEnds,
+            Buffers* buffers, int* maxLength ) const;
+
+  private:
+    struct Pattern {
+        explicit Pattern( const QRegExp& regexp )
+            : regexp( regexp ), rawMatcher( RawMatcher::compiled( regexp ) ),
+            prefilter( regexp ), keywords( regexp ) {}
+
+        const CompiledRegExp regexp;
+        const std::shared_ptr<const RawMatcher> rawMatcher;
+        const LiteralPrefilter prefilter;
+        const KeywordMatcher keywords;
+    };
+
+    // Patterns are not copyable
+    std::vector<std::unique_ptr<const Pattern>> patterns_;
+};
+
+#endif
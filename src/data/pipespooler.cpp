@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements PipeSpooler, spooling a pipe to a file.
+
+#include <cerrno>
+#include <chrono>
+
+#ifndef WIN32
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include <QDir>
+
+#include "log.h"
+
+#include "pipespooler.h"
+
+const int PipeSpooler::chunkSize = 64*1024;
+
+namespace {
+    // Period the spooling thread checks whether it has to end,
+    // when nothing is written to the pipe
+    const int pollTimeout = 200;
+}
+
+PipeSpooler::PipeSpooler( const QString& pipeName )
+    : pipeName_( pipeName ), fd_( -1 ),
+    spool_( QDir::tempPath() + "/glogg_pipe_XXXXXX.log" ),
+    terminate_( false ), thread_()
+{
+}
+
+PipeSpooler::~PipeSpooler()
+{
+    terminate_ = true;
+    if ( thread_.joinable() )
+        thread_.join();
+
+#ifndef WIN32
+    // The standard input is left open
+    if ( fd_ > STDIN_FILENO )
+        ::close( fd_ );
+#endif
+}
+
+bool PipeSpooler::start()
+{
+#ifndef WIN32
+    if ( pipeName_ == "-" )
+        fd_ = STDIN_FILENO;
+    else
+        // Not blocking until a writer opens the pipe
+        fd_ = ::open( QFile::encodeName( pipeName_ ).constData(),
+                O_RDONLY | O_NONBLOCK );
+
+    if ( fd_ < 0 ) {
+        LOG(logERROR) << "Cannot open the pipe " << pipeName_.toStdString();
+        return false;
+    }
+
+    if ( ! spool_.open() ) {
+        LOG(logERROR) << "Cannot create the spool file of "
+            << pipeName_.toStdString();
+        return false;
+    }
+
+    LOG(logINFO) << "Spooling " << pipeName_.toStdString()
+        << " to " << spool_.fileName().toStdString();
+    thread_ = std::thread( &PipeSpooler::run, this );
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString PipeSpooler::spoolFileName() const
+{
+    return spool_.fileName();
+}
+
+bool PipeSpooler::isPipe( const QString& fileName )
+{
+#ifndef WIN32
+    if ( fileName == "-" )
+        return true;
+
+    struct stat info;
+    return ( ::stat( QFile::encodeName( fileName ).constData(), &info ) == 0 )
+        && S_ISFIFO( info.st_mode );
+#else
+    Q_UNUSED( fileName );
+    return false;
+#endif
+}
+
+void PipeSpooler::run()
+{
+#ifndef WIN32
+    QByteArray buffer( chunkSize, 0 );
+
+    while ( ! terminate_ ) {
+        struct pollfd pipe = { fd_, POLLIN, 0 };
+        const int ready = ::poll( &pipe, 1, pollTimeout );
+        if ( ready < 0 && errno != EINTR ) {
+            LOG(logERROR) << "Cannot poll " << pipeName_.toStdString();
+            break;
+        }
+        else if ( ready <= 0 )
+            continue;
+
+        const ssize_t size = ::read( fd_, buffer.data(), buffer.size() );
+        if ( size > 0 ) {
+            if ( spool_.write( buffer.constData(), size ) != size
+                    || ! spool_.flush() ) {
+                LOG(logERROR) << "Cannot write to "
+                    << spool_.fileName().toStdString();
+                break;
+            }
+        }
+        else if ( size == 0 ) {
+            // The standard input is over, but a named pipe
+            // can be opened again by another writer.
+            if ( fd_ == STDIN_FILENO )
+                break;
+            std::this_thread::sleep_for(
+                    std::chrono::milliseconds( pollTimeout ) );
+        }
+        else if ( errno != EAGAIN && errno != EINTR ) {
+            LOG(logERROR) << "Cannot read " << pipeName_.toStdString();
+            break;
+        }
+    }
+
+    LOG(logDEBUG) << "End of the spooling of " << pipeName_.toStdString();
+#endif
+}
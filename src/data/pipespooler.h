@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPESPOOLER_H
+#define PIPESPOOLER_H
+
+#include <atomic>
+#include <thread>
+
+#include <QString>
+#include <QTemporaryFile>
+
+// Copies what is written to a pipe (the standard input, named "-",
+// or a named pipe) to a temporary file as it comes, for the data to be
+// indexed and read (seeking back) as the ones of a file growing, which
+// LogData follows as usual.
+// The copy is done by a thread of its own, waiting for the data, each
+// chunk read being written through so the file watcher sees it.
+// The spool file is removed when this object is destroyed.
+// Pipes are not supported on Windows.
+class PipeSpooler {
+  public:
+    PipeSpooler( const QString& pipeName );
+    ~PipeSpooler();
+
+    // Creates the spool file and starts copying the pipe to it,
+    // returns false if the pipe cannot be opened or the file created.
+    bool start();
+    // Returns the name of the file the pipe is copied to
+    QString spoolFileName() const;
+
+    // Returns whether the passed file is to be read through a spooler
+    static bool isPipe( const QString& fileName );
+
+    // Size of the chunks read from the pipe
+    static const int chunkSize;
+
+  private:
+    // Copies the pipe, in the spooling thread
+    void run();
+
+    const QString pipeName_;
+    int fd_;
+    QTemporaryFile spool_;
+    std::atomic<bool> terminate_;
+    std::thread thread_;
+};
+
+#endif
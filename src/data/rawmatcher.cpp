@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "log.h"
+
+#include "rawmatcher.h"
+#include "compiledregexp.h"
+
+#ifdef GLOGG_SUPPORTS_PCRE2
+#  define PCRE2_CODE_UNIT_WIDTH 8
+#  include <pcre2.h>
+#endif
+
+// Number of compiled patterns kept in the cache
+static const int cacheSize = 64;
+
+std::shared_ptr<const RawMatcher> RawMatcher::compiled( const QRegExp& regexp )
+{
+    static QMutex mutex;
+    static QCache<QString, std::shared_ptr<const RawMatcher>> cache( cacheSize );
+
+    const QString key = QString( "%1:%2:%3:" ).arg( regexp.patternSyntax() )
+        .arg( regexp.caseSensitivity() ).arg( regexp.isMinimal() )
+        + regexp.pattern();
+
+    QMutexLocker locker( &mutex );
+    if ( const std::shared_ptr<const RawMatcher>* cached = cache.object( key ) )
+        return *cached;
+
+    // (the matchers in use are kept by their users when evicted)
+    std::shared_ptr<const RawMatcher> matcher =
+        std::make_shared<const RawMatcher>( regexp );
+    cache.insert( key, new std::shared_ptr<const RawMatcher>( matcher ) );
+
+    return matcher;
+}
+
+#ifdef GLOGG_SUPPORTS_PCRE2
+
+RawMatcher::RawMatcher( const QRegExp& regexp )
+    : code_( nullptr ), regexp_( regexp ), tooCostly_( false )
+{
+    uint32_t options = PCRE2_UTF;
+#ifdef PCRE2_MATCH_INVALID_UTF
+    // Log files are not always valid UTF-8
+    options |= PCRE2_MATCH_INVALID_UTF;
+#else
+    // Older PCRE2 would fail on the first invalid sequence
+    LOG(logDEBUG) << "RawMatcher: PCRE2 too old to match invalid UTF-8";
+    return;
+#endif
+
+    QString pattern_text = regexp.pattern();
+    switch ( regexp.patternSyntax() ) {
+        case QRegExp::RegExp:
+        case QRegExp::RegExp2:
+            break;
+        case QRegExp::FixedString:
+            options |= PCRE2_LITERAL;
+            break;
+        case QRegExp::Wildcard:
+        case QRegExp::WildcardUnix:
+            pattern_text = CompiledRegExp::fromWildcard( pattern_text,
+                    regexp.patternSyntax() == QRegExp::WildcardUnix );
+            break;
+        default:
+            LOG(logDEBUG) << "RawMatcher: unsupported pattern syntax";
+            return;
+    }
+
+    if ( regexp.caseSensitivity() == Qt::CaseInsensitive )
+        options |= PCRE2_CASELESS;
+    if ( regexp.isMinimal() )
+        options |= PCRE2_UNGREEDY;
+
+    const QByteArray pattern = pattern_text.toUtf8();
+
+    int error;
+    PCRE2_SIZE error_offset;
+    pcre2_code* code = pcre2_compile(
+            reinterpret_cast<PCRE2_SPTR>( pattern.constData() ),
+            pattern.size(), options, &error, &error_offset, nullptr );
+
+    if ( code ) {
+        // The interpreter is used if JIT is not available
+        pcre2_jit_compile( code, PCRE2_JIT_COMPLETE );
+        code_ = code;
+    }
+    else {
+        LOG(logDEBUG) << "RawMatcher: cannot compile the pattern (error "
+            << error << " at " << error_offset << ")";
+    }
+}
+
+RawMatcher::~RawMatcher()
+{
+    if ( code_ )
+        pcre2_code_free( static_cast<pcre2_code*>( code_ ) );
+}
+
+RawMatcher::Context::Context( const RawMatcher& matcher )
+    : matchData_( nullptr ), matchContext_( nullptr )
+{
+    if ( matcher.code_ ) {
+        matchData_ = pcre2_match_data_create_from_pattern(
+                static_cast<pcre2_code*>( matcher.code_ ), nullptr );
+
+        pcre2_match_context* match_context = pcre2_match_context_create( nullptr );
+        if ( match_context )
+            pcre2_set_match_limit( match_context, CompiledRegExp::matchBudget );
+        matchContext_ = match_context;
+    }
+}
+
+RawMatcher::Context::~Context()
+{
+    if ( matchData_ )
+        pcre2_match_data_free( static_cast<pcre2_match_data*>( matchData_ ) );
+    if ( matchContext_ )
+        pcre2_match_context_free(
+                static_cast<pcre2_match_context*>( matchContext_ ) );
+}
+
+bool RawMatcher::matches( Context& context, const char* line, int length ) const
+{
+    if ( tooCostly_ )
+        return false;
+
+    const int result = pcre2_match( static_cast<pcre2_code*>( code_ ),
+            reinterpret_cast<PCRE2_SPTR>( line ), length, 0, 0,
+            static_cast<pcre2_match_data*>( context.matchData_ ),
+            static_cast<pcre2_match_context*>( context.matchContext_ ) );
+
+    if ( result == PCRE2_ERROR_MATCHLIMIT
+            || result == PCRE2_ERROR_RECURSIONLIMIT
+            || result == PCRE2_ERROR_JIT_STACKLIMIT ) {
+        tooCostly_ = true;
+        CompiledRegExp::reportTooCostly( regexp_ );
+    }
+
+    return ( result >= 0 );
+}
+
+#else
+
+RawMatcher::RawMatcher( const QRegExp& regexp )
+    : code_( nullptr ), regexp_( regexp ), tooCostly_( false )
+{
+}
+
+RawMatcher::~RawMatcher()
+{
+}
+
+RawMatcher::Context::Context( const RawMatcher& )
+    : matchData_( nullptr ), matchContext_( nullptr )
+{
+}
+
+RawMatcher::Context::~Context()
+{
+}
+
+bool RawMatcher::matches( Context&, const char*, int ) const
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RAWMATCHER_H
+#define RAWMATCHER_H
+
+#include <atomic>
+#include <memory>
+
+#include <QRegExp>
+
+// Matches a QRegExp pattern directly against the raw (UTF-8) bytes of
+// the lines, so the search does not have to decode each of them to a
+// QString.
+// This uses PCRE2 (with JIT if available) when glogg is built with
+// GLOGG_SUPPORTS_PCRE2, otherwise the matcher is never valid and the
+// caller must use the QRegExp.
+// The compiled pattern is read-only once built, each thread matching
+// with it must use its own Context. The patterns are shared through
+// a cache (see compiled()), so they are compiled once for all the
+// searches and filters using them.
+// As with CompiledRegExp, a match going over the budget makes the
+// pattern too costly, the matcher then matching no line.
+class RawMatcher
+{
+  public:
+    // Compile the passed regexp, isValid() tells if it worked.
+    // Wildcards are compiled as the equivalent regular expression
+    // (see CompiledRegExp::fromWildcard).
+    explicit RawMatcher( const QRegExp& regexp );
+    ~RawMatcher();
+
+    // Returns the matcher of the regexp from the cache shared by the
+    // threads, compiling it if it is not there.
+    static std::shared_ptr<const RawMatcher> compiled( const QRegExp& regexp );
+
+    // Scratch data for one thread
+    class Context
+    {
+      public:
+        explicit Context( const RawMatcher& matcher );
+        ~Context();
+
+      private:
+        friend class RawMatcher;
+        void* matchData_;
+        void* matchContext_;
+
+        Context( const Context& ) = delete;
+        Context& operator=( const Context& ) = delete;
+    };
+
+    // Returns whether the pattern can be matched at the byte level
+    bool isValid() const { return code_ != nullptr; }
+
+    // Returns true if the pattern is found in the passed line
+    // (which must not include its end of line).
+    bool matches( Context& context, const char* line, int length ) const;
+
+  private:
+    void* code_;
+    // (to report it when too costly)
+    const QRegExp regexp_;
+    mutable std::atomic<bool> tooCostly_;
+
+    RawMatcher( const RawMatcher& ) = delete;
+    RawMatcher& operator=( const RawMatcher& ) = delete;
+};
+
+#endif
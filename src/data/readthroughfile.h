@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef READTHROUGHFILE_H
+#define READTHROUGHFILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+// A file LogData reads through an object of its own, rather than
+// mapping it or reading it with QFile (a compressed file, a remote one).
+// Its data are read once from the start, while they are indexed, then
+// at any position.
+class ReadThroughFile
+{
+  public:
+    virtual ~ReadThroughFile() {}
+
+    // Receives each block of data, with the position reached in the
+    // source (the file actually read), returns false to stop.
+    typedef std::function<bool( const char* data, size_t length,
+            int64_t sourcePosition )> Consumer;
+
+    // Read the whole data, passing them to the consumer.
+    // Returns false on error or if the consumer stopped.
+    virtual bool readAll( const Consumer& consumer ) = 0;
+
+    // Copy length bytes of data from position to buffer (the data
+    // must have been read once).
+    // Returns false if they cannot be read.
+    virtual bool read( int64_t position, char* buffer, int64_t length ) = 0;
+
+    // Returns the size of the data read
+    virtual int64_t size() const = 0;
+    // Returns the size of the source, to report the progress of
+    // readAll (0 if not known)
+    virtual int64_t sourceSize() const = 0;
+};
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements RemoteFile, reading a file over ssh.
+
+#include <algorithm>
+
+#include <QDir>
+#include <QProcess>
+#include <QUrl>
+
+#include "log.h"
+
+#include "remotefile.h"
+
+const int64_t RemoteFile::blockSize = 256 * 1024;
+const int RemoteFile::maxFetchedBlocks = 64;
+const int RemoteFile::timeout = 30000;
+
+namespace {
+    const char* const remotePrefix = "ssh://";
+}
+
+bool RemoteFile::isRemote( const QString& fileName )
+{
+    return fileName.startsWith( remotePrefix );
+}
+
+RemoteFile::RemoteFile( const QString& url )
+    : user_(), host_(), port_( -1 ), quotedPath_(), size_( 0 ),
+    blocks_( blockSize, BlockCache::defaultMaxBytes() )
+{
+    const QUrl parsed( url );
+    user_ = parsed.userName();
+    host_ = parsed.host();
+    port_ = parsed.port( -1 );
+
+    QString path = parsed.path();
+    quotedPath_ = "'" + path.replace( "'", "'\\''" ) + "'";
+}
+
+bool RemoteFile::readAll( const Consumer& consumer )
+{
+    blocks_.clear();
+    size_ = 0;
+
+    const QByteArray size = runCommand( "wc -c < " + quotedPath_ );
+    if ( size.isNull() )
+        return false;
+    size_ = size.trimmed().toLongLong();
+
+    // No more than the size, as the file might be growing
+    QProcess ssh;
+    ssh.start( "ssh", sshArguments( "head -c " + QString::number( size_ )
+                + " -- " + quotedPath_, true ) );
+
+    // The blocks are cached as they come, the end of the file (the
+    // part most likely displayed first) staying in the cache.
+    QByteArray pending;
+    int64_t pending_start = 0;
+    int64_t position = 0;
+    bool stopped = false;
+    while ( ssh.bytesAvailable() > 0 || ssh.waitForReadyRead( timeout ) ) {
+        const QByteArray data = ssh.readAll();
+        position += data.size();
+        if ( ! consumer( data.constData(), data.size(), position ) ) {
+            stopped = true;
+            break;
+        }
+
+        pending.append( data );
+        const int64_t full_size = pending.size() / blockSize * blockSize;
+        if ( full_size > 0 ) {
+            cacheBlocks( pending_start, pending.left( full_size ) );
+            pending.remove( 0, full_size );
+            pending_start += full_size;
+        }
+    }
+
+    if ( ssh.state() != QProcess::NotRunning ) {
+        ssh.kill();
+        ssh.waitForFinished();
+        if ( ! stopped )
+            LOG(logWARNING) << "No data from " << host_.toStdString()
+                << " for " << timeout << " ms";
+        return false;
+    }
+
+    if ( ssh.exitCode() != 0 || position != size_ ) {
+        LOG(logWARNING) << "Cannot read the file on " << host_.toStdString()
+            << ": " << ssh.readAllStandardError().trimmed().constData();
+        blocks_.clear();
+        return false;
+    }
+
+    cacheBlocks( pending_start, pending );
+
+    return true;
+}
+
+bool RemoteFile::read( int64_t position, char* buffer, int64_t length )
+{
+    if ( position < 0 || length < 0 || position + length > size_ )
+        return false;
+
+    const int64_t last_needed = ( position + length - 1 ) / blockSize;
+    return blocks_.read( position, buffer, length,
+            [this, last_needed]( qint64 block ) {
+                // With the next blocks missing, in one command
+                int64_t last = block;
+                while ( last < last_needed && last - block + 1 < maxFetchedBlocks
+                        && ! blocks_.contains( last + 1 ) )
+                    last++;
+
+                return fetchBlocks( block, last );
+            } );
+}
+
+QStringList RemoteFile::sshArguments( const QString& command, bool compress ) const
+{
+    // Never asking for a password (there is no terminal)
+    QStringList arguments = { "-o", "BatchMode=yes",
+        "-o", QString( "ConnectTimeout=%1" ).arg( timeout / 1000 ) };
+#ifndef WIN32
+    // The connection is shared by the fetches of the blocks
+    arguments << "-o" << "ControlMaster=auto"
+        << "-o" << "ControlPath=" + QDir::tempPath() + "/glogg-ssh-%r@%h:%p"
+        << "-o" << "ControlPersist=60";
+#endif
+    if ( compress )
+        arguments << "-C";
+    if ( port_ > 0 )
+        arguments << "-p" << QString::number( port_ );
+    if ( ! user_.isEmpty() )
+        arguments << "-l" << user_;
+    arguments << host_ << command;
+
+    return arguments;
+}
+
+QByteArray RemoteFile::runCommand( const QString& command ) const
+{
+    QProcess ssh;
+    ssh.start( "ssh", sshArguments( command, false ) );
+
+    if ( ! ssh.waitForFinished( timeout )
+            || ssh.exitStatus() != QProcess::NormalExit
+            || ssh.exitCode() != 0 ) {
+        LOG(logWARNING) << "Cannot run '" << command.toStdString()
+            << "' on " << host_.toStdString() << ": "
+            << ssh.readAllStandardError().trimmed().constData();
+        ssh.kill();
+        ssh.waitForFinished();
+        return QByteArray();
+    }
+
+    return ssh.readAllStandardOutput();
+}
+
+QByteArray RemoteFile::fetchBlocks( int64_t first, int64_t last )
+{
+    const int64_t begin = first * blockSize;
+    const int64_t length = std::min( ( last + 1 ) * blockSize, size_ ) - begin;
+
+    LOG(logDEBUG) << "Fetching " << length << " bytes at " << begin
+        << " from " << host_.toStdString();
+
+    const QByteArray data = runCommand( "tail -c +" + QString::number( begin + 1 )
+            + " -- " + quotedPath_ + " | head -c " + QString::number( length ) );
+    if ( data.size() != length ) {
+        // The file has been truncated since it was indexed
+        LOG(logWARNING) << "Cannot read " << length << " bytes at "
+            << begin << " from " << host_.toStdString();
+        return QByteArray();
+    }
+
+    cacheBlocks( begin, data );
+
+    return data.left( blockSize );
+}
+
+void RemoteFile::cacheBlocks( int64_t position, const QByteArray& data )
+{
+    for ( int offset = 0; offset < data.size(); offset += blockSize )
+        blocks_.insert( ( position + offset ) / blockSize,
+                data.mid( offset, blockSize ) );
+}
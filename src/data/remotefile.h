@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMOTEFILE_H
+#define REMOTEFILE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include "readthroughfile.h"
+#include "blockcache.h"
+
+// A file on another host, named ssh://[user@]host[:port]/path, read
+// through the ssh command (authenticated by a key or an agent, as no
+// password can be asked for).
+// The file is streamed once (compressed by ssh) while it is indexed,
+// only the index being kept, then the data are fetched by blocks of
+// blockSize bytes when read, the last ones read being kept compressed
+// (see BlockCache). Browsing a large remote log hence only transfers
+// the blocks displayed, once.
+// The data are those of the file when it was indexed, its changes
+// being seen when it is reloaded.
+// This class is reentrant (not thread-safe).
+class RemoteFile : public ReadThroughFile
+{
+  public:
+    // Returns whether the passed name is the one of a remote file
+    static bool isRemote( const QString& fileName );
+
+    RemoteFile( const QString& url );
+
+    // Stream the whole file, passing its data to the consumer.
+    // Returns false if it cannot be read or if the consumer stopped.
+    bool readAll( const Consumer& consumer ) override;
+
+    // Copy length bytes of the file from position to buffer, fetching
+    // the blocks not cached.
+    // Returns false if they cannot be read.
+    bool read( int64_t position, char* buffer, int64_t length ) override;
+
+    // Returns the size of the file when it was read
+    int64_t size() const override { return size_; }
+    int64_t sourceSize() const override { return size_; }
+
+    // Size of the blocks the file is fetched by
+    static const int64_t blockSize;
+    // Most blocks fetched by one command
+    static const int maxFetchedBlocks;
+    // Delay after which a host not answering is given up (ms)
+    static const int timeout;
+
+  private:
+    // Returns the arguments of ssh running the passed command on the
+    // host, the output being compressed if compress is true.
+    QStringList sshArguments( const QString& command, bool compress ) const;
+    // Returns the output of the passed command run on the host,
+    // a null array if it failed.
+    QByteArray runCommand( const QString& command ) const;
+    // Fetch the blocks from first to last (included) to the cache,
+    // returns the data of the first one (null if they cannot be read)
+    QByteArray fetchBlocks( int64_t first, int64_t last );
+    // Store the passed data, starting at the beginning of a block
+    void cacheBlocks( int64_t position, const QByteArray& data );
+
+    QString user_;
+    QString host_;
+    int port_;
+    // Quoted for the remote shell
+    QString quotedPath_;
+    int64_t size_;
+    BlockCache blocks_;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements RunIndex
+
+#include "runindex.h"
+
+namespace {
+
+inline bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+}
+
+void RunIndex::add( qint64 begin, qint64 end, qint64 nb_lines, quint64 key )
+{
+    QMutexLocker locker( &mutex_ );
+
+    runs_[ begin ] = { end, nb_lines, key };
+}
+
+void RunIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    runs_.clear();
+}
+
+std::vector<RunIndex::Run> RunIndex::runs( qint64 end ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    std::vector<Run> runs;
+    // The run being merged, and its key
+    Run run = { -1, -1, 0 };
+    quint64 key = 0;
+    for ( const auto& entry : runs_ ) {
+        if ( entry.second.end > end )
+            break;
+
+        if ( entry.first == run.end && entry.second.key == key ) {
+            run.end = entry.second.end;
+            run.nbLines += entry.second.nbLines;
+        }
+        else {
+            if ( run.nbLines >= 2 )
+                runs.push_back( run );
+            run = { entry.first, entry.second.end, entry.second.nbLines };
+            key = entry.second.key;
+        }
+    }
+    if ( run.nbLines >= 2 )
+        runs.push_back( run );
+
+    return runs;
+}
+
+bool RunIndex::similar( const char* line, const char* other, int length )
+{
+    for ( int i = 0; i < length; i++ ) {
+        if ( line[i] != other[i]
+                && ! ( isDigit( line[i] ) && isDigit( other[i] ) ) )
+            return false;
+    }
+
+    return true;
+}
+
+// FNV-1a of the length and the bytes, the digits counting as '0'
+quint64 RunIndex::key( const char* line, int length )
+{
+    quint64 hash = 14695981039346656037ULL ^ quint64( length );
+    for ( int i = 0; i < length; i++ ) {
+        hash ^= static_cast<unsigned char>( isDigit( line[i] ) ? '0' : line[i] );
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
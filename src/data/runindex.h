@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNINDEX_H
+#define RUNINDEX_H
+
+#include <map>
+#include <vector>
+
+#include <QMutex>
+#include <QtGlobal>
+
+// The runs of consecutive similar lines of the data (like the lines of
+// a retry loop), recorded while it is indexed, for them to be shown
+// folded into one line.
+// Two lines are similar if they have the same length and the same
+// bytes but for their digits (timestamps and counters being allowed
+// to differ).
+// The runs are identified by the positions of their lines in the data,
+// so the parts of the data indexed separately (in parallel or as it
+// grows) record their runs independently: the runs at the edges of
+// each part are recorded whatever their length, with a key of their
+// lines, and merged with the adjacent runs of the same key when the
+// runs are looked at.
+// This class is thread-safe.
+class RunIndex
+{
+  public:
+    struct Run {
+        // Position of the first line and of the line following the run
+        qint64 begin;
+        qint64 end;
+        qint64 nbLines;
+    };
+
+    RunIndex() : mutex_(), runs_() {}
+
+    // Record the run of nb_lines similar lines from begin to end (the
+    // start of the next line), their lines having the passed key (see
+    // key()), replacing the run starting there if any.
+    void add( qint64 begin, qint64 end, qint64 nb_lines, quint64 key );
+    // Forget all the runs (the data is indexed again)
+    void clear();
+
+    // Returns the runs of at least two lines ending before end, adjacent
+    // runs of the same key being merged.
+    std::vector<Run> runs( qint64 end ) const;
+
+    // Returns whether the two lines of length bytes are similar
+    static bool similar( const char* line, const char* other, int length );
+    // Returns the key of the line, the same for similar lines
+    static quint64 key( const char* line, int length );
+
+  private:
+    struct Entry {
+        qint64 end;
+        qint64 nbLines;
+        quint64 key;
+    };
+
+    mutable QMutex mutex_;
+    // The runs by the position of their first line
+    std::map<qint64, Entry> runs_;
+};
+
+#endif
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements ScanReader, reading a file following an I/O policy.
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+#ifndef WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#include "log.h"
+
+#include "scanreader.h"
+
+const qint64 ScanReader::readAhead = 16 * 1024 * 1024;
+
+const qint64 BlockSizer::targetLatency = 100;
+const qint64 BlockSizer::minSize = 256 * 1024;
+const qint64 BlockSizer::maxSize = 64 * 1024 * 1024;
+const qint64 BlockSizer::blockAlignment = 64 * 1024;
+
+namespace {
+    std::atomic<int> scanPolicy( ScanReader::Cached );
+
+    // Alignment of the direct reads (the block size of most file systems)
+    const qint64 directAlignment = 4096;
+
+#ifndef WIN32
+    // Read length bytes at position to buffer, returns the number of
+    // bytes read (less at the end of the file) or -1 on error
+    qint64 readAt( int fd, char* buffer, qint64 length, qint64 position )
+    {
+        qint64 total = 0;
+        while ( total < length ) {
+            const ssize_t size = ::pread( fd, buffer + total,
+                    length - total, position + total );
+            if ( size < 0 && errno == EINTR )
+                continue;
+            else if ( size < 0 )
+                return total > 0 ? total : -1;
+            else if ( size == 0 )
+                break;
+            total += size;
+        }
+
+        return total;
+    }
+#endif
+}
+
+void ScanReader::setPolicy( Policy policy )
+{
+    scanPolicy = policy;
+}
+
+ScanReader::Policy ScanReader::policy()
+{
+    return static_cast<Policy>( scanPolicy.load() );
+}
+
+ScanReader::ScanReader( QFile& file )
+    : file_( file ),
+#ifdef WIN32
+    ownFile_( file.fileName() ),
+#endif
+    policy_( policy() ), directFd_( -1 ),
+    directBuffer_( nullptr ), directBufferSize_( 0 )
+{
+#ifdef WIN32
+    ownFile_.open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+#else
+    const int fd = file_.handle();
+    if ( fd < 0 || policy_ == Cached )
+        return;
+
+#  if defined(__linux__) && defined(O_DIRECT)
+    if ( policy_ == Direct ) {
+        // Reopened through the descriptor, the file having possibly
+        // been replaced since it was opened
+        const QByteArray path = "/proc/self/fd/" + QByteArray::number( fd );
+        directFd_ = ::open( path.constData(), O_RDONLY | O_DIRECT );
+        if ( directFd_ < 0 )
+            LOG(logWARNING) << "Cannot read " << file_.fileName().toStdString()
+                << " directly, reading it sequentially";
+    }
+#  endif
+
+#  ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#  endif
+#endif
+}
+
+ScanReader::~ScanReader()
+{
+#ifndef WIN32
+    if ( directFd_ >= 0 )
+        ::close( directFd_ );
+#endif
+    free( directBuffer_ );
+}
+
+QByteArray ScanReader::read( qint64 position, qint64 length )
+{
+    QByteArray data;
+
+#ifndef WIN32
+    if ( directFd_ >= 0 ) {
+        // The whole aligned blocks holding the data
+        const qint64 begin = position / directAlignment * directAlignment;
+        const qint64 size = ( position + length - begin + directAlignment - 1 )
+            / directAlignment * directAlignment;
+        if ( size > directBufferSize_ ) {
+            free( directBuffer_ );
+            directBuffer_ = nullptr;
+            directBufferSize_ = 0;
+
+            void* buffer = nullptr;
+            if ( posix_memalign( &buffer, directAlignment, size ) == 0 ) {
+                directBuffer_ = static_cast<char*>( buffer );
+                directBufferSize_ = size;
+            }
+        }
+
+        const qint64 total = directBuffer_ ?
+            readAt( directFd_, directBuffer_, size, begin ) : -1;
+        if ( total >= 0 ) {
+            if ( total > position - begin )
+                data = QByteArray( directBuffer_ + position - begin,
+                        qMin( length, total - ( position - begin ) ) );
+            return data;
+        }
+
+        // Not supported by the file system, read as Sequential
+        LOG(logWARNING) << "Cannot read " << file_.fileName().toStdString()
+            << " directly, reading it sequentially";
+        ::close( directFd_ );
+        directFd_ = -1;
+    }
+
+    data.resize( length );
+    const qint64 total = readAt( file_.handle(), data.data(), length, position );
+    data.resize( qMax( total, 0LL ) );
+
+#  ifdef POSIX_FADV_DONTNEED
+    if ( policy_ != Cached && total > 0 )
+        posix_fadvise( file_.handle(), position, total, POSIX_FADV_DONTNEED );
+#  endif
+#else
+    if ( ownFile_.seek( position ) )
+        data = ownFile_.read( length );
+#endif
+
+    return data;
+}
+
+void ScanReader::release( int fd, qint64 begin, qint64 end )
+{
+#ifdef POSIX_FADV_DONTNEED
+    if ( policy() == Cached || fd < 0 || end <= begin )
+        return;
+
+    posix_fadvise( fd, begin, end - begin, POSIX_FADV_DONTNEED );
+    posix_fadvise( fd, end, readAhead, POSIX_FADV_WILLNEED );
+#else
+    Q_UNUSED( fd );
+    Q_UNUSED( begin );
+    Q_UNUSED( end );
+#endif
+}
+
+BlockPrefetcher::BlockPrefetcher( QFile& file, qint64 position,
+        qint64 blockSize, int depth )
+    : reader_( file ), depth_( qMax( depth, 1 ) ),
+    position_( position ), mutex_(), cond_(), blockSize_( blockSize ), blocks_(),
+    ended_( false ), terminate_( false )
+{
+    thread_ = std::thread( &BlockPrefetcher::run, this );
+}
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        terminate_ = true;
+        cond_.wakeAll();
+    }
+
+    thread_.join();
+}
+
+QByteArray BlockPrefetcher::next()
+{
+    QMutexLocker locker( &mutex_ );
+
+    while ( blocks_.empty() && ! ended_ )
+        cond_.wait( &mutex_ );
+
+    if ( blocks_.empty() )
+        return QByteArray();
+
+    const QByteArray block = blocks_.front();
+    blocks_.pop_front();
+    cond_.wakeAll();
+
+    return block;
+}
+
+void BlockPrefetcher::setBlockSize( qint64 blockSize )
+{
+    QMutexLocker locker( &mutex_ );
+
+    blockSize_ = blockSize;
+}
+
+void BlockPrefetcher::run()
+{
+    forever {
+        qint64 block_size;
+        {
+            QMutexLocker locker( &mutex_ );
+            while ( (int) blocks_.size() >= depth_ && ! terminate_ )
+                cond_.wait( &mutex_ );
+            if ( terminate_ )
+                return;
+            block_size = blockSize_;
+        }
+
+        // Read without the lock, while the previous block is processed
+        const QByteArray block = reader_.read( position_, block_size );
+        position_ += block.size();
+
+        QMutexLocker locker( &mutex_ );
+        if ( block.isEmpty() ) {
+            ended_ = true;
+            cond_.wakeAll();
+            return;
+        }
+
+        blocks_.push_back( block );
+        cond_.wakeAll();
+    }
+}
+
+BlockSizer::BlockSizer( qint64 initialSize )
+    : size_( initialSize ), rate_( 0.0 )
+{
+}
+
+void BlockSizer::processed( qint64 size, qint64 nsecs )
+{
+    if ( size <= 0 || nsecs <= 0 )
+        return;
+
+    // The rate varies with the caches and the load, the last blocks
+    // weighing more.
+    const double rate = double( size ) / nsecs;
+    rate_ = ( rate_ > 0.0 ) ? ( 3 * rate_ + rate ) / 4 : rate;
+
+    const qint64 best_size = qint64( rate_ * targetLatency * 1000000 );
+    size_ = qBound( minSize,
+            ( best_size + blockAlignment / 2 ) / blockAlignment * blockAlignment,
+            maxSize );
+}
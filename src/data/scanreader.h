@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCANREADER_H
+#define SCANREADER_H
+
+#include <deque>
+#include <thread>
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+
+// Reads a file by big blocks from its start to its end, as the full
+// indexing does, following the I/O policy of the process so the scans
+// of multi-GB files do not evict everything else from the system's
+// cache (on shared hosts):
+//  - Cached: the file is read as any other,
+//  - Sequential: the system is told the file is read sequentially
+//    (reading further ahead) and the data read are dropped from its
+//    cache behind the reader,
+//  - Direct: the file is read bypassing the cache (O_DIRECT) by aligned
+//    blocks, which is Sequential where it is not supported.
+// The hints are only given on POSIX systems.
+// This class is reentrant.
+class ScanReader {
+  public:
+    enum Policy { Cached, Sequential, Direct };
+
+    // Set the policy of the scans started afterwards (Cached by default)
+    static void setPolicy( Policy policy );
+    static Policy policy();
+
+    // The file must be open, it is read through its descriptor (or
+    // another one opened on it), its position being left unchanged, so
+    // it can be used by another thread meanwhile.
+    ScanReader( QFile& file );
+    ~ScanReader();
+
+    // Returns up to length bytes of the file from position, less at
+    // its end and nothing if they cannot be read.
+    QByteArray read( qint64 position, qint64 length );
+
+    // Drop the data of the file (opened as fd) between begin and end
+    // from the system's cache and have it read the readAhead bytes
+    // after them, as the scan is going on there, if the policy is
+    // not Cached.
+    static void release( int fd, qint64 begin, qint64 end );
+
+    // Data asked to be read ahead of a scan by release (16 MiB)
+    static const qint64 readAhead;
+
+  private:
+    QFile& file_;
+#ifdef WIN32
+    // The file opened again, to be read from
+    QFile ownFile_;
+#endif
+    const Policy policy_;
+    // The descriptor the file is read through with O_DIRECT (-1 if not)
+    int directFd_;
+    // Aligned buffer of the direct reads
+    char* directBuffer_;
+    qint64 directBufferSize_;
+
+    ScanReader( const ScanReader& ) = delete;
+    ScanReader& operator=( const ScanReader& ) = delete;
+};
+
+// Reads a file by consecutive blocks through a ScanReader, a thread of
+// its own reading up to depth blocks ahead of the one returned, so the
+// disk is kept busy while the blocks are processed (rather than idle
+// while each one is).
+// The blocks are read until the end of the file, as it is when they are.
+class BlockPrefetcher {
+  public:
+    // The file must be open (see ScanReader)
+    BlockPrefetcher( QFile& file, qint64 position, qint64 blockSize,
+            int depth = defaultDepth );
+    // Stops the reading thread
+    ~BlockPrefetcher();
+
+    // Returns the next block (less than blockSize bytes long at the end
+    // of the file), empty if there is none.
+    QByteArray next();
+    // Sets the size of the blocks read from now on (the ones read
+    // ahead already keeping theirs), see BlockSizer
+    void setBlockSize( qint64 blockSize );
+
+    // Blocks read ahead by default (double buffering)
+    static const int defaultDepth = 2;
+
+  private:
+    // Reads the blocks, in the reading thread
+    void run();
+
+    ScanReader reader_;
+    const int depth_;
+    // Position of the next block to read (by the reading thread)
+    qint64 position_;
+
+    // Protects everything below
+    QMutex mutex_;
+    QWaitCondition cond_;
+    qint64 blockSize_;
+    std::deque<QByteArray> blocks_;
+    bool ended_;
+    bool terminate_;
+
+    std::thread thread_;
+};
+
+// Sizes the blocks a scan reads so each one takes about targetLatency
+// to read and process, at the rate measured on the last ones: bigger
+// blocks on fast disks (fewer hand-overs between the threads), smaller
+// ones on slow network mounts (the scan being interrupted and its
+// progress shown sooner).
+// The sizes are multiples of blockAlignment (as the direct reads need).
+class BlockSizer {
+  public:
+    BlockSizer( qint64 initialSize );
+
+    // Size of the next blocks to read
+    qint64 size() const { return size_; }
+    // Report that a block of size bytes took nsecs nanoseconds to read
+    // and process
+    void processed( qint64 size, qint64 nsecs );
+
+    // Time a block should take (in ms)
+    static const qint64 targetLatency;
+    // Bounds of the size of the blocks
+    static const qint64 minSize;
+    static const qint64 maxSize;
+    static const qint64 blockAlignment;
+
+  private:
+    qint64 size_;
+    // Bytes per nanosecond, averaged over the last blocks
+    // (0 before the first one)
+    double rate_;
+};
+
+#endif
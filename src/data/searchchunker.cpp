@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements SearchChunker, sizing the chunks of a search.
+
+#include "searchchunker.h"
+
+#include <QtGlobal>
+
+const qint64 SearchChunker::targetLatency = 50;
+const qint64 SearchChunker::minChunkSize = 64 * 1024;
+const qint64 SearchChunker::maxChunkSize = 8 * 1024 * 1024;
+const qint64 SearchChunker::initialChunkSize = 1024 * 1024;
+const qint64 SearchChunker::minLinesInChunk = 256;
+const qint64 SearchChunker::maxLinesInChunk = 256 * 1024;
+const qint64 SearchChunker::initialLinesInChunk = 5000;
+
+SearchChunker::SearchChunker( qint64 firstLine, qint64 endLine,
+        LinesSize linesSize )
+    : endLine_( endLine ), linesSize_( linesSize ), mutex_(),
+    bounds_( 1, firstLine ), nbLinesSearched_( 0 ), nbBytesSearched_( 0 ),
+    searchTime_( 0 )
+{
+}
+
+bool SearchChunker::chunk( qint64 index, qint64* first, qint64* end )
+{
+    QMutexLocker locker( &mutex_ );
+
+    while ( (qint64) bounds_.size() <= index + 1 ) {
+        if ( bounds_.back() >= endLine_ )
+            return false;
+        bounds_.push_back( chunkEnd( bounds_.back() ) );
+    }
+
+    *first = bounds_[index];
+    *end   = bounds_[index + 1];
+
+    return true;
+}
+
+void SearchChunker::searched( qint64 nbLines, qint64 nbBytes, qint64 nsecs )
+{
+    QMutexLocker locker( &mutex_ );
+
+    nbLinesSearched_ += nbLines;
+    if ( nbBytes > 0 )
+        nbBytesSearched_ += nbBytes;
+    searchTime_ += nsecs;
+}
+
+qint64 SearchChunker::chunkEnd( qint64 first ) const
+{
+    const qint64 maxLines = qMin( maxLinesInChunk, endLine_ - first );
+    // (in ns)
+    const double latency = targetLatency * 1000000.0;
+
+    if ( linesSize_( first, first + 1 ) < 0 ) {
+        const qint64 nbLines = ( searchTime_ > 0 ) ?
+            qint64( nbLinesSearched_ * latency / searchTime_ ) :
+            initialLinesInChunk;
+        return first + qBound( qMin( minLinesInChunk, maxLines ),
+                nbLines, maxLines );
+    }
+
+    const qint64 chunkSize = ( searchTime_ > 0 && nbBytesSearched_ > 0 ) ?
+        qBound( minChunkSize,
+                qint64( nbBytesSearched_ * latency / searchTime_ ),
+                maxChunkSize ) :
+        initialChunkSize;
+
+    // The most lines within the size (at least one): doubled
+    // until over it, then found by bisection.
+    qint64 nbLines = 1;
+    qint64 over = maxLines + 1;
+    while ( nbLines < maxLines ) {
+        const qint64 next = qMin( nbLines * 2, maxLines );
+        if ( linesSize_( first, first + next ) > chunkSize ) {
+            over = next;
+            break;
+        }
+        nbLines = next;
+    }
+    while ( over - nbLines > 1 ) {
+        const qint64 middle = nbLines + ( over - nbLines ) / 2;
+        if ( linesSize_( first, first + middle ) > chunkSize )
+            over = middle;
+        else
+            nbLines = middle;
+    }
+
+    return first + nbLines;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCHCHUNKER_H
+#define SEARCHCHUNKER_H
+
+#include <functional>
+#include <vector>
+
+#include <QMutex>
+
+// Splits the lines a search reads in chunks of about the same size in
+// bytes (rather than in lines), the size being adapted to the measured
+// search throughput so a chunk takes about targetLatency to search:
+// the progress (and the matches) are reported at that pace, whatever
+// the length of the lines.
+// A chunk is searched by a single thread, so its size is limited
+// (the lines of a chunk being decoded at once).
+// When the size of the lines is not known, the chunks are sized in
+// lines from the measured throughput in lines.
+// All functions are thread safe.
+class SearchChunker
+{
+  public:
+    // Returns the size in bytes of the lines from the first to the
+    // last (excluded), -1 if it is not known
+    typedef std::function<qint64( qint64, qint64 )> LinesSize;
+
+    // Time a chunk should take to search (in ms)
+    static const qint64 targetLatency;
+    // Bounds of the size of a chunk (in bytes), and its size before
+    // the throughput is known
+    static const qint64 minChunkSize;
+    static const qint64 maxChunkSize;
+    static const qint64 initialChunkSize;
+    // Bounds of the number of lines in a chunk (the lower one only
+    // for the chunks sized in lines), and the number of lines used
+    // before the throughput is known if the size is not
+    static const qint64 minLinesInChunk;
+    static const qint64 maxLinesInChunk;
+    static const qint64 initialLinesInChunk;
+
+    // Chunks of the lines from firstLine to endLine (excluded)
+    SearchChunker( qint64 firstLine, qint64 endLine, LinesSize linesSize );
+
+    // Get the lines of the index-th chunk, returns false past the last
+    // one. The chunks are sized when first asked for, in order.
+    bool chunk( qint64 index, qint64* first, qint64* end );
+    // Report the search of a chunk of nbLines lines and nbBytes bytes
+    // (-1 if not known) which took nsecs nanoseconds
+    void searched( qint64 nbLines, qint64 nbBytes, qint64 nsecs );
+
+  private:
+    // Returns the end of the chunk starting at first
+    // (with mutex_ held)
+    qint64 chunkEnd( qint64 first ) const;
+
+    const qint64 endLine_;
+    const LinesSize linesSize_;
+
+    mutable QMutex mutex_;
+    // The beginning of each chunk sized, and the end of the last one
+    std::vector<qint64> bounds_;
+    // Totals of the chunks searched
+    qint64 nbLinesSearched_;
+    qint64 nbBytesSearched_;
+    qint64 searchTime_;
+};
+
+#endif
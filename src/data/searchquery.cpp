@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements SearchQuery
+
+#include "searchquery.h"
+
+// Recursive descent parser for:
+//     or   := and ( "OR" and )*
+//     and  := not ( [ "AND" ] not )*
+//     not  := "NOT" not | term | "(" or ")"
+class SearchQuery::Parser
+{
+  public:
+    Parser( const QString& text, Qt::CaseSensitivity caseSensitivity,
+            SearchQuery* query )
+        : text_( text ), position_( 0 ), caseSensitivity_( caseSensitivity ),
+        query_( query ), token_( End ), tokenText_() {}
+
+    // Returns the root node, or -1 if the query is invalid
+    int parse()
+    {
+        nextToken();
+        if ( token_ == End ) {
+            error( "empty query" );
+            return -1;
+        }
+
+        const int root = parseOr();
+        if ( root != -1 && token_ != End ) {
+            error( "unexpected " + describeToken() );
+            return -1;
+        }
+
+        return root;
+    }
+
+  private:
+    enum Token { End, Word, Quoted, OpenParen, CloseParen, And, Or, Not };
+
+    void nextToken()
+    {
+        while ( position_ < text_.size() && text_[position_].isSpace() )
+            position_++;
+
+        tokenText_.clear();
+
+        if ( position_ == text_.size() ) {
+            token_ = End;
+        }
+        else if ( text_[position_] == '(' ) {
+            token_ = OpenParen;
+            position_++;
+        }
+        else if ( text_[position_] == ')' ) {
+            token_ = CloseParen;
+            position_++;
+        }
+        else if ( text_[position_] == '"' ) {
+            token_ = Quoted;
+            position_++;
+            while ( position_ < text_.size() && text_[position_] != '"' ) {
+                // Only the quote is escaped, the other backslashes
+                // belong to the regular expression.
+                if ( text_[position_] == '\\' && position_ + 1 < text_.size()
+                        && text_[position_ + 1] == '"' )
+                    position_++;
+                tokenText_ += text_[position_++];
+            }
+            if ( position_ == text_.size() )
+                error( "missing closing quote" );
+            else
+                position_++;
+        }
+        else {
+            while ( position_ < text_.size() && ! text_[position_].isSpace()
+                    && text_[position_] != '(' && text_[position_] != ')' )
+                tokenText_ += text_[position_++];
+
+            if ( tokenText_ == "AND" )
+                token_ = And;
+            else if ( tokenText_ == "OR" )
+                token_ = Or;
+            else if ( tokenText_ == "NOT" )
+                token_ = Not;
+            else
+                token_ = Word;
+        }
+    }
+
+    int parseOr()
+    {
+        int left = parseAnd();
+        while ( left != -1 && token_ == Or ) {
+            nextToken();
+            const int right = parseAnd();
+            if ( right == -1 )
+                return -1;
+            left = addNode( Node( Node::Or, -1, left, right ) );
+        }
+
+        return left;
+    }
+
+    int parseAnd()
+    {
+        int left = parseNot();
+        while ( left != -1 ) {
+            if ( token_ == And )
+                nextToken();
+            else if ( token_ != Word && token_ != Quoted
+                    && token_ != OpenParen && token_ != Not )
+                break;
+
+            const int right = parseNot();
+            if ( right == -1 )
+                return -1;
+            left = addNode( Node( Node::And, -1, left, right ) );
+        }
+
+        return left;
+    }
+
+    int parseNot()
+    {
+        if ( ! query_->error_.isEmpty() )
+            return -1;
+
+        switch ( token_ ) {
+            case Not:
+                {
+                    nextToken();
+                    const int operand = parseNot();
+                    if ( operand == -1 )
+                        return -1;
+                    return addNode( Node( Node::Not, -1, operand, -1 ) );
+                }
+            case Word:
+            case Quoted:
+                {
+                    const int term = addTerm( tokenText_ );
+                    nextToken();
+                    if ( term == -1 )
+                        return -1;
+                    return addNode( Node( Node::Term, term, -1, -1 ) );
+                }
+            case OpenParen:
+                {
+                    nextToken();
+                    const int node = parseOr();
+                    if ( node == -1 )
+                        return -1;
+                    if ( token_ != CloseParen ) {
+                        error( "missing closing parenthesis" );
+                        return -1;
+                    }
+                    nextToken();
+                    return node;
+                }
+            default:
+                error( "unexpected " + describeToken() );
+                return -1;
+        }
+    }
+
+    int addNode( const Node& node )
+    {
+        query_->nodes_.push_back( node );
+        return query_->nodes_.size() - 1;
+    }
+
+    // Returns the index of the term, adding it if it is new
+    int addTerm( const QString& pattern )
+    {
+        if ( pattern.isEmpty() ) {
+            error( "empty term" );
+            return -1;
+        }
+
+        const QRegExp regexp( pattern, caseSensitivity_, QRegExp::RegExp2 );
+        if ( ! regexp.isValid() ) {
+            error( "in term '" + pattern + "': " + regexp.errorString() );
+            return -1;
+        }
+
+        std::vector<QRegExp>& terms = query_->terms_;
+        for ( size_t i = 0; i < terms.size(); i++ ) {
+            if ( terms[i] == regexp )
+                return i;
+        }
+
+        terms.push_back( regexp );
+        return terms.size() - 1;
+    }
+
+    QString describeToken() const
+    {
+        switch ( token_ ) {
+            case End:        return "end of query";
+            case CloseParen: return "')'";
+            case OpenParen:  return "'('";
+            case And:        return "AND";
+            case Or:         return "OR";
+            case Not:        return "NOT";
+            default:         return "'" + tokenText_ + "'";
+        }
+    }
+
+    // Only the first error is kept
+    void error( const QString& message )
+    {
+        if ( query_->error_.isEmpty() )
+            query_->error_ = message;
+    }
+
+    const QString text_;
+    int position_;
+    const Qt::CaseSensitivity caseSensitivity_;
+    SearchQuery* query_;
+
+    Token token_;
+    QString tokenText_;
+};
+
+SearchQuery::SearchQuery( const QString& text,
+        Qt::CaseSensitivity caseSensitivity )
+    : nodes_(), root_( -1 ), terms_(), error_()
+{
+    root_ = Parser( text, caseSensitivity, this ).parse();
+
+    if ( ! error_.isEmpty() ) {
+        nodes_.clear();
+        terms_.clear();
+        root_ = -1;
+    }
+}
+
+MatchSet SearchQuery::evaluate( const std::vector<MatchSet>& termMatches,
+        LineNumber nbLines ) const
+{
+    if ( root_ == -1 )
+        return MatchSet();
+
+    return evaluateNode( root_, termMatches, nbLines );
+}
+
+MatchSet SearchQuery::evaluateNode( int index,
+        const std::vector<MatchSet>& termMatches, LineNumber nbLines ) const
+{
+    const Node& node = nodes_[index];
+
+    switch ( node.type ) {
+        case Node::Term:
+            return termMatches[node.term];
+        case Node::Not:
+            return evaluateNode( node.left, termMatches, nbLines )
+                .complemented( nbLines );
+        case Node::Or:
+            return evaluateNode( node.left, termMatches, nbLines ).united(
+                    evaluateNode( node.right, termMatches, nbLines ) );
+        case Node::And:
+            {
+                // "a AND NOT b" is a difference, no need to build
+                // the (big) complement of b.
+                const Node& left = nodes_[node.left];
+                const Node& right = nodes_[node.right];
+                if ( right.type == Node::Not )
+                    return evaluateNode( node.left, termMatches, nbLines )
+                        .subtracted( evaluateNode( right.left, termMatches, nbLines ) );
+                else if ( left.type == Node::Not )
+                    return evaluateNode( node.right, termMatches, nbLines )
+                        .subtracted( evaluateNode( left.left, termMatches, nbLines ) );
+                else
+                    return evaluateNode( node.left, termMatches, nbLines )
+                        .intersected( evaluateNode( node.right, termMatches, nbLines ) );
+            }
+    }
+
+    return MatchSet();
+}
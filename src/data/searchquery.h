@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCHQUERY_H
+#define SEARCHQUERY_H
+
+#include <vector>
+
+#include <QString>
+#include <QRegExp>
+
+#include "matchset.h"
+
+// A boolean combination of search terms, for instance:
+//     ERROR AND NOT (healthcheck OR "keep alive")
+// Terms are regular expressions, to be quoted if they contain spaces,
+// parentheses or double quotes (written \" inside the quotes).
+// The operators are NOT, AND and OR (upper case, in decreasing order
+// of precedence), two terms with no operator between them being ANDed.
+// The query is evaluated from the matches of each of its terms,
+// so the terms already searched for need not be searched again.
+class SearchQuery
+{
+  public:
+    // Parse the passed query, the terms using the passed case sensitivity
+    SearchQuery( const QString& text, Qt::CaseSensitivity caseSensitivity );
+
+    // Returns whether the query has been parsed successfully
+    bool isValid() const { return error_.isEmpty(); }
+    // Returns the reason the query is invalid
+    QString errorString() const { return error_; }
+
+    // Returns the (distinct) terms of the query
+    const std::vector<QRegExp>& terms() const { return terms_; }
+
+    // Returns the lines matching the query, from the matches of each
+    // term (in the order of terms()) over the nbLines first lines.
+    MatchSet evaluate( const std::vector<MatchSet>& termMatches,
+            LineNumber nbLines ) const;
+
+  private:
+    class Parser;
+
+    struct Node {
+        enum Type { Term, Not, And, Or };
+
+        Node( Type type, int term, int left, int right )
+            : type( type ), term( term ), left( left ), right( right ) {}
+
+        Type type;
+        // Index in terms_ (Term)
+        int term;
+        // Operands (the only one being left for Not)
+        int left;
+        int right;
+    };
+
+    MatchSet evaluateNode( int node, const std::vector<MatchSet>& termMatches,
+            LineNumber nbLines ) const;
+
+    std::vector<Node> nodes_;
+    int root_;
+    std::vector<QRegExp> terms_;
+    QString error_;
+};
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements SkipIndex
+
+#include "skipindex.h"
+
+#include <algorithm>
+
+#include "literalprefilter.h"
+
+// About 10,000 lines of 100 bytes: a block skipped saves reading them,
+// a block read costs probing its filter once per key.
+const int SkipIndex::blockSize = 1024*1024;
+
+namespace {
+
+// Length of the runs of bytes of the long words, and the step between
+// them: a word of at least gramLength + gramStep - 1 bytes always has
+// one of the first gramStep runs of its occurrences.
+const int gramLength = 8;
+const int gramStep = 4;
+
+// The Bloom filters have 4 probes and 10 bits per key (about 1% of
+// false positives).
+const int nbProbes = 4;
+const int bitsPerKey = 10;
+const int minimumBits = 512;
+
+// What a key is made of
+const char wholeWord = 'w';
+const char wordGram = 'g';
+
+inline bool isWordByte( unsigned char c )
+{
+    return ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'z' )
+        || ( c >= 'A' && c <= 'Z' ) || c == '_';
+}
+
+inline unsigned char foldCase( unsigned char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? c + ( 'a' - 'A' ) : c;
+}
+
+// Returns the key of the passed bytes, of the passed kind
+// (FNV-1a of the folded bytes, then mixed as in MurmurHash3)
+quint64 key( char kind, const unsigned char* data, int length )
+{
+    quint64 hash = 14695981039346656037ULL;
+    hash = ( hash ^ (unsigned char) kind ) * 1099511628211ULL;
+    for ( int i = 0; i < length; i++ )
+        hash = ( hash ^ foldCase( data[i] ) ) * 1099511628211ULL;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+// Calls f with each bit of the key in a filter of nb_bits bits
+// (double hashing)
+template <typename F>
+inline void forEachBit( quint64 key, quint64 nb_bits, F f )
+{
+    const quint64 step = ( key >> 32 ) | 1;
+    for ( int i = 0; i < nbProbes; i++ )
+        f( ( key + i * step ) & ( nb_bits - 1 ) );
+}
+
+}
+
+SkipIndex::Builder::Builder( Blocks* blocks )
+    : blocks_( blocks ), line_( 0 ), firstLine_( 0 ), size_( 0 ), keys_()
+{
+}
+
+void SkipIndex::Builder::addLine( const char* data, int length )
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+
+    for ( int i = 0; i < length; ) {
+        if ( ! isWordByte( bytes[i] ) ) {
+            i++;
+            continue;
+        }
+
+        int end = i + 1;
+        while ( end < length && isWordByte( bytes[end] ) )
+            end++;
+
+        keys_.push_back( key( wholeWord, bytes + i, end - i ) );
+        for ( int gram = i; gram + gramLength <= end; gram += gramStep )
+            keys_.push_back( key( wordGram, bytes + gram, gramLength ) );
+
+        i = end;
+    }
+
+    line_++;
+    size_ += length + 1;
+    if ( size_ >= blockSize )
+        finish();
+}
+
+void SkipIndex::Builder::skipLine()
+{
+    finish();
+    line_++;
+    firstLine_ = line_;
+}
+
+void SkipIndex::Builder::finish()
+{
+    if ( line_ > firstLine_ ) {
+        std::sort( keys_.begin(), keys_.end() );
+        keys_.erase( std::unique( keys_.begin(), keys_.end() ), keys_.end() );
+
+        quint64 nb_bits = minimumBits;
+        while ( nb_bits < keys_.size() * bitsPerKey )
+            nb_bits *= 2;
+
+        std::shared_ptr<std::vector<quint64>> bits =
+            std::make_shared<std::vector<quint64>>( nb_bits / 64 );
+        for ( quint64 k : keys_ )
+            forEachBit( k, nb_bits, [&bits]( quint64 bit )
+                    { (*bits)[bit / 64] |= quint64( 1 ) << ( bit % 64 ); } );
+
+        blocks_->push_back( { firstLine_, line_ - firstLine_, bits } );
+    }
+
+    keys_.clear();
+    size_ = 0;
+    firstLine_ = line_;
+}
+
+void SkipIndex::append( const Blocks& blocks, qint64 first_line )
+{
+    for ( const Block& block : blocks ) {
+        const qint64 line = first_line + block.firstLine;
+        // Only the lines following the ones indexed can be added
+        if ( ! blocks_.empty()
+                && line < blocks_.back().firstLine + blocks_.back().nbLines )
+            continue;
+
+        blocks_.push_back( { line, block.nbLines, block.bits } );
+    }
+}
+
+void SkipIndex::truncate( qint64 nb_lines )
+{
+    while ( ! blocks_.empty()
+            && blocks_.back().firstLine + blocks_.back().nbLines > nb_lines )
+        blocks_.pop_back();
+}
+
+SkipIndex::Query SkipIndex::query( const QRegExp& regexp )
+{
+    Query query;
+
+    for ( const std::string& literal : LiteralPrefilter::requiredLiterals( regexp ) ) {
+        const unsigned char* bytes =
+            reinterpret_cast<const unsigned char*>( literal.data() );
+        const int length = literal.size();
+
+        for ( int i = 0; i < length; ) {
+            if ( ! isWordByte( bytes[i] ) ) {
+                i++;
+                continue;
+            }
+
+            int end = i + 1;
+            while ( end < length && isWordByte( bytes[end] ) )
+                end++;
+
+            if ( i > 0 && end < length ) {
+                // Separated on both sides, it is a whole word of the line
+                query.push_back( { key( wholeWord, bytes + i, end - i ) } );
+            }
+            else if ( end - i >= gramLength + gramStep - 1 ) {
+                // It might be part of a longer word, which has one of
+                // its first runs.
+                std::vector<quint64> grams;
+                for ( int gram = i; gram < i + gramStep; gram++ )
+                    grams.push_back( key( wordGram, bytes + gram, gramLength ) );
+                query.push_back( grams );
+            }
+
+            i = end;
+        }
+    }
+
+    return query;
+}
+
+void SkipIndex::linesToSearch( const Query& query, qint64 first, qint64 end,
+        std::vector<std::pair<qint64, qint64>>* ranges ) const
+{
+    ranges->clear();
+
+    qint64 line = first;
+    if ( ! query.empty() ) {
+        // The first block ending after first
+        auto block = std::upper_bound( blocks_.begin(), blocks_.end(), first,
+                []( qint64 line, const Block& block )
+                { return line < block.firstLine + block.nbLines; } );
+
+        for ( ; block != blocks_.end() && block->firstLine < end; ++block ) {
+            if ( mightMatch( *block, query ) )
+                continue;
+
+            const qint64 skipped = qMax( block->firstLine, first );
+            if ( skipped > line )
+                ranges->push_back( { line, skipped } );
+            line = qMin( block->firstLine + block->nbLines, end );
+        }
+    }
+
+    if ( line < end )
+        ranges->push_back( { line, end } );
+}
+
+bool SkipIndex::mightMatch( const Block& block, const Query& query )
+{
+    const std::vector<quint64>& bits = *block.bits;
+    const quint64 nb_bits = bits.size() * 64;
+
+    for ( const std::vector<quint64>& keys : query ) {
+        bool found = false;
+        for ( quint64 k : keys ) {
+            bool all = true;
+            forEachBit( k, nb_bits, [&]( quint64 bit )
+                    { all = all && ( bits[bit / 64] & ( quint64( 1 ) << ( bit % 64 ) ) ); } );
+            if ( all ) {
+                found = true;
+                break;
+            }
+        }
+
+        if ( ! found )
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SKIPINDEX_H
+#define SKIPINDEX_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QRegExp>
+#include <QtGlobal>
+
+// A sketch of the words of a file by blocks of about blockSize bytes of
+// lines, built while the file is indexed, so a search for a pattern
+// whose matches must contain some words (like a trace id) skips the
+// blocks which cannot have any match.
+// Each block has a Bloom filter of the (hashed) words of its lines,
+// and of the runs of 8 bytes starting every 4 bytes in the long ones,
+// so a word can also be looked for in the middle of another.
+// The words are the runs of ASCII letters, digits and '_' of the raw
+// data (any other byte separating them) folded to lower case, so the
+// sketch can be used for case insensitive searches too.
+// A false positive only makes a block read for nothing.
+// The blocks are shared between the copies of the index.
+class SkipIndex
+{
+  public:
+    // The sketch of a block of consecutive lines
+    struct Block {
+        qint64 firstLine;
+        qint64 nbLines;
+        // The bits of the Bloom filter (a power of two of them)
+        std::shared_ptr<const std::vector<quint64>> bits;
+    };
+    typedef std::vector<Block> Blocks;
+
+    // Builds the blocks of the lines as they are scanned, numbered
+    // from 0. This class is reentrant.
+    class Builder {
+      public:
+        explicit Builder( Blocks* blocks );
+
+        // Add the next line (without its end of line)
+        void addLine( const char* data, int length );
+        // The next line is left out of the blocks (only its end has
+        // been scanned)
+        void skipLine();
+        // Close the block of the last lines added
+        void finish();
+
+      private:
+        Blocks* blocks_;
+        qint64 line_;
+        qint64 firstLine_;
+        qint64 size_;
+        std::vector<quint64> keys_;
+    };
+
+    // The keys a line must have to match a pattern: at least one of
+    // each set of keys.
+    typedef std::vector<std::vector<quint64>> Query;
+
+    SkipIndex() : blocks_() {}
+
+    // Add the blocks of lines following the ones indexed, their line
+    // numbers being relative to first_line.
+    void append( const Blocks& blocks, qint64 first_line );
+    // Remove the blocks of the lines from nb_lines
+    void truncate( qint64 nb_lines );
+
+    // Number of blocks
+    qint64 size() const { return blocks_.size(); }
+
+    // Returns the keys required by the matches of the passed regexp
+    // (none if nothing can be required from them).
+    static Query query( const QRegExp& regexp );
+
+    // Sets ranges to the ranges of lines [first, last) between first
+    // and end which might have a line having the keys of the query,
+    // the lines of the blocks which cannot being left out.
+    void linesToSearch( const Query& query, qint64 first, qint64 end,
+            std::vector<std::pair<qint64, qint64>>* ranges ) const;
+
+    // Approximate size of the data of a block
+    static const int blockSize;
+
+  private:
+    // Returns whether the block might have all the keys of the query
+    static bool mightMatch( const Block& block, const Query& query );
+
+    Blocks blocks_;
+};
+
+#endif
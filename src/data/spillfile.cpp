@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements SpillFile
+
+#include "spillfile.h"
+
+#include <QDir>
+
+#include "log.h"
+
+namespace {
+    // Alignment of the data written
+    const qint64 spillAlignment = 8;
+}
+
+SpillFile::SpillFile()
+    : file_( QDir::tempPath() + "/glogg_spill_XXXXXX" ), mapping_( nullptr )
+{
+    if ( ! file_.open() )
+        LOG(logWARNING) << "Cannot create the spill file "
+            << file_.fileTemplate().toStdString();
+}
+
+qint64 SpillFile::append( const void* data, qint64 size )
+{
+    if ( ! file_.isOpen() || mapping_ )
+        return -1;
+
+    const qint64 offset = ( file_.size() + spillAlignment - 1 )
+        & ~( spillAlignment - 1 );
+    if ( ! file_.resize( offset ) || ! file_.seek( offset ) )
+        return -1;
+    if ( size > 0 && file_.write( static_cast<const char*>( data ), size ) != size )
+        return -1;
+
+    return offset;
+}
+
+bool SpillFile::map()
+{
+    if ( ! file_.isOpen() || ! file_.flush() )
+        return false;
+
+    // Nothing to read from an empty file
+    if ( file_.size() == 0 )
+        return true;
+
+    mapping_ = file_.map( 0, file_.size() );
+    if ( ! mapping_ )
+        LOG(logWARNING) << "Cannot map the spill file "
+            << file_.fileName().toStdString();
+
+    return mapping_ != nullptr;
+}
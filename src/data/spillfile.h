@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPILLFILE_H
+#define SPILLFILE_H
+
+#include <QTemporaryFile>
+
+// A temporary file the data evicted from memory is written to, then
+// mapped: the data is read from the mapping, paged in by the system
+// when accessed and dropped again under memory pressure (as the file
+// cache is), rather than taking the memory of the process.
+// The file is removed when the object is destroyed.
+class SpillFile
+{
+  public:
+    // Creates the file in the temporary directory
+    SpillFile();
+
+    // Write the passed data at the end of the file (aligned for any
+    // type), returns its offset or -1 if it cannot be written.
+    qint64 append( const void* data, qint64 size );
+    // Map the file once all the data has been written,
+    // returns false if it cannot be.
+    bool map();
+    // Returns the data written at offset (once mapped)
+    const char* data( qint64 offset ) const
+    { return reinterpret_cast<const char*>( mapping_ ) + offset; }
+
+  private:
+    QTemporaryFile file_;
+    uchar* mapping_;
+};
+
+#endif
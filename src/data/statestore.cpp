@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "statestore.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+
+#include "log.h"
+
+namespace {
+    // Identifies glogg's state files
+    const quint32 STATE_MAGIC = 0x676c7374; // "glst"
+    const quint32 STATE_VERSION = 1;
+
+    enum RecordType { SetRecord = 1, RemoveRecord = 2 };
+
+    // Files smaller than this are never compacted
+    const qint64 MIN_COMPACTED_SIZE = 256*1024;
+
+    quint16 recordChecksum( const QString& key, const QByteArray& value )
+    {
+        const QByteArray data = key.toUtf8() + value;
+        return qChecksum( data.constData(), data.size() );
+    }
+
+    void writeRecord( QDataStream& out, const QString& key,
+            const QByteArray* value )
+    {
+        if ( value ) {
+            out << static_cast<quint8>( SetRecord ) << key << *value
+                << recordChecksum( key, *value );
+        }
+        else {
+            out << static_cast<quint8>( RemoveRecord ) << key
+                << recordChecksum( key, QByteArray() );
+        }
+    }
+}
+
+StateStore::StateStore( const QString& fileName )
+    : fileName_( fileName ), mutex_(), items_(), fileSize_( 0 )
+{
+    QMutexLocker locker( &mutex_ );
+
+    load();
+}
+
+StateStore& StateStore::instance()
+{
+#if QT_VERSION >= 0x050000
+    static StateStore store( QStandardPaths::writableLocation(
+                QStandardPaths::DataLocation ) + "/state" );
+#else
+    static StateStore store( QDir::homePath() + "/.local/share/glogg/state" );
+#endif
+
+    return store;
+}
+
+QByteArray StateStore::value( const QString& key ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return items_.value( key );
+}
+
+bool StateStore::contains( const QString& key ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return items_.contains( key );
+}
+
+void StateStore::setValue( const QString& key, const QByteArray& value )
+{
+    QMutexLocker locker( &mutex_ );
+
+    // (the same state is often saved again)
+    auto i = items_.constFind( key );
+    if ( i != items_.constEnd() && i.value() == value )
+        return;
+
+    items_.insert( key, value );
+    append( key, &value );
+}
+
+void StateStore::remove( const QString& key )
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( items_.remove( key ) > 0 )
+        append( key, nullptr );
+}
+
+qint64 StateStore::fileSize() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return fileSize_;
+}
+
+void StateStore::load()
+{
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return;
+
+    QDataStream in( &file );
+    in.setVersion( QDataStream::Qt_4_6 );
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if ( in.status() != QDataStream::Ok
+            || magic != STATE_MAGIC || version != STATE_VERSION ) {
+        LOG(logWARNING) << "Unknown state file " << fileName_.toStdString()
+            << ", starting afresh";
+        return;
+    }
+
+    qint64 valid_size = file.pos();
+    qint64 live_size = 0;
+    while ( ! in.atEnd() ) {
+        quint8 type;
+        QString key;
+        QByteArray value;
+        quint16 checksum;
+        in >> type >> key;
+        if ( type == SetRecord )
+            in >> value;
+        in >> checksum;
+
+        if ( in.status() != QDataStream::Ok
+                || ( type != SetRecord && type != RemoveRecord )
+                || checksum != recordChecksum( key, value ) ) {
+            LOG(logWARNING) << "State file " << fileName_.toStdString()
+                << " cut short at " << valid_size;
+            break;
+        }
+
+        if ( type == SetRecord )
+            items_.insert( key, value );
+        else
+            items_.remove( key );
+        valid_size = file.pos();
+    }
+
+    fileSize_ = valid_size;
+    for ( auto i = items_.constBegin(); i != items_.constEnd(); ++i )
+        live_size += 2 * i.key().size() + i.value().size();
+
+    LOG(logDEBUG) << "Loaded the state file " << fileName_.toStdString()
+        << ": " << items_.size() << " items, " << fileSize_ << " bytes";
+
+    // The records after a bad one must not be appended to
+    if ( valid_size < file.size()
+            || ( fileSize_ > MIN_COMPACTED_SIZE && live_size * 2 < fileSize_ ) ) {
+        file.close();
+        compact();
+    }
+}
+
+void StateStore::append( const QString& key, const QByteArray* value )
+{
+    // The header is written with the first item
+    if ( fileSize_ == 0 ) {
+        compact();
+        return;
+    }
+
+    QFile file( fileName_ );
+    if ( ! file.open( QIODevice::WriteOnly | QIODevice::Append ) ) {
+        LOG(logWARNING) << "Cannot write the state file "
+            << fileName_.toStdString();
+        return;
+    }
+
+    QDataStream out( &file );
+    out.setVersion( QDataStream::Qt_4_6 );
+    writeRecord( out, key, value );
+
+    fileSize_ = file.pos();
+}
+
+void StateStore::compact()
+{
+    const QString directory = QFileInfo( fileName_ ).absolutePath();
+    if ( ! QDir().mkpath( directory ) ) {
+        LOG(logWARNING) << "Cannot create the state directory "
+            << directory.toStdString();
+        return;
+    }
+
+    // Write to a temporary file first not to lose the items if
+    // interrupted
+    QFile file( fileName_ + ".new" );
+    if ( ! file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG(logWARNING) << "Cannot write the state file "
+            << file.fileName().toStdString();
+        return;
+    }
+
+    QDataStream out( &file );
+    out.setVersion( QDataStream::Qt_4_6 );
+    out << STATE_MAGIC << STATE_VERSION;
+    for ( auto i = items_.constBegin(); i != items_.constEnd(); ++i )
+        writeRecord( out, i.key(), &i.value() );
+
+    const qint64 size = file.pos();
+    file.close();
+
+    QFile::remove( fileName_ );
+    if ( ! QFile::rename( file.fileName(), fileName_ ) ) {
+        LOG(logWARNING) << "Cannot write the state file "
+            << fileName_.toStdString();
+        QFile::remove( file.fileName() );
+        return;
+    }
+
+    LOG(logDEBUG) << "Compacted the state file " << fileName_.toStdString()
+        << ": " << items_.size() << " items, " << size << " bytes";
+
+    fileSize_ = size;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATESTORE_H
+#define STATESTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+// Versioned binary store of the big items of the persistent state
+// (such as the search results and marks of each file), kept apart
+// from the QSettings holding the preferences so writing an item does
+// not parse and rewrite the whole of them.
+// The store is a file of records, appended to as the items are
+// written: after a header (magic and version), each record sets or
+// removes the value of a key, the last record of a key winning when
+// the file is read back. The file is compacted (written again with the
+// live items only) when opened, if most of it is dead records.
+// Each record is checksummed, a record cut short (e.g. by a crash
+// while writing) and the ones after it being dropped.
+// This class is thread safe.
+class StateStore
+{
+  public:
+    // A store in the passed file (created when first written to)
+    explicit StateStore( const QString& fileName );
+
+    // The store of the user, in the application data directory
+    static StateStore& instance();
+
+    // Returns the value of the key, empty if it has none
+    QByteArray value( const QString& key ) const;
+    bool contains( const QString& key ) const;
+    // Set the value of the key, written to the file at once (if
+    // changed)
+    void setValue( const QString& key, const QByteArray& value );
+    void remove( const QString& key );
+
+    // Size of the file, in bytes
+    qint64 fileSize() const;
+
+  private:
+    // Read the records of the file, compacting it if needed
+    // (with mutex_ held)
+    void load();
+    // Append a record to the file, a removal if value is null
+    // (with mutex_ held)
+    void append( const QString& key, const QByteArray* value );
+    // Write the file again with the live items only
+    // (with mutex_ held)
+    void compact();
+
+    const QString fileName_;
+
+    mutable QMutex mutex_;
+    QHash<QString, QByteArray> items_;
+    // Size of the file (0 if it has not been written to)
+    qint64 fileSize_;
+};
+
+#endif
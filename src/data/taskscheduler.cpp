@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "taskscheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <QThread>
+
+#include "log.h"
+#include "tracerecorder.h"
+
+class TaskScheduler::Task
+{
+  public:
+    enum State { Queued, Running, Ended };
+
+    std::function<void()> function;
+    // (read by yield() without the mutex)
+    std::atomic<Priority> priority;
+    unsigned long long sequence;
+    State state;
+    // Set when waited for, not to be paused
+    bool expedited;
+};
+
+namespace {
+    // The task run by the current thread of the pool
+    thread_local TaskScheduler::Task* currentTask = nullptr;
+}
+
+TaskScheduler& TaskScheduler::instance()
+{
+    // Never destroyed, its threads might still run when the
+    // static objects are.
+    static TaskScheduler* scheduler = new TaskScheduler();
+    return *scheduler;
+}
+
+TaskScheduler::TaskScheduler()
+    : mutex_(), taskQueuedCond_(), taskEndedCond_(), queue_(),
+    maxThreads_( 0 ), nbThreads_( 0 ), nbIdleThreads_( 0 ),
+    nbBusyThreads_( 0 ), nbPausedThreads_( 0 ), topQueuedPriority_( -1 ),
+    nextSequence_( 0 )
+{
+}
+
+TaskScheduler::TaskHandle TaskScheduler::submit(
+        std::function<void()> function, Priority priority )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    TaskHandle task = std::make_shared<Task>();
+    task->function  = std::move( function );
+    task->priority  = priority;
+    task->sequence  = nextSequence_++;
+    task->state     = Task::Queued;
+    task->expedited = false;
+    queue_.push_back( task );
+    queueChanged();
+
+    startThreadIfNeeded();
+    taskQueuedCond_.notify_one();
+
+    return task;
+}
+
+void TaskScheduler::setPriority( const TaskHandle& task, Priority priority )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    if ( ! task || task->state == Task::Ended )
+        return;
+
+    task->priority = priority;
+    if ( task->state == Task::Queued )
+        queueChanged();
+    // A paused task might resume, or another one pause
+    taskEndedCond_.notify_all();
+}
+
+bool TaskScheduler::cancel( const TaskHandle& task )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    if ( ! task || task->state != Task::Queued )
+        return false;
+
+    queue_.erase( std::find( queue_.begin(), queue_.end(), task ) );
+    queueChanged();
+    task->state = Task::Ended;
+    taskEndedCond_.notify_all();
+
+    return true;
+}
+
+void TaskScheduler::wait( const TaskHandle& task )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+
+    if ( task )
+        taskEndedCond_.wait( lock,
+                [&task] { return task->state == Task::Ended; } );
+}
+
+void TaskScheduler::expedite( const TaskHandle& task )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    if ( task && task->state != Task::Ended ) {
+        task->expedited = true;
+        taskEndedCond_.notify_all();
+    }
+}
+
+void TaskScheduler::yield()
+{
+    Task* const task = currentTask;
+
+    // Nothing queued above the task, checked without locking
+    // as the long tasks call it often.
+    if ( ! task || topQueuedPriority_ <= task->priority )
+        return;
+
+    std::unique_lock<std::mutex> lock( mutex_ );
+
+    if ( task->expedited || ! hasQueuedAbove( task->priority )
+            || nbBusyThreads_ < threadBudget() )
+        return;
+
+    LOG(logDEBUG) << "TaskScheduler: pausing a task";
+
+    // The thread is given to the tasks waiting
+    nbBusyThreads_--;
+    nbPausedThreads_++;
+    startThreadIfNeeded();
+    taskQueuedCond_.notify_one();
+
+    taskEndedCond_.wait( lock, [this, task] {
+            return task->expedited || ( ! hasQueuedAbove( task->priority )
+                && nbBusyThreads_ < threadBudget() ); } );
+
+    nbPausedThreads_--;
+    nbBusyThreads_++;
+    // The thread started in its place stops if idle
+    taskQueuedCond_.notify_all();
+
+    LOG(logDEBUG) << "TaskScheduler: resuming a task";
+}
+
+void TaskScheduler::setMaxThreads( int nbThreads )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    LOG(logDEBUG) << "TaskScheduler: up to " << nbThreads << " threads";
+
+    maxThreads_ = qMax( nbThreads, 0 );
+    startThreadIfNeeded();
+    // The idle threads over the budget stop, the paused ones
+    // might resume
+    taskQueuedCond_.notify_all();
+    taskEndedCond_.notify_all();
+}
+
+int TaskScheduler::maxThreads() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+
+    return threadBudget();
+}
+
+int TaskScheduler::threadBudget() const
+{
+    return maxThreads_ > 0 ? maxThreads_ : qMax( QThread::idealThreadCount(), 1 );
+}
+
+void TaskScheduler::startThreadIfNeeded()
+{
+    if ( ! queue_.empty() && nbIdleThreads_ == 0
+            && nbThreads_ - nbPausedThreads_ < threadBudget() ) {
+        nbThreads_++;
+        std::thread( &TaskScheduler::runTasks, this ).detach();
+    }
+}
+
+bool TaskScheduler::hasQueuedAbove( Priority priority ) const
+{
+    return std::any_of( queue_.begin(), queue_.end(),
+            [priority]( const TaskHandle& task ) {
+                return task->priority > priority; } );
+}
+
+void TaskScheduler::queueChanged()
+{
+    int top = -1;
+    for ( const TaskHandle& task : queue_ )
+        top = qMax<int>( top, task->priority );
+    topQueuedPriority_ = top;
+}
+
+void TaskScheduler::runTasks()
+{
+    TraceRecorder::nameThread( "TaskScheduler" );
+
+    std::unique_lock<std::mutex> lock( mutex_ );
+
+    for (;;) {
+        // The paused threads do not count, but resume before the
+        // tasks queued of their priority (Background, as only those
+        // can be paused) are started.
+        if ( nbThreads_ - nbPausedThreads_ > threadBudget()
+                || ( nbPausedThreads_ > 0 && ! queue_.empty()
+                    && nbBusyThreads_ + 1 >= threadBudget()
+                    && ! hasQueuedAbove( Background ) ) ) {
+            nbThreads_--;
+            taskEndedCond_.notify_all();
+            return;
+        }
+
+        if ( queue_.empty() ) {
+            nbIdleThreads_++;
+            taskQueuedCond_.wait( lock );
+            nbIdleThreads_--;
+            continue;
+        }
+
+        // The first submitted of the highest priority
+        auto next = std::min_element( queue_.begin(), queue_.end(),
+                []( const TaskHandle& a, const TaskHandle& b ) {
+                    return a->priority > b->priority
+                        || ( a->priority == b->priority
+                                && a->sequence < b->sequence ); } );
+        TaskHandle task = *next;
+        queue_.erase( next );
+        queueChanged();
+        task->state = Task::Running;
+        nbBusyThreads_++;
+
+        // Another thread for the tasks left, if the budget allows
+        startThreadIfNeeded();
+
+        lock.unlock();
+        currentTask = task.get();
+        task->function();
+        currentTask = nullptr;
+        // Released before the task is seen as ended
+        task->function = nullptr;
+        lock.lock();
+
+        nbBusyThreads_--;
+        task->state = Task::Ended;
+        taskEndedCond_.notify_all();
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs the indexing and search operations of all the files open on a
+// pool of threads they share, rather than on a thread per LogData and
+// LogFilteredData, mostly idle with many files open.
+// The pool grows with the tasks submitted up to its core budget, the
+// tasks of the highest priority running first (and in the order they
+// have been submitted for a same priority).
+// A task of a lower priority running when one of a higher priority is
+// queued is paused at its next yield() while the pool has no thread
+// left for it, so the tab displayed is not starved by the indexing of
+// a large file in a hidden one.
+// All functions are thread safe.
+class TaskScheduler
+{
+  public:
+    // The operations of the tab displayed run before the other ones
+    enum Priority { Background, Visible };
+
+    class Task;
+    typedef std::shared_ptr<Task> TaskHandle;
+
+    static TaskScheduler& instance();
+
+    // Queue the function to be run by a thread of the pool
+    TaskHandle submit( std::function<void()> function, Priority priority );
+    // Change the priority of the task, queued or running
+    void setPriority( const TaskHandle& task, Priority priority );
+    // Remove the task from the queue if it has not started,
+    // returns whether it has been (it will never run)
+    bool cancel( const TaskHandle& task );
+    // Wait for the end of the task, if it has started or is queued
+    void wait( const TaskHandle& task );
+    // The task is about to be waited for (interrupted): it is resumed
+    // if paused, and will not be paused again
+    void expedite( const TaskHandle& task );
+    // Called regularly by a long task, pauses it while tasks of
+    // a higher priority are waiting for its thread
+    // (returns at once out of a task of the pool)
+    void yield();
+
+    // Sets the number of threads running the tasks (the number of
+    // cores if 0), the threads over it stopping after their task
+    void setMaxThreads( int nbThreads );
+    int maxThreads() const;
+
+  private:
+    TaskScheduler();
+
+    // Main loop of the threads of the pool
+    void runTasks();
+    // Returns the number of threads the pool can have
+    // (with mutex_ held)
+    int threadBudget() const;
+    // Start a thread if the tasks queued need one
+    // (with mutex_ held)
+    void startThreadIfNeeded();
+    // Returns whether a task of a priority higher than the passed
+    // one is queued (with mutex_ held)
+    bool hasQueuedAbove( Priority priority ) const;
+    // Update topQueuedPriority_ after the queue changed
+    // (with mutex_ held)
+    void queueChanged();
+
+    mutable std::mutex mutex_;
+    std::condition_variable taskQueuedCond_;
+    std::condition_variable taskEndedCond_;
+
+    std::vector<TaskHandle> queue_;
+    int maxThreads_;
+    int nbThreads_;
+    int nbIdleThreads_;
+    // Threads running a task (not paused) and paused in yield()
+    int nbBusyThreads_;
+    int nbPausedThreads_;
+    // Highest priority of the tasks queued (-1 if none),
+    // read without the mutex by yield()
+    std::atomic<int> topQueuedPriority_;
+    // Submission number of the next task
+    unsigned long long nextSequence_;
+};
+
+#endif
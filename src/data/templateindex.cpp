@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements TemplateIndex
+
+#include "templateindex.h"
+
+#include <algorithm>
+
+#include "log.h"
+
+#include "abstractlogdata.h"
+
+const int TemplateIndex::nbLinesInChunk = 5000;
+const int TemplateIndex::maxWords = 64;
+
+namespace {
+
+const char* const termPrefix = "template=";
+
+// Stands for the words of a template which vary
+const QByteArray& wildcard()
+{
+    static const QByteArray word( "<*>" );
+    return word;
+}
+
+}
+
+TemplateIndex::TemplateIndex() : updateMutex_(), mutex_(), ids_(),
+    templates_(), groups_(), generation_( 0 )
+{
+}
+
+bool TemplateIndex::templateOfTerm( const QRegExp& term, int* id )
+{
+    const QString pattern = term.pattern();
+    if ( ! pattern.startsWith( QLatin1String( termPrefix ) ) )
+        return false;
+
+    bool ok;
+    *id = pattern.mid( qstrlen( termPrefix ) ).toInt( &ok );
+    return ok && *id >= 0;
+}
+
+QString TemplateIndex::termOfTemplate( int id )
+{
+    return QLatin1String( termPrefix ) + QString::number( id );
+}
+
+void TemplateIndex::update( const AbstractLogData* source, LineNumber nbLines,
+        const std::atomic<bool>* interruptRequest )
+{
+    QMutexLocker update_locker( &updateMutex_ );
+
+    LineNumber first;
+    int generation;
+    {
+        QMutexLocker locker( &mutex_ );
+
+        first = ids_.size();
+        // The last line might have been updated (if it was not LF-terminated)
+        if ( first >= 1 )
+            first--;
+        generation = generation_;
+    }
+
+    LOG(logDEBUG) << "Mining the templates of lines " << first
+        << " to " << nbLines;
+
+    for ( LineNumber i = first; i < nbLines; i += nbLinesInChunk ) {
+        if ( *interruptRequest )
+            return;
+
+        const int number = qMin<LineNumber>( nbLinesInChunk, nbLines - i );
+        std::vector<int> lineEnds;
+        const QByteArray blob = source->getRawLines( i, number, &lineEnds );
+
+        QMutexLocker locker( &mutex_ );
+
+        // The lines have been forgotten meanwhile
+        if ( generation != generation_ )
+            return;
+
+        while ( (LineNumber) ids_.size() > i ) {
+            templates_[ ids_.back() ].count--;
+            ids_.pop_back();
+        }
+        for ( size_t j = 0; j < lineEnds.size(); j++ ) {
+            const int beginning = ( j == 0 ) ? 0 : lineEnds[j-1] + 1;
+            ids_.push_back( mineLine( blob.constData() + beginning,
+                        lineEnds[j] - beginning ) );
+        }
+
+        // The data might have been truncated
+        if ( (int) lineEnds.size() < number )
+            break;
+    }
+}
+
+LineNumber TemplateIndex::nbLinesMined() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return ids_.size();
+}
+
+std::vector<TemplateIndex::Summary> TemplateIndex::topTemplates( int number ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    std::vector<uint32_t> ids;
+    for ( size_t id = 0; id < templates_.size(); id++ ) {
+        if ( templates_[id].count > 0 )
+            ids.push_back( id );
+    }
+
+    const auto top = ids.begin() + qMin<size_t>( number, ids.size() );
+    std::partial_sort( ids.begin(), top, ids.end(),
+            [this]( uint32_t a, uint32_t b ) {
+                return templates_[a].count > templates_[b].count
+                    || ( templates_[a].count == templates_[b].count && a < b ); } );
+
+    std::vector<Summary> summaries;
+    for ( auto id = ids.begin(); id != top; ++id ) {
+        const Template& t = templates_[ *id ];
+        QByteArray text;
+        for ( const QByteArray& word : t.words ) {
+            if ( ! text.isEmpty() )
+                text.append( ' ' );
+            text.append( word );
+        }
+        summaries.push_back( { int( *id ), QString::fromUtf8( text ), t.count } );
+    }
+
+    return summaries;
+}
+
+MatchSet TemplateIndex::find( int id, LineNumber nbLines ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    MatchSet lines;
+    const LineNumber end = qMin<LineNumber>( nbLines, ids_.size() );
+    for ( LineNumber line = 0; line < end; line++ ) {
+        if ( ids_[line] == (uint32_t) id )
+            lines.append( line );
+    }
+
+    return lines;
+}
+
+void TemplateIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    ids_.clear();
+    templates_.clear();
+    groups_.clear();
+    generation_++;
+}
+
+void TemplateIndex::truncate( LineNumber nbLines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    while ( (LineNumber) ids_.size() > nbLines ) {
+        templates_[ ids_.back() ].count--;
+        ids_.pop_back();
+    }
+    generation_++;
+}
+
+uint32_t TemplateIndex::mineLine( const char* line, int length )
+{
+    const char* const end = line + length;
+
+    // The words, those having a digit being parameters
+    std::vector<QByteArray> words;
+    for ( const char* p = line; p < end && (int) words.size() < maxWords; ) {
+        while ( p < end && ( *p == ' ' || *p == '\t' ) )
+            p++;
+        if ( p == end )
+            break;
+
+        const char* const start = p;
+        bool digit = false;
+        while ( p < end && *p != ' ' && *p != '\t' ) {
+            digit = digit || ( *p >= '0' && *p <= '9' );
+            p++;
+        }
+        words.push_back( digit ? wildcard() : QByteArray( start, p - start ) );
+    }
+
+    QByteArray key = QByteArray::number( (int) words.size() );
+    if ( ! words.empty() )
+        key.append( ' ' ).append( words.front() );
+    std::vector<uint32_t>& group = groups_[ key ];
+
+    // The template of the group having the most words in common
+    int best = -1;
+    int best_similarity = -1;
+    for ( uint32_t id : group ) {
+        const std::vector<QByteArray>& template_words = templates_[id].words;
+        int similarity = 0;
+        for ( size_t w = 0; w < words.size(); w++ ) {
+            if ( template_words[w] == words[w] )
+                similarity++;
+        }
+        if ( similarity > best_similarity ) {
+            best = id;
+            best_similarity = similarity;
+        }
+    }
+
+    if ( best >= 0 && 2 * best_similarity >= (int) words.size() ) {
+        Template& t = templates_[best];
+        for ( size_t w = 0; w < words.size(); w++ ) {
+            if ( t.words[w] != words[w] )
+                t.words[w] = wildcard();
+        }
+        t.count++;
+        return best;
+    }
+
+    Template t;
+    t.words = std::move( words );
+    t.count = 1;
+    templates_.push_back( std::move( t ) );
+    group.push_back( templates_.size() - 1 );
+
+    return templates_.size() - 1;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEMPLATEINDEX_H
+#define TEMPLATEINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QRegExp>
+#include <QString>
+
+#include "matchset.h"
+
+class AbstractLogData;
+
+// The templates of the messages of a log (the text of the lines with
+// their varying parameters replaced by <*>), mined online in the manner
+// of Drain: the words of a line are compared with the templates having
+// the same number of words and first word, the line taking the most
+// similar template (generalised where they differ) if at least half of
+// their words are the same, a new template otherwise.
+// The words having a digit are parameters from the start.
+// The template of each line is stored as a column of one template
+// number per line, so the lines of a template are found without
+// matching a regular expression over each line.
+// It is thread safe.
+class TemplateIndex
+{
+  public:
+    // A template and its number of lines
+    struct Summary {
+        int id;
+        QString text;
+        LineNumber count;
+    };
+
+    TemplateIndex();
+
+    // Returns whether the passed query term searches the lines of a
+    // template, written template=<number>, setting *id to the number.
+    static bool templateOfTerm( const QRegExp& term, int* id );
+    // Returns the query term searching the lines of the template
+    static QString termOfTemplate( int id );
+
+    // Mine the templates of the lines of source not mined yet (the
+    // last line mined is mined again, in case it was not LF terminated),
+    // up to nbLines.
+    // Stops if interrupted, the lines done being kept.
+    void update( const AbstractLogData* source, LineNumber nbLines,
+            const std::atomic<bool>* interruptRequest );
+    // Returns the number of lines mined
+    LineNumber nbLinesMined() const;
+    // Returns the (at most) number templates having the most lines,
+    // in decreasing order of lines.
+    std::vector<Summary> topTemplates( int number ) const;
+    // Returns the lines, among the nbLines first ones, of the
+    // passed template (they must have been mined).
+    MatchSet find( int id, LineNumber nbLines ) const;
+
+    // Forget the lines mined and the templates (the file has changed)
+    void clear();
+    // Forget the lines from the passed line on (the end of the file
+    // has changed), the templates being kept
+    void truncate( LineNumber nbLines );
+
+  private:
+    struct Template {
+        Template() : words(), count( 0 ) {}
+
+        std::vector<QByteArray> words;
+        LineNumber count;
+    };
+
+    // Number of lines read from the source at once
+    static const int nbLinesInChunk;
+    // Words of a line looked at (the others are ignored)
+    static const int maxWords;
+
+    // Returns the template of the line, added if needed
+    // (with mutex_ held)
+    uint32_t mineLine( const char* line, int length );
+
+    // Serialises the updates
+    QMutex updateMutex_;
+    mutable QMutex mutex_;
+    // Template of each line mined
+    std::vector<uint32_t> ids_;
+    std::vector<Template> templates_;
+    // The templates by number of words and first word
+    QHash<QByteArray, std::vector<uint32_t>> groups_;
+    // Changed each time the lines mined are forgotten, so the
+    // mining in progress is not added
+    int generation_;
+};
+
+#endif
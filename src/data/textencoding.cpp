@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "textencoding.h"
+
+#include "abstractlogdata.h"
+
+namespace {
+
+const QChar replacementCharacter( 0xFFFD );
+
+// Returns the length of the UTF-8 sequence starting at data and sets
+// *code_point, returns 0 if the sequence is not valid and -1 if it
+// is cut by end.
+int utf8Sequence( const unsigned char* data, const unsigned char* end,
+        uint* code_point )
+{
+    const unsigned char c = *data;
+    int extra;
+    uint minimum;
+    if ( c < 0x80 ) {
+        *code_point = c;
+        return 1;
+    }
+    else if ( ( c & 0xE0 ) == 0xC0 ) {
+        extra = 1;
+        *code_point = c & 0x1F;
+        minimum = 0x80;
+    }
+    else if ( ( c & 0xF0 ) == 0xE0 ) {
+        extra = 2;
+        *code_point = c & 0x0F;
+        minimum = 0x800;
+    }
+    else if ( ( c & 0xF8 ) == 0xF0 ) {
+        extra = 3;
+        *code_point = c & 0x07;
+        minimum = 0x10000;
+    }
+    else {
+        return 0;
+    }
+
+    for ( int i = 1; i <= extra; i++ ) {
+        if ( data + i == end )
+            return -1;
+        if ( ( data[i] & 0xC0 ) != 0x80 )
+            return 0;
+        *code_point = ( *code_point << 6 ) | ( data[i] & 0x3F );
+    }
+
+    // Overlong forms, surrogates and values out of Unicode are invalid
+    if ( *code_point < minimum || *code_point > 0x10FFFF
+            || ( *code_point >= 0xD800 && *code_point <= 0xDFFF ) )
+        return 0;
+
+    return extra + 1;
+}
+
+}
+
+const char* TextEncoding::name() const
+{
+    switch ( type_ ) {
+        case Latin1:
+            return "ISO-8859-1";
+        case Utf16LE:
+            return "UTF-16LE";
+        case Utf16BE:
+            return "UTF-16BE";
+        default:
+            return "UTF-8";
+    }
+}
+
+QByteArray TextEncoding::lineFeed() const
+{
+    switch ( type_ ) {
+        case Utf16LE:
+            return QByteArray( "\n\0", 2 );
+        case Utf16BE:
+            return QByteArray( "\0\n", 2 );
+        default:
+            return QByteArray( "\n" );
+    }
+}
+
+int TextEncoding::bomLength( const char* data, int length ) const
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+
+    switch ( type_ ) {
+        case Auto:
+        case Utf8:
+            return ( length >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB
+                    && bytes[2] == 0xBF ) ? 3 : 0;
+        case Utf16LE:
+            return ( length >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE ) ? 2 : 0;
+        case Utf16BE:
+            return ( length >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF ) ? 2 : 0;
+        default:
+            return 0;
+    }
+}
+
+TextEncoding TextEncoding::detect( const char* data, int length )
+{
+    for ( Type type : { Utf8, Utf16LE, Utf16BE } ) {
+        if ( TextEncoding( type ).bomLength( data, length ) > 0 )
+            return TextEncoding( type );
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+    const unsigned char* const end = bytes + length;
+
+    // ASCII text in UTF-16 has a NUL byte in each code unit
+    const int nb_units = length / 2;
+    int even_nuls = 0;
+    int odd_nuls = 0;
+    for ( int i = 0; i < nb_units * 2; i += 2 ) {
+        if ( bytes[i] == 0 )
+            even_nuls++;
+        if ( bytes[i + 1] == 0 )
+            odd_nuls++;
+    }
+    if ( odd_nuls > nb_units / 2 && even_nuls <= nb_units / 16 )
+        return TextEncoding( Utf16LE );
+    if ( even_nuls > nb_units / 2 && odd_nuls <= nb_units / 16 )
+        return TextEncoding( Utf16BE );
+
+    // The data might end in the middle of a sequence
+    uint code_point;
+    for ( const unsigned char* i = bytes; i < end; ) {
+        const int sequence = utf8Sequence( i, end, &code_point );
+        if ( sequence == 0 )
+            return TextEncoding( Latin1 );
+        else if ( sequence == -1 )
+            break;
+        i += sequence;
+    }
+
+    return TextEncoding( Utf8 );
+}
+
+QString LineDecoder::decode( const char* data, int length, bool expandTabs )
+{
+    buffer_.clear();
+    decode( data, length, expandTabs, &buffer_ );
+
+    return buffer_.string( 0 );
+}
+
+void LineDecoder::decode( const char* data, int length, bool expandTabs,
+        LineBuffer* lines )
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+
+    target_ = lines;
+    switch ( encoding_.type() ) {
+        case TextEncoding::Latin1:
+            decodeLatin1( bytes, length, expandTabs );
+            break;
+        case TextEncoding::Utf16LE:
+        case TextEncoding::Utf16BE:
+            decodeUtf16( bytes, length, expandTabs );
+            break;
+        default:
+            decodeUtf8( bytes, length, expandTabs );
+            break;
+    }
+    lines->endLine();
+}
+
+inline void LineDecoder::append( QChar c, bool expandTabs )
+{
+    // Room for a whole tab
+    target_->reserve( AbstractLogData::tabStop );
+
+    if ( expandTabs && c == QLatin1Char( '\t' ) ) {
+        const int spaces = AbstractLogData::tabStop
+            - ( target_->pendingLength() % AbstractLogData::tabStop );
+        for ( int i = 0; i < spaces; i++ )
+            target_->push( QLatin1Char( ' ' ) );
+    }
+    else {
+        target_->push( c );
+    }
+}
+
+inline void LineDecoder::appendCodePoint( uint code_point )
+{
+    if ( code_point > 0xFFFF ) {
+        append( QChar( QChar::highSurrogate( code_point ) ), false );
+        append( QChar( QChar::lowSurrogate( code_point ) ), false );
+    }
+    else {
+        append( QChar( code_point ), false );
+    }
+}
+
+void LineDecoder::decodeUtf8( const unsigned char* data, int length,
+        bool expandTabs )
+{
+    const unsigned char* const end = data + length;
+    uint code_point;
+
+    while ( data < end ) {
+        // Most of a log is ASCII
+        if ( *data < 0x80 ) {
+            append( QChar( ushort( *data++ ) ), expandTabs );
+            continue;
+        }
+
+        const int sequence = utf8Sequence( data, end, &code_point );
+        if ( sequence > 0 ) {
+            appendCodePoint( code_point );
+            data += sequence;
+        }
+        else {
+            append( replacementCharacter, false );
+            data++;
+        }
+    }
+}
+
+void LineDecoder::decodeLatin1( const unsigned char* data, int length,
+        bool expandTabs )
+{
+    for ( int i = 0; i < length; i++ )
+        append( QChar( ushort( data[i] ) ), expandTabs );
+}
+
+void LineDecoder::decodeUtf16( const unsigned char* data, int length,
+        bool expandTabs )
+{
+    const int low = encoding_.lowByteIndex();
+
+    for ( int i = 0; i + 1 < length; i += 2 )
+        append( QChar( ushort( data[i + low] | ( data[i + 1 - low] << 8 ) ) ),
+                expandTabs );
+
+    if ( length % 2 )
+        append( replacementCharacter, false );
+}
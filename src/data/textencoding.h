@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEXTENCODING_H
+#define TEXTENCODING_H
+
+#include <QByteArray>
+#include <QChar>
+#include <QString>
+
+#include "linebuffer.h"
+
+// An encoding a file can be read in, telling the indexer how an end of
+// line is written (its code units being one or two bytes wide).
+// Auto is only meaningful when choosing the encoding of a file: the
+// indexer replaces it with the encoding detected, the lines being
+// decoded as UTF-8 until then.
+class TextEncoding
+{
+  public:
+    enum Type { Auto, Utf8, Latin1, Utf16LE, Utf16BE };
+
+    TextEncoding( Type type = Auto ) : type_( type ) {}
+
+    Type type() const { return type_; }
+    // Returns the name of the encoding, as known by QTextCodec
+    const char* name() const;
+
+    // Width of a code unit, in bytes
+    int unitWidth() const
+    { return ( type_ == Utf16LE || type_ == Utf16BE ) ? 2 : 1; }
+    // Position of the least significant byte in a code unit (the one
+    // holding the LF or tab of an ASCII end of line or tab)
+    int lowByteIndex() const { return ( type_ == Utf16BE ) ? 1 : 0; }
+    // Returns an end of line (LF) in this encoding
+    QByteArray lineFeed() const;
+    // Returns the length of the byte order mark the passed data starts
+    // with, if it is the one of this encoding (0 if it is not).
+    int bomLength( const char* data, int length ) const;
+
+    // Guess the encoding of a file from its first bytes: a byte order
+    // mark, the NUL bytes of UTF-16 text (mostly ASCII), then whether
+    // it is valid UTF-8, Latin-1 being used if it is not.
+    static TextEncoding detect( const char* data, int length );
+
+    bool operator==( const TextEncoding& other ) const
+    { return type_ == other.type_; }
+    bool operator!=( const TextEncoding& other ) const
+    { return type_ != other.type_; }
+
+  private:
+    Type type_;
+};
+
+// Decodes lines of text in an encoding, expanding the tabs in the same
+// pass if asked, into a LineBuffer.
+// The QStrings returned by decode() are decoded in a buffer kept from
+// one line to the next, then allocated only once at their final size,
+// so a decoder should be kept for a batch of lines.
+// Invalid sequences are replaced by U+FFFD as QString::fromUtf8() does.
+// This class is reentrant (not thread-safe).
+class LineDecoder
+{
+  public:
+    explicit LineDecoder( TextEncoding encoding )
+        : encoding_( encoding ), buffer_(), target_( nullptr ) {}
+
+    // Returns the passed raw line (without its end of line) decoded
+    QString decode( const char* data, int length, bool expandTabs );
+    // Idem, the line being added to the passed buffer
+    void decode( const char* data, int length, bool expandTabs,
+            LineBuffer* lines );
+
+  private:
+    // Append a character, expanding it if it is a tab
+    inline void append( QChar c, bool expandTabs );
+    // Append a Unicode code point (made of two QChars if need be)
+    inline void appendCodePoint( uint code_point );
+    // The implementation for each width of code unit
+    void decodeUtf8( const unsigned char* data, int length, bool expandTabs );
+    void decodeLatin1( const unsigned char* data, int length, bool expandTabs );
+    void decodeUtf16( const unsigned char* data, int length, bool expandTabs );
+
+    const TextEncoding encoding_;
+    LineBuffer buffer_;
+    // Where the line being decoded is written
+    LineBuffer* target_;
+};
+
+#endif
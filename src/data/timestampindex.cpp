@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements TimestampIndex
+
+#include "timestampindex.h"
+
+#include <algorithm>
+
+const int TimestampIndex::interval = 1000;
+
+void TimestampIndex::append( const Samples& samples, qint64 first_line )
+{
+    for ( const Sample& sample : samples ) {
+        const qint64 line = first_line + sample.line;
+        // Only the lines following the ones sampled can be added
+        if ( ! samples_.empty() && line <= samples_.back().line )
+            continue;
+
+        const qint64 timestamp = samples_.empty() ? sample.timestamp :
+            qMax( sample.timestamp, samples_.back().timestamp );
+        samples_.push_back( { line, timestamp } );
+    }
+}
+
+void TimestampIndex::truncate( qint64 nb_lines )
+{
+    while ( ! samples_.empty() && samples_.back().line >= nb_lines )
+        samples_.pop_back();
+}
+
+bool TimestampIndex::timeRange( qint64* first, qint64* last ) const
+{
+    if ( samples_.empty() )
+        return false;
+
+    *first = samples_.front().timestamp;
+    *last  = samples_.back().timestamp;
+    return true;
+}
+
+void TimestampIndex::findRange( qint64 timestamp, qint64 nb_lines,
+        qint64* first, qint64* last ) const
+{
+    // First sample at or after the timestamp
+    const auto next = std::lower_bound( samples_.begin(), samples_.end(),
+            timestamp, []( const Sample& sample, qint64 timestamp )
+            { return sample.timestamp < timestamp; } );
+
+    *first = ( next == samples_.begin() ) ? 0 : ( next - 1 )->line + 1;
+    *last  = ( next == samples_.end() ) ? nb_lines : next->line;
+}
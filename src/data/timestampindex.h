@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMESTAMPINDEX_H
+#define TIMESTAMPINDEX_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+// A sparse table of the timestamps of the lines of a file, sampled
+// about every 'interval' lines while the file is indexed, to find the
+// lines around a time by binary search rather than reading them all.
+// The timestamps are kept non-decreasing (a sample earlier than the
+// previous one takes its timestamp), so the table stays sorted when
+// the lines are slightly out of order.
+class TimestampIndex
+{
+  public:
+    struct Sample {
+        qint64 line;
+        qint64 timestamp;
+    };
+    typedef std::vector<Sample> Samples;
+
+    TimestampIndex() : samples_() {}
+
+    // Add the samples of lines following the ones already sampled,
+    // their line numbers being relative to first_line.
+    void append( const Samples& samples, qint64 first_line );
+    // Remove the samples of the lines from nb_lines
+    void truncate( qint64 nb_lines );
+
+    // Number of samples
+    qint64 size() const { return samples_.size(); }
+    // Sets the timestamps of the first and last samples, returns false
+    // if there is none.
+    bool timeRange( qint64* first, qint64* last ) const;
+
+    // Returns the range of lines the first line with a timestamp at or
+    // after the passed one is in, between *first and *last included
+    // (*last being nb_lines if it might be after the last sample).
+    void findRange( qint64 timestamp, qint64 nb_lines,
+            qint64* first, qint64* last ) const;
+
+    // Lines between two samples
+    static const int interval;
+
+  private:
+    Samples samples_;
+};
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements TimestampRule
+
+#include "timestamprule.h"
+
+#include <limits>
+
+#include <QDateTime>
+
+#include "abstractlogdata.h"
+
+const qint64 TimestampRule::noTimestamp = std::numeric_limits<qint64>::min();
+
+TimestampRule::TimestampRule( const QRegExp& regexp, const QString& format )
+    : compiled_( regexp ), format_( format ),
+    valid_( regexp.isValid() && ! regexp.isEmpty() )
+{
+}
+
+bool TimestampRule::isValid() const
+{
+    return valid_;
+}
+
+qint64 TimestampRule::timestamp( const QString& line ) const
+{
+    QString text;
+    if ( compiled_.indexIn( line, 0, nullptr, &text ) == -1 )
+        return noTimestamp;
+
+    if ( ! format_.isEmpty() ) {
+        const QDateTime date = QDateTime::fromString( text, format_ );
+        return date.isValid() ? date.toMSecsSinceEpoch() : noTimestamp;
+    }
+
+    // At most 18 digits, not to overflow
+    qint64 key = 0;
+    int nb_digits = 0;
+    for ( const QChar c : text ) {
+        if ( c.isDigit() && nb_digits < 18 ) {
+            key = key * 10 + c.digitValue();
+            nb_digits++;
+        }
+    }
+
+    return nb_digits > 0 ? key : noTimestamp;
+}
+
+qint64 TimestampRule::findLine( const AbstractLogData& data,
+        qint64 timestamp ) const
+{
+    // Lines read at once looking for one with a timestamp
+    static const int linesRead = 64;
+
+    // The line searched is either in [first, last) or is result
+    qint64 first = 0;
+    qint64 last = data.getNbLine();
+    qint64 result = last;
+
+    while ( first < last ) {
+        const qint64 middle = first + ( last - first ) / 2;
+
+        // The lines without a timestamp (e.g. of a stack trace) are skipped
+        qint64 line = middle;
+        qint64 found = noTimestamp;
+        while ( line < last && found == noTimestamp ) {
+            const QStringList lines = data.getLines( line,
+                    qMin<qint64>( last - line, linesRead ) );
+            if ( lines.isEmpty() ) {
+                line = last;
+                break;
+            }
+
+            for ( const QString& string : lines ) {
+                found = this->timestamp( string );
+                if ( found != noTimestamp )
+                    break;
+                line++;
+            }
+        }
+
+        if ( found == noTimestamp ) {
+            last = middle;
+        }
+        else if ( found >= timestamp ) {
+            result = line;
+            last = middle;
+        }
+        else {
+            first = line + 1;
+        }
+    }
+
+    return result;
+}
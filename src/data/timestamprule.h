@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMESTAMPRULE_H
+#define TIMESTAMPRULE_H
+
+#include <QString>
+#include <QRegExp>
+
+#include "compiledregexp.h"
+
+class AbstractLogData;
+
+// How to extract the timestamp of a log line, to order the lines of
+// several files by time.
+// The timestamp is the first capture of a regular expression (or the
+// whole match if it has none), either parsed with a QDateTime format
+// or, with no format, reduced to its digits and compared as a number
+// (which orders fixed width timestamps such as ISO 8601 ones).
+// The rule is immutable, one instance can be used by several threads
+// (see CompiledRegExp).
+class TimestampRule
+{
+  public:
+    TimestampRule( const QRegExp& regexp, const QString& format = QString() );
+
+    // Returns whether the rule can be used
+    bool isValid() const;
+
+    // Returns the key ordering the passed line, noTimestamp if the line
+    // has no (valid) timestamp.
+    qint64 timestamp( const QString& line ) const;
+
+    // Returns the first line of the data with a timestamp at or after the
+    // passed one, data.getNbLine() if there is none. The lines must be in
+    // time order, they are found by a binary search (reading the lines,
+    // without the index of LogData::setTimestampRule()).
+    qint64 findLine( const AbstractLogData& data, qint64 timestamp ) const;
+
+    // Smaller than any timestamp
+    static const qint64 noTimestamp;
+
+  private:
+    CompiledRegExp compiled_;
+    QString format_;
+    bool valid_;
+};
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tokenindex.h"
+
+#include <QFileInfo>
+
+#include "log.h"
+
+#include "abstractlogdata.h"
+#include "indexcache.h"
+#include "literalprefilter.h"
+
+const int TokenIndex::nbLinesInChunk = 5000;
+
+namespace {
+
+// Parts of tokens shorter than this are in too many tokens to be worth
+// looking up
+const int minimumPartLength = 3;
+
+bool isTokenCharacter( char c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' )
+        || c == '_' || ( c & 0x80 );
+}
+
+// Only ASCII is folded (not the bytes of UTF-8 sequences)
+QByteArray foldedToken( const char* data, int length )
+{
+    QByteArray token( data, length );
+    for ( int i = 0; i < length; i++ ) {
+        if ( token[i] >= 'A' && token[i] <= 'Z' )
+            token[i] = token[i] - 'A' + 'a';
+    }
+
+    return token;
+}
+
+}
+
+TokenIndex::TokenIndex()
+    : mutex_(), fileName_(), postings_(), nbLines_( 0 ),
+    cacheLoaded_( false ), generation_( 0 )
+{
+}
+
+void TokenIndex::setFile( const QString& fileName )
+{
+    QMutexLocker locker( &mutex_ );
+
+    fileName_ = fileName;
+    postings_.clear();
+    nbLines_ = 0;
+    cacheLoaded_ = false;
+    generation_++;
+}
+
+bool TokenIndex::isEnabled() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return ! fileName_.isEmpty();
+}
+
+LineNumber TokenIndex::nbLines() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return nbLines_;
+}
+
+void TokenIndex::update( const AbstractLogData* source, LineNumber nbLines,
+        const std::atomic<bool>* interruptRequest )
+{
+    QString fileName;
+    bool loadCache;
+    int generation;
+    {
+        QMutexLocker locker( &mutex_ );
+
+        if ( fileName_.isEmpty() )
+            return;
+
+        fileName = fileName_;
+        loadCache = ! cacheLoaded_;
+        cacheLoaded_ = true;
+        generation = generation_;
+    }
+
+    if ( loadCache )
+        IndexCache().loadTokens( fileName, this );
+
+    const qint64 size = QFileInfo( fileName ).size();
+
+    LineNumber first;
+    {
+        QMutexLocker locker( &mutex_ );
+
+        if ( generation != generation_ )
+            return;
+        first = nbLines_;
+    }
+
+    // The last line might not be complete
+    const LineNumber end = ( nbLines >= 1 ) ? nbLines - 1 : 0;
+    if ( first >= end )
+        return;
+
+    LOG(logDEBUG) << "Indexing the tokens of lines " << first << " to " << end;
+
+    // The tokens of each line of a chunk
+    std::vector<std::vector<QByteArray>> lineTokens;
+
+    for ( LineNumber i = first; i < end; i += nbLinesInChunk ) {
+        if ( *interruptRequest )
+            return;
+
+        const int number = qMin<LineNumber>( nbLinesInChunk, end - i );
+        std::vector<int> lineEnds;
+        const QByteArray blob = source->getRawLines( i, number, &lineEnds );
+
+        lineTokens.resize( lineEnds.size() );
+        for ( size_t j = 0; j < lineEnds.size(); j++ ) {
+            const int beginning = ( j == 0 ) ? 0 : lineEnds[j-1] + 1;
+            lineTokens[j].clear();
+            tokenize( blob.constData() + beginning, lineEnds[j] - beginning,
+                    &lineTokens[j] );
+        }
+
+        QMutexLocker locker( &mutex_ );
+
+        // The lines have been forgotten meanwhile
+        if ( generation != generation_ )
+            return;
+
+        for ( size_t j = 0; j < lineEnds.size(); j++ ) {
+            const LineNumber line = i + j;
+            for ( const QByteArray& token : lineTokens[j] ) {
+                MatchSet& lines = postings_[token];
+                if ( lines.empty() || lines.last() != line )
+                    lines.append( line );
+            }
+        }
+        nbLines_ = i + lineEnds.size();
+
+        // The data might have been truncated
+        if ( (int) lineEnds.size() < number )
+            return;
+    }
+
+    IndexCache().saveTokens( fileName, size, *this );
+}
+
+bool TokenIndex::candidates( const QRegExp& regexp, MatchSet* candidates ) const
+{
+    // The tokens are looked for in the literal every match contains:
+    // the parts of it between two separators are whole tokens while
+    // the ones at its ends might only be the end or beginning of one.
+    const LiteralPrefilter prefilter( regexp );
+    if ( ! prefilter.isValid() )
+        return false;
+    const std::string& literal = prefilter.literal();
+
+    QMutexLocker locker( &mutex_ );
+
+    bool found = false;
+    size_t start = 0;
+    while ( start < literal.size() ) {
+        if ( ! isTokenCharacter( literal[start] ) ) {
+            start++;
+            continue;
+        }
+
+        size_t end = start;
+        while ( end < literal.size() && isTokenCharacter( literal[end] ) )
+            end++;
+
+        const QByteArray part = foldedToken( literal.data() + start, end - start );
+        const bool startsToken = ( start > 0 );
+        const bool endsToken = ( end < literal.size() );
+        start = end;
+
+        MatchSet lines;
+        if ( startsToken && endsToken ) {
+            lines = postings_.value( part );
+        }
+        else if ( part.size() >= minimumPartLength ) {
+            for ( auto i = postings_.constBegin(); i != postings_.constEnd(); ++i ) {
+                const QByteArray& token = i.key();
+                if ( startsToken ? token.startsWith( part )
+                        : endsToken ? token.endsWith( part )
+                        : token.contains( part ) )
+                    lines = lines.united( i.value() );
+            }
+        }
+        else {
+            continue;
+        }
+
+        *candidates = found ? candidates->intersected( lines ) : lines;
+        found = true;
+    }
+
+    return found;
+}
+
+void TokenIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    postings_.clear();
+    nbLines_ = 0;
+    generation_++;
+}
+
+QHash<QByteArray, MatchSet> TokenIndex::postings() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return postings_;
+}
+
+void TokenIndex::setPostings( const QHash<QByteArray, MatchSet>& postings,
+        LineNumber nbLines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    postings_ = postings;
+    nbLines_ = nbLines;
+}
+
+void TokenIndex::tokenize( const char* line, int length,
+        std::vector<QByteArray>* tokens )
+{
+    int start = 0;
+    while ( start < length ) {
+        if ( ! isTokenCharacter( line[start] ) ) {
+            start++;
+            continue;
+        }
+
+        int end = start;
+        while ( end < length && isTokenCharacter( line[end] ) )
+            end++;
+
+        tokens->push_back( foldedToken( line + start, end - start ) );
+        start = end;
+    }
+}
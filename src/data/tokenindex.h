@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOKENINDEX_H
+#define TOKENINDEX_H
+
+#include <atomic>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QRegExp>
+#include <QString>
+
+#include "matchset.h"
+
+class AbstractLogData;
+
+// An inverted index of the tokens (words) of the lines of a static
+// file, giving the lines each token is in, so a search for a pattern
+// whose matches must contain some words only reads the lines having
+// them all instead of the whole file.
+// A token is a run of ASCII letters, underscores and non-ASCII bytes
+// in the raw (UTF-8) data, folded to lower case: digits and punctuation
+// separate them, so the ever changing numbers (timestamps, ids...) do
+// not make the index as big as the file.
+// The index is kept in the index cache (see IndexCache) so it is only
+// built once for a file which does not change.
+// It is thread safe.
+class TokenIndex
+{
+  public:
+    TokenIndex();
+
+    // Sets the file whose tokens are indexed (the source of the
+    // lines), forgetting the lines indexed. An empty name disables
+    // the index.
+    void setFile( const QString& fileName );
+    bool isEnabled() const;
+
+    // Number of lines indexed (the first lines of the file)
+    LineNumber nbLines() const;
+
+    // Index the lines of source from nbLines() on, except the last of
+    // the nbLines passed (it might not be complete yet), loading the
+    // index from the cache first if it has not been built.
+    // Stops if interrupted, the lines done being kept.
+    void update( const AbstractLogData* source, LineNumber nbLines,
+            const std::atomic<bool>* interruptRequest );
+
+    // Sets candidates to the lines indexed which might match the passed
+    // regexp (the other ones do not), returns false if no token can be
+    // required from its matches (the whole file has to be searched).
+    bool candidates( const QRegExp& regexp, MatchSet* candidates ) const;
+
+    // Forget the lines indexed (the file has changed)
+    void clear();
+
+    // The lines of each token, for IndexCache
+    QHash<QByteArray, MatchSet> postings() const;
+    void setPostings( const QHash<QByteArray, MatchSet>& postings,
+            LineNumber nbLines );
+
+    // Add the tokens of the passed raw line (possibly several times
+    // the same) to tokens.
+    static void tokenize( const char* line, int length,
+            std::vector<QByteArray>* tokens );
+
+  private:
+    // Number of lines read from the source at once
+    static const int nbLinesInChunk;
+
+    mutable QMutex mutex_;
+    QString fileName_;
+    QHash<QByteArray, MatchSet> postings_;
+    LineNumber nbLines_;
+    // Whether the cache has been looked at
+    bool cacheLoaded_;
+    // Changed each time the lines indexed are forgotten, so the
+    // indexing in progress is not added
+    int generation_;
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trigramindex.h"
+
+#include <algorithm>
+
+#include "log.h"
+
+#include "abstractlogdata.h"
+#include "literalprefilter.h"
+
+// 512 lines of 100 bytes have a few thousand distinct trigrams, which
+// fill about a quarter of a 16 Kib bitmap (4% of the size of the data).
+const int TrigramIndex::linesPerBlock = 512;
+const int TrigramIndex::wordsPerBlock = 256;
+
+namespace {
+
+inline unsigned char foldCase( unsigned char c )
+{
+    return ( c >= 'A' && c <= 'Z' ) ? c + ( 'a' - 'A' ) : c;
+}
+
+// Returns the bit of the trigram starting at data (folded already)
+inline uint32_t trigramBit( const unsigned char* data )
+{
+    const uint32_t trigram = ( data[0] << 16 ) | ( data[1] << 8 ) | data[2];
+
+    // Multiplicative hashing, keeping the 14 high bits
+    return ( trigram * 2654435761u ) >> 18;
+}
+
+}
+
+TrigramIndex::TrigramIndex()
+    : mutex_(), enabled_( false ), bitmaps_(), generation_( 0 )
+{
+}
+
+void TrigramIndex::setEnabled( bool enabled )
+{
+    QMutexLocker locker( &mutex_ );
+
+    enabled_ = enabled;
+    bitmaps_.clear();
+    bitmaps_.shrink_to_fit();
+    generation_++;
+}
+
+bool TrigramIndex::isEnabled() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return enabled_;
+}
+
+LineNumber TrigramIndex::nbLines() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return bitmaps_.size() / wordsPerBlock * linesPerBlock;
+}
+
+void TrigramIndex::update( const AbstractLogData* source, LineNumber nbLines,
+        const std::atomic<bool>* interruptRequest )
+{
+    LineNumber first;
+    int generation;
+    {
+        QMutexLocker locker( &mutex_ );
+
+        if ( ! enabled_ )
+            return;
+
+        first = bitmaps_.size() / wordsPerBlock * linesPerBlock;
+        generation = generation_;
+    }
+
+    LOG(logDEBUG) << "Indexing the trigrams from line " << first;
+
+    std::vector<uint64_t> bitmap( wordsPerBlock );
+    std::vector<unsigned char> folded;
+
+    // The last line might not be complete
+    for ( LineNumber i = first; i + linesPerBlock < nbLines; i += linesPerBlock ) {
+        if ( *interruptRequest )
+            return;
+
+        std::vector<int> lineEnds;
+        const QByteArray blob = source->getRawLines( i, linesPerBlock, &lineEnds );
+        // The data might have been truncated
+        if ( (int) lineEnds.size() < linesPerBlock )
+            return;
+
+        folded.resize( blob.size() );
+        std::transform( blob.constData(), blob.constData() + blob.size(),
+                folded.begin(), [] ( char c ) { return foldCase( c ); } );
+
+        std::fill( bitmap.begin(), bitmap.end(), 0 );
+        for ( int j = 0; j < linesPerBlock; j++ ) {
+            const int beginning = ( j == 0 ) ? 0 : lineEnds[j-1] + 1;
+            for ( int k = beginning; k + 2 < lineEnds[j]; k++ ) {
+                const uint32_t bit = trigramBit( &folded[k] );
+                bitmap[bit / 64] |= uint64_t( 1 ) << ( bit % 64 );
+            }
+        }
+
+        QMutexLocker locker( &mutex_ );
+
+        // The lines have been forgotten meanwhile
+        if ( generation != generation_ )
+            return;
+
+        bitmaps_.insert( bitmaps_.end(), bitmap.begin(), bitmap.end() );
+    }
+}
+
+bool TrigramIndex::candidates( const QRegExp& regexp, MatchSet* candidates ) const
+{
+    const bool caseInsensitive = ( regexp.caseSensitivity() == Qt::CaseInsensitive );
+
+    // The bits every block having a match must have
+    std::vector<uint32_t> bits;
+    for ( const std::string& literal : LiteralPrefilter::requiredLiterals( regexp ) ) {
+        std::vector<unsigned char> folded( literal.size() );
+        std::transform( literal.begin(), literal.end(), folded.begin(),
+                [] ( char c ) { return foldCase( c ); } );
+
+        for ( size_t i = 0; i + 2 < folded.size(); i++ ) {
+            // We only know how to fold ASCII
+            if ( caseInsensitive
+                    && ( ( folded[i] | folded[i + 1] | folded[i + 2] ) & 0x80 ) )
+                continue;
+            bits.push_back( trigramBit( &folded[i] ) );
+        }
+    }
+
+    if ( bits.empty() )
+        return false;
+
+    std::sort( bits.begin(), bits.end() );
+    bits.erase( std::unique( bits.begin(), bits.end() ), bits.end() );
+
+    QMutexLocker locker( &mutex_ );
+
+    candidates->clear();
+    const size_t nbBlocks = bitmaps_.size() / wordsPerBlock;
+    for ( size_t b = 0; b < nbBlocks; b++ ) {
+        const uint64_t* bitmap = &bitmaps_[b * wordsPerBlock];
+
+        bool hasAll = true;
+        for ( uint32_t bit : bits ) {
+            if ( ! ( bitmap[bit / 64] & ( uint64_t( 1 ) << ( bit % 64 ) ) ) ) {
+                hasAll = false;
+                break;
+            }
+        }
+
+        if ( hasAll ) {
+            for ( int j = 0; j < linesPerBlock; j++ )
+                candidates->append( b * linesPerBlock + j );
+        }
+    }
+
+    return true;
+}
+
+void TrigramIndex::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    bitmaps_.clear();
+    generation_++;
+}
+
+void TrigramIndex::truncate( LineNumber nbLines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    const size_t nbBlocks = nbLines / linesPerBlock;
+    if ( bitmaps_.size() > nbBlocks * wordsPerBlock )
+        bitmaps_.resize( nbBlocks * wordsPerBlock );
+    generation_++;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <QMutex>
+#include <QRegExp>
+
+#include "matchset.h"
+
+class AbstractLogData;
+
+// An index of the trigrams (runs of three bytes) of the lines of a
+// file by blocks of lines, as code search engines do, so a search for
+// a pattern whose matches must contain some strings only reads the
+// blocks having all their trigrams.
+// Each block has a bitmap of the (hashed) trigrams of its lines, in
+// the raw (UTF-8) data folded to lower case (ASCII only) so it can be
+// used for case insensitive searches too. A collision only makes a
+// block read for nothing.
+// It is thread safe.
+class TrigramIndex
+{
+  public:
+    TrigramIndex();
+
+    // The index is disabled by default
+    void setEnabled( bool enabled );
+    bool isEnabled() const;
+
+    // Number of lines indexed (the lines of the blocks indexed)
+    LineNumber nbLines() const;
+
+    // Index the blocks of the source after the ones indexed, as long
+    // as they do not hold the last of the nbLines passed (it might not
+    // be complete yet).
+    // Stops if interrupted, the blocks done being kept.
+    void update( const AbstractLogData* source, LineNumber nbLines,
+            const std::atomic<bool>* interruptRequest );
+
+    // Sets candidates to the lines indexed which might match the passed
+    // regexp (those of the blocks having all its trigrams), returns
+    // false if no trigram can be required from its matches.
+    bool candidates( const QRegExp& regexp, MatchSet* candidates ) const;
+
+    // Forget the lines indexed (the file has changed)
+    void clear();
+    // Forget the lines from the passed line on (the end of the file
+    // has changed)
+    void truncate( LineNumber nbLines );
+
+    // Number of lines in a block
+    static const int linesPerBlock;
+
+  private:
+    // Number of 64 bits words in the bitmap of a block
+    static const int wordsPerBlock;
+
+    mutable QMutex mutex_;
+    bool enabled_;
+    // The bitmaps of all the blocks, one after the other
+    std::vector<uint64_t> bitmaps_;
+    // Changed each time the lines indexed are forgotten, so the
+    // indexing in progress is not added
+    int generation_;
+};
+
+#endif
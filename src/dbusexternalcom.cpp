@@ -22,6 +22,7 @@
 #include <QString>
 
 #include "log.h"
+#include "perfcounters.h"
 
 static const char* DBUS_SERVICE_NAME = "org.bonnefon.glogg";
 
@@ -38,6 +39,16 @@ DBusExternalCommunicator::DBusExternalCommunicator()
 
     connect( dbus_iface_object_.get(), SIGNAL( signalLoadFile( const QString& ) ),
              this, SIGNAL( loadFile( const QString& ) ) );
+    connect( dbus_iface_object_.get(),
+             SIGNAL( signalLoadFiles( const QStringList&, const QVariantMap& ) ),
+             this, SIGNAL( loadFiles( const QStringList&, const QVariantMap& ) ) );
+    // Queued for the id to be returned before the command can finish
+    connect( dbus_iface_object_.get(),
+             SIGNAL( signalRunCommand( qint32, const QString&,
+                     const QString&, const QVariantMap& ) ),
+             this, SIGNAL( runCommand( qint32, const QString&,
+                     const QString&, const QVariantMap& ) ),
+             Qt::QueuedConnection );
 }
 
 // If listening fails (e.g. another glogg is already listening,
@@ -70,11 +81,22 @@ qint32 DBusExternalCommunicator::version() const
     return 3;
 }
 
+void DBusExternalCommunicator::commandFinished( qint32 id, bool success,
+        const QVariantMap& result )
+{
+    emit dbus_iface_object_->commandFinished( id, success, result );
+}
+
 qint32 DBusInterfaceExternalCommunicator::version() const
 {
     return 0x010000;
 }
 
+QString DBusInterfaceExternalCommunicator::performanceCounters() const
+{
+    return PerfCounters::toJson();
+}
+
 void DBusInterfaceExternalCommunicator::loadFile( const QString& file_name )
 {
     LOG(logDEBUG) << "DBusInterfaceExternalCommunicator::loadFile()";
@@ -82,6 +104,32 @@ void DBusInterfaceExternalCommunicator::loadFile( const QString& file_name )
     emit signalLoadFile( file_name );
 }
 
+void DBusInterfaceExternalCommunicator::loadFiles(
+        const QStringList& file_names, const QVariantMap& options )
+{
+    LOG(logDEBUG) << "DBusInterfaceExternalCommunicator::loadFiles()";
+
+    emit signalLoadFiles( file_names, options );
+}
+
+qint32 DBusInterfaceExternalCommunicator::runCommand( const QString& file_name,
+        const QString& command, const QVariantMap& args )
+{
+    LOG(logDEBUG) << "DBusInterfaceExternalCommunicator::runCommand()";
+
+    // The arrays (e.g. the lines to mark) are received as variant arrays
+    QVariantMap values = args;
+    for ( QVariant& value : values ) {
+        if ( value.userType() == qMetaTypeId<QDBusArgument>() )
+            value = qdbus_cast<QVariantList>( value.value<QDBusArgument>() );
+    }
+
+    const qint32 id = nextCommandId_++;
+    emit signalRunCommand( id, file_name, command, values );
+
+    return id;
+}
+
 DBusExternalInstance::DBusExternalInstance()
 {
      dbusInterface_ = std::make_shared<QDBusInterface>(
@@ -102,6 +150,21 @@ void DBusExternalInstance::loadFile( const QString& file_name ) const
     }
 }
 
+void DBusExternalInstance::loadFiles( const QStringList& file_names,
+        const QVariantMap& options ) const
+{
+    QDBusReply<void> reply = dbusInterface_->call( "loadFiles",
+            file_names, options );
+
+    if ( ! reply.isValid() ) {
+        // Older instances only open one file at a time
+        LOG( logWARNING ) << "Invalid reply from D-Bus call: "
+            << qPrintable( reply.error().message() );
+        for ( const QString& file_name : file_names )
+            loadFile( file_name );
+    }
+}
+
 uint32_t DBusExternalInstance::getVersion() const
 {
     QDBusReply<qint32> reply = dbusInterface_->call( "version" );
@@ -114,3 +177,16 @@ uint32_t DBusExternalInstance::getVersion() const
 
     return (uint32_t) reply.value();
 }
+
+QString DBusExternalInstance::getPerformanceCounters() const
+{
+    QDBusReply<QString> reply = dbusInterface_->call( "performanceCounters" );
+
+    if ( ! reply.isValid() ) {
+        LOG( logWARNING ) << "Invalid reply from D-Bus call: "
+            << qPrintable( reply.error().message() );
+        return QString();
+    }
+
+    return reply.value();
+}
@@ -33,7 +33,10 @@ class DBusExternalInstance : public ExternalInstance {
     ~DBusExternalInstance() {}
 
     virtual void loadFile( const QString& file_name ) const;
+    virtual void loadFiles( const QStringList& file_names,
+            const QVariantMap& options ) const;
     virtual uint32_t getVersion() const;
+    virtual QString getPerformanceCounters() const;
 
   private:
     std::shared_ptr<QDBusInterface> dbusInterface_;
@@ -44,15 +47,30 @@ class DBusInterfaceExternalCommunicator : public QObject
   Q_OBJECT
 
   public:
-    DBusInterfaceExternalCommunicator() : QObject() {}
+    DBusInterfaceExternalCommunicator() : QObject(), nextCommandId_( 0 ) {}
     ~DBusInterfaceExternalCommunicator() {}
 
   public slots:
     void loadFile( const QString& file_name );
+    void loadFiles( const QStringList& file_names, const QVariantMap& options );
     qint32 version() const;
+    QString performanceCounters() const;
+    // Returns the id the commandFinished() D-Bus signal is then sent with
+    qint32 runCommand( const QString& file_name, const QString& command,
+            const QVariantMap& args );
 
   signals:
     void signalLoadFile( const QString& file_name );
+    void signalLoadFiles( const QStringList& file_names,
+            const QVariantMap& options );
+    void signalRunCommand( qint32 id, const QString& file_name,
+            const QString& command, const QVariantMap& args );
+
+    // Sent on the bus when a command is done
+    void commandFinished( qint32 id, bool success, const QVariantMap& result );
+
+  private:
+    qint32 nextCommandId_;
 };
 
 // An implementation of ExternalCommunicator using D-Bus via Qt
@@ -72,6 +90,7 @@ class DBusExternalCommunicator : public ExternalCommunicator
 
   public slots:
     qint32 version() const;
+    void commandFinished( qint32 id, bool success, const QVariantMap& result );
 
   private:
     std::shared_ptr<DBusInterfaceExternalCommunicator> dbus_iface_object_;
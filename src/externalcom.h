@@ -21,6 +21,8 @@
 #define EXTERNALCOM_H
 
 #include <QObject>
+#include <QStringList>
+#include <QVariantMap>
 
 class CantCreateExternalErr {};
 
@@ -36,7 +38,16 @@ class ExternalInstance
     virtual ~ExternalInstance() {}
 
     virtual void loadFile( const QString& file_name ) const = 0;
+    // Open all the files at once, the instance loading them a few at
+    // a time. The options (all optional) are:
+    //   "search" (string): the search to run in each file
+    //   "ignoreCase" (bool): whether the search ignores the case
+    virtual void loadFiles( const QStringList& file_names,
+            const QVariantMap& options ) const = 0;
     virtual uint32_t getVersion() const = 0;
+    // Returns the performance counters of the instance as JSON
+    // (empty if the IPC cannot return them)
+    virtual QString getPerformanceCounters() const = 0;
 };
 
 /*
@@ -58,9 +69,19 @@ class ExternalCommunicator : public QObject
 
   signals:
     void loadFile( const QString& file_name );
+    void loadFiles( const QStringList& file_names, const QVariantMap& options );
+    // A script runs the command on an open file (see
+    // CrawlerWidget::runCommand), commandFinished() is to be called
+    // with the id once it is done.
+    void runCommand( qint32 id, const QString& file_name,
+            const QString& command, const QVariantMap& args );
 
   public slots:
     virtual qint32 version() const = 0;
+    // Notify the script the command has finished, the result holding
+    // an "error" if it failed
+    virtual void commandFinished( qint32 id, bool success,
+            const QVariantMap& result ) = 0;
 };
 
 #endif
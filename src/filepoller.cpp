@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements FilePoller
+
+#include "filepoller.h"
+
+#include <QFileInfo>
+#include <QDir>
+
+#ifdef _WIN32
+#  include <windows.h>
+#elif defined(__linux__)
+#  include <sys/vfs.h>
+#else
+#  include <sys/param.h>
+#  include <sys/mount.h>
+#endif
+
+#include "log.h"
+
+FilePoller::FilePoller() : QObject(), schedule_(), files_(), clock_(), timer_()
+{
+    clock_.start();
+
+    timer_.setSingleShot( true );
+    connect( &timer_, SIGNAL( timeout() ), this, SLOT( poll() ) );
+}
+
+int FilePoller::addFile( const QString& fileName,
+        std::function<void()> notification )
+{
+    LOG(logDEBUG) << "FilePoller::addFile " << fileName.toStdString();
+
+    const QFileInfo info( fileName );
+    const int id = schedule_.add( clock_.elapsed() );
+    files_[id] = { fileName, info.exists() ? info.size() : -1,
+        info.lastModified(), std::move( notification ) };
+
+    scheduleNextPoll();
+
+    return id;
+}
+
+void FilePoller::removeFile( int id )
+{
+    schedule_.remove( id );
+    files_.erase( id );
+
+    scheduleNextPoll();
+}
+
+bool FilePoller::isOnNetworkFileSystem( const QString& fileName )
+{
+    QFileInfo info( fileName );
+    const QString path = info.exists() ? info.absoluteFilePath() : info.absolutePath();
+
+#ifdef _WIN32
+    if ( path.startsWith( "//" ) || path.startsWith( "\\\\" ) )
+        return true;
+
+    const QString root = QDir::toNativeSeparators( path.left( 3 ) );
+    return GetDriveTypeW( reinterpret_cast<LPCWSTR>( root.utf16() ) ) == DRIVE_REMOTE;
+#elif defined(__linux__)
+    struct statfs buf;
+    if ( statfs( QFile::encodeName( path ).constData(), &buf ) != 0 )
+        return false;
+
+    // Magic numbers from linux/magic.h (and the cifs sources)
+    switch ( static_cast<unsigned long>( buf.f_type ) ) {
+        case 0x6969:        // NFS
+        case 0x517B:        // SMB
+        case 0xFF534D42:    // CIFS
+        case 0xFE534D42:    // SMB2
+        case 0x564C:        // NCP
+        case 0x5346414F:    // AFS
+        case 0x73757245:    // Coda
+        case 0x65735546:    // FUSE (sshfs...)
+            return true;
+        default:
+            return false;
+    }
+#else
+    struct statfs buf;
+    if ( statfs( QFile::encodeName( path ).constData(), &buf ) != 0 )
+        return false;
+
+    return ( buf.f_flags & MNT_LOCAL ) == 0;
+#endif
+}
+
+//
+// Slots
+//
+
+void FilePoller::poll()
+{
+    const qint64 now = clock_.elapsed();
+
+    for ( int id : schedule_.takeDue( now ) ) {
+        auto file = files_.find( id );
+        if ( file == files_.end() )
+            continue;
+
+        const QFileInfo info( file->second.fileName );
+        const qint64 size = info.exists() ? info.size() : -1;
+        const QDateTime lastModified = info.lastModified();
+
+        const bool changed = ( size != file->second.size )
+            || ( lastModified != file->second.lastModified );
+        schedule_.polled( id, changed, now );
+
+        if ( changed ) {
+            LOG(logDEBUG) << "FilePoller: " << file->second.fileName.toStdString()
+                << " has changed";
+            file->second.size = size;
+            file->second.lastModified = lastModified;
+            // Can remove files (but not the one notified)
+            file->second.notification();
+        }
+    }
+
+    scheduleNextPoll();
+}
+
+//
+// Private functions
+//
+
+void FilePoller::scheduleNextPoll()
+{
+    const qint64 next = schedule_.nextDue();
+
+    if ( next == -1 )
+        timer_.stop();
+    else
+        timer_.start( qMax<qint64>( next - clock_.elapsed(), 0 ) );
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILEPOLLER_H
+#define FILEPOLLER_H
+
+#include <functional>
+#include <unordered_map>
+
+#include <QObject>
+#include <QString>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "pollingschedule.h"
+
+// Watches files by polling their size and modification date, for the
+// file systems the OS does not notify changes on (network mounts).
+// The files are polled according to a PollingSchedule: often for the
+// ones changing, less and less for the idle ones, and a bounded number
+// of stat calls per second overall.
+// It lives in the main thread.
+class FilePoller : public QObject {
+  Q_OBJECT
+
+  public:
+    FilePoller();
+
+    // Poll the passed file, calling the notification when it changes,
+    // returns the id to remove it.
+    int addFile( const QString& fileName, std::function<void()> notification );
+    void removeFile( int id );
+
+    // Returns whether the passed file (or the directory it would be
+    // created in) is on a network file system.
+    static bool isOnNetworkFileSystem( const QString& fileName );
+
+  private slots:
+    void poll();
+
+  private:
+    struct PolledFile {
+        QString fileName;
+        qint64 size;
+        QDateTime lastModified;
+        std::function<void()> notification;
+    };
+
+    // Schedule the timer for the next poll
+    void scheduleNextPoll();
+
+    PollingSchedule schedule_;
+    std::unordered_map<int, PolledFile> files_;
+    QElapsedTimer clock_;
+    QTimer timer_;
+};
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements FilterColorCache
+
+#include <algorithm>
+
+#include "log.h"
+
+#include "filtercolorcache.h"
+#include "data/logdata.h"
+#include "data/patternsetmatcher.h"
+
+const int FilterColorCache::maxCachedLines = 100000;
+
+FilterColorCache::FilterColorCache( const LogData* logData )
+    : QThread(), logData_( logData ), mutex_(), requestCond_(),
+    terminate_( false ), filterSet_(), matcher_(), filterIndexes_(),
+    pending_()
+{
+    matcher_ = filterSet_.newMatcher();
+
+    start();
+}
+
+FilterColorCache::~FilterColorCache()
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        terminate_ = true;
+        requestCond_.wakeAll();
+    }
+    wait();
+}
+
+void FilterColorCache::setFilterSet( const FilterSet& filterSet )
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( filterSet.generation() != filterSet_.generation() ) {
+        LOG(logDEBUG) << "FilterColorCache: new FilterSet";
+        filterSet_ = filterSet;
+        matcher_   = filterSet_.newMatcher();
+        filterIndexes_.clear();
+        pending_.clear();
+    }
+}
+
+bool FilterColorCache::getLineColors( qint64 line, bool* isFiltered,
+        QColor* foreColor, QColor* backColor ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    QHash<qint64, int>::const_iterator i = filterIndexes_.constFind( line );
+    if ( i == filterIndexes_.constEnd() )
+        return false;
+
+    *isFiltered = ( i.value() != -1 );
+    if ( *isFiltered )
+        filterSet_.getFilterColors( i.value(), foreColor, backColor );
+
+    return true;
+}
+
+void FilterColorCache::prefetch( const std::vector<qint64>& lines )
+{
+    QMutexLocker locker( &mutex_ );
+
+    bool added = false;
+    for ( qint64 line : lines ) {
+        if ( ! filterIndexes_.contains( line ) ) {
+            pending_.push_back( line );
+            added = true;
+        }
+    }
+
+    if ( added ) {
+        std::sort( pending_.begin(), pending_.end() );
+        pending_.erase( std::unique( pending_.begin(), pending_.end() ),
+                pending_.end() );
+        requestCond_.wakeAll();
+    }
+}
+
+void FilterColorCache::clear()
+{
+    QMutexLocker locker( &mutex_ );
+
+    filterIndexes_.clear();
+    pending_.clear();
+}
+
+void FilterColorCache::invalidateFrom( qint64 line )
+{
+    QMutexLocker locker( &mutex_ );
+
+    QHash<qint64, int>::iterator i = filterIndexes_.begin();
+    while ( i != filterIndexes_.end() ) {
+        if ( i.key() >= line )
+            i = filterIndexes_.erase( i );
+        else
+            ++i;
+    }
+}
+
+// Matches the pending lines, one run of consecutive lines at a time
+void FilterColorCache::run()
+{
+    QMutexLocker locker( &mutex_ );
+
+    forever {
+        while ( ( terminate_ == false ) && pending_.empty() )
+            requestCond_.wait( &mutex_ );
+
+        if ( terminate_ )
+            return;
+
+        // Take the first run of consecutive lines
+        std::vector<qint64>::iterator end = pending_.begin() + 1;
+        while ( end != pending_.end() && *end == *( end - 1 ) + 1 )
+            ++end;
+
+        const qint64 firstLine = pending_.front();
+        const int nbLines = end - pending_.begin();
+        pending_.erase( pending_.begin(), end );
+
+        const int generation = filterSet_.generation();
+        std::shared_ptr<const PatternSetMatcher> matcher = matcher_;
+
+        // Match without holding the lock
+        std::vector<QBitArray> matches;
+        int maxLength = 0;
+        locker.unlock();
+        // The file might have been truncated since the request
+        const bool valid = ( firstLine + nbLines <= logData_->getNbLine() );
+        if ( valid )
+            matcher->matchLines( logData_, firstLine, nbLines, &matches, &maxLength );
+        locker.relock();
+
+        // The filters might have changed in between
+        if ( generation != filterSet_.generation() || ! valid )
+            continue;
+
+        if ( filterIndexes_.size() + nbLines > maxCachedLines )
+            filterIndexes_.clear();
+
+        // The first filter matching a line wins
+        for ( int j = 0; j < nbLines; j++ ) {
+            int index = -1;
+            for ( size_t i = 0; i < matches.size(); i++ ) {
+                if ( j < matches[i].size() && matches[i].testBit( j ) ) {
+                    index = i;
+                    break;
+                }
+            }
+            filterIndexes_.insert( firstLine + j, index );
+        }
+
+        if ( pending_.empty() )
+            emit colorsAvailable();
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILTERCOLORCACHE_H
+#define FILTERCOLORCACHE_H
+
+#include <memory>
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+
+#include "filterset.h"
+
+class LogData;
+class PatternSetMatcher;
+
+// Caches which filter of the FilterSet colours each line of a LogData,
+// so the views can be painted without running any regexp.
+// The lines are matched in a thread of their own: the views ask for
+// the lines around what they display and are signalled when the colours
+// are available.
+// The cache is keyed on the line number in the LogData, and emptied
+// when the FilterSet changes (as seen through its generation).
+// All public functions are called from the GUI thread.
+class FilterColorCache : public QThread
+{
+  Q_OBJECT
+
+  public:
+    FilterColorCache( const LogData* logData );
+    ~FilterColorCache();
+
+    // Use the passed set to colour the lines, does nothing if it
+    // is the same generation as the one used already.
+    void setFilterSet( const FilterSet& filterSet );
+    // Returns false if the colours of the passed line are not known yet,
+    // else whether the line is coloured by a filter and its colours.
+    bool getLineColors( qint64 line, bool* isFiltered,
+            QColor* foreColor, QColor* backColor ) const;
+    // Ask for the passed lines to be matched in the background
+    // (lines already known are ignored).
+    void prefetch( const std::vector<qint64>& lines );
+    // Forget everything (used when the file is truncated)
+    void clear();
+    // Forget the lines from the passed one (used when the file grows,
+    // as the last line might not have been complete)
+    void invalidateFrom( qint64 line );
+
+    // Beyond this number of lines, the cache is emptied
+    static const int maxCachedLines;
+
+  signals:
+    // Sent when lines asked for have been matched
+    void colorsAvailable();
+
+  protected:
+    void run();
+
+  private:
+    const LogData* logData_;
+
+    // Protects everything below
+    mutable QMutex mutex_;
+    QWaitCondition requestCond_;
+    bool terminate_;
+
+    FilterSet filterSet_;
+    std::shared_ptr<const PatternSetMatcher> matcher_;
+    // Index of the filter colouring each known line (-1 if none)
+    QHash<qint64, int> filterIndexes_;
+    // Lines to match, sorted
+    std::vector<qint64> pending_;
+};
+
+#endif
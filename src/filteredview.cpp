@@ -49,6 +49,12 @@ void FilteredView::setVisibility( Visibility visi )
         case MarksAndMatches:
             data_visibility = LogFilteredData::MarksAndMatches;
             break;
+        case MatchesWithContext:
+            data_visibility = LogFilteredData::MatchesWithContext;
+            break;
+        case Collapsed:
+            data_visibility = LogFilteredData::Collapsed;
+            break;
     };
 
     logFilteredData_->setVisibility( data_visibility );
@@ -56,18 +62,21 @@ void FilteredView::setVisibility( Visibility visi )
     updateData();
 }
 
-// For the filtered view, a line is always matching!
-AbstractLogView::LineType FilteredView::lineType( int lineNumber ) const
+// For the filtered view, a line is always matching, unless it is
+// only shown as the context of a match!
+AbstractLogView::LineType FilteredView::lineType( qint64 lineNumber ) const
 {
     LogFilteredData::FilteredLineType type =
         logFilteredData_->filteredLineTypeByIndex( lineNumber );
     if ( type == LogFilteredData::Mark )
         return Marked;
+    else if ( type == LogFilteredData::Context )
+        return Normal;
     else
         return Match;
 }
 
-qint64 FilteredView::displayLineNumber( int lineNumber ) const
+qint64 FilteredView::displayLineNumber( qint64 lineNumber ) const
 {
     // Display a 1-based index
     return logFilteredData_->getMatchingLineNumber( lineNumber ) + 1;
@@ -77,3 +86,8 @@ qint64 FilteredView::maxDisplayLineNumber() const
 {
     return logFilteredData_->getNbTotalLines();
 }
+
+qint64 FilteredView::foldedLines( qint64 lineNumber ) const
+{
+    return logFilteredData_->getNbFoldedLines( lineNumber );
+}
@@ -33,15 +33,17 @@ class FilteredView : public AbstractLogView
             QWidget* parent = 0 );
 
     // What is visible in the view.
-    enum Visibility { MatchesOnly, MarksOnly, MarksAndMatches };
+    enum Visibility { MatchesOnly, MarksOnly, MarksAndMatches,
+        MatchesWithContext, Collapsed };
     void setVisibility( Visibility visi );
 
   protected:
-    virtual LineType lineType( int lineNumber ) const;
+    virtual LineType lineType( qint64 lineNumber ) const;
 
     // Number of the filtered line relative to the unfiltered source
-    virtual qint64 displayLineNumber( int lineNumber ) const;
+    virtual qint64 displayLineNumber( qint64 lineNumber ) const;
     virtual qint64 maxDisplayLineNumber() const;
+    virtual qint64 foldedLines( qint64 lineNumber ) const;
 
   private:
     LogFilteredData* logFilteredData_;
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements FilterMap
+
+#include <algorithm>
+
+#include "log.h"
+
+#include "filtermap.h"
+#include "data/logdata.h"
+#include "data/patternsetmatcher.h"
+
+const int FilterMap::maxFilters = 255;
+
+namespace {
+    const int nbLinesInChunk = 5000;
+}
+
+FilterMap::FilterMap( const LogData* logData )
+    : QThread(), logData_( logData ), mutex_(), requestCond_(),
+    terminate_( false ), active_( false ), filterSet_(), matcher_(),
+    epoch_( 0 ), nbLinesToMap_( 0 ), filterOfLine_(), linesOfFilter_()
+{
+    matcher_ = filterSet_.newMatcher();
+
+    start();
+}
+
+FilterMap::~FilterMap()
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        terminate_ = true;
+        requestCond_.wakeAll();
+    }
+    wait();
+}
+
+void FilterMap::setActive( bool active )
+{
+    QMutexLocker locker( &mutex_ );
+
+    active_ = active;
+    requestCond_.wakeAll();
+}
+
+void FilterMap::setFilterSet( const FilterSet& filterSet )
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( filterSet.generation() != filterSet_.generation() ) {
+        LOG(logDEBUG) << "FilterMap: new FilterSet";
+        filterSet_ = filterSet;
+        matcher_   = filterSet_.newMatcher();
+        truncate( 0 );
+        requestCond_.wakeAll();
+    }
+}
+
+void FilterMap::update()
+{
+    QMutexLocker locker( &mutex_ );
+
+    nbLinesToMap_ = logData_->getNbLine();
+    requestCond_.wakeAll();
+}
+
+void FilterMap::invalidateFrom( qint64 line )
+{
+    QMutexLocker locker( &mutex_ );
+
+    truncate( line );
+}
+
+qint64 FilterMap::nbLinesMapped() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return filterOfLine_.size();
+}
+
+int FilterMap::filterOfLine( qint64 line ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( line < 0 || line >= (qint64) filterOfLine_.size() )
+        return -1;
+
+    return filterOfLine_[line] - 1;
+}
+
+qint64 FilterMap::nextLineOfFilter( int filter, qint64 line ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( filter < 0 || filter >= (int) linesOfFilter_.size() )
+        return -1;
+
+    const std::vector<qint64>& lines = linesOfFilter_[filter];
+    std::vector<qint64>::const_iterator i = ( line < 0 ) ? lines.begin() :
+        std::upper_bound( lines.begin(), lines.end(), (qint64) line );
+    if ( i == lines.end() )
+        return -1;
+
+    return *i;
+}
+
+qint64 FilterMap::previousLineOfFilter( int filter, qint64 line ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( filter < 0 || filter >= (int) linesOfFilter_.size() || line <= 0 )
+        return -1;
+
+    const std::vector<qint64>& lines = linesOfFilter_[filter];
+    std::vector<qint64>::const_iterator i = std::lower_bound(
+            lines.begin(), lines.end(), (qint64) line );
+    if ( i == lines.begin() )
+        return -1;
+
+    return *( i - 1 );
+}
+
+void FilterMap::getDensity( int filter, qint64 totalNbLine, int nbSlices,
+        std::vector<int>* counts ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    counts->assign( nbSlices, 0 );
+
+    if ( filter < 0 || filter >= (int) linesOfFilter_.size()
+            || totalNbLine <= 0 )
+        return;
+
+    // The lines are sorted, each slice is counted from the position of
+    // its first line, so the cost depends on the number of slices.
+    const std::vector<qint64>& lines = linesOfFilter_[filter];
+    std::vector<qint64>::const_iterator first = lines.begin();
+    for ( int slice = 0; slice < nbSlices && first != lines.end(); slice++ ) {
+        const qint64 nextSliceLine =
+            ( (qint64) ( slice + 1 ) * totalNbLine + nbSlices - 1 ) / nbSlices;
+        const std::vector<qint64>::const_iterator next = std::lower_bound(
+                first, lines.end(), (qint64) nextSliceLine );
+        ( *counts )[slice] = next - first;
+        first = next;
+    }
+}
+
+int FilterMap::nbFilters() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return linesOfFilter_.size();
+}
+
+void FilterMap::getFilterColors( int filter,
+        QColor* foreColor, QColor* backColor ) const
+{
+    QMutexLocker locker( &mutex_ );
+
+    filterSet_.getFilterColors( filter, foreColor, backColor );
+}
+
+void FilterMap::truncate( qint64 line )
+{
+    if ( line < (qint64) filterOfLine_.size() ) {
+        filterOfLine_.resize( line );
+        for ( std::vector<qint64>& lines : linesOfFilter_ )
+            lines.erase( std::lower_bound( lines.begin(), lines.end(),
+                        (qint64) line ), lines.end() );
+    }
+
+    if ( line == 0 )
+        linesOfFilter_.assign(
+                std::min( (int) matcher_->size(), maxFilters ),
+                std::vector<qint64>() );
+
+    nbLinesToMap_ = logData_->getNbLine();
+    epoch_++;
+}
+
+// Maps the lines not mapped yet, one chunk at a time
+void FilterMap::run()
+{
+    QMutexLocker locker( &mutex_ );
+
+    forever {
+        while ( ( terminate_ == false ) && ( ! active_
+                    || (qint64) filterOfLine_.size() >= nbLinesToMap_ ) )
+            requestCond_.wait( &mutex_ );
+
+        if ( terminate_ )
+            return;
+
+        const qint64 firstLine = filterOfLine_.size();
+        const int nbLines = std::min<qint64>(
+                nbLinesToMap_ - firstLine, nbLinesInChunk );
+        const int epoch = epoch_;
+        std::shared_ptr<const PatternSetMatcher> matcher = matcher_;
+
+        // Match without holding the lock
+        std::vector<QBitArray> matches;
+        int maxLength = 0;
+        locker.unlock();
+        // The file might have been truncated since the request
+        const bool valid = ( firstLine + nbLines <= logData_->getNbLine() );
+        if ( valid && matcher->size() > 0 )
+            matcher->matchLines( logData_, firstLine, nbLines,
+                    &matches, &maxLength );
+        locker.relock();
+
+        // The map might have been invalidated in between
+        if ( epoch != epoch_ )
+            continue;
+
+        if ( ! valid ) {
+            nbLinesToMap_ = logData_->getNbLine();
+            continue;
+        }
+
+        // The first filter matching a line wins
+        const int nbFilters = linesOfFilter_.size();
+        for ( int j = 0; j < nbLines; j++ ) {
+            int index = -1;
+            for ( int i = 0; i < nbFilters && i < (int) matches.size(); i++ ) {
+                if ( j < matches[i].size() && matches[i].testBit( j ) ) {
+                    index = i;
+                    break;
+                }
+            }
+            filterOfLine_.push_back( index + 1 );
+            if ( index >= 0 )
+                linesOfFilter_[index].push_back( firstLine + j );
+        }
+
+        const qint64 nbLinesMapped = filterOfLine_.size();
+        const qint64 nbLinesToMap  = nbLinesToMap_;
+        if ( nbLinesMapped >= nbLinesToMap ) {
+            LOG(logDEBUG) << "FilterMap: " << nbLinesMapped << " lines mapped";
+            emit mapFinished();
+        }
+        else {
+            const int previous = ( nbLinesMapped - nbLines ) * 100 / nbLinesToMap;
+            const int percent  = nbLinesMapped * 100 / nbLinesToMap;
+            if ( percent != previous )
+                emit mapProgressed( percent );
+        }
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILTERMAP_H
+#define FILTERMAP_H
+
+#include <memory>
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "filterset.h"
+
+class LogData;
+class PatternSetMatcher;
+
+// Maps which filter of the FilterSet colours each line of the whole
+// LogData, for the overview to show where each filter matches and to
+// find the next line coloured by a given filter without matching again.
+// The map is built by a thread of its own, from the start of the file,
+// while it is active.
+// All public functions are called from the GUI thread.
+class FilterMap : public QThread
+{
+  Q_OBJECT
+
+  public:
+    FilterMap( const LogData* logData );
+    ~FilterMap();
+
+    // The map is only built while active (e.g. the overview is visible)
+    void setActive( bool active );
+    // Map the file with the passed set, does nothing if it is the same
+    // generation as the one used already.
+    void setFilterSet( const FilterSet& filterSet );
+    // Map the lines added to the file since the last update
+    void update();
+    // Forget the lines from the passed one (the whole map if 0)
+    void invalidateFrom( qint64 line );
+
+    // Returns the number of lines mapped so far
+    qint64 nbLinesMapped() const;
+    // Returns the index of the filter colouring the passed line,
+    // -1 if none or if the line is not mapped yet.
+    int filterOfLine( qint64 line ) const;
+    // Returns the first line after the passed one coloured by the passed
+    // filter, or -1 if none is known.
+    qint64 nextLineOfFilter( int filter, qint64 line ) const;
+    // Returns the last line before the passed one coloured by the passed
+    // filter, or -1 if none is known.
+    qint64 previousLineOfFilter( int filter, qint64 line ) const;
+    // Count the lines coloured by the passed filter in each of 'nbSlices'
+    // equal slices of a file of 'totalNbLine' lines.
+    void getDensity( int filter, qint64 totalNbLine, int nbSlices,
+            std::vector<int>* counts ) const;
+    // Returns the number of filters of the set used
+    int nbFilters() const;
+    // Get the colours of the filter at the passed index
+    void getFilterColors( int filter,
+            QColor* foreColor, QColor* backColor ) const;
+
+    // Only the first filters are mapped (the index is kept on a byte)
+    static const int maxFilters;
+
+  signals:
+    // Sent while mapping, percent being the proportion of the file mapped.
+    void mapProgressed( int percent );
+    // Sent when the whole file has been mapped.
+    void mapFinished();
+
+  protected:
+    void run();
+
+  private:
+    // Truncate the map (must be called with the mutex held)
+    void truncate( qint64 line );
+
+    const LogData* logData_;
+
+    // Protects everything below
+    mutable QMutex mutex_;
+    QWaitCondition requestCond_;
+    bool terminate_;
+    bool active_;
+
+    FilterSet filterSet_;
+    std::shared_ptr<const PatternSetMatcher> matcher_;
+    // Changed whenever the map is invalidated, so the lines matched
+    // meanwhile are thrown away
+    int epoch_;
+    // Number of lines of the file to map
+    qint64 nbLinesToMap_;
+    // For each line mapped, the index of the filter colouring it
+    // plus one (0 meaning none)
+    std::vector<quint8> filterOfLine_;
+    // For each filter, the (sorted) lines it colours
+    std::vector<std::vector<qint64>> linesOfFilter_;
+};
+
+#endif
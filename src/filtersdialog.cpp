@@ -22,6 +22,7 @@
 #include "configuration.h"
 #include "persistentinfo.h"
 #include "filterset.h"
+#include "data/abstractlogdata.h"
 
 #include "filtersdialog.h"
 
@@ -31,7 +32,8 @@ static const QString DEFAULT_BACK_COLOUR = "white";
 
 // Construct the box, including a copy of the global FilterSet
 // to handle ok/cancel/apply
-FiltersDialog::FiltersDialog( QWidget* parent ) : QDialog( parent )
+FiltersDialog::FiltersDialog( const AbstractLogData* logData,
+        QWidget* parent ) : QDialog( parent ), logData_( logData )
 {
     setupUi( this );
 
@@ -65,6 +67,18 @@ FiltersDialog::FiltersDialog( QWidget* parent ) : QDialog( parent )
             this, SLOT( updateFilterProperties() ) );
     connect( backColorBox, SIGNAL( activated( int ) ),
             this, SLOT( updateFilterProperties() ) );
+    connect( watchCheck, SIGNAL( clicked() ),
+            this, SLOT( updateFilterProperties() ) );
+
+    if ( logData_ ) {
+        matchEstimator_.reset( new MatchEstimator( logData_ ) );
+        connect( patternEdit, SIGNAL( textEdited( const QString& ) ),
+                this, SLOT( estimateMatches() ) );
+        connect( matchEstimator_.get(),
+                SIGNAL( estimated( const QRegExp&, qint64, qint64, qint64 ) ),
+                this,
+                SLOT( matchesEstimated( const QRegExp&, qint64, qint64, qint64 ) ) );
+    }
 }
 
 //
@@ -156,6 +170,9 @@ void FiltersDialog::updatePropertyFields()
 
     LOG(logDEBUG) << "updatePropertyFields(), row = " << selectedRow_;
 
+    // (the estimate was for the pattern of the previous filter)
+    estimateLabel->clear();
+
     if ( selectedRow_ >= 0 ) {
         const Filter& currentFilter = filterSet->filterList.at( selectedRow_ );
 
@@ -174,6 +191,8 @@ void FiltersDialog::updatePropertyFields()
             backColorBox->setCurrentIndex( index );
             backColorBox->setEnabled( true );
         }
+        watchCheck->setChecked( currentFilter.isWatched() );
+        watchCheck->setEnabled( true );
 
         // Enable the buttons if needed
         removeFilterButton->setEnabled( true );
@@ -186,6 +205,7 @@ void FiltersDialog::updatePropertyFields()
         patternEdit->setEnabled( false );
         foreColorBox->setEnabled( false );
         backColorBox->setEnabled( false );
+        watchCheck->setEnabled( false );
     }
 }
 
@@ -201,6 +221,7 @@ void FiltersDialog::updateFilterProperties()
         currentFilter.setPattern( patternEdit->text() );
         currentFilter.setForeColor( foreColorBox->currentText() );
         currentFilter.setBackColor( backColorBox->currentText() );
+        currentFilter.setWatched( watchCheck->isChecked() );
 
         // Update the entry in the filterList widget
         filterListWidget->currentItem()->setText( patternEdit->text() );
@@ -211,6 +232,29 @@ void FiltersDialog::updateFilterProperties()
     }
 }
 
+void FiltersDialog::estimateMatches()
+{
+    // (as the regexp of the Filter)
+    const QRegExp regexp( patternEdit->text() );
+
+    estimateLabel->clear();
+    if ( ! regexp.isEmpty() && regexp.isValid() )
+        matchEstimator_->estimate( regexp );
+    else
+        matchEstimator_->cancel();
+}
+
+void FiltersDialog::matchesEstimated( const QRegExp& regexp, qint64 nbMatches,
+        qint64 nbLinesSampled, qint64 searchTime )
+{
+    // The pattern might have been changed meanwhile
+    if ( regexp.pattern() != patternEdit->text() )
+        return;
+
+    estimateLabel->setText( MatchEstimator::describe( nbMatches,
+                nbLinesSampled, logData_->getNbLine(), searchTime ) );
+}
+
 //
 // Private functions
 //
@@ -285,6 +329,10 @@ void FiltersDialog::populateFilterList()
         // new_item->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEditable | Qt::ItemIsEnabled );
         new_item->setForeground( QBrush( QColor( filter.foreColorName() ) ) );
         new_item->setBackground( QBrush( QColor( filter.backColorName() ) ) );
+        if ( CompiledRegExp::isTooCostly( filter.regexp() ) )
+            new_item->setToolTip( tr( "This expression is too costly to match "
+                        "(it backtracks too much), it does not colour the "
+                        "lines any more." ) );
         filterListWidget->addItem( new_item );
     }
 }
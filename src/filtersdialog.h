@@ -25,14 +25,19 @@
 #include <QDialog>
 
 #include "filterset.h"
+#include "data/matchestimator.h"
 #include "ui_filtersdialog.h"
 
+class AbstractLogData;
+
 class FiltersDialog : public QDialog, public Ui::FiltersDialog
 {
   Q_OBJECT
 
   public:
-    FiltersDialog( QWidget* parent = 0 );
+    // The matches of the pattern typed are estimated on the passed
+    // source (the file displayed), if any
+    FiltersDialog( const AbstractLogData* logData, QWidget* parent = 0 );
 
   signals:
     // Is emitted when new settings must be used
@@ -49,6 +54,11 @@ class FiltersDialog : public QDialog, public Ui::FiltersDialog
     void updatePropertyFields();
     // Update the selected Filter from the values in the property fields.
     void updateFilterProperties();
+    // Estimate the matches of the pattern typed (see MatchEstimator)
+    void estimateMatches();
+    // Called when they have been estimated
+    void matchesEstimated( const QRegExp& regexp, qint64 nbMatches,
+            qint64 nbLinesSampled, qint64 searchTime );
 
   private:
     // Temporary filterset modified by the dialog
@@ -58,6 +68,10 @@ class FiltersDialog : public QDialog, public Ui::FiltersDialog
     // Index of the row currently selected or -1 if none.
     int selectedRow_;
 
+    const AbstractLogData* logData_;
+    // Null if there is no source
+    std::unique_ptr<MatchEstimator> matchEstimator_;
+
     void populateColors();
     void populateFilterList();
 };
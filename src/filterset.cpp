@@ -19,26 +19,40 @@
 
 // This file implements classes Filter and FilterSet
 
+#include <atomic>
+
 #include <QSettings>
 
 #include "log.h"
 #include "filterset.h"
+#include "data/patternsetmatcher.h"
 
 const int FilterSet::FILTERSET_VERSION = 1;
 
-Filter::Filter()
+namespace {
+    // Generation given to the next modified FilterSet
+    std::atomic<int> nextGeneration( 1 );
+}
+
+Filter::Filter() : watched_( false )
 {
 }
 
 Filter::Filter( const QString& pattern,
             const QString& foreColorName, const QString& backColorName ) :
-    regexp_( pattern ), foreColorName_( foreColorName ),
-    backColorName_( backColorName ), enabled_( true )
+    regexp_( pattern ), compiled_( regexp_ ), keywords_( regexp_ ),
+    foreColorName_( foreColorName ),
+    backColorName_( backColorName ), enabled_( true ), watched_( false )
 {
     LOG(logDEBUG) << "New Filter, fore: " << foreColorName_.toStdString()
         << " back: " << backColorName_.toStdString();
 }
 
+const QRegExp& Filter::regexp() const
+{
+    return regexp_;
+}
+
 QString Filter::pattern() const
 {
     return regexp_.pattern();
@@ -47,6 +61,8 @@ QString Filter::pattern() const
 void Filter::setPattern( const QString& pattern )
 {
     regexp_.setPattern( pattern );
+    compiled_ = CompiledRegExp( regexp_ );
+    keywords_ = KeywordMatcher( regexp_ );
 }
 
 const QString& Filter::foreColorName() const
@@ -69,9 +85,22 @@ void Filter::setBackColor( const QString& backColorName )
     backColorName_ = backColorName;
 }
 
+bool Filter::isWatched() const
+{
+    return watched_;
+}
+
+void Filter::setWatched( bool watched )
+{
+    watched_ = watched;
+}
+
 int Filter::indexIn( const QString& string ) const
 {
-    return regexp_.indexIn( string );
+    if ( keywords_.isValid() )
+        return keywords_.indexIn( string );
+
+    return compiled_.indexIn( string );
 }
 
 //
@@ -92,6 +121,8 @@ QDataStream& operator>>( QDataStream& in, Filter& object )
 {
     LOG(logDEBUG) << ">>operator from Filter";
     in >> object.regexp_;
+    object.compiled_ = CompiledRegExp( object.regexp_ );
+    object.keywords_ = KeywordMatcher( object.regexp_ );
     in >> object.foreColorName_;
     in >> object.backColorName_;
 
@@ -100,13 +131,21 @@ QDataStream& operator>>( QDataStream& in, Filter& object )
 
 
 // Default constructor
-FilterSet::FilterSet()
+FilterSet::FilterSet() : filterList(), generation_( nextGeneration++ )
 {
     qRegisterMetaTypeStreamOperators<Filter>( "Filter" );
     qRegisterMetaTypeStreamOperators<FilterSet>( "FilterSet" );
     qRegisterMetaTypeStreamOperators<FilterSet::FilterList>( "FilterSet::FilterList" );
 }
 
+FilterSet& FilterSet::operator=( const FilterSet& other )
+{
+    filterList  = other.filterList;
+    generation_ = nextGeneration++;
+
+    return *this;
+}
+
 bool FilterSet::matchLine( const QString& line,
         QColor* foreColor, QColor* backColor ) const
 {
@@ -122,6 +161,54 @@ bool FilterSet::matchLine( const QString& line,
     return false;
 }
 
+void FilterSet::matchLines( const LogData* logData, qint64 firstLine,
+        int nbLines, std::vector<int>* filterIndexes ) const
+{
+    std::vector<QBitArray> matches;
+    int maxLength = 0;
+    newMatcher()->matchLines( logData, firstLine, nbLines, &matches, &maxLength );
+
+    filterIndexes->assign( nbLines, -1 );
+    // The first filter matching a line wins
+    for ( int i = matches.size() - 1; i >= 0; i-- ) {
+        const QBitArray& bits = matches[i];
+        for ( int j = 0; j < bits.size(); j++ ) {
+            if ( bits.testBit( j ) )
+                (*filterIndexes)[j] = i;
+        }
+    }
+}
+
+void FilterSet::getFilterColors( int index,
+        QColor* foreColor, QColor* backColor ) const
+{
+    foreColor->setNamedColor( filterList[index].foreColorName() );
+    backColor->setNamedColor( filterList[index].backColorName() );
+}
+
+std::unique_ptr<const PatternSetMatcher> FilterSet::newMatcher() const
+{
+    std::vector<QRegExp> patterns;
+    patterns.reserve( filterList.size() );
+    for ( const Filter& filter : filterList )
+        patterns.push_back( filter.regexp() );
+
+    return std::unique_ptr<const PatternSetMatcher>(
+            new PatternSetMatcher( patterns ) );
+}
+
+std::unique_ptr<const PatternSetMatcher> FilterSet::newWatchMatcher() const
+{
+    std::vector<QRegExp> patterns;
+    for ( const Filter& filter : filterList ) {
+        if ( filter.isWatched() )
+            patterns.push_back( filter.regexp() );
+    }
+
+    return std::unique_ptr<const PatternSetMatcher>(
+            new PatternSetMatcher( patterns ) );
+}
+
 //
 // Operators for serialization
 //
@@ -138,6 +225,7 @@ QDataStream& operator>>( QDataStream& in, FilterSet& object )
 {
     LOG(logDEBUG) << ">>operator from FilterSet";
     in >> object.filterList;
+    object.generation_ = nextGeneration++;
 
     return in;
 }
@@ -153,6 +241,7 @@ void Filter::saveToStorage( QSettings& settings ) const
     settings.setValue( "regexp", regexp_.pattern() );
     settings.setValue( "fore_colour", foreColorName_ );
     settings.setValue( "back_colour", backColorName_ );
+    settings.setValue( "watched", watched_ );
 }
 
 void Filter::retrieveFromStorage( QSettings& settings )
@@ -160,8 +249,11 @@ void Filter::retrieveFromStorage( QSettings& settings )
     LOG(logDEBUG) << "Filter::retrieveFromStorage";
 
     regexp_ = QRegExp( settings.value( "regexp" ).toString() );
+    compiled_ = CompiledRegExp( regexp_ );
+    keywords_ = KeywordMatcher( regexp_ );
     foreColorName_ = settings.value( "fore_colour" ).toString();
     backColorName_ = settings.value( "back_colour" ).toString();
+    watched_ = settings.value( "watched", false ).toBool();
 }
 
 void FilterSet::saveToStorage( QSettings& settings ) const
@@ -186,6 +278,7 @@ void FilterSet::retrieveFromStorage( QSettings& settings )
     LOG(logDEBUG) << "FilterSet::retrieveFromStorage";
 
     filterList.clear();
+    generation_ = nextGeneration++;
 
     if ( settings.contains( "FilterSet/version" ) ) {
         settings.beginGroup( "FilterSet" );
@@ -20,11 +20,19 @@
 #ifndef FILTERSET_H
 #define FILTERSET_H
 
+#include <memory>
+#include <vector>
+
 #include <QRegExp>
 #include <QColor>
 #include <QMetaType>
 
 #include "persistable.h"
+#include "data/compiledregexp.h"
+#include "data/keywordmatcher.h"
+
+class LogData;
+class PatternSetMatcher;
 
 // Represents a filter, i.e. a regexp and the colors matching text
 // should be rendered in.
@@ -41,12 +49,17 @@ class Filter
     int indexIn( const QString& string ) const;
 
     // Accessor functions
+    const QRegExp& regexp() const;
     QString pattern() const;
     void setPattern( const QString& pattern );
     const QString& foreColorName() const;
     void setForeColor( const QString& foreColorName );
     const QString& backColorName() const;
     void setBackColor( const QString& backColorName );
+    // A watched filter is matched against the lines appended to the
+    // files, the user being notified of the new matches (see FilterWatch)
+    bool isWatched() const;
+    void setWatched( bool watched );
 
     // Operators for serialization
     // (must be kept to migrate filters from <=0.8.2)
@@ -59,9 +72,14 @@ class Filter
 
   private:
     QRegExp regexp_;
+    // The regexp_ as matched by indexIn(), by keywords_ if it is only
+    // an alternation of keywords
+    CompiledRegExp compiled_;
+    KeywordMatcher keywords_;
     QString foreColorName_;
     QString backColorName_;
     bool enabled_;
+    bool watched_;
 };
 
 // Represents an ordered set of filters to be applied to each line displayed.
@@ -70,6 +88,14 @@ class FilterSet : public Persistable
   public:
     // Construct an empty filter set
     FilterSet();
+    // Copies keep the generation of the original, which is changed
+    // when the set is assigned to.
+    FilterSet( const FilterSet& other ) = default;
+    FilterSet& operator=( const FilterSet& other );
+
+    // Returns a number identifying the content of the set, changing
+    // every time it is modified.
+    int generation() const { return generation_; }
 
     // Returns weither the passed line match a filter of the set,
     // if so, it returns the fore/back colors the line should use.
@@ -77,6 +103,19 @@ class FilterSet : public Persistable
     bool matchLine( const QString& line,
             QColor* foreColor, QColor* backColor ) const;
 
+    // Match a range of lines against all the filters at once (reading
+    // the lines only once), filterIndexes receiving for each line the
+    // index of the filter colouring it, or -1.
+    void matchLines( const LogData* logData, qint64 firstLine, int nbLines,
+            std::vector<int>* filterIndexes ) const;
+    // Returns the colours of the filter at the passed index
+    void getFilterColors( int index,
+            QColor* foreColor, QColor* backColor ) const;
+    // Returns a matcher for the filters, in order
+    std::unique_ptr<const PatternSetMatcher> newMatcher() const;
+    // Idem for the watched filters only
+    std::unique_ptr<const PatternSetMatcher> newWatchMatcher() const;
+
     // Reads/writes the current config in the QSettings object passed
     virtual void saveToStorage( QSettings& settings ) const;
     virtual void retrieveFromStorage( QSettings& settings );
@@ -96,6 +135,7 @@ class FilterSet : public Persistable
     static const int FILTERSET_VERSION;
 
     FilterList filterList;
+    int generation_;
 
     // To simplify this class interface, FilterDialog can access our
     // internal structure directly.
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements FilterWatch
+
+#include <algorithm>
+
+#include "log.h"
+
+#include "filterwatch.h"
+#include "data/logdata.h"
+#include "data/patternsetmatcher.h"
+
+namespace {
+    const int nbLinesInChunk = 5000;
+}
+
+FilterWatch::FilterWatch( const LogData* logData )
+    : QObject(), logData_( logData ), terminate_( false ), mutex_(),
+    filterSetGeneration_( 0 ), matcher_(), epoch_( 0 ),
+    nbLinesMatched_( -1 ), nbLinesToMatch_( 0 ), nbNewMatches_( 0 ),
+    lastNewMatch_( -1 ), task_(), taskSubmitted_( false )
+{
+}
+
+FilterWatch::~FilterWatch()
+{
+    terminate_ = true;
+
+    TaskScheduler::TaskHandle task;
+    {
+        QMutexLocker locker( &mutex_ );
+        task = task_;
+    }
+
+    if ( task && ! TaskScheduler::instance().cancel( task ) ) {
+        TaskScheduler::instance().expedite( task );
+        TaskScheduler::instance().wait( task );
+    }
+}
+
+void FilterWatch::setFilterSet( const FilterSet& filterSet )
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( filterSet.generation() != filterSetGeneration_ ) {
+        LOG(logDEBUG) << "FilterWatch: new FilterSet";
+        filterSetGeneration_ = filterSet.generation();
+        matcher_ = filterSet.newWatchMatcher();
+        // The lines matched meanwhile were for the previous filters
+        epoch_++;
+
+        submitIfNeeded();
+    }
+}
+
+void FilterWatch::update()
+{
+    QMutexLocker locker( &mutex_ );
+
+    nbLinesToMatch_ = logData_->getNbLine();
+    if ( nbLinesMatched_ < 0 )
+        nbLinesMatched_ = nbLinesToMatch_;
+
+    submitIfNeeded();
+}
+
+void FilterWatch::restartFrom( qint64 line )
+{
+    QMutexLocker locker( &mutex_ );
+
+    if ( nbLinesMatched_ > line )
+        nbLinesMatched_ = line;
+    epoch_++;
+}
+
+void FilterWatch::reset()
+{
+    QMutexLocker locker( &mutex_ );
+
+    nbLinesMatched_ = -1;
+    epoch_++;
+}
+
+qint64 FilterWatch::nbNewMatches() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return nbNewMatches_;
+}
+
+qint64 FilterWatch::lastNewMatch() const
+{
+    QMutexLocker locker( &mutex_ );
+
+    return lastNewMatch_;
+}
+
+void FilterWatch::acknowledge()
+{
+    QMutexLocker locker( &mutex_ );
+
+    nbNewMatches_ = 0;
+    lastNewMatch_ = -1;
+}
+
+void FilterWatch::submitIfNeeded()
+{
+    if ( taskSubmitted_ || terminate_ || ! matcher_ || matcher_->size() == 0
+            || nbLinesMatched_ < 0 || nbLinesMatched_ >= nbLinesToMatch_ )
+        return;
+
+    taskSubmitted_ = true;
+    task_ = TaskScheduler::instance().submit( [this] { run(); },
+            TaskScheduler::Background );
+}
+
+void FilterWatch::run()
+{
+    QMutexLocker locker( &mutex_ );
+
+    while ( ! terminate_ && matcher_->size() > 0
+            && nbLinesMatched_ >= 0 && nbLinesMatched_ < nbLinesToMatch_ ) {
+        const qint64 firstLine = nbLinesMatched_;
+        const int nbLines = std::min<qint64>(
+                nbLinesToMatch_ - firstLine, nbLinesInChunk );
+        const int epoch = epoch_;
+        std::shared_ptr<const PatternSetMatcher> matcher = matcher_;
+
+        // Match without holding the lock
+        std::vector<QBitArray> matches;
+        int maxLength = 0;
+        locker.unlock();
+        // The file might have been truncated since the update
+        const bool valid = ( firstLine + nbLines <= logData_->getNbLine() );
+        if ( valid )
+            matcher->matchLines( logData_, firstLine, nbLines,
+                    &matches, &maxLength );
+        TaskScheduler::instance().yield();
+        locker.relock();
+
+        // The lines to match might have been changed in between
+        if ( epoch != epoch_ )
+            continue;
+
+        if ( ! valid ) {
+            nbLinesToMatch_ = logData_->getNbLine();
+            continue;
+        }
+
+        qint64 nbNewMatches = 0;
+        for ( int j = 0; j < nbLines; j++ ) {
+            for ( const QBitArray& bits : matches ) {
+                if ( j < bits.size() && bits.testBit( j ) ) {
+                    nbNewMatches++;
+                    lastNewMatch_ = firstLine + j;
+                    break;
+                }
+            }
+        }
+        nbLinesMatched_ = firstLine + nbLines;
+
+        if ( nbNewMatches > 0 ) {
+            nbNewMatches_ += nbNewMatches;
+            LOG(logDEBUG) << "FilterWatch: " << nbNewMatches
+                << " new lines matching";
+            emit newMatches( nbNewMatches_ );
+        }
+    }
+
+    taskSubmitted_ = false;
+}
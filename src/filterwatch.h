@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILTERWATCH_H
+#define FILTERWATCH_H
+
+#include <atomic>
+#include <memory>
+
+#include <QObject>
+#include <QMutex>
+
+#include "filterset.h"
+#include "data/taskscheduler.h"
+
+class LogData;
+class PatternSetMatcher;
+
+// Matches the watched filters of the FilterSet (the standing queries)
+// against the lines appended to a file, counting the new lines matching
+// them until the user acknowledges them.
+// Only the lines added since the last update are matched (as for an
+// UpdateSearchOperation), all the watched filters at once so the new
+// data is read once whatever their number (see PatternSetMatcher).
+// The matching runs on the TaskScheduler, in the background.
+// All public functions are called from the GUI thread.
+class FilterWatch : public QObject
+{
+  Q_OBJECT
+
+  public:
+    FilterWatch( const LogData* logData );
+    ~FilterWatch();
+
+    // Watch the filters of the passed set marked as watched, does
+    // nothing if it is the same generation as the one used already.
+    void setFilterSet( const FilterSet& filterSet );
+    // Match the lines added to the file since the last update, the
+    // lines the file has when first updated being the ones not new.
+    void update();
+    // The lines from the passed one are new (e.g. the file has been
+    // truncated and written again)
+    void restartFrom( qint64 line );
+    // The file is read again: the lines it has when next updated
+    // are not new
+    void reset();
+
+    // Returns the number of new lines matching a watched filter since
+    // they were last acknowledged
+    qint64 nbNewMatches() const;
+    // Returns the last of them, -1 if none
+    qint64 lastNewMatch() const;
+    // Start counting the new matches from zero
+    void acknowledge();
+
+  signals:
+    // Sent when new lines have matched a watched filter, nbNewMatches
+    // being the number of them not acknowledged
+    void newMatches( qint64 nbNewMatches );
+
+  private:
+    // Match the new lines, one chunk at a time
+    void run();
+    // Queue the matching if there are new lines to match
+    // (with mutex_ held)
+    void submitIfNeeded();
+
+    const LogData* logData_;
+
+    // Set to end the task, read without the mutex while matching
+    std::atomic<bool> terminate_;
+
+    // Protects everything below
+    mutable QMutex mutex_;
+
+    int filterSetGeneration_;
+    std::shared_ptr<const PatternSetMatcher> matcher_;
+    // Changed whenever the lines to match are changed, so the lines
+    // matched meanwhile are thrown away
+    int epoch_;
+    // Lines matched so far (-1 before the first update), and to match
+    qint64 nbLinesMatched_;
+    qint64 nbLinesToMatch_;
+    qint64 nbNewMatches_;
+    qint64 lastNewMatch_;
+
+    TaskScheduler::TaskHandle task_;
+    bool taskSubmitted_;
+};
+
+#endif
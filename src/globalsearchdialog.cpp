@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "globalsearchdialog.h"
+
+#include <QCheckBox>
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSplitter>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "crawlerwidget.h"
+
+// Matching lines of each tab shown in the results list, the other
+// ones being seen in the tab itself
+static const int maxResultsPerTab = 200;
+
+// The data attached to the items of the results list
+static const int tabRole = Qt::UserRole;
+static const int lineRole = Qt::UserRole + 1;
+
+GlobalSearchDialog::GlobalSearchDialog( QWidget* parent ) : QDialog( parent )
+{
+    setWindowTitle( tr( "Search in All Tabs" ) );
+
+    searchLineEdit_ = new QLineEdit( this );
+    ignoreCaseCheck_ = new QCheckBox( tr( "Ignore &case" ), this );
+    QPushButton* searchButton = new QPushButton( tr( "&Search" ), this );
+    searchButton->setDefault( true );
+    connect( searchButton, SIGNAL( clicked() ), this, SLOT( startSearch() ) );
+    connect( searchLineEdit_, SIGNAL( returnPressed() ),
+            this, SLOT( startSearch() ) );
+
+    QHBoxLayout* searchLayout = new QHBoxLayout();
+    searchLayout->addWidget( searchLineEdit_ );
+    searchLayout->addWidget( ignoreCaseCheck_ );
+    searchLayout->addWidget( searchButton );
+
+    countTree_ = new QTreeWidget( this );
+    countTree_->setRootIsDecorated( false );
+    countTree_->setHeaderLabels( QStringList() << tr( "File" ) << tr( "Matches" ) );
+
+    resultTree_ = new QTreeWidget( this );
+    resultTree_->setRootIsDecorated( false );
+    resultTree_->setUniformRowHeights( true );
+    resultTree_->setHeaderLabels( QStringList()
+            << tr( "File" ) << tr( "Line" ) << tr( "Text" ) );
+    connect( resultTree_, SIGNAL( itemActivated( QTreeWidgetItem*, int ) ),
+            this, SLOT( activateResult( QTreeWidgetItem* ) ) );
+
+    QSplitter* splitter = new QSplitter( Qt::Vertical, this );
+    splitter->addWidget( countTree_ );
+    splitter->addWidget( resultTree_ );
+    splitter->setStretchFactor( 1, 3 );
+
+    totalLabel_ = new QLabel( this );
+
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(
+            QDialogButtonBox::Close, this );
+    connect( buttonBox, SIGNAL( rejected() ), this, SLOT( reject() ) );
+
+    QVBoxLayout* layout = new QVBoxLayout( this );
+    layout->addLayout( searchLayout );
+    layout->addWidget( splitter );
+    layout->addWidget( totalLabel_ );
+    layout->addWidget( buttonBox );
+
+    resize( 720, 540 );
+}
+
+void GlobalSearchDialog::setSearchedTabs(
+        const std::vector<CrawlerWidget*>& tabs, const QStringList& names )
+{
+    for ( const SearchedTab& tab : tabs_ ) {
+        if ( tab.widget )
+            disconnect( tab.filteredData, 0, this, 0 );
+    }
+    tabs_.clear();
+    countTree_->clear();
+    resultTree_->clear();
+
+    for ( size_t i = 0; i < tabs.size(); i++ ) {
+        SearchedTab tab;
+        tab.widget = tabs[i];
+        tab.filteredData = tabs[i]->filteredData();
+        tab.name = names[i];
+        tab.nbMatches = 0;
+        tab.countItem = new QTreeWidgetItem( countTree_,
+                QStringList() << names[i] << tr( "searching..." ) );
+        tabs_.push_back( tab );
+
+        connect( tab.filteredData, SIGNAL( searchProgressed( qint64, int ) ),
+                this, SLOT( updateSearchedTab( qint64, int ) ) );
+    }
+
+    updateTotal();
+}
+
+void GlobalSearchDialog::startSearch()
+{
+    if ( ! searchLineEdit_->text().isEmpty() )
+        emit searchRequested( searchLineEdit_->text(),
+                ignoreCaseCheck_->isChecked() );
+}
+
+void GlobalSearchDialog::updateSearchedTab( qint64 nbMatches, int progress )
+{
+    for ( size_t i = 0; i < tabs_.size(); i++ ) {
+        SearchedTab& tab = tabs_[i];
+        if ( tab.filteredData != sender() || ! tab.widget )
+            continue;
+
+        tab.nbMatches = nbMatches;
+        tab.countItem->setText( 1, progress < 100 ?
+                tr( "%1 (%2 %)" ).arg( nbMatches ).arg( progress ) :
+                QString::number( nbMatches ) );
+        if ( progress >= 100 )
+            updateResults( i );
+    }
+
+    updateTotal();
+}
+
+void GlobalSearchDialog::activateResult( QTreeWidgetItem* item )
+{
+    const size_t index = item->data( 0, tabRole ).toUInt();
+
+    if ( index < tabs_.size() && tabs_[index].widget )
+        emit lineActivated( tabs_[index].widget,
+                item->data( 0, lineRole ).toLongLong() );
+}
+
+void GlobalSearchDialog::updateResults( int index )
+{
+    SearchedTab& tab = tabs_[index];
+
+    for ( QTreeWidgetItem* item : tab.results )
+        delete item;
+    tab.results.clear();
+
+    const LogData* log_data = tab.widget->logData();
+    const LogFilteredData* filtered_data = tab.widget->filteredData();
+    const qint64 nb_results = qMin<qint64>( filtered_data->getNbMatches(),
+            maxResultsPerTab );
+
+    QList<QTreeWidgetItem*> items;
+    for ( qint64 i = 0; i < nb_results; i++ ) {
+        const qint64 line = filtered_data->getMatchingLineNumber( i );
+        QTreeWidgetItem* item = new QTreeWidgetItem( QStringList()
+                << tab.name << QString::number( line + 1 )
+                << log_data->getExpandedLineString( line ) );
+        item->setData( 0, tabRole, index );
+        item->setData( 0, lineRole, line );
+        items.append( item );
+        tab.results.push_back( item );
+    }
+    resultTree_->addTopLevelItems( items );
+}
+
+void GlobalSearchDialog::updateTotal()
+{
+    qint64 nb_matches = 0;
+    for ( const SearchedTab& tab : tabs_ )
+        nb_matches += tab.nbMatches;
+
+    totalLabel_->setText( tr( "%1 matches in %2 files" )
+            .arg( nb_matches ).arg( tabs_.size() ) );
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GLOBALSEARCHDIALOG_H
+#define GLOBALSEARCHDIALOG_H
+
+#include <vector>
+
+#include <QDialog>
+#include <QPointer>
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QTreeWidget;
+class QTreeWidgetItem;
+class CrawlerWidget;
+
+// Panel searching all the open tabs at once: each tab runs the search
+// as if typed in its own search line (so its searches share the
+// TaskScheduler with the other files and use the file's own cache),
+// the panel showing the number of matches of each file and the
+// matching lines of all of them.
+class GlobalSearchDialog : public QDialog
+{
+  Q_OBJECT
+
+  public:
+    GlobalSearchDialog( QWidget* parent = 0 );
+
+    // Follow the searches started in the passed tabs, named as the
+    // names passed, forgetting the previous ones
+    void setSearchedTabs( const std::vector<CrawlerWidget*>& tabs,
+            const QStringList& names );
+
+  signals:
+    // Sent when the user starts a search, to be run in all the tabs
+    void searchRequested( const QString& text, bool ignoreCase );
+    // Sent when the user activates a matching line (starting at 0)
+    void lineActivated( CrawlerWidget* tab, qint64 line );
+
+  private slots:
+    void startSearch();
+    // The search of a tab has progressed (the tab being the sender)
+    void updateSearchedTab( qint64 nbMatches, int progress );
+    void activateResult( QTreeWidgetItem* item );
+
+  private:
+    struct SearchedTab {
+        QPointer<CrawlerWidget> widget;
+        const QObject* filteredData;
+        QString name;
+        qint64 nbMatches;
+        QTreeWidgetItem* countItem;
+        // The lines of the tab in the results list
+        std::vector<QTreeWidgetItem*> results;
+    };
+
+    // Replace the matching lines of the tab in the results list
+    void updateResults( int index );
+    void updateTotal();
+
+    QLineEdit* searchLineEdit_;
+    QCheckBox* ignoreCaseCheck_;
+    QLabel* totalLabel_;
+    QTreeWidget* countTree_;
+    QTreeWidget* resultTree_;
+
+    std::vector<SearchedTab> tabs_;
+};
+
+#endif
@@ -85,6 +85,8 @@ void INotifyWatchTowerDriver::removeDir( const DirId& dir_id )
 }
 
 static constexpr size_t INOTIFY_BUFFER_SIZE = 4096;
+// Maximum number of buffers read in one go when events keep coming
+static constexpr int INOTIFY_MAX_READS = 16;
 
 std::vector<INotifyWatchTowerDriver::INotifyObservedFile*>
 INotifyWatchTowerDriver::waitAndProcessEvents(
@@ -115,22 +117,31 @@ INotifyWatchTowerDriver::waitAndProcessEvents(
             char buffer[ INOTIFY_BUFFER_SIZE ]
                 __attribute__ ((aligned(__alignof__(struct inotify_event))));
 
-            ssize_t nb = read( inotify_fd_, buffer, sizeof( buffer ) );
-            if ( nb > 0 )
-            {
-                ssize_t offset = 0;
-                while ( offset < nb ) {
-                    const inotify_event* event =
-                        reinterpret_cast<const inotify_event*>( buffer + offset );
-
-                    offset += processINotifyEvent( event, list,
-                            &files_to_notify, files_needing_readding );
+            // Drain all the events already queued (within reason) so they
+            // are coalesced by the caller rather than notified one by one.
+            int nb_reads = 0;
+            do {
+                ssize_t nb = read( inotify_fd_, buffer, sizeof( buffer ) );
+                if ( nb > 0 )
+                {
+                    ssize_t offset = 0;
+                    while ( offset < nb ) {
+                        const inotify_event* event =
+                            reinterpret_cast<const inotify_event*>( buffer + offset );
+
+                        offset += processINotifyEvent( event, list,
+                                &files_to_notify, files_needing_readding );
+                    }
+                }
+                else
+                {
+                    LOG(logWARNING) << "Error reading from inotify " << errno;
+                    break;
                 }
-            }
-            else
-            {
-                LOG(logWARNING) << "Error reading from inotify " << errno;
-            }
+
+                fds[0].revents = 0;
+            } while ( ++nb_reads < INOTIFY_MAX_READS
+                    && poll( fds, 1, 0 ) > 0 && ( fds[0].revents & POLLIN ) );
         }
 
         if ( fds[1].revents & POLLIN )
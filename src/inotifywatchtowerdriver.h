@@ -19,6 +19,10 @@ class INotifyWatchTowerDriver {
         FileId() { wd_ = -1; }
         bool operator==( const FileId& other ) const
         { return wd_ == other.wd_; }
+        bool valid() const
+        { return (wd_ != -1); }
+        size_t hash() const
+        { return wd_; }
       private:
         FileId( int wd ) { wd_ = wd; }
         int wd_;
@@ -32,6 +36,8 @@ class INotifyWatchTowerDriver {
         { return wd_ == other.wd_; }
         bool valid() const
         { return (wd_ != -1); }
+        size_t hash() const
+        { return wd_; }
       private:
         DirId( int wd ) { wd_ = wd; }
         int wd_;
@@ -43,6 +49,10 @@ class INotifyWatchTowerDriver {
         SymlinkId() { wd_ = -1; }
         bool operator==( const SymlinkId& other ) const
         { return wd_ == other.wd_; }
+        bool valid() const
+        { return (wd_ != -1); }
+        size_t hash() const
+        { return wd_; }
       private:
         SymlinkId( int wd ) { wd_ = wd; }
         int wd_;
@@ -74,8 +84,9 @@ class INotifyWatchTowerDriver {
     void removeSymlink( const SymlinkId& symlink_id );
     void removeDir( const DirId& dir_id );
 
-    // Wait for an event for the OS, treat it and
-    // return a list of files to notify about.
+    // Wait for an event for the OS, treat it (and the ones queued
+    // behind it) and return a list of files to notify about, a file
+    // being listed once per event.
     // This must be called with the lock on the list held,
     // the function will unlock it temporary whilst blocking.
     // Also returns a list of file that need readding
@@ -0,0 +1,215 @@
+#include "kqueuewatchtowerdriver.h"
+
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "log.h"
+
+#include "watchtowerlist.h"
+
+namespace {
+// Only watching, the file is not read (and can be unmounted on macOS)
+#ifdef O_EVTONLY
+    const int WATCH_OPEN_FLAGS = O_EVTONLY;
+#else
+    const int WATCH_OPEN_FLAGS = O_RDONLY;
+#endif
+
+    const unsigned int FILE_EVENTS = NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE
+        | NOTE_RENAME | NOTE_ATTRIB | NOTE_REVOKE;
+    // Entries added, removed or renamed
+    const unsigned int DIR_EVENTS = NOTE_WRITE | NOTE_DELETE | NOTE_RENAME;
+};
+
+KQueueWatchTowerDriver::KQueueWatchTowerDriver() : kqueue_fd_( kqueue() )
+{
+    int pipefd[2];
+
+    pipe( pipefd );
+    fcntl( pipefd[0], F_SETFL, O_NONBLOCK );
+    fcntl( pipefd[1], F_SETFL, O_NONBLOCK );
+
+    breaking_pipe_read_fd_  = pipefd[0];
+    breaking_pipe_write_fd_ = pipefd[1];
+
+    struct kevent change;
+    EV_SET( &change, breaking_pipe_read_fd_, EVFILT_READ, EV_ADD, 0, 0, nullptr );
+    kevent( kqueue_fd_, &change, 1, nullptr, 0, nullptr );
+}
+
+KQueueWatchTowerDriver::~KQueueWatchTowerDriver()
+{
+    close( breaking_pipe_read_fd_ );
+    close( breaking_pipe_write_fd_ );
+    close( kqueue_fd_ );
+}
+
+KQueueWatchTowerDriver::FileId KQueueWatchTowerDriver::addFile(
+        const std::string& file_name )
+{
+    int fd = watch( file_name, WATCH_OPEN_FLAGS, FILE_EVENTS );
+
+    LOG(logDEBUG) << "KQueueWatchTower::addFile new fd " << fd;
+
+    return { fd };
+}
+
+KQueueWatchTowerDriver::SymlinkId KQueueWatchTowerDriver::addSymlink(
+        const std::string& file_name )
+{
+#ifdef O_SYMLINK
+    int symlink_fd = watch( file_name, WATCH_OPEN_FLAGS | O_SYMLINK, FILE_EVENTS );
+    LOG(logDEBUG) << "KQueueWatchTower::addFile new symlink fd " << symlink_fd;
+
+    return { symlink_fd };
+#else
+    // The link itself cannot be opened, its replacement is seen
+    // through the directory.
+    (void) file_name;
+    return { -1 };
+#endif
+}
+
+KQueueWatchTowerDriver::DirId KQueueWatchTowerDriver::addDir(
+        const std::string& file_name )
+{
+    int dir_fd = watch( file_name, WATCH_OPEN_FLAGS | O_DIRECTORY, DIR_EVENTS );
+    LOG(logDEBUG) << "KQueueWatchTower::addFile dir " << file_name
+        << " watched fd " << dir_fd;
+
+    return { dir_fd };
+}
+
+void KQueueWatchTowerDriver::removeFile(
+        const KQueueWatchTowerDriver::FileId& file_id )
+{
+    unwatch( file_id.fd_ );
+}
+
+void KQueueWatchTowerDriver::removeSymlink( const SymlinkId& symlink_id )
+{
+    unwatch( symlink_id.fd_ );
+}
+
+void KQueueWatchTowerDriver::removeDir( const DirId& dir_id )
+{
+    LOG(logDEBUG) << "KQueueWatchTower::removeDir removing fd " << dir_id.fd_;
+
+    unwatch( dir_id.fd_ );
+}
+
+static constexpr int KQUEUE_NB_EVENTS = 64;
+
+std::vector<KQueueWatchTowerDriver::KQueueObservedFile*>
+KQueueWatchTowerDriver::waitAndProcessEvents(
+        KQueueObservedFileList* list,
+        std::unique_lock<std::mutex>* list_lock,
+        std::vector<KQueueObservedFile*>* files_needing_readding )
+{
+    std::vector<KQueueObservedFile*> files_to_notify;
+    struct kevent events[ KQUEUE_NB_EVENTS ];
+
+    list_lock->unlock();
+    int nb_events = kevent( kqueue_fd_, nullptr, 0,
+            events, KQUEUE_NB_EVENTS, nullptr );
+    list_lock->lock();
+
+    if ( nb_events < 0 )
+        LOG(logWARNING) << "Error waiting for kqueue events " << errno;
+
+    for ( int i = 0; i < nb_events; i++ ) {
+        const int fd = static_cast<int>( events[i].ident );
+
+        if ( fd == breaking_pipe_read_fd_ ) {
+            uint8_t byte;
+            read( breaking_pipe_read_fd_, &byte, sizeof byte );
+            continue;
+        }
+
+        LOG(logDEBUG) << "Event received: " << std::hex << events[i].fflags
+            << " for fd " << std::dec << fd;
+
+        // The file being closed (removed) meanwhile is not a problem
+        // as its events are dropped with it.
+        if ( auto file = list->searchByFileOrSymlinkWd( { fd }, { fd } ) ) {
+            LOG(logDEBUG) << "Adding file: " << std::hex << file;
+            files_to_notify.push_back( file );
+        }
+        else {
+            processDirectoryEvent( fd, list,
+                    &files_to_notify, files_needing_readding );
+        }
+    }
+
+    return files_to_notify;
+}
+
+void KQueueWatchTowerDriver::interruptWait()
+{
+    char byte = 'X';
+
+    (void) write( breaking_pipe_write_fd_, (void*) &byte, sizeof byte );
+}
+
+//
+// Private functions
+//
+
+int KQueueWatchTowerDriver::watch( const std::string& file_name,
+        int open_flags, unsigned int vnode_events )
+{
+    int fd = open( file_name.c_str(), open_flags );
+    if ( fd == -1 )
+        return -1;
+
+    struct kevent change;
+    EV_SET( &change, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+            vnode_events, 0, nullptr );
+    if ( kevent( kqueue_fd_, &change, 1, nullptr, 0, nullptr ) == -1 ) {
+        LOG(logWARNING) << "Cannot watch " << file_name << " " << errno;
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+}
+
+void KQueueWatchTowerDriver::unwatch( int fd )
+{
+    // Closing the file removes its events from the queue
+    if ( fd >= 0 )
+        close( fd );
+}
+
+void KQueueWatchTowerDriver::processDirectoryEvent( int dir_fd,
+        KQueueObservedFileList* list,
+        std::vector<KQueueObservedFile*>* files_to_notify,
+        std::vector<KQueueObservedFile*>* files_needing_readding )
+{
+    for ( auto file: list->filesInDirectory( { dir_fd } ) ) {
+        // Is the file watched (still) the one with this name?
+        struct stat named;
+        const bool exists = ( stat( file->file_name_.c_str(), &named ) == 0 );
+
+        bool replaced;
+        if ( file->file_id_.valid() ) {
+            struct stat watched;
+            replaced = ( fstat( file->file_id_.fd_, &watched ) != 0 )
+                || ( exists && ( watched.st_ino != named.st_ino
+                            || watched.st_dev != named.st_dev ) );
+        }
+        else {
+            replaced = exists;
+        }
+
+        if ( replaced ) {
+            LOG(logDEBUG) << "Dir change for watched file " << file->file_name_;
+            files_needing_readding->push_back( file );
+            files_to_notify->push_back( file );
+        }
+    }
+}
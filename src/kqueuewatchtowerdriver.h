@@ -0,0 +1,126 @@
+#ifndef KQUEUEWATCHTOWERDRIVER_H
+#define KQUEUEWATCHTOWERDRIVER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+template <typename Driver>
+class ObservedFile;
+template <typename Driver>
+class ObservedFileList;
+
+// WatchTower driver for the BSDs and macOS, using kqueue.
+// Unlike inotify, kqueue watches open files (vnodes): each file and
+// directory watched is kept open, and a change in a directory does not
+// tell which entry changed, so the files of the directory are checked.
+class KQueueWatchTowerDriver {
+  public:
+    class FileId {
+      public:
+        friend class KQueueWatchTowerDriver;
+
+        FileId() { fd_ = -1; }
+        bool operator==( const FileId& other ) const
+        { return fd_ == other.fd_; }
+        bool valid() const
+        { return (fd_ != -1); }
+        size_t hash() const
+        { return fd_; }
+      private:
+        FileId( int fd ) { fd_ = fd; }
+        int fd_;
+    };
+    class DirId {
+      public:
+        friend class KQueueWatchTowerDriver;
+
+        DirId() { fd_ = -1; }
+        bool operator==( const DirId& other ) const
+        { return fd_ == other.fd_; }
+        bool valid() const
+        { return (fd_ != -1); }
+        size_t hash() const
+        { return fd_; }
+      private:
+        DirId( int fd ) { fd_ = fd; }
+        int fd_;
+    };
+    class SymlinkId {
+      public:
+        friend class KQueueWatchTowerDriver;
+
+        SymlinkId() { fd_ = -1; }
+        bool operator==( const SymlinkId& other ) const
+        { return fd_ == other.fd_; }
+        bool valid() const
+        { return (fd_ != -1); }
+        size_t hash() const
+        { return fd_; }
+      private:
+        SymlinkId( int fd ) { fd_ = fd; }
+        int fd_;
+    };
+
+#ifdef HAS_TEMPLATE_ALIASES
+    using KQueueObservedFile = ObservedFile<KQueueWatchTowerDriver>;
+    using KQueueObservedFileList = ObservedFileList<KQueueWatchTowerDriver>;
+#else
+    typedef ObservedFile<KQueueWatchTowerDriver> KQueueObservedFile;
+    typedef ObservedFileList<KQueueWatchTowerDriver> KQueueObservedFileList;
+#endif
+
+    // Default constructor
+    KQueueWatchTowerDriver();
+    ~KQueueWatchTowerDriver();
+
+    // No copy/assign/move please
+    KQueueWatchTowerDriver( const KQueueWatchTowerDriver& ) = delete;
+    KQueueWatchTowerDriver& operator=( const KQueueWatchTowerDriver& ) = delete;
+    KQueueWatchTowerDriver( const KQueueWatchTowerDriver&& ) = delete;
+    KQueueWatchTowerDriver& operator=( const KQueueWatchTowerDriver&& ) = delete;
+
+    FileId addFile( const std::string& file_name );
+    SymlinkId addSymlink( const std::string& file_name );
+    DirId addDir( const std::string& file_name );
+
+    void removeFile( const FileId& file_id );
+    void removeSymlink( const SymlinkId& symlink_id );
+    void removeDir( const DirId& dir_id );
+
+    // Wait for an event for the OS, treat it (and the ones queued
+    // behind it) and return a list of files to notify about.
+    // This must be called with the lock on the list held,
+    // the function will unlock it temporary whilst blocking.
+    // Also returns a list of file that need readding
+    // (because of renames/symlink...)
+    std::vector<KQueueObservedFile*> waitAndProcessEvents(
+            KQueueObservedFileList* list,
+            std::unique_lock<std::mutex>* list_mutex,
+            std::vector<KQueueObservedFile*>* files_needing_readding );
+
+    // Interrupt waitAndProcessEvents if it is blocking.
+    void interruptWait();
+
+  private:
+    // Only written at initialisation so no protection needed.
+    const int kqueue_fd_;
+
+    // Breaking pipe
+    int breaking_pipe_read_fd_;
+    int breaking_pipe_write_fd_;
+
+    // Private member functions
+    // Open the passed file and add it to the kqueue, returns the fd
+    int watch( const std::string& file_name, int open_flags,
+            unsigned int vnode_events );
+    void unwatch( int fd );
+    // Check whether the watched files of the passed directory have been
+    // created or replaced.
+    void processDirectoryEvent( int dir_fd, KQueueObservedFileList* list,
+            std::vector<KQueueObservedFile*>* files_to_notify,
+            std::vector<KQueueObservedFile*>* files_needing_readding );
+};
+
+#endif
@@ -152,8 +152,18 @@ typedef Log<Output2FILE> FILELog;
 #define FILELOG_MAX_LEVEL logDEBUG
 #endif
 
+// Whether the statements of a level are compiled in: those above
+// FILELOG_MAX_LEVEL are removed at compile time, the level having to
+// be a constant expression, so they cost nothing in the hot loops
+// (unlike the check of the reporting level, done at run time).
+template <TLogLevel level>
+struct LogLevelCompiled
+{
+    static constexpr bool value = ( level <= FILELOG_MAX_LEVEL );
+};
+
 #define FILE_LOG(level) \
-    if (level > FILELOG_MAX_LEVEL) ;\
+    if (!LogLevelCompiled<level>::value) ;\
     else if (level > FILELog::ReportingLevel() || !Output2FILE::Stream()) ; \
     else FILELog().Get(level, __FILE__, __LINE__)
 
@@ -41,7 +41,7 @@ class LogMainView : public AbstractLogView
 
   protected:
     // Implements the virtual function
-    virtual LineType lineType( int lineNumber ) const;
+    virtual LineType lineType( qint64 lineNumber ) const;
 
   private:
     LogFilteredData* filteredData_;
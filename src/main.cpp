@@ -18,8 +18,10 @@
  */
 
 #include <QApplication>
+#include <QTimer>
 
 #include <memory>
+#include <vector>
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
@@ -41,6 +43,10 @@ using namespace std;
 #include "mainwindow.h"
 #include "savedsearches.h"
 #include "loadingstatus.h"
+#include "tracerecorder.h"
+#include "batchrunner.h"
+#include "prewarmer.h"
+#include "data/remotefile.h"
 
 #include "externalcom.h"
 #ifdef GLOGG_SUPPORTS_DBUS
@@ -53,17 +59,47 @@ using namespace std;
 #include "log.h"
 
 static void print_version();
+static void describe_options( po::options_description& desc,
+        po::options_description& all_options );
+static void parse_options( int argc, char *argv[],
+        const po::options_description& all_options,
+        po::variables_map& vm, bool allow_unregistered );
+static bool is_batch_run( const po::variables_map& vm );
 
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
+    po::options_description desc("Usage: glogg [options] [file]");
+    po::options_description all_options("all options");
+    describe_options( desc, all_options );
+
+    // A batch run has no window, so does not need a display.
+    // This is known before the options are really parsed, Qt's (unknown
+    // here) having to be removed from them by QApplication otherwise.
+    bool batch_run = false;
+    try {
+        po::variables_map vm;
+        parse_options( argc, argv, all_options, vm, true );
+        batch_run = is_batch_run( vm );
+    }
+    catch(...) {
+        // (reported when parsed again)
+    }
+
+    unique_ptr<QCoreApplication> app( batch_run ?
+            new QCoreApplication( argc, argv ) :
+            new QApplication( argc, argv ) );
 
     string filename = "";
+    string trace_filename = "";
+    BatchRunner::Options batch = { {}, "", false, false, false };
+    // Number of recent files to prewarm, -1 if not asked to
+    int prewarm_files = -1;
 
     // Configuration
     bool new_session = false;
     bool load_session = false;
     bool multi_instance = false;
+    bool perf_counters = false;
 #ifdef _WIN32
     bool log_to_file = false;
 #endif
@@ -71,45 +107,8 @@ int main(int argc, char *argv[])
     TLogLevel logLevel = logWARNING;
 
     try {
-        po::options_description desc("Usage: glogg [options] [file]");
-        desc.add_options()
-            ("help,h", "print out program usage (this message)")
-            ("version,v", "print glogg's version information")
-            ("multi,m", "allow multiple instance of glogg to run simultaneously (use together with -s)")
-            ("load-session,s", "load the previous session (default when no file is passed)")
-            ("new-session,n", "do not load the previous session (default when a file is passed)")
-#ifdef _WIN32
-            ("log,l", "save the log to a file (Windows only)")
-#endif
-            ("debug,d", "output more debug (include multiple times for more verbosity e.g. -dddd)")
-            ;
-        po::options_description desc_hidden("Hidden options");
-        // For -dd, -ddd...
-        for ( string s = "dd"; s.length() <= 10; s.append("d") )
-            desc_hidden.add_options()(s.c_str(), "debug");
-
-        desc_hidden.add_options()
-            ("input-file", po::value<string>(), "input file")
-            ;
-
-        po::options_description all_options("all options");
-        all_options.add(desc).add(desc_hidden);
-
-        po::positional_options_description positional;
-        positional.add("input-file", 1);
-
-        int command_line_style = (((po::command_line_style::unix_style ^
-                po::command_line_style::allow_guessing) |
-                po::command_line_style::allow_long_disguise) ^
-                po::command_line_style::allow_sticky);
-
         po::variables_map vm;
-        po::store(po::command_line_parser(argc, argv).
-                options(all_options).
-                positional(positional).
-                style(command_line_style).run(),
-                vm);
-        po::notify(vm);
+        parse_options( argc, argv, all_options, vm, false );
 
         if ( vm.count("help") ) {
             desc.print(cout);
@@ -133,6 +132,12 @@ int main(int argc, char *argv[])
         if ( vm.count( "load-session" ) )
             load_session = true;
 
+        if ( vm.count( "perf-counters" ) )
+            perf_counters = true;
+
+        if ( vm.count( "trace" ) )
+            trace_filename = vm["trace"].as<string>();
+
 #ifdef _WIN32
         if ( vm.count( "log" ) )
             log_to_file = true;
@@ -142,8 +147,20 @@ int main(int argc, char *argv[])
             if ( vm.count( s ) )
                 logLevel = (TLogLevel) (logWARNING + s.length());
 
-        if ( vm.count("input-file") )
-            filename = vm["input-file"].as<string>();
+        if ( vm.count("input-file") ) {
+            // The first one is displayed in the window
+            batch.fileNames = vm["input-file"].as<vector<string>>();
+            filename = batch.fileNames.front();
+        }
+
+        if ( vm.count( "search" ) )
+            batch.pattern = vm["search"].as<string>();
+        batch.ignoreCase = vm.count( "ignore-case" );
+        batch.countOnly = vm.count( "count" );
+        batch.writeIndex = vm.count( "index" );
+
+        if ( vm.count( "prewarm" ) )
+            prewarm_files = qMax( vm["prewarm"].as<int>(), 0 );
     }
     catch(exception& e) {
         cerr << "Option processing error: " << e.what() << endl;
@@ -165,12 +182,57 @@ int main(int argc, char *argv[])
 
     FILELog::setReportingLevel( logLevel );
 
-    if ( ! filename.empty() ) {
+    if ( prewarm_files >= 0 ) {
+        // The recent files of the GUI, indexed as it would do it
+        GetPersistentInfo().migrateAndInit();
+        GetPersistentInfo().registerPersistable(
+                std::make_shared<RecentFiles>(), QString( "recentFiles" ) );
+        GetPersistentInfo().retrieve( QString( "recentFiles" ) );
+
+        const QStringList files = Prewarmer::filesToPrewarm(
+                Persistent<RecentFiles>( "recentFiles" )->recentFiles(),
+                prewarm_files );
+        if ( files.isEmpty() )
+            return 0;
+
+        BatchRunner::Options prewarm = { {}, "", false, false, false };
+        for ( const QString& file_name : files )
+            prewarm.fileNames.push_back( file_name.toStdString() );
+
+        Prewarmer::lowerProcessPriority();
+        qRegisterMetaType<LoadingStatus>("LoadingStatus");
+        return BatchRunner( prewarm ).run();
+    }
+
+    if ( batch_run ) {
+        if ( batch.fileNames.empty() ) {
+            cerr << "No file to search or index." << endl;
+            return 2;
+        }
+
+        qRegisterMetaType<LoadingStatus>("LoadingStatus");
+        return BatchRunner( batch ).run();
+    }
+
+    // "-" being the standard input
+    const bool read_stdin = ( filename == "-" );
+
+    if ( ! filename.empty() && ! read_stdin
+            && ! RemoteFile::isRemote( QString::fromStdString( filename ) ) ) {
         // Convert to absolute path
         QFileInfo file( QString::fromStdString( filename ) );
         filename = file.absoluteFilePath().toStdString();
     }
 
+    // All the files passed, opened at once
+    QStringList file_names;
+    for ( const string& name : batch.fileNames ) {
+        QString file_name = QString::fromStdString( name );
+        if ( name != "-" && ! RemoteFile::isRemote( file_name ) )
+            file_name = QFileInfo( file_name ).absoluteFilePath();
+        file_names << file_name;
+    }
+
     // External communicator
     shared_ptr<ExternalCommunicator> externalCommunicator = nullptr;
     shared_ptr<ExternalInstance> externalInstance = nullptr;
@@ -191,12 +253,28 @@ int main(int argc, char *argv[])
     }
 
     LOG(logDEBUG) << "externalInstance = " << externalInstance;
-    if ( ( ! multi_instance ) && externalInstance ) {
+    if ( perf_counters ) {
+        const QString counters = externalInstance ?
+            externalInstance->getPerformanceCounters() : QString();
+        if ( counters.isEmpty() ) {
+            cerr << "Cannot get the performance counters of a running glogg." << endl;
+            return 1;
+        }
+
+        cout << counters.toStdString();
+        return 0;
+    }
+
+    // Only this process can read its standard input
+    if ( ( ! multi_instance ) && ( ! read_stdin ) && externalInstance ) {
         uint32_t version = externalInstance->getVersion();
         LOG(logINFO) << "Found another glogg (version = "
             << std::setbase(16) << version << ")";
 
-        externalInstance->loadFile( QString::fromStdString( filename ) );
+        if ( file_names.size() > 1 )
+            externalInstance->loadFiles( file_names, QVariantMap() );
+        else
+            externalInstance->loadFile( QString::fromStdString( filename ) );
 
         return 0;
     }
@@ -237,6 +315,11 @@ int main(int argc, char *argv[])
     // FIXME: should be replaced by a two staged init of MainWindow
     GetPersistentInfo().retrieve( QString( "settings" ) );
 
+    if ( ! trace_filename.empty() ) {
+        TraceRecorder::start( QString::fromStdString( trace_filename ) );
+        TraceRecorder::nameThread( "GUI" );
+    }
+
     std::unique_ptr<Session> session( new Session() );
     MainWindow mw( std::move( session ), externalCommunicator );
 
@@ -245,9 +328,84 @@ int main(int argc, char *argv[])
     // Load the existing session if needed
     if ( load_session || ( filename.empty() && !new_session ) )
         mw.reloadSession();
-    mw.loadInitialFile( QString::fromStdString( filename ) );
-    mw.startBackgroundTasks();
-    return app.exec();
+    if ( file_names.size() > 1 )
+        mw.loadFiles( file_names, QVariantMap() );
+    else
+        mw.loadInitialFile( QString::fromStdString( filename ) );
+    // Once the event loop has shown the window
+    QTimer::singleShot( 0, &mw, SLOT( startBackgroundTasks() ) );
+    const int result = app->exec();
+
+    TraceRecorder::stop();
+
+    return result;
+}
+
+// The options of the command line, those shown by --help in desc
+static void describe_options( po::options_description& desc,
+        po::options_description& all_options )
+{
+    desc.add_options()
+        ("help,h", "print out program usage (this message)")
+        ("version,v", "print glogg's version information")
+        ("multi,m", "allow multiple instance of glogg to run simultaneously (use together with -s)")
+        ("load-session,s", "load the previous session (default when no file is passed)")
+        ("new-session,n", "do not load the previous session (default when a file is passed)")
+        ("perf-counters", "print the performance counters of the running glogg (as JSON)")
+        ("trace", po::value<string>(), "record what the threads do to a file (Chrome trace format, for chrome://tracing or Perfetto)")
+        ("search,e", po::value<string>(), "print the lines of the files matching the regexp, without a window")
+        ("ignore-case,i", "ignore case distinctions in the search")
+        ("count,c", "print the number of matching lines rather than the lines")
+        ("index", "index the files without a window, keeping their indexes in the index cache")
+        ("prewarm", po::value<int>(), "index the N most recent files without a window, at a low priority, so they open at once (e.g. from cron)")
+#ifdef _WIN32
+        ("log,l", "save the log to a file (Windows only)")
+#endif
+        ("debug,d", "output more debug (include multiple times for more verbosity e.g. -dddd)")
+        ;
+    po::options_description desc_hidden("Hidden options");
+    // For -dd, -ddd...
+    for ( string s = "dd"; s.length() <= 10; s.append("d") )
+        desc_hidden.add_options()(s.c_str(), "debug");
+
+    desc_hidden.add_options()
+        ("input-file", po::value<vector<string>>(), "input file")
+        ;
+
+    all_options.add(desc).add(desc_hidden);
+}
+
+// Parse the command line to vm, the options not in all_options (Qt's)
+// being ignored if allow_unregistered is set.
+static void parse_options( int argc, char *argv[],
+        const po::options_description& all_options,
+        po::variables_map& vm, bool allow_unregistered )
+{
+    po::positional_options_description positional;
+    positional.add("input-file", -1);
+
+    int command_line_style = (((po::command_line_style::unix_style ^
+            po::command_line_style::allow_guessing) |
+            po::command_line_style::allow_long_disguise) ^
+            po::command_line_style::allow_sticky);
+
+    po::command_line_parser parser( argc, argv );
+    parser.options(all_options).
+        positional(positional).
+        style(command_line_style);
+    if ( allow_unregistered )
+        parser.allow_unregistered();
+
+    po::store(parser.run(), vm);
+    po::notify(vm);
+}
+
+// Returns whether the options ask for a batch run (--search, --index
+// or --prewarm), which has no window.
+static bool is_batch_run( const po::variables_map& vm )
+{
+    return vm.count( "search" ) || vm.count( "index" )
+        || vm.count( "prewarm" );
 }
 
 static void print_version()
@@ -22,6 +22,7 @@
 // load/save the settings on opening/closing of the app
 
 #include <iostream>
+#include <set>
 #include <cassert>
 
 #include <QAction>
@@ -36,6 +37,9 @@
 #include <QDragEnterEvent>
 #include <QMimeData>
 #include <QUrl>
+#include <QApplication>
+#include <QPainter>
+#include <QInputDialog>
 
 #include "log.h"
 
@@ -46,6 +50,8 @@
 #include "crawlerwidget.h"
 #include "filtersdialog.h"
 #include "optionsdialog.h"
+#include "perfcountersdialog.h"
+#include "globalsearchdialog.h"
 #include "persistentinfo.h"
 #include "menuactiontooltipbehavior.h"
 #include "tabbedcrawlerwidget.h"
@@ -59,6 +65,8 @@ MainWindow::MainWindow( std::unique_ptr<Session> session,
     session_( std::move( session )  ),
     externalCommunicator_( external_communicator ),
     recentFiles_( Persistent<RecentFiles>( "recentFiles" ) ),
+    globalSearchDialog_( nullptr ),
+    comparison_(),
     mainIcon_(),
     signalMux_(),
     quickFindMux_( session_->getQuickFindPattern() ),
@@ -104,8 +112,8 @@ MainWindow::MainWindow( std::unique_ptr<Session> session,
     // Actions from the CrawlerWidget
     signalMux_.connect( SIGNAL( followDisabled() ),
             this, SLOT( disableFollow() ) );
-    signalMux_.connect( SIGNAL( updateLineNumber( int ) ),
-            this, SLOT( lineNumberHandler( int ) ) );
+    signalMux_.connect( SIGNAL( updateLineNumber( qint64 ) ),
+            this, SLOT( lineNumberHandler( qint64 ) ) );
 
     // Register for progress status bar
     signalMux_.connect( SIGNAL( loadingProgressed( int ) ),
@@ -156,6 +164,12 @@ MainWindow::MainWindow( std::unique_ptr<Session> session,
     // Actions from external instances
     connect( externalCommunicator_.get(), SIGNAL( loadFile( const QString& ) ),
              this, SLOT( loadFileNonInteractive( const QString& ) ) );
+    connect( externalCommunicator_.get(),
+             SIGNAL( loadFiles( const QStringList&, const QVariantMap& ) ),
+             this, SLOT( loadFilesNonInteractive( const QStringList&, const QVariantMap& ) ) );
+    connect( externalCommunicator_.get(),
+             SIGNAL( runCommand( qint32, const QString&, const QString&, const QVariantMap& ) ),
+             this, SLOT( runCommand( qint32, const QString&, const QString&, const QVariantMap& ) ) );
 
 #ifdef GLOGG_SUPPORTS_VERSION_CHECKING
     // Version checker notification
@@ -195,7 +209,19 @@ void MainWindow::reloadSession()
 
         assert( crawler_widget );
 
-        mainTabWidget_.addTab( crawler_widget, strippedName( file_name ) );
+        // Loaded once displayed, what was known of it is shown meanwhile
+        uint64_t fileSize;
+        uint32_t fileNbLine;
+        QDateTime lastModified;
+        session_->getFileInfo( crawler_widget,
+                &fileSize, &fileNbLine, &lastModified );
+
+        const int index = addCrawlerTab( crawler_widget, file_name );
+        crawler_widget->restoreSearchResults( file_name );
+        if ( fileSize > 0 )
+            mainTabWidget_.setTabToolTip( index, tr( "%1 (%2 - %3 lines)" )
+                    .arg( file_name ).arg( readableSize( fileSize ) )
+                    .arg( fileNbLine ) );
     }
 
     if ( current_file_index >= 0 )
@@ -211,10 +237,90 @@ void MainWindow::loadInitialFile( QString fileName )
         loadFile( fileName );
 }
 
+void MainWindow::loadFiles( const QStringList& fileNames,
+        const QVariantMap& options )
+{
+    LOG(logDEBUG) << "loadFiles ( " << fileNames.size() << " files )";
+
+    const QString search = options.value( "search" ).toString();
+    const bool ignore_case = options.value( "ignoreCase" ).toBool();
+
+    // The tabs are all created at once but, as the ones of a restored
+    // session, their files are only loaded when displayed or when
+    // loadPendingFiles() gets to them.
+    CrawlerWidget* first_widget = nullptr;
+    QStringList opened;
+    for ( const QString& file_name : fileNames ) {
+        if ( session_->getViewIfOpen( file_name.toStdString() ) )
+            continue;
+
+        if ( prewarmer_ )
+            prewarmer_->skip( file_name );
+
+        try {
+            CrawlerWidget* crawler_widget = dynamic_cast<CrawlerWidget*>(
+                    session_->open( file_name.toStdString(),
+                        []() { return new CrawlerWidget(); }, true ) );
+            assert( crawler_widget );
+
+            addCrawlerTab( crawler_widget, file_name );
+            if ( ! search.isEmpty() )
+                crawler_widget->search( search, ignore_case );
+
+            if ( first_widget )
+                pendingLoads_.append( crawler_widget );
+            else
+                first_widget = crawler_widget;
+            opened << file_name;
+        }
+        catch ( FileUnreadableErr ) {
+            LOG(logWARNING) << "Can't open file " << file_name.toStdString();
+        }
+    }
+
+    if ( opened.isEmpty() )
+        return;
+
+    // Update the recent files list
+    // (reload the list first in case another glogg changed it)
+    GetPersistentInfo().retrieve( "recentFiles" );
+    for ( const QString& file_name : opened )
+        recentFiles_->addRecent( file_name );
+    GetPersistentInfo().save( "recentFiles" );
+    updateRecentFileActions();
+
+    // Displaying it loads it
+    mainTabWidget_.setCurrentWidget( first_widget );
+
+    loadPendingFiles();
+}
+
 void MainWindow::startBackgroundTasks()
 {
     LOG(logDEBUG) << "startBackgroundTasks";
 
+    // Only shown in the File menu
+    GetPersistentInfo().retrieve( QString( "recentFiles" ) );
+    updateRecentFileActions();
+
+    // The indexes of the recent files not open are checked in the
+    // background, so these files open at once later
+    std::shared_ptr<Configuration> config =
+        Persistent<Configuration>( "settings" );
+    if ( config->prewarmFiles() > 0 ) {
+        QStringList files;
+        for ( const QString& file_name : Prewarmer::filesToPrewarm(
+                    recentFiles_->recentFiles(), config->prewarmFiles() ) ) {
+            if ( ! session_->getViewIfOpen( file_name.toStdString() ) )
+                files << file_name;
+        }
+
+        if ( ! files.isEmpty() ) {
+            prewarmer_.reset( new Prewarmer( files ) );
+            prewarmer_->start();
+        }
+    }
+
 #ifdef GLOGG_SUPPORTS_VERSION_CHECKING
     versionChecker_.startCheck();
 #endif
@@ -236,6 +342,11 @@ void MainWindow::createActions()
     openAction->setStatusTip(tr("Open a file"));
     connect(openAction, SIGNAL(triggered()), this, SLOT(open()));
 
+    duplicateTabAction = new QAction(tr("&Duplicate Tab"), this);
+    duplicateTabAction->setStatusTip(tr("Open the file in another tab, "
+                "for another search, without loading it again"));
+    connect(duplicateTabAction, SIGNAL(triggered()), this, SLOT(duplicateTab()));
+
     closeAction = new QAction(tr("&Close"), this);
     closeAction->setShortcut(tr("Ctrl+W"));
     closeAction->setStatusTip(tr("Close document"));
@@ -253,6 +364,11 @@ void MainWindow::createActions()
                 this, SLOT(openRecentFile()));
     }
 
+    exportResultsAction = new QAction(tr("&Export Search Results..."), this);
+    exportResultsAction->setStatusTip(tr("Write the lines matching the search to a file"));
+    connect( exportResultsAction, SIGNAL(triggered()),
+            this, SLOT(exportSearchResults()) );
+
     exitAction = new QAction(tr("E&xit"), this);
     exitAction->setShortcut(tr("Ctrl+Q"));
     exitAction->setStatusTip(tr("Exit the application"));
@@ -275,6 +391,18 @@ void MainWindow::createActions()
     connect( findAction, SIGNAL(triggered()),
             this, SLOT( find() ) );
 
+    searchAllTabsAction = new QAction(tr("Search in &All Tabs..."), this);
+    searchAllTabsAction->setShortcut(Qt::CTRL + Qt::SHIFT + Qt::Key_F);
+    searchAllTabsAction->setStatusTip(tr("Search the text in all the open files"));
+    connect( searchAllTabsAction, SIGNAL(triggered()),
+            this, SLOT( searchAllTabs() ) );
+
+    compareTabsAction = new QAction(tr("&Compare with Tab..."), this);
+    compareTabsAction->setStatusTip(tr("Show the lines of the file and of "
+                "another open file not in the other one"));
+    connect( compareTabsAction, SIGNAL(triggered()),
+            this, SLOT( compareTabs() ) );
+
     overviewVisibleAction = new QAction( tr("Matches &overview"), this );
     overviewVisibleAction->setCheckable( true );
     overviewVisibleAction->setChecked( config->isOverviewVisible() );
@@ -306,6 +434,13 @@ void MainWindow::createActions()
     reloadAction->setIcon( QIcon(":/images/reload16.png") );
     signalMux_.connect( reloadAction, SIGNAL(triggered()), SLOT(reload()) );
 
+    reloadAllAction = new QAction( tr("Reload A&ll"), this );
+    reloadAllAction->setShortcut( Qt::CTRL + Qt::SHIFT + Qt::Key_R );
+    reloadAllAction->setStatusTip( tr("Reload the lines changed in all "
+                "the open files") );
+    connect( reloadAllAction, SIGNAL(triggered()),
+            this, SLOT( reloadAll() ) );
+
     stopAction = new QAction( tr("&Stop"), this );
     stopAction->setIcon( QIcon(":/images/stop16.png") );
     stopAction->setEnabled( true );
@@ -319,6 +454,10 @@ void MainWindow::createActions()
     optionsAction->setStatusTip(tr("Show the Options box"));
     connect( optionsAction, SIGNAL(triggered()), this, SLOT(options()) );
 
+    perfCountersAction = new QAction(tr("&Performance Counters..."), this);
+    perfCountersAction->setStatusTip(tr("Show the performance counters"));
+    connect( perfCountersAction, SIGNAL(triggered()), this, SLOT(perfCounters()) );
+
     aboutAction = new QAction(tr("&About"), this);
     aboutAction->setStatusTip(tr("Show the About box"));
     connect( aboutAction, SIGNAL(triggered()), this, SLOT(about()) );
@@ -332,9 +471,12 @@ void MainWindow::createMenus()
 {
     fileMenu = menuBar()->addMenu( tr("&File") );
     fileMenu->addAction( openAction );
+    fileMenu->addAction( duplicateTabAction );
     fileMenu->addAction( closeAction );
     fileMenu->addAction( closeAllAction );
     fileMenu->addSeparator();
+    fileMenu->addAction( exportResultsAction );
+    fileMenu->addSeparator();
     for (int i = 0; i < MaxRecentFiles; ++i) {
         fileMenu->addAction( recentFileActions[i] );
         recentFileActionBehaviors[i] =
@@ -348,6 +490,7 @@ void MainWindow::createMenus()
     editMenu->addAction( selectAllAction );
     editMenu->addSeparator();
     editMenu->addAction( findAction );
+    editMenu->addAction( searchAllTabsAction );
 
     viewMenu = menuBar()->addMenu( tr("&View") );
     viewMenu->addAction( overviewVisibleAction );
@@ -358,15 +501,19 @@ void MainWindow::createMenus()
     viewMenu->addAction( followAction );
     viewMenu->addSeparator();
     viewMenu->addAction( reloadAction );
+    viewMenu->addAction( reloadAllAction );
 
     toolsMenu = menuBar()->addMenu( tr("&Tools") );
     toolsMenu->addAction( filtersAction );
+    toolsMenu->addAction( compareTabsAction );
     toolsMenu->addSeparator();
     toolsMenu->addAction( optionsAction );
 
     menuBar()->addSeparator();
 
     helpMenu = menuBar()->addMenu( tr("&Help") );
+    helpMenu->addAction( perfCountersAction );
+    helpMenu->addSeparator();
     helpMenu->addAction( aboutAction );
 }
 
@@ -423,6 +570,25 @@ void MainWindow::openRecentFile()
         loadFile(action->data().toString());
 }
 
+// The new tab shares the LogData of the current one, so the file is
+// neither indexed nor kept in memory twice, but has its own search
+void MainWindow::duplicateTab()
+{
+    CrawlerWidget* current = currentCrawlerWidget();
+    if ( ! current )
+        return;
+
+    const QString file_name =
+        QString::fromStdString( session_->getFilename( current ) );
+    CrawlerWidget* crawler_widget = dynamic_cast<CrawlerWidget*>(
+            session_->openView( current,
+                []() { return new CrawlerWidget(); } ) );
+    assert( crawler_widget );
+
+    const int index = addCrawlerTab( crawler_widget, file_name );
+    mainTabWidget_.setCurrentIndex( index );
+}
+
 // Close current tab
 void MainWindow::closeTab()
 {
@@ -459,24 +625,130 @@ void MainWindow::copy()
     CrawlerWidget* current = currentCrawlerWidget();
 
     if ( current ) {
-        clipboard->setText( current->getSelectedText() );
+        // (read when pasted, the selection might be huge)
+        clipboard->setMimeData( current->getSelectionMimeData() );
 
         // Put it in the global selection as well (X11 only)
-        clipboard->setText( current->getSelectedText(),
+        clipboard->setMimeData( current->getSelectionMimeData(),
                 QClipboard::Selection );
     }
 }
 
+// Write the matches of the current search to a file, in the background
+void MainWindow::exportSearchResults()
+{
+    CrawlerWidget* current = currentCrawlerWidget();
+    if ( ! current )
+        return;
+
+    const QString fileName = QFileDialog::getSaveFileName( this,
+            tr("Export search results") );
+    if ( ! fileName.isEmpty() )
+        current->exportSearchResults( fileName );
+}
+
 // Display the QuickFind bar
 void MainWindow::find()
 {
     displayQuickFindBar( QuickFindMux::Forward );
 }
 
+// Opens the (non modal) panel searching all the tabs
+void MainWindow::searchAllTabs()
+{
+    if ( ! globalSearchDialog_ ) {
+        globalSearchDialog_ = new GlobalSearchDialog( this );
+        connect( globalSearchDialog_,
+                SIGNAL( searchRequested( const QString&, bool ) ),
+                this, SLOT( startGlobalSearch( const QString&, bool ) ) );
+        connect( globalSearchDialog_,
+                SIGNAL( lineActivated( CrawlerWidget*, qint64 ) ),
+                this, SLOT( displayTabLine( CrawlerWidget*, qint64 ) ) );
+    }
+
+    globalSearchDialog_->show();
+    globalSearchDialog_->raise();
+    globalSearchDialog_->activateWindow();
+}
+
+// Each file is checked against the fingerprints of its lines, only the
+// lines after the last ones unchanged being indexed (and searched)
+// again. The files are indexed on the threads shared by the tabs, as
+// many at a time as the scheduler has threads, the current one first.
+void MainWindow::reloadAll()
+{
+    // A file open in several tabs is reloaded once
+    std::set<std::string> reloaded;
+    for ( int i = 0; i < mainTabWidget_.count(); i++ ) {
+        if ( auto crawler_widget = dynamic_cast<CrawlerWidget*>(
+                    mainTabWidget_.widget( i ) ) ) {
+            if ( reloaded.insert(
+                        session_->getFilename( crawler_widget ) ).second )
+                crawler_widget->reloadChanges();
+        }
+    }
+}
+
+// The tab to compare with is chosen among the other ones, then whether
+// the words with digits are ignored
+void MainWindow::compareTabs()
+{
+    CrawlerWidget* current = currentCrawlerWidget();
+    if ( ! current )
+        return;
+
+    std::vector<CrawlerWidget*> others;
+    QStringList names;
+    for ( int i = 0; i < mainTabWidget_.count(); i++ ) {
+        if ( mainTabWidget_.widget( i ) != current ) {
+            others.push_back( dynamic_cast<CrawlerWidget*>(
+                        mainTabWidget_.widget( i ) ) );
+            names << mainTabWidget_.tabText( i );
+        }
+    }
+
+    if ( others.empty() ) {
+        QMessageBox::information( this, tr( "Compare with Tab" ),
+                tr( "Open the file to compare with in another tab first." ) );
+        return;
+    }
+
+    bool ok;
+    const QString name = QInputDialog::getItem( this, tr( "Compare with Tab" ),
+            tr( "Compare %1 with:" ).arg(
+                mainTabWidget_.tabText( mainTabWidget_.currentIndex() ) ),
+            names, 0, false, &ok );
+    if ( ! ok )
+        return;
+    CrawlerWidget* other = others[ names.indexOf( name ) ];
+
+    const bool mask_variables = QMessageBox::question( this,
+            tr( "Compare with Tab" ),
+            tr( "Ignore the words with digits (timestamps, ids, counters) "
+                "when comparing the lines?" ),
+            QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes )
+        == QMessageBox::Yes;
+
+    // A restored file is loaded, the lines loaded so far being compared
+    session_->activate( other );
+
+    comparison_.reset( new LogComparison( current->logData(), other->logData(),
+                mask_variables ) );
+    comparedTabs_[0] = current;
+    comparedTabs_[1] = other;
+    connect( comparison_.get(), SIGNAL( comparisonProgressed( int ) ),
+            this, SLOT( updateComparisonProgress( int ) ) );
+    connect( comparison_.get(), SIGNAL( comparisonFinished( bool ) ),
+            this, SLOT( showComparison( bool ) ) );
+
+    comparison_->start( TaskScheduler::Visible );
+}
+
 // Opens the 'Filters' dialog box
 void MainWindow::filters()
 {
-    FiltersDialog dialog(this);
+    CrawlerWidget* current = currentCrawlerWidget();
+    FiltersDialog dialog( current ? current->logData() : nullptr, this );
     signalMux_.connect(&dialog, SIGNAL( optionsChanged() ), SLOT( applyConfiguration() ));
     dialog.exec();
     signalMux_.disconnect(&dialog, SIGNAL( optionsChanged() ), SLOT( applyConfiguration() ));
@@ -491,6 +763,13 @@ void MainWindow::options()
     signalMux_.disconnect(&dialog, SIGNAL( optionsChanged() ), SLOT( applyConfiguration() ));
 }
 
+// Opens the performance counters panel.
+void MainWindow::perfCounters()
+{
+    PerfCountersDialog dialog(this);
+    dialog.exec();
+}
+
 // Opens the 'About' dialog box.
 void MainWindow::about()
 {
@@ -539,7 +818,7 @@ void MainWindow::disableFollow()
     followAction->setChecked( false );
 }
 
-void MainWindow::lineNumberHandler( int line )
+void MainWindow::lineNumberHandler( qint64 line )
 {
     // The line number received is the internal (starts at 0)
     lineNbField->setText( tr( "Line %1" ).arg( line + 1 ) );
@@ -555,8 +834,16 @@ void MainWindow::updateLoadingProgress( int progress )
     // We ignore 0% and 100% to avoid a flash when the file (or update)
     // is very short.
     if ( progress > 0 && progress < 100 ) {
-        infoLine->setText( current_file +
-                tr( " - Indexing lines... (%1 %)" ).arg( progress ) );
+        // The number of lines of a big file is estimated first
+        const LogData* log_data = currentCrawlerWidget()->logData();
+        if ( log_data->getEstimatedNbLine() > log_data->getNbLine() )
+            infoLine->setText( current_file +
+                    tr( " - Indexing lines... (%1 %, about %2 lines)" )
+                    .arg( progress )
+                    .arg( QLocale().toString( log_data->getEstimatedNbLine() ) ) );
+        else
+            infoLine->setText( current_file +
+                    tr( " - Indexing lines... (%1 %)" ).arg( progress ) );
         infoLine->displayGauge( progress );
 
         stopAction->setEnabled( true );
@@ -644,10 +931,21 @@ void MainWindow::closeTab( int index )
 
     assert( widget );
 
-    widget->stopLoading();
+    // (the other tabs on the file still need it loaded)
+    if ( session_->nbViews( widget ) == 1 )
+        widget->stopLoading();
+    if ( comparedTabs_[0] == widget || comparedTabs_[1] == widget )
+        comparison_.reset();
     mainTabWidget_.removeTab( index );
     session_->close( widget );
+
+    pendingLoads_.removeAll( widget );
+    const bool was_loading = backgroundLoads_.removeAll( widget ) > 0;
+
     delete widget;
+
+    if ( was_loading )
+        loadPendingFiles();
 }
 
 void MainWindow::currentTabChanged( int index )
@@ -661,6 +959,14 @@ void MainWindow::currentTabChanged( int index )
         signalMux_.setCurrentDocument( crawler_widget );
         quickFindMux_.registerSelector( crawler_widget );
 
+        // A restored file is loaded when first displayed
+        session_->activate( crawler_widget );
+        mainTabWidget_.setTabToolTip( index, QString() );
+
+        // The new lines matching the watched filters are seen
+        crawler_widget->acknowledgeWatchedMatches();
+        mainTabWidget_.setTabIcon( index, QIcon() );
+
         // New tab is set up with fonts etc...
         emit optionsChanged();
 
@@ -693,32 +999,148 @@ void MainWindow::loadFileNonInteractive( const QString& file_name )
 
     loadFile( file_name );
 
-    // Try to get the window to the front
-    // This is a bit of a hack but has been tested on:
-    // Qt 5.3 / Gnome / Linux
-    // Qt 4.8 / Win7
-#ifdef _WIN32
-    // Hack copied from http://qt-project.org/forums/viewthread/6164
-    ::SetWindowPos((HWND) effectiveWinId(), HWND_TOPMOST,
-            0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_SHOWWINDOW);
-    ::SetWindowPos((HWND) effectiveWinId(), HWND_NOTOPMOST,
-            0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_SHOWWINDOW);
-#else
-    Qt::WindowFlags window_flags = windowFlags();
-    window_flags |= Qt::WindowStaysOnTopHint;
-    setWindowFlags( window_flags );
-#endif
+    raiseWindow();
+}
 
-    activateWindow();
-    raise();
+void MainWindow::loadFilesNonInteractive( const QStringList& file_names,
+        const QVariantMap& options )
+{
+    LOG(logDEBUG) << "loadFilesNonInteractive( "
+        << file_names.size() << " files )";
 
-#ifndef _WIN32
-    window_flags = windowFlags();
-    window_flags &= ~Qt::WindowStaysOnTopHint;
-    setWindowFlags( window_flags );
-#endif
+    loadFiles( file_names, options );
 
-    showNormal();
+    raiseWindow();
+}
+
+void MainWindow::handleBackgroundLoadingFinished()
+{
+    CrawlerWidget* crawler_widget = qobject_cast<CrawlerWidget*>( sender() );
+
+    disconnect( crawler_widget, SIGNAL( loadingFinished( LoadingStatus ) ),
+            this, SLOT( handleBackgroundLoadingFinished() ) );
+    backgroundLoads_.removeAll( crawler_widget );
+
+    loadPendingFiles();
+}
+
+void MainWindow::runCommand( qint32 id, const QString& file_name,
+        const QString& command, const QVariantMap& args )
+{
+    LOG(logDEBUG) << "runCommand( " << id << ", "
+        << command.toStdString() << " )";
+
+    CrawlerWidget* crawler_widget = dynamic_cast<CrawlerWidget*>(
+            session_->getViewIfOpen(
+                QFileInfo( file_name ).absoluteFilePath().toStdString() ) );
+    if ( ! crawler_widget ) {
+        QVariantMap result;
+        result[ "error" ] = tr( "%1 is not open" ).arg( file_name );
+        externalCommunicator_->commandFinished( id, false, result );
+        return;
+    }
+
+    connect( crawler_widget,
+            SIGNAL( commandFinished( qint32, bool, const QVariantMap& ) ),
+            externalCommunicator_.get(),
+            SLOT( commandFinished( qint32, bool, const QVariantMap& ) ),
+            Qt::UniqueConnection );
+
+    // A restored file is loaded for the command
+    session_->activate( crawler_widget );
+    crawler_widget->runCommand( id, command, args );
+}
+
+void MainWindow::startGlobalSearch( const QString& text, bool ignore_case )
+{
+    LOG(logDEBUG) << "startGlobalSearch( " << text.toStdString() << " )";
+
+    std::vector<CrawlerWidget*> crawler_widgets;
+    QStringList names;
+    for ( int i = 0; i < mainTabWidget_.count(); i++ ) {
+        CrawlerWidget* crawler_widget = dynamic_cast<CrawlerWidget*>(
+                mainTabWidget_.widget( i ) );
+
+        // A restored file is loaded for the search, which then
+        // follows the loading
+        session_->activate( crawler_widget );
+        crawler_widget->search( text, ignore_case );
+
+        crawler_widgets.push_back( crawler_widget );
+        names << mainTabWidget_.tabText( i );
+    }
+
+    globalSearchDialog_->setSearchedTabs( crawler_widgets, names );
+}
+
+void MainWindow::handleWatchedFiltersMatched( qint64 nb_matches )
+{
+    CrawlerWidget* crawler_widget = qobject_cast<CrawlerWidget*>( sender() );
+    const int index = mainTabWidget_.indexOf( crawler_widget );
+
+    if ( index < 0 )
+        return;
+
+    // The user is looking at them already
+    if ( index == mainTabWidget_.currentIndex() && isActiveWindow() ) {
+        crawler_widget->acknowledgeWatchedMatches();
+        return;
+    }
+
+    LOG(logDEBUG) << "handleWatchedFiltersMatched: " << nb_matches
+        << " new matches in tab " << index;
+
+    QPixmap badge( 10, 10 );
+    badge.fill( Qt::transparent );
+    QPainter painter( &badge );
+    painter.setRenderHint( QPainter::Antialiasing );
+    painter.setPen( Qt::NoPen );
+    painter.setBrush( Qt::red );
+    painter.drawEllipse( badge.rect() );
+    painter.end();
+
+    mainTabWidget_.setTabIcon( index, QIcon( badge ) );
+    mainTabWidget_.setTabToolTip( index,
+            tr( "%1 new lines match the watched filters" ).arg( nb_matches ) );
+    QApplication::alert( this );
+}
+
+void MainWindow::displayTabLine( CrawlerWidget* crawler_widget, qint64 line )
+{
+    mainTabWidget_.setCurrentWidget( crawler_widget );
+    crawler_widget->displayLine( line );
+}
+
+// (the signals of a comparison replaced since are ignored)
+void MainWindow::updateComparisonProgress( int percent )
+{
+    if ( comparison_ && sender() == comparison_.get() )
+        infoLine->displayGauge( percent );
+}
+
+void MainWindow::showComparison( bool success )
+{
+    if ( ! comparison_ || sender() != comparison_.get() )
+        return;
+
+    infoLine->hideGauge();
+    if ( ! success || ! comparison_->isFinished()
+            || ! comparedTabs_[0] || ! comparedTabs_[1] ) {
+        QMessageBox::warning( this, tr( "Compare with Tab" ),
+                tr( "The files could not be compared (they have been "
+                    "truncated or closed meanwhile)." ) );
+        return;
+    }
+
+    const QString names[2] = {
+        mainTabWidget_.tabText( mainTabWidget_.indexOf( comparedTabs_[0] ) ),
+        mainTabWidget_.tabText( mainTabWidget_.indexOf( comparedTabs_[1] ) ) };
+    const MatchSet* only[2] = {
+        &comparison_->leftOnly(), &comparison_->rightOnly() };
+    for ( int i = 0; i < 2; i++ )
+        comparedTabs_[i]->showLines( *only[i],
+                tr( "%1 line%2 not in %3." ).arg( only[i]->size() )
+                .arg( only[i]->size() > 1 ? "s" : "" ).arg( names[1 - i] ) );
 }
 
 void MainWindow::newVersionNotification( const QString& new_version )
@@ -808,6 +1230,10 @@ bool MainWindow::loadFile( const QString& fileName )
     // Load the file
     loadingFileName = fileName;
 
+    // (not indexing it twice at the same time)
+    if ( prewarmer_ )
+        prewarmer_->skip( fileName );
+
     try {
         CrawlerWidget* crawler_widget = dynamic_cast<CrawlerWidget*>(
                 session_->open( fileName.toStdString(),
@@ -821,8 +1247,7 @@ bool MainWindow::loadFile( const QString& fileName )
         // tab during loading. (maybe FIXME)
         //mainTabWidget_.setEnabled( false );
 
-        int index = mainTabWidget_.addTab(
-                crawler_widget, strippedName( fileName ) );
+        int index = addCrawlerTab( crawler_widget, fileName );
 
         // Setting the new tab, the user will see a blank page for the duration
         // of the loading, with no way to switch to another tab
@@ -845,12 +1270,74 @@ bool MainWindow::loadFile( const QString& fileName )
 
 }
 
+void MainWindow::loadPendingFiles()
+{
+    while ( backgroundLoads_.size() < MaxBackgroundLoads
+            && ! pendingLoads_.isEmpty() ) {
+        CrawlerWidget* crawler_widget = pendingLoads_.takeFirst();
+
+        // Already loaded if it has been displayed
+        if ( ! session_->isDeferred( crawler_widget ) )
+            continue;
+
+        LOG(logDEBUG) << "Loading in the background "
+            << session_->getFilename( crawler_widget );
+
+        connect( crawler_widget, SIGNAL( loadingFinished( LoadingStatus ) ),
+                this, SLOT( handleBackgroundLoadingFinished() ) );
+        backgroundLoads_.append( crawler_widget );
+        session_->activate( crawler_widget );
+    }
+}
+
+void MainWindow::raiseWindow()
+{
+    // This is a bit of a hack but has been tested on:
+    // Qt 5.3 / Gnome / Linux
+    // Qt 4.8 / Win7
+#ifdef _WIN32
+    // Hack copied from http://qt-project.org/forums/viewthread/6164
+    ::SetWindowPos((HWND) effectiveWinId(), HWND_TOPMOST,
+            0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_SHOWWINDOW);
+    ::SetWindowPos((HWND) effectiveWinId(), HWND_NOTOPMOST,
+            0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_SHOWWINDOW);
+#else
+    Qt::WindowFlags window_flags = windowFlags();
+    window_flags |= Qt::WindowStaysOnTopHint;
+    setWindowFlags( window_flags );
+#endif
+
+    activateWindow();
+    raise();
+
+#ifndef _WIN32
+    window_flags = windowFlags();
+    window_flags &= ~Qt::WindowStaysOnTopHint;
+    setWindowFlags( window_flags );
+#endif
+
+    showNormal();
+}
+
+
+
 // Strips the passed filename from its directory part.
 QString MainWindow::strippedName( const QString& fullFileName ) const
 {
     return QFileInfo( fullFileName ).fileName();
 }
 
+// Adds the tab of the file, following the new matches of its
+// watched filters.
+int MainWindow::addCrawlerTab( CrawlerWidget* crawler_widget,
+        const QString& file_name )
+{
+    connect( crawler_widget, SIGNAL( watchedFiltersMatched( qint64 ) ),
+            this, SLOT( handleWatchedFiltersMatched( qint64 ) ) );
+
+    return mainTabWidget_.addTab( crawler_widget, strippedName( file_name ) );
+}
+
 // Return the currently active CrawlerWidget, or NULL if none
 CrawlerWidget* MainWindow::currentCrawlerWidget() const
 {
@@ -912,6 +1399,10 @@ void MainWindow::writeSettings()
                 view,
                 0UL,
                 view->context() ) );
+
+        // The results are restored with the session
+        dynamic_cast<const CrawlerWidget*>( view )->saveSearchResults(
+                QString( session_->getFilename( view ).c_str() ) );
     }
     session_->save( widget_list, saveGeometry() );
 
@@ -930,9 +1421,7 @@ void MainWindow::readSettings()
     crawlerWidget->restoreState( session.crawlerState() );
     */
 
-    // History of recent files
-    GetPersistentInfo().retrieve( QString( "recentFiles" ) );
-    updateRecentFileActions();
+    // The history of recent files is read by startBackgroundTasks()
 
     // GetPersistentInfo().retrieve( QString( "settings" ) );
     GetPersistentInfo().retrieve( QString( "filterSet" ) );
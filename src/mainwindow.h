@@ -22,6 +22,9 @@
 
 #include <memory>
 #include <QMainWindow>
+#include <QPointer>
+#include <QStringList>
+#include <QVariantMap>
 
 #include "session.h"
 #include "crawlerwidget.h"
@@ -30,6 +33,8 @@
 #include "tabbedcrawlerwidget.h"
 #include "quickfindwidget.h"
 #include "quickfindmux.h"
+#include "data/logcomparison.h"
+#include "prewarmer.h"
 #ifdef GLOGG_SUPPORTS_VERSION_CHECKING
 #include "versionchecker.h"
 #endif
@@ -39,6 +44,7 @@ class Session;
 class RecentFiles;
 class MenuActionToolTipBehavior;
 class ExternalCommunicator;
+class GlobalSearchDialog;
 
 // Main window of the application, creates menus, toolbar and
 // the CrawlerWidget
@@ -56,8 +62,15 @@ class MainWindow : public QMainWindow
     void reloadSession();
     // Loads the initial file (parameter passed or from config file)
     void loadInitialFile( QString fileName );
+    // Open the files in new tabs, the first one being displayed and
+    // the other ones loaded in the background a few at a time (see
+    // ExternalInstance::loadFiles for the options)
+    void loadFiles( const QStringList& fileNames, const QVariantMap& options );
+
+  public slots:
     // Starts the lower priority activities the MW controls such as
-    // version checking etc...
+    // loading the recent files, version checking etc...
+    // (called once the window is displayed, not to delay it)
     void startBackgroundTasks();
 
   protected:
@@ -70,13 +83,23 @@ class MainWindow : public QMainWindow
   private slots:
     void open();
     void openRecentFile();
+    // Open another tab on the file of the current one, sharing its index
+    void duplicateTab();
     void closeTab();
     void closeAll();
     void selectAll();
     void copy();
+    void exportSearchResults();
     void find();
+    // Open the panel searching all the tabs at once
+    void searchAllTabs();
+    // Compare the file of the current tab with the one of another tab
+    void compareTabs();
+    // Reload what has changed in the files of all the tabs
+    void reloadAll();
     void filters();
     void options();
+    void perfCounters();
     void about();
     void aboutQt();
 
@@ -90,7 +113,7 @@ class MainWindow : public QMainWindow
 
     // Update the line number displayed in the status bar.
     // Must be passed as the internal (starts at 0) line number.
-    void lineNumberHandler( int line );
+    void lineNumberHandler( qint64 line );
 
     // Instructs the widget to update the loading progress gauge
     void updateLoadingProgress( int progress );
@@ -116,6 +139,27 @@ class MainWindow : public QMainWindow
     // Load a file in a new tab (non-interactive)
     // (for use from e.g. IPC)
     void loadFileNonInteractive( const QString& file_name );
+    // Idem for several files
+    void loadFilesNonInteractive( const QStringList& file_names,
+            const QVariantMap& options );
+    // A file opened by loadFiles() has been loaded in the background
+    void handleBackgroundLoadingFinished();
+    // Run a command from a script on an open file (see
+    // CrawlerWidget::runCommand), loading it if it was restored
+    void runCommand( qint32 id, const QString& file_name,
+            const QString& command, const QVariantMap& args );
+    // Run the search in all the tabs, loading the restored files,
+    // the results being shown by the GlobalSearchDialog
+    void startGlobalSearch( const QString& text, bool ignore_case );
+    // Badge the tab of the sender as lines appended to its file
+    // match a watched filter
+    void handleWatchedFiltersMatched( qint64 nb_matches );
+    // Display the line (starting at 0) of the tab
+    void displayTabLine( CrawlerWidget* crawler_widget, qint64 line );
+    // The comparison of two tabs has progressed, or is finished (the
+    // lines of each file not in the other one being shown in its tab)
+    void updateComparisonProgress( int percent );
+    void showComparison( bool success );
 
     // Notify the user a new version is available
     void newVersionNotification( const QString& new_version );
@@ -141,9 +185,16 @@ class MainWindow : public QMainWindow
     void readSettings();
     void writeSettings();
     bool loadFile( const QString& fileName );
+    // Start loading the files opened by loadFiles() until
+    // MaxBackgroundLoads are loading
+    void loadPendingFiles();
+    // Try to get the window to the front
+    void raiseWindow();
     void updateTitleBar( const QString& file_name );
     void updateRecentFileActions();
     QString strippedName( const QString& fullFileName ) const;
+    int addCrawlerTab( CrawlerWidget* crawler_widget,
+            const QString& file_name );
     CrawlerWidget* currentCrawlerWidget() const;
     void displayQuickFindBar( QuickFindMux::QFDirection direction );
 
@@ -151,6 +202,20 @@ class MainWindow : public QMainWindow
     std::shared_ptr<ExternalCommunicator> externalCommunicator_;
     std::shared_ptr<RecentFiles> recentFiles_;
     QString loadingFileName;
+    // Tabs opened by loadFiles() still to be loaded, and being loaded
+    QList<CrawlerWidget*> pendingLoads_;
+    QList<CrawlerWidget*> backgroundLoads_;
+    // Created when first opened, then kept for the next searches
+    GlobalSearchDialog* globalSearchDialog_;
+    // The comparison running or done last, and the tabs compared
+    std::unique_ptr<LogComparison> comparison_;
+    QPointer<CrawlerWidget> comparedTabs_[2];
+    // Indexing the recent files in the background, if configured
+    std::unique_ptr<Prewarmer> prewarmer_;
+
+    // Files loaded at the same time in the background, their indexing
+    // sharing the TaskScheduler's threads
+    enum { MaxBackgroundLoads = 2 };
 
     enum { MaxRecentFiles = 5 };
     QAction *recentFileActions[MaxRecentFiles];
@@ -168,20 +233,26 @@ class MainWindow : public QMainWindow
     QToolBar *toolBar;
 
     QAction *openAction;
+    QAction *duplicateTabAction;
     QAction *closeAction;
     QAction *closeAllAction;
+    QAction *exportResultsAction;
     QAction *exitAction;
     QAction *copyAction;
     QAction *selectAllAction;
     QAction *findAction;
+    QAction *searchAllTabsAction;
+    QAction *compareTabsAction;
     QAction *overviewVisibleAction;
     QAction *lineNumbersVisibleInMainAction;
     QAction *lineNumbersVisibleInFilteredAction;
     QAction *followAction;
     QAction *reloadAction;
+    QAction *reloadAllAction;
     QAction *stopAction;
     QAction *filtersAction;
     QAction *optionsAction;
+    QAction *perfCountersAction;
     QAction *aboutAction;
     QAction *aboutQtAction;
 
@@ -19,14 +19,14 @@
 
 #include "marks.h"
 
+#include <algorithm>
+
 #include "log.h"
-#include "utils.h"
 
 // This file implements the list of marks for a file.
-// It is implemented as a QList which is kept in order when inserting,
-// it is simpler than something fancy like a heap, and insertion are
-// not done very often anyway.  Oh and we need to iterate through the
-// list, disqualifying a straight heap.
+// It is implemented as a std::vector which is kept in order when
+// inserting: lookups are binary searches in contiguous memory, and
+// insertions, which are not done very often, move a few integers.
 
 Marks::Marks() : marks_()
 {
@@ -34,14 +34,14 @@ Marks::Marks() : marks_()
 
 void Marks::addMark( qint64 line, QChar mark )
 {
-    // Look for the index immediately before
-    int index;
-    if ( ! lookupLineNumber< QList<Mark> >( marks_, line, &index ) )
+    // Look for the mark immediately after
+    std::vector<Mark>::const_iterator next = findMark( line );
+    if ( next == marks_.end() || next->lineNumber() != line )
     {
         // If a mark is not already set for this line
         LOG(logDEBUG) << "Inserting mark at line " << line
-            << " (index " << index << ")";
-        marks_.insert( index, Mark( line ) );
+            << " (index " << ( next - marks_.begin() ) << ")";
+        marks_.insert( marks_.begin() + ( next - marks_.begin() ), Mark( line ) );
     }
     else
     {
@@ -52,6 +52,32 @@ void Marks::addMark( qint64 line, QChar mark )
     mark = mark;
 }
 
+void Marks::addMarks( const std::vector<qint64>& lines )
+{
+    std::vector<Mark> merged;
+    merged.reserve( marks_.size() + lines.size() );
+
+    auto mark = marks_.begin();
+    auto line = lines.begin();
+    while ( mark != marks_.end() || line != lines.end() ) {
+        if ( line == lines.end()
+                || ( mark != marks_.end() && mark->lineNumber() <= *line ) ) {
+            // A line already marked is skipped
+            if ( line != lines.end() && mark->lineNumber() == *line )
+                ++line;
+            merged.push_back( *mark++ );
+        }
+        else {
+            if ( merged.empty() || merged.back().lineNumber() != *line )
+                merged.push_back( Mark( *line ) );
+            ++line;
+        }
+    }
+
+    LOG(logDEBUG) << "Added " << ( merged.size() - marks_.size() ) << " marks";
+    marks_.swap( merged );
+}
+
 qint64 Marks::getMark( QChar mark ) const
 {
     // 'mark' is not used yet
@@ -62,8 +88,8 @@ qint64 Marks::getMark( QChar mark ) const
 
 bool Marks::isLineMarked( qint64 line ) const
 {
-    int index;
-    return lookupLineNumber< QList<Mark> >( marks_, line, &index );
+    std::vector<Mark>::const_iterator i = findMark( line );
+    return i != marks_.end() && i->lineNumber() == line;
 }
 
 void Marks::deleteMark( QChar mark )
@@ -74,15 +100,28 @@ void Marks::deleteMark( QChar mark )
 
 void Marks::deleteMark( qint64 line )
 {
-    int index;
+    std::vector<Mark>::const_iterator i = findMark( line );
 
-    if ( lookupLineNumber< QList<Mark> >( marks_, line, &index ) )
+    if ( i != marks_.end() && i->lineNumber() == line )
     {
-        marks_.removeAt( index );
+        marks_.erase( marks_.begin() + ( i - marks_.begin() ) );
     }
 }
 
+void Marks::deleteMarksFrom( qint64 line )
+{
+    std::vector<Mark>::const_iterator i = findMark( line );
+
+    marks_.erase( marks_.begin() + ( i - marks_.begin() ), marks_.end() );
+}
+
 void Marks::clear()
 {
     marks_.clear();
 }
+
+std::vector<Mark>::const_iterator Marks::findMark( qint64 line ) const
+{
+    return std::lower_bound( marks_.begin(), marks_.end(), line,
+            []( const Mark& mark, qint64 l ) { return mark.lineNumber() < l; } );
+}
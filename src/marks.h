@@ -20,24 +20,27 @@
 #ifndef MARKS_H
 #define MARKS_H
 
+#include <vector>
+
 #include <QChar>
-#include <QList>
 
 // Class encapsulating a single mark
 // Contains the line number the mark is identifying.
 class Mark {
   public:
-    Mark( int line ) { lineNumber_ = line; };
+    Mark( qint64 line ) { lineNumber_ = line; };
 
     // Accessors
-    int lineNumber() const { return lineNumber_; }
+    qint64 lineNumber() const { return lineNumber_; }
 
   private:
-    int lineNumber_;
+    qint64 lineNumber_;
 };
 
 // A list of marks, i.e. line numbers optionally associated to an
 // identifying character.
+// The marks are kept sorted in a contiguous array, so lookups are
+// binary searches and the marks of a range of lines can be iterated.
 class Marks {
   public:
     // Create an empty Marks
@@ -47,6 +50,9 @@ class Marks {
     // If a mark for this char already exist, the previous one is replaced.
     // It will happily add marks anywhere, even at stupid indexes.
     void addMark( qint64 line, QChar mark = QChar() );
+    // Add unnamed marks at all the passed lines (sorted), in a single
+    // merge, the lines already marked being skipped.
+    void addMarks( const std::vector<qint64>& lines );
     // Get the (unique) mark identified by the passed char.
     qint64 getMark( QChar mark ) const;
     // Returns wheither the passed line has a mark on it.
@@ -62,6 +68,8 @@ class Marks {
     // Return the total number of marks
     int size() const
     { return marks_.size(); }
+    // Delete the marks on the passed line and the following ones.
+    void deleteMarksFrom( qint64 line );
     // Completely clear the marks list.
     void clear();
 
@@ -69,7 +77,7 @@ class Marks {
     // Provide a const_iterator for the client to iterate through the marks.
     class const_iterator {
       public:
-        const_iterator( QList<Mark>::const_iterator iter )
+        const_iterator( std::vector<Mark>::const_iterator iter )
         { internal_iter_ = iter; }
         const_iterator( const const_iterator& original )
         { internal_iter_ = original.internal_iter_; }
@@ -83,17 +91,24 @@ class Marks {
         { ++internal_iter_ ; return *this; }
 
       private:
-        QList<Mark>::const_iterator internal_iter_;
+        std::vector<Mark>::const_iterator internal_iter_;
     };
 
     const_iterator begin() const
     { return const_iterator( marks_.begin() ); }
     const_iterator end() const
     { return const_iterator( marks_.end() ); }
+    // Returns an iterator on the first mark at or after the passed line
+    // (to go through the marks of a range of lines).
+    const_iterator lowerBound( qint64 line ) const
+    { return const_iterator( findMark( line ) ); }
 
   private:
-    // List of marks.
-    QList<Mark> marks_;
+    // Sorted list of marks.
+    std::vector<Mark> marks_;
+
+    // Returns the first mark at or after the passed line
+    std::vector<Mark>::const_iterator findMark( qint64 line ) const;
 };
 
 #endif
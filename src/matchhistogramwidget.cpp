@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements MatchHistogramWidget, drawing the number of
+// matches by period under the search line.
+
+#include <QDateTime>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+
+#include "matchhistogramwidget.h"
+
+#include "data/logfiltereddata.h"
+#include "data/matchhistogram.h"
+
+// Graphic parameters
+const int MatchHistogramWidget::BAR_WIDTH = 6;
+
+namespace {
+
+// The timestamps between these are taken for milliseconds since the
+// epoch (years 2000 to 2100), as read with a format, and shown as dates.
+const qint64 firstDate = 946684800000LL;
+const qint64 lastDate  = 4102444800000LL;
+
+}
+
+MatchHistogramWidget::MatchHistogramWidget( QWidget* parent ) :
+    QWidget( parent )
+{
+    filteredData_ = NULL;
+    histogram_    = NULL;
+
+    setBackgroundRole( QPalette::Base );
+    setAutoFillBackground( true );
+    setMouseTracking( true );
+    setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Fixed );
+}
+
+void MatchHistogramWidget::setFilteredData( const LogFilteredData* filteredData )
+{
+    filteredData_ = filteredData;
+    histogram_    = NULL;
+}
+
+QSize MatchHistogramWidget::sizeHint() const
+{
+    return QSize( 200, 60 );
+}
+
+void MatchHistogramWidget::updateHistogram()
+{
+    if ( ! isVisible() || filteredData_ == NULL )
+        return;
+
+    histogram_ = &filteredData_->getMatchHistogram(
+            qMax( 1, width() / BAR_WIDTH ) );
+    update();
+}
+
+void MatchHistogramWidget::paintEvent( QPaintEvent* /* paintEvent */ )
+{
+    static const QColor match_color("red");
+
+    if ( histogram_ == NULL || histogram_->maxCount() == 0 )
+        return;
+
+    QPainter painter( this );
+    const int max_height = height() - 2;
+
+    for ( int bucket = 0; bucket < histogram_->size(); bucket++ ) {
+        const qint64 count = histogram_->count( bucket );
+        if ( count == 0 )
+            continue;
+
+        // A bucket with a match is always seen
+        const int bar_height = qMax<qint64>( 1,
+                count * max_height / histogram_->maxCount() );
+        painter.fillRect( bucket * BAR_WIDTH, height() - bar_height,
+                BAR_WIDTH - 1, bar_height, match_color );
+    }
+}
+
+void MatchHistogramWidget::mousePressEvent( QMouseEvent* mouseEvent )
+{
+    const int bucket = bucketAt( mouseEvent->x() );
+
+    if ( mouseEvent->button() == Qt::LeftButton && bucket >= 0 )
+        emit lineClicked( histogram_->firstLine( bucket ) );
+}
+
+void MatchHistogramWidget::mouseMoveEvent( QMouseEvent* mouseEvent )
+{
+    const int bucket = bucketAt( mouseEvent->x() );
+
+    if ( bucket >= 0 )
+        QToolTip::showText( mouseEvent->globalPos(),
+                bucketDescription( bucket ), this );
+    else
+        QToolTip::hideText();
+}
+
+void MatchHistogramWidget::resizeEvent( QResizeEvent* /* resizeEvent */ )
+{
+    updateHistogram();
+}
+
+void MatchHistogramWidget::showEvent( QShowEvent* /* showEvent */ )
+{
+    updateHistogram();
+}
+
+int MatchHistogramWidget::bucketAt( int x ) const
+{
+    if ( histogram_ == NULL || x < 0 )
+        return -1;
+
+    const int bucket = x / BAR_WIDTH;
+    return bucket < histogram_->size() ? bucket : -1;
+}
+
+QString MatchHistogramWidget::bucketDescription( int bucket ) const
+{
+    const qint64 count = histogram_->count( bucket );
+
+    if ( histogram_->isByTime() ) {
+        const qint64 start = histogram_->startTime( bucket );
+        return tr( "%1 match%2 from %3 to %4" )
+            .arg( count ).arg( count > 1 ? "es" : "" )
+            .arg( timeText( start ) )
+            .arg( timeText( start + histogram_->bucketSize() ) );
+    }
+    else {
+        return tr( "%1 match%2 in lines %3 to %4" )
+            .arg( count ).arg( count > 1 ? "es" : "" )
+            .arg( histogram_->firstLine( bucket ) + 1 )
+            .arg( histogram_->endLine( bucket ) );
+    }
+}
+
+QString MatchHistogramWidget::timeText( qint64 time ) const
+{
+    if ( time < firstDate || time >= lastDate )
+        return QString::number( time );
+
+    const QDateTime date = QDateTime::fromMSecsSinceEpoch( time );
+    return date.toString( histogram_->bucketSize() < 1000 ?
+            "yyyy-MM-dd hh:mm:ss.zzz" : "yyyy-MM-dd hh:mm:ss" );
+}
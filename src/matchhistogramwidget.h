@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATCHHISTOGRAMWIDGET_H
+#define MATCHHISTOGRAMWIDGET_H
+
+#include <QWidget>
+
+class LogFilteredData;
+class MatchHistogram;
+
+// Chart of the number of matches of the search by period of time (or
+// range of lines), drawn from the MatchHistogram of the LogFilteredData.
+// The bucket under the mouse is described in a tooltip, clicking on
+// it sends the first line of the bucket.
+class MatchHistogramWidget : public QWidget
+{
+  Q_OBJECT
+
+  public:
+    MatchHistogramWidget( QWidget* parent = 0 );
+
+    // Associate the widget with the matches it draws
+    void setFilteredData( const LogFilteredData* filteredData );
+
+    QSize sizeHint() const;
+
+  public slots:
+    // Count the matches again (when they have changed) if the widget
+    // is visible
+    void updateHistogram();
+
+  signals:
+    // Sent when the user clicks on a bucket
+    void lineClicked( qint64 line );
+
+  protected:
+    void paintEvent( QPaintEvent* paintEvent );
+    void mousePressEvent( QMouseEvent* mouseEvent );
+    void mouseMoveEvent( QMouseEvent* mouseEvent );
+    void resizeEvent( QResizeEvent* resizeEvent );
+    void showEvent( QShowEvent* showEvent );
+
+  private:
+    // Width of a bar, in pixels
+    static const int BAR_WIDTH;
+
+    const LogFilteredData* filteredData_;
+    // Valid until the next updateHistogram()
+    const MatchHistogram* histogram_;
+
+    // Returns the bucket drawn at the x coordinate, -1 if none
+    int bucketAt( int x ) const;
+    // Returns the text describing the bucket
+    QString bucketDescription( int bucket ) const;
+    // Returns the text of a time of the histogram
+    QString timeText( qint64 time ) const;
+};
+
+#endif
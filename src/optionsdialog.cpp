@@ -71,6 +71,9 @@ void OptionsDialog::setupRegexp()
 
     mainSearchBox->addItems( regexpTypes );
     quickFindSearchBox->addItems( regexpTypes );
+
+    // Queries are only evaluated by the main search
+    mainSearchBox->addItem( tr("Boolean Query (AND/OR/NOT)") );
 }
 
 // Enable/disable the QuickFind options depending on the state
@@ -123,6 +126,7 @@ void OptionsDialog::updateDialogFromConfig()
             getRegexpIndex( config->quickfindRegexpType() ) );
 
     incrementalCheckBox->setChecked( config->isQuickfindIncremental() );
+    mainIncrementalCheckBox->setChecked( config->isMainSearchIncremental() );
 }
 
 //
@@ -160,6 +164,7 @@ void OptionsDialog::updateConfigFromDialog()
     config->setQuickfindRegexpType(
             getRegexpTypeFromIndex( quickFindSearchBox->currentIndex() ) );
     config->setQuickfindIncremental( incrementalCheckBox->isChecked() );
+    config->setMainSearchIncremental( mainIncrementalCheckBox->isChecked() );
 
     emit optionsChanged();
 }
@@ -24,18 +24,23 @@
 #include "log.h"
 
 #include "data/logfiltereddata.h"
+#include "filtermap.h"
 
 #include "overview.h"
 
-Overview::Overview() : matchLines_(), markLines_()
+Overview::Overview() : matchLines_(), markLines_(), filterLines_(),
+    matchesGeneration_( -1 ), matchLinesHeight_( 0 ), matchLinesInFile_( 0 ),
+    nbMatchesProcessed_( 0 )
 {
     logFilteredData_ = NULL;
+    filterMap_       = NULL;
     linesInFile_     = 0;
     topLine_         = 0;
     nbLines_         = 0;
     height_          = 0;
     dirty_           = true;
     visible_         = false;
+    linesGeneration_ = 0;
 }
 
 Overview::~Overview()
@@ -47,7 +52,13 @@ void Overview::setFilteredData( const LogFilteredData* logFilteredData )
     logFilteredData_ = logFilteredData;
 }
 
-void Overview::updateData( int totalNbLine )
+void Overview::setFilterMap( const FilterMap* filterMap )
+{
+    filterMap_ = filterMap;
+    dirty_ = true;
+}
+
+void Overview::updateData( qint64 totalNbLine )
 {
     LOG(logDEBUG) << "OverviewWidget::updateData " << totalNbLine;
 
@@ -75,74 +86,173 @@ const QVector<Overview::WeightedLine>* Overview::getMarkLines() const
     return &markLines_;
 }
 
+const QVector<Overview::ColoredLine>* Overview::getFilterLines() const
+{
+    return &filterLines_;
+}
+
 std::pair<int,int> Overview::getViewLines() const
 {
     int top = 0;
     int bottom = height_ - 1;
 
     if ( linesInFile_ > 0 ) {
-        top = (int)((qint64)topLine_ * height_ / linesInFile_);
-        bottom = (int)((qint64)top + nbLines_ * height_ / linesInFile_);
+        top = (int)( topLine_ * height_ / linesInFile_ );
+        bottom = (int)( top + nbLines_ * height_ / linesInFile_ );
     }
 
     return std::pair<int,int>(top, bottom);
 }
 
-int Overview::fileLineFromY( int position ) const
+qint64 Overview::fileLineFromY( int position ) const
 {
-    int line = (int)((qint64)position * linesInFile_ / height_);
+    qint64 line = (qint64)position * linesInFile_ / height_;
 
     return line;
 }
 
-int Overview::yFromFileLine( int file_line ) const
+int Overview::yFromFileLine( qint64 file_line ) const
 {
     int position = 0;
 
     if ( linesInFile_ > 0 )
-        position =  (int)((qint64)file_line * height_ / linesInFile_);
+        position = (int)( file_line * height_ / linesInFile_ );
 
     return position;
 }
 
+qint64 Overview::firstFileLineOfY( int y ) const
+{
+    if ( height_ <= 0 )
+        return linesInFile_;
+
+    // Smallest line such as line * height_ / linesInFile_ >= y
+    return ( (qint64)y * linesInFile_ + height_ - 1 ) / height_;
+}
+
 // Update the internal cache
 void Overview::recalculatesLines()
 {
     LOG(logDEBUG) << "OverviewWidget::recalculatesLines";
 
     if ( logFilteredData_ != NULL ) {
-        matchLines_.clear();
-        markLines_.clear();
-
-        for ( int i = 0; i < logFilteredData_->getNbLine(); i++ ) {
-            LogFilteredData::FilteredLineType line_type =
-                logFilteredData_->filteredLineTypeByIndex( i );
-            int line = (int) logFilteredData_->getMatchingLineNumber( i );
-            int position = (int)( (qint64)line * height_ / linesInFile_ );
-            if ( line_type == LogFilteredData::Match ) {
-                if ( ( ! matchLines_.isEmpty() ) && matchLines_.last().position() == position ) {
-                    // If the line is already there, we increase its weight
-                    matchLines_.last().load();
-                }
-                else {
-                    // If not we just add it
-                    matchLines_.append( WeightedLine( position ) );
-                }
-            }
-            else {
-                if ( ( ! markLines_.isEmpty() ) && markLines_.last().position() == position ) {
-                    // If the line is already there, we increase its weight
-                    markLines_.last().load();
-                }
-                else {
-                    // If not we just add it
-                    markLines_.append( WeightedLine( position ) );
-                }
-            }
-        }
+        recalculatesMatchLines();
+        recalculatesMarkLines();
     }
     else
         LOG(logERROR) << "Overview::recalculatesLines: logFilteredData_ == NULL";
 
+    recalculatesFilterLines();
+
     dirty_ = false;
+    ++linesGeneration_;
+}
+
+// The matches of each pixel line are counted from the ranks, in the
+// MatchSet, of the first lines of this pixel line and of the next one
+// (the MatchSet keeping the number of matches by block of lines),
+// so the cost depends on the height and not on the number of matches.
+void Overview::recalculatesMatchLines()
+{
+    if ( logFilteredData_->getVisibility() == LogFilteredData::MarksOnly ) {
+        matchLines_.clear();
+        matchesGeneration_ = -1;
+        return;
+    }
+
+    const MatchSet& matches = logFilteredData_->getMatches();
+
+    // Nothing new?
+    if ( ( logFilteredData_->getMatchesGeneration() == matchesGeneration_ )
+            && ( height_ == matchLinesHeight_ )
+            && ( linesInFile_ == matchLinesInFile_ )
+            && ( matches.size() == nbMatchesProcessed_ ) )
+        return;
+
+    matchesGeneration_  = logFilteredData_->getMatchesGeneration();
+    matchLinesHeight_   = height_;
+    matchLinesInFile_   = linesInFile_;
+    nbMatchesProcessed_ = matches.size();
+
+    matchLines_.clear();
+    if ( linesInFile_ <= 0 )
+        return;
+
+    // Go from a match to the next pixel line having one
+    LineNumber rank = 0;
+    while ( rank < matches.size() ) {
+        const int y = yFromFileLine( matches.select( rank ) );
+        if ( y >= height_ )
+            break;
+
+        const qint64 firstLine = firstFileLineOfY( y );
+        const qint64 nextLine  = firstFileLineOfY( y + 1 );
+        const LineNumber nextRank = matches.rank( nextLine );
+        matchLines_.append( WeightedLine( y, nextRank - rank,
+                    nextLine - firstLine ) );
+        rank = nextRank;
+    }
+}
+
+void Overview::recalculatesMarkLines()
+{
+    markLines_.clear();
+
+    if ( logFilteredData_->getVisibility() == LogFilteredData::MatchesOnly
+            || logFilteredData_->getVisibility()
+                == LogFilteredData::MatchesWithContext
+            || linesInFile_ <= 0 )
+        return;
+
+    // There are few marks, they are placed again each time
+    const Marks& marks = logFilteredData_->getMarks();
+    for ( Marks::const_iterator i = marks.begin(); i != marks.end(); ++i ) {
+        const int y = yFromFileLine( i->lineNumber() );
+        if ( ( ! markLines_.isEmpty() ) && markLines_.last().position() == y ) {
+            // If the line is already there, we increase its weight
+            markLines_.last().load();
+        }
+        else {
+            // If not we just add it
+            markLines_.append( WeightedLine( y, 1,
+                        firstFileLineOfY( y + 1 ) - firstFileLineOfY( y ) ) );
+        }
+    }
+}
+
+// Each pixel line takes the colour of the filter colouring the most
+// file lines it covers.
+void Overview::recalculatesFilterLines()
+{
+    filterLines_.clear();
+
+    if ( filterMap_ == NULL || height_ <= 0 )
+        return;
+
+    std::vector<int> bestCounts( height_, 0 );
+    std::vector<int> bestFilters( height_, -1 );
+    std::vector<int> counts;
+
+    const int nbFilters = filterMap_->nbFilters();
+    for ( int filter = 0; filter < nbFilters; filter++ ) {
+        filterMap_->getDensity( filter, linesInFile_, height_, &counts );
+        for ( int position = 0; position < height_; position++ ) {
+            if ( counts[position] > bestCounts[position] ) {
+                bestCounts[position]  = counts[position];
+                bestFilters[position] = filter;
+            }
+        }
+    }
+
+    for ( int position = 0; position < height_; position++ ) {
+        if ( bestFilters[position] >= 0 ) {
+            QColor foreColor, backColor;
+            filterMap_->getFilterColors( bestFilters[position],
+                    &foreColor, &backColor );
+            // Darker when more lines are coloured
+            filterLines_.append( ColoredLine( position, bestCounts[position],
+                        firstFileLineOfY( position + 1 ) - firstFileLineOfY( position ),
+                        backColor ) );
+        }
+    }
 }
@@ -22,8 +22,10 @@
 
 #include <QList>
 #include <QVector>
+#include <QColor>
 
 class LogFilteredData;
+class FilterMap;
 
 // Class implementing the logic behind the matches overview bar.
 // This class converts the matches found in a LogFilteredData in
@@ -34,23 +36,51 @@ class LogFilteredData;
 class Overview
 {
   public:
-    // A line with a position in pixel and a weight (darkness)
+    // A line with a position in pixel and the number of file lines
+    // it stands for, out of the ones it covers (its density).
     class WeightedLine {
       public:
         static const int WEIGHT_STEPS = 3;
 
-        WeightedLine() { pos_ = 0; weight_ = 0; }
+        WeightedLine() { pos_ = 0; count_ = 1; nbLines_ = 1; }
         // (Necessary for QVector)
-        WeightedLine( int pos ) { pos_ = pos; weight_ = 0; }
+        WeightedLine( int pos ) { pos_ = pos; count_ = 1; nbLines_ = 1; }
+        WeightedLine( int pos, qint64 count, qint64 nbLines )
+        { pos_ = pos; count_ = count; nbLines_ = nbLines; }
 
         int position() const { return pos_; }
-        int weight() const { return weight_; }
-
-        void load() { weight_ = qMin( weight_ + 1, WEIGHT_STEPS - 1 ); }
+        // Darkness, between 0 and WEIGHT_STEPS - 1
+        int weight() const
+        { return qMin<qint64>( count_ - 1, WEIGHT_STEPS - 1 ); }
+        // Number of lines represented
+        qint64 count() const { return count_; }
+        // Number of lines of the file covered by the pixel line
+        qint64 nbLines() const { return nbLines_; }
+        // Proportion of the lines covered which are represented
+        double density() const
+        { return nbLines_ > 0 ? (double) count_ / nbLines_ : 1.0; }
+
+        void load() { count_++; }
 
       private:
         int pos_;
-        int weight_;
+        qint64 count_;
+        qint64 nbLines_;
+    };
+
+    // A weighted line drawn in the colour of a filter
+    class ColoredLine : public WeightedLine {
+      public:
+        ColoredLine() : WeightedLine(), color_() {}
+        ColoredLine( int pos, const QColor& color )
+            : WeightedLine( pos ), color_( color ) {}
+        ColoredLine( int pos, qint64 count, qint64 nbLines, const QColor& color )
+            : WeightedLine( pos, count, nbLines ), color_( color ) {}
+
+        const QColor& color() const { return color_; }
+
+      private:
+        QColor color_;
     };
 
     Overview();
@@ -58,15 +88,17 @@ class Overview
 
     // Associate the passed filteredData to this Overview
     void setFilteredData( const LogFilteredData* logFilteredData );
+    // Associate the passed filter map to this Overview
+    void setFilterMap( const FilterMap* filterMap );
     // Signal the overview its attached LogFilteredData has been changed and
     // the overview must be updated with the provided total number
     // of line of the file.
-    void updateData( int totalNbLine );
+    void updateData( qint64 totalNbLine );
     // Set the visibility flag of this overview.
     void setVisible( bool visible ) { visible_ = visible; dirty_ = visible; }
 
     // Update the current position in the file (to draw the view line)
-    void updateCurrentPosition( int firstLine, int lastLine )
+    void updateCurrentPosition( qint64 firstLine, qint64 lastLine )
     { topLine_ = firstLine; nbLines_ = lastLine - firstLine; }
 
     // Returns weither this overview is visible.
@@ -80,34 +112,59 @@ class Overview
     // Returns a list of lines (between 0 and 'height') representing marks.
     // (pointer returned is valid until next call to update*()
     const QVector<WeightedLine>* getMarkLines() const;
+    // Returns a list of lines (between 0 and 'height') representing the
+    // lines coloured by the filters.
+    // (pointer returned is valid until next call to update*()
+    const QVector<ColoredLine>* getFilterLines() const;
+    // Returns a number changed each time the lines above are recalculated,
+    // for the client to know whether what it has drawn from them is current.
+    int linesGeneration() const { return linesGeneration_; }
     // Return a pair of lines (between 0 and 'height') representing the current view.
     std::pair<int,int> getViewLines() const;
 
     // Return the line number corresponding to the passed overview y coordinate.
-    int fileLineFromY( int y ) const;
+    qint64 fileLineFromY( int y ) const;
     // Return the y coordinate corresponding to the passed line number.
-    int yFromFileLine( int file_line ) const;
+    int yFromFileLine( qint64 file_line ) const;
+    // Return the first line number whose y coordinate is the passed one
+    // (or more if no line is drawn there).
+    qint64 firstFileLineOfY( int y ) const;
 
   private:
     // List of matches associated with this Overview.
     const LogFilteredData* logFilteredData_;
+    // Map of the filters colouring the lines (can be NULL)
+    const FilterMap* filterMap_;
     // Total number of lines in the file.
-    int linesInFile_;
+    qint64 linesInFile_;
     // Whether the overview is visible.
     bool visible_;
     // First and last line currently viewed.
-    int topLine_;
-    int nbLines_;
+    qint64 topLine_;
+    qint64 nbLines_;
     // Current height of view window.
     int height_;
     // Does the cache (matchesLines, markLines) need to be recalculated.
     int dirty_;
+    // Incremented each time the lines are recalculated.
+    int linesGeneration_;
 
     // List of lines representing matches and marks (are shared with the client)
     QVector<WeightedLine> matchLines_;
     QVector<WeightedLine> markLines_;
+    QVector<ColoredLine> filterLines_;
+
+    // What matchLines_ has been computed for, it is kept as long
+    // as this doesn't change.
+    int matchesGeneration_;
+    int matchLinesHeight_;
+    qint64 matchLinesInFile_;
+    qint64 nbMatchesProcessed_;
 
     void recalculatesLines();
+    void recalculatesMatchLines();
+    void recalculatesMarkLines();
+    void recalculatesFilterLines();
 };
 
 #endif
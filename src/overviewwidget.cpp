@@ -23,6 +23,7 @@
 #include <QPainter>
 #include <QMouseEvent>
 #include <cassert>
+#include <cmath>
 
 #include "log.h"
 
@@ -35,6 +36,25 @@ const int OverviewWidget::LINE_MARGIN = 4;
 const int OverviewWidget::STEP_DURATION_MS = 30;
 const int OverviewWidget::INITIAL_TTL_VALUE = 5;
 
+namespace {
+
+// Heat map shading: from light for a single line to opaque when all
+// the lines covered by the pixel line are represented (log scale).
+double opacityOf( const Overview::WeightedLine& line )
+{
+    const double minOpacity = 1.0 / Overview::WeightedLine::WEIGHT_STEPS;
+    const qint64 nbLines = qMax<qint64>( line.nbLines(),
+            Overview::WeightedLine::WEIGHT_STEPS );
+
+    if ( line.count() <= 1 )
+        return minOpacity;
+
+    return qMin( 1.0, minOpacity + ( 1.0 - minOpacity )
+            * std::log( (double) line.count() ) / std::log( (double) nbLines ) );
+}
+
+}
+
 #define HIGHLIGHT_XPM_WIDTH 27
 #define HIGHLIGHT_XPM_HEIGHT 9
 
@@ -135,9 +155,10 @@ const char* const highlight_xpm[][14] = {
 };
 
 OverviewWidget::OverviewWidget( QWidget* parent ) :
-    QWidget( parent ), highlightTimer_()
+    QWidget( parent ), linesPixmap_(), highlightTimer_()
 {
     overview_ = NULL;
+    linesPixmapGeneration_ = -1;
 
     setBackgroundRole( QPalette::Window );
 
@@ -151,9 +172,6 @@ OverviewWidget::OverviewWidget( QWidget* parent ) :
 
 void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
 {
-    static const QColor match_color("red");
-    static const QColor mark_color("dodgerblue");
-
     static const QPixmap highlight_pixmap[] = {
         QPixmap( highlight_xpm[0] ),
         QPixmap( highlight_xpm[1] ),
@@ -166,36 +184,20 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
     assert( overview_ != NULL );
 
     overview_->updateView( height() );
+    updateLinesPixmap();
 
     {
         QPainter painter( this );
 
+        // The lines of the filters, matches and marks, only redrawn
+        // when they change (not when the view is scrolled)
+        painter.drawPixmap( 0, 0, linesPixmap_ );
+
         // The line separating from the main view
         painter.setPen( palette().color(QPalette::Text) );
         painter.drawLine( 0, 0, 0, height() );
 
-        // The 'match' lines
-        painter.setPen( match_color );
-        foreach (Overview::WeightedLine line, *(overview_->getMatchLines()) ) {
-            painter.setOpacity( ( 1.0 / Overview::WeightedLine::WEIGHT_STEPS )
-                   * ( line.weight() + 1 ) );
-            // (allow multiple matches to look 'darker' than a single one.)
-            painter.drawLine( 1 + LINE_MARGIN,
-                    line.position(), width() - LINE_MARGIN - 1, line.position() );
-        }
-
-        // The 'mark' lines
-        painter.setPen( mark_color );
-        foreach (Overview::WeightedLine line, *(overview_->getMarkLines()) ) {
-            painter.setOpacity( ( 1.0 / Overview::WeightedLine::WEIGHT_STEPS )
-                   * ( line.weight() + 1 ) );
-            // (allow multiple matches to look 'darker' than a single one.)
-            painter.drawLine( 1 + LINE_MARGIN,
-                    line.position(), width() - LINE_MARGIN - 1, line.position() );
-        }
-
         // The 'view' lines
-        painter.setOpacity( 1 );
         painter.setPen( palette().color(QPalette::Text) );
         std::pair<int,int> view_lines = overview_->getViewLines();
         painter.drawLine( 1, view_lines.first, width(), view_lines.first );
@@ -233,11 +235,60 @@ void OverviewWidget::mouseMoveEvent( QMouseEvent* mouseEvent )
 
 void OverviewWidget::handleMousePress( int position )
 {
-    int line = overview_->fileLineFromY( position );
+    qint64 line = overview_->fileLineFromY( position );
     LOG(logDEBUG) << "OverviewWidget::handleMousePress y=" << position << " line=" << line;
     emit lineClicked( line );
 }
 
+void OverviewWidget::updateLinesPixmap()
+{
+    static const QColor match_color("red");
+    static const QColor mark_color("dodgerblue");
+
+    const int ratio = devicePixelRatio();
+    const QSize size = this->size() * ratio;
+
+    if ( linesPixmapGeneration_ == overview_->linesGeneration()
+            && linesPixmap_.size() == size )
+        return;
+
+    LOG(logDEBUG) << "OverviewWidget::updateLinesPixmap generation "
+        << overview_->linesGeneration();
+
+    linesPixmap_ = QPixmap( size );
+    linesPixmap_.setDevicePixelRatio( ratio );
+    linesPixmap_.fill( Qt::transparent );
+    linesPixmapGeneration_ = overview_->linesGeneration();
+
+    QPainter painter( &linesPixmap_ );
+
+    // The lines coloured by the filters, under everything else
+    foreach (Overview::ColoredLine line, *(overview_->getFilterLines()) ) {
+        painter.setPen( line.color() );
+        painter.setOpacity( opacityOf( line ) );
+        painter.drawLine( 1 + LINE_MARGIN,
+                line.position(), width() - LINE_MARGIN - 1, line.position() );
+    }
+
+    // The 'match' lines
+    painter.setPen( match_color );
+    foreach (Overview::WeightedLine line, *(overview_->getMatchLines()) ) {
+        painter.setOpacity( opacityOf( line ) );
+        // (the more matches, the 'darker' the line.)
+        painter.drawLine( 1 + LINE_MARGIN,
+                line.position(), width() - LINE_MARGIN - 1, line.position() );
+    }
+
+    // The 'mark' lines
+    painter.setPen( mark_color );
+    foreach (Overview::WeightedLine line, *(overview_->getMarkLines()) ) {
+        painter.setOpacity( opacityOf( line ) );
+        // (the more matches, the 'darker' the line.)
+        painter.drawLine( 1 + LINE_MARGIN,
+                line.position(), width() - LINE_MARGIN - 1, line.position() );
+    }
+}
+
 void OverviewWidget::highlightLine( qint64 line )
 {
     highlightTimer_.stop();
@@ -22,6 +22,7 @@
 
 #include <QWidget>
 #include <QBasicTimer>
+#include <QPixmap>
 
 class Overview;
 
@@ -33,7 +34,8 @@ class OverviewWidget : public QWidget
     OverviewWidget( QWidget* parent = 0 );
 
     // Associate the widget with an Overview object.
-    void setOverview( Overview* overview ) { overview_ = overview; }
+    void setOverview( Overview* overview )
+    { overview_ = overview; linesPixmapGeneration_ = -1; }
 
   public slots:
     // Sent when a match at the line passed must be highlighted in
@@ -49,7 +51,7 @@ class OverviewWidget : public QWidget
 
   signals:
     // Sent when the user click on a line in the Overview.
-    void lineClicked( int line );
+    void lineClicked( qint64 line );
 
   private:
     // Constants
@@ -59,15 +61,24 @@ class OverviewWidget : public QWidget
 
     Overview* overview_;
 
+    // The filter, match and mark lines, drawn once each time the
+    // Overview recalculates them, and painted under the view lines.
+    QPixmap linesPixmap_;
+    // Generation of the Overview lines the pixmap is drawn from
+    // (-1 if it must be redrawn)
+    int linesPixmapGeneration_;
+
     // Highlight:
     // Which line is higlighted, or -1 if none
-    int highlightedLine_;
+    qint64 highlightedLine_;
     // Number of step until the highlight become static
     int highlightedTTL_;
 
     QBasicTimer highlightTimer_;
 
     void handleMousePress( int position );
+    // Redraw linesPixmap_ if the Overview lines or our size have changed.
+    void updateLinesPixmap();
 };
 
 #endif
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "perfcounters.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+std::atomic<qint64> PerfCounters::counters_[NbCounters];
+PerfCounters::HistogramData PerfCounters::histograms_[NbHistograms];
+
+namespace {
+    // Returns the bucket of a duration
+    int bucket( qint64 nanoseconds )
+    {
+        qint64 microseconds = nanoseconds / 1000;
+        int i = 0;
+        while ( microseconds > 0 && i < PerfCounters::nbBuckets - 1 ) {
+            microseconds >>= 1;
+            i++;
+        }
+        return i;
+    }
+
+    double perSecond( qint64 value, qint64 nanoseconds )
+    {
+        return nanoseconds > 0 ? value * 1e9 / nanoseconds : 0.0;
+    }
+}
+
+void PerfCounters::add( Counter counter, qint64 value )
+{
+    counters_[counter].fetch_add( value, std::memory_order_relaxed );
+}
+
+void PerfCounters::record( Histogram histogram, qint64 nanoseconds )
+{
+    HistogramData& data = histograms_[histogram];
+
+    data.count.fetch_add( 1, std::memory_order_relaxed );
+    data.total.fetch_add( nanoseconds, std::memory_order_relaxed );
+    data.buckets[ bucket( nanoseconds ) ].fetch_add( 1, std::memory_order_relaxed );
+
+    qint64 max = data.max.load( std::memory_order_relaxed );
+    while ( nanoseconds > max
+            && ! data.max.compare_exchange_weak( max, nanoseconds,
+                std::memory_order_relaxed ) ) {}
+}
+
+void PerfCounters::reset()
+{
+    for ( auto& counter : counters_ )
+        counter.store( 0, std::memory_order_relaxed );
+
+    for ( auto& data : histograms_ ) {
+        data.count.store( 0, std::memory_order_relaxed );
+        data.total.store( 0, std::memory_order_relaxed );
+        data.max.store( 0, std::memory_order_relaxed );
+        for ( auto& b : data.buckets )
+            b.store( 0, std::memory_order_relaxed );
+    }
+}
+
+const char* PerfCounters::name( Counter counter )
+{
+    static const char* const names[] = {
+        "bytes_indexed", "lines_indexed", "indexing_ns",
+        "block_cache_hits", "block_cache_misses" };
+    return names[counter];
+}
+
+const char* PerfCounters::name( Histogram histogram )
+{
+    static const char* const names[] = {
+        "search_chunk_latency", "paint_time",
+        "data_mutex_wait", "file_mutex_wait" };
+    return names[histogram];
+}
+
+QString PerfCounters::report()
+{
+    const qint64 bytes = counters_[BytesIndexed].load();
+    const qint64 lines = counters_[LinesIndexed].load();
+    const qint64 time = counters_[IndexingTime].load();
+
+    QStringList text;
+    text << QString( "Indexing: %1 bytes, %2 lines in %3 ms "
+            "(%4 MiB/s, %5 lines/s)" )
+        .arg( bytes ).arg( lines ).arg( time / 1000000 )
+        .arg( perSecond( bytes, time ) / ( 1024 * 1024 ), 0, 'f', 1 )
+        .arg( perSecond( lines, time ), 0, 'f', 0 );
+    text << QString( "Block cache: %1 hits, %2 misses" )
+        .arg( counters_[BlockCacheHits].load() )
+        .arg( counters_[BlockCacheMisses].load() );
+
+    for ( int h = 0; h < NbHistograms; h++ ) {
+        const HistogramData& data = histograms_[h];
+        const qint64 count = data.count.load();
+
+        text << "";
+        text << QString( "%1: %2 times, mean %3 us, max %4 us" )
+            .arg( name( static_cast<Histogram>( h ) ) ).arg( count )
+            .arg( count > 0 ? data.total.load() / count / 1000 : 0 )
+            .arg( data.max.load() / 1000 );
+
+        for ( int i = 0; i < nbBuckets; i++ ) {
+            const qint64 nb = data.buckets[i].load();
+            if ( nb == 0 )
+                continue;
+            const QString limit = ( i < nbBuckets - 1 ) ?
+                QString( "< %1 us" ).arg( qint64( 1 ) << i ) :
+                QString( ">= %1 us" ).arg( qint64( 1 ) << ( i - 1 ) );
+            text << QString( "    %1: %2" ).arg( limit, 12 ).arg( nb );
+        }
+    }
+
+    return text.join( "\n" );
+}
+
+QString PerfCounters::toJson()
+{
+    QJsonObject json;
+
+    QJsonObject counters;
+    for ( int c = 0; c < NbCounters; c++ )
+        counters[ name( static_cast<Counter>( c ) ) ] =
+            double( counters_[c].load() );
+    counters[ "indexing_bytes_per_second" ] = perSecond(
+            counters_[BytesIndexed].load(), counters_[IndexingTime].load() );
+    counters[ "indexing_lines_per_second" ] = perSecond(
+            counters_[LinesIndexed].load(), counters_[IndexingTime].load() );
+    json[ "counters" ] = counters;
+
+    QJsonObject histograms;
+    for ( int h = 0; h < NbHistograms; h++ ) {
+        const HistogramData& data = histograms_[h];
+
+        QJsonArray buckets;
+        for ( int i = 0; i < nbBuckets; i++ )
+            buckets.append( double( data.buckets[i].load() ) );
+
+        QJsonObject histogram;
+        histogram[ "count" ] = double( data.count.load() );
+        histogram[ "total_ns" ] = double( data.total.load() );
+        histogram[ "max_ns" ] = double( data.max.load() );
+        histogram[ "buckets_log2_us" ] = buckets;
+        histograms[ name( static_cast<Histogram>( h ) ) ] = histogram;
+    }
+    json[ "histograms" ] = histograms;
+
+    return QString::fromUtf8( QJsonDocument( json ).toJson() );
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <atomic>
+#include <chrono>
+
+#include <QMutex>
+#include <QString>
+
+// Counters and duration histograms of the work glogg does (indexing,
+// searching, painting and waiting for locks), always kept since an
+// update is an atomic addition (and a clock read for the timers).
+// They are shown in the performance counters dialog and returned
+// to the external instances asking for them.
+// All functions are thread safe.
+class PerfCounters
+{
+  public:
+    enum Counter {
+        BytesIndexed,
+        LinesIndexed,
+        IndexingTime,   // nanoseconds
+        // Blocks of the slow sources read from (or missing from) their
+        // BlockCache
+        BlockCacheHits,
+        BlockCacheMisses,
+        NbCounters
+    };
+
+    enum Histogram {
+        SearchChunkLatency,
+        PaintTime,
+        DataMutexWait,
+        FileMutexWait,
+        NbHistograms
+    };
+
+    // Bucket i holds the durations in [2^(i-1), 2^i) µs, the first
+    // one those under 1 µs and the last one all the longer ones.
+    static const int nbBuckets = 24;
+
+    static void add( Counter counter, qint64 value );
+    static void record( Histogram histogram, qint64 nanoseconds );
+    static void reset();
+
+    // Returns the counters and histograms as readable text
+    static QString report();
+    // Returns the counters and histograms as a JSON object
+    static QString toJson();
+
+    static const char* name( Counter counter );
+    static const char* name( Histogram histogram );
+
+  private:
+    struct HistogramData {
+        std::atomic<qint64> count;
+        std::atomic<qint64> total;
+        std::atomic<qint64> max;
+        std::atomic<qint64> buckets[nbBuckets];
+    };
+
+    static std::atomic<qint64> counters_[NbCounters];
+    static HistogramData histograms_[NbHistograms];
+};
+
+// Records in a histogram the time from its construction to its
+// destruction.
+class PerfTimer
+{
+  public:
+    explicit PerfTimer( PerfCounters::Histogram histogram )
+        : histogram_( histogram ), start_( std::chrono::steady_clock::now() ) {}
+    ~PerfTimer() { PerfCounters::record( histogram_, elapsed() ); }
+
+    // Returns the nanoseconds since the construction
+    qint64 elapsed() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_ ).count();
+    }
+
+  private:
+    const PerfCounters::Histogram histogram_;
+    const std::chrono::steady_clock::time_point start_;
+};
+
+// Like QMutexLocker, also recording the time waited for the mutex,
+// when it was not free (taking a free mutex is not timed).
+class PerfMutexLocker
+{
+  public:
+    PerfMutexLocker( QMutex* mutex, PerfCounters::Histogram histogram )
+        : mutex_( mutex )
+    {
+        if ( ! mutex_->tryLock() ) {
+            PerfTimer timer( histogram );
+            mutex_->lock();
+        }
+    }
+    ~PerfMutexLocker() { mutex_->unlock(); }
+
+  private:
+    PerfMutexLocker( const PerfMutexLocker& ) = delete;
+    PerfMutexLocker& operator=( const PerfMutexLocker& ) = delete;
+
+    QMutex* const mutex_;
+};
+
+#endif
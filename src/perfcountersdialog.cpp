@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "perfcountersdialog.h"
+
+#include <QDialogButtonBox>
+#include <QFontDatabase>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include "perfcounters.h"
+
+// Refresh period of the counters shown (ms)
+static const int refreshPeriod = 1000;
+
+PerfCountersDialog::PerfCountersDialog( QWidget* parent ) : QDialog( parent )
+{
+    setWindowTitle( tr( "Performance counters" ) );
+
+    text_ = new QPlainTextEdit( this );
+    text_->setReadOnly( true );
+    text_->setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
+    text_->setMinimumSize( 480, 360 );
+
+    QDialogButtonBox* buttonBox = new QDialogButtonBox(
+            QDialogButtonBox::Close, this );
+    QPushButton* resetButton = buttonBox->addButton(
+            tr( "&Reset" ), QDialogButtonBox::ResetRole );
+    connect( resetButton, SIGNAL( clicked() ), this, SLOT( resetCounters() ) );
+    connect( buttonBox, SIGNAL( rejected() ), this, SLOT( reject() ) );
+
+    QVBoxLayout* layout = new QVBoxLayout( this );
+    layout->addWidget( text_ );
+    layout->addWidget( buttonBox );
+
+    refreshTimer_ = new QTimer( this );
+    connect( refreshTimer_, SIGNAL( timeout() ), this, SLOT( refresh() ) );
+    refreshTimer_->start( refreshPeriod );
+
+    refresh();
+}
+
+void PerfCountersDialog::refresh()
+{
+    text_->setPlainText( PerfCounters::report() );
+}
+
+void PerfCountersDialog::resetCounters()
+{
+    PerfCounters::reset();
+    refresh();
+}
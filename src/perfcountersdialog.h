@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERFCOUNTERSDIALOG_H
+#define PERFCOUNTERSDIALOG_H
+
+#include <QDialog>
+
+class QPlainTextEdit;
+class QTimer;
+
+// Debug panel showing the performance counters (see PerfCounters),
+// refreshed every second while it is open.
+class PerfCountersDialog : public QDialog
+{
+  Q_OBJECT
+
+  public:
+    PerfCountersDialog( QWidget* parent = 0 );
+
+  private slots:
+    // Show the current values of the counters
+    void refresh();
+    // Start counting from zero again
+    void resetCounters();
+
+  private:
+    QPlainTextEdit* text_;
+    QTimer* refreshTimer_;
+};
+
+#endif
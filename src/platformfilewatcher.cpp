@@ -22,18 +22,26 @@
 #include "log.h"
 
 std::shared_ptr<PlatformFileWatcher::PlatformWatchTower> PlatformFileWatcher::watch_tower_;
+std::shared_ptr<FilePoller> PlatformFileWatcher::file_poller_;
 
-PlatformFileWatcher::PlatformFileWatcher() : FileWatcher()
+PlatformFileWatcher::PlatformFileWatcher() : FileWatcher(), poll_id_( -1 )
 {
     // Caution, this is NOT thread-safe or re-entrant!
     if ( !watch_tower_ )
     {
         watch_tower_ = std::make_shared<PlatformWatchTower>();
     }
+
+    if ( !file_poller_ )
+    {
+        file_poller_ = std::make_shared<FilePoller>();
+    }
 }
 
 PlatformFileWatcher::~PlatformFileWatcher()
 {
+    if ( poll_id_ != -1 )
+        file_poller_->removeFile( poll_id_ );
 }
 
 void PlatformFileWatcher::addFile( const QString& fileName )
@@ -45,6 +53,19 @@ void PlatformFileWatcher::addFile( const QString& fileName )
     notification_ = std::make_shared<Registration>(
             watch_tower_->addFile( fileName.toStdString(), [this, fileName] {
                 emit fileChanged( fileName ); } ) );
+
+    if ( poll_id_ != -1 ) {
+        file_poller_->removeFile( poll_id_ );
+        poll_id_ = -1;
+    }
+
+    // The watch tower only sees the changes made from this host
+    if ( FilePoller::isOnNetworkFileSystem( fileName ) ) {
+        LOG(logINFO) << fileName.toStdString()
+            << " is on a network file system, polling it";
+        poll_id_ = file_poller_->addFile( fileName, [this, fileName] {
+                emit fileChanged( fileName ); } );
+    }
 }
 
 void PlatformFileWatcher::removeFile( const QString& fileName )
@@ -52,4 +73,9 @@ void PlatformFileWatcher::removeFile( const QString& fileName )
     LOG(logDEBUG) << "FileWatcher::removeFile " << fileName.toStdString();
 
     notification_ = nullptr;
+
+    if ( poll_id_ != -1 ) {
+        file_poller_->removeFile( poll_id_ );
+        poll_id_ = -1;
+    }
 }
@@ -26,16 +26,22 @@
 
 #ifdef _WIN32
 #  include "winwatchtowerdriver.h"
+#elif defined(GLOGG_SUPPORTS_KQUEUE)
+#  include "kqueuewatchtowerdriver.h"
 #else
 #  include "inotifywatchtowerdriver.h"
 #endif
 
 #include "watchtower.h"
+#include "filepoller.h"
 
 class INotifyWatchTower;
 
-// An implementation of FileWatcher, as an adapter to INotifyWatchTower.
-// This is Linux only, and require a recent version of the kernel.
+// An implementation of FileWatcher, as an adapter to a WatchTower using
+// the platform's driver (inotify on Linux, kqueue on the BSDs and macOS,
+// ReadDirectoryChanges on Windows).
+// Files on network file systems, for which the OS is not notified of
+// changes made by other hosts, are also polled by a FilePoller.
 
 // Please note that due to the implementation of the constructor
 // this class is not thread safe and shall always be used from the main UI thread.
@@ -61,6 +67,12 @@ using PlatformWatchTower = WatchTower<WinWatchTowerDriver>;
 #  else
 typedef WatchTower<WinWatchTowerDriver> PlatformWatchTower;
 #  endif
+#elif defined(GLOGG_SUPPORTS_KQUEUE)
+#  ifdef HAS_TEMPLATE_ALIASES
+using PlatformWatchTower = WatchTower<KQueueWatchTowerDriver>;
+#  else
+typedef WatchTower<KQueueWatchTowerDriver> PlatformWatchTower;
+#  endif
 #else
 #  ifdef HAS_TEMPLATE_ALIASES
 using PlatformWatchTower = WatchTower<INotifyWatchTowerDriver>;
@@ -75,7 +87,12 @@ typedef WatchTower<INotifyWatchTowerDriver> PlatformWatchTower;
     // Reference to the (unique) watchtower.
     static std::shared_ptr<PlatformWatchTower> watch_tower_;
 
+    // Reference to the (unique) poller, for the network files.
+    static std::shared_ptr<FilePoller> file_poller_;
+
     std::shared_ptr<Registration> notification_;
+    // Id in the poller (-1 if not polled)
+    int poll_id_;
 };
 
 #endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements PollingSchedule
+
+#include "pollingschedule.h"
+
+#include <algorithm>
+#include <limits>
+
+PollingSchedule::PollingSchedule( int minInterval, int maxInterval,
+        int maxPollsPerSecond )
+    : minInterval_( minInterval ), maxInterval_( maxInterval ),
+    maxPollsPerSecond_( maxPollsPerSecond ), entries_(), nextId_( 0 ),
+    budgetStart_( 0 ), nbPolls_( 0 )
+{
+}
+
+int PollingSchedule::add( int64_t now )
+{
+    const int id = nextId_++;
+    entries_[id] = { minInterval_, now };
+
+    return id;
+}
+
+void PollingSchedule::remove( int id )
+{
+    entries_.erase( id );
+}
+
+std::vector<int> PollingSchedule::takeDue( int64_t now )
+{
+    if ( now - budgetStart_ >= 1000 ) {
+        budgetStart_ = now;
+        nbPolls_ = 0;
+    }
+
+    std::vector<std::pair<int64_t, int>> due;
+    for ( const auto& entry : entries_ ) {
+        if ( entry.second.due <= now )
+            due.push_back( { entry.second.due, entry.first } );
+    }
+
+    const size_t budget = maxPollsPerSecond_ - nbPolls_;
+    if ( due.size() > budget ) {
+        std::partial_sort( due.begin(), due.begin() + budget, due.end() );
+        due.resize( budget );
+    }
+    else {
+        std::sort( due.begin(), due.end() );
+    }
+
+    std::vector<int> ids;
+    for ( const auto& file : due ) {
+        ids.push_back( file.second );
+        // Not due again until polled
+        entries_[file.second].due = std::numeric_limits<int64_t>::max();
+    }
+    nbPolls_ += ids.size();
+
+    return ids;
+}
+
+void PollingSchedule::polled( int id, bool changed, int64_t now )
+{
+    auto entry = entries_.find( id );
+    if ( entry == entries_.end() )
+        return;
+
+    entry->second.interval = changed ? minInterval_ :
+        std::min( entry->second.interval * 2, maxInterval_ );
+    entry->second.due = now + entry->second.interval;
+}
+
+int64_t PollingSchedule::nextDue() const
+{
+    if ( entries_.empty() )
+        return -1;
+
+    int64_t next = std::numeric_limits<int64_t>::max();
+    for ( const auto& entry : entries_ )
+        next = std::min( next, entry.second.due );
+
+    // Nothing more until the next second once the budget is spent
+    if ( nbPolls_ >= maxPollsPerSecond_ )
+        next = std::max( next, budgetStart_ + 1000 );
+
+    return ( next == std::numeric_limits<int64_t>::max() ) ? -1 : next;
+}
+
+int PollingSchedule::interval( int id ) const
+{
+    auto entry = entries_.find( id );
+
+    return ( entry != entries_.end() ) ? entry->second.interval : -1;
+}
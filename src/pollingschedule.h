@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POLLINGSCHEDULE_H
+#define POLLINGSCHEDULE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Decides when each of a set of files is to be polled (stat-ed) for
+// changes: a file that has just changed is polled again after the
+// minimum interval, the interval doubling each time it is found
+// unchanged, up to the maximum interval.
+// At most maxPollsPerSecond files are polled in any second, the files
+// left over being polled first the next second.
+// Times are in milliseconds, from any origin.
+class PollingSchedule
+{
+  public:
+    PollingSchedule( int minInterval = 250, int maxInterval = 8000,
+            int maxPollsPerSecond = 20 );
+
+    // Add a file to poll from now on, returns its id
+    int add( int64_t now );
+    // Stop polling the file
+    void remove( int id );
+
+    // Returns the files to poll now, most overdue first, within the
+    // budget left for the current second.
+    std::vector<int> takeDue( int64_t now );
+    // Record that the file has been polled, and whether it had changed
+    void polled( int id, bool changed, int64_t now );
+
+    // Returns when the next file is to be polled (-1 if none)
+    int64_t nextDue() const;
+    // Returns the current polling interval of the file
+    int interval( int id ) const;
+
+  private:
+    struct Entry {
+        int interval;
+        int64_t due;
+    };
+
+    const int minInterval_;
+    const int maxInterval_;
+    const int maxPollsPerSecond_;
+
+    std::unordered_map<int, Entry> entries_;
+    int nextId_;
+
+    // Start of the current second and polls done during it
+    int64_t budgetStart_;
+    int nbPolls_;
+};
+
+#endif
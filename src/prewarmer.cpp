@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements Prewarmer.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include <QFileInfo>
+
+#include "log.h"
+
+#include "data/logdata.h"
+#include "data/indexcache.h"
+#include "data/taskscheduler.h"
+#include "data/pipespooler.h"
+#include "data/remotefile.h"
+#include "prewarmer.h"
+
+Prewarmer::Prewarmer( const QStringList& fileNames )
+    : QObject(), fileNames_( fileNames ), currentFile_(), logData_()
+{
+}
+
+Prewarmer::~Prewarmer()
+{
+    if ( logData_ )
+        logData_->interruptLoading();
+}
+
+void Prewarmer::start()
+{
+    LOG(logDEBUG) << "Prewarmer: indexing " << fileNames_.size() << " files";
+
+    prewarmNext();
+}
+
+void Prewarmer::skip( const QString& fileName )
+{
+    const QString file_name = QFileInfo( fileName ).absoluteFilePath();
+    fileNames_.removeAll( file_name );
+
+    // (the next file is attached once the loading is interrupted)
+    if ( file_name == currentFile_ && logData_ )
+        logData_->interruptLoading();
+}
+
+QStringList Prewarmer::filesToPrewarm( const QStringList& recentFiles,
+        int nbFiles )
+{
+    QStringList files;
+    for ( const QString& file_name : recentFiles.mid( 0, nbFiles ) ) {
+        if ( PipeSpooler::isPipe( file_name )
+                || RemoteFile::isRemote( file_name ) )
+            continue;
+
+        const QFileInfo info( file_name );
+        if ( info.isFile() && info.isReadable()
+                && info.size() >= IndexCache::minimumFileSize )
+            files << info.absoluteFilePath();
+    }
+
+    return files;
+}
+
+void Prewarmer::lowerProcessPriority()
+{
+#if defined( _WIN32 )
+    // Both the I/O and the CPU
+    SetPriorityClass( GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN );
+#else
+#if defined( __linux__ ) && defined( SYS_ioprio_set )
+    // IOPRIO_WHO_PROCESS, IOPRIO_CLASS_IDLE (not in the libc headers)
+    const int who_process = 1;
+    const int class_idle = 3 << 13;
+    if ( syscall( SYS_ioprio_set, who_process, 0, class_idle ) != 0 )
+        LOG(logWARNING) << "Cannot lower the I/O priority";
+#elif defined( __APPLE__ ) && defined( IOPOL_TYPE_DISK )
+    setiopolicy_np( IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE );
+#endif
+    if ( setpriority( PRIO_PROCESS, 0, 19 ) != 0 )
+        LOG(logWARNING) << "Cannot lower the priority";
+#endif
+}
+
+void Prewarmer::loadingFinished( LoadingStatus status )
+{
+    LOG(logDEBUG) << "Prewarmer: " << currentFile_.toStdString()
+        << ( status == LoadingStatus::Successful ?
+                " indexed" : " not indexed" );
+
+    // (deleted once out of its signal)
+    logData_.release()->deleteLater();
+    currentFile_.clear();
+
+    prewarmNext();
+}
+
+void Prewarmer::prewarmNext()
+{
+    if ( fileNames_.isEmpty() ) {
+        emit finished();
+        return;
+    }
+
+    currentFile_ = fileNames_.takeFirst();
+
+    logData_.reset( new LogData() );
+    connect( logData_.get(), SIGNAL( loadingFinished( LoadingStatus ) ),
+            this, SLOT( loadingFinished( LoadingStatus ) ) );
+    logData_->setPriority( TaskScheduler::Background );
+    logData_->attachFile( currentFile_ );
+}
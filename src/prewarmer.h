@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREWARMER_H
+#define PREWARMER_H
+
+#include <memory>
+
+#include <QObject>
+#include <QStringList>
+
+#include "loadingstatus.h"
+
+class LogData;
+
+// Indexes files in the background, one at a time, so their index is
+// in the IndexCache (checked, or completed if they have grown) when
+// they are opened: the big files opened every day (the recent ones)
+// then open at once, their data being also in the system's cache.
+// Each file is attached in turn to a LogData of Background priority,
+// whose tasks give way to those of the files displayed.
+class Prewarmer : public QObject
+{
+  Q_OBJECT
+
+  public:
+    Prewarmer( const QStringList& fileNames );
+    // Interrupts the indexing in progress
+    ~Prewarmer();
+
+    // Start indexing the files
+    void start();
+    // Do not index the passed file (e.g. it is being opened), the
+    // indexing of it being interrupted if in progress
+    void skip( const QString& fileName );
+
+    // Returns which of the nbFiles most recent files are worth
+    // indexing: the local files big enough for their index to be cached
+    static QStringList filesToPrewarm( const QStringList& recentFiles,
+            int nbFiles );
+    // Lower the I/O and CPU priorities of the process, for a prewarm
+    // run without a window (e.g. from cron)
+    static void lowerProcessPriority();
+
+  signals:
+    // Sent when all the files have been indexed
+    void finished();
+
+  private slots:
+    void loadingFinished( LoadingStatus status );
+
+  private:
+    // Attach the next file, or send finished() if none is left
+    void prewarmNext();
+
+    QStringList fileNames_;
+    // The file being indexed (empty if none) and its data
+    QString currentFile_;
+    std::unique_ptr<LogData> logData_;
+};
+
+#endif
@@ -23,8 +23,6 @@
 // Search is started just after the selection and the selection is updated
 // if a match is found.
 
-#include <QApplication>
-
 #include "log.h"
 #include "quickfindpattern.h"
 #include "selection.h"
@@ -32,27 +30,19 @@
 
 #include "quickfind.h"
 
-void SearchingNotifier::reset()
-{
-    dotToDisplay_ = 0;
-    startTime_ = QTime::currentTime();
-}
+namespace {
 
-void SearchingNotifier::sendNotification( qint64 current_line, qint64 nb_lines )
+// Number of matches found in advance in each direction
+const int nbPrefetchedMatches = 8;
+
+bool operator==( const FilePosition& left, const FilePosition& right )
 {
-    LOG( logDEBUG ) << "Emitting Searching....";
-    qint64 progress;
-    if ( current_line < 0 )
-        progress = ( nb_lines + current_line ) * 100 / nb_lines;
-    else
-        progress = current_line * 100 / nb_lines;
-    emit notify( QFNotificationProgress( progress ) );
+    return left.line() == right.line() && left.column() == right.column();
+}
 
-    QApplication::processEvents( QEventLoop::ExcludeUserInputEvents );
-    startTime_ = QTime::currentTime().addMSecs( -800 );
 }
 
-void QuickFind::LastMatchPosition::set( int line, int column )
+void QuickFind::LastMatchPosition::set( qint64 line, int column )
 {
     if ( ( line_ == -1 ) ||
             ( ( line <= line_ ) && ( column < column_ ) ) )
@@ -67,7 +57,7 @@ void QuickFind::LastMatchPosition::set( const FilePosition &position )
     set( position.line(), position.column() );
 }
 
-bool QuickFind::LastMatchPosition::isLater( int line, int column ) const
+bool QuickFind::LastMatchPosition::isLater( qint64 line, int column ) const
 {
     if ( line_ == -1 )
         return false;
@@ -84,7 +74,7 @@ bool QuickFind::LastMatchPosition::isLater( const FilePosition &position ) const
     return isLater( position.line(), position.column() );
 }
 
-bool QuickFind::LastMatchPosition::isSooner( int line, int column ) const
+bool QuickFind::LastMatchPosition::isSooner( qint64 line, int column ) const
 {
     if ( line_ == -1 )
         return false;
@@ -101,16 +91,125 @@ bool QuickFind::LastMatchPosition::isSooner( const FilePosition &position ) cons
     return isSooner( position.line(), position.column() );
 }
 
+FilePosition QuickFind::IncrementalSearchStatus::resumePosition() const
+{
+    if ( searchedRegExp_.isEmpty() )
+        return position_;
+
+    if ( ongoing_ == Forward ) {
+        if ( noMatchUntil_ <= position_.line() )
+            return position_;
+        else
+            return FilePosition( noMatchUntil_, 0 );
+    }
+    else {
+        // The start line of a backward search is skipped at column 0
+        if ( noMatchUntil_ >= position_.line() )
+            return position_;
+        else
+            return FilePosition( noMatchUntil_ + 1, 0 );
+    }
+}
+
+QuickFind::Prefetch::Prefetch( const AbstractLogData* logData, bool forward )
+    : forward_( forward ), worker_( logData ), regexp_(), matches_(),
+    origin_(), end_(), complete_( false )
+{
+}
+
+void QuickFind::Prefetch::startFrom( const QRegExp& regexp,
+        const FilePosition& position )
+{
+    if ( position == origin_ && regexp == regexp_ ) {
+        topUp();
+        return;
+    }
+
+    LOG( logDEBUG ) << "QuickFind: prefetching from line " << position.line();
+
+    worker_.cancel();
+    matches_.clear();
+    regexp_ = regexp;
+    origin_ = position;
+    end_ = position;
+    complete_ = false;
+    worker_.search( regexp_, end_, forward_, nbPrefetchedMatches );
+}
+
+bool QuickFind::Prefetch::take( const FilePosition& position, Match* match )
+{
+    if ( matches_.empty() || ! ( position == origin_ ) )
+        return false;
+
+    *match = matches_.front();
+    matches_.pop_front();
+    origin_ = positionAfter( *match );
+
+    return true;
+}
+
+void QuickFind::Prefetch::clear()
+{
+    worker_.cancel();
+    matches_.clear();
+    origin_ = FilePosition();
+    end_ = FilePosition();
+    complete_ = false;
+}
+
+void QuickFind::Prefetch::add( const Match& match )
+{
+    matches_.push_back( match );
+    end_ = positionAfter( match );
+}
+
+void QuickFind::Prefetch::finished( bool complete )
+{
+    complete_ = complete;
+}
+
+FilePosition QuickFind::Prefetch::positionAfter( const Match& match ) const
+{
+    if ( forward_ )
+        return FilePosition( match.line, match.endColumn + 1 );
+    else
+        return FilePosition( match.line, qMax( match.startColumn - 1, 0 ) );
+}
+
+void QuickFind::Prefetch::topUp()
+{
+    const int missing = nbPrefetchedMatches - matches_.size();
+
+    if ( ! complete_ && ! worker_.isSearching()
+            && missing > nbPrefetchedMatches / 2 )
+        worker_.search( regexp_, end_, forward_, missing );
+}
+
 QuickFind::QuickFind( const AbstractLogData* const logData,
         Selection* selection,
         const QuickFindPattern* const quickFindPattern ) :
     logData_( logData ), selection_( selection ),
     quickFindPattern_( quickFindPattern ),
-    lastMatch_(), firstMatch_(), searchingNotifier_(),
-    incrementalSearchStatus_()
+    lastMatch_(), firstMatch_(),
+    incrementalSearchStatus_(), worker_( logData ),
+    searchDirection_( None ), searchRegExp_(), noMatchPosition_(),
+    prefetchAhead_( logData, true ), prefetchBehind_( logData, false )
 {
-    connect( &searchingNotifier_, SIGNAL( notify( const QFNotification& ) ),
-            this, SIGNAL( notify( const QFNotification& ) ) );
+    connect( &worker_, SIGNAL( searchProgressed( int ) ),
+            this, SLOT( handleSearchProgressed( int ) ) );
+    connect( &worker_, SIGNAL( matchFound( qint64, int, int ) ),
+            this, SLOT( handleMatchFound( qint64, int, int ) ) );
+    connect( &worker_, SIGNAL( searchFinished( bool ) ),
+            this, SLOT( handleSearchFinished( bool ) ) );
+
+    connect( prefetchAhead_.worker(), SIGNAL( matchFound( qint64, int, int ) ),
+            this, SLOT( handleMatchPrefetchedAhead( qint64, int, int ) ) );
+    connect( prefetchAhead_.worker(), SIGNAL( searchFinished( bool ) ),
+            this, SLOT( handlePrefetchAheadFinished( bool ) ) );
+    connect( prefetchBehind_.worker(), SIGNAL( matchFound( qint64, int, int ) ),
+            this, SLOT( handleMatchPrefetchedBehind( qint64, int, int ) ) );
+    connect( prefetchBehind_.worker(), SIGNAL( searchFinished( bool ) ),
+            this, SLOT( handlePrefetchBehindFinished( bool ) ) );
 }
 
 void QuickFind::incrementalSearchStop()
@@ -129,13 +228,16 @@ void QuickFind::incrementalSearchStop()
 void QuickFind::incrementalSearchAbort()
 {
     if ( incrementalSearchStatus_.isOngoing() ) {
+        worker_.cancel();
+        searchDirection_ = None;
+
         // We reset the selection to what it was
         *selection_ = incrementalSearchStatus_.initialSelection();
         incrementalSearchStatus_ = IncrementalSearchStatus();
     }
 }
 
-qint64 QuickFind::incrementallySearchForward()
+void QuickFind::incrementallySearchForward()
 {
     LOG( logDEBUG ) << "QuickFind::incrementallySearchForward";
 
@@ -144,9 +246,18 @@ qint64 QuickFind::incrementallySearchForward()
 
     if ( incrementalSearchStatus_.direction() == Forward ) {
         // An incremental search is active, we restart the search
-        // from the initial point
-        LOG( logDEBUG ) << "Restart search from initial point";
-        start_position = incrementalSearchStatus_.position();
+        // from the initial point, or from where the previous pattern
+        // has been searched for if the new one can only match there.
+        recordIncrementalProgress();
+        if ( quickFindPattern_->isRefinementOf(
+                    incrementalSearchStatus_.searchedRegExp() ) ) {
+            LOG( logDEBUG ) << "Restart search from the previous pattern";
+            start_position = incrementalSearchStatus_.resumePosition();
+        }
+        else {
+            LOG( logDEBUG ) << "Restart search from initial point";
+            start_position = incrementalSearchStatus_.position();
+        }
     }
     else {
         // It's a new search so we search from the selection
@@ -156,22 +267,10 @@ qint64 QuickFind::incrementallySearchForward()
                 *selection_ );
     }
 
-    qint64 line_found = doSearchForward( start_position );
-
-    if ( line_found >= 0 ) {
-        // We have found a result...
-        // ... the caller will jump to this line.
-        return line_found;
-    }
-    else {
-        // No result...
-        // ... we want the client to show the initial line.
-        selection_->clear();
-        return incrementalSearchStatus_.position().line();
-    }
+    doSearchForward( start_position );
 }
 
-qint64 QuickFind::incrementallySearchBackward()
+void QuickFind::incrementallySearchBackward()
 {
     LOG( logDEBUG ) << "QuickFind::incrementallySearchBackward";
 
@@ -180,9 +279,18 @@ qint64 QuickFind::incrementallySearchBackward()
 
     if ( incrementalSearchStatus_.direction() == Backward ) {
         // An incremental search is active, we restart the search
-        // from the initial point
-        LOG( logDEBUG ) << "Restart search from initial point";
-        start_position = incrementalSearchStatus_.position();
+        // from the initial point, or from where the previous pattern
+        // has been searched for if the new one can only match there.
+        recordIncrementalProgress();
+        if ( quickFindPattern_->isRefinementOf(
+                    incrementalSearchStatus_.searchedRegExp() ) ) {
+            LOG( logDEBUG ) << "Restart search from the previous pattern";
+            start_position = incrementalSearchStatus_.resumePosition();
+        }
+        else {
+            LOG( logDEBUG ) << "Restart search from initial point";
+            start_position = incrementalSearchStatus_.position();
+        }
     }
     else {
         // It's a new search so we search from the selection
@@ -192,183 +300,236 @@ qint64 QuickFind::incrementallySearchBackward()
                 *selection_ );
     }
 
-    qint64 line_found = doSearchBackward( start_position );
-
-    if ( line_found >= 0 ) {
-        // We have found a result...
-        // ... the caller will jump to this line.
-        return line_found;
-    }
-    else {
-        // No result...
-        // ... we want the client to show the initial line.
-        selection_->clear();
-        return incrementalSearchStatus_.position().line();
-    }
+    doSearchBackward( start_position );
 }
 
-qint64 QuickFind::searchForward()
+void QuickFind::searchForward()
 {
     incrementalSearchStatus_ = IncrementalSearchStatus();
 
     // Position where we start the search from
     FilePosition start_position = selection_->getNextPosition();
 
-    return doSearchForward( start_position );
+    Match match;
+    if ( quickFindPattern_->isActive()
+            && prefetchAhead_.take( start_position, &match ) ) {
+        LOG( logDEBUG ) << "QuickFind: match prefetched at line " << match.line;
+        worker_.cancel();
+        searchDirection_ = None;
+        showMatch( match );
+        return;
+    }
+
+    doSearchForward( start_position );
 }
 
 
-qint64 QuickFind::searchBackward()
+void QuickFind::searchBackward()
 {
     incrementalSearchStatus_ = IncrementalSearchStatus();
 
     // Position where we start the search from
     FilePosition start_position = selection_->getPreviousPosition();
 
-    return doSearchBackward( start_position );
+    Match match;
+    if ( quickFindPattern_->isActive()
+            && prefetchBehind_.take( start_position, &match ) ) {
+        LOG( logDEBUG ) << "QuickFind: match prefetched at line " << match.line;
+        worker_.cancel();
+        searchDirection_ = None;
+        showMatch( match );
+        return;
+    }
+
+    doSearchBackward( start_position );
 }
 
 // Internal implementation of forward search,
-// returns the line where the pattern is found or -1 if not found.
-// Parameters are the position the search shall start
-qint64 QuickFind::doSearchForward( const FilePosition &start_position )
+// starts the search from the passed position.
+void QuickFind::doSearchForward( const FilePosition &start_position )
 {
-    bool found = false;
-    int found_start_col;
-    int found_end_col;
+    worker_.cancel();
+    searchDirection_ = None;
 
-    if ( ! quickFindPattern_->isActive() )
-        return -1;
+    if ( ! quickFindPattern_->isActive() ) {
+        restoreIncrementalPosition();
+        return;
+    }
 
     // Optimisation: if we are already after the last match,
     // we don't do any search at all.
     if ( lastMatch_.isLater( start_position ) ) {
         // Send a notification
         emit notify( QFNotificationReachedEndOfFile() );
+        restoreIncrementalPosition();
 
-        return -1;
-    }
-
-    qint64 line = start_position.line();
-    LOG( logDEBUG ) << "Start searching at line " << line;
-    // We look at the rest of the first line
-    if ( quickFindPattern_->isLineMatching(
-                logData_->getExpandedLineString( line ),
-                start_position.column() ) ) {
-        quickFindPattern_->getLastMatch( &found_start_col, &found_end_col );
-        found = true;
+        return;
     }
-    else {
-        searchingNotifier_.reset();
-        // And then the rest of the file
-        qint64 nb_lines = logData_->getNbLine();
-        line++;
-        while ( line < nb_lines ) {
-            if ( quickFindPattern_->isLineMatching(
-                        logData_->getExpandedLineString( line ) ) ) {
-                quickFindPattern_->getLastMatch(
-                        &found_start_col, &found_end_col );
-                found = true;
-                break;
-            }
-            line++;
-
-            // See if we need to notify of the ongoing search
-            searchingNotifier_.ping( line, nb_lines );
-        }
-    }
-
-    if ( found ) {
-        selection_->selectPortion(
-                line, found_start_col, found_end_col );
-
-        // Clear any notification
-        emit clearNotification();
-
-        return line;
-    }
-    else {
-        // Update the position of the last match
-        FilePosition last_match_position = selection_->getPreviousPosition();
-        lastMatch_.set( last_match_position );
 
-        // Send a notification
-        emit notify( QFNotificationReachedEndOfFile() );
+    LOG( logDEBUG ) << "Start searching at line " << start_position.line();
 
-        return -1;
-    }
+    searchDirection_ = Forward;
+    searchRegExp_ = quickFindPattern_->getRegExp();
+    noMatchPosition_ = selection_->getPreviousPosition();
+    worker_.search( searchRegExp_, start_position, true );
 }
 
 // Internal implementation of backward search,
-// returns the line where the pattern is found or -1 if not found.
-// Parameters are the position the search shall start
-qint64 QuickFind::doSearchBackward( const FilePosition &start_position )
+// starts the search from the passed position.
+void QuickFind::doSearchBackward( const FilePosition &start_position )
 {
-    bool found = false;
-    int start_col;
-    int end_col;
+    worker_.cancel();
+    searchDirection_ = None;
 
-    if ( ! quickFindPattern_->isActive() )
-        return -1;
+    if ( ! quickFindPattern_->isActive() ) {
+        restoreIncrementalPosition();
+        return;
+    }
 
     // Optimisation: if we are already before the first match,
     // we don't do any search at all.
     if ( firstMatch_.isSooner( start_position ) ) {
         // Send a notification
         emit notify( QFNotificationReachedBegininningOfFile() );
+        restoreIncrementalPosition();
 
-        return -1;
+        return;
     }
 
-    qint64 line = start_position.line();
-    LOG( logDEBUG ) << "Start searching at line " << line;
-    // We look at the beginning of the first line
-    if (    ( start_position.column() > 0 )
-         && ( quickFindPattern_->isLineMatchingBackward(
-                 logData_->getExpandedLineString( line ),
-                 start_position.column() ) )
-       ) {
-        quickFindPattern_->getLastMatch( &start_col, &end_col );
-        found = true;
-    }
-    else {
-        searchingNotifier_.reset();
-        // And then the rest of the file
-        qint64 nb_lines = logData_->getNbLine();
-        line--;
-        while ( line >= 0 ) {
-            if ( quickFindPattern_->isLineMatchingBackward(
-                        logData_->getExpandedLineString( line ) ) ) {
-                quickFindPattern_->getLastMatch( &start_col, &end_col );
-                found = true;
-                break;
-            }
-            line--;
-
-            // See if we need to notify of the ongoing search
-            searchingNotifier_.ping( -line, nb_lines );
+    LOG( logDEBUG ) << "Start searching at line " << start_position.line();
+
+    searchDirection_ = Backward;
+    searchRegExp_ = quickFindPattern_->getRegExp();
+    noMatchPosition_ = selection_->getNextPosition();
+    worker_.search( searchRegExp_, start_position, false );
+}
+
+//
+// Slots
+//
+
+void QuickFind::handleSearchProgressed( int percent )
+{
+    emit notify( QFNotificationProgress( percent ) );
+}
+
+void QuickFind::handleMatchFound( qint64 line, int start_col, int end_col )
+{
+    searchDirection_ = None;
+
+    if ( incrementalSearchStatus_.isOngoing() )
+        incrementalSearchStatus_.setNoMatchUntil( searchRegExp_, line );
+
+    const Match match = { line, start_col, end_col };
+    showMatch( match );
+}
+
+void QuickFind::handleSearchFinished( bool )
+{
+    const QFDirection direction = searchDirection_;
+    searchDirection_ = None;
+
+    // Nothing found?
+    if ( direction != None ) {
+        if ( incrementalSearchStatus_.isOngoing() )
+            incrementalSearchStatus_.setNoMatchUntil( searchRegExp_,
+                    direction == Forward ? logData_->getNbLine() : -1 );
+
+        if ( direction == Forward ) {
+            // Update the position of the last match
+            lastMatch_.set( noMatchPosition_ );
+
+            // Send a notification
+            emit notify( QFNotificationReachedEndOfFile() );
         }
+        else {
+            // Update the position of the first match
+            firstMatch_.set( noMatchPosition_ );
+
+            // Send a notification
+            LOG( logDEBUG ) << "QF: Send BOF notification.";
+            emit notify( QFNotificationReachedBegininningOfFile() );
+        }
+
+        restoreIncrementalPosition();
     }
+}
 
-    if ( found )
-    {
-        selection_->selectPortion( line, start_col, end_col );
+void QuickFind::handleMatchPrefetchedAhead( qint64 line,
+        int start_col, int end_col )
+{
+    const Match match = { line, start_col, end_col };
+    prefetchAhead_.add( match );
+}
 
-        // Clear any notification
-        emit clearNotification();
+void QuickFind::handleMatchPrefetchedBehind( qint64 line,
+        int start_col, int end_col )
+{
+    const Match match = { line, start_col, end_col };
+    prefetchBehind_.add( match );
+}
 
-        return line;
-    }
-    else {
-        // Update the position of the first match
-        FilePosition first_match_position = selection_->getNextPosition();
-        firstMatch_.set( first_match_position );
+void QuickFind::handlePrefetchAheadFinished( bool complete )
+{
+    prefetchAhead_.finished( complete );
+}
 
-        // Send a notification
-        LOG( logDEBUG ) << "QF: Send BOF notification.";
-        emit notify( QFNotificationReachedBegininningOfFile() );
+void QuickFind::handlePrefetchBehindFinished( bool complete )
+{
+    prefetchBehind_.finished( complete );
+}
+
+//
+// Private functions
+//
+
+void QuickFind::showMatch( const Match& match )
+{
+    selection_->selectPortion( match.line, match.startColumn, match.endColumn );
+
+    // Clear any notification
+    emit clearNotification();
 
-        return -1;
+    // The matches around are not needed while the pattern is typed
+    if ( ! incrementalSearchStatus_.isOngoing() )
+        prefetchAround( match );
+
+    // The caller will jump to this line.
+    emit searchDone( match.line );
+}
+
+void QuickFind::prefetchAround( const Match& match )
+{
+    // Searching from other threads only
+    if ( ! logData_->isThreadSafe() )
+        return;
+
+    const QRegExp regexp = quickFindPattern_->getRegExp();
+
+    // Where the next searches will start from (see Selection)
+    prefetchAhead_.startFrom( regexp,
+            FilePosition( match.line, match.endColumn + 1 ) );
+    prefetchBehind_.startFrom( regexp,
+            FilePosition( match.line, qMax( match.startColumn - 1, 0 ) ) );
+}
+
+void QuickFind::recordIncrementalProgress()
+{
+    // Only the search in progress is not recorded yet
+    if ( searchDirection_ != None
+            && searchDirection_ == incrementalSearchStatus_.direction() )
+        incrementalSearchStatus_.setNoMatchUntil( searchRegExp_,
+                worker_.reachedLine() );
+}
+
+// Called when nothing has been found
+void QuickFind::restoreIncrementalPosition()
+{
+    if ( incrementalSearchStatus_.isOngoing() ) {
+        // No result...
+        // ... we want the client to show the initial line.
+        selection_->clear();
+        emit searchDone( incrementalSearchStatus_.position().line() );
     }
 }
 
@@ -376,4 +537,7 @@ void QuickFind::resetLimits()
 {
     lastMatch_.reset();
     firstMatch_.reset();
+
+    prefetchAhead_.clear();
+    prefetchBehind_.clear();
 }
@@ -20,55 +20,29 @@
 #ifndef QUICKFIND_H
 #define QUICKFIND_H
 
+#include <deque>
+
 #include <QObject>
 #include <QPoint>
-#include <QTime>
+#include <QRegExp>
 
 #include "utils.h"
 #include "qfnotifications.h"
 #include "selection.h"
+#include "quickfindworker.h"
 
 class QuickFindPattern;
 class AbstractLogData;
 class Portion;
 
-// Handle "long processing" notifications to the UI.
-// reset() shall be called at the beginning of the search
-// and then ping() should be called periodically during the processing.
-// The notify() signal should be forwarded to the UI.
-class SearchingNotifier : public QObject
-{
-  Q_OBJECT
-
-  public:
-    SearchingNotifier() {};
-
-    // Reset internal timers at the beiginning of the processing
-    void reset();
-    // Shall be called frequently during processing, send the notification
-    // and call the event loop when appropriate.
-    // Pass the current line number and total number of line so that
-    // a progress percentage is calculated and displayed.
-    // (line shall be negative if ging in reverse)
-    inline void ping( qint64 line, qint64 nb_lines ) {
-        if ( startTime_.msecsTo( QTime::currentTime() ) > 1000 )
-            sendNotification( line, nb_lines );
-    }
-
-  signals:
-    // Sent when the UI shall display a message to the user.
-    void notify( const QFNotification& message );
-
-  private:
-    void sendNotification( qint64 current_line, qint64 nb_lines );
-
-    QTime startTime_;
-    int dotToDisplay_;
-};
-
 // Represents a search made with Quick Find (without its results)
 // it keeps a pointer to a set of data and to a QuickFindPattern which
 // are used for the searches. (the caller retains ownership of both).
+// The searches are asynchronous (see QuickFindWorker), searchDone()
+// being sent when they are finished.
+// When the data can be searched from other threads, the next matches
+// ahead and behind the last one found are searched for in advance,
+// so repeated searches (n/N) are answered at once.
 class QuickFind : public QObject
 {
   Q_OBJECT
@@ -82,12 +56,11 @@ class QuickFind : public QObject
     void setSearchStartPoint( QPoint startPoint );
 
     // Used for incremental searches
-    // Return the first occurence of the passed pattern from the starting
-    // point.  These searches don't use the QFP and don't change the
-    // starting point.
-    // TODO Update comment
-    qint64 incrementallySearchForward();
-    qint64 incrementallySearchBackward();
+    // Search the first occurence of the pattern from the point the
+    // incremental search started at, the view being sent back to this
+    // point if there is none.
+    void incrementallySearchForward();
+    void incrementallySearchBackward();
 
     // Stop the currently ongoing incremental search, leave the selection
     // where it is if a match has been found, restore the old one
@@ -99,20 +72,14 @@ class QuickFind : public QObject
     // position/selection
     void incrementalSearchAbort();
 
-    // Used for 'repeated' (n/N) QF searches using the current direction
-    // Return the line of the first occurence of the QFP and
-    // update the selection. It returns -1 if nothing is found.
-    /*
-    int searchNext();
-    int searchPrevious();
-    */
-
-    // Idem but ignore the direction and always search in the
-    // specified direction
-    qint64 searchForward();
-    qint64 searchBackward();
+    // Used for 'repeated' (n/N) QF searches
+    // Search the next occurence of the QFP in the specified direction
+    // and update the selection if one is found.
+    void searchForward();
+    void searchBackward();
 
-    // Make the object forget the 'no more match' flag.
+    // Make the object forget the 'no more match' flag
+    // and the matches found in advance.
     void resetLimits();
 
   signals:
@@ -120,6 +87,18 @@ class QuickFind : public QObject
     void notify( const QFNotification& message );
     // Sent when the UI shall clear the notification.
     void clearNotification();
+    // Sent when a search is finished, with the line the view shall
+    // display (-1 if it shall stay where it is).
+    void searchDone( qint64 line );
+
+  private slots:
+    void handleSearchProgressed( int percent );
+    void handleMatchFound( qint64 line, int startColumn, int endColumn );
+    void handleSearchFinished( bool complete );
+    void handleMatchPrefetchedAhead( qint64 line, int startColumn, int endColumn );
+    void handleMatchPrefetchedBehind( qint64 line, int startColumn, int endColumn );
+    void handlePrefetchAheadFinished( bool complete );
+    void handlePrefetchBehindFinished( bool complete );
 
   private:
     enum QFDirection {
@@ -131,18 +110,18 @@ class QuickFind : public QObject
     class LastMatchPosition {
       public:
         LastMatchPosition() : line_( -1 ), column_( -1 ) {}
-        void set( int line, int column );
+        void set( qint64 line, int column );
         void set( const FilePosition& position );
         void reset() { line_ = -1; column_ = -1; }
         // Does the passed position come after the recorded one
-        bool isLater( int line, int column ) const;
+        bool isLater( qint64 line, int column ) const;
         bool isLater( const FilePosition& position ) const;
         // Does the passed position come before the recorded one
-        bool isSooner( int line, int column ) const;
+        bool isSooner( qint64 line, int column ) const;
         bool isSooner( const FilePosition& position ) const;
 
       private:
-        int line_;
+        qint64 line_;
         int column_;
     };
 
@@ -150,23 +129,83 @@ class QuickFind : public QObject
       public:
         /* Constructors */
         IncrementalSearchStatus() :
-            ongoing_( None ), position_(), initialSelection_() {}
+            ongoing_( None ), position_(), initialSelection_(),
+            searchedRegExp_(), noMatchUntil_( -1 ) {}
         IncrementalSearchStatus(
                 QFDirection direction,
                 const FilePosition& position,
                 const Selection& initial_selection ) :
             ongoing_( direction ),
             position_( position ),
-            initialSelection_( initial_selection ) {}
+            initialSelection_( initial_selection ),
+            searchedRegExp_(), noMatchUntil_( -1 ) {}
 
         bool isOngoing() const { return ( ongoing_ != None ); }
         QFDirection direction() const { return ongoing_; }
         FilePosition position() const { return position_; }
         Selection initialSelection() const { return initialSelection_; }
+
+        // Record that the passed regexp has no match between the
+        // position and the passed line (excluded).
+        void setNoMatchUntil( const QRegExp& regexp, qint64 line )
+        { searchedRegExp_ = regexp; noMatchUntil_ = line; }
+        QRegExp searchedRegExp() const { return searchedRegExp_; }
+        // Returns the position a search for a pattern matching only
+        // where searchedRegExp() does can start from.
+        FilePosition resumePosition() const;
       private:
         QFDirection ongoing_;
         FilePosition position_;
         Selection initialSelection_;
+        // What is known from the previous keystroke's search
+        QRegExp searchedRegExp_;
+        qint64 noMatchUntil_;
+    };
+
+    struct Match {
+        qint64 line;
+        int startColumn;
+        int endColumn;
+    };
+
+    // The next matches in one direction, in the order repeated
+    // searches would find them, found by a worker of its own.
+    class Prefetch {
+      public:
+        Prefetch( const AbstractLogData* logData, bool forward );
+
+        QuickFindWorker* worker() { return &worker_; }
+
+        // Make sure the matches from the passed position are being
+        // found, keeping the ones found already if they start there.
+        void startFrom( const QRegExp& regexp, const FilePosition& position );
+        // If the match a search from the passed position would find is
+        // known, remove it from the queue and return true.
+        bool take( const FilePosition& position, Match* match );
+        // Forget everything and stop the worker
+        void clear();
+
+        // Called when the worker reports
+        void add( const Match& match );
+        void finished( bool complete );
+
+      private:
+        // Position the search for the next match starts from once
+        // the passed match is selected (see Selection)
+        FilePosition positionAfter( const Match& match ) const;
+        // Restart the worker if the queue is getting short
+        void topUp();
+
+        const bool forward_;
+        QuickFindWorker worker_;
+        QRegExp regexp_;
+        std::deque<Match> matches_;
+        // Where the first match queued has been searched from
+        FilePosition origin_;
+        // Where the match after the last one queued is searched from
+        FilePosition end_;
+        // Set once the end (start) of the data has been reached
+        bool complete_;
     };
 
     // Pointers to external objects
@@ -181,14 +220,32 @@ class QuickFind : public QObject
     LastMatchPosition lastMatch_;
     LastMatchPosition firstMatch_;
 
-    SearchingNotifier searchingNotifier_;
-
     // Incremental search status
     IncrementalSearchStatus incrementalSearchStatus_;
 
+    // Search in progress
+    QuickFindWorker worker_;
+    QFDirection searchDirection_;
+    QRegExp searchRegExp_;
+    // Limit to record if nothing is found
+    FilePosition noMatchPosition_;
+
+    // Matches found in advance
+    Prefetch prefetchAhead_;
+    Prefetch prefetchBehind_;
+
     // Private functions
-    qint64 doSearchForward( const FilePosition &start_position );
-    qint64 doSearchBackward( const FilePosition &start_position );
+    void doSearchForward( const FilePosition &start_position );
+    void doSearchBackward( const FilePosition &start_position );
+    // Select the passed match and show it
+    void showMatch( const Match& match );
+    // Find in advance the matches around the one selected
+    void prefetchAround( const Match& match );
+    // Record how far the incremental search has gone without a match
+    // before it is restarted for the new pattern
+    void recordIncrementalProgress();
+    // Show the point the incremental search started at (if one is ongoing)
+    void restoreIncrementalPosition();
 };
 
 #endif
@@ -27,7 +27,8 @@
 #include "persistentinfo.h"
 #include "configuration.h"
 
-QuickFindPattern::QuickFindPattern() : QObject(), regexp_()
+QuickFindPattern::QuickFindPattern() : QObject(), regexp_(), compiled_(),
+    generation_( 0 )
 {
     active_ = false;
 }
@@ -50,12 +51,15 @@ void QuickFindPattern::changeSearchPattern( const QString& pattern )
 
     regexp_.setPattern( pattern );
     regexp_.setPatternSyntax( syntax );
+    compiled_ = CompiledRegExp( regexp_ );
 
     if ( regexp_.isValid() && ( ! regexp_.isEmpty() ) )
         active_ = true;
     else
         active_ = false;
 
+    generation_++;
+
     emit patternUpdated();
 }
 
@@ -66,6 +70,42 @@ void QuickFindPattern::changeSearchPattern( const QString& pattern, bool ignoreC
     changeSearchPattern( pattern );
 }
 
+bool QuickFindPattern::isRefinementOf( const QRegExp& previous ) const
+{
+    if ( ( ! active_ ) || previous.isEmpty()
+            || previous.patternSyntax() != regexp_.patternSyntax()
+            || previous.caseSensitivity() != regexp_.caseSensitivity() )
+        return false;
+
+    const QString previousText = previous.pattern();
+    const QString text = regexp_.pattern();
+
+    if ( regexp_.patternSyntax() == QRegExp::FixedString )
+        return text.contains( previousText );
+
+    // The previous pattern must be plain text
+    const QString specials = ( regexp_.patternSyntax() == QRegExp::Wildcard ) ?
+        "*?[]\\" : "\\^$.*+?()[]{}|";
+    for ( const QChar c : previousText ) {
+        if ( specials.contains( c ) )
+            return false;
+    }
+
+    if ( ! text.startsWith( previousText ) )
+        return false;
+
+    // The characters added must not change the meaning of the
+    // previous ones (quantifier or alternative).
+    if ( regexp_.patternSyntax() != QRegExp::Wildcard ) {
+        const QString added = text.mid( previousText.length() );
+        if ( ( ! added.isEmpty() && QString( "*+?{" ).contains( added[0] ) )
+                || added.contains( '|' ) )
+            return false;
+    }
+
+    return true;
+}
+
 bool QuickFindPattern::matchLine( const QString& line,
         QList<QuickFindMatch>& matches ) const
 {
@@ -73,8 +113,8 @@ bool QuickFindPattern::matchLine( const QString& line,
 
     if ( active_ ) {
         int pos = 0;
-        while ( ( pos = regexp_.indexIn( line, pos ) ) != -1 ) {
-            int length = regexp_.matchedLength();
+        int length = 0;
+        while ( ( pos = compiled_.indexIn( line, pos, &length ) ) != -1 ) {
             matches << QuickFindMatch( pos, length );
             pos += length;
         }
@@ -83,15 +123,17 @@ bool QuickFindPattern::matchLine( const QString& line,
     return ( matches.count() > 0 );
 }
 
-bool QuickFindPattern::isLineMatching( const QString& line, int column ) const
+bool QuickFindPattern::isLineMatching( const QString& line, int column,
+        int* start_col, int* end_col ) const
 {
     int pos = 0;
 
     if ( ! active_ )
         return false;
-    if ( ( pos = regexp_.indexIn( line, column ) ) != -1 ) {
-        lastMatchStart_ = pos;
-        lastMatchEnd_   = pos + regexp_.matchedLength() - 1;
+    int length = 0;
+    if ( ( pos = compiled_.indexIn( line, column, &length ) ) != -1 ) {
+        *start_col = pos;
+        *end_col   = pos + length - 1;
 
         return true;
     }
@@ -99,25 +141,20 @@ bool QuickFindPattern::isLineMatching( const QString& line, int column ) const
         return false;
 }
 
-bool QuickFindPattern::isLineMatchingBackward(
-        const QString& line, int column ) const
+bool QuickFindPattern::isLineMatchingBackward( const QString& line,
+        int column, int* start_col, int* end_col ) const
 {
     int pos = 0;
 
     if ( ! active_ )
         return false;
-    if ( ( pos = regexp_.lastIndexIn( line, column ) ) != -1 ) {
-        lastMatchStart_ = pos;
-        lastMatchEnd_   = pos + regexp_.matchedLength() - 1;
+    int length = 0;
+    if ( ( pos = compiled_.lastIndexIn( line, column, &length ) ) != -1 ) {
+        *start_col = pos;
+        *end_col   = pos + length - 1;
 
         return true;
     }
     else
         return false;
 }
-
-void QuickFindPattern::getLastMatch( int* start_col, int* end_col ) const
-{
-    *start_col = lastMatchStart_;
-    *end_col   = lastMatchEnd_;
-}
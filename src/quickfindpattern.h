@@ -25,6 +25,8 @@
 #include <QRegExp>
 #include <QList>
 
+#include "data/compiledregexp.h"
+
 // Represents a match result for QuickFind
 class QuickFindMatch
 {
@@ -42,6 +44,9 @@ class QuickFindMatch
     int length_;
 };
 
+// (stored in the QList itself, not one allocation per match)
+Q_DECLARE_TYPEINFO( QuickFindMatch, Q_PRIMITIVE_TYPE );
+
 // Represents a search pattern for QuickFind (without its results)
 class QuickFindPattern : public QObject
 {
@@ -60,9 +65,18 @@ class QuickFindPattern : public QObject
 
     // Returns whether the search is active (i.e. valid and non empty regexp)
     bool isActive() const { return active_; }
+    // Returns a number changed each time the pattern is changed
+    int generation() const { return generation_; }
 
     // Return the text of the regex
     QString getPattern() const { return regexp_.pattern(); }
+    // Return the regex itself (to be copied in the thread using it)
+    QRegExp getRegExp() const { return regexp_; }
+
+    // Returns whether the pattern is known to match only lines the
+    // passed (previous) one matches too, i.e. it is the same plain
+    // text with characters added.
+    bool isRefinementOf( const QRegExp& previous ) const;
 
     // Returns whether the passed line match the quick find search.
     // If so, it populate the passed list with the list of matches
@@ -71,16 +85,14 @@ class QuickFindPattern : public QObject
             QList<QuickFindMatch>& matches ) const;
 
     // Returns whether there is a match in the passed line, starting at
-    // the passed column.
-    // Results are stored internally.
-    bool isLineMatching( const QString& line, int column = 0 ) const;
+    // the passed column, setting start_col and end_col to the position
+    // of the first one found if so.
+    bool isLineMatching( const QString& line, int column,
+            int* start_col, int* end_col ) const;
 
     // Same as isLineMatching but search backward
-    bool isLineMatchingBackward( const QString& line, int column = -1 ) const;
-
-    // Must be called when isLineMatching returns 'true', returns
-    // the position of the first match found.
-    void getLastMatch( int* start_col, int* end_col ) const;
+    bool isLineMatchingBackward( const QString& line, int column,
+            int* start_col, int* end_col ) const;
 
   signals:
     // Sent when the pattern is changed
@@ -89,9 +101,9 @@ class QuickFindPattern : public QObject
   private:
     bool active_;
     QRegExp regexp_;
-
-    mutable int lastMatchStart_;
-    mutable int lastMatchEnd_;
+    // The regexp_ as matched on the lines
+    CompiledRegExp compiled_;
+    int generation_;
 };
 
 #endif
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements QuickFindWorker.
+
+#include "log.h"
+#include "data/abstractlogdata.h"
+
+#include "quickfindworker.h"
+
+namespace {
+
+// Number of lines read at once by the thread
+const int nbLinesPerBlock = 5000;
+// Number of lines searched on each pass of the event loop
+// (when the data are not thread safe)
+const int nbLinesPerTimedBlock = 1000;
+
+// Delay before the first progress report and between the next ones
+const int firstProgressDelay = 1000;
+const int progressDelay = 200;
+
+}
+
+QuickFindWorker::Search::Search( int id, const QRegExp& regexp,
+        const FilePosition& start, bool forward, int maxMatches,
+        qint64 nbLines )
+    : id( id ), regexp( regexp ), forward( forward ), maxMatches( maxMatches ),
+    startLine( start.line() ), startColumn( start.column() ),
+    line( start.line() ), nbLines( nbLines ), lastProgress(),
+    matches(), nbMatches( 0 ), done( false ), complete( false ), lines()
+{
+    // Delay the first report
+    lastProgress = QTime::currentTime().addMSecs(
+            progressDelay - firstProgressDelay );
+}
+
+QuickFindWorker::QuickFindWorker( const AbstractLogData* logData )
+    : QThread(), logData_( logData ),
+    threaded_( logData && logData->isThreadSafe() ),
+    mutex_(), searchRequestedCond_(), terminate_( false ),
+    currentId_( 0 ), requested_(), searching_( false ), reachedLine_( -1 ),
+    timedSearch_(), timer_()
+{
+    // Results from the thread are queued to our (owner's) thread
+    connect( this, SIGNAL( blockSearched( int, qint64, int ) ),
+            this, SLOT( handleBlockSearched( int, qint64, int ) ) );
+    connect( this, SIGNAL( matchSearched( int, qint64, int, int ) ),
+            this, SLOT( handleMatchSearched( int, qint64, int, int ) ) );
+    connect( this, SIGNAL( searchEnded( int, bool ) ),
+            this, SLOT( handleSearchEnded( int, bool ) ) );
+
+    timer_.setInterval( 0 );
+    connect( &timer_, SIGNAL( timeout() ), this, SLOT( searchNextBlock() ) );
+
+    if ( threaded_ )
+        start();
+}
+
+QuickFindWorker::~QuickFindWorker()
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        terminate_ = true;
+        currentId_++;
+        searchRequestedCond_.wakeAll();
+    }
+    wait();
+}
+
+void QuickFindWorker::search( const QRegExp& regexp,
+        const FilePosition& start, bool forward, int maxMatches )
+{
+    LOG(logDEBUG) << "QuickFindWorker::search from line " << start.line();
+
+    QMutexLocker locker( &mutex_ );
+
+    currentId_++;
+    Search* search = new Search( currentId_, regexp, start, forward,
+            maxMatches, logData_->getNbLine() );
+    searching_ = true;
+    reachedLine_ = start.line();
+
+    if ( threaded_ ) {
+        requested_.reset( search );
+        searchRequestedCond_.wakeAll();
+    }
+    else {
+        timedSearch_.reset( search );
+        timer_.start();
+    }
+}
+
+void QuickFindWorker::cancel()
+{
+    QMutexLocker locker( &mutex_ );
+
+    currentId_++;
+    requested_.reset();
+    timedSearch_.reset();
+    timer_.stop();
+    searching_ = false;
+}
+
+bool QuickFindWorker::isSearching() const
+{
+    return searching_;
+}
+
+qint64 QuickFindWorker::reachedLine() const
+{
+    return reachedLine_;
+}
+
+// This is the thread's main loop
+void QuickFindWorker::run()
+{
+    QMutexLocker locker( &mutex_ );
+
+    forever {
+        while ( ( ! terminate_ ) && ( ! requested_ ) )
+            searchRequestedCond_.wait( &mutex_ );
+
+        if ( terminate_ )
+            return;
+
+        std::unique_ptr<Search> search = std::move( requested_ );
+        locker.unlock();
+
+        bool cancelled = false;
+        while ( ! search->done && ! cancelled ) {
+            searchBlock( search.get(), nbLinesPerBlock );
+
+            for ( const Match& match : search->matches )
+                emit matchSearched( search->id, match.line,
+                        match.startColumn, match.endColumn );
+            search->matches.clear();
+
+            // Reported on each block for reachedLine()
+            emit blockSearched( search->id, search->line,
+                    progressToReport( search.get() ) );
+
+            QMutexLocker idLocker( &mutex_ );
+            cancelled = ( search->id != currentId_ );
+        }
+
+        if ( ! cancelled )
+            emit searchEnded( search->id, search->complete );
+
+        locker.relock();
+    }
+}
+
+//
+// Slots
+//
+
+void QuickFindWorker::searchNextBlock()
+{
+    if ( ! timedSearch_ ) {
+        timer_.stop();
+        return;
+    }
+
+    searchBlock( timedSearch_.get(), nbLinesPerTimedBlock );
+
+    // Released first as a new search can be started from the slots
+    std::unique_ptr<Search> search = std::move( timedSearch_ );
+
+    const int id = search->id;
+    for ( const Match& match : search->matches ) {
+        handleMatchSearched( id, match.line, match.startColumn, match.endColumn );
+        // Cancelled by the receivers?
+        if ( id != currentId_ )
+            return;
+    }
+    search->matches.clear();
+
+    if ( search->done ) {
+        timer_.stop();
+        handleSearchEnded( id, search->complete );
+    }
+    else {
+        reachedLine_ = search->line;
+
+        const int percent = progressToReport( search.get() );
+        if ( percent >= 0 )
+            emit searchProgressed( percent );
+        timedSearch_ = std::move( search );
+    }
+}
+
+void QuickFindWorker::handleBlockSearched( int id, qint64 line, int percent )
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        if ( id != currentId_ )
+            return;
+    }
+
+    reachedLine_ = line;
+
+    if ( percent >= 0 )
+        emit searchProgressed( percent );
+}
+
+void QuickFindWorker::handleMatchSearched( int id, qint64 line,
+        int startColumn, int endColumn )
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        if ( id != currentId_ )
+            return;
+    }
+
+    LOG(logDEBUG) << "QuickFindWorker: match found, line " << line;
+
+    emit matchFound( line, startColumn, endColumn );
+}
+
+void QuickFindWorker::handleSearchEnded( int id, bool complete )
+{
+    {
+        QMutexLocker locker( &mutex_ );
+        if ( id != currentId_ )
+            return;
+        searching_ = false;
+    }
+
+    emit searchFinished( complete );
+}
+
+//
+// Private functions
+//
+
+// Called from the searching thread (or the event loop),
+// only uses the search passed and the (thread safe) data.
+void QuickFindWorker::searchBlock( Search* search, int nbLines ) const
+{
+    // Record the match and restart from where QuickFind would
+    // search for the next one (see Selection).
+    auto found = [search] ( qint64 line, int position, int length ) {
+        const Match match = { line, position, position + length - 1 };
+        search->matches.push_back( match );
+
+        if ( ++search->nbMatches >= search->maxMatches ) {
+            search->done = true;
+        }
+        else {
+            search->startLine = line;
+            search->line = line;
+            search->startColumn = search->forward ?
+                match.endColumn + 1 : qMax( match.startColumn - 1, 0 );
+        }
+    };
+
+    if ( search->forward ) {
+        const qint64 first = search->line;
+        const int number = qMin<qint64>( nbLines, search->nbLines - first );
+        if ( number <= 0 ) {
+            search->done = true;
+            search->complete = true;
+            return;
+        }
+
+        LineBuffer& lines = search->lines;
+        logData_->getExpandedLinesForScan( first, number, &lines );
+        for ( int i = 0; i < lines.size(); i++ ) {
+            const qint64 line = first + i;
+            // Only the rest of the first line is searched
+            const int column = ( line == search->startLine ) ? search->startColumn : 0;
+            int length = 0;
+            const int position = search->regexp.indexIn(
+                    lines.rawString( i ), column, &length );
+            if ( position != -1 ) {
+                found( line, position, length );
+                return;
+            }
+        }
+
+        search->line = first + number;
+        if ( search->line >= search->nbLines )
+            search->done = search->complete = true;
+    }
+    else {
+        // Lines are read by blocks ending at search->line
+        const qint64 last = qMin( search->line, search->nbLines - 1 );
+        if ( last < 0 ) {
+            search->done = true;
+            search->complete = true;
+            return;
+        }
+        const qint64 first = qMax<qint64>( last - nbLines + 1, 0 );
+
+        LineBuffer& lines = search->lines;
+        logData_->getExpandedLinesForScan( first, last - first + 1, &lines );
+        for ( int i = lines.size() - 1; i >= 0; i-- ) {
+            const qint64 line = first + i;
+            int position;
+            int length = 0;
+            if ( line == search->startLine ) {
+                // Only the beginning of the first line is searched
+                if ( search->startColumn <= 0 )
+                    continue;
+                position = search->regexp.lastIndexIn(
+                        lines.rawString( i ), search->startColumn, &length );
+            }
+            else {
+                position = search->regexp.lastIndexIn(
+                        lines.rawString( i ), -1, &length );
+            }
+
+            if ( position != -1 ) {
+                found( line, position, length );
+                return;
+            }
+        }
+
+        search->line = first - 1;
+        if ( search->line < 0 )
+            search->done = search->complete = true;
+    }
+}
+
+int QuickFindWorker::progressToReport( Search* search )
+{
+    if ( search->done || search->nbLines == 0
+            || search->lastProgress.msecsTo( QTime::currentTime() ) < progressDelay )
+        return -1;
+
+    search->lastProgress = QTime::currentTime();
+
+    // Position in the file
+    if ( search->forward )
+        return search->line * 100 / search->nbLines;
+    else
+        return ( search->nbLines - search->line ) * 100 / search->nbLines;
+}
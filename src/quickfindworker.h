@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QUICKFINDWORKER_H
+#define QUICKFINDWORKER_H
+
+#include <memory>
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QRegExp>
+#include <QTimer>
+#include <QTime>
+
+#include "utils.h"
+#include "data/linebuffer.h"
+#include "data/compiledregexp.h"
+
+class AbstractLogData;
+
+// Looks for the next (or previous) match of a QuickFind regexp in a set
+// of data, reading the lines by blocks, without blocking the UI.
+// If the data can be read from any thread (see
+// AbstractLogData::isThreadSafe()) the search is done by a thread of its
+// own, else it is done a block at a time from the event loop.
+// A search can go on after the first match to find the next ones
+// (see QuickFind's prefetching).
+// Only the last search started is reported, starting a new one (or
+// calling cancel()) cancelling the one in progress.
+// Everything except run() is in the owner's thread.
+class QuickFindWorker : public QThread
+{
+  Q_OBJECT
+
+  public:
+    QuickFindWorker( const AbstractLogData* logData );
+    ~QuickFindWorker();
+
+    // Start searching from the passed position, forward (from the
+    // column) or backward (before the column, the start line being
+    // skipped if the column is 0).
+    // After each match, the search goes on from the position a
+    // QuickFind search would start from if this match was selected,
+    // until maxMatches matches have been found.
+    void search( const QRegExp& regexp, const FilePosition& start,
+            bool forward, int maxMatches = 1 );
+    // Cancel the search in progress (nothing is reported for it)
+    void cancel();
+    // Returns whether a search is in progress
+    bool isSearching() const;
+    // Returns the next line the last search started will search (as
+    // far as the owner's thread knows), there is no match between the
+    // start of the search and this line, unless a match has been
+    // reported already.
+    qint64 reachedLine() const;
+
+  signals:
+    // Sent regularly during a long search
+    void searchProgressed( int percent );
+    // Sent for each match, in the order they are found
+    void matchFound( qint64 line, int startColumn, int endColumn );
+    // Sent when the search is done (after its last match, if any),
+    // complete being true if the end of the data has been reached.
+    void searchFinished( bool complete );
+
+    // Internal signals sent by the searching thread
+    void blockSearched( int id, qint64 line, int percent );
+    void matchSearched( int id, qint64 line, int startColumn, int endColumn );
+    void searchEnded( int id, bool complete );
+
+  protected:
+    void run();
+
+  private slots:
+    // Search the next block from the event loop
+    void searchNextBlock();
+    void handleBlockSearched( int id, qint64 line, int percent );
+    void handleMatchSearched( int id, qint64 line, int startColumn, int endColumn );
+    void handleSearchEnded( int id, bool complete );
+
+  private:
+    struct Match {
+        qint64 line;
+        int startColumn;
+        int endColumn;
+    };
+
+    struct Search {
+        Search( int id, const QRegExp& regexp, const FilePosition& start,
+                bool forward, int maxMatches, qint64 nbLines );
+
+        int id;
+        // (sharing its compiled pattern with the views, see CompiledRegExp)
+        CompiledRegExp regexp;
+        bool forward;
+        int maxMatches;
+        // Where the search (re)started
+        qint64 startLine;
+        int startColumn;
+        // Next line to search
+        qint64 line;
+        qint64 nbLines;
+        // When the last progress was reported
+        QTime lastProgress;
+
+        // Matches not reported yet
+        std::vector<Match> matches;
+        int nbMatches;
+        // Set when the search is done
+        bool done;
+        // Set if the end of the data has been reached
+        bool complete;
+        // The lines of the block searched, reused from one block to the next
+        LineBuffer lines;
+    };
+
+    // Search the next block of nbLines lines of the passed search,
+    // stopping at the first match found, setting done if it is finished.
+    void searchBlock( Search* search, int nbLines ) const;
+    // Returns the progress to report, or -1 if it is not time yet
+    static int progressToReport( Search* search );
+
+    const AbstractLogData* logData_;
+    const bool threaded_;
+
+    // Protects the members below
+    mutable QMutex mutex_;
+    QWaitCondition searchRequestedCond_;
+    bool terminate_;
+    // Id of the search to report (incremented on each search or cancel)
+    int currentId_;
+    // Search for the thread to start
+    std::unique_ptr<Search> requested_;
+    bool searching_;
+    qint64 reachedLine_;
+
+    // Search done from the event loop
+    std::unique_ptr<Search> timedSearch_;
+    QTimer timer_;
+};
+
+#endif
@@ -23,10 +23,15 @@
 // There are three types of selection, only one type might be active
 // at any time.
 
+#include <QBuffer>
+#include <QIODevice>
+
 #include "selection.h"
 
 #include "data/abstractlogdata.h"
 
+const int Selection::writtenLinesPerBlock = 10000;
+
 Selection::Selection()
 {
     selectedLine_ = -1;
@@ -39,7 +44,7 @@ Selection::Selection()
     selectedRange_.endLine   = 0;
 }
 
-void Selection::selectPortion( int line, int start_column, int end_column )
+void Selection::selectPortion( qint64 line, int start_column, int end_column )
 {
     // First unselect any whole line or range
     selectedLine_ = -1;
@@ -50,7 +55,7 @@ void Selection::selectPortion( int line, int start_column, int end_column )
     selectedPartial_.endColumn   = qMax ( start_column, end_column );
 }
 
-void Selection::selectRange( int start_line, int end_line )
+void Selection::selectRange( qint64 start_line, qint64 end_line )
 {
     // First unselect any whole line and portion
     selectedLine_ = -1;
@@ -62,9 +67,9 @@ void Selection::selectRange( int start_line, int end_line )
     selectedRange_.firstLine = start_line;
 }
 
-void Selection::selectRangeFromPrevious( int line )
+void Selection::selectRangeFromPrevious( qint64 line )
 {
-    int previous_line;
+    qint64 previous_line;
 
     if ( selectedLine_ >= 0 )
         previous_line = selectedLine_;
@@ -78,7 +83,7 @@ void Selection::selectRangeFromPrevious( int line )
     selectRange( previous_line, line );
 }
 
-void Selection::crop( int last_line )
+void Selection::crop( qint64 last_line )
 {
     if ( selectedLine_ > last_line )
         selectedLine_ = -1;
@@ -93,7 +98,7 @@ void Selection::crop( int last_line )
         selectedRange_.startLine = last_line;
 };
 
-bool Selection::getPortionForLine( int line, int* start_column, int* end_column ) const
+bool Selection::getPortionForLine( qint64 line, int* start_column, int* end_column ) const
 {
     if ( selectedPartial_.line == line ) {
         *start_column = selectedPartial_.startColumn;
@@ -106,7 +111,7 @@ bool Selection::getPortionForLine( int line, int* start_column, int* end_column
     }
 }
 
-bool Selection::isLineSelected( int line ) const
+bool Selection::isLineSelected( qint64 line ) const
 {
     if ( line == selectedLine_ )
         return true;
@@ -122,20 +127,23 @@ qint64 Selection::selectedLine() const
     return selectedLine_;
 }
 
-QList<int> Selection::getLines() const
+bool Selection::getLineRange( qint64* first_line, qint64* last_line ) const
 {
-    QList<int> selection;
-
-    if ( selectedLine_ >= 0 )
-        selection.append( selectedLine_ );
-    else if ( selectedPartial_.line >= 0 )
-        selection.append( selectedPartial_.line );
-    else if ( selectedRange_.startLine >= 0 )
-        for ( int i = selectedRange_.startLine;
-                i <= selectedRange_.endLine; i++ )
-            selection.append( i );
+    if ( selectedLine_ >= 0 ) {
+        *first_line = *last_line = selectedLine_;
+    }
+    else if ( selectedPartial_.line >= 0 ) {
+        *first_line = *last_line = selectedPartial_.line;
+    }
+    else if ( selectedRange_.startLine >= 0 ) {
+        *first_line = selectedRange_.startLine;
+        *last_line  = selectedRange_.endLine;
+    }
+    else {
+        return false;
+    }
 
-    return selection;
+    return true;
 }
 
 // The tab behaviour is a bit odd at the moment, full lines are not expanded
@@ -161,6 +169,36 @@ QString Selection::getSelectedText( const AbstractLogData* logData ) const
     return text;
 }
 
+bool Selection::writeSelectedText( const AbstractLogData* logData,
+        QIODevice* device ) const
+{
+    if ( selectedRange_.startLine >= 0 && selectedLine_ < 0
+            && selectedPartial_.line < 0 )
+        return writeLines( logData, selectedRange_.startLine,
+                selectedRange_.endLine, device );
+
+    // A line at most
+    return device->write( getSelectedText( logData ).toUtf8() ) >= 0;
+}
+
+bool Selection::writeLines( const AbstractLogData* logData,
+        qint64 first_line, qint64 last_line, QIODevice* device )
+{
+    for ( qint64 first = first_line; first <= last_line;
+            first += writtenLinesPerBlock ) {
+        const int number = qMin<qint64>( writtenLinesPerBlock,
+                last_line - first + 1 );
+        QByteArray block = logData->getLines( first, number ).join( "\n" ).toUtf8();
+        if ( first + number <= last_line )
+            block.append( '\n' );
+
+        if ( device->write( block ) != block.size() )
+            return false;
+    }
+
+    return true;
+}
+
 FilePosition Selection::getNextPosition() const
 {
     qint64 line = 0;
@@ -198,3 +236,36 @@ FilePosition Selection::getPreviousPosition() const
 
     return FilePosition( line, column );
 }
+
+SelectionMimeData::SelectionMimeData( const AbstractLogData* logData,
+        const Selection& selection )
+    : QMimeData(), logData_( logData ), selection_( selection )
+{
+}
+
+QStringList SelectionMimeData::formats() const
+{
+    return QStringList() << "text/plain";
+}
+
+bool SelectionMimeData::hasFormat( const QString& mimetype ) const
+{
+    return mimetype == "text/plain";
+}
+
+// Rendered again for each paste, not to keep a copy of the text.
+QVariant SelectionMimeData::retrieveData( const QString& mimetype,
+        QVariant::Type type ) const
+{
+    if ( mimetype != "text/plain" || ! logData_ )
+        return QVariant();
+
+    QBuffer buffer;
+    buffer.open( QIODevice::WriteOnly );
+    selection_.writeSelectedText( logData_, &buffer );
+
+    if ( type == QVariant::String )
+        return QString::fromUtf8( buffer.data() );
+    else
+        return buffer.data();
+}
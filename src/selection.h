@@ -22,6 +22,10 @@
 
 #include <QList>
 #include <QString>
+#include <QMimeData>
+#include <QPointer>
+
+class QIODevice;
 
 #include "utils.h"
 
@@ -31,17 +35,17 @@ class Portion
 {
   public:
     Portion() { line_ = -1; }
-    Portion( int line, int start_column, int end_column )
+    Portion( qint64 line, int start_column, int end_column )
     { line_ = line; startColumn_ = start_column; endColumn_ = end_column; }
 
-    int line() const { return line_; }
+    qint64 line() const { return line_; }
     int startColumn() const { return startColumn_; }
     int endColumn() const { return endColumn_; }
 
     bool isValid() const { return ( line_ != -1 ); }
 
   private:
-    int line_;
+    qint64 line_;
     int startColumn_;
     int endColumn_;
 };
@@ -57,23 +61,23 @@ class Selection
     void clear() { selectedPartial_.line = -1; selectedLine_ = -1; };
 
     // Select one line
-    void selectLine( int line )
+    void selectLine( qint64 line )
       { selectedPartial_.line = -1; selectedRange_.startLine = -1;
         selectedLine_ = line; };
     // Select a portion of line (both start and end included)
-    void selectPortion( int line, int start_column, int end_column );
+    void selectPortion( qint64 line, int start_column, int end_column );
     void selectPortion( Portion selection )
       { selectPortion( selection.line(), selection.startColumn(),
               selection.endColumn() ); }
     // Select a range of lines (both start and end included)
-    void selectRange( int start_line, int end_line );
+    void selectRange( qint64 start_line, qint64 end_line );
 
     // Select a range from the previously selected line or beginning
     // of range (shift+click behaviour)
-    void selectRangeFromPrevious( int line );
+    void selectRangeFromPrevious( qint64 line );
 
     // Crop selection so that in fit in the range ending with the line passed.
-    void crop( int last_line );
+    void crop( qint64 last_line );
 
     // Returns whether the selection is empty
     bool isEmpty() const
@@ -87,19 +91,28 @@ class Selection
 
     // Returns whether a portion is selected or not on the passed line.
     // If so, returns the portion position.
-    bool getPortionForLine( int line,
+    bool getPortionForLine( qint64 line,
             int* start_column, int* end_column ) const;
-    // Get a list of selected line(s), in order.
-    QList<int> getLines() const;
+    // Returns the first and last lines selected (entirely or not),
+    // false if there are none.
+    bool getLineRange( qint64* first_line, qint64* last_line ) const;
 
     // Returns wether the line passed is selected (entirely).
-    bool isLineSelected( int line ) const;
+    bool isLineSelected( qint64 line ) const;
 
     // Returns the line selected or -1 if not a single line selection
     qint64 selectedLine() const;
 
     // Returns the text selected from the passed AbstractLogData
     QString getSelectedText( const AbstractLogData* logData ) const;
+    // Write the text selected to the device as UTF-8, the lines being
+    // read by blocks so the memory used does not depend on the size
+    // of the selection. Returns false if the device cannot be written.
+    bool writeSelectedText( const AbstractLogData* logData,
+            QIODevice* device ) const;
+    // Idem for the passed lines (all existing), first and last included
+    static bool writeLines( const AbstractLogData* logData,
+            qint64 first_line, qint64 last_line, QIODevice* device );
 
     // Return the position immediately after the current selection
     // (used for searches).
@@ -111,22 +124,47 @@ class Selection
 
   private:
     // Line number currently selected, or -1 if none selected
-    int selectedLine_;
+    qint64 selectedLine_;
 
     struct SelectedPartial {
-        int line;
+        qint64 line;
         int startColumn;
         int endColumn;
     };
     struct SelectedRange {
         // The limits of the range, sorted
-        int startLine;
-        int endLine;
+        qint64 startLine;
+        qint64 endLine;
         // The line selected first, used for shift+click
-        int firstLine;
+        qint64 firstLine;
     };
     struct SelectedPartial selectedPartial_;
     struct SelectedRange selectedRange_;
+
+    // Number of lines read at once by writeLines()
+    static const int writtenLinesPerBlock;
+};
+
+// The text of a selection for the clipboard, only read from the
+// AbstractLogData when it is pasted (the lines being read as they are
+// then), so copying a large selection costs nothing until it is used.
+class SelectionMimeData : public QMimeData
+{
+  public:
+    SelectionMimeData( const AbstractLogData* logData,
+            const Selection& selection );
+
+    QStringList formats() const override;
+    bool hasFormat( const QString& mimetype ) const override;
+
+  protected:
+    QVariant retrieveData( const QString& mimetype,
+            QVariant::Type type ) const override;
+
+  private:
+    // (null once the data is closed)
+    const QPointer<const AbstractLogData> logData_;
+    const Selection selection_;
 };
 
 #endif
@@ -31,6 +31,8 @@
 #include "sessioninfo.h"
 #include "data/logdata.h"
 #include "data/logfiltereddata.h"
+#include "data/pipespooler.h"
+#include "data/remotefile.h"
 
 Session::Session()
 {
@@ -61,13 +63,16 @@ ViewInterface* Session::getViewIfOpen( const std::string& file_name ) const
 }
 
 ViewInterface* Session::open( const std::string& file_name,
-        std::function<ViewInterface*()> view_factory )
+        std::function<ViewInterface*()> view_factory, bool deferred )
 {
     ViewInterface* view = nullptr;
 
-    QFileInfo fileInfo( file_name.c_str() );
-    if ( fileInfo.isReadable() ) {
-        return openAlways( file_name, view_factory, nullptr );
+    // The pipes and remote files can only be checked when read
+    const QString name = QString::fromStdString( file_name );
+    QFileInfo fileInfo( name );
+    if ( fileInfo.isReadable() || PipeSpooler::isPipe( name )
+            || RemoteFile::isRemote( name ) ) {
+        return openAlways( file_name, view_factory, nullptr, deferred );
     }
     else {
         throw FileUnreadableErr();
@@ -76,11 +81,56 @@ ViewInterface* Session::open( const std::string& file_name,
     return view;
 }
 
+ViewInterface* Session::openView( const ViewInterface* view,
+        std::function<ViewInterface*()> view_factory )
+{
+    const OpenFile* file = findOpenFileFromView( view );
+
+    assert( file );
+
+    // (the view is deferred if the file is)
+    const std::string file_name = file->fileName;
+    return openAlways( file_name, view_factory, nullptr, file->deferred );
+}
+
+int Session::nbViews( const ViewInterface* view ) const
+{
+    const OpenFile* file = findOpenFileFromView( view );
+
+    assert( file );
+
+    return std::count_if( openFiles_.begin(), openFiles_.end(),
+            [&](const std::pair<const ViewInterface*, OpenFile>& o)
+            { return ( o.second.logData == file->logData ); } );
+}
+
 void Session::close( const ViewInterface* view )
 {
+    // The LogData is destroyed with the last view sharing it
     openFiles_.erase( openFiles_.find( view ) );
 }
 
+void Session::activate( const ViewInterface* view )
+{
+    OpenFile* file = findOpenFileFromView( view );
+
+    assert( file );
+
+    if ( file->deferred ) {
+        LOG(logDEBUG) << "Loading deferred file " << file->fileName;
+        attach( file );
+    }
+}
+
+bool Session::isDeferred( const ViewInterface* view ) const
+{
+    const OpenFile* file = findOpenFileFromView( view );
+
+    assert( file );
+
+    return file->deferred;
+}
+
 void Session::save( std::vector<
         std::tuple<const ViewInterface*,
             uint64_t,
@@ -101,8 +151,14 @@ void Session::save( std::vector<
         const OpenFile* file = findOpenFileFromView( view_object );
         assert( file );
 
+        uint64_t file_size;
+        uint32_t file_nb_line;
+        QDateTime last_modified;
+        getFileInfo( view_object, &file_size, &file_nb_line, &last_modified );
+
         LOG(logDEBUG) << "Saving " << file->fileName << " in session.";
-        session_files.push_back( { file->fileName, top_line, view_context->toString() } );
+        session_files.push_back( { file->fileName, top_line,
+                view_context->toString(), file_size, file_nb_line } );
     }
 
     std::shared_ptr<SessionInfo> session =
@@ -127,7 +183,11 @@ std::vector<std::pair<std::string, ViewInterface*>> Session::restore(
     for ( auto file: session_files )
     {
         LOG(logDEBUG) << "Create view for " << file.fileName;
-        ViewInterface* view = openAlways( file.fileName, view_factory, file.viewContext.c_str() );
+        ViewInterface* view = openAlways( file.fileName, view_factory,
+                file.viewContext.c_str(), true );
+        OpenFile* open_file = findOpenFileFromView( view );
+        open_file->savedFileSize   = file.fileSize;
+        open_file->savedFileNbLine = file.fileNbLine;
         result.push_back( { file.fileName, view } );
     }
 
@@ -161,6 +221,13 @@ void Session::getFileInfo( const ViewInterface* view, uint64_t* fileSize,
 
     assert( file );
 
+    if ( file->deferred ) {
+        *fileSize = file->savedFileSize;
+        *fileNbLine = file->savedFileNbLine;
+        *lastModified = QDateTime();
+        return;
+    }
+
     *fileSize = file->logData->getFileSize();
     *fileNbLine = file->logData->getNbLine();
     *lastModified = file->logData->getLastModifiedDate();
@@ -173,12 +240,18 @@ void Session::getFileInfo( const ViewInterface* view, uint64_t* fileSize,
 
 ViewInterface* Session::openAlways( const std::string& file_name,
         std::function<ViewInterface*()> view_factory,
-        const char* view_context )
+        const char* view_context, bool deferred )
 {
+    // The LogData of a file already open is shared, so it is indexed
+    // (and kept in memory) only once, each view having its own search
+    const OpenFile* shared_file = findOpenFileFromName( file_name );
+
     // Create the data objects
-    auto log_data          = std::make_shared<LogData>();
+    auto log_data          = shared_file ?
+        shared_file->logData : std::make_shared<LogData>();
     auto log_filtered_data =
         std::shared_ptr<LogFilteredData>( log_data->getNewFilteredData() );
+    const bool attached    = shared_file && ! shared_file->deferred;
 
     ViewInterface* view = view_factory();
     view->setData( log_data, log_filtered_data );
@@ -193,14 +266,40 @@ ViewInterface* Session::openAlways( const std::string& file_name,
             { file_name,
             log_data,
             log_filtered_data,
-            view } } );
+            view,
+            ! attached,
+            shared_file ? shared_file->savedFileSize : 0,
+            shared_file ? shared_file->savedFileNbLine : 0 } } );
 
     // Start loading the file
-    log_data->attachFile( QString( file_name.c_str() ) );
+    if ( ! attached && ! deferred )
+        attach( findOpenFileFromView( view ) );
 
     return view;
 }
 
+void Session::attach( OpenFile* file )
+{
+    for ( auto& open_file : openFiles_ ) {
+        if ( open_file.second.logData == file->logData )
+            open_file.second.deferred = false;
+    }
+
+    file->logData->attachFile( QString( file->fileName.c_str() ) );
+}
+
+Session::OpenFile* Session::findOpenFileFromName( const std::string& file_name )
+{
+    auto result = std::find_if( openFiles_.begin(), openFiles_.end(),
+            [&](const std::pair<const ViewInterface*, OpenFile>& o)
+            { return ( o.second.fileName == file_name ); } );
+
+    if ( result != openFiles_.end() )
+        return &( result->second );
+    else
+        return nullptr;
+}
+
 Session::OpenFile* Session::findOpenFileFromView( const ViewInterface* view )
 {
     assert( view );
@@ -60,15 +60,35 @@ class Session {
     // Open a new file, starts its asynchronous loading, and construct a new
     // view for it (the caller passes a factory to build the concrete view)
     // The ownership of the view is given to the caller
-    // Throw exceptions if the file is already open or if it cannot be open.
+    // Throw exceptions if the file cannot be open.
+    // If the file is already open, the new view shares the LogData (and
+    // index) of the existing ones, with its own LogFilteredData, the
+    // file being indexed only once.
+    // If deferred, the loading only starts when activate() is called.
     ViewInterface* open( const std::string& file_name,
+            std::function<ViewInterface*()> view_factory,
+            bool deferred = false );
+    // Construct another view on the file of the passed view, sharing
+    // its LogData, with its own LogFilteredData (and search).
+    // The ownership of the view is given to the caller
+    ViewInterface* openView( const ViewInterface* view,
             std::function<ViewInterface*()> view_factory );
-    // Close the file identified by the view passed
+    // Returns the number of views on the file of the passed view
+    // (including itself)
+    int nbViews( const ViewInterface* view ) const;
+    // Close the file identified by the view passed, its LogData being
+    // kept as long as other views use it
     // Throw an exception if it does not exist.
     void close( const ViewInterface* view );
+    // Start loading the file of the view if restore() deferred it
+    // (called when the view is displayed)
+    void activate( const ViewInterface* view );
+    // Returns whether the file of the view waits for activate()
+    bool isDeferred( const ViewInterface* view ) const;
 
     // Open all the files listed in the stored session
-    // (see ::open)
+    // (see ::open), their loading being deferred until activate()
+    // is called for their view, not to read them all at startup.
     // returns a vector of pairs (file_name, view) and the index of the
     // current file (or -1 if none).
     std::vector<std::pair<std::string, ViewInterface*>> restore(
@@ -91,6 +111,8 @@ class Session {
     std::string getFilename( const ViewInterface* view ) const;
     // Get the size (in bytes) and number of lines in the current file.
     // The file is identified by the view attached to it.
+    // Until a restored file is loaded, they are the ones saved with
+    // the session (and lastModified is invalid).
     void getFileInfo( const ViewInterface* view, uint64_t* fileSize,
             uint32_t* fileNbLine, QDateTime* lastModified ) const;
     // Get a (non-const) reference to the QuickFind pattern.
@@ -103,12 +125,23 @@ class Session {
         std::shared_ptr<LogData> logData;
         std::shared_ptr<LogFilteredData> logFilteredData;
         ViewInterface* view;
+        // Set while restored but not loaded yet, with the
+        // information saved
+        bool deferred;
+        uint64_t savedFileSize;
+        uint32_t savedFileNbLine;
     };
 
-    // Open a file without checking if it is existing/readable
+    // Open a file without checking if it is existing/readable,
+    // loading it unless deferred (or already loaded for another view)
     ViewInterface* openAlways( const std::string& file_name,
             std::function<ViewInterface*()> view_factory,
-            const char* view_context );
+            const char* view_context, bool deferred = false );
+    // Start loading the file deferred, for all the views sharing it
+    void attach( OpenFile* file );
+    // Find an open file from its name (the first view of it), nullptr
+    // if it is not open
+    OpenFile* findOpenFileFromName( const std::string& file_name );
     // Find an open file from its associated view
     OpenFile* findOpenFileFromView( const ViewInterface* view );
     const OpenFile* findOpenFileFromView( const ViewInterface* view ) const;
@@ -45,7 +45,10 @@ void SessionInfo::retrieveFromStorage( QSettings& settings )
                 uint64_t top_line = settings.value( "topLine" ).toInt();
                 std::string view_context =
                     settings.value( "viewContext" ).toString().toStdString();
-                openFiles_.push_back( { file_name, top_line, view_context } );
+                uint64_t file_size = settings.value( "fileSize" ).toLongLong();
+                uint32_t file_nb_line = settings.value( "fileNbLine" ).toUInt();
+                openFiles_.push_back( { file_name, top_line, view_context,
+                        file_size, file_nb_line } );
             }
             settings.endArray();
         }
@@ -70,6 +73,8 @@ void SessionInfo::saveToStorage( QSettings& settings ) const
         settings.setValue( "fileName", QString( open_file->fileName.c_str() ) );
         settings.setValue( "topLine", qint64( open_file->topLine ) );
         settings.setValue( "viewContext", QString( open_file->viewContext.c_str() ) );
+        settings.setValue( "fileSize", qint64( open_file->fileSize ) );
+        settings.setValue( "fileNbLine", open_file->fileNbLine );
     }
     settings.endArray();
     settings.endGroup();
@@ -49,6 +49,10 @@ class SessionInfo : public Persistable {
         // The view context contains parameter specific to the view's
         // implementation (such as geometry...)
         std::string viewContext;
+        // Size and number of lines when saved, shown until the file
+        // is loaded again (0 if unknown)
+        uint64_t    fileSize;
+        uint32_t    fileNbLine;
     };
 
     // List of the loaded files
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements TemplateListWidget, listing the most frequent
+// templates of the messages under the search line.
+
+#include <QHeaderView>
+
+#include "templatelistwidget.h"
+
+#include "data/logfiltereddata.h"
+
+const int TemplateListWidget::NB_TEMPLATES = 100;
+
+TemplateListWidget::TemplateListWidget( QWidget* parent ) :
+    QTreeWidget( parent )
+{
+    filteredData_ = NULL;
+
+    setColumnCount( 2 );
+    setHeaderLabels( QStringList() << tr( "Lines" ) << tr( "Template" ) );
+    setRootIsDecorated( false );
+    setUniformRowHeights( true );
+    header()->setStretchLastSection( true );
+    setToolTip( tr( "Double-click on a template to search for its lines" ) );
+
+    connect( this, SIGNAL( itemActivated( QTreeWidgetItem*, int ) ),
+            this, SLOT( activateItem( QTreeWidgetItem*, int ) ) );
+}
+
+void TemplateListWidget::setFilteredData( LogFilteredData* filteredData )
+{
+    filteredData_ = filteredData;
+
+    connect( filteredData_, SIGNAL( templatesMined() ),
+            this, SLOT( updateTemplates() ) );
+}
+
+void TemplateListWidget::mineTemplates()
+{
+    if ( isVisible() && filteredData_ != NULL )
+        filteredData_->mineTemplates();
+}
+
+void TemplateListWidget::updateTemplates()
+{
+    if ( ! isVisible() || filteredData_ == NULL )
+        return;
+
+    // The same template stays selected
+    const QTreeWidgetItem* current = currentItem();
+    const int current_id = current ? current->data( 0, Qt::UserRole ).toInt() : -1;
+
+    clear();
+    for ( const TemplateIndex::Summary& summary :
+            filteredData_->getTopTemplates( NB_TEMPLATES ) ) {
+        QTreeWidgetItem* item = new QTreeWidgetItem( this );
+        item->setText( 0, QString::number( summary.count ) );
+        item->setTextAlignment( 0, Qt::AlignRight );
+        item->setText( 1, summary.text );
+        item->setData( 0, Qt::UserRole, summary.id );
+        if ( summary.id == current_id )
+            setCurrentItem( item );
+    }
+    resizeColumnToContents( 0 );
+}
+
+void TemplateListWidget::showEvent( QShowEvent* showEvent )
+{
+    QTreeWidget::showEvent( showEvent );
+
+    updateTemplates();
+    mineTemplates();
+}
+
+void TemplateListWidget::activateItem( QTreeWidgetItem* item, int /* column */ )
+{
+    emit templateActivated( item->data( 0, Qt::UserRole ).toInt() );
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEMPLATELISTWIDGET_H
+#define TEMPLATELISTWIDGET_H
+
+#include <QTreeWidget>
+
+class LogFilteredData;
+
+// List of the templates of the messages having the most lines, mined
+// in the background while the list is shown (see TemplateIndex).
+// Activating a template sends its number, to search for its lines.
+class TemplateListWidget : public QTreeWidget
+{
+  Q_OBJECT
+
+  public:
+    TemplateListWidget( QWidget* parent = 0 );
+
+    // Associate the widget with the data whose templates it lists
+    void setFilteredData( LogFilteredData* filteredData );
+
+  public slots:
+    // Mine the templates of the lines added if the list is visible
+    void mineTemplates();
+    // Fill the list with the templates mined so far
+    void updateTemplates();
+
+  signals:
+    // Sent when the user activates (double-clicks) a template
+    void templateActivated( int id );
+
+  protected:
+    void showEvent( QShowEvent* showEvent );
+
+  private slots:
+    void activateItem( QTreeWidgetItem* item, int column );
+
+  private:
+    // Number of templates listed
+    static const int NB_TEMPLATES;
+
+    LogFilteredData* filteredData_;
+};
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tracerecorder.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include <QFile>
+
+#include "log.h"
+
+namespace {
+    // Events recorded at most (about 40 MiB), to keep a forgotten
+    // recording from eating the memory
+    const size_t maxEvents = 1000000;
+
+    struct Event {
+        const char* name;
+        const char* category;   // nullptr for the name of a thread
+        int thread;
+        qint64 start;
+        qint64 duration;
+    };
+
+    std::atomic<bool> recording( false );
+    std::mutex mutex;
+    QString fileName;
+    std::vector<Event> events;
+    std::chrono::steady_clock::time_point origin;
+
+    std::atomic<int> nbThreads( 0 );
+
+    // Returns the number identifying the calling thread in the trace
+    int threadNumber()
+    {
+        thread_local int number = ++nbThreads;
+        return number;
+    }
+
+    void addEvent( const Event& event )
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        if ( recording && events.size() < maxEvents )
+            events.push_back( event );
+    }
+}
+
+void TraceRecorder::start( const QString& file_name )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+
+    fileName = file_name;
+    events.clear();
+    origin = std::chrono::steady_clock::now();
+    recording = true;
+}
+
+bool TraceRecorder::stop()
+{
+    std::vector<Event> recorded;
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        if ( ! recording )
+            return false;
+        recording = false;
+        recorded.swap( events );
+    }
+
+    QFile file( fileName );
+    if ( ! file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG(logWARNING) << "Cannot write the trace to " << fileName.toStdString();
+        return false;
+    }
+
+    QByteArray trace = "{\"traceEvents\":[\n";
+    for ( size_t i = 0; i < recorded.size(); i++ ) {
+        const Event& event = recorded[i];
+        if ( i > 0 )
+            trace += ",\n";
+        if ( event.category )
+            trace += QString( "{\"name\":\"%1\",\"cat\":\"%2\",\"ph\":\"X\","
+                    "\"pid\":1,\"tid\":%3,\"ts\":%4,\"dur\":%5}" )
+                .arg( event.name ).arg( event.category ).arg( event.thread )
+                .arg( event.start ).arg( event.duration ).toUtf8();
+        else
+            trace += QString( "{\"name\":\"thread_name\",\"ph\":\"M\","
+                    "\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}}" )
+                .arg( event.thread ).arg( event.name ).toUtf8();
+
+        if ( trace.size() > 1024*1024 ) {
+            file.write( trace );
+            trace.clear();
+        }
+    }
+    trace += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    file.write( trace );
+
+    if ( recorded.size() >= maxEvents )
+        LOG(logWARNING) << "The trace is truncated to its first "
+            << maxEvents << " events";
+
+    return true;
+}
+
+bool TraceRecorder::isRecording()
+{
+    return recording.load( std::memory_order_relaxed );
+}
+
+void TraceRecorder::nameThread( const char* name )
+{
+    if ( isRecording() )
+        addEvent( { name, nullptr, threadNumber(), 0, 0 } );
+}
+
+qint64 TraceRecorder::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin ).count();
+}
+
+void TraceRecorder::addSpan( const char* name, const char* category,
+        qint64 start, qint64 duration )
+{
+    addEvent( { name, category, threadNumber(), start, duration } );
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2015 Nicolas Bonnefon and other contributors
+ *
+ * This file is part of glogg.
+ *
+ * glogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * glogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with glogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+
+// Records, when started, the spans of work of the threads (indexing,
+// searching, painting, file notifications...) to a file in the Chrome
+// trace event format, opening in chrome://tracing or Perfetto, to see
+// how the threads interleave. Not recording costs a flag check a span.
+// All functions are thread safe.
+class TraceRecorder
+{
+  public:
+    // Start recording, the trace being written to the file by stop()
+    static void start( const QString& file_name );
+    // Stop recording and write the trace, returns whether it is written
+    static bool stop();
+
+    static bool isRecording();
+
+    // Give a name to the calling thread in the trace
+    // (the name must be a literal)
+    static void nameThread( const char* name );
+
+    // Returns the time since the recording started (µs)
+    static qint64 now();
+    // Add a span of work of the calling thread
+    // (the name and category must be literals)
+    static void addSpan( const char* name, const char* category,
+            qint64 start, qint64 duration );
+};
+
+// Records in the trace the span of work from its construction to its
+// destruction.
+class TraceSpan
+{
+  public:
+    TraceSpan( const char* name, const char* category )
+        : name_( name ), category_( category ),
+        start_( TraceRecorder::isRecording() ? TraceRecorder::now() : -1 ) {}
+    ~TraceSpan()
+    {
+        if ( start_ >= 0 )
+            TraceRecorder::addSpan( name_, category_, start_,
+                    TraceRecorder::now() - start_ );
+    }
+
+  private:
+    TraceSpan( const TraceSpan& ) = delete;
+    TraceSpan& operator=( const TraceSpan& ) = delete;
+
+    const char* const name_;
+    const char* const category_;
+    const qint64 start_;
+};
+
+#endif
@@ -3,8 +3,10 @@
 
 #include "config.h"
 
+#include <cstdint>
 #include <memory>
 #include <atomic>
+#include <vector>
 #include <thread>
 #include <mutex>
 
@@ -23,6 +25,16 @@ using Registration = std::shared_ptr<void>;
 typedef std::shared_ptr<void> Registration;
 #endif
 
+// Counts of what a WatchTower has done since its creation
+struct WatchTowerStats {
+    // Number of times the driver has returned events
+    uint64_t drainCycles;
+    // Number of file changes reported by the driver
+    uint64_t events;
+    // Number of notifications sent (one per file and callback per cycle)
+    uint64_t notifications;
+};
+
 template<typename Driver>
 class WatchTower {
   public:
@@ -41,6 +53,8 @@ class WatchTower {
 
     // Number of watched directories (for tests)
     unsigned int numberWatchedDirectories() const;
+    // Returns the coalescing statistics
+    WatchTowerStats stats() const;
 
   private:
     // The driver (parametrised)
@@ -56,6 +70,11 @@ class WatchTower {
     std::atomic_bool running_;
     std::thread thread_;
 
+    // Statistics (see WatchTowerStats)
+    std::atomic<uint64_t> drain_cycles_;
+    std::atomic<uint64_t> events_;
+    std::atomic<uint64_t> notifications_;
+
     // Exist as long as the onject exists, to ensure observers won't try to
     // call us if we are dead.
     std::shared_ptr<void> heartBeat_;
@@ -77,15 +96,19 @@ class WatchTower {
 #include <unistd.h>
 
 #include "log.h"
+#include "tracerecorder.h"
 
 namespace {
+    template <typename T>
+    void removeDuplicates( std::vector<T>* list );
     bool isSymLink( const std::string& file_name );
     std::string directory_path( const std::string& path );
 };
 
 template <typename Driver>
 WatchTower<Driver>::WatchTower()
-    : driver_(), thread_(),
+    : driver_(), thread_(), drain_cycles_( 0 ), events_( 0 ),
+    notifications_( 0 ),
     heartBeat_(std::shared_ptr<void>((void*) 0xDEADC0DE, [] (void*) {}))
 {
     running_ = true;
@@ -136,7 +159,8 @@ Registration WatchTower<Driver>::addFile(
                             driver_.removeDir( dir->dir_id_ );
                         } } );
 
-            dir->dir_id_ = driver_.addDir( dir->path );
+            observed_file_list_.setDirectoryId( dir.get(),
+                    driver_.addDir( dir->path ) );
 
             if ( ! dir->dir_id_.valid() ) {
                 LOG(logWARNING) << "WatchTower::addFile driver failed to add dir";
@@ -153,7 +177,7 @@ Registration WatchTower<Driver>::addFile(
     }
     else
     {
-        existing_observed_file->addCallback( ptr );
+        observed_file_list_.addCallback( existing_observed_file, ptr );
     }
 
     // Returns a shared pointer that removes its own entry
@@ -171,6 +195,12 @@ unsigned int WatchTower<Driver>::numberWatchedDirectories() const
     return observed_file_list_.numberWatchedDirectories();
 }
 
+template <typename Driver>
+WatchTowerStats WatchTower<Driver>::stats() const
+{
+    return { drain_cycles_, events_, notifications_ };
+}
+
 //
 // Private functions
 //
@@ -216,6 +246,8 @@ void WatchTower<Driver>::removeNotification(
 template <typename Driver>
 void WatchTower<Driver>::run()
 {
+    TraceRecorder::nameThread( "WatchTower" );
+
     while ( running_ ) {
         std::unique_lock<std::mutex> lock( observers_mutex_ );
 
@@ -227,6 +259,16 @@ void WatchTower<Driver>::run()
             << files.size() << " files, " << files_needing_readding.size()
             << " needing re-adding";
 
+        if ( ! files.empty() ) {
+            drain_cycles_++;
+            events_ += files.size();
+        }
+
+        // A file changed several times during the cycle is only
+        // readded and notified once.
+        removeDuplicates( &files );
+        removeDuplicates( &files_needing_readding );
+
         for ( auto file: files_needing_readding ) {
             // A file 'needing readding' has the same name,
             // but probably a different inode, so it needs
@@ -235,8 +277,10 @@ void WatchTower<Driver>::run()
             driver_.removeFile( file->file_id_ );
             driver_.removeSymlink( file->symlink_id_ );
 
-            std::tie( file->file_id_, file->symlink_id_ ) =
-                addFileToDriver( file->file_name_ );
+            typename Driver::FileId file_id;
+            typename Driver::SymlinkId symlink_id;
+            std::tie( file_id, symlink_id ) = addFileToDriver( file->file_name_ );
+            observed_file_list_.setIds( file, file_id, symlink_id );
         }
 
         for ( auto file: files ) {
@@ -248,13 +292,28 @@ void WatchTower<Driver>::run()
                     std::static_pointer_cast<std::function<void()>>( observer );
                 // The observer is called with the mutex held,
                 // Let's hope it doesn't do anything too funky.
+                TraceSpan span( "WatchTower notification", "watch" );
                 (*fptr)();
+                notifications_++;
             }
         }
     }
 }
 
 namespace {
+    // Remove the duplicates from the passed (small) list, keeping
+    // the order of the first occurrences.
+    template <typename T>
+    void removeDuplicates( std::vector<T>* list )
+    {
+        auto end = list->begin();
+        for ( auto i = list->begin(); i != list->end(); ++i ) {
+            if ( std::find( list->begin(), end, *i ) == end )
+                *end++ = *i;
+        }
+        list->erase( end, list->end() );
+    }
+
     bool isSymLink( const std::string& file_name )
     {
 #ifdef HAVE_SYMLINK
@@ -6,7 +6,7 @@
 #include <functional>
 #include <string>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include <list>
 #include <memory>
 #include <algorithm>
@@ -69,7 +69,16 @@ struct ObservedFile {
     std::shared_ptr<ObservedDir<Driver>> dir_;
 };
 
+// Hash of a driver's file/symlink/dir id
+struct WatchIdHash {
+    template <typename Id>
+    size_t operator()( const Id& id ) const { return id.hash(); }
+};
+
 // A list of the observed files and directories
+// All the lookups are done through hash tables (by name, driver id or
+// callback), so watching thousands of files costs the same per event
+// as watching a few.
 // This class is not thread safe
 template<typename Driver>
 class ObservedFileList {
@@ -87,10 +96,21 @@ class ObservedFileList {
                 typename Driver::SymlinkId symlink_id );
         ObservedFile<Driver>* searchByDirWdAndName(
                 typename Driver::DirId id, const char* name );
+        // Returns the files of the passed directory (for the drivers
+        // not told which entry of a directory has changed).
+        std::vector<ObservedFile<Driver>*> filesInDirectory(
+                typename Driver::DirId id );
 
         // Add a new file, the list returns a pointer to the added file,
         // but has ownership of the file.
         ObservedFile<Driver>* addNewObservedFile( ObservedFile<Driver> new_observed );
+        // Add a callback to a file of the list
+        void addCallback( ObservedFile<Driver>* file,
+                std::shared_ptr<void> callback );
+        // Change the driver ids of a file of the list (when it is readded)
+        void setIds( ObservedFile<Driver>* file,
+                typename Driver::FileId file_id,
+                typename Driver::SymlinkId symlink_id );
         // Remove a callback, remove and returns the file object if
         // it was the last callback on this object, nullptr if not.
         // The caller has ownership of the object.
@@ -107,6 +127,9 @@ class ObservedFileList {
         std::shared_ptr<ObservedDir<Driver>> addWatchedDirectory(
             const std::string& dir_name,
             std::function<void( ObservedDir<Driver>* )> remove_notification );
+        // Set the driver id of a watched directory
+        void setDirectoryId( ObservedDir<Driver>* dir,
+                typename Driver::DirId dir_id );
 
         // Similar to previous functions but extract the name of the
         // directory from the file name.
@@ -121,22 +144,34 @@ class ObservedFileList {
         unsigned int numberWatchedDirectories() const;
 
     private:
-        // List of observed files
+        typedef typename std::list<ObservedFile<Driver>>::iterator FileIterator;
+
+        // List of observed files (never moved in memory)
         std::list<ObservedFile<Driver>> observed_files_;
+        // The observed files, key-ed by name and by callback
+        std::unordered_map<std::string, FileIterator> by_name_;
+        std::unordered_map<void*, FileIterator> by_callback_;
 
         // List of observed dirs, key-ed by name
-        std::map<std::string, std::weak_ptr<ObservedDir<Driver>>> observed_dirs_;
+        std::unordered_map<std::string, std::weak_ptr<ObservedDir<Driver>>> observed_dirs_;
 
-        // Map the inotify file (including symlinks) wds to the observed file
-        std::map<int, ObservedFile<Driver>*> by_file_wd_;
-        // Map the inotify directory wds to the observed files
-        std::map<int, ObservedFile<Driver>*> by_dir_wd_;
+        // Map the driver file (and symlinks) ids to the observed file
+        std::unordered_map<typename Driver::FileId,
+            ObservedFile<Driver>*, WatchIdHash> by_file_id_;
+        std::unordered_map<typename Driver::SymlinkId,
+            ObservedFile<Driver>*, WatchIdHash> by_symlink_id_;
+        // Map the driver directory ids to the observed dirs
+        std::unordered_map<typename Driver::DirId,
+            ObservedDir<Driver>*, WatchIdHash> by_dir_id_;
 
         // Heartbeat
         std::shared_ptr<void> heartBeat_;
 
-        // Clean all reference to any expired directory
-        void cleanRefsToExpiredDirs();
+        // Add/remove the driver ids of the file to the maps
+        void indexIds( ObservedFile<Driver>* file );
+        void unindexIds( ObservedFile<Driver>* file );
+        // Remove the references to a directory being destroyed
+        void cleanRefsToDir( ObservedDir<Driver>* dir );
 };
 
 namespace {
@@ -148,21 +183,15 @@ template <typename Driver>
 ObservedFile<Driver>* ObservedFileList<Driver>::searchByName(
         const std::string& file_name )
 {
-    // Look for an existing observer on this file
-    auto existing_observer = observed_files_.begin();
-    for ( ; existing_observer != observed_files_.end(); ++existing_observer )
-    {
-        if ( existing_observer->file_name_ == file_name )
-        {
-            LOG(logDEBUG) << "Found " << file_name;
-            break;
-        }
-    }
+    auto existing_observer = by_name_.find( file_name );
 
-    if ( existing_observer != observed_files_.end() )
-        return &( *existing_observer );
-    else
+    if ( existing_observer != by_name_.end() ) {
+        LOG(logDEBUG) << "Found " << file_name;
+        return &( *existing_observer->second );
+    }
+    else {
         return nullptr;
+    }
 }
 
 template <typename Driver>
@@ -170,32 +199,25 @@ ObservedFile<Driver>* ObservedFileList<Driver>::searchByFileOrSymlinkWd(
         typename Driver::FileId file_id,
         typename Driver::SymlinkId symlink_id )
 {
-    auto result = find_if( observed_files_.begin(), observed_files_.end(),
-            [file_id, symlink_id] (ObservedFile<Driver> file) -> bool {
-                return ( file_id == file.file_id_ ) ||
-                    ( symlink_id == file.symlink_id_ );
-                } );
-
-    if ( result != observed_files_.end() )
-        return &( *result );
-    else
-        return nullptr;
+    auto file = by_file_id_.find( file_id );
+    if ( file != by_file_id_.end() )
+        return file->second;
+
+    auto symlink = by_symlink_id_.find( symlink_id );
+    if ( symlink != by_symlink_id_.end() )
+        return symlink->second;
+
+    return nullptr;
 }
 
 template <typename Driver>
 ObservedFile<Driver>* ObservedFileList<Driver>::searchByDirWdAndName(
         typename Driver::DirId id, const char* name )
 {
-    auto dir = find_if( observed_dirs_.begin(), observed_dirs_.end(),
-            [id] (std::pair<std::string,std::weak_ptr<ObservedDir<Driver>>> d) -> bool {
-            if ( auto dir = d.second.lock() ) {
-                return ( id == dir->dir_id_ );
-            }
-            else {
-                return false; } } );
+    auto dir = by_dir_id_.find( id );
 
-    if ( dir != observed_dirs_.end() ) {
-        std::string path = dir->first + "/" + name;
+    if ( dir != by_dir_id_.end() ) {
+        std::string path = dir->second->path + "/" + name;
 
         // LOG(logDEBUG) << "Testing path: " << path;
 
@@ -207,39 +229,79 @@ ObservedFile<Driver>* ObservedFileList<Driver>::searchByDirWdAndName(
     }
 }
 
+template <typename Driver>
+std::vector<ObservedFile<Driver>*> ObservedFileList<Driver>::filesInDirectory(
+        typename Driver::DirId id )
+{
+    std::vector<ObservedFile<Driver>*> files;
+
+    for ( auto& file: observed_files_ ) {
+        if ( file.dir_ && file.dir_->dir_id_ == id )
+            files.push_back( &file );
+    }
+
+    return files;
+}
+
 template <typename Driver>
 ObservedFile<Driver>* ObservedFileList<Driver>::addNewObservedFile(
         ObservedFile<Driver> new_observed )
 {
     auto new_file = observed_files_.insert( std::begin( observed_files_ ), new_observed );
 
+    by_name_[ new_file->file_name_ ] = new_file;
+    for ( const auto& callback : new_file->callbacks )
+        by_callback_[ callback.get() ] = new_file;
+    indexIds( &( *new_file ) );
+
     return &( *new_file );
 }
 
+template <typename Driver>
+void ObservedFileList<Driver>::addCallback( ObservedFile<Driver>* file,
+        std::shared_ptr<void> callback )
+{
+    file->addCallback( callback );
+    by_callback_[ callback.get() ] = by_name_.at( file->file_name_ );
+}
+
+template <typename Driver>
+void ObservedFileList<Driver>::setIds( ObservedFile<Driver>* file,
+        typename Driver::FileId file_id,
+        typename Driver::SymlinkId symlink_id )
+{
+    unindexIds( file );
+    file->file_id_    = file_id;
+    file->symlink_id_ = symlink_id;
+    indexIds( file );
+}
+
 template <typename Driver>
 std::shared_ptr<ObservedFile<Driver>> ObservedFileList<Driver>::removeCallback(
         std::shared_ptr<void> callback )
 {
     std::shared_ptr<ObservedFile<Driver>> returned_file = nullptr;
 
-    for ( auto observer = begin( observed_files_ );
-            observer != end( observed_files_ ); )
-    {
-        std::vector<std::shared_ptr<void>>& callbacks = observer->callbacks;
-        callbacks.erase( std::remove(
-                    std::begin( callbacks ), std::end( callbacks ), callback ),
-                std::end( callbacks ) );
-
-        /* See if all notifications have been deleted for this file */
-        if ( callbacks.empty() ) {
-            LOG(logDEBUG) << "Empty notification list for " << observer->file_name_
-                << ", removing the watched file";
-            returned_file = std::make_shared<ObservedFile<Driver>>( *observer );
-            observer = observed_files_.erase( observer );
-        }
-        else {
-            ++observer;
-        }
+    auto by_callback = by_callback_.find( callback.get() );
+    if ( by_callback == by_callback_.end() )
+        return returned_file;
+
+    FileIterator observer = by_callback->second;
+    by_callback_.erase( by_callback );
+
+    std::vector<std::shared_ptr<void>>& callbacks = observer->callbacks;
+    callbacks.erase( std::remove(
+                std::begin( callbacks ), std::end( callbacks ), callback ),
+            std::end( callbacks ) );
+
+    /* See if all notifications have been deleted for this file */
+    if ( callbacks.empty() ) {
+        LOG(logDEBUG) << "Empty notification list for " << observer->file_name_
+            << ", removing the watched file";
+        returned_file = std::make_shared<ObservedFile<Driver>>( *observer );
+        unindexIds( &( *observer ) );
+        by_name_.erase( observer->file_name_ );
+        observed_files_.erase( observer );
     }
 
     return returned_file;
@@ -251,8 +313,9 @@ std::shared_ptr<ObservedDir<Driver>> ObservedFileList<Driver>::watchedDirectory(
 {
     std::shared_ptr<ObservedDir<Driver>> dir = nullptr;
 
-    if ( observed_dirs_.find( dir_name ) != std::end( observed_dirs_ ) )
-        dir = observed_dirs_[ dir_name ].lock();
+    auto observed_dir = observed_dirs_.find( dir_name );
+    if ( observed_dir != std::end( observed_dirs_ ) )
+        dir = observed_dir->second.lock();
 
     return dir;
 }
@@ -269,7 +332,7 @@ std::shared_ptr<ObservedDir<Driver>> ObservedFileList<Driver>::addWatchedDirecto
             [this, remove_notification, weakHeartBeat] (ObservedDir<Driver>* d) {
                 if ( auto heart_beat = weakHeartBeat.lock() ) {
                     remove_notification( d );
-                    this->cleanRefsToExpiredDirs();
+                    this->cleanRefsToDir( d );
                 }
                 delete d; } };
 
@@ -278,6 +341,15 @@ std::shared_ptr<ObservedDir<Driver>> ObservedFileList<Driver>::addWatchedDirecto
     return dir;
 }
 
+template <typename Driver>
+void ObservedFileList<Driver>::setDirectoryId( ObservedDir<Driver>* dir,
+        typename Driver::DirId dir_id )
+{
+    dir->dir_id_ = dir_id;
+    if ( dir_id.valid() )
+        by_dir_id_[ dir_id ] = dir;
+}
+
 template <typename Driver>
 std::shared_ptr<ObservedDir<Driver>> ObservedFileList<Driver>::watchedDirectoryForFile(
         const std::string& file_name )
@@ -302,18 +374,38 @@ unsigned int ObservedFileList<Driver>::numberWatchedDirectories() const
 
 // Private functions
 template <typename Driver>
-void ObservedFileList<Driver>::cleanRefsToExpiredDirs()
+void ObservedFileList<Driver>::indexIds( ObservedFile<Driver>* file )
 {
-    for ( auto it = std::begin( observed_dirs_ );
-            it != std::end( observed_dirs_ ); )
-    {
-        if ( it->second.expired() ) {
-            it = observed_dirs_.erase( it );
-        }
-        else {
-            ++it;
-        }
-    }
+    if ( file->file_id_.valid() )
+        by_file_id_[ file->file_id_ ] = file;
+    if ( file->symlink_id_.valid() )
+        by_symlink_id_[ file->symlink_id_ ] = file;
+}
+
+template <typename Driver>
+void ObservedFileList<Driver>::unindexIds( ObservedFile<Driver>* file )
+{
+    // Only if the ids have not been reused for another file
+    auto by_file = by_file_id_.find( file->file_id_ );
+    if ( by_file != by_file_id_.end() && by_file->second == file )
+        by_file_id_.erase( by_file );
+
+    auto by_symlink = by_symlink_id_.find( file->symlink_id_ );
+    if ( by_symlink != by_symlink_id_.end() && by_symlink->second == file )
+        by_symlink_id_.erase( by_symlink );
+}
+
+template <typename Driver>
+void ObservedFileList<Driver>::cleanRefsToDir( ObservedDir<Driver>* dir )
+{
+    auto by_id = by_dir_id_.find( dir->dir_id_ );
+    if ( by_id != by_dir_id_.end() && by_id->second == dir )
+        by_dir_id_.erase( by_id );
+
+    // The name might be used by a new dir already
+    auto observed_dir = observed_dirs_.find( dir->path );
+    if ( observed_dir != observed_dirs_.end() && observed_dir->second.expired() )
+        observed_dirs_.erase( observed_dir );
 }
 
 namespace {
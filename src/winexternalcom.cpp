@@ -21,6 +21,7 @@
 
 #include <QString>
 #include <QRegExp>
+#include <QDataStream>
 
 #include "log.h"
 
@@ -32,6 +33,7 @@ WinExternalCommunicator::WinExternalCommunicator()
 {
     mutex_held_elsewhere_ = false;
     message_listener_     = nullptr;
+    nextCommandId_        = 0;
 
     (void)::CreateMutex( NULL, TRUE, TEXT( GLOGG_UUID ) );
     switch ( ::GetLastError() ) {
@@ -75,6 +77,29 @@ void WinExternalCommunicator::handleMessageReceived(
         case MessageId::LOAD_FILE:
             emit loadFile( data );
             break;
+        case MessageId::LOAD_FILES:
+            {
+                // The data is the bytes received (see WinMessageListener)
+                QByteArray bytes = data.toLatin1();
+                QDataStream in( &bytes, QIODevice::ReadOnly );
+                QStringList file_names;
+                QVariantMap options;
+                in >> file_names >> options;
+                if ( in.status() == QDataStream::Ok )
+                    emit loadFiles( file_names, options );
+            }
+            break;
+        case MessageId::RUN_COMMAND:
+            {
+                QByteArray bytes = data.toLatin1();
+                QDataStream in( &bytes, QIODevice::ReadOnly );
+                QString file_name, command;
+                QVariantMap args;
+                in >> file_name >> command >> args;
+                if ( in.status() == QDataStream::Ok )
+                    emit runCommand( nextCommandId_++, file_name, command, args );
+            }
+            break;
         default:
             LOG( logWARNING ) << "Unrecognised IPC message: "
                 << static_cast<int>( message_id );
@@ -96,6 +121,14 @@ qint32 WinExternalCommunicator::version() const
     return 3;
 }
 
+// WM_COPYDATA only goes one way, the sender cannot be notified.
+void WinExternalCommunicator::commandFinished( qint32 id, bool success,
+        const QVariantMap& result )
+{
+    LOG(logDEBUG) << "Command " << id << " finished: " << success;
+    Q_UNUSED( result );
+}
+
 WinExternalInstance::WinExternalInstance()
 {
     LPCWSTR window_title = (LPCWSTR) WINDOW_TITLE.utf16();
@@ -123,11 +156,32 @@ void WinExternalInstance::loadFile( const QString& file_name ) const
 
 }
 
+void WinExternalInstance::loadFiles( const QStringList& file_names,
+        const QVariantMap& options ) const
+{
+    QByteArray bytes;
+    QDataStream out( &bytes, QIODevice::WriteOnly );
+    out << file_names << options;
+
+    COPYDATASTRUCT data;
+    data.dwData = static_cast<ULONG_PTR>( MessageId::LOAD_FILES );
+    data.lpData = bytes.data();
+    data.cbData = bytes.size();
+
+    SendMessage( window_handle_, WM_COPYDATA, 0, (LPARAM) &data );
+}
+
 uint32_t WinExternalInstance::getVersion() const
 {
     return 6;
 }
 
+// WM_COPYDATA only goes one way, nothing can be returned.
+QString WinExternalInstance::getPerformanceCounters() const
+{
+    return QString();
+}
+
 /*
  * WinMessageListener class
  */
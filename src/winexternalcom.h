@@ -38,7 +38,10 @@ class WinExternalInstance : public ExternalInstance {
     ~WinExternalInstance() {}
 
     virtual void loadFile( const QString& file_name ) const;
+    virtual void loadFiles( const QStringList& file_names,
+            const QVariantMap& options ) const;
     virtual uint32_t getVersion() const;
+    virtual QString getPerformanceCounters() const;
 
   private:
     static WINBOOL enumWindowsCallback( HWND hwnd, LPARAM lParam );
@@ -46,7 +49,12 @@ class WinExternalInstance : public ExternalInstance {
 };
 
 enum class MessageId {
-    LOAD_FILE
+    LOAD_FILE,
+    // The file names and the options, in a QDataStream
+    LOAD_FILES,
+    // The file name, the command and its arguments, in a QDataStream
+    // (see ExternalCommunicator::runCommand, no completion is sent back)
+    RUN_COMMAND
 };
 
 // A hidden widget to listen for message via Windows'
@@ -87,6 +95,7 @@ class WinExternalCommunicator : public ExternalCommunicator
 
   public slots:
     qint32 version() const;
+    void commandFinished( qint32 id, bool success, const QVariantMap& result );
 
   private slots:
       void handleMessageReceived(
@@ -97,6 +106,7 @@ class WinExternalCommunicator : public ExternalCommunicator
 
     bool mutex_held_elsewhere_;
     std::shared_ptr<WinMessageListener> message_listener_;
+    qint32 nextCommandId_;
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include <windows.h>
 #include <winbase.h>
 
+#include <algorithm>
 #include <map>
 
 #include "watchtowerlist.h"
@@ -19,8 +20,9 @@ namespace {
 
 WinNotificationInfoList::WinNotificationInfoList( const char* buffer, size_t buffer_size )
 {
-    pointer_ = buffer;
-    next_ = updateCurrentNotification( pointer_ );
+    // An empty buffer has no notification
+    pointer_ = ( buffer_size > 0 ) ? buffer : nullptr;
+    next_ = pointer_ ? updateCurrentNotification( pointer_ ) : nullptr;
 }
 
 const char* WinNotificationInfoList::updateCurrentNotification(
@@ -72,6 +74,7 @@ WinWatchTowerDriver::WinWatchTowerDriver()
 
 WinWatchTowerDriver::~WinWatchTowerDriver()
 {
+    CloseHandle( hCompPort_ );
 }
 
 WinWatchTowerDriver::FileId WinWatchTowerDriver::addFile(
@@ -141,7 +144,14 @@ void WinWatchTowerDriver::removeDir( const DirId& dir_id )
 
         LOG(logDEBUG) << "WinWatchTowerDriver::removeDir handle=" << std::hex << handle;
 
+        // Closing the handle cancels the pending read, whose completion
+        // comes later: until then the system still owns the buffer.
         CloseHandle( handle );
+        dir_id.dir_record_->closing_ = true;
+        if ( dir_id.dir_record_->pending_ )
+            closing_records_.push_back( dir_id.dir_record_ );
+        else
+            releaseKey( dir_id.dir_record_->key_ );
     }
     else {
         /* Happens when an error occured when creating the dir_record_ */
@@ -158,10 +168,11 @@ void WinWatchTowerDriver::serialisedAddDir(
         DirId& dir_id )
 {
     bool inserted = false;
-    auto dir_record = std::make_shared<WinWatchedDirRecord>( dir_name );
     // The index we will be inserting this record (if success), plus 1 (to avoid
-    // 0 which is used as a magic value)
-    unsigned int index_record = dir_records_.size() + 1;
+    // 0 which is used as a magic value), reusing the one of a removed record
+    unsigned int index_record = free_keys_.empty() ?
+        dir_records_.size() + 1 : free_keys_.back();
+    auto dir_record = std::make_shared<WinWatchedDirRecord>( dir_name, index_record );
 
     LOG(logDEBUG) << "Adding dir for: " << dir_name;
 
@@ -196,16 +207,7 @@ void WinWatchTowerDriver::serialisedAddDir(
 
         LOG(logDEBUG) << "Weak ptr address stored: " << index_record;
 
-        memset( &overlapped_, 0, sizeof overlapped_ );
-
-        inserted = ReadDirectoryChangesW( hDir,
-                dir_record->buffer_,
-                dir_record->buffer_length_,
-                false,
-                FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
-                &buffer_length_, // not set when using asynchronous mechanisms...
-                &overlapped_,
-                NULL );          // no completion routine
+        inserted = readDirectoryChanges( dir_record.get() );
 
         if ( ! inserted ) {
             LOG(logERROR) << "ReadDirectoryChangesW failed (" << GetLastError() << ")";
@@ -217,10 +219,41 @@ void WinWatchTowerDriver::serialisedAddDir(
     }
 
     if ( inserted ) {
-        dir_records_.push_back( std::weak_ptr<WinWatchedDirRecord>( dir_record ) );
+        if ( index_record <= dir_records_.size() ) {
+            free_keys_.pop_back();
+            dir_records_[ index_record - 1 ] = dir_record;
+        }
+        else {
+            dir_records_.push_back( std::weak_ptr<WinWatchedDirRecord>( dir_record ) );
+        }
     }
 }
 
+// (Re)start the asynchronous read of the changes of the directory
+bool WinWatchTowerDriver::readDirectoryChanges( WinWatchedDirRecord* dir_record )
+{
+    memset( &dir_record->overlapped_, 0, sizeof dir_record->overlapped_ );
+
+    dir_record->pending_ = ReadDirectoryChangesW(
+            dir_record->handle_,
+            dir_record->buffer_.data(),
+            dir_record->buffer_.size(),
+            false,
+            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
+            &buffer_length_, // not set when using asynchronous mechanisms...
+            &dir_record->overlapped_,
+            NULL );          // no completion routine
+
+    return dir_record->pending_;
+}
+
+// The key of a removed record can be used by a new one
+void WinWatchTowerDriver::releaseKey( unsigned int key )
+{
+    dir_records_[ key - 1 ].reset();
+    free_keys_.push_back( key );
+}
+
 std::vector<ObservedFile<WinWatchTowerDriver>*> WinWatchTowerDriver::waitAndProcessEvents(
         ObservedFileList<WinWatchTowerDriver>* list,
         std::unique_lock<std::mutex>* lock,
@@ -228,6 +261,12 @@ std::vector<ObservedFile<WinWatchTowerDriver>*> WinWatchTowerDriver::waitAndProc
 {
     std::vector<ObservedFile<WinWatchTowerDriver>*> files_to_notify { };
 
+    struct Completion {
+        ULONG_PTR key;
+        DWORD num_bytes;
+    };
+    std::vector<Completion> completions;
+
     ULONG_PTR key = 0;
     DWORD num_bytes = 0;
     LPOVERLAPPED lpOverlapped = 0;
@@ -239,52 +278,24 @@ std::vector<ObservedFile<WinWatchTowerDriver>*> WinWatchTowerDriver::waitAndProc
             &key,
             &lpOverlapped,
             INFINITE );
+    completions.push_back( { key, num_bytes } );
+
+    // Then take the completions already queued (for the other
+    // directories), so they are dispatched in one cycle
+    // (a failed read, e.g. cancelled, is still dequeued)
+    while ( completions.size() < static_cast<size_t>( MAX_BATCHED_COMPLETIONS )
+            && ( GetQueuedCompletionStatus( hCompPort_,
+                    &num_bytes, &key, &lpOverlapped, 0 ) || lpOverlapped ) ) {
+        completions.push_back( { key, num_bytes } );
+    }
     lock->lock();
 
-    LOG(logDEBUG) << "Event (" << status << ") key: " << std::hex << key;
-
-    if ( key ) {
-        // Extract the dir from the completion key
-        auto dir_record_ptr = dir_records_[key - 1];
-        LOG(logDEBUG) << "use_count = " << dir_record_ptr.use_count();
-
-        if ( std::shared_ptr<WinWatchedDirRecord> dir_record = dir_record_ptr.lock() )
-        {
-            LOG(logDEBUG) << "Got event for dir " << dir_record.get();
+    LOG(logDEBUG) << "Event (" << status << "), " << completions.size()
+        << " completions";
 
-            WinNotificationInfoList notification_info(
-                    dir_record->buffer_,
-                    dir_record->buffer_length_ );
-
-            for ( auto notification : notification_info ) {
-                std::string file_path = dir_record->path_ + shortstringize( notification.fileName() );
-                LOG(logDEBUG) << "File is " << file_path;
-                auto file = list->searchByName( file_path );
-
-                if ( file )
-                {
-                    files_to_notify.push_back( file );
-                }
-            }
-
-            // Re-listen for changes
-            status = ReadDirectoryChangesW(
-                    dir_record->handle_,
-                    dir_record->buffer_,
-                    dir_record->buffer_length_,
-                    false,
-                    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
-                    &buffer_length_,// not set when using asynchronous mechanisms...
-                    &overlapped_,
-                    NULL );          // no completion routine
-        }
-        else {
-            LOG(logWARNING) << "Looks like our dir_record disappeared!";
-        }
-    }
-    else {
-        LOG(logDEBUG) << "Signaled";
-    }
+    for ( const auto& completion : completions )
+        processCompletion( completion.key, completion.num_bytes,
+                list, &files_to_notify );
 
     {
         std::lock_guard<std::mutex> lk( action_mutex_ );
@@ -304,6 +315,69 @@ std::vector<ObservedFile<WinWatchTowerDriver>*> WinWatchTowerDriver::waitAndProc
     return files_to_notify;
 }
 
+// Collect the files of the changes the completion reports
+void WinWatchTowerDriver::processCompletion( ULONG_PTR key, DWORD num_bytes,
+        ObservedFileList<WinWatchTowerDriver>* list,
+        std::vector<ObservedFile<WinWatchTowerDriver>*>* files_to_notify )
+{
+    if ( ! key ) {
+        LOG(logDEBUG) << "Signaled";
+        return;
+    }
+
+    // Extract the dir from the completion key
+    std::shared_ptr<WinWatchedDirRecord> dir_record;
+    if ( key <= dir_records_.size() )
+        dir_record = dir_records_[key - 1].lock();
+
+    if ( ! dir_record ) {
+        LOG(logWARNING) << "Looks like our dir_record disappeared!";
+        return;
+    }
+
+    LOG(logDEBUG) << "Got event for dir " << dir_record.get();
+    dir_record->pending_ = false;
+
+    if ( dir_record->closing_ ) {
+        // The read has been cancelled, the buffer can go
+        closing_records_.erase( std::remove( closing_records_.begin(),
+                    closing_records_.end(), dir_record ),
+                closing_records_.end() );
+        releaseKey( key );
+        return;
+    }
+
+    if ( num_bytes == 0 ) {
+        // The changes did not fit in the buffer, they are lost:
+        // every file of the directory might have changed.
+        LOG(logWARNING) << "Notification buffer overflowed for dir "
+            << dir_record->path_;
+        DirId dir_id;
+        dir_id.dir_record_ = dir_record;
+        for ( auto file : list->filesInDirectory( dir_id ) )
+            files_to_notify->push_back( file );
+    }
+    else {
+        WinNotificationInfoList notification_info(
+                dir_record->buffer_.data(), num_bytes );
+
+        for ( auto notification : notification_info ) {
+            std::string file_path = dir_record->path_ + shortstringize( notification.fileName() );
+            LOG(logDEBUG) << "File is " << file_path;
+            auto file = list->searchByName( file_path );
+
+            if ( file )
+            {
+                files_to_notify->push_back( file );
+            }
+        }
+    }
+
+    // Re-listen for changes
+    if ( ! readDirectoryChanges( dir_record.get() ) )
+        LOG(logERROR) << "ReadDirectoryChangesW failed (" << GetLastError() << ")";
+}
+
 void WinWatchTowerDriver::interruptWait()
 {
     LOG(logDEBUG) << "Driver::interruptWait()";
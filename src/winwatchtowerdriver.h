@@ -5,7 +5,10 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <cstring>
+#include <functional>
 #include <iterator>
+#include <memory>
 #include <vector>
 
 #define WIN32_LEAN_AND_MEAN
@@ -94,20 +97,44 @@ class ObservedFileList;
 
 class WinWatchTowerDriver {
   public:
+    // A watched directory, with its own notification buffer and
+    // overlapped structure (reused from one read to the next).
     struct WinWatchedDirRecord {
-        WinWatchedDirRecord( const std::string& file_name )
-            : path_( file_name ) { }
+        WinWatchedDirRecord( const std::string& file_name, unsigned int key )
+            : path_( file_name ), key_( key ),
+            buffer_( READ_DIR_CHANGE_BUFFER_SIZE )
+        { memset( &overlapped_, 0, sizeof overlapped_ ); }
 
-        static const int READ_DIR_CHANGE_BUFFER_SIZE = 4096;
+        // The most ReadDirectoryChangesW returns for a network share,
+        // so a burst of changes does not overflow the buffer.
+        static const int READ_DIR_CHANGE_BUFFER_SIZE = 64 * 1024;
 
         std::string path_;
         void* handle_ = nullptr;
-        static const unsigned long buffer_length_ = READ_DIR_CHANGE_BUFFER_SIZE;
-        char buffer_[buffer_length_];
+        // Completion key (index in dir_records_ plus 1)
+        unsigned int key_;
+        // A read is in progress (the buffer is the system's)
+        bool pending_ = false;
+        // The directory has been removed, the record is only kept
+        // until its pending read is cancelled
+        bool closing_ = false;
+        OVERLAPPED overlapped_;
+        std::vector<char> buffer_;
     };
 
-    class FileId { };
-    class SymlinkId { };
+    // Files are not watched individually (see DirId)
+    class FileId {
+      public:
+        bool operator==( const FileId& ) const { return true; }
+        bool valid() const { return false; }
+        size_t hash() const { return 0; }
+    };
+    class SymlinkId {
+      public:
+        bool operator==( const SymlinkId& ) const { return true; }
+        bool valid() const { return false; }
+        size_t hash() const { return 0; }
+    };
     class DirId {
       public:
         friend class WinWatchTowerDriver;
@@ -117,6 +144,8 @@ class WinWatchTowerDriver {
         { return dir_record_ == other.dir_record_; }
         bool valid() const
         { return ( dir_record_ != nullptr ); }
+        size_t hash() const
+        { return std::hash<WinWatchedDirRecord*>()( dir_record_.get() ); }
       private:
         std::shared_ptr<WinWatchedDirRecord> dir_record_;
     };
@@ -158,19 +187,30 @@ class WinWatchTowerDriver {
     std::condition_variable action_done_cv_;
     std::unique_ptr<Action> scheduled_action_ = nullptr;
 
+    // Most completions dequeued (and dispatched) at once
+    static const int MAX_BATCHED_COMPLETIONS = 64;
+
     // Win32 notification variables
     HANDLE     hCompPort_;
-    OVERLAPPED overlapped_;
     unsigned long buffer_length_;
 
-    // List of directory records
-    // Accessed exclusively in the worker thread context
+    // List of directory records, indexed by completion key (minus 1)
+    // Accessed with the WatchTower's mutex held
     std::vector<std::weak_ptr<WinWatchedDirRecord>> dir_records_ { };
+    // Keys of the removed records, to reuse
+    std::vector<unsigned int> free_keys_ { };
+    // Removed records waiting for their read to be cancelled
+    std::vector<std::shared_ptr<WinWatchedDirRecord>> closing_records_ { };
 
     // Private member functions
     void serialisedAddDir(
             const std::string& file_name,
             DirId& dir_id );
+    bool readDirectoryChanges( WinWatchedDirRecord* dir_record );
+    void processCompletion( ULONG_PTR key, DWORD num_bytes,
+            ObservedFileList<WinWatchTowerDriver>* list,
+            std::vector<ObservedFile<WinWatchTowerDriver>*>* files_to_notify );
+    void releaseKey( unsigned int key );
 };
 
 #endif
@@ -0,0 +1,563 @@
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QStandardPaths>
+
+#include "log.h"
+#include "perfcounters.h"
+#include "test_utils.h"
+#include "perf_utils.h"
+
+#include "data/logdata.h"
+#include "data/logfiltereddata.h"
+#include "data/scanreader.h"
+#include "quickfindworker.h"
+#include "persistentinfo.h"
+#include "sessioninfo.h"
+#include "configuration.h"
+#include "filterset.h"
+#include "savedsearches.h"
+#include "recentfiles.h"
+#include "session.h"
+#include "mainwindow.h"
+
+#include "gmock/gmock.h"
+
+#define TMPDIR "/tmp"
+
+// The report is written even if no benchmark is run
+static BenchmarkReport* const report = BenchmarkReport::instance();
+
+static const int PAGE_NB_LINES = 70;
+
+// Typical logs with a few matches, logs matching often with much more
+// tabs and non ASCII text, and logs with lines of tens of KiB.
+static const std::vector<LogProfile> profiles = {
+    { "mixed", 2000000, 20, 200, 0.1, 0.05, 0.001, 8192, 100000 },
+    { "dense", 1000000, 40, 120, 0.3, 0.2, 0.0, 0, 2 },
+    { "longlines", 20000, 20, 200, 0.1, 0.05, 0.1, 65536, 1000 } };
+
+class Benchmarks : public testing::Test {
+  public:
+    Benchmarks() {
+        FILELog::setReportingLevel( logERROR );
+    }
+
+    // Returns the datasets of the profiles, generated the first time
+    static const std::vector<LogDataset>& datasets() {
+        static std::vector<LogDataset> datasets;
+        if ( datasets.empty() ) {
+            for ( const LogProfile& profile : profiles )
+                datasets.push_back( generateLog( profile,
+                            QString( TMPDIR "/benchmark_%1.txt" ).arg( profile.name ) ) );
+        }
+        return datasets;
+    }
+
+    // Attach log_data to the dataset and wait for it to be indexed
+    static bool load( LogData* log_data, const LogDataset& dataset ) {
+        SafeQSignalSpy endSpy( log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+        log_data->attachFile( dataset.fileName );
+        return endSpy.safeWait( 600000 );
+    }
+
+    // Run the search and wait for its end
+    static void search( LogFilteredData* filtered_data, const QRegExp& regexp ) {
+        SafeQSignalSpy progressSpy( filtered_data,
+                SIGNAL( searchProgressed( qint64, int ) ) );
+        filtered_data->runSearch( regexp );
+
+        int percent = 0;
+        while ( percent < 100 && progressSpy.wait( 600000 ) )
+            percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+    }
+};
+
+TEST_F( Benchmarks, indexing ) {
+    for ( size_t i = 0; i < profiles.size(); i++ ) {
+        const LogDataset& dataset = datasets()[i];
+        LogData log_data;
+        {
+            Benchmark b( "indexing", profiles[i].name, dataset.size, dataset.nbLines );
+            ASSERT_TRUE( load( &log_data, dataset ) );
+        }
+        ASSERT_THAT( log_data.getNbLine(), dataset.nbLines );
+    }
+}
+
+TEST_F( Benchmarks, coldIndexing ) {
+    // The biggest dataset read from the disk with each I/O policy, and
+    // how much of it is left in the system's cache (evicting the rest).
+    const LogDataset& dataset = datasets()[0];
+    const std::vector<std::pair<ScanReader::Policy, const char*>> policies = {
+        { ScanReader::Cached, "indexing.cold.cached" },
+        { ScanReader::Sequential, "indexing.cold.sequential" },
+        { ScanReader::Direct, "indexing.cold.direct" } };
+
+    for ( const auto& policy : policies ) {
+        ScanReader::setPolicy( policy.first );
+        dropFromCache( dataset.fileName );
+
+        LogData log_data;
+        {
+            Benchmark b( policy.second, profiles[0].name, dataset.size, dataset.nbLines );
+            ASSERT_TRUE( load( &log_data, dataset ) );
+            b.extra[ "cached_bytes" ] = double( cachedSize( dataset.fileName ) );
+        }
+        ASSERT_THAT( log_data.getNbLine(), dataset.nbLines );
+    }
+
+    ScanReader::setPolicy( ScanReader::Cached );
+}
+
+TEST_F( Benchmarks, search ) {
+    for ( size_t i = 0; i < profiles.size(); i++ ) {
+        const LogDataset& dataset = datasets()[i];
+        LogData log_data;
+        ASSERT_TRUE( load( &log_data, dataset ) );
+        std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+
+        // Sparse or dense depending on the profile
+        {
+            Benchmark b( "search.literal", profiles[i].name, dataset.size, dataset.nbLines );
+            search( filtered_data.get(), QRegExp( benchmarkNeedle ) );
+        }
+        ASSERT_THAT( filtered_data->getNbMatches(), dataset.nbMatches );
+
+        {
+            Benchmark b( "search.regexp", profiles[i].name, dataset.size, dataset.nbLines );
+            search( filtered_data.get(), QRegExp( "status=5\\d\\d.*retry" ) );
+        }
+
+        {
+            Benchmark b( "search.nomatch", profiles[i].name, dataset.size, dataset.nbLines );
+            search( filtered_data.get(), QRegExp( "xyzzy" ) );
+        }
+        ASSERT_THAT( filtered_data->getNbMatches(), 0 );
+    }
+}
+
+TEST_F( Benchmarks, searchChunks ) {
+    // The lines shortest and longest, the chunks searched being
+    // sized in bytes whatever their number of lines.
+    const std::vector<LogProfile> chunkProfiles = {
+        { "short", 5000000, 30, 40, 0.0, 0.0, 0.0, 0, 1000 },
+        profiles[2] };
+
+    for ( const LogProfile& profile : chunkProfiles ) {
+        const LogDataset dataset = generateLog( profile,
+                QString( TMPDIR "/benchmark_chunks_%1.txt" ).arg( profile.name ) );
+        LogData log_data;
+        ASSERT_TRUE( load( &log_data, dataset ) );
+        std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+
+        PerfCounters::reset();
+        {
+            Benchmark b( "search.chunks", profile.name, dataset.size, dataset.nbLines );
+            search( filtered_data.get(), QRegExp( "status=5\\d\\d.*retry" ) );
+
+            const QJsonObject latency = QJsonDocument::fromJson(
+                    PerfCounters::toJson().toUtf8() ).object()[ "histograms" ]
+                .toObject()[ PerfCounters::name( PerfCounters::SearchChunkLatency ) ]
+                .toObject();
+            const double nb_chunks = latency[ "count" ].toDouble();
+            b.extra[ "chunks" ] = nb_chunks;
+            b.extra[ "lines_per_chunk" ] = nb_chunks > 0 ? dataset.nbLines / nb_chunks : 0.0;
+            b.extra[ "chunk_latency_mean_ms" ] = nb_chunks > 0 ?
+                latency[ "total_ns" ].toDouble() / nb_chunks / 1e6 : 0.0;
+            b.extra[ "chunk_latency_max_ms" ] = latency[ "max_ns" ].toDouble() / 1e6;
+        }
+    }
+}
+
+TEST_F( Benchmarks, quickFind ) {
+    for ( size_t i = 0; i < profiles.size(); i++ ) {
+        const LogDataset& dataset = datasets()[i];
+        LogData log_data;
+        ASSERT_TRUE( load( &log_data, dataset ) );
+
+        // Through the whole file, as a search for a missing pattern
+        QuickFindWorker worker( &log_data );
+        SafeQSignalSpy finishedSpy( &worker, SIGNAL( searchFinished( bool ) ) );
+        {
+            Benchmark b( "quickfind", profiles[i].name, dataset.size, dataset.nbLines );
+            worker.search( QRegExp( "xyzzy" ), FilePosition( 0, 0 ), true );
+            ASSERT_TRUE( finishedSpy.safeWait( 600000 ) );
+        }
+        ASSERT_THAT( finishedSpy.last().at( 0 ).toBool(), true );
+    }
+}
+
+TEST_F( Benchmarks, lineFetch ) {
+    for ( size_t i = 0; i < profiles.size(); i++ ) {
+        const LogDataset& dataset = datasets()[i];
+        LogData log_data;
+        ASSERT_TRUE( load( &log_data, dataset ) );
+
+        // Page by page, as the view paints them while scrolled
+        LineBuffer lines;
+        {
+            Benchmark b( "linefetch", profiles[i].name, dataset.size, dataset.nbLines );
+            for ( qint64 first = 0; first < dataset.nbLines; first += PAGE_NB_LINES ) {
+                log_data.getExpandedLines( first, PAGE_NB_LINES, &lines );
+                ASSERT_THAT( lines.size(),
+                        qMin<qint64>( PAGE_NB_LINES, dataset.nbLines - first ) );
+            }
+        }
+
+        // Random pages, the cache being of no use
+        std::mt19937_64 random( 42 );
+        const int nbPages = 10000;
+        {
+            Benchmark b( "linefetch.random", profiles[i].name, 0,
+                    nbPages * PAGE_NB_LINES );
+            for ( int page = 0; page < nbPages; page++ ) {
+                const qint64 first = random() % ( dataset.nbLines - PAGE_NB_LINES );
+                log_data.getExpandedLines( first, PAGE_NB_LINES, &lines );
+                for ( int j = 0; j < lines.size(); j++ )
+                    b.bytes += lines.length( j );
+            }
+        }
+    }
+}
+
+TEST_F( Benchmarks, follow ) {
+    // The file grows by chunks of lines, each being indexed (and
+    // searched) before the next one is written.
+    const LogProfile& profile = profiles[0];
+    const int nbChunks = 200;
+    const int chunkNbLines = 5000;
+
+    QFile file( TMPDIR "/benchmark_follow.txt" );
+    file.open( QIODevice::WriteOnly );
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    log_data.attachFile( file.fileName() );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    search( filtered_data.get(), QRegExp( benchmarkNeedle ) );
+
+    std::mt19937_64 random( 42 );
+    qint64 line = 0;
+    {
+        Benchmark b( "follow", profile.name, 0, qint64( nbChunks ) * chunkNbLines );
+        for ( int chunk = 0; chunk < nbChunks; chunk++ ) {
+            QByteArray data;
+            for ( int j = 0; j < chunkNbLines; j++, line++ )
+                data.append( generateLine( profile, line, random ) + '\n' );
+            b.bytes += data.size();
+
+            endSpy.clear();
+            ASSERT_TRUE( file.open( QIODevice::Append ) );
+            file.write( data );
+            file.close();
+            ASSERT_TRUE( endSpy.wait( 10000 ) );
+        }
+    }
+    ASSERT_THAT( log_data.getNbLine(), line );
+}
+
+// Appends lines to a file at a rate (in bytes per second) in a thread,
+// the file being rotated as logrotate does at an interval, and records
+// when each write ended with the number of lines written by then.
+class RateWriter {
+  public:
+    struct Write {
+        std::chrono::steady_clock::time_point time;
+        qint64 nbLines;
+    };
+
+    RateWriter( const QString& file_name, const std::vector<QByteArray>& lines,
+            double bytes_per_second, std::chrono::milliseconds duration,
+            std::chrono::milliseconds rotation_interval )
+        : fileName_( file_name ), lines_( lines ),
+        bytesPerSecond_( bytes_per_second ), duration_( duration ),
+        rotationInterval_( rotation_interval ), nbBytes_( 0 ),
+        nbRotations_( 0 ), done_( false ), mutex_(), writes_(), thread_()
+    {}
+
+    ~RateWriter() { join(); }
+
+    void start() { thread_ = std::thread( [this] { run(); } ); }
+    void join() { if ( thread_.joinable() ) thread_.join(); }
+    bool isDone() const { return done_; }
+
+    qint64 nbBytes() const { return nbBytes_; }
+    int nbRotations() const { return nbRotations_; }
+
+    // Move the writes recorded since the previous call to writes
+    void takeWrites( std::vector<Write>* writes )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        writes->insert( writes->end(), writes_.begin(), writes_.end() );
+        writes_.clear();
+    }
+
+  private:
+    void run()
+    {
+        using namespace std::chrono;
+
+        QFile file( fileName_ );
+        file.open( QIODevice::Append );
+
+        const auto start = steady_clock::now();
+        auto rotated = start;
+        qint64 nb_lines = 0;
+        size_t next = 0;
+        QByteArray data;
+        while ( steady_clock::now() - start < duration_ ) {
+            const auto now = steady_clock::now();
+            if ( now - rotated >= rotationInterval_ ) {
+                file.close();
+                QFile::remove( fileName_ + ".2" );
+                QFile::rename( fileName_ + ".1", fileName_ + ".2" );
+                QFile::rename( fileName_, fileName_ + ".1" );
+                file.open( QIODevice::WriteOnly );
+                rotated = now;
+                nbRotations_++;
+            }
+
+            // Catch up with the rate, by whole lines
+            const double target =
+                bytesPerSecond_ * duration<double>( now - start ).count();
+            data.clear();
+            while ( nbBytes_ + data.size() < target ) {
+                data.append( lines_[next] );
+                next = ( next + 1 ) % lines_.size();
+                nb_lines++;
+            }
+
+            if ( ! data.isEmpty() ) {
+                file.write( data );
+                file.flush();
+                nbBytes_ += data.size();
+
+                std::lock_guard<std::mutex> lock( mutex_ );
+                writes_.push_back( { steady_clock::now(), nb_lines } );
+            }
+
+            std::this_thread::sleep_for( milliseconds( 5 ) );
+        }
+
+        done_ = true;
+    }
+
+    const QString fileName_;
+    const std::vector<QByteArray>& lines_;
+    const double bytesPerSecond_;
+    const std::chrono::milliseconds duration_;
+    const std::chrono::milliseconds rotationInterval_;
+    std::atomic<qint64> nbBytes_;
+    std::atomic<int> nbRotations_;
+    std::atomic<bool> done_;
+    std::mutex mutex_;
+    std::vector<Write> writes_;
+    std::thread thread_;
+};
+
+TEST_F( Benchmarks, followLatency ) {
+    // The time from a line being written to the file being signalled
+    // as changed, to the line being indexed and to it being searched,
+    // through the watcher, LogData and LogFilteredData as the GUI uses
+    // them, for a writer at each rate (in MB/s) of GLOGG_FOLLOW_RATES.
+    using namespace std::chrono;
+
+    const char* rates_variable = getenv( "GLOGG_FOLLOW_RATES" );
+    const QStringList rates =
+        QString( rates_variable ? rates_variable : "1,10,100" ).split( ',' );
+    const milliseconds duration( 5000 );
+    const milliseconds rotationInterval( 2000 );
+
+    // Every line matches the search
+    LogProfile profile = profiles[0];
+    profile.longLineRatio = 0.0;
+    profile.matchInterval = 1;
+    std::vector<QByteArray> lines;
+    std::mt19937_64 random( 42 );
+    for ( int i = 0; i < 10000; i++ )
+        lines.push_back( generateLine( profile, i, random ) + '\n' );
+
+    for ( const QString& rate : rates ) {
+        const QString file_name = TMPDIR "/benchmark_follow_latency.txt";
+        QFile::remove( file_name + ".1" );
+        QFile::remove( file_name + ".2" );
+        QFile file( file_name );
+        file.open( QIODevice::WriteOnly );
+        file.close();
+
+        LogData log_data;
+        log_data.setFollowRotation( true );
+        SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+        log_data.attachFile( file_name );
+        ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+        std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+        search( filtered_data.get(), QRegExp( benchmarkNeedle ) );
+
+        // The writes each step has caught up with, and their latencies
+        // (in ms): a write has reached a step when the step has been
+        // signalled after it, with at least its lines.
+        struct Step {
+            size_t nbReached;
+            std::vector<double> latencies;
+        };
+        Step changed = { 0, {} }, indexed = { 0, {} }, searched = { 0, {} };
+        std::vector<RateWriter::Write> writes;
+        RateWriter writer( file_name, lines, rate.toDouble() * 1024 * 1024,
+                duration, rotationInterval );
+        auto reach = [&writer, &writes] ( Step* step, qint64 nb_lines ) {
+            const auto now = steady_clock::now();
+            writer.takeWrites( &writes );
+            while ( step->nbReached < writes.size()
+                    && writes[ step->nbReached ].nbLines <= nb_lines
+                    && writes[ step->nbReached ].time <= now ) {
+                step->latencies.push_back( duration_cast<microseconds>(
+                            now - writes[ step->nbReached ].time ).count() / 1000.0 );
+                step->nbReached++;
+            }
+        };
+
+        // The search is updated when the file has been indexed, as
+        // CrawlerWidget does
+        const std::vector<QMetaObject::Connection> connections = {
+            QObject::connect( &log_data, &LogData::fileChanged,
+                    [&] ( LogData::MonitoredFileStatus ) {
+                        reach( &changed, std::numeric_limits<qint64>::max() ); } ),
+            QObject::connect( &log_data, &LogData::loadingFinished,
+                    [&] ( LoadingStatus ) {
+                        reach( &indexed, log_data.getNbLine() );
+                        filtered_data->updateSearch(); } ),
+            QObject::connect( filtered_data.get(), &LogFilteredData::searchProgressed,
+                    [&] ( qint64 nb_matches, int progress ) {
+                        if ( progress == 100 )
+                            reach( &searched, nb_matches ); } ) };
+
+        const QByteArray dataset = ( rate + "MBps" ).toLatin1();
+        {
+            Benchmark b( "followLatency", dataset.constData(), 0, 0 );
+            writer.start();
+            while ( ! writer.isDone() )
+                QTest::qWait( 10 );
+            writer.join();
+            writer.takeWrites( &writes );
+
+            // Until the last write is searched (or given up on)
+            const auto end = steady_clock::now() + seconds( 30 );
+            while ( searched.nbReached < writes.size() && steady_clock::now() < end )
+                QTest::qWait( 10 );
+
+            b.bytes = writer.nbBytes();
+            b.lines = writes.empty() ? 0 : writes.back().nbLines;
+            b.extra[ "writes" ] = double( writes.size() );
+            b.extra[ "rotations" ] = writer.nbRotations();
+            const std::vector<std::pair<const char*, const Step*>> steps = {
+                { "changed", &changed }, { "indexed", &indexed },
+                { "searched", &searched } };
+            for ( const auto& step : steps ) {
+                const QString name = step.first;
+                const std::vector<double>& latencies = step.second->latencies;
+                b.extra[ name + "_p50_ms" ] = percentile( latencies, 0.5 );
+                b.extra[ name + "_p90_ms" ] = percentile( latencies, 0.9 );
+                b.extra[ name + "_p99_ms" ] = percentile( latencies, 0.99 );
+                b.extra[ name + "_max_ms" ] = percentile( latencies, 1.0 );
+                b.extra[ name + "_missed" ] =
+                    double( writes.size() - step.second->nbReached );
+
+                std::cout << name.toStdString() << ": p50 "
+                    << percentile( latencies, 0.5 ) << " ms, p99 "
+                    << percentile( latencies, 0.99 ) << " ms, "
+                    << writes.size() - step.second->nbReached << " missed"
+                    << std::endl;
+            }
+        }
+
+        for ( const auto& connection : connections )
+            QObject::disconnect( connection );
+
+        ASSERT_THAT( searched.nbReached, writes.size() );
+    }
+}
+
+TEST_F( Benchmarks, startup ) {
+    // As main() does, with settings of their own
+    QStandardPaths::setTestModeEnabled( true );
+    GetPersistentInfo().migrateAndInit();
+    GetPersistentInfo().registerPersistable(
+            std::make_shared<SessionInfo>(), QString( "session" ) );
+    GetPersistentInfo().registerPersistable(
+            std::make_shared<Configuration>(), QString( "settings" ) );
+    GetPersistentInfo().registerPersistable(
+            std::make_shared<FilterSet>(), QString( "filterSet" ) );
+    GetPersistentInfo().registerPersistable(
+            std::make_shared<SavedSearches>(), QString( "savedSearches" ) );
+    GetPersistentInfo().registerPersistable(
+            std::make_shared<RecentFiles>(), QString( "recentFiles" ) );
+    GetPersistentInfo().retrieve( QString( "settings" ) );
+
+    // A session of all the datasets, to be restored
+    std::vector<SessionInfo::OpenFile> files;
+    for ( const LogDataset& dataset : datasets() )
+        files.push_back( { dataset.fileName.toStdString(), 0, "",
+                uint64_t( dataset.size ), uint32_t( dataset.nbLines ) } );
+    Persistent<SessionInfo>( "session" )->setOpenFiles( files );
+    GetPersistentInfo().save( QString( "session" ) );
+
+    // Until the main window is displayed with the session restored, then
+    // the background tasks being run, as after a launch.
+    auto launch = [] () {
+        std::unique_ptr<MainWindow> mw( new MainWindow(
+                    std::unique_ptr<Session>( new Session() ), nullptr ) );
+        mw->show();
+        mw->reloadSession();
+        const bool exposed = QTest::qWaitForWindowExposed( mw.get() );
+        mw->startBackgroundTasks();
+        return exposed;
+    };
+
+    // The first window of the process loads the fonts, styles...
+    // (and the files, if the system caches are dropped before the run)
+    {
+        Benchmark b( "startup.cold", "session", 0, 1 );
+        ASSERT_TRUE( launch() );
+    }
+
+    const int nbLaunches = 20;
+    {
+        Benchmark b( "startup.warm", "session", 0, nbLaunches );
+        for ( int i = 0; i < nbLaunches; i++ )
+            ASSERT_TRUE( launch() );
+    }
+}
+
+TEST_F( Benchmarks, logging ) {
+    // The cost of a statement in a hot loop when it is below the
+    // reporting level (checked at run time), and when it is above
+    // FILELOG_MAX_LEVEL (compiled out).
+    const qint64 nbStatements = 100000000;
+    volatile qint64 sink = 0;
+    {
+        Benchmark b( "log.runtime", "statements", 0, nbStatements );
+        for ( qint64 i = 0; i < nbStatements; i++ ) {
+            sink = sink + i;
+            LOG(logDEBUG) << "statement " << i;
+        }
+    }
+
+    {
+        Benchmark b( "log.compiledout", "statements", 0, nbStatements );
+        for ( qint64 i = 0; i < nbStatements; i++ ) {
+            sink = sink + i;
+            LOG(logDEBUG4) << "statement " << i;
+        }
+    }
+}
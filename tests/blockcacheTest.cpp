@@ -0,0 +1,81 @@
+#include <vector>
+
+#include "gmock/gmock.h"
+
+#include "data/blockcache.h"
+
+using namespace std;
+using namespace testing;
+
+class BlockCacheBehaviour : public testing::Test {
+  public:
+    BlockCacheBehaviour() : source(), fetched()
+    {
+        for ( int i = 0; i < 10000; i++ )
+            source.append( QByteArray::number( i ) + " some log line\n" );
+    }
+
+    // Fetches the blocks of 1000 bytes of the source, counting them
+    BlockCache::Fetch fetch()
+    {
+        return [this]( qint64 block ) {
+            fetched.push_back( block );
+            return source.mid( block * 1000, 1000 );
+        };
+    }
+
+    QByteArray source;
+    vector<qint64> fetched;
+};
+
+TEST_F( BlockCacheBehaviour, readsTheBlocksOnce ) {
+    BlockCache cache( 1000, 1024 * 1024 );
+
+    QByteArray data( 2500, '\0' );
+    ASSERT_TRUE( cache.read( 1500, data.data(), data.size(), fetch() ) );
+    ASSERT_THAT( data, Eq( source.mid( 1500, 2500 ) ) );
+    ASSERT_THAT( fetched, ElementsAre( 1, 2, 3 ) );
+
+    ASSERT_TRUE( cache.read( 1000, data.data(), data.size(), fetch() ) );
+    ASSERT_THAT( data, Eq( source.mid( 1000, 2500 ) ) );
+    ASSERT_THAT( fetched, ElementsAre( 1, 2, 3 ) );
+}
+
+TEST_F( BlockCacheBehaviour, readsTheLastBlockAgain ) {
+    BlockCache cache( 1000, 1024 * 1024 );
+    const qint64 end = source.size();
+
+    QByteArray data( 10, '\0' );
+    ASSERT_TRUE( cache.read( end - 10, data.data(), data.size(), fetch() ) );
+    ASSERT_TRUE( cache.read( end - 10, data.data(), data.size(), fetch() ) );
+    ASSERT_THAT( fetched.size(), 2u );
+
+    // (past the end)
+    ASSERT_FALSE( cache.read( end - 10, data.data(), 20, fetch() ) );
+}
+
+TEST_F( BlockCacheBehaviour, dropsTheBlocksChanged ) {
+    BlockCache cache( 1000, 1024 * 1024 );
+
+    QByteArray data( 3000, '\0' );
+    ASSERT_TRUE( cache.read( 0, data.data(), data.size(), fetch() ) );
+    cache.invalidateFrom( 1500 );
+    ASSERT_TRUE( cache.contains( 0 ) );
+    ASSERT_FALSE( cache.contains( 1 ) );
+    ASSERT_FALSE( cache.contains( 2 ) );
+
+    cache.clear();
+    ASSERT_FALSE( cache.contains( 0 ) );
+}
+
+TEST_F( BlockCacheBehaviour, keepsTheBlocksWithinTheBudget ) {
+    // Room for a few compressed blocks only
+    BlockCache cache( 1000, 2000 );
+
+    QByteArray data( 1000, '\0' );
+    for ( int block = 0; block < 50; block++ )
+        ASSERT_TRUE( cache.read( block * 1000, data.data(), data.size(), fetch() ) );
+
+    ASSERT_TRUE( cache.contains( 49 ) );
+    ASSERT_FALSE( cache.contains( 0 ) );
+}
@@ -0,0 +1,31 @@
+#include <vector>
+
+#include "gmock/gmock.h"
+
+#include "data/bufferpool.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( BufferPoolBehaviour, reusesTheBufferGivenBack ) {
+    BufferPool<vector<int>> pool;
+    vector<int>* first;
+    {
+        auto buffer = pool.acquire();
+        buffer->assign( 1000, 42 );
+        first = buffer.get();
+    }
+
+    // The same buffer, as it was left
+    auto buffer = pool.acquire();
+    ASSERT_THAT( buffer.get(), Eq( first ) );
+    ASSERT_THAT( buffer->size(), Eq( 1000u ) );
+}
+
+TEST( BufferPoolBehaviour, makesABufferForEachTaker ) {
+    BufferPool<vector<int>> pool;
+    auto first = pool.acquire();
+    auto second = pool.acquire();
+
+    ASSERT_THAT( first.get(), Ne( second.get() ) );
+}
@@ -0,0 +1,90 @@
+#include <QByteArray>
+
+#include "test_utils.h"
+
+#include "data/bytescanner.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+static const int BUFFER_SIZE = 64*1024*1024;
+static const char* line_format =
+    "LOGDATA is a part of glogg, we are going to test it thoroughly, this is line\t\t%07d\n";
+
+class PerfByteScanner : public testing::Test {
+  public:
+    PerfByteScanner() : buffer() {
+        char newLine[90];
+
+        buffer.reserve( BUFFER_SIZE );
+        for ( int i = 0; buffer.size() < BUFFER_SIZE - 90; i++ ) {
+            snprintf( newLine, 89, line_format, i );
+            buffer.append( newLine );
+        }
+    }
+
+    // The byte by byte loop previously used by IndexOperation::doIndex
+    int countWithByteLoop() const {
+        int found = 0;
+        for ( int i = 0; i < buffer.length(); i++ ) {
+            const char c = buffer.at( i );
+            if ( c == '\n' || c == '\t' )
+                found++;
+        }
+
+        return found;
+    }
+
+    int countWithKernel() const {
+        const char* data = buffer.constData();
+        const int length = buffer.length();
+
+        int found = 0;
+        int i = findEndOfLineOrTab( data, length );
+        while ( i < length ) {
+            found++;
+            i++;
+            i += findEndOfLineOrTab( data + i, length - i );
+        }
+
+        return found;
+    }
+
+    QByteArray buffer;
+};
+
+TEST_F( PerfByteScanner, byteLoop ) {
+    int found;
+    {
+        TestTimer t;
+
+        found = countWithByteLoop();
+    }
+
+    // Three special characters per line
+    ASSERT_THAT( found, buffer.count( '\n' ) * 3 );
+}
+
+TEST_F( PerfByteScanner, vectorKernel ) {
+    int found;
+    {
+        TestTimer t( std::string( "PerfByteScanner.vectorKernel (" )
+                + byteScannerKernelName() + ")" );
+
+        found = countWithKernel();
+    }
+
+    ASSERT_THAT( found, countWithByteLoop() );
+}
+
+TEST_F( PerfByteScanner, kernelMatchesScalarAtAllAlignments ) {
+    const char* data = buffer.constData();
+
+    for ( int offset = 0; offset < 64; offset++ ) {
+        for ( int length = 0; length < 200; length++ ) {
+            ASSERT_THAT( findEndOfLineOrTab( data + offset, length ),
+                    findEndOfLineOrTabScalar( data + offset, length ) );
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include <QBuffer>
+
+#include "gmock/gmock.h"
+
+#include "data/checkpointindex.h"
+
+using namespace std;
+using namespace testing;
+
+class CheckpointIndexBehaviour : public testing::Test {
+  public:
+    CheckpointIndexBehaviour() : data_(), buffer_( &data_ )
+    {
+        // 1000 lines of 10 bytes
+        for ( int i = 0; i < 1000; i++ )
+            data_.append( QString( "line%1\n" ).arg( i, 5, 10, QChar( '0' ) )
+                    .toLatin1() );
+        buffer_.open( QIODevice::ReadOnly );
+    }
+
+  protected:
+    QByteArray data_;
+    QBuffer buffer_;
+};
+
+TEST_F( CheckpointIndexBehaviour, isEmptyBeforeBeingBuilt ) {
+    CheckpointIndex index;
+    ASSERT_TRUE( index.isEmpty() );
+    ASSERT_THAT( index.nbLines(), Eq( 0 ) );
+    ASSERT_THAT( index.lineAt( 500 ), Eq( 0 ) );
+}
+
+TEST_F( CheckpointIndexBehaviour, countsTheLinesOfWholeWindows ) {
+    CheckpointIndex index;
+    ASSERT_TRUE( index.build( &buffer_, data_.size(), 10, 1000 ) );
+
+    ASSERT_THAT( index.checkpoints().size(), Eq( 11u ) );
+    ASSERT_THAT( index.size(), Eq( 10000 ) );
+    ASSERT_THAT( index.nbLines(), Eq( 1000 ) );
+    ASSERT_THAT( index.lineAt( 5000 ), Eq( 500 ) );
+    ASSERT_THAT( index.positionOf( 500 ), Eq( 5000 ) );
+}
+
+TEST_F( CheckpointIndexBehaviour, extrapolatesFromPartialWindows ) {
+    CheckpointIndex index;
+    ASSERT_TRUE( index.build( &buffer_, data_.size(), 10, 100 ) );
+
+    ASSERT_THAT( index.nbLines(), Eq( 1000 ) );
+    ASSERT_THAT( index.lineAt( 2500 ), Eq( 250 ) );
+    ASSERT_THAT( index.lineAt( 20000 ), Eq( 1000 ) );
+    ASSERT_THAT( index.positionOf( 2000 ), Eq( 10000 ) );
+}
+
+TEST_F( CheckpointIndexBehaviour, countsAnUnterminatedLastLine ) {
+    data_.append( "last" );
+    CheckpointIndex index;
+    ASSERT_TRUE( index.build( &buffer_, data_.size(), 10, 1000 ) );
+
+    ASSERT_THAT( index.nbLines(), Eq( 1001 ) );
+}
+
+TEST_F( CheckpointIndexBehaviour, findsTheNextLineStart ) {
+    ASSERT_THAT( CheckpointIndex::lineStartAfter( &buffer_, data_.size(), 0 ),
+            Eq( 0 ) );
+    ASSERT_THAT( CheckpointIndex::lineStartAfter( &buffer_, data_.size(), 5000 ),
+            Eq( 5000 ) );
+    ASSERT_THAT( CheckpointIndex::lineStartAfter( &buffer_, data_.size(), 5005 ),
+            Eq( 5010 ) );
+    ASSERT_THAT( CheckpointIndex::lineStartAfter( &buffer_, data_.size(), 9995 ),
+            Eq( 10000 ) );
+}
@@ -0,0 +1,49 @@
+#include <string>
+
+#include "gmock/gmock.h"
+
+#include "data/columnindex.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( ColumnIndexBehaviour, recordsTheColumnsOfTheCharacters ) {
+    // Tabs and multi-byte characters (some cut by the pieces)
+    string line;
+    for ( int i = 0; line.size() < 300000; i++ )
+        line.append( ( i % 7 == 0 ) ? "\t" : "caf\xC3\xA9 \xE6\x97\xA5 " );
+
+    const TextEncoding encoding( TextEncoding::Utf8 );
+    const ColumnIndex::Checkpoints checkpoints =
+        ColumnIndex::checkpoints( encoding, line.data(), line.size() );
+
+    ASSERT_THAT( checkpoints.size(),
+            line.size() / ColumnIndex::checkpointInterval + 1 );
+    ASSERT_THAT( checkpoints[0].offset, 0LL );
+    ASSERT_THAT( checkpoints[0].column, 0 );
+
+    // The columns are those of the line decoded up to the checkpoint
+    LineDecoder decoder( encoding );
+    for ( const ColumnIndex::Checkpoint& checkpoint : checkpoints ) {
+        ASSERT_THAT( (unsigned char) line[ checkpoint.offset ] & 0xC0, Ne( 0x80 ) );
+        ASSERT_THAT( checkpoint.column, decoder.decode( line.data(),
+                    checkpoint.offset, true ).size() );
+    }
+}
+
+TEST( ColumnIndexBehaviour, findsTheLinesRecorded ) {
+    ColumnIndex index;
+    ColumnIndex::Checkpoints checkpoints;
+
+    index.add( 100, 200000, { { 0, 0 }, { 65536, 70000 } } );
+    ASSERT_TRUE( index.find( 100, 200000, &checkpoints ) );
+    ASSERT_THAT( checkpoints.size(), 2u );
+    ASSERT_THAT( checkpoints[1].column, 70000 );
+
+    // Not the same line anymore
+    ASSERT_FALSE( index.find( 100, 150000, &checkpoints ) );
+    ASSERT_FALSE( index.find( 200, 200000, &checkpoints ) );
+
+    index.clear();
+    ASSERT_FALSE( index.find( 100, 200000, &checkpoints ) );
+}
@@ -0,0 +1,73 @@
+#include "gmock/gmock.h"
+
+#include "data/compiledregexp.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( CompiledRegExpBehaviour, matchesAsQRegExp ) {
+    const CompiledRegExp regexp( QRegExp( "status=5\\d\\d", Qt::CaseSensitive,
+                QRegExp::RegExp2 ) );
+
+    int length = 0;
+    ASSERT_THAT( regexp.indexIn( "GET / status=503 in 12 ms", 0, &length ), 6 );
+    ASSERT_THAT( length, 10 );
+    ASSERT_THAT( regexp.indexIn( "GET / status=503", 7 ), -1 );
+    ASSERT_THAT( regexp.indexIn( "GET / status=200" ), -1 );
+}
+
+TEST( CompiledRegExpBehaviour, keepsTheOptionsOfThePattern ) {
+    ASSERT_THAT( CompiledRegExp( QRegExp( "ERROR", Qt::CaseInsensitive ) )
+            .indexIn( "an error" ), 3 );
+    ASSERT_THAT( CompiledRegExp( QRegExp( "a.c", Qt::CaseSensitive,
+                    QRegExp::FixedString ) ).indexIn( "abc a.c" ), 4 );
+    ASSERT_THAT( CompiledRegExp( QRegExp( "st*s", Qt::CaseSensitive,
+                    QRegExp::Wildcard ) ).indexIn( "the status" ), 4 );
+    ASSERT_THAT( CompiledRegExp( QRegExp( "[]a]?.c", Qt::CaseSensitive,
+                    QRegExp::Wildcard ) ).indexIn( "abc ]x.c" ), 4 );
+    ASSERT_THAT( CompiledRegExp( QRegExp( "a\\*", Qt::CaseSensitive,
+                    QRegExp::WildcardUnix ) ).indexIn( "ab a*" ), 3 );
+
+    QRegExp minimal( "<.+>" );
+    minimal.setMinimal( true );
+    int length = 0;
+    CompiledRegExp( minimal ).indexIn( "<a><b>", 0, &length );
+    ASSERT_THAT( length, 3 );
+}
+
+TEST( CompiledRegExpBehaviour, findsTheLastMatch ) {
+    const CompiledRegExp regexp( QRegExp( "ab" ) );
+
+    int length = 0;
+    ASSERT_THAT( regexp.lastIndexIn( "ab ab ab", -1, &length ), 6 );
+    ASSERT_THAT( length, 2 );
+    ASSERT_THAT( regexp.lastIndexIn( "ab ab ab", 5 ), 3 );
+    ASSERT_THAT( regexp.lastIndexIn( "ab ab ab", 0 ), 0 );
+    ASSERT_THAT( regexp.lastIndexIn( "ba ba", -1 ), -1 );
+}
+
+TEST( CompiledRegExpBehaviour, returnsTheFirstCapture ) {
+    QString capture;
+    ASSERT_THAT( CompiledRegExp( QRegExp( "at (\\d+):(\\d+)" ) )
+            .indexIn( "started at 12:34", 0, nullptr, &capture ), 8 );
+    ASSERT_THAT( capture, QString( "12" ) );
+
+    CompiledRegExp( QRegExp( "\\d+" ) ).indexIn( "at 12", 0, nullptr, &capture );
+    ASSERT_THAT( capture, QString( "12" ) );
+}
+
+TEST( CompiledRegExpBehaviour, abandonsThePatternsBacktrackingTooMuch ) {
+    const QRegExp backtracking( "(a+)+b" );
+    const CompiledRegExp regexp( backtracking );
+
+    ASSERT_THAT( regexp.indexIn( "xx aab" ), 3 );
+    ASSERT_FALSE( regexp.isTooCostly() );
+
+    ASSERT_THAT( regexp.indexIn( QString( 40, 'a' ) + "cb" ), -1 );
+    ASSERT_TRUE( regexp.isTooCostly() );
+    ASSERT_TRUE( CompiledRegExp::isTooCostly( backtracking ) );
+    // and then matches nothing
+    ASSERT_THAT( regexp.indexIn( "xx aab" ), -1 );
+
+    ASSERT_FALSE( CompiledRegExp::isTooCostly( QRegExp( "a+b" ) ) );
+}
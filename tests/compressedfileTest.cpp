@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+#include "gmock/gmock.h"
+
+#include "data/compressedfile.h"
+
+using namespace std;
+using namespace testing;
+
+#ifdef GLOGG_SUPPORTS_GZIP
+
+#include <zlib.h>
+
+static const char* gz_file = "/tmp/glogg_compressed.gz";
+
+class CompressedFileBehaviour : public testing::Test {
+  public:
+    CompressedFileBehaviour() {
+        // Numbered lines so any range read is different from its
+        // neighbours
+        for ( int i = 0; (int64_t) data_.size() < 3 * CompressedFile::checkpointSpacing; i++ ) {
+            char line[64];
+            snprintf( line, sizeof( line ), "%08d some log line of text %d\n", i, i * 7 );
+            data_ += line;
+        }
+    }
+
+    ~CompressedFileBehaviour() {
+        remove( gz_file );
+    }
+
+    // Writes each part as a gzip member
+    void writeGzip( const vector<string>& parts ) {
+        FILE* file = fopen( gz_file, "wb" );
+        for ( const string& part : parts ) {
+            gzFile gz = gzdopen( dup( fileno( file ) ), "ab" );
+            gzwrite( gz, part.data(), part.size() );
+            gzclose( gz );
+            fseek( file, 0, SEEK_END );
+        }
+        fclose( file );
+    }
+
+    string decompressAll( CompressedFile& file ) {
+        string result;
+        file.readAll( [&result]( const char* data, size_t length, int64_t ) {
+                result.append( data, length );
+                return true; } );
+        return result;
+    }
+
+    string read( CompressedFile& file, int64_t position, int64_t length ) {
+        string result( length, '\0' );
+        if ( ! file.read( position, &result[0], length ) )
+            return "failed";
+        return result;
+    }
+
+    string data_;
+};
+
+TEST_F( CompressedFileBehaviour, detectsTheFormat ) {
+    writeGzip( { data_.substr( 0, 1000 ) } );
+
+    ASSERT_THAT( CompressedFile::detectFormat( gz_file ),
+            CompressedFile::Format::Gzip );
+    ASSERT_THAT( CompressedFile::isSupported( CompressedFile::Format::Gzip ), true );
+}
+
+TEST_F( CompressedFileBehaviour, decompressesTheWholeFile ) {
+    writeGzip( { data_ } );
+
+    CompressedFile file( gz_file, CompressedFile::Format::Gzip );
+    ASSERT_THAT( decompressAll( file ) == data_, true );
+    ASSERT_THAT( file.size(), data_.size() );
+}
+
+TEST_F( CompressedFileBehaviour, readsAnywhereInTheFile ) {
+    writeGzip( { data_ } );
+
+    CompressedFile file( gz_file, CompressedFile::Format::Gzip );
+    decompressAll( file );
+
+    // Backward, around the checkpoints and forward from the previous read
+    const int64_t positions[] = { (int64_t) data_.size() - 100, 0,
+        CompressedFile::checkpointSpacing - 10, CompressedFile::checkpointSpacing + 5000,
+        2 * CompressedFile::checkpointSpacing + 123, 1234567 };
+    for ( int64_t position : positions )
+        ASSERT_THAT( read( file, position, 100 ), data_.substr( position, 100 ) );
+}
+
+TEST_F( CompressedFileBehaviour, readsAcrossMembers ) {
+    const size_t split = data_.size() / 2 + 17;
+    writeGzip( { data_.substr( 0, split ), data_.substr( split ) } );
+
+    CompressedFile file( gz_file, CompressedFile::Format::Gzip );
+    ASSERT_THAT( decompressAll( file ) == data_, true );
+
+    ASSERT_THAT( read( file, split - 50, 100 ), data_.substr( split - 50, 100 ) );
+    ASSERT_THAT( read( file, split + 2000000, 100 ), data_.substr( split + 2000000, 100 ) );
+    ASSERT_THAT( read( file, 10, 100 ), data_.substr( 10, 100 ) );
+}
+
+TEST_F( CompressedFileBehaviour, refusesReadsPastTheEnd ) {
+    writeGzip( { data_.substr( 0, 1000 ) } );
+
+    CompressedFile file( gz_file, CompressedFile::Format::Gzip );
+    decompressAll( file );
+
+    ASSERT_THAT( read( file, 950, 100 ), "failed" );
+}
+
+#endif
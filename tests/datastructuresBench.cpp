@@ -0,0 +1,298 @@
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QColor>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include "log.h"
+#include "utils.h"
+#include "marks.h"
+#include "filterset.h"
+#include "quickfindpattern.h"
+#include "persistentinfo.h"
+#include "configuration.h"
+
+#include "data/abstractlogdata.h"
+#include "data/logdataworkerthread.h"
+#include "data/matchset.h"
+
+#include <benchmark/benchmark.h>
+
+// Micro-benchmarks of the data structures the views and the searches
+// use for each line, to judge the changes made to them.
+// Run with --benchmark_filter=<regex> to only run some of them.
+
+// Lines like the ones of a log, the number-th having a tab in every
+// tabs_every lines
+static std::vector<QString> makeLines( int nb_lines, int tabs_every )
+{
+    std::vector<QString> lines;
+    for ( int i = 0; i < nb_lines; i++ )
+        lines.push_back( QString( "2017-03-12 10:%1:%2.123 INFO%3[worker-%4] "
+                    "request user=alice%5 status=200 latency_ms=%6" )
+                .arg( i % 60 ).arg( i % 59 )
+                .arg( i % tabs_every == 0 ? "\t\t" : " " )
+                .arg( i % 7 ).arg( i ).arg( i % 1000 ) );
+
+    return lines;
+}
+
+// Returns random indexes in [0, size)
+static std::vector<qint64> randomIndexes( qint64 size, int nb )
+{
+    std::mt19937_64 random( 42 );
+    std::uniform_int_distribution<qint64> index( 0, size - 1 );
+
+    std::vector<qint64> indexes( nb );
+    for ( qint64& i : indexes )
+        i = index( random );
+
+    return indexes;
+}
+
+//
+// LinePositionArray
+//
+
+static void LinePositionArray_append( benchmark::State& state )
+{
+    for ( auto _ : state ) {
+        LinePositionArray array;
+        for ( qint64 i = 0; i < state.range( 0 ); i++ )
+            array.append( i * 85 + ( i % 11 ), 84 + ( i % 11 ) );
+        benchmark::DoNotOptimize( array.size() );
+    }
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( LinePositionArray_append )->Range( 1 << 10, 1 << 22 );
+
+static void LinePositionArray_concatenate( benchmark::State& state )
+{
+    LinePositionArray part;
+    for ( qint64 i = 0; i < state.range( 0 ); i++ )
+        part.append( ( i + 1 ) * 85 );
+
+    for ( auto _ : state ) {
+        LinePositionArray array;
+        for ( int i = 0; i < 16; i++ )
+            array += part;
+        benchmark::DoNotOptimize( array.size() );
+    }
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) * 16 );
+}
+BENCHMARK( LinePositionArray_concatenate )->Range( 1 << 10, 1 << 20 );
+
+static void LinePositionArray_randomAccess( benchmark::State& state )
+{
+    LinePositionArray array;
+    for ( qint64 i = 0; i < state.range( 0 ); i++ )
+        array.append( i * 85 + ( i % 11 ) );
+    const std::vector<qint64> indexes = randomIndexes( state.range( 0 ), 4096 );
+
+    for ( auto _ : state ) {
+        for ( qint64 i : indexes )
+            benchmark::DoNotOptimize( array.at( i ) );
+    }
+    state.SetItemsProcessed( state.iterations() * indexes.size() );
+}
+BENCHMARK( LinePositionArray_randomAccess )->Range( 1 << 10, 1 << 24 );
+
+//
+// AbstractLogData::untabify
+//
+
+// (untabify is protected)
+class UntabifyingLogData : public AbstractLogData {
+  public:
+    using AbstractLogData::untabify;
+};
+
+static void AbstractLogData_untabify( benchmark::State& state )
+{
+    const std::vector<QString> lines = makeLines( 1000, state.range( 0 ) );
+
+    for ( auto _ : state ) {
+        for ( const QString& line : lines )
+            benchmark::DoNotOptimize( UntabifyingLogData::untabify( line ) );
+    }
+    state.SetItemsProcessed( state.iterations() * lines.size() );
+}
+// Lines with tabs in 1 in 1, 10 and 1000
+BENCHMARK( AbstractLogData_untabify )->Arg( 1 )->Arg( 10 )->Arg( 1000 );
+
+//
+// Lookups of lines
+//
+
+static void lookupLineNumber_marks( benchmark::State& state )
+{
+    std::vector<Mark> list;
+    for ( qint64 i = 0; i < state.range( 0 ); i++ )
+        list.push_back( Mark( i * 3 ) );
+    const std::vector<qint64> lines =
+        randomIndexes( state.range( 0 ) * 3, 4096 );
+
+    for ( auto _ : state ) {
+        int index;
+        for ( qint64 line : lines )
+            benchmark::DoNotOptimize( lookupLineNumber( list, line, &index ) );
+    }
+    state.SetItemsProcessed( state.iterations() * lines.size() );
+}
+BENCHMARK( lookupLineNumber_marks )->Range( 1 << 10, 1 << 24 );
+
+static void MatchSet_select( benchmark::State& state )
+{
+    MatchSet set;
+    for ( qint64 i = 0; i < state.range( 0 ); i++ )
+        set.append( i * 3 );
+    const std::vector<qint64> indexes = randomIndexes( set.size(), 4096 );
+
+    for ( auto _ : state ) {
+        for ( qint64 i : indexes )
+            benchmark::DoNotOptimize( set.select( i ) );
+    }
+    state.SetItemsProcessed( state.iterations() * indexes.size() );
+}
+BENCHMARK( MatchSet_select )->Range( 1 << 10, 1 << 24 );
+
+//
+// Marks
+//
+
+static void Marks_addMark( benchmark::State& state )
+{
+    const std::vector<qint64> lines = randomIndexes( 1 << 30, state.range( 0 ) );
+
+    for ( auto _ : state ) {
+        Marks marks;
+        for ( qint64 line : lines )
+            marks.addMark( line );
+        benchmark::DoNotOptimize( marks.size() );
+    }
+    state.SetItemsProcessed( state.iterations() * lines.size() );
+}
+BENCHMARK( Marks_addMark )->Range( 1 << 6, 1 << 14 );
+
+static void Marks_isLineMarked( benchmark::State& state )
+{
+    Marks marks;
+    std::vector<qint64> lines;
+    for ( qint64 i = 0; i < state.range( 0 ); i++ )
+        lines.push_back( i * 7 );
+    marks.addMarks( lines );
+    const std::vector<qint64> tested =
+        randomIndexes( state.range( 0 ) * 7, 4096 );
+
+    for ( auto _ : state ) {
+        for ( qint64 line : tested )
+            benchmark::DoNotOptimize( marks.isLineMarked( line ) );
+    }
+    state.SetItemsProcessed( state.iterations() * tested.size() );
+}
+BENCHMARK( Marks_isLineMarked )->Range( 1 << 6, 1 << 20 );
+
+//
+// Matching of the displayed lines
+//
+
+static void FilterSet_matchLine( benchmark::State& state )
+{
+    // The filters are only read from the settings
+    QTemporaryDir dir;
+    QSettings settings( dir.path() + "/filters.ini", QSettings::IniFormat );
+    settings.beginGroup( "FilterSet" );
+    settings.setValue( "version", 1 );
+    settings.beginWriteArray( "filters" );
+    for ( int i = 0; i < state.range( 0 ); i++ ) {
+        settings.setArrayIndex( i );
+        settings.setValue( "regexp", QString( "user=alice%1\\b" ).arg( i * 97 ) );
+        settings.setValue( "fore_colour", "black" );
+        settings.setValue( "back_colour", "yellow" );
+    }
+    settings.endArray();
+    settings.endGroup();
+
+    FilterSet filter_set;
+    filter_set.retrieveFromStorage( settings );
+
+    const std::vector<QString> lines = makeLines( 1000, 10 );
+
+    for ( auto _ : state ) {
+        QColor fore, back;
+        for ( const QString& line : lines )
+            benchmark::DoNotOptimize( filter_set.matchLine( line, &fore, &back ) );
+    }
+    state.SetItemsProcessed( state.iterations() * lines.size() );
+}
+// With 1, 8 and 32 filters
+BENCHMARK( FilterSet_matchLine )->Arg( 1 )->Arg( 8 )->Arg( 32 );
+
+static void FilterSet_matchLine_keywords( benchmark::State& state )
+{
+    // A filter of levels, matched without the regexp
+    QTemporaryDir dir;
+    QSettings settings( dir.path() + "/filters.ini", QSettings::IniFormat );
+    settings.beginGroup( "FilterSet" );
+    settings.setValue( "version", 1 );
+    settings.beginWriteArray( "filters" );
+    settings.setArrayIndex( 0 );
+    settings.setValue( "regexp", "ERROR|WARN|FATAL" );
+    settings.setValue( "fore_colour", "black" );
+    settings.setValue( "back_colour", "red" );
+    settings.endArray();
+    settings.endGroup();
+
+    FilterSet filter_set;
+    filter_set.retrieveFromStorage( settings );
+
+    const std::vector<QString> lines = makeLines( 1000, 10 );
+
+    for ( auto _ : state ) {
+        QColor fore, back;
+        for ( const QString& line : lines )
+            benchmark::DoNotOptimize( filter_set.matchLine( line, &fore, &back ) );
+    }
+    state.SetItemsProcessed( state.iterations() * lines.size() );
+}
+BENCHMARK( FilterSet_matchLine_keywords );
+
+static void QuickFindPattern_matchLine( benchmark::State& state )
+{
+    QuickFindPattern pattern;
+    pattern.changeSearchPattern( "status=200", false );
+
+    const std::vector<QString> lines = makeLines( 1000, 10 );
+
+    for ( auto _ : state ) {
+        QList<QuickFindMatch> matches;
+        for ( const QString& line : lines ) {
+            matches.clear();
+            benchmark::DoNotOptimize( pattern.matchLine( line, matches ) );
+        }
+    }
+    state.SetItemsProcessed( state.iterations() * lines.size() );
+}
+BENCHMARK( QuickFindPattern_matchLine );
+
+int main( int argc, char** argv )
+{
+    QCoreApplication app( argc, argv );
+
+    FILELog::setReportingLevel( logERROR );
+
+    // QuickFindPattern reads the configuration
+    QStandardPaths::setTestModeEnabled( true );
+    GetPersistentInfo().migrateAndInit();
+    GetPersistentInfo().registerPersistable(
+            std::make_shared<Configuration>(), QString( "settings" ) );
+
+    benchmark::Initialize( &argc, argv );
+    benchmark::RunSpecifiedBenchmarks();
+
+    return 0;
+}
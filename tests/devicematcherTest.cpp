@@ -0,0 +1,63 @@
+#include <string>
+
+#include "gmock/gmock.h"
+
+#include "data/devicematcher.h"
+#include "data/literalprefilter.h"
+
+using namespace std;
+using namespace testing;
+
+// Returns the lines (ended by LF) as getRawLines would
+static string rawLines( const vector<string>& lines, vector<int>* lineEnds )
+{
+    string data;
+    for ( const string& line : lines ) {
+        data += line;
+        lineEnds->push_back( data.size() );
+        data += '\n';
+    }
+    return data;
+}
+
+TEST( DeviceMatcherBehaviour, onlyQualifiesLargeDataWithALiteral ) {
+    DeviceMatcher& matcher = DeviceMatcher::instance();
+    const LiteralPrefilter literal( QRegExp( "timeout", Qt::CaseSensitive,
+                QRegExp::FixedString ) );
+    const LiteralPrefilter no_literal( QRegExp( "t.*t" ) );
+
+    ASSERT_FALSE( matcher.qualifies( literal, DeviceMatcher::minimumSize - 1 ) );
+    ASSERT_FALSE( matcher.qualifies( no_literal, DeviceMatcher::minimumSize ) );
+    ASSERT_THAT( matcher.qualifies( literal, DeviceMatcher::minimumSize ),
+            matcher.isAvailable() );
+}
+
+TEST( DeviceMatcherBehaviour, findsTheLinesWithTheLiteral ) {
+    DeviceMatcher& matcher = DeviceMatcher::instance();
+    const LiteralPrefilter prefilter( QRegExp( "Timeout", Qt::CaseInsensitive,
+                QRegExp::FixedString ) );
+
+    vector<int> lineEnds;
+    const string data = rawLines( { "connection TIMEOUT",
+            "retrying", "timeou", "t", "closed after timeout",
+            "timeout" }, &lineEnds );
+
+    QBitArray candidates;
+    if ( ! matcher.isAvailable() ) {
+        // The caller searches the lines itself
+        ASSERT_FALSE( matcher.findLines( prefilter, data.data(), data.size(),
+                    lineEnds, &candidates ) );
+        return;
+    }
+
+    ASSERT_TRUE( matcher.findLines( prefilter, data.data(), data.size(),
+                lineEnds, &candidates ) );
+    ASSERT_THAT( candidates.size(), 6 );
+    ASSERT_TRUE( candidates.testBit( 0 ) );
+    ASSERT_FALSE( candidates.testBit( 1 ) );
+    // Not across lines
+    ASSERT_FALSE( candidates.testBit( 2 ) );
+    ASSERT_FALSE( candidates.testBit( 3 ) );
+    ASSERT_TRUE( candidates.testBit( 4 ) );
+    ASSERT_TRUE( candidates.testBit( 5 ) );
+}
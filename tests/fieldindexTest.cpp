@@ -0,0 +1,53 @@
+#include <string>
+
+#include "gmock/gmock.h"
+
+#include "data/fieldindex.h"
+
+using namespace std;
+using namespace testing;
+
+static QByteArray value( const string& line, const char* name )
+{
+    QByteArray result;
+    if ( ! FieldIndex::fieldValue( line.data(), line.size(), name, &result ) )
+        return "(none)";
+
+    return result;
+}
+
+TEST( FieldIndexBehaviour, findsKeyValueFields ) {
+    const string line = "12:00:01 level=ERROR thread=main service=\"pay ments\"";
+
+    ASSERT_THAT( value( line, "level" ), QByteArray( "ERROR" ) );
+    ASSERT_THAT( value( line, "thread" ), QByteArray( "main" ) );
+    ASSERT_THAT( value( line, "service" ), QByteArray( "pay ments" ) );
+    ASSERT_THAT( value( line, "request_id" ), QByteArray( "(none)" ) );
+
+    // A name ending another name is not the field
+    ASSERT_THAT( value( "loglevel=INFO level=WARN", "level" ), QByteArray( "WARN" ) );
+    ASSERT_THAT( value( "level=INFO, thread=main", "level" ), QByteArray( "INFO" ) );
+}
+
+TEST( FieldIndexBehaviour, findsJsonFields ) {
+    const string line = "{\"level\": \"ERROR\", \"code\":42, \"msg\":\"a \\\"b\\\"\"}";
+
+    ASSERT_THAT( value( line, "level" ), QByteArray( "ERROR" ) );
+    ASSERT_THAT( value( line, "code" ), QByteArray( "42" ) );
+    ASSERT_THAT( value( line, "msg" ), QByteArray( "a \\\"b\\\"" ) );
+    // A value is not a name
+    ASSERT_THAT( value( "{\"msg\":\"level\"}", "level" ), QByteArray( "(none)" ) );
+}
+
+TEST( FieldIndexBehaviour, recognisesTheTermsOnAField ) {
+    FieldIndex index;
+    index.setFields( QStringList() << "level" << "service" );
+
+    QString field_value;
+    ASSERT_THAT( index.fieldOfTerm( QRegExp( "service=payments" ), &field_value ), 1 );
+    ASSERT_THAT( field_value, QString( "payments" ) );
+
+    ASSERT_THAT( index.fieldOfTerm( QRegExp( "thread=main" ), &field_value ), -1 );
+    ASSERT_THAT( index.fieldOfTerm( QRegExp( "level=ERR.*" ), &field_value ), -1 );
+    ASSERT_THAT( index.fieldOfTerm( QRegExp( "level=" ), &field_value ), -1 );
+}
@@ -0,0 +1,55 @@
+#include <cstring>
+
+#include "gmock/gmock.h"
+
+#include "data/keywordmatcher.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( KeywordMatcherExtraction, splitsTheAlternation ) {
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "ERROR|WARN|FATAL" ),
+            ElementsAre( "ERROR", "WARN", "FATAL" ) );
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "(?:ERROR|WARN)" ),
+            ElementsAre( "ERROR", "WARN" ) );
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "main\\.cpp|(x)" ),
+            IsEmpty() );
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "main\\.cpp" ),
+            ElementsAre( "main.cpp" ) );
+}
+
+TEST( KeywordMatcherExtraction, givesUpOnOtherPatterns ) {
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "ERROR|" ), IsEmpty() );
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "ERR.R|WARN" ), IsEmpty() );
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "\\bERROR" ), IsEmpty() );
+    ASSERT_THAT( KeywordMatcher::alternatedKeywords( "(?i)error" ), IsEmpty() );
+    ASSERT_FALSE( KeywordMatcher( QRegExp( "ERR*", Qt::CaseSensitive,
+                    QRegExp::Wildcard ) ).isValid() );
+}
+
+TEST( KeywordMatcherBehaviour, findsTheFirstKeyword ) {
+    const KeywordMatcher matcher( QRegExp( "ERROR|WARN|FATAL" ) );
+    ASSERT_TRUE( matcher.isValid() );
+
+    int length = 0;
+    ASSERT_THAT( matcher.indexIn( "12:00 WARN disk ERROR", &length ), 6 );
+    ASSERT_THAT( length, 4 );
+    ASSERT_THAT( matcher.indexIn( "12:00 warn disk" ), -1 );
+
+    const char* const data = "12:00 INFO\n12:01 FATAL\n";
+    ASSERT_THAT( matcher.find( data, strlen( data ), &length ), 17 );
+    ASSERT_THAT( length, 5 );
+}
+
+TEST( KeywordMatcherBehaviour, prefersTheFirstAlternative ) {
+    int length = 0;
+    ASSERT_THAT( KeywordMatcher( QRegExp( "ab|abc" ) ).indexIn( "xabc", &length ), 1 );
+    ASSERT_THAT( length, 2 );
+}
+
+TEST( KeywordMatcherBehaviour, foldsTheCase ) {
+    const KeywordMatcher matcher( QRegExp( "Error|Warn", Qt::CaseInsensitive ) );
+
+    ASSERT_THAT( matcher.indexIn( "a WARNING" ), 2 );
+    ASSERT_THAT( matcher.find( "an eRRor", 8 ), 3 );
+}
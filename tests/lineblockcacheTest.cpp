@@ -0,0 +1,68 @@
+#include "gmock/gmock.h"
+
+#include "data/lineblockcache.h"
+
+using namespace std;
+using namespace testing;
+
+class LineBlockCacheTest: public testing::Test {
+  public:
+    LineBlockCacheTest() : nbLoaded( 0 ),
+        cache( [this]( qint64 first_line, int number ) {
+                nbLoaded.fetchAndAddRelaxed( number );
+                QStringList lines;
+                for ( qint64 i = first_line; i < first_line + number; i++ )
+                    lines.append( QString::number( i ) );
+                return lines;
+            } ) {}
+
+    // The lines are read ahead in a background thread,
+    // so only the lines loaded on request are counted here.
+    void getLines( qint64 first_line, int number, qint64 nb_lines ) {
+        lines = cache.getLines( first_line, number, nb_lines );
+    }
+
+    QAtomicInt nbLoaded;
+    LineBlockCache cache;
+    QStringList lines;
+};
+
+TEST_F( LineBlockCacheTest, returnsTheLinesAskedFor ) {
+    getLines( 250, 10, 1000 );
+    ASSERT_THAT( lines.size(), Eq( 10 ) );
+    ASSERT_THAT( lines.first(), Eq( QString( "250" ) ) );
+    ASSERT_THAT( lines.last(), Eq( QString( "259" ) ) );
+}
+
+TEST_F( LineBlockCacheTest, doesNotReadTheSameLinesTwice ) {
+    getLines( 0, 10, 1000 );
+    const int loaded = nbLoaded.load();
+    getLines( 0, 10, 1000 );
+    ASSERT_THAT( nbLoaded.load(), Eq( loaded ) );
+}
+
+TEST_F( LineBlockCacheTest, returnsTheEndOfTheFile ) {
+    getLines( 990, 10, 1000 );
+    ASSERT_THAT( lines.size(), Eq( 10 ) );
+    ASSERT_THAT( lines.last(), Eq( QString( "999" ) ) );
+}
+
+TEST_F( LineBlockCacheTest, refusesLinesPastTheEnd ) {
+    getLines( 995, 10, 1000 );
+    ASSERT_THAT( lines.size(), Eq( 0 ) );
+}
+
+TEST_F( LineBlockCacheTest, readsTheLastBlockAgainWhenTheFileGrows ) {
+    getLines( 990, 10, 1000 );
+    getLines( 995, 10, 1005 );
+    ASSERT_THAT( lines.size(), Eq( 10 ) );
+    ASSERT_THAT( lines.last(), Eq( QString( "1004" ) ) );
+}
+
+TEST_F( LineBlockCacheTest, readsInvalidatedLinesAgain ) {
+    getLines( 0, 10, 1000 );
+    cache.invalidateFrom( 5 );
+    const int loaded = nbLoaded.load();
+    getLines( 0, 10, 1000 );
+    ASSERT_THAT( nbLoaded.load(), Gt( loaded ) );
+}
@@ -0,0 +1,297 @@
+#include "gmock/gmock.h"
+
+#include "data/logdataworkerthread.h"
+
+using namespace std;
+using namespace testing;
+
+class LinePositionArrayBehaviour: public testing::Test {
+  public:
+    LinePositionArray line_array;
+
+    void SetUp() override {
+        line_array.append( 4 );
+        line_array.append( 8 );
+        line_array.append( 10 );
+        // A very long line
+        line_array.append( 345 );
+        line_array.append( 20000000 );
+        line_array.append( 20000004 );
+    }
+};
+
+TEST_F( LinePositionArrayBehaviour, canBeMadeEmpty ) {
+    LinePositionArray array;
+    ASSERT_THAT( array.size(), 0 );
+}
+
+TEST_F( LinePositionArrayBehaviour, canBeCopied ) {
+    LinePositionArray array = line_array;
+    ASSERT_THAT( array.size(), 6 );
+    ASSERT_THAT( array[3], 345 );
+}
+
+TEST_F( LinePositionArrayBehaviour, keepsPositions ) {
+    ASSERT_THAT( line_array.size(), 6 );
+    ASSERT_THAT( line_array[0], 4 );
+    ASSERT_THAT( line_array[4], 20000000 );
+    ASSERT_THAT( line_array.at( 5 ), 20000004 );
+}
+
+TEST_F( LinePositionArrayBehaviour, fakeLFIsRemovedOnAppend ) {
+    line_array.append( 20000020 );
+    line_array.setFakeFinalLF();
+
+    LinePositionArray other_array;
+    other_array.append( 20000030 );
+    other_array.append( 20000040 );
+
+    line_array += other_array;
+
+    ASSERT_THAT( line_array.size(), 8 );
+    ASSERT_THAT( line_array[5], 20000004 );
+    ASSERT_THAT( line_array[6], 20000030 );
+    ASSERT_THAT( line_array[7], 20000040 );
+}
+
+TEST_F( LinePositionArrayBehaviour, keepsLengthsIfAllAreKnown ) {
+    ASSERT_THAT( line_array.hasLengths(), false );
+
+    LinePositionArray array;
+    array.append( 4, 3 );
+    array.append( 100000, 99995 );
+    array.append( 100010, 12 );
+    ASSERT_THAT( array.hasLengths(), true );
+    ASSERT_THAT( array.lengthAt( 0 ), 3 );
+    ASSERT_THAT( array.lengthAt( 1 ), 99995 );
+    ASSERT_THAT( array.lengthAt( 2 ), 12 );
+
+    array.append( 100020 );
+    ASSERT_THAT( array.hasLengths(), false );
+}
+
+TEST_F( LinePositionArrayBehaviour, fakeLFLengthIsRemovedOnAppend ) {
+    LinePositionArray array;
+    array.append( 10, 9 );
+    array.append( 100000, 99989 );
+    array.setFakeFinalLF();
+
+    LinePositionArray other_array;
+    other_array.append( 100010, 100009 );
+    array += other_array;
+
+    ASSERT_THAT( array.hasLengths(), true );
+    ASSERT_THAT( array.size(), 2 );
+    ASSERT_THAT( array.lengthAt( 1 ), 100009 );
+
+    // Not if the lengths of the other are not known
+    array += line_array;
+    ASSERT_THAT( array.hasLengths(), false );
+}
+
+class LinePositionArrayBigFile: public testing::Test {
+  public:
+    static const qint64 nb_lines = 30000;
+    LinePositionArray line_array;
+
+    // Lines of random-ish length, some very long
+    static qint64 position( qint64 line ) {
+        return line * 150 + ( line / 1000 ) * 100000 + ( line % 7 );
+    }
+
+    void SetUp() override {
+        for ( qint64 i = 0; i < nb_lines; i++ )
+            line_array.append( position( i ) );
+    }
+};
+
+TEST_F( LinePositionArrayBigFile, keepsAllPositions ) {
+    ASSERT_THAT( line_array.size(), nb_lines );
+    for ( qint64 i = 0; i < nb_lines; i++ )
+        ASSERT_THAT( line_array[i], position( i ) );
+}
+
+TEST_F( LinePositionArrayBigFile, fakeLFIsRemovedAcrossBlocks ) {
+    // Exactly fills a block with the fake LF
+    LinePositionArray array;
+    for ( int i = 0; i < CompressedLinePositionStorage::BLOCK_SIZE - 1; i++ )
+        array.append( i * 10 );
+    array.append( 100000 );
+    array.setFakeFinalLF();
+
+    LinePositionArray other_array;
+    other_array.append( 200000 );
+
+    array += other_array;
+
+    ASSERT_THAT( array.size(), CompressedLinePositionStorage::BLOCK_SIZE );
+    ASSERT_THAT( array[CompressedLinePositionStorage::BLOCK_SIZE - 2],
+            ( CompressedLinePositionStorage::BLOCK_SIZE - 2 ) * 10 );
+    ASSERT_THAT( array[CompressedLinePositionStorage::BLOCK_SIZE - 1], 200000 );
+}
+
+TEST_F( LinePositionArrayBigFile, usesLessMemoryThanPlainPositions ) {
+    CompressedLinePositionStorage storage;
+    for ( qint64 i = 0; i < nb_lines; i++ )
+        storage.append( i * 120 );
+
+    ASSERT_THAT( storage.allocatedSize(),
+            Lt( nb_lines * sizeof( qint64 ) / 3 ) );
+}
+
+TEST_F( LinePositionArrayBigFile, keepsPositionsOnceSpilled ) {
+    LinePositionArray array;
+    for ( qint64 i = 0; i < nb_lines; i++ )
+        array.append( position( i ), ( i % 1000 == 0 ) ? 100000 : 10 );
+
+    LinePositionArray spilled;
+    ASSERT_TRUE( array.spill( &spilled ) );
+    ASSERT_TRUE( spilled.isSpilled() );
+    ASSERT_THAT( spilled.allocatedSize(), Lt( array.allocatedSize() / 10 ) );
+
+    ASSERT_THAT( spilled.size(), nb_lines );
+    ASSERT_THAT( spilled.hasLengths(), true );
+    for ( qint64 i = 0; i < nb_lines; i++ ) {
+        ASSERT_THAT( spilled[i], position( i ) );
+        ASSERT_THAT( spilled.lengthAt( i ),
+                ( i % 1000 == 0 ) ? 100000 : 10 );
+    }
+}
+
+TEST_F( LinePositionArrayBigFile, canBeAppendedToOnceSpilled ) {
+    line_array.setFakeFinalLF();
+    LinePositionArray spilled;
+    ASSERT_TRUE( line_array.spill( &spilled ) );
+
+    LinePositionArray other_array;
+    other_array.append( position( nb_lines ) + 1000 );
+    spilled += other_array;
+
+    ASSERT_THAT( spilled.isSpilled(), false );
+    ASSERT_THAT( spilled.size(), nb_lines );
+    ASSERT_THAT( spilled[nb_lines - 2], position( nb_lines - 2 ) );
+    ASSERT_THAT( spilled[nb_lines - 1], position( nb_lines ) + 1000 );
+}
+
+class SharedLinePositionArrayBehaviour: public testing::Test {
+  public:
+    SharedLinePositionArray line_array;
+
+    // Positions every 10 bytes, from 'first' to 'last' (included)
+    static LinePositionArray positions( qint64 first, qint64 last,
+            bool fake_final_lf = false ) {
+        LinePositionArray array;
+        for ( qint64 pos = first; pos <= last; pos += 10 )
+            array.append( pos );
+        array.setFakeFinalLF( fake_final_lf );
+        return array;
+    }
+};
+
+TEST_F( SharedLinePositionArrayBehaviour, canBeMadeEmpty ) {
+    ASSERT_THAT( line_array.size(), 0 );
+}
+
+TEST_F( SharedLinePositionArrayBehaviour, keepsAppendedPositions ) {
+    line_array.append( positions( 10, 1000 ) );
+    line_array.append( positions( 1010, 1100 ) );
+    line_array.append( positions( 1110, 1120 ) );
+
+    ASSERT_THAT( line_array.size(), 112 );
+    ASSERT_THAT( line_array[0], 10 );
+    ASSERT_THAT( line_array[99], 1000 );
+    ASSERT_THAT( line_array[100], 1010 );
+    ASSERT_THAT( line_array.at( 111 ), 1120 );
+}
+
+TEST_F( SharedLinePositionArrayBehaviour, fakeLFIsRemovedOnAppend ) {
+    line_array.append( positions( 10, 1000, true ) );
+    line_array.append( positions( 1005, 1015 ) );
+
+    ASSERT_THAT( line_array.size(), 101 );
+    ASSERT_THAT( line_array[98], 990 );
+    ASSERT_THAT( line_array[99], 1005 );
+    ASSERT_THAT( line_array[100], 1015 );
+}
+
+TEST_F( SharedLinePositionArrayBehaviour, copiesAreNotChangedByAppends ) {
+    line_array.append( positions( 10, 1000, true ) );
+    SharedLinePositionArray copy = line_array;
+
+    line_array.append( positions( 1005, 2005 ) );
+
+    ASSERT_THAT( copy.size(), 100 );
+    ASSERT_THAT( copy[99], 1000 );
+    ASSERT_THAT( line_array[99], 1005 );
+}
+
+TEST_F( SharedLinePositionArrayBehaviour, keepsPositionsOverManyAppends ) {
+    for ( qint64 pos = 10; pos <= 100000; pos += 100 )
+        line_array.append( positions( pos, pos + 90 ) );
+
+    ASSERT_THAT( line_array.size(), 10000 );
+    for ( qint64 i = 0; i < 10000; i++ )
+        ASSERT_THAT( line_array[i], 10 + i * 10 );
+}
+
+TEST_F( SharedLinePositionArrayBehaviour, keepsLengthsOverManyAppends ) {
+    for ( qint64 pos = 10; pos <= 100000; pos += 100 ) {
+        LinePositionArray array;
+        for ( qint64 i = pos; i <= pos + 90; i += 10 )
+            array.append( i, i / 10 );
+        line_array.append( std::move( array ) );
+    }
+
+    ASSERT_THAT( line_array.hasLengths(), true );
+    for ( qint64 i = 0; i < 10000; i++ )
+        ASSERT_THAT( line_array.lengthAt( i ), i + 1 );
+
+    line_array.append( positions( 100010, 100100 ) );
+    ASSERT_THAT( line_array.hasLengths(), false );
+}
+
+TEST_F( SharedLinePositionArrayBehaviour, canBeTruncatedAndAppendedTo ) {
+    line_array.append( positions( 10, 1000 ) );
+    line_array.append( positions( 1010, 1100, true ) );
+    SharedLinePositionArray copy = line_array;
+
+    line_array.truncate( 50 );
+    ASSERT_THAT( line_array.size(), 50 );
+    ASSERT_THAT( line_array.hasFakeFinalLF(), false );
+    ASSERT_THAT( line_array[49], 500 );
+
+    line_array.append( positions( 505, 605 ) );
+    ASSERT_THAT( line_array.size(), 61 );
+    ASSERT_THAT( line_array[49], 500 );
+    ASSERT_THAT( line_array[50], 505 );
+    ASSERT_THAT( line_array[60], 605 );
+
+    // The copy is unchanged
+    ASSERT_THAT( copy.size(), 110 );
+    ASSERT_THAT( copy[50], 510 );
+}
+
+TEST_F( SharedLinePositionArrayBehaviour, spillsTheLargeParts ) {
+    // Large enough to be spilled, then a small part kept in memory
+    const qint64 nb_lines = 1000000;
+    LinePositionArray array;
+    for ( qint64 i = 0; i < nb_lines; i++ )
+        array.append( i * 100 + 99, 99 );
+    line_array.append( std::move( array ) );
+    line_array.append( positions( nb_lines * 100 + 10, nb_lines * 100 + 100 ) );
+
+    SharedLinePositionArray spilled = line_array.spilled();
+    ASSERT_THAT( spilled.allocatedSize(),
+            Lt( line_array.allocatedSize() / 10 ) );
+
+    ASSERT_THAT( spilled.size(), nb_lines + 10 );
+    for ( qint64 i = 0; i < nb_lines; i++ )
+        ASSERT_THAT( spilled[i], i * 100 + 99 );
+    ASSERT_THAT( spilled[nb_lines + 9], nb_lines * 100 + 100 );
+
+    // Still appended to, the original being unchanged
+    spilled.append( positions( nb_lines * 100 + 110, nb_lines * 100 + 200 ) );
+    ASSERT_THAT( spilled.size(), nb_lines + 20 );
+    ASSERT_THAT( spilled[nb_lines + 19], nb_lines * 100 + 200 );
+    ASSERT_THAT( line_array.size(), nb_lines + 10 );
+}
@@ -0,0 +1,116 @@
+#include "gmock/gmock.h"
+
+#include "data/literalprefilter.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( LiteralPrefilterExtraction, keepsPlainPattern ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "request" ), Eq( "request" ) );
+}
+
+TEST( LiteralPrefilterExtraction, returnsLongestRun ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "id=\\d+ status=[0-9]" ),
+            Eq( " status=" ) );
+}
+
+TEST( LiteralPrefilterExtraction, dropsOptionalCharacters ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "colou?r" ), Eq( "colo" ) );
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "ab*cdef" ), Eq( "cdef" ) );
+}
+
+TEST( LiteralPrefilterExtraction, dropsOptionalMultibyteCharacters ) {
+    // (the whole UTF-8 sequence of the optional character)
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "caf\xC3\xA9?s" ), Eq( "caf" ) );
+    ASSERT_THAT( LiteralPrefilter::requiredLiterals(
+                string( "na\xC3\xAF*ve \xE6\x97\xA5{2}end" ) ),
+            ElementsAre( "na", "ve ", "end" ) );
+}
+
+TEST( LiteralPrefilterExtraction, unescapesPunctuation ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "main\\.cpp" ), Eq( "main.cpp" ) );
+}
+
+TEST( LiteralPrefilterExtraction, ignoresGroups ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "(foo|bar)baz" ), Eq( "baz" ) );
+}
+
+TEST( LiteralPrefilterExtraction, givesUpOnAlternation ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "error|warning" ), Eq( "" ) );
+}
+
+TEST( LiteralPrefilterExtraction, givesUpOnEscapesWithArguments ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiteral( "\\x41BCD" ), Eq( "" ) );
+}
+
+TEST( LiteralPrefilterExtraction, returnsAllTheRuns ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiterals( string( "id=\\d+ status=[0-9]" ) ),
+            ElementsAre( "id=", " status=" ) );
+    ASSERT_THAT( LiteralPrefilter::requiredLiterals( string( "error|warning" ) ),
+            ElementsAre() );
+}
+
+TEST( LiteralPrefilterExtraction, splitsWildcardPatterns ) {
+    ASSERT_THAT( LiteralPrefilter::requiredLiterals(
+                QRegExp( "*conn?ction [a-z]*lost", Qt::CaseSensitive, QRegExp::Wildcard ) ),
+            ElementsAre( "conn", "ction ", "lost" ) );
+    ASSERT_THAT( LiteralPrefilter::requiredLiterals(
+                QRegExp( "a\\b", Qt::CaseSensitive, QRegExp::Wildcard ) ),
+            ElementsAre( "a\\b" ) );
+}
+
+TEST( LiteralPrefilterExtraction, tellsTheNarrowerPatterns ) {
+    const QRegExp error( "ERROR" );
+    ASSERT_TRUE( LiteralPrefilter::isNarrower( QRegExp( "ERROR 42" ), error ) );
+    ASSERT_TRUE( LiteralPrefilter::isNarrower( QRegExp( "ERROR.*timeout" ), error ) );
+    ASSERT_TRUE( LiteralPrefilter::isNarrower( error, error ) );
+
+    // The wider pattern must be a plain string the narrower one requires
+    ASSERT_FALSE( LiteralPrefilter::isNarrower( QRegExp( "ERROR 42" ),
+                QRegExp( "ERR.R" ) ) );
+    ASSERT_FALSE( LiteralPrefilter::isNarrower( QRegExp( "ERROR|WARN" ), error ) );
+    ASSERT_FALSE( LiteralPrefilter::isNarrower( QRegExp( "ERRORS?" ),
+                QRegExp( "ERRORS" ) ) );
+
+    ASSERT_TRUE( LiteralPrefilter::isNarrower( QRegExp( "Error 42" ),
+                QRegExp( "error", Qt::CaseInsensitive ) ) );
+    ASSERT_FALSE( LiteralPrefilter::isNarrower(
+                QRegExp( "ERROR 42", Qt::CaseInsensitive ), error ) );
+    ASSERT_FALSE( LiteralPrefilter::isNarrower( QRegExp( "Error 42" ), error ) );
+}
+
+class LiteralPrefilterSearch: public testing::Test {
+  public:
+    const string text = "2015-01-01 INFO Request abc-1234 done";
+};
+
+TEST_F( LiteralPrefilterSearch, fixedStringIsExact ) {
+    LiteralPrefilter prefilter( QRegExp( "abc-1234",
+                Qt::CaseSensitive, QRegExp::FixedString ) );
+    ASSERT_TRUE( prefilter.isExact() );
+    ASSERT_THAT( prefilter.find( text.data(), text.size() ), Eq( 24 ) );
+}
+
+TEST_F( LiteralPrefilterSearch, regexpIsNotExact ) {
+    LiteralPrefilter prefilter( QRegExp( "Request.*done" ) );
+    ASSERT_TRUE( prefilter.isValid() );
+    ASSERT_FALSE( prefilter.isExact() );
+    ASSERT_THAT( prefilter.find( text.data(), text.size() ), Eq( 16 ) );
+}
+
+TEST_F( LiteralPrefilterSearch, foldsCase ) {
+    LiteralPrefilter prefilter( QRegExp( "REQUEST",
+                Qt::CaseInsensitive, QRegExp::FixedString ) );
+    ASSERT_THAT( prefilter.find( text.data(), text.size() ), Eq( 16 ) );
+}
+
+TEST_F( LiteralPrefilterSearch, reportsMissingLiteral ) {
+    LiteralPrefilter prefilter( QRegExp( "abc-1235",
+                Qt::CaseSensitive, QRegExp::FixedString ) );
+    ASSERT_THAT( prefilter.find( text.data(), text.size() ), Eq( -1 ) );
+}
+
+TEST_F( LiteralPrefilterSearch, isNotUsedForShortLiterals ) {
+    LiteralPrefilter prefilter( QRegExp( "a.*" ) );
+    ASSERT_FALSE( prefilter.isValid() );
+}
@@ -0,0 +1,71 @@
+#include <cstring>
+
+#include "gmock/gmock.h"
+
+#include "data/logcomparison.h"
+
+using namespace std;
+using namespace testing;
+
+namespace {
+
+vector<LineNumber> lines( const MatchSet& set )
+{
+    return vector<LineNumber>( set.begin(), set.end() );
+}
+
+quint64 hash( const char* line, bool maskVariables )
+{
+    return LogComparison::hashLine( line, strlen( line ), maskVariables );
+}
+
+}
+
+TEST( LogComparisonBehaviour, masksTheWordsWithDigits ) {
+    const char* line = "2017-03-12 10:00:01 [worker-3] session=4f2a closed";
+    const char* other = "2018-11-02 23:59:59 [worker-12] session=beef7 closed";
+
+    ASSERT_THAT( hash( line, true ), Eq( hash( other, true ) ) );
+    ASSERT_THAT( hash( line, false ), Ne( hash( other, false ) ) );
+    ASSERT_THAT( hash( "session closed", true ),
+            Ne( hash( "session opened", true ) ) );
+    // The spaces (and CR) at the end do not count
+    ASSERT_THAT( hash( "session closed \r", false ),
+            Eq( hash( "session closed", false ) ) );
+}
+
+TEST( LogComparisonBehaviour, findsTheLinesOfEachSideOnly ) {
+    const vector<quint64> left  = { 1, 2, 3, 4, 5, 6, 7 };
+    const vector<quint64> right = { 1, 2, 9, 4, 5, 7, 8 };
+
+    MatchSet left_only, right_only;
+    LogComparison::diff( left, right, &left_only, &right_only );
+
+    ASSERT_THAT( lines( left_only ), ElementsAre( 2, 5 ) );
+    ASSERT_THAT( lines( right_only ), ElementsAre( 2, 6 ) );
+}
+
+TEST( LogComparisonBehaviour, matchesTheLinesFoundOnceOnEachSideFirst ) {
+    // The repeated lines are diffed between the unique ones
+    const vector<quint64> left  = { 10, 0, 0, 11, 0, 12, 0, 0 };
+    const vector<quint64> right = { 0, 10, 0, 0, 11, 0, 0, 12, 0 };
+
+    MatchSet left_only, right_only;
+    LogComparison::diff( left, right, &left_only, &right_only );
+
+    ASSERT_THAT( lines( left_only ), ElementsAre( 6 ) );
+    ASSERT_THAT( lines( right_only ), ElementsAre( 0, 6 ) );
+}
+
+TEST( LogComparisonBehaviour, findsNothingForTheSameLines ) {
+    const vector<quint64> left = { 5, 5, 5, 6, 5 };
+
+    MatchSet left_only, right_only;
+    LogComparison::diff( left, left, &left_only, &right_only );
+
+    ASSERT_TRUE( left_only.empty() );
+    ASSERT_TRUE( right_only.empty() );
+
+    LogComparison::diff( left, vector<quint64>(), &left_only, &right_only );
+    ASSERT_THAT( left_only.size(), Eq( 5 ) );
+}
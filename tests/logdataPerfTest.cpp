@@ -55,8 +55,14 @@ TEST_F( PerfLogData, simpleLoad ) {
         ASSERT_TRUE( endSpy.wait( 20000 ) );
     }
 
-    // Blocks of 5 MiB + 1 for the start notification (0%)
-    ASSERT_THAT( progressSpy.count(), log_data.getFileSize() / (5LL*1024*1024) + 2 );
+    // The progress goes from 0 to 100%, each value being notified once
+    // at most, whatever the size of the blocks read
+    ASSERT_THAT( progressSpy.count(), testing::Le( 101 ) );
+    ASSERT_THAT( progressSpy.first().at( 0 ).toInt(), 0 );
+    ASSERT_THAT( progressSpy.last().at( 0 ).toInt(), 100 );
+    for ( int i = 1; i < progressSpy.count(); i++ )
+        ASSERT_THAT( progressSpy.at( i ).at( 0 ).toInt(),
+                testing::Gt( progressSpy.at( i - 1 ).at( 0 ).toInt() ) );
     ASSERT_THAT( endSpy.count(), 1 );
     QList<QVariant> arguments = endSpy.takeFirst();
     ASSERT_THAT( arguments.at(0).toInt(),
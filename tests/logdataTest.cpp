@@ -1,12 +1,24 @@
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include <QTest>
 #include <QSignalSpy>
+#include <QBuffer>
+
+#ifndef WIN32
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#endif
 
 #include "log.h"
 #include "test_utils.h"
 
 #include "data/logdata.h"
+#include "data/logfiltereddata.h"
+#include "data/fusedsearch.h"
+#include "data/matchestimator.h"
+#include "selection.h"
 
 #include "gmock/gmock.h"
 
@@ -122,6 +134,242 @@ TEST_F( LogDataChanging, changingFile ) {
     }
 }
 
+TEST_F( LogDataChanging, growthIsCoalesced ) {
+    char newLine[90];
+    LogData log_data;
+    log_data.setGrowthCoalescingDelay( 300 );
+
+    SafeQSignalSpy finishedSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    SafeQSignalSpy changedSpy( &log_data,
+            SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ) );
+
+    QFile file( TMPDIR "/growingfile.txt" );
+    QVERIFY( file.open( QIODevice::WriteOnly ) );
+    file.close();
+
+    log_data.attachFile( TMPDIR "/growingfile.txt" );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+    ASSERT_THAT( log_data.getNbLine(), 0LL );
+
+    // Grow the file several times within the window
+    for ( int burst = 0; burst < 5; burst++ ) {
+        if ( file.open( QIODevice::Append ) ) {
+            for (int i = 0; i < 100; i++) {
+                snprintf(newLine, 89, sl_format, i);
+                file.write( newLine, qstrlen(newLine) );
+            }
+        }
+        file.close();
+        QTest::qWait( 20 );
+    }
+
+    // and wait for the (single) indexing
+    ASSERT_TRUE( finishedSpy.wait( 2000 ) );
+    QTest::qWait( 500 );
+
+    ASSERT_THAT( changedSpy.count(), 1 );
+    ASSERT_THAT( finishedSpy.count(), 2 );
+    ASSERT_THAT( log_data.getNbLine(), 500LL );
+}
+
+TEST_F( LogDataChanging, truncationKeepsUnchangedLines ) {
+    char newLine[90];
+    LogData log_data;
+
+    SafeQSignalSpy finishedSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    SafeQSignalSpy changedSpy( &log_data,
+            SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ) );
+
+    QFile file( TMPDIR "/rewrittenfile.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for (int i = 0; i < 25000; i++) {
+            snprintf(newLine, 89, sl_format, i);
+            file.write( newLine, qstrlen(newLine) );
+        }
+    }
+    file.close();
+
+    log_data.attachFile( TMPDIR "/rewrittenfile.txt" );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+    ASSERT_THAT( log_data.getNbLine(), 25000LL );
+
+    // Rewrite it shorter, keeping its beginning
+    // (the spy only waiting for the signals of the indexing it causes)
+    finishedSpy.clear();
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for (int i = 0; i < 12000; i++) {
+            snprintf(newLine, 89, sl_format, i);
+            file.write( newLine, qstrlen(newLine) );
+        }
+        for (int i = 0; i < 500; i++) {
+            snprintf(newLine, 89, sl_format, 900000 + i);
+            file.write( newLine, qstrlen(newLine) );
+        }
+    }
+    file.close();
+
+    ASSERT_TRUE( finishedSpy.safeWait() );
+
+    ASSERT_THAT( changedSpy.count(), 1 );
+    ASSERT_THAT( changedSpy.takeFirst().at( 0 ).value<LogData::MonitoredFileStatus>(),
+            LogData::PartiallyTruncated );
+    ASSERT_THAT( log_data.getNbLine(), 12500LL );
+    snprintf(newLine, 89, sl_format, 900499);
+    newLine[ qstrlen( newLine ) - 1 ] = '\0';
+    ASSERT_THAT( log_data.getLineString( 12499 ), QString( newLine ) );
+}
+
+TEST_F( LogDataChanging, reloadingKeepsAnUnchangedFile ) {
+    char newLine[90];
+    LogData log_data;
+
+    SafeQSignalSpy finishedSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    SafeQSignalSpy changedSpy( &log_data,
+            SIGNAL( fileChanged( LogData::MonitoredFileStatus ) ) );
+
+    QFile file( TMPDIR "/reloadedfile.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for (int i = 0; i < 25000; i++) {
+            snprintf(newLine, 89, sl_format, i);
+            file.write( newLine, qstrlen(newLine) );
+        }
+    }
+    file.close();
+
+    log_data.attachFile( TMPDIR "/reloadedfile.txt" );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+
+    // Nothing is indexed again
+    ASSERT_THAT( log_data.reloadChanges(), LogData::Unchanged );
+    ASSERT_THAT( changedSpy.count(), 0 );
+    ASSERT_THAT( log_data.getNbLine(), 25000LL );
+}
+
+#ifndef WIN32
+TEST_F( LogDataChanging, reloadingIndexesAFileChangedInPlace ) {
+    char newLine[90];
+    LogData log_data;
+
+    SafeQSignalSpy finishedSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    QFile file( TMPDIR "/inplacefile.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for (int i = 0; i < 25000; i++) {
+            snprintf(newLine, 89, sl_format, i);
+            file.write( newLine, qstrlen(newLine) );
+        }
+    }
+    file.close();
+
+    log_data.attachFile( TMPDIR "/inplacefile.txt" );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+
+    // A line before the fingerprints is changed, the size being the same
+    if ( file.open( QIODevice::ReadWrite ) ) {
+        file.seek( 500LL * ( SL_LINE_LENGTH + 1 ) );
+        snprintf(newLine, 89, sl_format, 900000);
+        file.write( newLine, qstrlen(newLine) );
+    }
+    file.close();
+    // (its date surely differing)
+    struct timeval times[2];
+    gettimeofday( &times[0], nullptr );
+    times[0].tv_sec += 10;
+    times[1] = times[0];
+    utimes( TMPDIR "/inplacefile.txt", times );
+
+    // Nothing telling where, the whole file is indexed again
+    ASSERT_THAT( log_data.reloadChanges(), LogData::Truncated );
+    finishedSpy.clear();
+    log_data.reload();
+    ASSERT_TRUE( finishedSpy.wait( 10000 ) );
+
+    ASSERT_THAT( log_data.getNbLine(), 25000LL );
+    newLine[ qstrlen( newLine ) - 1 ] = '\0';
+    ASSERT_THAT( log_data.getLineString( 500 ), QString( newLine ) );
+}
+
+TEST_F( LogDataChanging, rotationIsFollowed ) {
+    char newLine[90];
+    LogData log_data;
+    log_data.setFollowRotation( true );
+
+    SafeQSignalSpy finishedSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    QFile::remove( TMPDIR "/rotatingfile.txt.1" );
+    QFile file( TMPDIR "/rotatingfile.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for (int i = 0; i < 200; i++) {
+            snprintf(newLine, 89, sl_format, i);
+            file.write( newLine, qstrlen(newLine) );
+        }
+        // Incomplete last line
+        file.write( "partial" );
+    }
+    file.close();
+
+    log_data.attachFile( TMPDIR "/rotatingfile.txt" );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+    ASSERT_THAT( log_data.getNbLine(), 201LL );
+
+    // Rotate it as logrotate does and write to the new one
+    finishedSpy.clear();
+    QVERIFY( QFile::rename( TMPDIR "/rotatingfile.txt",
+                TMPDIR "/rotatingfile.txt.1" ) );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for (int i = 0; i < 100; i++) {
+            snprintf(newLine, 89, sl_format, i);
+            file.write( newLine, qstrlen(newLine) );
+        }
+    }
+    file.close();
+
+    ASSERT_TRUE( finishedSpy.wait( 10000 ) );
+    // (the lines of the new file being possibly indexed after the
+    // rotation itself)
+    if ( log_data.getNbLine() < 301LL )
+        ASSERT_TRUE( finishedSpy.wait( 10000 ) );
+
+    // The lines of both files, the new ones being the only indexed
+    ASSERT_THAT( log_data.getNbLine(), 301LL );
+    ASSERT_THAT( log_data.getLineString( 200 ), QString( "partial" ) );
+    snprintf(newLine, 89, sl_format, 0);
+    newLine[ qstrlen( newLine ) - 1 ] = '\0';
+    ASSERT_THAT( log_data.getLineString( 201 ), QString( newLine ) );
+}
+
+TEST_F( LogDataChanging, namedPipeIsSpooled ) {
+    char newLine[90];
+    LogData log_data;
+
+    SafeQSignalSpy finishedSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    QFile::remove( TMPDIR "/changingpipe" );
+    ASSERT_THAT( ::mkfifo( TMPDIR "/changingpipe", 0600 ), 0 );
+
+    log_data.attachFile( TMPDIR "/changingpipe" );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+    ASSERT_THAT( log_data.getNbLine(), 0LL );
+
+    // Written as a program piping its output would do
+    QFile pipe( TMPDIR "/changingpipe" );
+    ASSERT_TRUE( pipe.open( QIODevice::WriteOnly | QIODevice::Unbuffered ) );
+    for (int i = 0; i < 200; i++) {
+        snprintf(newLine, 89, sl_format, i);
+        pipe.write( newLine, qstrlen(newLine) );
+    }
+    pipe.close();
+
+    // Indexed as the spool file grows
+    while ( log_data.getNbLine() < 200LL && finishedSpy.wait( 2000 ) );
+    ASSERT_THAT( log_data.getNbLine(), 200LL );
+    newLine[ qstrlen( newLine ) - 1 ] = '\0';
+    ASSERT_THAT( log_data.getLineString( 199 ), QString( newLine ) );
+
+    QFile::remove( TMPDIR "/changingpipe" );
+}
+#endif
+
 class LogDataBehaviour : public testing::Test {
   public:
     LogDataBehaviour() {
@@ -179,3 +427,775 @@ TEST_F( LogDataBehaviour, cannotBeReAttached ) {
 
     ASSERT_THROW( log_data.attachFile( TMPDIR "/verybiglog.txt" ), CantReattachErr );
 }
+
+TEST_F( LogDataBehaviour, findsTheLineAtATime ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    ASSERT_THAT( log_data.getLineAtTime( 0 ), -1LL );
+
+    // The line numbers are used as timestamps
+    log_data.setTimestampRule( TimestampRule( QRegExp( "line (\\d+)$" ) ) );
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    ASSERT_THAT( log_data.getLineAtTime( 0 ), 0LL );
+    ASSERT_THAT( log_data.getLineAtTime( 1234 ), 1234LL );
+    ASSERT_THAT( log_data.getLineAtTime( 4999 ), 4999LL );
+    ASSERT_THAT( log_data.getLineAtTime( 99999 ), SL_NB_LINES );
+}
+
+TEST_F( LogDataBehaviour, findsTheLineAtATimeWithoutTheIndex ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    // Only the line numbers ending in 0 are timestamps
+    const TimestampRule rule( QRegExp( "line (\\d+0)$" ) );
+
+    ASSERT_THAT( rule.findLine( log_data, 0 ), 0LL );
+    ASSERT_THAT( rule.findLine( log_data, 1230 ), 1230LL );
+    ASSERT_THAT( rule.findLine( log_data, 1234 ), 1240LL );
+    ASSERT_THAT( rule.findLine( log_data, 99999 ), SL_NB_LINES );
+}
+
+TEST_F( LogDataBehaviour, searchesATimeWindow ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.setTimestampRule( TimestampRule( QRegExp( "line (\\d+)$" ) ) );
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    filtered_data->runSearch( QRegExp( "glogg" ), TimeWindow( 1000, 1999 ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    ASSERT_THAT( filtered_data->getNbMatches(), 1000 );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ), 1000LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 999 ), 1999LL );
+}
+
+TEST_F( LogDataBehaviour, restartsASearchWithoutItsOldResults ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    // The first search (matching every line) is abandoned at once
+    filtered_data->runSearch( QRegExp( "glogg" ) );
+    filtered_data->runSearch( QRegExp( "line 00012" ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    ASSERT_THAT( filtered_data->getNbMatches(), 10 );
+    for ( const QList<QVariant>& progress : progressSpy )
+        ASSERT_LE( qvariant_cast<qint64>( progress.at( 0 ) ), 10 );
+}
+
+TEST_F( LogDataBehaviour, narrowsTheSearchFromItsMatches ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    // Each pattern typed after the previous one, the last one being
+    // searched for in the whole file again
+    const std::vector<std::pair<const char*, LineNumber>> searches = {
+        { "line 0001", 100 },
+        { "line 00012", 10 },
+        { "line 000123", 1 },
+        { "line 0002", 100 } };
+    for ( const auto& search : searches ) {
+        filtered_data->runNarrowerSearch( QRegExp( search.first ) );
+        int percent = 0;
+        while ( percent < 100 && progressSpy.wait( 10000 ) )
+            percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+        ASSERT_THAT( filtered_data->getNbMatches(), search.second );
+    }
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ), 200LL );
+}
+
+TEST_F( LogDataBehaviour, showsTheMatchesWithTheirContext ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    filtered_data->runSearch( QRegExp( "line 00(0010|0012|0100|4999)$" ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+    ASSERT_THAT( filtered_data->getNbMatches(), 4 );
+
+    // [8, 15) (merged), [98, 103) and [4997, 5000)
+    filtered_data->setVisibility( LogFilteredData::MatchesWithContext );
+    filtered_data->setContextLines( 2 );
+    ASSERT_THAT( filtered_data->getNbLine(), 15LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ), 8LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 6 ), 14LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 7 ), 98LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 14 ), 4999LL );
+    ASSERT_THAT( filtered_data->filteredLineTypeByIndex( 0 ),
+            LogFilteredData::Context );
+    ASSERT_THAT( filtered_data->filteredLineTypeByIndex( 9 ),
+            LogFilteredData::Match );
+
+    filtered_data->setContextLines( 0 );
+    ASSERT_THAT( filtered_data->getNbLine(), 4LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 1 ), 12LL );
+}
+
+TEST_F( LogDataBehaviour, foldsTheRunsOfSimilarLines ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    // The lines only differ by their number
+    const std::vector<AbstractLogData::LineRun> runs = log_data.getLineRuns();
+    ASSERT_THAT( runs.size(), 1u );
+    ASSERT_THAT( runs[0].firstLine, 0LL );
+    ASSERT_THAT( runs[0].nbLines, SL_NB_LINES );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    filtered_data->setVisibility( LogFilteredData::Collapsed );
+    ASSERT_THAT( filtered_data->getNbLine(), 1LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ), 0LL );
+    ASSERT_THAT( filtered_data->getNbFoldedLines( 0 ), SL_NB_LINES );
+    ASSERT_THAT( filtered_data->filteredLineTypeByIndex( 0 ),
+            LogFilteredData::Context );
+}
+
+TEST_F( LogDataBehaviour, countsTheMatchesByRangeOfLines ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    filtered_data->runSearch( QRegExp( "line 000" ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    // The timestamps are not known, the ranges are powers of two
+    const MatchHistogram& histogram = filtered_data->getMatchHistogram( 10 );
+    ASSERT_FALSE( histogram.isByTime() );
+    ASSERT_THAT( histogram.size(), 10 );
+    ASSERT_THAT( histogram.bucketSize(), 512LL );
+    ASSERT_THAT( histogram.count( 0 ), 512LL );
+    ASSERT_THAT( histogram.count( 1 ), 488LL );
+    ASSERT_THAT( histogram.count( 2 ), 0LL );
+    ASSERT_THAT( histogram.maxCount(), 512LL );
+    ASSERT_THAT( histogram.endLine( 9 ), SL_NB_LINES );
+}
+
+TEST_F( LogDataBehaviour, countsTheMatchesByPeriodOfTime ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    // The line numbers are used as timestamps
+    log_data.setTimestampRule( TimestampRule( QRegExp( "line (\\d+)$" ) ) );
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    filtered_data->runSearch( QRegExp( "line 000" ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    const MatchHistogram& histogram = filtered_data->getMatchHistogram( 10 );
+    ASSERT_TRUE( histogram.isByTime() );
+    ASSERT_THAT( histogram.size(), 10 );
+    ASSERT_THAT( histogram.bucketSize(), 500LL );
+    ASSERT_THAT( histogram.startTime( 3 ), 1500LL );
+    ASSERT_THAT( histogram.firstLine( 3 ), 1500LL );
+    ASSERT_THAT( histogram.count( 0 ), 500LL );
+    ASSERT_THAT( histogram.count( 1 ), 500LL );
+    ASSERT_THAT( histogram.count( 2 ), 0LL );
+}
+
+TEST_F( LogDataBehaviour, reusesTheMatchesRestored ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    // Matches which are not the ones of the file, to tell they are used
+    // (the lines after them only being searched)
+    MatchSet matches;
+    matches.append( 1 );
+    matches.append( 2 );
+    matches.append( 3 );
+    filtered_data->restoreMatches( QRegExp( "line 000" ), matches, 4000, -1 );
+
+    filtered_data->runSearch( QRegExp( "line 000" ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    ASSERT_THAT( filtered_data->getNbMatches(), 3LL );
+
+    QRegExp regexp;
+    LineNumber nb_lines;
+    int max_length;
+    ASSERT_TRUE( filtered_data->getCurrentSearch( &regexp, &nb_lines, &max_length ) );
+    ASSERT_THAT( regexp.pattern(), QString( "line 000" ) );
+    ASSERT_THAT( nb_lines, SL_NB_LINES );
+}
+
+TEST_F( LogDataBehaviour, readsUtf16Files ) {
+    // With a byte order mark, a tab and no final LF
+    const char data[] = "\xFF\xFEl\0i\0n\0e\0 \0001\0\n\0a\0\t\0b\0\n\0l\0a\0s\0t\0";
+    QFile file( TMPDIR "/utf16log.txt" );
+    if ( file.open( QIODevice::WriteOnly ) )
+        file.write( data, sizeof( data ) - 1 );
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/utf16log.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    ASSERT_THAT( log_data.getEncoding().type(), TextEncoding::Utf16LE );
+    ASSERT_THAT( log_data.getNbLine(), 3LL );
+    ASSERT_THAT( log_data.getMaxLength(), 9 );
+    ASSERT_THAT( log_data.getLineString( 0 ), QString( "line 1" ) );
+    ASSERT_THAT( log_data.getExpandedLineString( 1 ), QString( "a       b" ) );
+    ASSERT_THAT( log_data.getLines( 1, 2 ), QStringList() << "a\tb" << "last" );
+}
+
+TEST_F( LogDataBehaviour, recordsLineLengths ) {
+    // With a tab, a line too long for 16 bits and no final LF
+    QFile file( TMPDIR "/linelengths.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        file.write( "line 1\na\tb\n" );
+        file.write( QByteArray( 70000, 'x' ) + "\nlast" );
+    }
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.setRecordLineLengths( true );
+    log_data.attachFile( TMPDIR "/linelengths.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    ASSERT_THAT( log_data.hasLineLengths(), true );
+    ASSERT_THAT( log_data.getNbLine(), 4LL );
+    ASSERT_THAT( log_data.getLineLength( 0 ), 6 );
+    ASSERT_THAT( log_data.getLineLength( 1 ), 9 );
+    ASSERT_THAT( log_data.getLineLength( 2 ), 70000 );
+    ASSERT_THAT( log_data.getLineLength( 3 ), 4 );
+
+    // Not recorded by default (the file being indexed again)
+    endSpy.clear();
+    log_data.setRecordLineLengths( false );
+    ASSERT_TRUE( endSpy.wait( 10000 ) );
+    ASSERT_THAT( log_data.hasLineLengths(), false );
+    ASSERT_THAT( log_data.getLineLength( 1 ), 9 );
+}
+
+TEST_F( LogDataBehaviour, writesTheSelectedLines ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    Selection selection;
+    selection.selectRange( 10, 4020 );
+    QBuffer buffer;
+    buffer.open( QIODevice::WriteOnly );
+    ASSERT_TRUE( selection.writeSelectedText( &log_data, &buffer ) );
+    ASSERT_THAT( QString::fromUtf8( buffer.data() ),
+            selection.getSelectedText( &log_data ) );
+
+    // All of them, as in the file without its final LF
+    QFile file( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( file.open( QIODevice::ReadOnly ) );
+    buffer.close();
+    buffer.setData( QByteArray() );
+    buffer.open( QIODevice::WriteOnly );
+    ASSERT_TRUE( Selection::writeLines( &log_data, 0, SL_NB_LINES - 1, &buffer ) );
+    ASSERT_THAT( buffer.data() + "\n", file.readAll() );
+}
+
+TEST_F( LogDataBehaviour, fetchesSparseLines ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    // Close and far apart, out of order and repeated
+    const std::vector<qint64> lines = { 0, 2, 3, 1500, 4999, 12, 12 };
+    const QStringList fetched = log_data.getLinesAt( lines );
+    ASSERT_THAT( fetched.size(), (int) lines.size() );
+    for ( size_t i = 0; i < lines.size(); i++ )
+        ASSERT_THAT( fetched[i], log_data.getLineString( lines[i] ) );
+
+    // A missing line is left empty
+    const QStringList expanded = log_data.getExpandedLinesAt( { 7, SL_NB_LINES } );
+    ASSERT_THAT( expanded.size(), 2 );
+    ASSERT_THAT( expanded[0], log_data.getExpandedLineString( 7 ) );
+    ASSERT_THAT( expanded[1], QString() );
+}
+
+TEST_F( LogDataBehaviour, readsWindowsOfTheLongLines ) {
+    // A long line with tabs and multi-byte characters (some cut by
+    // the pieces it is decoded by), between short ones
+    QByteArray long_line;
+    for ( int i = 0; long_line.size() < 300000; i++ )
+        long_line.append( ( i % 7 == 0 ) ? "\t" : "caf\xC3\xA9 \xE6\x97\xA5 " );
+    QFile file( TMPDIR "/longlines.txt" );
+    if ( file.open( QIODevice::WriteOnly ) )
+        file.write( "line 1\n" + long_line + "\na\tb\n" );
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/longlines.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+    ASSERT_THAT( log_data.getNbLine(), 3LL );
+
+    const QString expanded = log_data.getExpandedLineString( 1 );
+    LineBuffer lines;
+    std::vector<int> windowStarts;
+    for ( int first_col : { 0, 5, 65530, 150001, expanded.size() - 10 } ) {
+        log_data.getExpandedLineWindows( 0, 3, first_col, 80,
+                &lines, &windowStarts );
+        ASSERT_THAT( lines.size(), 3 );
+        ASSERT_THAT( windowStarts, std::vector<int>( { -1, first_col, -1 } ) );
+        ASSERT_THAT( lines.string( 0 ), QString( "line 1" ) );
+        ASSERT_THAT( lines.string( 1 ), expanded.mid( first_col, 80 ) );
+        ASSERT_THAT( lines.string( 2 ), QString( "a       b" ) );
+    }
+}
+
+TEST_F( LogDataBehaviour, answersQueriesOnIndexedFields ) {
+    QFile file( TMPDIR "/fieldslog.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        file.write( "12:00 level=ERROR service=payments msg=declined\n" );
+        file.write( "12:01 level=INFO service=payments\n" );
+        file.write( "{\"level\": \"ERROR\", \"service\": \"payments\"}\n" );
+        file.write( "{\"level\": \"ERROR\", \"service\": \"search\"}\n" );
+        // The text of the field is not the field
+        file.write( "12:02 msg=\"service=payments\" level=ERROR\n" );
+    }
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/fieldslog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    filtered_data->setIndexedFields( QStringList() << "level" << "service" );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    filtered_data->runQuery(
+            SearchQuery( "level=ERROR AND service=payments", Qt::CaseSensitive ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    ASSERT_THAT( filtered_data->getNbMatches(), 2 );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ), 0LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 1 ), 2LL );
+
+    // With a term searched in the text
+    filtered_data->runQuery(
+            SearchQuery( "level=error AND declined", Qt::CaseInsensitive ) );
+    percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    ASSERT_THAT( filtered_data->getNbMatches(), 1 );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ), 0LL );
+}
+
+TEST_F( LogDataBehaviour, exportsTheMatches ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+    SafeQSignalSpy exportSpy( filtered_data.get(),
+            SIGNAL( exportFinished( bool ) ) );
+
+    // Runs of consecutive lines and single ones
+    const QRegExp regexp( "line 00(012|03[0-9]|4[0-9]00)" );
+    filtered_data->runSearch( regexp );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+    ASSERT_THAT( filtered_data->getNbMatches(), 120 );
+
+    filtered_data->exportMatches( TMPDIR "/exportedmatches.txt" );
+    ASSERT_TRUE( exportSpy.safeWait( 10000 ) );
+    ASSERT_TRUE( exportSpy.last().at( 0 ).toBool() );
+
+    QByteArray expected;
+    QFile file( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( file.open( QIODevice::ReadOnly ) );
+    while ( ! file.atEnd() ) {
+        const QByteArray line = file.readLine();
+        if ( regexp.indexIn( QString::fromUtf8( line ) ) >= 0 )
+            expected.append( line );
+    }
+
+    QFile exported( TMPDIR "/exportedmatches.txt" );
+    ASSERT_TRUE( exported.open( QIODevice::ReadOnly ) );
+    ASSERT_THAT( exported.readAll(), expected );
+}
+
+TEST_F( LogDataBehaviour, searchesTheLinesHavingTheTokens ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    filtered_data->setTokenIndexFile( TMPDIR "/smalllog.txt" );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    // Whole tokens, parts of tokens and no token at all
+    const std::vector<std::pair<const char*, LineNumber>> searches = {
+        { "test it thoroughly", SL_NB_LINES },
+        { "glo", SL_NB_LINES },
+        { "line 00012", 10 },
+        { "00012", 10 },
+        { "xyzzy", 0 } };
+    for ( const auto& search : searches ) {
+        filtered_data->runSearch( QRegExp( search.first ) );
+        int percent = 0;
+        while ( percent < 100 && progressSpy.wait( 10000 ) )
+            percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+        ASSERT_THAT( filtered_data->getNbMatches(), search.second );
+    }
+}
+
+TEST_F( LogDataBehaviour, searchesTheBlocksHavingTheTrigrams ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    filtered_data->setTrigramIndexEnabled( true );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    // Including lines after the last block indexed
+    const std::vector<std::pair<QRegExp, LineNumber>> searches = {
+        { QRegExp( "*test it*thoroughly*", Qt::CaseSensitive, QRegExp::Wildcard ),
+            SL_NB_LINES },
+        { QRegExp( "line 00012" ), 10 },
+        { QRegExp( "LINE 00012", Qt::CaseInsensitive ), 10 },
+        { QRegExp( "line 0049[0-9]" ), 10 },
+        { QRegExp( "xyzzy" ), 0 },
+        { QRegExp( "\\d" ), SL_NB_LINES } };
+    for ( const auto& search : searches ) {
+        filtered_data->runSearch( search.first );
+        int percent = 0;
+        while ( percent < 100 && progressSpy.wait( 10000 ) )
+            percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+        ASSERT_THAT( filtered_data->getNbMatches(), search.second );
+    }
+}
+
+TEST_F( LogDataBehaviour, skipsTheBlocksWithoutTheSearchedWords ) {
+    // A few blocks of lines with a trace id each, the last line being
+    // completed as the file grows
+    char line[100];
+    QFile file( TMPDIR "/tracelog.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for ( int i = 0; i < 60000; i++ ) {
+            snprintf( line, sizeof line, "request %06d trace=%08x%08x done\n",
+                    i, i * 2654435761u, i );
+            file.write( line, qstrlen( line ) );
+        }
+        file.write( "request 999999 trace=0123456789abcdef" );
+    }
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.setBuildSkipIndex( true );
+    log_data.attachFile( TMPDIR "/tracelog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    ASSERT_TRUE( log_data.getSkipIndex() != nullptr );
+    ASSERT_GE( log_data.getSkipIndex()->size(), 3 );
+
+    if ( file.open( QIODevice::Append ) )
+        file.write( "0123456789abcdef done\nrequest 999999 trace=ffffffffffffffff done\n" );
+    file.close();
+    ASSERT_TRUE( endSpy.wait( 1000 ) );
+    ASSERT_THAT( log_data.getNbLine(), 60002LL );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    snprintf( line, sizeof line, "%08x%08x", 31337 * 2654435761u, 31337 );
+    const std::vector<std::pair<QRegExp, LineNumber>> searches = {
+        { QRegExp( line ), 1 },
+        { QRegExp( QString( line ).toUpper(), Qt::CaseInsensitive ), 1 },
+        { QRegExp( QString( line ).mid( 3, 11 ) ), 1 },
+        { QRegExp( "0123456789abcdef0123456789abcdef" ), 1 },
+        { QRegExp( " ffffffffffffffff " ), 0 },
+        { QRegExp( "=ffffffffffffffff done" ), 1 },
+        { QRegExp( " request 031337 " ), 0 },
+        { QRegExp( "request 031337 " ), 1 },
+        { QRegExp( "done" ), 60002 } };
+    for ( const auto& search : searches ) {
+        filtered_data->runSearch( search.first );
+        int percent = 0;
+        while ( percent < 100 && progressSpy.wait( 10000 ) )
+            percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+        ASSERT_THAT( filtered_data->getNbMatches(), search.second );
+    }
+}
+
+TEST_F( LogDataBehaviour, searchesTheLinesWhileIndexingThem ) {
+    // Every tenth line matching, the last one too (not LF terminated)
+    char line[100];
+    QFile file( TMPDIR "/fusedlog.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for ( int i = 0; i < 50000; i++ ) {
+            snprintf( line, sizeof line, "request %06d status=%d\n",
+                    i, ( i % 10 == 3 ) ? 500 : 200 );
+            file.write( line, qstrlen( line ) );
+        }
+        file.write( "request 999999 status=500" );
+    }
+    file.close();
+
+    const QRegExp regexp( "status=5\\d\\d" );
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.setFusedSearch( regexp );
+    log_data.attachFile( TMPDIR "/fusedlog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    MatchSet matches;
+    LineNumber nbLines;
+    int maxLength;
+    ASSERT_TRUE( log_data.getFusedSearch()->find( regexp, &matches,
+                &nbLines, &maxLength ) );
+    ASSERT_FALSE( log_data.getFusedSearch()->find( QRegExp( "status" ),
+                &matches, &nbLines, &maxLength ) );
+    ASSERT_THAT( nbLines, 50001u );
+    ASSERT_THAT( matches.size(), 5001u );
+    ASSERT_THAT( matches.last(), 50000u );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_data.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    filtered_data->runSearch( regexp );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    ASSERT_THAT( filtered_data->getNbMatches(), 5001 );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 0 ), 3LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 5000 ), 50000LL );
+
+    // Forgotten once the file is indexed again
+    log_data.reload();
+    ASSERT_TRUE( endSpy.wait( 10000 ) );
+    ASSERT_FALSE( log_data.getFusedSearch()->find( regexp, &matches,
+                &nbLines, &maxLength ) );
+}
+
+TEST_F( LogDataBehaviour, showsTheLinesWhileIndexingThem ) {
+    // Of more than one block read by the indexing
+    char line[100];
+    QFile file( TMPDIR "/prefixlog.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for ( int i = 0; i < 200000; i++ ) {
+            snprintf( line, sizeof line, "request %06d of the prefix test\n", i );
+            file.write( line, qstrlen( line ) );
+        }
+    }
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    // The last line shown is read as soon as it is
+    qint64 nbLinesShown = 0;
+    QString lastLineShown;
+    QObject::connect( &log_data, &LogData::linesIndexed,
+            [&] ( qint64 nbLines ) {
+                nbLinesShown = nbLines;
+                lastLineShown = log_data.getLineString( nbLines - 1 );
+            } );
+
+    // (the lengths being recorded, the index is not taken from the cache)
+    log_data.setRecordLineLengths( true );
+    log_data.attachFile( TMPDIR "/prefixlog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    ASSERT_THAT( nbLinesShown, testing::Gt( 0LL ) );
+    ASSERT_THAT( nbLinesShown, testing::Lt( 200000LL ) );
+    snprintf( line, sizeof line, "request %06d of the prefix test",
+            int( nbLinesShown - 1 ) );
+    ASSERT_THAT( lastLineShown, QString( line ) );
+
+    // The same lines once indexed
+    ASSERT_THAT( log_data.getNbLine(), 200000LL );
+    ASSERT_THAT( log_data.getLineString( nbLinesShown - 1 ), QString( line ) );
+}
+
+TEST_F( LogDataBehaviour, keepsTheLinesShownWhileReindexing ) {
+    char line[100];
+    QFile file( TMPDIR "/prefixreload.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for ( int i = 0; i < 200000; i++ ) {
+            snprintf( line, sizeof line, "request %06d of the reload test\n", i );
+            file.write( line, qstrlen( line ) );
+        }
+    }
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.setRecordLineLengths( true );
+    log_data.attachFile( TMPDIR "/prefixreload.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+    ASSERT_THAT( log_data.getNbLine(), 200000LL );
+
+    // The previous lines are shown until the reindexing ends, none
+    // being added to them
+    qint64 maxNbLines = 0;
+    auto record = [&] () {
+        maxNbLines = qMax( maxNbLines, log_data.getNbLine() ); };
+    QObject::connect( &log_data, &LogData::loadingProgressed, record );
+    QObject::connect( &log_data, &LogData::linesIndexed, record );
+
+    endSpy.clear();
+    log_data.reload();
+    ASSERT_TRUE( endSpy.wait( 10000 ) );
+
+    ASSERT_THAT( maxNbLines, testing::Le( 200000LL ) );
+    ASSERT_THAT( log_data.getNbLine(), 200000LL );
+    snprintf( line, sizeof line, "request %06d of the reload test", 199999 );
+    ASSERT_THAT( log_data.getLineString( 199999 ), QString( line ) );
+}
+
+TEST_F( LogDataBehaviour, countsTheMatchesOfASmallFileExactly ) {
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/smalllog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    MatchEstimator estimator( &log_data );
+    SafeQSignalSpy estimateSpy( &estimator,
+            SIGNAL( estimated( const QRegExp&, qint64, qint64, qint64 ) ) );
+
+    estimator.estimate( QRegExp( "line 00(012|03[0-9]|4[0-9]00)" ) );
+    ASSERT_TRUE( estimateSpy.safeWait( 10000 ) );
+
+    ASSERT_THAT( estimateSpy.last().at( 1 ).toLongLong(), 120LL );
+    ASSERT_THAT( estimateSpy.last().at( 2 ).toLongLong(), SL_NB_LINES );
+}
+
+TEST_F( LogDataBehaviour, estimatesTheMatchesOfABigFileFromSamples ) {
+    // A line in ten matching
+    char line[100];
+    QFile file( TMPDIR "/estimatedlog.txt" );
+    if ( file.open( QIODevice::WriteOnly ) ) {
+        for ( int i = 0; i < 200000; i++ ) {
+            snprintf( line, sizeof line, "request %06d %s\n", i,
+                    ( i % 10 == 3 ) ? "failed ERROR" : "served" );
+            file.write( line, qstrlen( line ) );
+        }
+    }
+    file.close();
+
+    LogData log_data;
+    SafeQSignalSpy endSpy( &log_data, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_data.attachFile( TMPDIR "/estimatedlog.txt" );
+    ASSERT_TRUE( endSpy.safeWait( 10000 ) );
+
+    MatchEstimator estimator( &log_data );
+    SafeQSignalSpy estimateSpy( &estimator,
+            SIGNAL( estimated( const QRegExp&, qint64, qint64, qint64 ) ) );
+
+    // The first estimate is abandoned for the second one (not sent)
+    estimator.estimate( QRegExp( "served" ) );
+    estimator.estimate( QRegExp( "ERROR" ) );
+    ASSERT_TRUE( estimateSpy.safeWait( 10000 ) );
+
+    ASSERT_THAT( estimateSpy.last().at( 0 ).toRegExp().pattern(),
+            QString( "ERROR" ) );
+    const qint64 nbMatches = estimateSpy.last().at( 1 ).toLongLong();
+    ASSERT_THAT( nbMatches, testing::Ge( 19000LL ) );
+    ASSERT_THAT( nbMatches, testing::Le( 21000LL ) );
+    ASSERT_THAT( estimateSpy.last().at( 2 ).toLongLong(),
+            testing::Le( MatchEstimator::linesInBlock
+                * MatchEstimator::maxBlocks ) );
+    ASSERT_THAT( estimateSpy.last().at( 3 ).toLongLong(), testing::Ge( 0LL ) );
+}
@@ -0,0 +1,100 @@
+#include <QTest>
+#include <QSignalSpy>
+
+#include "log.h"
+#include "test_utils.h"
+
+#include "data/logdataset.h"
+#include "data/logfiltereddata.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+#define TMPDIR "/tmp"
+
+static const char* set_format="LOGDATASET is a part of glogg, this is line %06d of file %d\n";
+
+class LogDataSetBehaviour : public testing::Test {
+  public:
+    LogDataSetBehaviour() {
+        // The first one not ending with a LF
+        writeFile( TMPDIR "/logset.txt.2", 0, 100, "partial" );
+        writeFile( TMPDIR "/logset.txt.1", 1, 0, "" );
+        writeFile( TMPDIR "/logset.txt", 2, 50, "" );
+    }
+
+    static QStringList fileNames() {
+        return QStringList() << TMPDIR "/logset.txt.2"
+            << TMPDIR "/logset.txt.1" << TMPDIR "/logset.txt";
+    }
+
+    static QString line( int number, int file ) {
+        char newLine[90];
+        snprintf(newLine, 89, set_format, number, file);
+        newLine[ qstrlen( newLine ) - 1 ] = '\0';
+        return QString( newLine );
+    }
+
+  private:
+    static void writeFile( const char* fileName, int file_number,
+            int nb_lines, const char* end ) {
+        char newLine[90];
+
+        QFile file( fileName );
+        if ( file.open( QIODevice::WriteOnly ) ) {
+            for (int i = 0; i < nb_lines; i++) {
+                snprintf(newLine, 89, set_format, i, file_number);
+                file.write( newLine, qstrlen(newLine) );
+            }
+            file.write( end, qstrlen( end ) );
+        }
+        file.close();
+    }
+};
+
+TEST_F( LogDataSetBehaviour, presentsTheFilesAsOne ) {
+    LogDataSet log_set;
+    SafeQSignalSpy finishedSpy( &log_set, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_set.attachFiles( fileNames() );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+    QTest::qWait( 100 );
+
+    ASSERT_THAT( finishedSpy.count(), 1 );
+    ASSERT_THAT( log_set.getNbLine(), 151LL );
+    ASSERT_THAT( log_set.getLineString( 99 ), line( 99, 0 ) );
+    ASSERT_THAT( log_set.getLineString( 100 ), QString( "partial" ) );
+    ASSERT_THAT( log_set.getLineString( 101 ), line( 0, 2 ) );
+    ASSERT_THAT( log_set.getLineString( 150 ), line( 49, 2 ) );
+
+    ASSERT_THAT( log_set.getLines( 99, 3 ), ElementsAre(
+                line( 99, 0 ), QString( "partial" ), line( 0, 2 ) ) );
+
+    ASSERT_THAT( log_set.getFileIndex( 100 ), 0 );
+    ASSERT_THAT( log_set.getFileIndex( 101 ), 2 );
+    ASSERT_THAT( log_set.getFirstLine( 2 ), 101LL );
+}
+
+TEST_F( LogDataSetBehaviour, searchesAllTheFiles ) {
+    LogDataSet log_set;
+    SafeQSignalSpy finishedSpy( &log_set, SIGNAL( loadingFinished( LoadingStatus ) ) );
+
+    log_set.attachFiles( fileNames() );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+
+    std::unique_ptr<LogFilteredData> filtered_data( log_set.getNewFilteredData() );
+    SafeQSignalSpy progressSpy( filtered_data.get(),
+            SIGNAL( searchProgressed( qint64, int ) ) );
+
+    filtered_data->runSearch( QRegExp( "line 00004[0-9]|partial" ) );
+    int percent = 0;
+    while ( percent < 100 && progressSpy.wait( 10000 ) )
+        percent = qvariant_cast<int>( progressSpy.last().at( 1 ) );
+
+    // 10 lines of each complete file and the partial line between them
+    ASSERT_THAT( filtered_data->getNbLine(), 21LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 10 ), 100LL );
+    ASSERT_THAT( filtered_data->getMatchingLineNumber( 11 ), 141LL );
+    ASSERT_THAT( filtered_data->getLineString( 20 ), line( 49, 2 ) );
+}
@@ -21,7 +21,7 @@ class PerfLogFilteredData : public testing::Test {
   public:
     PerfLogFilteredData()
         : log_data_(), filtered_data_( log_data_.getNewFilteredData() ),
-          progressSpy( filtered_data_.get(), SIGNAL( searchProgressed( int, int ) ) ) {
+          progressSpy( filtered_data_.get(), SIGNAL( searchProgressed( qint64, int ) ) ) {
         FILELog::setReportingLevel( logERROR );
 
         generateDataFiles();
@@ -0,0 +1,63 @@
+#include <random>
+#include <string>
+
+#include "test_utils.h"
+
+#include "data/matchset.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+static const int NB_LOOKUPS = 10000000;
+
+class PerfMatchSet : public testing::Test {
+  public:
+    // Returns a set of nb_matches lines, one line in every_line
+    static MatchSet makeSet( LineNumber nb_matches, int every_line ) {
+        MatchSet set;
+        for ( LineNumber i = 0; i < nb_matches; i++ )
+            set.append( i * every_line );
+
+        return set;
+    }
+
+    // Select then rank random lines of the set, as the views do
+    // when painting and the searches when merging
+    static void lookUp( const MatchSet& set, const std::string& name ) {
+        std::mt19937_64 random( 42 );
+        std::uniform_int_distribution<LineNumber> index( 0, set.size() - 1 );
+
+        std::vector<LineNumber> indexes( NB_LOOKUPS );
+        for ( LineNumber& i : indexes )
+            i = index( random );
+
+        std::vector<LineNumber> lines( NB_LOOKUPS );
+        {
+            TestTimer t( "PerfMatchSet.select " + name );
+            for ( int i = 0; i < NB_LOOKUPS; i++ )
+                lines[i] = set.select( indexes[i] );
+        }
+
+        LineNumber errors = 0;
+        {
+            TestTimer t( "PerfMatchSet.rank " + name );
+            for ( int i = 0; i < NB_LOOKUPS; i++ )
+                errors += ( set.rank( lines[i] ) != indexes[i] );
+        }
+
+        ASSERT_THAT( errors, 0 );
+    }
+};
+
+TEST_F( PerfMatchSet, lookUpInDenseSets ) {
+    for ( LineNumber nb_matches : { 1000000LL, 10000000LL, 100000000LL } )
+        lookUp( makeSet( nb_matches, 2 ),
+                std::to_string( nb_matches ) + " dense" );
+}
+
+TEST_F( PerfMatchSet, lookUpInSparseSets ) {
+    for ( LineNumber nb_matches : { 1000000LL, 10000000LL, 100000000LL } )
+        lookUp( makeSet( nb_matches, 50 ),
+                std::to_string( nb_matches ) + " sparse" );
+}
@@ -0,0 +1,153 @@
+#include "gmock/gmock.h"
+
+#include "data/matchset.h"
+
+using namespace std;
+using namespace testing;
+
+class MatchSetBehaviour: public testing::Test {
+  public:
+    MatchSet match_set;
+
+    void SetUp() override {
+        match_set.append( 4 );
+        match_set.append( 8 );
+        match_set.append( 10 );
+        // In another container
+        match_set.append( 345000 );
+        match_set.append( 345004 );
+    }
+};
+
+TEST_F( MatchSetBehaviour, canBeMadeEmpty ) {
+    MatchSet set;
+    ASSERT_THAT( set.size(), 0 );
+    ASSERT_THAT( set.empty(), true );
+}
+
+TEST_F( MatchSetBehaviour, keepsLines ) {
+    ASSERT_THAT( match_set.size(), 5 );
+    ASSERT_THAT( match_set.select( 0 ), 4 );
+    ASSERT_THAT( match_set.select( 3 ), 345000 );
+    ASSERT_THAT( match_set.last(), 345004 );
+}
+
+TEST_F( MatchSetBehaviour, knowsItsLines ) {
+    ASSERT_THAT( match_set.contains( 8 ), true );
+    ASSERT_THAT( match_set.contains( 9 ), false );
+    ASSERT_THAT( match_set.contains( 345004 ), true );
+    ASSERT_THAT( match_set.contains( 2000000 ), false );
+}
+
+TEST_F( MatchSetBehaviour, ranksLines ) {
+    ASSERT_THAT( match_set.rank( 0 ), 0 );
+    ASSERT_THAT( match_set.rank( 8 ), 1 );
+    ASSERT_THAT( match_set.rank( 9 ), 2 );
+    ASSERT_THAT( match_set.rank( 345001 ), 4 );
+    ASSERT_THAT( match_set.rank( 2000000 ), 5 );
+}
+
+TEST_F( MatchSetBehaviour, removesTheLastLine ) {
+    match_set.removeLast();
+    match_set.removeLast();
+    ASSERT_THAT( match_set.size(), 3 );
+    ASSERT_THAT( match_set.last(), 10 );
+    ASSERT_THAT( match_set.contains( 345000 ), false );
+
+    match_set.append( 20 );
+    ASSERT_THAT( match_set.select( 3 ), 20 );
+}
+
+TEST_F( MatchSetBehaviour, iteratesInOrder ) {
+    vector<LineNumber> lines;
+    for ( LineNumber line : match_set )
+        lines.push_back( line );
+    ASSERT_THAT( lines, ElementsAre( 4, 8, 10, 345000, 345004 ) );
+}
+
+TEST_F( MatchSetBehaviour, iteratesFromALine ) {
+    vector<LineNumber> lines;
+    for ( auto i = match_set.lowerBound( 9 ); i != match_set.end(); ++i )
+        lines.push_back( *i );
+    ASSERT_THAT( lines, ElementsAre( 10, 345000, 345004 ) );
+
+    ASSERT_THAT( *match_set.lowerBound( 8 ), 8 );
+    ASSERT_THAT( *match_set.lowerBound( 11 ), 345000 );
+    ASSERT_THAT( match_set.lowerBound( 345005 ) == match_set.end(), true );
+}
+
+TEST_F( MatchSetBehaviour, combinesSets ) {
+    MatchSet other;
+    other.append( 8 );
+    other.append( 12 );
+    other.append( 345004 );
+
+    vector<LineNumber> united;
+    for ( LineNumber line : match_set.united( other ) )
+        united.push_back( line );
+    ASSERT_THAT( united, ElementsAre( 4, 8, 10, 12, 345000, 345004 ) );
+
+    vector<LineNumber> intersected;
+    for ( LineNumber line : match_set.intersected( other ) )
+        intersected.push_back( line );
+    ASSERT_THAT( intersected, ElementsAre( 8, 345004 ) );
+
+    vector<LineNumber> subtracted;
+    for ( LineNumber line : match_set.subtracted( other ) )
+        subtracted.push_back( line );
+    ASSERT_THAT( subtracted, ElementsAre( 4, 10, 345000 ) );
+}
+
+TEST_F( MatchSetBehaviour, complementsSets ) {
+    vector<LineNumber> complemented;
+    for ( LineNumber line : match_set.complemented( 12 ) )
+        complemented.push_back( line );
+    ASSERT_THAT( complemented, ElementsAre( 0, 1, 2, 3, 5, 6, 7, 9, 11 ) );
+}
+
+class MatchSetDense: public testing::Test {
+  public:
+    static const LineNumber nb_lines = 200000;
+    MatchSet match_set;
+
+    void SetUp() override {
+        // Every other line
+        for ( LineNumber line = 0; line < nb_lines; line += 2 )
+            match_set.append( line );
+    }
+};
+
+TEST_F( MatchSetDense, keepsAllLines ) {
+    ASSERT_THAT( match_set.size(), nb_lines / 2 );
+    for ( LineNumber i = 0; i < nb_lines / 2; i++ ) {
+        ASSERT_THAT( match_set.select( i ), i * 2 );
+        ASSERT_THAT( match_set.rank( i * 2 ), i );
+        ASSERT_THAT( match_set.contains( i * 2 + 1 ), false );
+    }
+}
+
+TEST_F( MatchSetDense, iteratesOverBitmaps ) {
+    LineNumber expected = 0;
+    for ( LineNumber line : match_set ) {
+        ASSERT_THAT( line, expected );
+        expected += 2;
+    }
+    ASSERT_THAT( expected, nb_lines );
+}
+
+TEST_F( MatchSetDense, iteratesFromALineOfABitmap ) {
+    auto i = match_set.lowerBound( 70001 );
+    ASSERT_THAT( *i, 70002 );
+    ++i;
+    ASSERT_THAT( *i, 70004 );
+}
+
+TEST_F( MatchSetDense, removesTheLastLineOfABitmap ) {
+    match_set.removeLast();
+    ASSERT_THAT( match_set.last(), nb_lines - 4 );
+}
+
+TEST_F( MatchSetDense, usesLessMemoryThanAnArray ) {
+    ASSERT_THAT( match_set.allocatedSize(),
+            Lt( match_set.size() * sizeof( LineNumber ) / 2 ) );
+}
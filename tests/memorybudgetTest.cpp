@@ -0,0 +1,115 @@
+#include <vector>
+
+#include "gmock/gmock.h"
+
+#include "data/memorybudget.h"
+
+using namespace std;
+using namespace testing;
+
+// Releases its memory when asked, recording the order of the calls
+class FakeClient : public MemoryBudget::Client {
+  public:
+    FakeClient( vector<FakeClient*>* released )
+        : released_( released ), nbReleases( 0 ), usage( 0 )
+    { MemoryBudget::instance().addClient( this ); }
+    ~FakeClient()
+    { MemoryBudget::instance().removeClient( this ); }
+
+    void use( qint64 size )
+    {
+        usage = size;
+        MemoryBudget::instance().setUsage( this, usage );
+    }
+
+    void releaseMemory() override
+    {
+        nbReleases++;
+        released_->push_back( this );
+    }
+
+    vector<FakeClient*>* released_;
+    int nbReleases;
+    qint64 usage;
+};
+
+class MemoryBudgetBehaviour : public testing::Test {
+  public:
+    MemoryBudgetBehaviour() : released()
+    { MemoryBudget::instance().setLimit( 1000 ); }
+    ~MemoryBudgetBehaviour()
+    { MemoryBudget::instance().setLimit( 0 ); }
+
+    vector<FakeClient*> released;
+};
+
+TEST_F( MemoryBudgetBehaviour, asksNothingUnderTheLimit ) {
+    FakeClient a( &released );
+    FakeClient b( &released );
+    a.use( 400 );
+    b.use( 600 );
+
+    ASSERT_THAT( MemoryBudget::instance().usage(), 1000 );
+    ASSERT_THAT( released.size(), 0 );
+}
+
+TEST_F( MemoryBudgetBehaviour, asksTheHiddenClientsFirst ) {
+    MemoryBudget& budget = MemoryBudget::instance();
+    FakeClient visible( &released );
+    FakeClient hidden( &released );
+    FakeClient shown_before( &released );
+    budget.setPriority( &shown_before, TaskScheduler::Visible );
+    budget.setPriority( &shown_before, TaskScheduler::Background );
+    budget.setPriority( &visible, TaskScheduler::Visible );
+
+    visible.use( 500 );
+    hidden.use( 300 );
+    shown_before.use( 300 );
+
+    // The one hidden for the longest is enough
+    ASSERT_THAT( released, ElementsAre( &hidden ) );
+
+    released.clear();
+    visible.use( 900 );
+    ASSERT_THAT( released, ElementsAre( &shown_before ) );
+
+    // Then the one displayed
+    released.clear();
+    visible.use( 1200 );
+    ASSERT_THAT( released, ElementsAre( &visible ) );
+}
+
+TEST_F( MemoryBudgetBehaviour, asksAgainOnlyOnceTheUsageChanged ) {
+    FakeClient a( &released );
+    a.use( 1500 );
+    ASSERT_THAT( a.nbReleases, 1 );
+
+    // Not released yet
+    MemoryBudget::instance().setUsage( &a, 1500 );
+    ASSERT_THAT( a.nbReleases, 1 );
+
+    a.use( 1200 );
+    ASSERT_THAT( a.nbReleases, 2 );
+
+    a.use( 100 );
+    a.use( 200 );
+    ASSERT_THAT( a.nbReleases, 2 );
+}
+
+TEST_F( MemoryBudgetBehaviour, asksWhenTheLimitIsLowered ) {
+    FakeClient a( &released );
+    FakeClient b( &released );
+    a.use( 400 );
+    b.use( 400 );
+    ASSERT_THAT( released.size(), 0 );
+
+    MemoryBudget::instance().setLimit( 500 );
+    ASSERT_THAT( released, ElementsAre( &a ) );
+    ASSERT_THAT( MemoryBudget::instance().limit(), 500 );
+}
+
+TEST( MemoryBudgetDefault, isHalfThePhysicalMemory ) {
+    MemoryBudget::instance().setLimit( 0 );
+    ASSERT_THAT( MemoryBudget::instance().limit(),
+            MemoryBudget::physicalMemory() / 2 );
+}
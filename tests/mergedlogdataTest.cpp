@@ -0,0 +1,68 @@
+#include <QTest>
+#include <QSignalSpy>
+
+#include "log.h"
+#include "test_utils.h"
+
+#include "data/logdata.h"
+#include "data/mergedlogdata.h"
+
+#include "gmock/gmock.h"
+
+using namespace testing;
+
+#define TMPDIR "/tmp"
+
+class MergedLogDataBehaviour : public testing::Test {
+  public:
+    static void writeFile( const char* fileName, const QStringList& lines ) {
+        QFile file( fileName );
+        if ( file.open( QIODevice::WriteOnly ) ) {
+            for ( const QString& line : lines )
+                file.write( ( line + "\n" ).toUtf8() );
+        }
+        file.close();
+    }
+
+    static void load( LogData* log_data, const char* fileName ) {
+        SafeQSignalSpy finishedSpy( log_data,
+                SIGNAL( loadingFinished( LoadingStatus ) ) );
+        log_data->attachFile( fileName );
+        finishedSpy.safeWait();
+    }
+};
+
+TEST_F( MergedLogDataBehaviour, interleavesTheLinesByTimestamp ) {
+    writeFile( TMPDIR "/node1.log", QStringList()
+            << "10:00:01 node1 starting"
+            << "10:00:04 node1 error"
+            << "    continuation of the error"
+            << "10:00:05 node1 stopping" );
+    writeFile( TMPDIR "/node2.log", QStringList()
+            << "10:00:02 node2 starting"
+            << "10:00:04 node2 sending"
+            << "10:00:06 node2 stopping" );
+
+    LogData node1, node2;
+    load( &node1, TMPDIR "/node1.log" );
+    load( &node2, TMPDIR "/node2.log" );
+
+    MergedLogData merged_data( { &node1, &node2 },
+            TimestampRule( QRegExp( "^(\\S+)" ) ) );
+    SafeQSignalSpy finishedSpy( &merged_data,
+            SIGNAL( loadingFinished( LoadingStatus ) ) );
+    ASSERT_TRUE( finishedSpy.safeWait() );
+
+    ASSERT_THAT( merged_data.getNbLine(), 7LL );
+    ASSERT_THAT( merged_data.getLines( 0, 7 ), ElementsAre(
+                QString( "10:00:01 node1 starting" ),
+                QString( "10:00:02 node2 starting" ),
+                QString( "10:00:04 node1 error" ),
+                QString( "    continuation of the error" ),
+                QString( "10:00:04 node2 sending" ),
+                QString( "10:00:05 node1 stopping" ),
+                QString( "10:00:06 node2 stopping" ) ) );
+
+    ASSERT_THAT( merged_data.getSourceIndex( 4 ), 1 );
+    ASSERT_THAT( merged_data.getSourceLineNumber( 4 ), 1LL );
+}
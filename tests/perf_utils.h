@@ -0,0 +1,296 @@
+#ifndef PERF_UTILS_H
+#define PERF_UTILS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "gmock/gmock.h"
+
+// A kind of log file to benchmark on, generated from a fixed seed so
+// the same data is used from one run (and one machine) to the next.
+struct LogProfile {
+    const char* name;
+    qint64 nbLines;
+    // Length of the text of a line, drawn uniformly in [min, max]
+    int minLength;
+    int maxLength;
+    // Share of the lines having a tab, some UTF-8 text, and of the
+    // (much) longer lines
+    double tabRatio;
+    double utf8Ratio;
+    double longLineRatio;
+    int longLineLength;
+    // A line in matchInterval has the needle (none if 0)
+    int matchInterval;
+};
+
+// What has been generated
+struct LogDataset {
+    QString fileName;
+    qint64 nbLines;
+    qint64 size;
+    qint64 nbMatches;
+};
+
+// The word the matching lines have
+static const char* const benchmarkNeedle = "NEEDLE";
+
+// Returns the line number-th of the profile (without its LF)
+inline QByteArray generateLine( const LogProfile& profile, qint64 number,
+        std::mt19937_64& random )
+{
+    static const char* const words[] = { "request", "user", "session",
+        "GET", "POST", "/api/v1/items", "status=200", "status=500",
+        "latency_ms=", "cache", "miss", "hit", "payments", "INFO", "WARN",
+        "ERROR", "connection", "closed", "retrying", "timeout" };
+    static const char* const utf8_words[] = { "caf\xC3\xA9", "na\xC3\xAFve",
+        "\xE6\x97\xA5\xE6\x9C\xAC", "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82" };
+
+    std::uniform_real_distribution<double> ratio( 0.0, 1.0 );
+    const int length = ( ratio( random ) < profile.longLineRatio ) ?
+        profile.longLineLength :
+        std::uniform_int_distribution<int>( profile.minLength,
+                profile.maxLength )( random );
+    const bool tab = ratio( random ) < profile.tabRatio;
+    const bool utf8 = ratio( random ) < profile.utf8Ratio;
+    const bool match = profile.matchInterval > 0
+        && number % profile.matchInterval == profile.matchInterval / 2;
+
+    QByteArray line;
+    line.reserve( length + 64 );
+    line.append( QByteArray::number( 1500000000000LL + number * 17 ) );
+    line.append( tab ? '\t' : ' ' );
+    if ( match ) {
+        line.append( benchmarkNeedle );
+        line.append( ' ' );
+    }
+    if ( utf8 ) {
+        line.append( utf8_words[ random() % 4 ] );
+        line.append( ' ' );
+    }
+    while ( line.size() < length ) {
+        line.append( words[ random() % 20 ] );
+        line.append( QByteArray::number( qulonglong( random() % 100000 ) ) );
+        line.append( ' ' );
+    }
+
+    return line;
+}
+
+// Write the dataset of the profile to the passed file
+inline LogDataset generateLog( const LogProfile& profile, const QString& fileName )
+{
+    LogDataset dataset = { fileName, 0, 0, 0 };
+    std::mt19937_64 random( 42 );
+
+    QFile file( fileName );
+    if ( ! file.open( QIODevice::WriteOnly ) )
+        return dataset;
+
+    QByteArray buffer;
+    for ( qint64 i = 0; i < profile.nbLines; i++ ) {
+        const QByteArray line = generateLine( profile, i, random );
+        if ( line.contains( benchmarkNeedle ) )
+            dataset.nbMatches++;
+        buffer.append( line );
+        buffer.append( '\n' );
+
+        if ( buffer.size() > 1024*1024 ) {
+            file.write( buffer );
+            buffer.clear();
+        }
+    }
+    file.write( buffer );
+
+    dataset.nbLines = profile.nbLines;
+    dataset.size = file.size();
+
+    return dataset;
+}
+
+// Returns the p-th percentile (p in [0, 1]) of the values, 0 if none
+inline double percentile( std::vector<double> values, double p )
+{
+    if ( values.empty() )
+        return 0;
+
+    const size_t rank = std::min( values.size() - 1,
+            size_t( p * values.size() ) );
+    std::nth_element( values.begin(), values.begin() + rank, values.end() );
+    return values[ rank ];
+}
+
+// Returns the peak resident set size of the process, in bytes
+inline qint64 peakResidentSize()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof counters ) )
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024LL;
+#endif
+#endif
+}
+
+// Have the next read of the file come from the disk: the file is dropped
+// from the system's cache (if it can be), and touched so glogg's index
+// cache does not apply to it.
+inline void dropFromCache( const QString& fileName )
+{
+#ifndef _WIN32
+    const QByteArray name = QFile::encodeName( fileName );
+    utimes( name.constData(), nullptr );
+
+    const int fd = open( name.constData(), O_RDONLY );
+    if ( fd < 0 )
+        return;
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+#endif
+    close( fd );
+#else
+    Q_UNUSED( fileName );
+#endif
+}
+
+// Returns how much of the file is in the system's cache, in bytes
+// (0 if it cannot be known)
+inline qint64 cachedSize( const QString& fileName )
+{
+#ifndef _WIN32
+    QFile file( fileName );
+    if ( ! file.open( QIODevice::ReadOnly ) || file.size() == 0 )
+        return 0;
+
+    void* data = mmap( nullptr, file.size(), PROT_READ, MAP_SHARED,
+            file.handle(), 0 );
+    if ( data == MAP_FAILED )
+        return 0;
+
+    const qint64 page = sysconf( _SC_PAGESIZE );
+    std::vector<char> pages( ( file.size() + page - 1 ) / page );
+    qint64 size = 0;
+#ifdef __linux__
+    const bool known = mincore( data, file.size(),
+            reinterpret_cast<unsigned char*>( pages.data() ) ) == 0;
+#else
+    const bool known = mincore( data, file.size(), pages.data() ) == 0;
+#endif
+    if ( known ) {
+        for ( char resident : pages )
+            size += ( resident & 1 ) ? page : 0;
+    }
+    munmap( data, file.size() );
+
+    return qMin( size, file.size() );
+#else
+    Q_UNUSED( fileName );
+    return 0;
+#endif
+}
+
+// The results of the benchmarks of a run, written as JSON to the file
+// GLOGG_BENCHMARK_REPORT names (glogg_benchmarks.json by default) when
+// the tests end, to compare the runs.
+class BenchmarkReport : public ::testing::Environment {
+  public:
+    static BenchmarkReport* instance()
+    {
+        static BenchmarkReport* report = static_cast<BenchmarkReport*>(
+                ::testing::AddGlobalTestEnvironment( new BenchmarkReport() ) );
+        return report;
+    }
+
+    void add( const QJsonObject& result ) { results_.append( result ); }
+
+    void TearDown() override
+    {
+        const char* name = getenv( "GLOGG_BENCHMARK_REPORT" );
+        QFile file( name ? name : "glogg_benchmarks.json" );
+        if ( file.open( QIODevice::WriteOnly ) ) {
+            QJsonObject report;
+            report[ "benchmarks" ] = results_;
+            file.write( QJsonDocument( report ).toJson() );
+        }
+    }
+
+  private:
+    BenchmarkReport() : results_() {}
+
+    QJsonArray results_;
+};
+
+// Times its scope, then reports the throughput on the amount of data
+// and lines processed (set before it ends if not known when created),
+// with the extra results set.
+struct Benchmark {
+    Benchmark( const std::string& name, const char* dataset,
+            qint64 bytes, qint64 lines )
+        : name_( name ), dataset_( dataset ), bytes( bytes ), lines( lines ),
+        extra(), start_( std::chrono::steady_clock::now() )
+    {
+        BenchmarkReport::instance();
+    }
+
+    ~Benchmark()
+    {
+        const double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_ ).count();
+
+        QJsonObject result = extra;
+        result[ "name" ] = QString::fromStdString( name_ );
+        result[ "dataset" ] = dataset_;
+        result[ "seconds" ] = seconds;
+        result[ "bytes" ] = double( bytes );
+        result[ "lines" ] = double( lines );
+        result[ "mb_per_second" ] = bytes / ( 1024.0 * 1024.0 ) / seconds;
+        result[ "lines_per_second" ] = lines / seconds;
+        result[ "peak_rss_bytes" ] = double( peakResidentSize() );
+        BenchmarkReport::instance()->add( result );
+
+        std::cout << std::endl << name_ << " (" << dataset_ << "): "
+            << seconds * 1000 << "ms, "
+            << result[ "mb_per_second" ].toDouble() << " MB/s, "
+            << result[ "lines_per_second" ].toDouble() << " lines/s" << std::endl;
+    }
+
+    const std::string name_;
+    const char* const dataset_;
+    qint64 bytes;
+    qint64 lines;
+    QJsonObject extra;
+    const std::chrono::steady_clock::time_point start_;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "gmock/gmock.h"
+
+#include "perfcounters.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( PerfCountersBehaviour, addsTheCounters ) {
+    PerfCounters::reset();
+    PerfCounters::add( PerfCounters::BytesIndexed, 1000 );
+    PerfCounters::add( PerfCounters::BytesIndexed, 24 );
+    PerfCounters::add( PerfCounters::IndexingTime, 1000000000 );
+
+    const QString json = PerfCounters::toJson();
+    ASSERT_THAT( json.contains( "\"bytes_indexed\": 1024" ), true );
+    ASSERT_THAT( json.contains( "\"indexing_bytes_per_second\": 1024" ), true );
+}
+
+TEST( PerfCountersBehaviour, recordsTheDurations ) {
+    PerfCounters::reset();
+    PerfCounters::record( PerfCounters::PaintTime, 500 );
+    PerfCounters::record( PerfCounters::PaintTime, 3000 );
+    PerfCounters::record( PerfCounters::PaintTime, 2500 );
+
+    // Under 1 us, then twice in [2, 4) us
+    ASSERT_THAT( PerfCounters::report().toStdString(),
+            HasSubstr( "paint_time: 3 times, mean 2 us, max 3 us\n"
+                "          < 1 us: 1\n"
+                "          < 4 us: 2" ) );
+}
+
+TEST( PerfCountersBehaviour, canBeReset ) {
+    PerfCounters::record( PerfCounters::SearchChunkLatency, 1000 );
+    PerfCounters::reset();
+
+    ASSERT_THAT( PerfCounters::report().toStdString(),
+            HasSubstr( "search_chunk_latency: 0 times, mean 0 us, max 0 us" ) );
+}
+
+TEST( PerfCountersBehaviour, timesTheMutexWaits ) {
+    PerfCounters::reset();
+    QMutex mutex;
+    {
+        PerfMutexLocker locker( &mutex, PerfCounters::FileMutexWait );
+    }
+
+    // The mutex was free
+    ASSERT_THAT( mutex.tryLock(), true );
+    mutex.unlock();
+    ASSERT_THAT( PerfCounters::report().toStdString(),
+            HasSubstr( "file_mutex_wait: 0 times" ) );
+}
@@ -0,0 +1,74 @@
+#include "gmock/gmock.h"
+
+#include "pollingschedule.h"
+
+using namespace std;
+using namespace testing;
+
+class PollingScheduleBehaviour: public testing::Test {
+  public:
+    // 100 ms to 800 ms, 4 polls per second
+    PollingSchedule schedule { 100, 800, 4 };
+};
+
+TEST_F( PollingScheduleBehaviour, pollsANewFileAtOnce ) {
+    const int id = schedule.add( 0 );
+
+    ASSERT_THAT( schedule.nextDue(), 0 );
+    ASSERT_THAT( schedule.takeDue( 0 ), ElementsAre( id ) );
+    // Not taken twice
+    ASSERT_THAT( schedule.takeDue( 0 ), IsEmpty() );
+}
+
+TEST_F( PollingScheduleBehaviour, backsOffForIdleFiles ) {
+    const int id = schedule.add( 0 );
+    int64_t now = 0;
+
+    for ( int expected : { 200, 400, 800, 800 } ) {
+        schedule.takeDue( now );
+        schedule.polled( id, false, now );
+        ASSERT_THAT( schedule.interval( id ), expected );
+        ASSERT_THAT( schedule.nextDue(), now + expected );
+        now += expected;
+    }
+}
+
+TEST_F( PollingScheduleBehaviour, speedsUpForChangingFiles ) {
+    const int id = schedule.add( 0 );
+    int64_t now = 0;
+
+    for ( int i = 0; i < 3; i++ ) {
+        schedule.takeDue( now );
+        schedule.polled( id, false, now );
+        now += 1000;
+    }
+    ASSERT_THAT( schedule.interval( id ), 800 );
+
+    schedule.takeDue( now );
+    schedule.polled( id, true, now );
+    ASSERT_THAT( schedule.interval( id ), 100 );
+    ASSERT_THAT( schedule.nextDue(), now + 100 );
+}
+
+TEST_F( PollingScheduleBehaviour, capsThePollsPerSecond ) {
+    vector<int> ids;
+    for ( int i = 0; i < 6; i++ )
+        ids.push_back( schedule.add( i ) );
+
+    // Most overdue first
+    ASSERT_THAT( schedule.takeDue( 10 ), ElementsAre( ids[0], ids[1], ids[2], ids[3] ) );
+    // Nothing more before the next second
+    ASSERT_THAT( schedule.takeDue( 20 ), IsEmpty() );
+    ASSERT_THAT( schedule.nextDue(), 1000 );
+
+    ASSERT_THAT( schedule.takeDue( 1000 ), ElementsAre( ids[4], ids[5] ) );
+}
+
+TEST_F( PollingScheduleBehaviour, forgetsRemovedFiles ) {
+    const int id = schedule.add( 0 );
+    schedule.remove( id );
+
+    ASSERT_THAT( schedule.nextDue(), -1 );
+    ASSERT_THAT( schedule.takeDue( 0 ), IsEmpty() );
+    ASSERT_THAT( schedule.interval( id ), -1 );
+}
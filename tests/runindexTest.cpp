@@ -0,0 +1,65 @@
+#include <cstring>
+
+#include "gmock/gmock.h"
+
+#include "data/runindex.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( RunIndexBehaviour, findsLinesSimilarButForTheirDigits ) {
+    const char* line  = "12:00:01 retrying connection (attempt 3)";
+    const char* other = "12:00:02 retrying connection (attempt 4)";
+    const char* different = "12:00:02 retrying connection (attempt x)";
+    const int length = strlen( line );
+
+    ASSERT_TRUE( RunIndex::similar( line, other, length ) );
+    ASSERT_FALSE( RunIndex::similar( line, different, length ) );
+    ASSERT_THAT( RunIndex::key( line, length ),
+            Eq( RunIndex::key( other, length ) ) );
+    ASSERT_THAT( RunIndex::key( line, length ),
+            Ne( RunIndex::key( different, length ) ) );
+    ASSERT_THAT( RunIndex::key( line, length ),
+            Ne( RunIndex::key( line, length - 1 ) ) );
+}
+
+TEST( RunIndexBehaviour, keepsTheRunsOfSeveralLines ) {
+    RunIndex index;
+    index.add( 0, 30, 3, 1 );
+    index.add( 30, 40, 1, 2 );
+    index.add( 40, 60, 2, 3 );
+
+    const vector<RunIndex::Run> runs = index.runs( 100 );
+    ASSERT_THAT( runs.size(), Eq( 2u ) );
+    ASSERT_THAT( runs[0].begin, Eq( 0 ) );
+    ASSERT_THAT( runs[0].end, Eq( 30 ) );
+    ASSERT_THAT( runs[0].nbLines, Eq( 3 ) );
+    ASSERT_THAT( runs[1].begin, Eq( 40 ) );
+    ASSERT_THAT( runs[1].nbLines, Eq( 2 ) );
+}
+
+TEST( RunIndexBehaviour, mergesTheRunsOfTheSameKeyIndexedSeparately ) {
+    RunIndex index;
+    // A run across the end of a part indexed and the start of the next
+    index.add( 0, 20, 2, 1 );
+    index.add( 20, 30, 1, 1 );
+    index.add( 30, 50, 2, 2 );
+
+    const vector<RunIndex::Run> runs = index.runs( 100 );
+    ASSERT_THAT( runs.size(), Eq( 2u ) );
+    ASSERT_THAT( runs[0].begin, Eq( 0 ) );
+    ASSERT_THAT( runs[0].end, Eq( 30 ) );
+    ASSERT_THAT( runs[0].nbLines, Eq( 3 ) );
+    ASSERT_THAT( runs[1].begin, Eq( 30 ) );
+}
+
+TEST( RunIndexBehaviour, onlyReturnsTheRunsEndingBeforeTheEnd ) {
+    RunIndex index;
+    index.add( 0, 20, 2, 1 );
+    index.add( 20, 50, 3, 2 );
+
+    ASSERT_THAT( index.runs( 40 ).size(), Eq( 1u ) );
+
+    index.clear();
+    ASSERT_TRUE( index.runs( 100 ).empty() );
+}
@@ -0,0 +1,95 @@
+#include <vector>
+
+#include "gmock/gmock.h"
+
+#include "data/searchchunker.h"
+
+using namespace std;
+using namespace testing;
+
+// Lines of the passed length each
+static SearchChunker::LinesSize linesOf( qint64 length )
+{
+    return [length]( qint64 first, qint64 end ) { return ( end - first ) * length; };
+}
+
+static SearchChunker::LinesSize unknownSize()
+{
+    return []( qint64, qint64 ) { return qint64( -1 ); };
+}
+
+// Returns the chunks, all of them being asked for
+static vector<pair<qint64, qint64>> chunks( SearchChunker* chunker )
+{
+    vector<pair<qint64, qint64>> result;
+    qint64 first, end;
+    for ( qint64 i = 0; chunker->chunk( i, &first, &end ); i++ )
+        result.push_back( { first, end } );
+
+    return result;
+}
+
+TEST( SearchChunkerBehaviour, sizesTheChunksInBytes ) {
+    SearchChunker short_lines( 0, 1000000, linesOf( 40 ) );
+    qint64 first, end;
+    ASSERT_TRUE( short_lines.chunk( 0, &first, &end ) );
+    ASSERT_THAT( first, 0 );
+    ASSERT_THAT( end, SearchChunker::initialChunkSize / 40 );
+
+    SearchChunker long_lines( 0, 1000000, linesOf( 50000 ) );
+    ASSERT_TRUE( long_lines.chunk( 0, &first, &end ) );
+    ASSERT_THAT( end, SearchChunker::initialChunkSize / 50000 );
+
+    // A line longer than a chunk is a chunk of its own
+    SearchChunker huge_lines( 10, 13, linesOf( 64 * 1024 * 1024 ) );
+    ASSERT_THAT( chunks( &huge_lines ), ElementsAre( Pair( 10, 11 ),
+                Pair( 11, 12 ), Pair( 12, 13 ) ) );
+}
+
+TEST( SearchChunkerBehaviour, coversAllTheLines ) {
+    SearchChunker chunker( 100, 200000, linesOf( 100 ) );
+    const vector<pair<qint64, qint64>> all = chunks( &chunker );
+
+    ASSERT_THAT( all.front().first, 100 );
+    ASSERT_THAT( all.back().second, 200000 );
+    for ( size_t i = 1; i < all.size(); i++ )
+        ASSERT_THAT( all[i].first, all[i - 1].second );
+
+    // The chunks already sized are not changed
+    chunker.searched( 1000, 100000, 1000 );
+    qint64 first, end;
+    ASSERT_TRUE( chunker.chunk( 1, &first, &end ) );
+    ASSERT_THAT( first, all[1].first );
+    ASSERT_THAT( end, all[1].second );
+}
+
+TEST( SearchChunkerBehaviour, aimsAtTheTargetLatency ) {
+    // 100 MB/s: a chunk of 5 MB takes 50 ms
+    SearchChunker chunker( 0, 10000000, linesOf( 100 ) );
+    chunker.searched( 10000, 1000000, 10000000 );
+
+    qint64 first, end;
+    ASSERT_TRUE( chunker.chunk( 0, &first, &end ) );
+    ASSERT_THAT( end, 50000 );
+
+    // Within the bounds
+    chunker.searched( 100000000, 10000000000LL, 1 );
+    ASSERT_TRUE( chunker.chunk( 1, &first, &end ) );
+    ASSERT_THAT( end - first, SearchChunker::maxChunkSize / 100 );
+}
+
+TEST( SearchChunkerBehaviour, sizesInLinesIfTheSizeIsNotKnown ) {
+    SearchChunker chunker( 0, 1000000, unknownSize() );
+    qint64 first, end;
+    ASSERT_TRUE( chunker.chunk( 0, &first, &end ) );
+    ASSERT_THAT( end, SearchChunker::initialLinesInChunk );
+
+    // 1M lines/s: 50000 lines in 50 ms
+    chunker.searched( 1000, -1, 1000000 );
+    ASSERT_TRUE( chunker.chunk( 1, &first, &end ) );
+    ASSERT_THAT( end - first, 50000 );
+
+    chunker.searched( 1, -1, 1000000000 );
+    ASSERT_TRUE( chunker.chunk( 2, &first, &end ) );
+    ASSERT_THAT( end - first, SearchChunker::minLinesInChunk );
+}
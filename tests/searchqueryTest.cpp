@@ -0,0 +1,88 @@
+#include "gmock/gmock.h"
+
+#include "data/searchquery.h"
+
+using namespace std;
+using namespace testing;
+
+class SearchQueryBehaviour: public testing::Test {
+  public:
+    static const LineNumber nb_lines = 10;
+
+    // Matches of each term given as a list of lines
+    MatchSet makeSet( const vector<LineNumber>& lines ) {
+        MatchSet set;
+        for ( LineNumber line : lines )
+            set.append( line );
+        return set;
+    }
+
+    vector<LineNumber> toVector( const MatchSet& set ) {
+        vector<LineNumber> lines;
+        for ( LineNumber line : set )
+            lines.push_back( line );
+        return lines;
+    }
+
+    // Terms a, b and c (in this order in the query)
+    vector<LineNumber> evaluate( const QString& text ) {
+        SearchQuery query( text, Qt::CaseSensitive );
+        vector<MatchSet> matches = {
+            makeSet( { 1, 2, 3, 4 } ),
+            makeSet( { 3, 4, 5, 6 } ),
+            makeSet( { 4, 6, 8 } ) };
+        matches.resize( query.terms().size() );
+        return toVector( query.evaluate( matches, nb_lines ) );
+    }
+};
+
+TEST_F( SearchQueryBehaviour, parsesTerms ) {
+    SearchQuery query( "a AND \"b c\" OR NOT a", Qt::CaseSensitive );
+    ASSERT_THAT( query.isValid(), true );
+    ASSERT_THAT( query.terms().size(), 2 );
+    ASSERT_THAT( query.terms()[0].pattern(), QString( "a" ) );
+    ASSERT_THAT( query.terms()[1].pattern(), QString( "b c" ) );
+}
+
+TEST_F( SearchQueryBehaviour, unescapesQuotes ) {
+    SearchQuery query( "\"say \\\"hello\\\" \\\\d\"", Qt::CaseSensitive );
+    ASSERT_THAT( query.isValid(), true );
+    ASSERT_THAT( query.terms()[0].pattern(), QString( "say \"hello\" \\\\d" ) );
+}
+
+TEST_F( SearchQueryBehaviour, combinesTerms ) {
+    ASSERT_THAT( evaluate( "a AND b" ), ElementsAre( 3, 4 ) );
+    ASSERT_THAT( evaluate( "a OR b" ), ElementsAre( 1, 2, 3, 4, 5, 6 ) );
+    ASSERT_THAT( evaluate( "a AND NOT b" ), ElementsAre( 1, 2 ) );
+    ASSERT_THAT( evaluate( "NOT a AND b" ), ElementsAre( 5, 6 ) );
+    ASSERT_THAT( evaluate( "NOT a" ), ElementsAre( 0, 5, 6, 7, 8, 9 ) );
+}
+
+TEST_F( SearchQueryBehaviour, andsAdjacentTerms ) {
+    ASSERT_THAT( evaluate( "a b" ), ElementsAre( 3, 4 ) );
+}
+
+TEST_F( SearchQueryBehaviour, followsPrecedence ) {
+    // AND binds tighter than OR
+    ASSERT_THAT( evaluate( "a OR b AND c" ), ElementsAre( 1, 2, 3, 4, 6 ) );
+    ASSERT_THAT( evaluate( "(a OR b) AND c" ), ElementsAre( 4, 6 ) );
+    // NOT binds tighter than AND
+    ASSERT_THAT( evaluate( "NOT a AND NOT b" ), ElementsAre( 0, 7, 8, 9 ) );
+    ASSERT_THAT( evaluate( "NOT (a AND b)" ), ElementsAre( 0, 1, 2, 5, 6, 7, 8, 9 ) );
+}
+
+TEST_F( SearchQueryBehaviour, reusesRepeatedTerms ) {
+    SearchQuery query( "a OR (b AND a)", Qt::CaseSensitive );
+    ASSERT_THAT( query.terms().size(), 2 );
+}
+
+TEST_F( SearchQueryBehaviour, rejectsMalformedQueries ) {
+    ASSERT_THAT( SearchQuery( "", Qt::CaseSensitive ).isValid(), false );
+    ASSERT_THAT( SearchQuery( "a AND", Qt::CaseSensitive ).isValid(), false );
+    ASSERT_THAT( SearchQuery( "OR a", Qt::CaseSensitive ).isValid(), false );
+    ASSERT_THAT( SearchQuery( "(a OR b", Qt::CaseSensitive ).isValid(), false );
+    ASSERT_THAT( SearchQuery( "a)", Qt::CaseSensitive ).isValid(), false );
+    ASSERT_THAT( SearchQuery( "\"a", Qt::CaseSensitive ).isValid(), false );
+    ASSERT_THAT( SearchQuery( "\"\"", Qt::CaseSensitive ).isValid(), false );
+    ASSERT_THAT( SearchQuery( "\"a(\"", Qt::CaseSensitive ).isValid(), false );
+}
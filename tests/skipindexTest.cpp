@@ -0,0 +1,98 @@
+#include <string>
+
+#include "gmock/gmock.h"
+
+#include "data/skipindex.h"
+
+using namespace std;
+using namespace testing;
+
+typedef vector<pair<qint64, qint64>> Ranges;
+
+// Returns the blocks of the passed lines, a block being closed
+// after each line starting with '|'
+static SkipIndex::Blocks build( const vector<string>& lines )
+{
+    SkipIndex::Blocks blocks;
+    SkipIndex::Builder builder( &blocks );
+    for ( const string& line : lines ) {
+        builder.addLine( line.data(), line.size() );
+        if ( line[0] == '|' )
+            builder.finish();
+    }
+    builder.finish();
+
+    return blocks;
+}
+
+static Ranges linesToSearch( const SkipIndex& index, const QRegExp& regexp,
+        qint64 first, qint64 end )
+{
+    Ranges ranges;
+    index.linesToSearch( SkipIndex::query( regexp ), first, end, &ranges );
+    return ranges;
+}
+
+TEST( SkipIndexBehaviour, skipsTheBlocksWithoutTheWords ) {
+    SkipIndex index;
+    index.append( build( { "GET /index.html user=alice",
+                "|done in 12 ms",
+                "GET /about.html user=bob",
+                "|done in 15 ms",
+                "POST /login user=carol",
+                "done in 40 ms" } ), 0 );
+    ASSERT_THAT( index.size(), 3 );
+
+    ASSERT_THAT( linesToSearch( index, QRegExp( "user=bob " ), 0, 6 ),
+            Ranges( { { 2, 4 } } ) );
+    ASSERT_THAT( linesToSearch( index,
+                QRegExp( " post ", Qt::CaseInsensitive ), 0, 6 ),
+            Ranges( { { 4, 6 } } ) );
+    ASSERT_THAT( linesToSearch( index, QRegExp( "/index.html",
+                    Qt::CaseSensitive, QRegExp::FixedString ), 1, 5 ),
+            Ranges( { { 1, 2 } } ) );
+    // Nothing can be required from the matches
+    ASSERT_THAT( linesToSearch( index, QRegExp( "us.r" ), 0, 6 ),
+            Ranges( { { 0, 6 } } ) );
+}
+
+TEST( SkipIndexBehaviour, findsAWordInALongerOne ) {
+    SkipIndex index;
+    index.append( build( { "|trace=4bf92f3577b34da6a3ce929d0e0e4736",
+                "|trace=00f067aa0ba902b7c4d8e61a3b9f5c21" } ), 0 );
+
+    for ( int start = 0; start < 16; start++ ) {
+        const QString part = QString( "4bf92f3577b34da6a3ce929d0e0e4736" ).mid( start, 12 );
+        ASSERT_THAT( linesToSearch( index, QRegExp( part ), 0, 2 ),
+                Ranges( { { 0, 1 } } ) );
+    }
+}
+
+TEST( SkipIndexBehaviour, searchesTheLinesOutOfTheBlocks ) {
+    SkipIndex::Blocks blocks;
+    SkipIndex::Builder builder( &blocks );
+    builder.skipLine();
+    builder.addLine( "first", 5 );
+    builder.finish();
+
+    SkipIndex index;
+    index.append( blocks, 10 );
+    ASSERT_THAT( index.size(), 1 );
+
+    ASSERT_THAT( linesToSearch( index, QRegExp( " missing " ), 0, 20 ),
+            Ranges( { { 0, 11 }, { 12, 20 } } ) );
+}
+
+TEST( SkipIndexBehaviour, canBeTruncatedAndAppendedTo ) {
+    SkipIndex index;
+    index.append( build( { "|alpha", "|beta", "|gamma" } ), 0 );
+
+    index.truncate( 2 );
+    ASSERT_THAT( index.size(), 2 );
+
+    index.append( build( { "|delta" } ), 2 );
+    ASSERT_THAT( linesToSearch( index, QRegExp( " delta " ), 0, 3 ),
+            Ranges( { { 2, 3 } } ) );
+    ASSERT_THAT( linesToSearch( index, QRegExp( " gamma " ), 0, 3 ),
+            Ranges() );
+}
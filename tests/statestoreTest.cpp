@@ -0,0 +1,86 @@
+#include <QFile>
+
+#include "gmock/gmock.h"
+
+#include "data/statestore.h"
+
+using namespace std;
+using namespace testing;
+
+#define TMPDIR "/tmp"
+
+static const char* const stateFile = TMPDIR "/glogg_state_test";
+
+class StateStoreBehaviour : public testing::Test {
+  public:
+    StateStoreBehaviour() { QFile::remove( stateFile ); }
+    ~StateStoreBehaviour() { QFile::remove( stateFile ); }
+};
+
+TEST_F( StateStoreBehaviour, readsBackTheItemsWritten ) {
+    {
+        StateStore store( stateFile );
+        ASSERT_FALSE( store.contains( "marks/a.log" ) );
+
+        store.setValue( "marks/a.log", "first" );
+        store.setValue( "marks/b.log", "second" );
+        store.setValue( "marks/a.log", "third" );
+        store.remove( "marks/b.log" );
+        ASSERT_THAT( store.value( "marks/a.log" ), QByteArray( "third" ) );
+    }
+
+    StateStore store( stateFile );
+    ASSERT_THAT( store.value( "marks/a.log" ), QByteArray( "third" ) );
+    ASSERT_FALSE( store.contains( "marks/b.log" ) );
+}
+
+TEST_F( StateStoreBehaviour, onlyAppendsTheItemsChanged ) {
+    StateStore store( stateFile );
+    store.setValue( "marks/a.log", QByteArray( 1000, 'a' ) );
+    const qint64 size = store.fileSize();
+
+    store.setValue( "marks/b.log", "b" );
+    ASSERT_THAT( store.fileSize(), Lt( size + 100 ) );
+
+    // (nothing is written for the same value)
+    const qint64 new_size = store.fileSize();
+    store.setValue( "marks/b.log", "b" );
+    ASSERT_THAT( store.fileSize(), new_size );
+}
+
+TEST_F( StateStoreBehaviour, dropsARecordCutShort ) {
+    {
+        StateStore store( stateFile );
+        store.setValue( "marks/a.log", "kept" );
+        store.setValue( "marks/b.log", "cut short" );
+    }
+
+    QFile file( stateFile );
+    ASSERT_TRUE( file.resize( file.size() - 3 ) );
+
+    {
+        StateStore store( stateFile );
+        ASSERT_THAT( store.value( "marks/a.log" ), QByteArray( "kept" ) );
+        ASSERT_FALSE( store.contains( "marks/b.log" ) );
+
+        // What is written next is not lost after the bad record
+        store.setValue( "marks/c.log", "new" );
+    }
+
+    StateStore store( stateFile );
+    ASSERT_THAT( store.value( "marks/c.log" ), QByteArray( "new" ) );
+}
+
+TEST_F( StateStoreBehaviour, compactsTheDeadRecords ) {
+    {
+        StateStore store( stateFile );
+        for ( int i = 0; i < 100; i++ )
+            store.setValue( "results/a.log", QByteArray( 10000, 'a' + i % 26 ) );
+        ASSERT_THAT( store.fileSize(), Gt( 100 * 10000LL ) );
+    }
+
+    StateStore store( stateFile );
+    ASSERT_THAT( store.fileSize(), Lt( 11000LL ) );
+    ASSERT_THAT( store.value( "results/a.log" ),
+            QByteArray( 10000, 'a' + 99 % 26 ) );
+}
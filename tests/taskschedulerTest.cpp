@@ -0,0 +1,127 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+
+#include "data/taskscheduler.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( TaskSchedulerBehaviour, runsTheTasksByPriority ) {
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    scheduler.setMaxThreads( 1 );
+
+    // Keeps the only thread busy while the other tasks are queued
+    atomic<bool> started( false );
+    atomic<bool> go( false );
+    TaskScheduler::TaskHandle blocker = scheduler.submit( [&] {
+            started = true;
+            while ( ! go ) this_thread::yield(); },
+            TaskScheduler::Background );
+    while ( ! started )
+        this_thread::yield();
+
+    mutex order_mutex;
+    vector<int> order;
+    vector<TaskScheduler::TaskHandle> tasks;
+    for ( int i = 0; i < 4; i++ )
+        tasks.push_back( scheduler.submit( [&, i] {
+                    lock_guard<mutex> lock( order_mutex );
+                    order.push_back( i ); },
+                    i == 3 ? TaskScheduler::Visible : TaskScheduler::Background ) );
+    scheduler.setPriority( tasks[2], TaskScheduler::Visible );
+    ASSERT_TRUE( scheduler.cancel( tasks[1] ) );
+
+    go = true;
+    for ( const auto& task : tasks )
+        scheduler.wait( task );
+    scheduler.wait( blocker );
+    ASSERT_FALSE( scheduler.cancel( blocker ) );
+
+    ASSERT_THAT( order, ElementsAre( 2, 3, 0 ) );
+
+    scheduler.setMaxThreads( 0 );
+}
+
+TEST( TaskSchedulerBehaviour, runsAllTheTasks ) {
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    scheduler.setMaxThreads( 4 );
+    ASSERT_THAT( scheduler.maxThreads(), 4 );
+
+    atomic<int> nbRun( 0 );
+    vector<TaskScheduler::TaskHandle> tasks;
+    for ( int i = 0; i < 1000; i++ )
+        tasks.push_back( scheduler.submit( [&nbRun] { nbRun++; },
+                    TaskScheduler::Background ) );
+    for ( const auto& task : tasks )
+        scheduler.wait( task );
+
+    ASSERT_THAT( nbRun.load(), 1000 );
+
+    scheduler.setMaxThreads( 0 );
+}
+
+TEST( TaskSchedulerBehaviour, pausesTheBackgroundTasks ) {
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    scheduler.setMaxThreads( 1 );
+
+    // Without pausing, the visible task would never get the thread
+    atomic<bool> started( false );
+    atomic<bool> visibleRun( false );
+    TaskScheduler::TaskHandle background = scheduler.submit( [&] {
+            started = true;
+            const auto end = chrono::steady_clock::now() + chrono::seconds( 10 );
+            while ( ! visibleRun && chrono::steady_clock::now() < end )
+                scheduler.yield(); },
+            TaskScheduler::Background );
+    while ( ! started )
+        this_thread::yield();
+
+    TaskScheduler::TaskHandle visible = scheduler.submit(
+            [&] { visibleRun = true; }, TaskScheduler::Visible );
+    scheduler.wait( visible );
+    scheduler.wait( background );
+
+    ASSERT_TRUE( visibleRun );
+
+    scheduler.setMaxThreads( 0 );
+}
+
+TEST( TaskSchedulerBehaviour, resumesTheTasksExpedited ) {
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    scheduler.setMaxThreads( 1 );
+
+    atomic<bool> started( false );
+    atomic<bool> stop( false );
+    TaskScheduler::TaskHandle background = scheduler.submit( [&] {
+            started = true;
+            while ( ! stop )
+                scheduler.yield(); },
+            TaskScheduler::Background );
+    while ( ! started )
+        this_thread::yield();
+
+    // Pauses the background task until the end of this one
+    atomic<bool> visibleStarted( false );
+    atomic<bool> go( false );
+    TaskScheduler::TaskHandle visible = scheduler.submit( [&] {
+            visibleStarted = true;
+            while ( ! go ) this_thread::yield(); },
+            TaskScheduler::Visible );
+    while ( ! visibleStarted )
+        this_thread::yield();
+
+    // As an interrupted operation
+    stop = true;
+    scheduler.expedite( background );
+    scheduler.wait( background );
+
+    go = true;
+    scheduler.wait( visible );
+
+    scheduler.setMaxThreads( 0 );
+}
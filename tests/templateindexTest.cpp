@@ -0,0 +1,96 @@
+#include <atomic>
+
+#include <QStringList>
+
+#include "gmock/gmock.h"
+
+#include "data/abstractlogdata.h"
+#include "data/templateindex.h"
+
+using namespace std;
+using namespace testing;
+
+// The lines of a log held in memory
+class StringLogData : public AbstractLogData {
+  public:
+    StringLogData( const QStringList& lines ) : lines_( lines ) {}
+
+  protected:
+    QString doGetLineString( qint64 line ) const override
+    { return lines_[ line ]; }
+    QString doGetExpandedLineString( qint64 line ) const override
+    { return lines_[ line ]; }
+    QStringList doGetLines( qint64 first_line, int number ) const override
+    { return lines_.mid( first_line, number ); }
+    QStringList doGetExpandedLines( qint64 first_line, int number ) const override
+    { return lines_.mid( first_line, number ); }
+    qint64 doGetNbLine() const override { return lines_.size(); }
+    int doGetMaxLength() const override { return 80; }
+    int doGetLineLength( qint64 line ) const override
+    { return lines_[ line ].length(); }
+
+  private:
+    const QStringList lines_;
+};
+
+static const QStringList messages = QStringList()
+    << "connected to host alpha"
+    << "connected to host beta"
+    << "user 12 logged in"
+    << "user 345 logged in"
+    << "connected to host gamma"
+    << "disk full";
+
+static vector<LineNumber> linesOf( const MatchSet& matches )
+{
+    return vector<LineNumber>( matches.begin(), matches.end() );
+}
+
+TEST( TemplateIndexBehaviour, minesTheTemplatesOfTheMessages ) {
+    const StringLogData source( messages );
+    const atomic<bool> interrupt( false );
+
+    TemplateIndex index;
+    index.update( &source, source.getNbLine(), &interrupt );
+    ASSERT_THAT( index.nbLinesMined(), 6LL );
+
+    const vector<TemplateIndex::Summary> top = index.topTemplates( 2 );
+    ASSERT_THAT( top.size(), 2u );
+    ASSERT_THAT( top[0].text, QString( "connected to host <*>" ) );
+    ASSERT_THAT( top[0].count, 3LL );
+    ASSERT_THAT( top[1].text, QString( "user <*> logged in" ) );
+    ASSERT_THAT( top[1].count, 2LL );
+
+    ASSERT_THAT( linesOf( index.find( top[0].id, 6 ) ),
+            ElementsAre( 0, 1, 4 ) );
+    ASSERT_THAT( linesOf( index.find( top[1].id, 3 ) ), ElementsAre( 2 ) );
+}
+
+TEST( TemplateIndexBehaviour, minesTheLinesAddedAfterATruncation ) {
+    const StringLogData source( messages );
+    const atomic<bool> interrupt( false );
+
+    TemplateIndex index;
+    index.update( &source, 4, &interrupt );
+    ASSERT_THAT( index.topTemplates( 10 ).size(), 2u );
+
+    index.truncate( 3 );
+    ASSERT_THAT( index.topTemplates( 10 ).back().count, 1LL );
+
+    index.update( &source, source.getNbLine(), &interrupt );
+    const vector<TemplateIndex::Summary> top = index.topTemplates( 10 );
+    ASSERT_THAT( top.size(), 3u );
+    ASSERT_THAT( top[0].count, 3LL );
+    ASSERT_THAT( top[1].count, 2LL );
+    ASSERT_THAT( top[2].text, QString( "disk full" ) );
+}
+
+TEST( TemplateIndexBehaviour, recognisesTheTermsOnATemplate ) {
+    int id = -1;
+    ASSERT_TRUE( TemplateIndex::templateOfTerm(
+                QRegExp( TemplateIndex::termOfTemplate( 12 ) ), &id ) );
+    ASSERT_THAT( id, 12 );
+
+    ASSERT_FALSE( TemplateIndex::templateOfTerm( QRegExp( "template=x" ), &id ) );
+    ASSERT_FALSE( TemplateIndex::templateOfTerm( QRegExp( "level=12" ), &id ) );
+}
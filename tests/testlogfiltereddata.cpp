@@ -67,8 +67,8 @@ void TestLogFilteredData::simpleSearch()
             this, SLOT( loadingFinished() ) );
 
     filteredData_ = logData_->getNewFilteredData();
-    connect( filteredData_, SIGNAL( searchProgressed( int, int ) ),
-            this, SLOT( searchProgressed( int, int ) ) );
+    connect( filteredData_, SIGNAL( searchProgressed( qint64, int ) ),
+            this, SLOT( searchProgressed( qint64, int ) ) );
 
     QFuture<void> future = QtConcurrent::run(this, &TestLogFilteredData::simpleSearchTest);
 
@@ -149,8 +149,8 @@ void TestLogFilteredData::multipleSearch()
             this, SLOT( loadingFinished() ) );
 
     filteredData_ = logData_->getNewFilteredData();
-    connect( filteredData_, SIGNAL( searchProgressed( int, int ) ),
-            this, SLOT( searchProgressed( int, int ) ) );
+    connect( filteredData_, SIGNAL( searchProgressed( qint64, int ) ),
+            this, SLOT( searchProgressed( qint64, int ) ) );
 
     QFuture<void> future = QtConcurrent::run(this, &TestLogFilteredData::multipleSearchTest);
 
@@ -174,19 +174,20 @@ void TestLogFilteredData::multipleSearchTest()
 
     // Performs two searches in a row
     // Start the search, and immediately another one
-    // (the second call should block until the first search is done)
+    // (the first search is abandoned, only the second one reporting
+    // its progress)
     filteredData_->runSearch( QRegExp( "1234" ) );
     filteredData_->runSearch( QRegExp( "123" ) );
 
-    for ( int i = 0; i < 3; i++ ) {
-        waitSearchProgressed();
-        signalSearchProgressedRead();
-    }
-
     // We should have the result for the 2nd search after the last chunk
-    waitSearchProgressed();
+    {
+        std::pair<int,int> progress;
+        do {
+            progress = waitSearchProgressed();
+            signalSearchProgressedRead();
+        } while ( progress.second < 100 );
+    }
     QCOMPARE( filteredData_->getNbLine(), 12LL );
-    signalSearchProgressedRead();
 
     // Now a tricky one: we run a search and immediately attach a new file
     /* FIXME: sometimes we receive loadingFinished before searchProgressed
@@ -217,8 +218,8 @@ void TestLogFilteredData::updateSearch()
             this, SLOT( loadingFinished() ) );
 
     filteredData_ = logData_->getNewFilteredData();
-    connect( filteredData_, SIGNAL( searchProgressed( int, int ) ),
-            this, SLOT( searchProgressed( int, int ) ) );
+    connect( filteredData_, SIGNAL( searchProgressed( qint64, int ) ),
+            this, SLOT( searchProgressed( qint64, int ) ) );
 
     QFuture<void> future = QtConcurrent::run(this, &TestLogFilteredData::updateSearchTest);
 
@@ -359,8 +360,8 @@ void TestLogFilteredData::marks()
             this, SLOT( loadingFinished() ) );
 
     filteredData_ = logData_->getNewFilteredData();
-    connect( filteredData_, SIGNAL( searchProgressed( int, int ) ),
-            this, SLOT( searchProgressed( int, int ) ) );
+    connect( filteredData_, SIGNAL( searchProgressed( qint64, int ) ),
+            this, SLOT( searchProgressed( qint64, int ) ) );
 
     QFuture<void> future = QtConcurrent::run(this, &TestLogFilteredData::marksTest);
 
@@ -412,7 +413,7 @@ void TestLogFilteredData::marksTest()
 
     // Performs a search
     QSignalSpy progressSpy( filteredData_,
-            SIGNAL( searchProgressed( int, int ) ) );
+            SIGNAL( searchProgressed( qint64, int ) ) );
     filteredData_->runSearch( QRegExp( "0000.4" ) );
 
     for ( int i = 0; i < 1; i++ ) {
@@ -461,6 +462,16 @@ void TestLogFilteredData::marksTest()
     QCOMPARE( filteredData_->getLineString(1), startline + "000025" );
     QCOMPARE( filteredData_->getLineString(2), startline + "000044" );
 
+    // Mark all the matches (44 being marked already)
+    filteredData_->markAllMatches();
+
+    QCOMPARE( filteredData_->getNbLine(), 12LL );
+    QCOMPARE( filteredData_->getLineString(0), startline + "000004" );
+    QCOMPARE( filteredData_->getLineString(1), startline + "000010" );
+    QCOMPARE( filteredData_->getLineString(4), startline + "000025" );
+    QCOMPARE( filteredData_->getLineString(6), startline + "000044" );
+    QCOMPARE( filteredData_->getLineString(11), startline + "000094" );
+
     // Another test with marks only
     filteredData_->clearSearch();
     filteredData_->clearMarks();
@@ -486,8 +497,8 @@ void TestLogFilteredData::lineLength()
             this, SLOT( loadingFinished() ) );
 
     filteredData_ = logData_->getNewFilteredData();
-    connect( filteredData_, SIGNAL( searchProgressed( int, int ) ),
-            this, SLOT( searchProgressed( int, int ) ) );
+    connect( filteredData_, SIGNAL( searchProgressed( qint64, int ) ),
+            this, SLOT( searchProgressed( qint64, int ) ) );
 
     QFuture<void> future = QtConcurrent::run(this, &TestLogFilteredData::lineLengthTest);
 
@@ -565,7 +576,7 @@ void TestLogFilteredData::loadingFinished()
         loadingFinishedCondition_.wait( locker.mutex() );
 }
 
-void TestLogFilteredData::searchProgressed( int nbMatches, int completion )
+void TestLogFilteredData::searchProgressed( qint64 nbMatches, int completion )
 {
     QMutexLocker locker( &searchProgressedMutex_ );
 
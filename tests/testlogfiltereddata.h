@@ -23,7 +23,7 @@ class TestLogFilteredData: public QObject
 
     public slots:
         void loadingFinished();
-        void searchProgressed( int completion, int nbMatches );
+        void searchProgressed( qint64 nbMatches, int completion );
 
     private:
         bool generateDataFiles();
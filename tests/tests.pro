@@ -19,12 +19,12 @@ mac {
 
 TARGET = logcrawler_tests
 HEADERS += testlogdata.h testlogfiltereddata.h\
-    ../src/data/logdata.h ../src/data/logfiltereddata.h ../src/data/logdataworkerthread.h\
+    ../src/data/logdata.h ../src/data/logfiltereddata.h ../src/data/logdataworkerthread.h ../src/data/bytescanner.h ../src/data/compressedlinestorage.h ../src/data/indexcache.h ../src/data/rawmatcher.h ../src/data/literalprefilter.h ../src/data/patternsetmatcher.h ../src/data/lineblockcache.h ../src/data/matchset.h ../src/data/searchquery.h\
     ../src/data/abstractlogdata.h ../src/data/logfiltereddataworkerthread.h\
     ../src/platformfilewatcher.h ../src/marks.h
 SOURCES += testlogdata.cpp testlogfiltereddata.cpp \
     ../src/data/abstractlogdata.cpp ../src/data/logdata.cpp ../src/main.cpp\
-    ../src/data/logfiltereddata.cpp ../src/data/logdataworkerthread.cpp\
+    ../src/data/logfiltereddata.cpp ../src/data/logdataworkerthread.cpp ../src/data/bytescanner.cpp ../src/data/compressedlinestorage.cpp ../src/data/indexcache.cpp ../src/data/rawmatcher.cpp ../src/data/literalprefilter.cpp ../src/data/patternsetmatcher.cpp ../src/data/lineblockcache.cpp ../src/data/matchset.cpp ../src/data/searchquery.cpp\
     ../src/data/logfiltereddataworkerthread.cpp\
     ../src/filewatcher.cpp ../src/marks.cpp
 
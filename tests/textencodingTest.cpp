@@ -0,0 +1,103 @@
+#include <string>
+
+#include "gmock/gmock.h"
+
+#include "data/textencoding.h"
+
+using namespace std;
+using namespace testing;
+
+static TextEncoding::Type detect( const string& data )
+{
+    return TextEncoding::detect( data.data(), data.size() ).type();
+}
+
+static QString decode( TextEncoding::Type type, const string& data,
+        bool expandTabs = false )
+{
+    LineDecoder decoder( type );
+    return decoder.decode( data.data(), data.size(), expandTabs );
+}
+
+TEST( TextEncodingBehaviour, detectsTheEncoding ) {
+    ASSERT_THAT( detect( "\xEF\xBB\xBFline 1\n" ), TextEncoding::Utf8 );
+    ASSERT_THAT( detect( string( "\xFF\xFEl\0i\0n\0e\0\n\0", 12 ) ),
+            TextEncoding::Utf16LE );
+    ASSERT_THAT( detect( string( "\xFE\xFF\0l\0i\0n\0e\0\n", 12 ) ),
+            TextEncoding::Utf16BE );
+
+    // Without byte order mark
+    ASSERT_THAT( detect( string( "l\0i\0n\0e\0\n\0", 10 ) ),
+            TextEncoding::Utf16LE );
+    ASSERT_THAT( detect( string( "\0l\0i\0n\0e\0\n", 10 ) ),
+            TextEncoding::Utf16BE );
+    ASSERT_THAT( detect( "caf\xC3\xA9\n" ), TextEncoding::Utf8 );
+    ASSERT_THAT( detect( "caf\xE9\n" ), TextEncoding::Latin1 );
+
+    // The data read might end in the middle of a character
+    ASSERT_THAT( detect( "caf\xC3\xA9 caf\xC3" ), TextEncoding::Utf8 );
+}
+
+TEST( TextEncodingBehaviour, writesTheEndsOfLine ) {
+    ASSERT_THAT( TextEncoding( TextEncoding::Utf8 ).lineFeed(), QByteArray( "\n" ) );
+    ASSERT_THAT( TextEncoding( TextEncoding::Utf16LE ).lineFeed(),
+            QByteArray( "\n\0", 2 ) );
+    ASSERT_THAT( TextEncoding( TextEncoding::Utf16BE ).lineFeed(),
+            QByteArray( "\0\n", 2 ) );
+    ASSERT_THAT( TextEncoding( TextEncoding::Utf16BE ).unitWidth(), 2 );
+    ASSERT_THAT( TextEncoding( TextEncoding::Utf16BE ).lowByteIndex(), 1 );
+}
+
+TEST( TextEncodingBehaviour, decodesTheLines ) {
+    ASSERT_THAT( decode( TextEncoding::Utf8, "caf\xC3\xA9" ),
+            QString::fromUtf8( "caf\xC3\xA9" ) );
+    ASSERT_THAT( decode( TextEncoding::Latin1, "caf\xE9" ),
+            QString::fromUtf8( "caf\xC3\xA9" ) );
+    ASSERT_THAT( decode( TextEncoding::Utf16LE, string( "c\0a\0f\0\xE9\0", 8 ) ),
+            QString::fromUtf8( "caf\xC3\xA9" ) );
+    ASSERT_THAT( decode( TextEncoding::Utf16BE, string( "\0c\0a\0f\0\xE9", 8 ) ),
+            QString::fromUtf8( "caf\xC3\xA9" ) );
+
+    // Out of the BMP
+    ASSERT_THAT( decode( TextEncoding::Utf8, "\xF0\x9F\x98\x80" ),
+            QString::fromUtf8( "\xF0\x9F\x98\x80" ) );
+}
+
+TEST( TextEncodingBehaviour, expandsTheTabs ) {
+    ASSERT_THAT( decode( TextEncoding::Utf8, "a\tb\xC3\xA9\tc", true ),
+            QString::fromUtf8( "a       b\xC3\xA9      c" ) );
+    ASSERT_THAT( decode( TextEncoding::Utf16LE, string( "a\0\t\0b\0", 6 ), true ),
+            QString::fromUtf8( "a       b" ) );
+    ASSERT_THAT( decode( TextEncoding::Utf8, "a\tb", false ),
+            QString::fromUtf8( "a\tb" ) );
+}
+
+TEST( TextEncodingBehaviour, replacesInvalidSequences ) {
+    const QString decoded = decode( TextEncoding::Utf8, "a\xFF\xC3z" );
+
+    ASSERT_THAT( decoded.size(), 4 );
+    ASSERT_THAT( decoded.at( 1 ), QChar( 0xFFFD ) );
+    ASSERT_THAT( decoded.at( 2 ), QChar( 0xFFFD ) );
+    ASSERT_THAT( decoded.at( 3 ), QChar( 'z' ) );
+}
+
+TEST( TextEncodingBehaviour, decodesLinesInABuffer ) {
+    LineDecoder decoder( TextEncoding::Utf8 );
+    LineBuffer lines;
+
+    // Long enough for the buffer to grow
+    const string long_line( 1000, 'x' );
+    decoder.decode( "a\tb", 3, true, &lines );
+    decoder.decode( long_line.data(), long_line.size(), false, &lines );
+    decoder.decode( "\tc", 2, true, &lines );
+
+    ASSERT_THAT( lines.size(), 3 );
+    ASSERT_THAT( lines.string( 0 ), QString::fromUtf8( "a       b" ) );
+    ASSERT_THAT( lines.length( 1 ), 1000 );
+    ASSERT_THAT( lines.string( 2 ), QString::fromUtf8( "        c" ) );
+
+    lines.clear();
+    decoder.decode( "d", 1, true, &lines );
+    ASSERT_THAT( lines.size(), 1 );
+    ASSERT_THAT( lines.string( 0 ), QString::fromUtf8( "d" ) );
+}
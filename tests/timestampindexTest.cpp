@@ -0,0 +1,54 @@
+#include "gmock/gmock.h"
+
+#include "data/timestampindex.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( TimestampIndexBehaviour, findsTheLinesAroundATime ) {
+    TimestampIndex index;
+    index.append( { { 0, 100 }, { 1000, 200 }, { 2000, 300 } }, 0 );
+
+    qint64 first, last;
+    index.findRange( 250, 2500, &first, &last );
+    ASSERT_THAT( first, 1001 );
+    ASSERT_THAT( last, 2000 );
+
+    index.findRange( 200, 2500, &first, &last );
+    ASSERT_THAT( first, 1 );
+    ASSERT_THAT( last, 1000 );
+
+    index.findRange( 50, 2500, &first, &last );
+    ASSERT_THAT( first, 0 );
+    ASSERT_THAT( last, 0 );
+
+    index.findRange( 400, 2500, &first, &last );
+    ASSERT_THAT( first, 2001 );
+    ASSERT_THAT( last, 2500 );
+}
+
+TEST( TimestampIndexBehaviour, keepsTheTimestampsSorted ) {
+    TimestampIndex index;
+    index.append( { { 0, 100 }, { 1000, 300 }, { 2000, 200 }, { 3000, 400 } }, 0 );
+
+    qint64 first, last;
+    index.findRange( 350, 3500, &first, &last );
+    ASSERT_THAT( first, 2001 );
+    ASSERT_THAT( last, 3000 );
+}
+
+TEST( TimestampIndexBehaviour, canBeTruncatedAndAppendedTo ) {
+    TimestampIndex index;
+    index.append( { { 0, 100 }, { 1000, 200 }, { 2000, 300 } }, 0 );
+
+    index.truncate( 1500 );
+    ASSERT_THAT( index.size(), 2 );
+
+    index.append( { { 0, 250 }, { 1000, 350 } }, 1499 );
+    ASSERT_THAT( index.size(), 4 );
+
+    qint64 first, last;
+    index.findRange( 300, 3000, &first, &last );
+    ASSERT_THAT( first, 1500 );
+    ASSERT_THAT( last, 2499 );
+}
@@ -0,0 +1,33 @@
+#include "gmock/gmock.h"
+
+#include "data/timestamprule.h"
+
+using namespace std;
+using namespace testing;
+
+TEST( TimestampRuleBehaviour, ordersFixedWidthTimestampsByTheirDigits ) {
+    TimestampRule rule( QRegExp( "^(\\S+ \\S+)" ) );
+
+    const qint64 first = rule.timestamp( "2015-03-04 12:34:56.789 INFO first" );
+    const qint64 second = rule.timestamp( "2015-03-04 12:35:01.002 INFO second" );
+
+    ASSERT_THAT( first, 20150304123456789LL );
+    ASSERT_THAT( first, Lt( second ) );
+}
+
+TEST( TimestampRuleBehaviour, parsesTimestampsWithAFormat ) {
+    TimestampRule rule( QRegExp( "\\[([^\\]]+)\\]" ), "dd/MM/yyyy hh:mm:ss" );
+
+    const qint64 first = rule.timestamp( "node1 [31/12/2014 23:59:59] first" );
+    const qint64 second = rule.timestamp( "node2 [01/01/2015 00:00:00] second" );
+
+    ASSERT_THAT( second - first, 1000LL );
+}
+
+TEST( TimestampRuleBehaviour, reportsLinesWithoutTimestamp ) {
+    TimestampRule rule( QRegExp( "^(\\d+)" ) );
+    TimestampRule dateRule( QRegExp( "^(\\S+)" ), "yyyy-MM-dd" );
+
+    ASSERT_THAT( rule.timestamp( "    at Foo.bar()" ), TimestampRule::noTimestamp );
+    ASSERT_THAT( dateRule.timestamp( "not-a-date line" ), TimestampRule::noTimestamp );
+}
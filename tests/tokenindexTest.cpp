@@ -0,0 +1,84 @@
+#include <cstring>
+#include <vector>
+
+#include "gmock/gmock.h"
+
+#include "data/tokenindex.h"
+
+using namespace std;
+using namespace testing;
+
+static vector<QByteArray> tokens( const char* line )
+{
+    vector<QByteArray> result;
+    TokenIndex::tokenize( line, strlen( line ), &result );
+
+    return result;
+}
+
+static vector<LineNumber> lines( const MatchSet& set )
+{
+    vector<LineNumber> result;
+    for ( LineNumber line : set )
+        result.push_back( line );
+
+    return result;
+}
+
+static MatchSet matchSet( std::initializer_list<LineNumber> lines )
+{
+    MatchSet set;
+    for ( LineNumber line : lines )
+        set.append( line );
+
+    return set;
+}
+
+class TokenIndexBehaviour : public testing::Test {
+  public:
+    TokenIndex index;
+
+    TokenIndexBehaviour() {
+        QHash<QByteArray, MatchSet> postings;
+        postings.insert( "error", matchSet( { 0, 2 } ) );
+        postings.insert( "errors", matchSet( { 3 } ) );
+        postings.insert( "payment", matchSet( { 0, 1 } ) );
+        postings.insert( "declined", matchSet( { 0 } ) );
+        index.setPostings( postings, 4 );
+    }
+
+    vector<LineNumber> candidates( const QRegExp& regexp ) {
+        MatchSet result;
+        if ( ! index.candidates( regexp, &result ) )
+            return vector<LineNumber>( 1, 999 );
+
+        return lines( result );
+    }
+};
+
+TEST( TokenIndexTokenizing, splitsOnDigitsAndPunctuation ) {
+    ASSERT_THAT( tokens( "12:00 ERROR req42abc, Caf\xC3\xA9_Bar" ),
+            ElementsAre( "error", "req", "abc", "caf\xC3\xA9_bar" ) );
+    ASSERT_THAT( tokens( "12:00:01" ), ElementsAre() );
+}
+
+TEST_F( TokenIndexBehaviour, findsTheLinesHavingTheTokens ) {
+    // Might be part of a token
+    ASSERT_THAT( candidates( QRegExp( "ERROR" ) ), ElementsAre( 0, 2, 3 ) );
+    // Whole tokens
+    ASSERT_THAT( candidates( QRegExp( " error ", Qt::CaseInsensitive ) ),
+            ElementsAre( 0, 2 ) );
+    // The end of a token then the beginning of another one
+    ASSERT_THAT( candidates( QRegExp( "error payment" ) ), ElementsAre( 0 ) );
+    ASSERT_THAT( candidates( QRegExp( "declined: (\\d+) errors" ) ),
+            ElementsAre( 0 ) );
+    ASSERT_THAT( candidates( QRegExp( "missing", Qt::CaseSensitive,
+                    QRegExp::FixedString ) ), ElementsAre() );
+}
+
+TEST_F( TokenIndexBehaviour, needsATokenInThePattern ) {
+    ASSERT_THAT( candidates( QRegExp( "[0-9]+" ) ), ElementsAre( 999 ) );
+    ASSERT_THAT( candidates( QRegExp( "12:00" ) ), ElementsAre( 999 ) );
+    // Too short to be looked up
+    ASSERT_THAT( candidates( QRegExp( "er" ) ), ElementsAre( 999 ) );
+}
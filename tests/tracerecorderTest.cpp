@@ -0,0 +1,49 @@
+#include <thread>
+
+#include <QFile>
+
+#include "gmock/gmock.h"
+
+#include "tracerecorder.h"
+
+using namespace std;
+using namespace testing;
+
+static const char* const traceFile = "/tmp/glogg_trace.json";
+
+static string readTrace()
+{
+    QFile file( traceFile );
+    if ( ! file.open( QIODevice::ReadOnly ) )
+        return "";
+    return file.readAll().toStdString();
+}
+
+TEST( TraceRecorderBehaviour, recordsTheSpansOfTheThreads ) {
+    TraceRecorder::start( traceFile );
+    TraceRecorder::nameThread( "main" );
+    {
+        TraceSpan span( "outer", "test" );
+        std::thread thread( [] {
+                TraceRecorder::nameThread( "worker" );
+                TraceSpan span( "inner", "test" );
+                } );
+        thread.join();
+    }
+    ASSERT_TRUE( TraceRecorder::stop() );
+
+    const string trace = readTrace();
+    ASSERT_THAT( trace, StartsWith( "{\"traceEvents\":[" ) );
+    ASSERT_THAT( trace, HasSubstr( "\"args\":{\"name\":\"main\"}" ) );
+    ASSERT_THAT( trace, HasSubstr( "\"args\":{\"name\":\"worker\"}" ) );
+    ASSERT_THAT( trace, HasSubstr( "{\"name\":\"outer\",\"cat\":\"test\",\"ph\":\"X\"" ) );
+    ASSERT_THAT( trace, HasSubstr( "{\"name\":\"inner\",\"cat\":\"test\",\"ph\":\"X\"" ) );
+}
+
+TEST( TraceRecorderBehaviour, recordsNothingWhenStopped ) {
+    ASSERT_FALSE( TraceRecorder::isRecording() );
+    {
+        TraceSpan span( "ignored", "test" );
+    }
+    ASSERT_FALSE( TraceRecorder::stop() );
+}
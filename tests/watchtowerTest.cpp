@@ -3,6 +3,7 @@
 #include "config.h"
 
 #include <cstdio>
+#include <iostream>
 #include <fcntl.h>
 
 #include <memory>
@@ -18,6 +19,9 @@
 #ifdef _WIN32
 #  include "winwatchtowerdriver.h"
 using PlatformWatchTower = WatchTower<WinWatchTowerDriver>;
+#elif defined(GLOGG_SUPPORTS_KQUEUE)
+#  include "kqueuewatchtowerdriver.h"
+using PlatformWatchTower = WatchTower<KQueueWatchTowerDriver>;
 #else
 #  include "inotifywatchtowerdriver.h"
 using PlatformWatchTower = WatchTower<INotifyWatchTowerDriver>;
@@ -226,6 +230,18 @@ TEST_F( WatchTowerSingleFile, RemovingOneWatchOfTwoStillYieldsOneNotification )
     ASSERT_TRUE( waitNotificationReceived( 1 ) );
 }
 
+TEST_F( WatchTowerSingleFile, ChangesInTheSameCycleAreCoalesced ) {
+    for ( int i = 0; i < 50; i++ )
+        appendDataToFile( file_name );
+
+    ASSERT_TRUE( waitNotificationReceived() );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+
+    const WatchTowerStats stats = watch_tower->stats();
+    ASSERT_THAT( stats.events, Ge( stats.notifications ) );
+    ASSERT_THAT( stats.notifications, Le( stats.drainCycles ) );
+}
+
 TEST_F( WatchTowerSingleFile, RenamingTheFileYieldsANotification ) {
     auto new_file_name = createTempName();
 
@@ -440,6 +456,116 @@ TEST_F( WatchTowerInexistantDirectory, LaterCreatedDirIsFollowed ) {
 
 /*****/
 
+class WatchTowerManyFiles: public WatchTowerDirectories {
+  public:
+    static const int NB_FILES;
+
+    vector<string> file_names;
+
+    WatchTowerManyFiles() {
+        for ( int i = 0; i < NB_FILES; i++ )
+            file_names.push_back( createTempEmptyFileInDir( second_dir_name ) );
+    }
+
+    ~WatchTowerManyFiles() {
+        for ( const auto& name: file_names )
+            remove( name.c_str() );
+    }
+};
+
+const int WatchTowerManyFiles::NB_FILES = 10000;
+
+TEST_F( WatchTowerManyFiles, ScalesToTenThousandFiles ) {
+    using namespace std::chrono;
+
+    auto start = steady_clock::now();
+    vector<Registration> registrations;
+    for ( const auto& name: file_names )
+        registrations.push_back( registerFile( name ) );
+    auto registered = steady_clock::now();
+
+    // Notifications for the last files added, then the first
+    appendDataToFile( file_names.back() );
+    ASSERT_TRUE( waitNotificationReceived() );
+    appendDataToFile( file_names.front() );
+    ASSERT_TRUE( waitNotificationReceived() );
+    auto notified = steady_clock::now();
+
+    registrations.clear();
+    auto removed = steady_clock::now();
+
+    cout << "Registering " << NB_FILES << " files: "
+        << duration_cast<milliseconds>( registered - start ).count() << " ms, "
+        << "notifying: "
+        << duration_cast<milliseconds>( notified - registered ).count() << " ms, "
+        << "removing: "
+        << duration_cast<milliseconds>( removed - notified ).count() << " ms"
+        << endl;
+
+    ASSERT_THAT( watch_tower->numberWatchedDirectories(), Eq( 1 ) );
+}
+
+/*****/
+
+class WatchTowerManyDirectories: public WatchTowerDirectories {
+  public:
+    static const int NB_DIRS;
+
+    vector<string> dir_names;
+    vector<string> file_names;
+
+    WatchTowerManyDirectories() {
+        for ( int i = 0; i < NB_DIRS; i++ ) {
+            dir_names.push_back( createTempDir() );
+            file_names.push_back( createTempEmptyFileInDir( dir_names.back() ) );
+        }
+    }
+
+    ~WatchTowerManyDirectories() {
+        for ( const auto& name: file_names )
+            remove( name.c_str() );
+        for ( const auto& name: dir_names )
+            removeDir( name );
+    }
+};
+
+const int WatchTowerManyDirectories::NB_DIRS = 1000;
+
+TEST_F( WatchTowerManyDirectories, ScalesToAThousandDirectories ) {
+    using namespace std::chrono;
+
+    vector<Registration> registrations;
+    for ( const auto& name: file_names )
+        registrations.push_back( registerFile( name ) );
+
+    // The latency of a change in every hundredth directory
+    microseconds total { 0 };
+    microseconds longest { 0 };
+    int nb_changes = 0;
+    for ( int i = NB_DIRS - 1; i >= 0; i -= 100 ) {
+        auto start = steady_clock::now();
+        appendDataToFile( file_names[i] );
+        ASSERT_TRUE( waitNotificationReceived() );
+        auto latency = duration_cast<microseconds>( steady_clock::now() - start );
+
+        total += latency;
+        longest = max( longest, latency );
+        nb_changes++;
+    }
+
+    cout << "Notifying in " << NB_DIRS << " directories: "
+        << total.count() / nb_changes << " us mean latency, "
+        << longest.count() << " us max" << endl;
+
+    // With the directory of the fixture's file
+    ASSERT_THAT( watch_tower->numberWatchedDirectories(), Eq( NB_DIRS + 1 ) );
+
+    registrations.clear();
+    ASSERT_THAT( watch_tower->numberWatchedDirectories(), Eq( 1 ) );
+}
+
+/*****/
+
 #ifdef _WIN32
 class WinNotificationInfoListTest : public testing::Test {
   public: